@@ -5,22 +5,29 @@
 
 #include "spdk/stdinc.h"
 #include "spdk/env.h"
+#include "spdk/histogram_data.h"
 #include "spdk/json.h"
 #include "spdk/likely.h"
 #include "spdk/string.h"
 #include "spdk/util.h"
 
+#include <algorithm>
 #include <map>
+#include <new>
+#include <utility>
+#include <vector>
 
 extern "C" {
 #include "spdk/trace_parser.h"
 #include "spdk/util.h"
+#include "spdk_internal/trace_defs.h"
 }
 
 static struct spdk_trace_parser *g_parser;
 static const struct spdk_trace_flags *g_flags;
 static struct spdk_json_write_ctx *g_json;
 static bool g_print_tsc = false;
+static bool g_latency = false;
 
 /* This is a bit ugly, but we don't want to include env_dpdk in the app, while spdk_util, which we
  * do need, uses some of the functions implemented there.  We're not actually using the functions
@@ -189,6 +196,10 @@ print_event_json(struct spdk_trace_parser_entry *entry, uint64_t tsc_rate, uint6
 
 	spdk_json_write_object_begin(g_json);
 	spdk_json_write_named_uint64(g_json, "lcore", entry->lcore);
+	if (spdk_trace_parser_get_thread_name(g_parser, entry->lcore) != NULL) {
+		spdk_json_write_named_string(g_json, "thread",
+					     spdk_trace_parser_get_thread_name(g_parser, entry->lcore));
+	}
 	spdk_json_write_named_uint64(g_json, "tpoint", e->tpoint_id);
 	spdk_json_write_named_uint64(g_json, "tsc", e->tsc);
 
@@ -250,10 +261,473 @@ print_event_json(struct spdk_trace_parser_entry *entry, uint64_t tsc_rate, uint6
 	spdk_json_write_object_end(g_json);
 }
 
+/*
+ * Latency breakdown mode.  The tracepoints recorded for the same object (e.g. an NVMe-oF request or
+ * a bdev_io) between its creation and its reuse make up a span.  The time between each pair of
+ * consecutive tracepoints of a span is attributed to one of the stages below.  Spans are chained
+ * into requests through the tracepoints' related objects, e.g. an NVMe-oF request, its bdev_io and
+ * the NVMe request submitted for it.  The histograms of the per-request stage totals, the span
+ * durations and the individual transitions are printed at the end.
+ */
+enum latency_stage {
+	LATENCY_STAGE_QUEUEING,
+	LATENCY_STAGE_TRANSPORT,
+	LATENCY_STAGE_BDEV,
+	LATENCY_STAGE_DEVICE,
+	LATENCY_STAGE_OTHER,
+	LATENCY_STAGE_COUNT,
+};
+
+static const char *g_latency_stage_names[] = {
+	"queueing",
+	"transport",
+	"bdev",
+	"device",
+	"other",
+};
+
+static const double g_latency_cutoffs[] = { 0.5, 0.9, 0.99, 0.999 };
+
+struct latency_stats {
+	struct spdk_histogram_data	*histogram;
+	uint64_t			count;
+	uint64_t			total;
+	uint64_t			min;
+	uint64_t			max;
+
+	latency_stats() : count(0), total(0), min(UINT64_MAX), max(0)
+	{
+		histogram = spdk_histogram_data_alloc();
+		if (histogram == NULL) {
+			throw std::bad_alloc();
+		}
+	}
+	~latency_stats() { spdk_histogram_data_free(histogram); }
+	latency_stats(const latency_stats &) = delete;
+	latency_stats &operator=(const latency_stats &) = delete;
+
+	void tally(uint64_t tsc)
+	{
+		spdk_histogram_data_tally(histogram, tsc);
+		count++;
+		total += tsc;
+		min = spdk_min(min, tsc);
+		max = spdk_max(max, tsc);
+	}
+};
+
+struct latency_interval {
+	uint64_t	start;
+	uint64_t	end;
+	int		stage;
+};
+
+struct latency_span {
+	uint8_t		object_type;
+	uint64_t	object_index;
+	uint64_t	start;
+	uint64_t	last;
+	uint16_t	last_tpoint;
+	uint32_t	num_transitions;
+	std::vector<latency_interval> intervals;
+
+	/* Span of the top-level object of the request this span is a part of */
+	uint64_t	root;
+	/* Distance from the top-level object, following the related objects */
+	uint32_t	depth;
+	/* Only kept up to date in the root span: spans of the request and how many are unfinished */
+	std::vector<uint64_t> members;
+	uint32_t	num_open;
+};
+
+/* All the spans of the requests which aren't finished yet, by span id */
+static std::map<uint64_t, latency_span> g_latency_spans;
+static uint64_t g_latency_span_id;
+/* Spans in progress, by object type and object id */
+static std::map<std::pair<uint8_t, uint64_t>, uint64_t> g_latency_active;
+/* Spans in progress, by object type and object index, used to find related objects' spans */
+static std::map<std::pair<uint8_t, uint64_t>, uint64_t> g_latency_index;
+/* Time between two tracepoints, by their ids */
+static std::map<std::pair<uint16_t, uint16_t>, latency_stats> g_latency_transitions;
+/* Per-request totals of each stage */
+static std::map<int, latency_stats> g_latency_stages;
+/* Whole span durations, by object type */
+static std::map<uint8_t, latency_stats> g_latency_objects;
+
+static enum latency_stage
+get_latency_stage(uint8_t object_type, const struct spdk_trace_tpoint *from)
+{
+	/* Time spent waiting for resources, whichever layer the request is in */
+	if (strstr(from->name, "PENDING") != NULL || strstr(from->name, "NEED_BUFFER") != NULL ||
+	    strstr(from->name, "QUEUED") != NULL) {
+		return LATENCY_STAGE_QUEUEING;
+	}
+
+	switch (object_type) {
+	case OBJECT_ISCSI_PDU:
+	case OBJECT_NVME_TCP_REQ:
+	case OBJECT_NVMF_RDMA_IO:
+	case OBJECT_NVMF_TCP_IO:
+	case OBJECT_NVMF_FC_IO:
+	case OBJECT_NVME_NVDA_TCP_REQ:
+		return LATENCY_STAGE_TRANSPORT;
+	case OBJECT_BDEV_IO:
+	case OBJECT_BDEV_NVME_IO:
+	case OBJECT_SCSI_TASK:
+		return LATENCY_STAGE_BDEV;
+	case OBJECT_NVME_PCIE_REQ:
+		return LATENCY_STAGE_DEVICE;
+	default:
+		return LATENCY_STAGE_OTHER;
+	}
+}
+
+/*
+ * The stages of the objects making up a request overlap, e.g. the transport stage of an NVMe-oF
+ * request covers the bdev stage of its bdev_io.  Each moment of the request is attributed to the
+ * stage of the innermost object being processed at that time.
+ */
 static void
-process_event(struct spdk_trace_parser_entry *e, uint64_t tsc_rate, uint64_t tsc_offset)
+latency_request_finish(const latency_span &root)
 {
+	std::vector<std::pair<const latency_interval *, uint32_t>> intervals;
+	std::vector<uint64_t> points;
+	uint64_t stages[LATENCY_STAGE_COUNT] = {};
+	uint32_t depth;
+	size_t i;
+	int stage;
+
+	for (uint64_t id : root.members) {
+		const latency_span &span = g_latency_spans.at(id);
+
+		for (const latency_interval &interval : span.intervals) {
+			intervals.push_back(std::make_pair(&interval, span.depth));
+			points.push_back(interval.start);
+			points.push_back(interval.end);
+		}
+	}
+
+	std::sort(points.begin(), points.end());
+	points.erase(std::unique(points.begin(), points.end()), points.end());
+
+	for (i = 0; i + 1 < points.size(); ++i) {
+		stage = -1;
+		depth = 0;
+
+		for (auto &interval : intervals) {
+			if (interval.first->start > points[i] || interval.first->end < points[i + 1]) {
+				continue;
+			}
+			if (stage == -1 || interval.second >= depth) {
+				stage = interval.first->stage;
+				depth = interval.second;
+			}
+		}
+
+		if (stage != -1) {
+			stages[stage] += points[i + 1] - points[i];
+		}
+	}
+
+	for (i = 0; i < LATENCY_STAGE_COUNT; ++i) {
+		if (stages[i] != 0) {
+			g_latency_stages[i].tally(stages[i]);
+		}
+	}
+}
+
+static void
+latency_span_finish(uint64_t id)
+{
+	latency_span &span = g_latency_spans.at(id);
+
+	g_latency_index.erase(std::make_pair(span.object_type, span.object_index));
+
+	/* A lone tracepoint doesn't tell anything about the latency */
+	if (span.num_transitions != 0) {
+		g_latency_objects[span.object_type].tally(span.last - span.start);
+	}
+
+	latency_span &root = g_latency_spans.at(span.root);
+	assert(root.num_open > 0);
+	if (--root.num_open != 0) {
+		return;
+	}
+
+	latency_request_finish(root);
+
+	std::vector<uint64_t> members;
+	members.swap(root.members);
+	for (uint64_t member : members) {
+		g_latency_spans.erase(member);
+	}
+}
+
+/*
+ * Makes the span a part of the request of its related object, e.g. a bdev_io becomes a part of the
+ * NVMe-oF request it was submitted for.  Only spans which don't have any related spans yet are
+ * linked, so that each request forms a tree.
+ */
+static void
+latency_span_link(uint64_t id, latency_span &span, const struct spdk_trace_parser_entry *entry)
+{
+	if (entry->related_type == OBJECT_NONE || span.root != id || span.members.size() != 1) {
+		return;
+	}
+
+	auto it = g_latency_index.find(std::make_pair(entry->related_type, entry->related_index));
+	if (it == g_latency_index.end()) {
+		return;
+	}
+
+	latency_span &parent = g_latency_spans.at(it->second);
+	latency_span &root = g_latency_spans.at(parent.root);
+	if (parent.root == id) {
+		return;
+	}
+
+	span.root = parent.root;
+	span.depth = parent.depth + 1;
+	span.members.clear();
+	span.num_open = 0;
+
+	root.members.push_back(id);
+	root.num_open++;
+}
+
+static void
+process_latency(struct spdk_trace_parser_entry *entry)
+{
+	struct spdk_trace_entry		*e = entry->entry;
+	const struct spdk_trace_tpoint	*d = &g_flags->tpoint[e->tpoint_id];
+	std::pair<uint8_t, uint64_t>	key(d->object_type, e->object_id);
+	latency_span			*span;
+	latency_interval		interval;
+	uint64_t			id;
+
+	/* Tracepoints of objects created before the trace was captured can't be tied to a span */
+	if (d->object_type == OBJECT_NONE || entry->object_index == UINT64_MAX) {
+		return;
+	}
+
+	auto it = g_latency_active.find(key);
+	if (d->new_object) {
+		if (it != g_latency_active.end()) {
+			latency_span_finish(it->second);
+		}
+
+		id = ++g_latency_span_id;
+		span = &g_latency_spans[id];
+		span->object_type = d->object_type;
+		span->object_index = entry->object_index;
+		span->start = span->last = e->tsc;
+		span->last_tpoint = e->tpoint_id;
+		span->root = id;
+		span->members.push_back(id);
+		span->num_open = 1;
+
+		g_latency_active[key] = id;
+		g_latency_index[std::make_pair(d->object_type, entry->object_index)] = id;
+		latency_span_link(id, *span, entry);
+		return;
+	}
+
+	if (it == g_latency_active.end()) {
+		return;
+	}
+
+	id = it->second;
+	span = &g_latency_spans.at(id);
+
+	interval.start = span->last;
+	interval.end = e->tsc;
+	interval.stage = get_latency_stage(d->object_type, &g_flags->tpoint[span->last_tpoint]);
+	span->intervals.push_back(interval);
+	span->num_transitions++;
+	g_latency_transitions[std::make_pair(span->last_tpoint, e->tpoint_id)].tally(e->tsc - span->last);
+
+	span->last = e->tsc;
+	span->last_tpoint = e->tpoint_id;
+	latency_span_link(id, *span, entry);
+}
+
+struct latency_cutoff_ctx {
+	const double	*cutoff;
+	uint64_t	values[SPDK_COUNTOF(g_latency_cutoffs)];
+	size_t		num_values;
+};
+
+static void
+check_latency_cutoff(void *ctx, uint64_t start, uint64_t end, uint64_t count,
+		     uint64_t total, uint64_t so_far)
+{
+	struct latency_cutoff_ctx *cctx = (struct latency_cutoff_ctx *)ctx;
+
+	if (count == 0) {
+		return;
+	}
+
+	while (cctx->num_values < SPDK_COUNTOF(g_latency_cutoffs) &&
+	       (double)so_far / total >= g_latency_cutoffs[cctx->num_values]) {
+		cctx->values[cctx->num_values++] = end;
+	}
+}
+
+static void
+print_latency_bucket(void *ctx, uint64_t start, uint64_t end, uint64_t count,
+		     uint64_t total, uint64_t so_far)
+{
+	if (count == 0) {
+		return;
+	}
+
+	if (g_json != NULL) {
+		spdk_json_write_array_begin(g_json);
+		spdk_json_write_double(g_json, get_us_from_tsc(start, g_flags->tsc_rate));
+		spdk_json_write_double(g_json, get_us_from_tsc(end, g_flags->tsc_rate));
+		spdk_json_write_uint64(g_json, count);
+		spdk_json_write_array_end(g_json);
+	} else {
+		printf("  %12.3f - %12.3f: %9.4f%%  (%9ju)\n",
+		       get_us_from_tsc(start, g_flags->tsc_rate),
+		       get_us_from_tsc(end, g_flags->tsc_rate),
+		       (double)so_far * 100 / total, count);
+	}
+}
+
+static void
+print_latency_stats(const char *name, const latency_stats &stats, bool histogram)
+{
+	struct latency_cutoff_ctx	cctx = {};
+	uint64_t			tsc_rate = g_flags->tsc_rate;
+	size_t				i;
+
+	spdk_histogram_data_iterate(stats.histogram, check_latency_cutoff, &cctx);
+	for (i = 0; i < cctx.num_values; ++i) {
+		/* Bucket ends overestimate the values, report the maximum at most */
+		cctx.values[i] = spdk_min(cctx.values[i], stats.max);
+	}
+
+	if (g_json == NULL) {
+		printf("%-48.48s %9ju %10.3f %10.3f", name, stats.count,
+		       get_us_from_tsc(stats.total, tsc_rate) / stats.count,
+		       get_us_from_tsc(stats.min, tsc_rate));
+		for (i = 0; i < cctx.num_values; ++i) {
+			printf(" %10.3f", get_us_from_tsc(cctx.values[i], tsc_rate));
+		}
+		printf(" %10.3f\n", get_us_from_tsc(stats.max, tsc_rate));
+		if (histogram) {
+			spdk_histogram_data_iterate(stats.histogram, print_latency_bucket, NULL);
+		}
+		return;
+	}
+
+	spdk_json_write_named_string(g_json, "name", name);
+	spdk_json_write_named_uint64(g_json, "count", stats.count);
+	spdk_json_write_named_double(g_json, "avg_us", get_us_from_tsc(stats.total, tsc_rate) /
+				     stats.count);
+	spdk_json_write_named_double(g_json, "min_us", get_us_from_tsc(stats.min, tsc_rate));
+	spdk_json_write_named_double(g_json, "max_us", get_us_from_tsc(stats.max, tsc_rate));
+	spdk_json_write_named_array_begin(g_json, "percentiles");
+	for (i = 0; i < cctx.num_values; ++i) {
+		spdk_json_write_object_begin(g_json);
+		spdk_json_write_named_double(g_json, "percentile", g_latency_cutoffs[i] * 100);
+		spdk_json_write_named_double(g_json, "us", get_us_from_tsc(cctx.values[i], tsc_rate));
+		spdk_json_write_object_end(g_json);
+	}
+	spdk_json_write_array_end(g_json);
+	if (histogram) {
+		spdk_json_write_named_array_begin(g_json, "histogram");
+		spdk_histogram_data_iterate(stats.histogram, print_latency_bucket, NULL);
+		spdk_json_write_array_end(g_json);
+	}
+}
+
+static void
+print_latency_header(const char *title)
+{
+	char label[32];
+	size_t i;
+
+	printf("\n%-48s %9s %10s %10s", title, "Count", "Avg(us)", "Min(us)");
+	for (i = 0; i < SPDK_COUNTOF(g_latency_cutoffs); ++i) {
+		snprintf(label, sizeof(label), "p%g(us)", g_latency_cutoffs[i] * 100);
+		printf(" %10s", label);
+	}
+	printf(" %10s\n", "Max(us)");
+}
+
+static void
+print_latency_breakdown(void)
+{
+	char name[2 * sizeof(g_flags->tpoint[0].name) + 8];
+
+	for (auto &span : g_latency_active) {
+		latency_span_finish(span.second);
+	}
+	g_latency_active.clear();
+
+	if (g_json == NULL) {
+		print_latency_header("Stage");
+	} else {
+		spdk_json_write_named_array_begin(g_json, "stages");
+	}
+	for (auto &stage : g_latency_stages) {
+		if (g_json != NULL) {
+			spdk_json_write_object_begin(g_json);
+		}
+		print_latency_stats(g_latency_stage_names[stage.first], stage.second, true);
+		if (g_json != NULL) {
+			spdk_json_write_object_end(g_json);
+		}
+	}
+
 	if (g_json == NULL) {
+		print_latency_header("Object");
+	} else {
+		spdk_json_write_array_end(g_json);
+		spdk_json_write_named_array_begin(g_json, "objects");
+	}
+	for (auto &object : g_latency_objects) {
+		snprintf(name, sizeof(name), "%c", g_flags->object[object.first].id_prefix);
+		if (g_json != NULL) {
+			spdk_json_write_object_begin(g_json);
+		}
+		print_latency_stats(name, object.second, false);
+		if (g_json != NULL) {
+			spdk_json_write_object_end(g_json);
+		}
+	}
+
+	if (g_json == NULL) {
+		print_latency_header("Transition");
+	} else {
+		spdk_json_write_array_end(g_json);
+		spdk_json_write_named_array_begin(g_json, "transitions");
+	}
+	for (auto &transition : g_latency_transitions) {
+		snprintf(name, sizeof(name), "%s -> %s", g_flags->tpoint[transition.first.first].name,
+			 g_flags->tpoint[transition.first.second].name);
+		if (g_json != NULL) {
+			spdk_json_write_object_begin(g_json);
+		}
+		print_latency_stats(name, transition.second, false);
+		if (g_json != NULL) {
+			spdk_json_write_object_end(g_json);
+		}
+	}
+
+	if (g_json != NULL) {
+		spdk_json_write_array_end(g_json);
+	}
+}
+
+static void
+process_event(struct spdk_trace_parser_entry *e, uint64_t tsc_rate, uint64_t tsc_offset)
+{
+	if (g_latency) {
+		process_latency(e);
+	} else if (g_json == NULL) {
 		print_event(e, tsc_rate, tsc_offset);
 	} else {
 		print_event_json(e, tsc_rate, tsc_offset);
@@ -323,7 +797,7 @@ usage(void)
 {
 	fprintf(stderr, "usage:\n");
 	fprintf(stderr, "   %s <option> <lcore#>\n", g_exe_name);
-	fprintf(stderr, "                 '-c' to display single lcore history\n");
+	fprintf(stderr, "                 '-c' to display single lcore (or user thread) history\n");
 	fprintf(stderr, "                 '-t' to display TSC offset for each event\n");
 	fprintf(stderr, "                 '-s' to specify spdk_trace shm name for a\n");
 	fprintf(stderr, "                      currently running process\n");
@@ -334,6 +808,8 @@ usage(void)
 	fprintf(stderr, "                 '-f' to specify a tracepoint file name\n");
 	fprintf(stderr, "                      (-s and -f are mutually exclusive)\n");
 	fprintf(stderr, "                 '-j' to use JSON to format the output\n");
+	fprintf(stderr, "                 '-l' to print the latency breakdown of the traced\n");
+	fprintf(stderr, "                      requests instead of the events\n");
 }
 
 int
@@ -345,13 +821,14 @@ main(int argc, char **argv)
 	uint64_t			tsc_offset, entry_count;
 	const char			*app_name = NULL;
 	const char			*file_name = NULL;
+	const char			*thread_name;
 	int				op, i;
 	char				shm_name[64];
 	int				shm_id = -1, shm_pid = -1;
 	bool				json = false;
 
 	g_exe_name = argv[0];
-	while ((op = getopt(argc, argv, "c:f:i:jp:s:t")) != -1) {
+	while ((op = getopt(argc, argv, "c:f:i:jlp:s:t")) != -1) {
 		switch (op) {
 		case 'c':
 			lcore = atoi(optarg);
@@ -380,6 +857,9 @@ main(int argc, char **argv)
 		case 'j':
 			json = true;
 			break;
+		case 'l':
+			g_latency = true;
+			break;
 		default:
 			usage();
 			exit(1);
@@ -430,13 +910,18 @@ main(int argc, char **argv)
 	} else {
 		spdk_json_write_object_begin(g_json);
 		print_tpoint_definitions();
-		spdk_json_write_named_array_begin(g_json, "entries");
+		if (!g_latency) {
+			spdk_json_write_named_array_begin(g_json, "entries");
+		}
 	}
 
 	for (i = 0; i < SPDK_TRACE_MAX_LCORE; ++i) {
 		if (lcore == SPDK_TRACE_MAX_LCORE || i == lcore) {
 			entry_count = spdk_trace_parser_get_entry_count(g_parser, i);
-			if (entry_count > 0) {
+			thread_name = spdk_trace_parser_get_thread_name(g_parser, i);
+			if (entry_count > 0 && thread_name != NULL) {
+				printf("Trace Size of thread %s (%d): %ju\n", thread_name, i, entry_count);
+			} else if (entry_count > 0) {
 				printf("Trace Size of lcore (%d): %ju\n", i, entry_count);
 			}
 		}
@@ -450,8 +935,14 @@ main(int argc, char **argv)
 		process_event(&entry, g_flags->tsc_rate, tsc_offset);
 	}
 
+	if (g_latency) {
+		print_latency_breakdown();
+	}
+
 	if (g_json != NULL) {
-		spdk_json_write_array_end(g_json);
+		if (!g_latency) {
+			spdk_json_write_array_end(g_json);
+		}
 		spdk_json_write_object_end(g_json);
 		spdk_json_write_end(g_json);
 	}
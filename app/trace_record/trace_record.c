@@ -4,6 +4,7 @@
  */
 
 #include "spdk/stdinc.h"
+#include "spdk/config.h"
 
 #include "spdk/env.h"
 #include "spdk/string.h"
@@ -11,9 +12,59 @@
 #include "spdk/util.h"
 #include "spdk/barrier.h"
 
+#ifdef SPDK_CONFIG_ISAL
+#include "../isa-l/include/igzip_lib.h"
+#endif
+
 #define TRACE_FILE_COPY_SIZE	(32 * 1024)
 #define TRACE_PATH_MAX		2048
 
+#define TRACE_STREAM_MAGIC		"SPDKTRS"
+#define TRACE_STREAM_VERSION		1
+#define TRACE_STREAM_CHUNK_MAGIC	0x4b4e4843 /* "CHNK" */
+#define TRACE_STREAM_CHUNK_COMPRESSED	(1 << 0)
+
+/*
+ * Entries this close to the application's next entry index may be rewritten by a tracepoint
+ * being recorded at the moment, as a tracepoint with arguments spans several entries.
+ */
+#define TRACE_STREAM_GUARD_ENTRIES	16
+
+/* A chunk is written once this fraction of the circular buffer holds new entries */
+#define TRACE_STREAM_CHUNK_DIVISOR	8
+
+enum trace_stream_chunk_type {
+	/* Trace entries of an lcore, starting at first_entry */
+	TRACE_STREAM_CHUNK_ENTRIES,
+	/* struct spdk_trace_history of an lcore (without the entries) at the end of the capture */
+	TRACE_STREAM_CHUNK_HISTORY,
+};
+
+/*
+ * Layout of a trace stream file: the header, followed by struct spdk_trace_flags of the
+ * traced application, followed by any number of chunks, each being a struct
+ * trace_stream_chunk and data_len bytes of (optionally compressed) data.
+ */
+struct trace_stream_header {
+	char		magic[8];
+	uint32_t	version;
+	uint32_t	reserved;
+};
+
+struct trace_stream_chunk {
+	uint32_t	magic;
+	uint16_t	type;
+	uint16_t	flags;
+	uint32_t	lcore;
+	uint32_t	reserved;
+	/* Sequence number of the first entry in the chunk */
+	uint64_t	first_entry;
+	uint64_t	num_entries;
+	/* Total number of entries of the lcore dropped so far */
+	uint64_t	num_dropped;
+	uint64_t	data_len;
+};
+
 static char *g_exe_name;
 static int g_verbose = 1;
 static uint64_t g_tsc_rate;
@@ -37,6 +88,9 @@ struct lcore_trace_record_ctx {
 
 	/* Total number of entries in lcore trace file */
 	uint64_t num_entries;
+
+	/* Number of entries overwritten in shared memory before they were recorded */
+	uint64_t num_dropped;
 };
 
 struct aggr_trace_record_ctx {
@@ -45,6 +99,21 @@ struct aggr_trace_record_ctx {
 	int shm_fd;
 	struct lcore_trace_record_ctx lcore_ports[SPDK_TRACE_MAX_LCORE];
 	struct spdk_trace_histories *trace_histories;
+
+	/* Streaming mode */
+	bool stream;
+	int stream_fd;
+	/* Entries copied out of shared memory */
+	void *stream_buf;
+	/* Compressed entries */
+	void *stream_zbuf;
+	size_t stream_buf_size;
+	size_t stream_zbuf_size;
+#ifdef SPDK_CONFIG_ISAL
+	void *stream_level_buf;
+	struct isal_zstream zstream;
+	struct inflate_state zstate;
+#endif
 };
 
 static int
@@ -389,6 +458,7 @@ lcore_trace_record(struct lcore_trace_record_ctx *lcore_port)
 		/* There must be missed updates */
 		fprintf(stderr, "Trace-record missed %ju trace entries\n",
 			shm_next_entry - rec_next_entry - num_cir_entries);
+		lcore_port->num_dropped += shm_next_entry - rec_next_entry - num_cir_entries;
 
 		lcore_port->num_entries += num_cir_entries;
 		rc = circular_buffer_padding_all(fd, in_history, shm_cir_next);
@@ -529,6 +599,468 @@ out:
 	return rc;
 }
 
+static int
+trace_stream_buf_reserve(void **buf, size_t *buf_size, size_t size)
+{
+	void *new_buf;
+
+	if (size <= *buf_size) {
+		return 0;
+	}
+
+	new_buf = realloc(*buf, size);
+	if (new_buf == NULL) {
+		fprintf(stderr, "Failed to allocate memory for trace stream buffer.\n");
+		return -1;
+	}
+
+	*buf = new_buf;
+	*buf_size = size;
+
+	return 0;
+}
+
+static int
+trace_stream_prepare(struct aggr_trace_record_ctx *ctx, const char *path)
+{
+	int flags = O_CREAT | O_EXCL | O_WRONLY;
+	struct trace_stream_header hdr = {};
+	struct lcore_trace_record_ctx *lcore_port;
+	uint64_t max_entries = 0;
+	int i, rc;
+
+	ctx->out_file = path;
+	for (i = 0; i < SPDK_TRACE_MAX_LCORE; i++) {
+		lcore_port = &ctx->lcore_ports[i];
+		if (lcore_port->valid) {
+			max_entries = spdk_max(max_entries, lcore_port->in_history->num_entries);
+		}
+	}
+
+	if (max_entries == 0) {
+		fprintf(stderr, "No trace histories to stream.\n");
+		return -1;
+	}
+
+	rc = trace_stream_buf_reserve(&ctx->stream_buf, &ctx->stream_buf_size,
+				      max_entries * sizeof(struct spdk_trace_entry));
+	if (rc) {
+		return rc;
+	}
+
+#ifdef SPDK_CONFIG_ISAL
+	/* Chunks which don't get smaller when compressed are stored as they are */
+	rc = trace_stream_buf_reserve(&ctx->stream_zbuf, &ctx->stream_zbuf_size, ctx->stream_buf_size);
+	if (rc) {
+		return rc;
+	}
+
+	ctx->stream_level_buf = malloc(ISAL_DEF_LVL1_DEFAULT);
+	if (ctx->stream_level_buf == NULL) {
+		fprintf(stderr, "Failed to allocate memory for compression.\n");
+		return -1;
+	}
+#endif
+
+	/* If output trace file already exists, try to unlink it */
+	if (access(path, F_OK) == 0) {
+		rc = unlink(path);
+		if (rc) {
+			fprintf(stderr, "Could not remove existing trace file %s.\n", path);
+			return -1;
+		}
+	}
+
+	ctx->stream_fd = open(path, flags, 0600);
+	if (ctx->stream_fd < 0) {
+		fprintf(stderr, "Could not open trace stream file %s.\n", path);
+		return -1;
+	}
+
+	memcpy(hdr.magic, TRACE_STREAM_MAGIC, sizeof(TRACE_STREAM_MAGIC));
+	hdr.version = TRACE_STREAM_VERSION;
+
+	rc = cont_write(ctx->stream_fd, &hdr, sizeof(hdr));
+	if (rc < 0) {
+		fprintf(stderr, "Failed to write header into trace stream file\n");
+		return rc;
+	}
+
+	rc = cont_write(ctx->stream_fd, &ctx->trace_histories->flags, sizeof(struct spdk_trace_flags));
+	if (rc < 0) {
+		fprintf(stderr, "Failed to write trace flags into trace stream file\n");
+		return rc;
+	}
+
+	if (g_verbose) {
+		printf("Create trace stream file %s for output\n", path);
+	}
+
+	return 0;
+}
+
+static void *
+trace_stream_compress(struct aggr_trace_record_ctx *ctx, void *data, struct trace_stream_chunk *chunk)
+{
+#ifdef SPDK_CONFIG_ISAL
+	struct isal_zstream *zstream = &ctx->zstream;
+
+	isal_deflate_stateless_init(zstream);
+	zstream->level = 1;
+	zstream->level_buf = ctx->stream_level_buf;
+	zstream->level_buf_size = ISAL_DEF_LVL1_DEFAULT;
+	zstream->end_of_stream = 1;
+	zstream->flush = NO_FLUSH;
+	zstream->next_in = data;
+	zstream->avail_in = chunk->data_len;
+	zstream->next_out = ctx->stream_zbuf;
+	zstream->avail_out = chunk->data_len;
+
+	if (isal_deflate_stateless(zstream) == COMP_OK) {
+		chunk->flags |= TRACE_STREAM_CHUNK_COMPRESSED;
+		chunk->data_len = zstream->total_out;
+		return ctx->stream_zbuf;
+	}
+#endif
+	return data;
+}
+
+static int
+trace_stream_decompress(struct aggr_trace_record_ctx *ctx, void *data, uint64_t data_len,
+			void *out, uint64_t out_len)
+{
+#ifdef SPDK_CONFIG_ISAL
+	struct inflate_state *zstate = &ctx->zstate;
+	int rc;
+
+	isal_inflate_init(zstate);
+	zstate->next_in = data;
+	zstate->avail_in = data_len;
+	zstate->next_out = out;
+	zstate->avail_out = out_len;
+
+	rc = isal_inflate_stateless(zstate);
+	if (rc != ISAL_DECOMP_OK || zstate->total_out != out_len) {
+		fprintf(stderr, "Failed to decompress trace stream chunk (%d)\n", rc);
+		return -1;
+	}
+
+	return 0;
+#else
+	fprintf(stderr, "ISA-L is required to read compressed trace stream chunks\n");
+	return -1;
+#endif
+}
+
+static int
+trace_stream_write_chunk(struct aggr_trace_record_ctx *ctx, struct trace_stream_chunk *chunk,
+			 void *data)
+{
+	int rc;
+
+	chunk->magic = TRACE_STREAM_CHUNK_MAGIC;
+
+	rc = cont_write(ctx->stream_fd, chunk, sizeof(*chunk));
+	if (rc < 0) {
+		fprintf(stderr, "Failed to write chunk header into trace stream file\n");
+		return rc;
+	}
+
+	rc = cont_write(ctx->stream_fd, data, chunk->data_len);
+	if (rc < 0) {
+		fprintf(stderr, "Failed to write chunk into trace stream file\n");
+		return rc;
+	}
+
+	return 0;
+}
+
+/*
+ * Copies the entries added since the last call out of the circular buffer, by their sequence
+ * numbers, and appends them to the stream file as a single chunk.  Unless flush is set, nothing is
+ * written until a sizeable part of the buffer is filled, to keep the chunks large enough to compress
+ * well.  Entries overwritten before they could be copied are counted as dropped.
+ */
+static int
+lcore_trace_stream(struct aggr_trace_record_ctx *ctx, struct lcore_trace_record_ctx *lcore_port,
+		   bool flush)
+{
+	struct spdk_trace_history	*in_history = lcore_port->in_history;
+	struct spdk_trace_entry		*entries = ctx->stream_buf;
+	struct trace_stream_chunk	chunk = {};
+	uint64_t			num_cir_entries = in_history->num_entries;
+	uint64_t			shm_next_entry;
+	uint64_t			first_entry, num_entries, num_dropped = 0;
+	uint64_t			cir_start, len, skip;
+	void				*data;
+	int				rc;
+
+	shm_next_entry = in_history->next_entry;
+
+	/* Ensure all entries of spdk_trace_history are latest to next_entry */
+	spdk_smp_rmb();
+
+	if (shm_next_entry < lcore_port->rec_next_entry) {
+		fprintf(stderr, "Trace porting error in lcore %d, trace rollback occurs.\n", in_history->lcore);
+		fprintf(stderr, "shm_next_entry is %ju, record_next_entry is %ju.\n", shm_next_entry,
+			lcore_port->rec_next_entry);
+		return -1;
+	}
+
+	first_entry = lcore_port->rec_next_entry;
+	num_entries = shm_next_entry - first_entry;
+	if (num_entries == 0 ||
+	    (!flush && num_entries < spdk_max(num_cir_entries / TRACE_STREAM_CHUNK_DIVISOR, 1))) {
+		return 0;
+	}
+
+	if (num_entries > num_cir_entries) {
+		/* Entries overwritten before the recording started don't count as dropped */
+		if (lcore_port->rec_next_entry != 0) {
+			num_dropped += num_entries - num_cir_entries;
+		}
+
+		first_entry = shm_next_entry - num_cir_entries;
+		num_entries = num_cir_entries;
+	}
+
+	cir_start = first_entry & (num_cir_entries - 1);
+	len = spdk_min(num_entries, num_cir_entries - cir_start);
+	memcpy(entries, &in_history->entries[cir_start], len * sizeof(*entries));
+	memcpy(&entries[len], &in_history->entries[0], (num_entries - len) * sizeof(*entries));
+
+	/* Ensure the entries were copied before checking how far the application got meanwhile */
+	spdk_smp_rmb();
+
+	if (in_history->next_entry + TRACE_STREAM_GUARD_ENTRIES > first_entry + num_cir_entries) {
+		/* The oldest entries might have been overwritten while being copied */
+		skip = spdk_min(in_history->next_entry + TRACE_STREAM_GUARD_ENTRIES -
+				num_cir_entries - first_entry, num_entries);
+		if (lcore_port->rec_next_entry != 0) {
+			num_dropped += skip;
+		}
+
+		entries += skip;
+		first_entry += skip;
+		num_entries -= skip;
+	}
+
+	if (num_dropped != 0) {
+		fprintf(stderr, "Trace-record dropped %ju trace entries for lcore %d\n", num_dropped,
+			in_history->lcore);
+		lcore_port->num_dropped += num_dropped;
+	}
+
+	if (num_entries != 0) {
+		chunk.type = TRACE_STREAM_CHUNK_ENTRIES;
+		chunk.lcore = in_history->lcore;
+		chunk.first_entry = first_entry;
+		chunk.num_entries = num_entries;
+		chunk.num_dropped = lcore_port->num_dropped;
+		chunk.data_len = num_entries * sizeof(*entries);
+
+		data = trace_stream_compress(ctx, entries, &chunk);
+		rc = trace_stream_write_chunk(ctx, &chunk, data);
+		if (rc) {
+			return rc;
+		}
+
+		if (g_verbose) {
+			printf("Stream %ju trace_entry for lcore %d (%ju bytes)\n", num_entries,
+			       in_history->lcore, chunk.data_len);
+		}
+
+		if (lcore_port->first_entry_tsc == 0) {
+			lcore_port->first_entry_tsc = entries[0].tsc;
+		}
+		lcore_port->last_entry_tsc = entries[num_entries - 1].tsc;
+		lcore_port->num_entries += num_entries;
+	}
+
+	lcore_port->rec_next_entry = shm_next_entry;
+
+	return 0;
+}
+
+static int
+trace_stream_finish(struct aggr_trace_record_ctx *ctx)
+{
+	struct lcore_trace_record_ctx *lcore_port;
+	struct trace_stream_chunk chunk;
+	int i, rc;
+
+	/* Append the final tpoint_count of each lcore */
+	for (i = 0; i < SPDK_TRACE_MAX_LCORE; i++) {
+		lcore_port = &ctx->lcore_ports[i];
+		if (!lcore_port->valid) {
+			continue;
+		}
+
+		memset(&chunk, 0, sizeof(chunk));
+		chunk.type = TRACE_STREAM_CHUNK_HISTORY;
+		chunk.lcore = i;
+		chunk.num_entries = lcore_port->num_entries;
+		chunk.num_dropped = lcore_port->num_dropped;
+		chunk.data_len = sizeof(struct spdk_trace_history);
+
+		rc = trace_stream_write_chunk(ctx, &chunk, lcore_port->in_history);
+		if (rc) {
+			goto out;
+		}
+	}
+
+	/* Tracepoints and owners might have been registered after the recording started */
+	if (lseek(ctx->stream_fd, sizeof(struct trace_stream_header), SEEK_SET) < 0) {
+		fprintf(stderr, "Failed to lseek trace stream file\n");
+		rc = -1;
+		goto out;
+	}
+
+	rc = cont_write(ctx->stream_fd, &ctx->trace_histories->flags, sizeof(struct spdk_trace_flags));
+	if (rc < 0) {
+		fprintf(stderr, "Failed to write trace flags into trace stream file\n");
+		goto out;
+	}
+
+	rc = 0;
+	printf("All lcores trace entries are streamed into trace file %s\n", ctx->out_file);
+	printf("Use '%s -d %s -f <file>' to convert it for spdk_trace\n", g_exe_name, ctx->out_file);
+
+out:
+	close(ctx->stream_fd);
+
+	return rc;
+}
+
+static int
+trace_stream_convert(struct aggr_trace_record_ctx *ctx, const char *stream_file, const char *path)
+{
+	struct trace_stream_header hdr;
+	struct trace_stream_chunk chunk;
+	struct lcore_trace_record_ctx *lcore_port;
+	struct spdk_trace_entry *entries;
+	uint64_t size;
+	void *data;
+	int fd, i, rc = -1;
+
+	fd = open(stream_file, O_RDONLY);
+	if (fd < 0) {
+		fprintf(stderr, "Could not open trace stream file %s.\n", stream_file);
+		return -1;
+	}
+
+	ctx->trace_histories = calloc(1, sizeof(struct spdk_trace_histories));
+	if (ctx->trace_histories == NULL) {
+		fprintf(stderr, "Failed to allocate memory for trace flags.\n");
+		goto out;
+	}
+
+	if (cont_read(fd, &hdr, sizeof(hdr)) != sizeof(hdr) ||
+	    memcmp(hdr.magic, TRACE_STREAM_MAGIC, sizeof(TRACE_STREAM_MAGIC)) != 0 ||
+	    hdr.version != TRACE_STREAM_VERSION) {
+		fprintf(stderr, "%s is not a trace stream file.\n", stream_file);
+		goto out;
+	}
+
+	if (cont_read(fd, &ctx->trace_histories->flags, sizeof(struct spdk_trace_flags)) !=
+	    sizeof(struct spdk_trace_flags)) {
+		fprintf(stderr, "Failed to read trace flags from trace stream file\n");
+		goto out;
+	}
+
+	g_tsc_rate = ctx->trace_histories->flags.tsc_rate;
+	g_utsc_rate = g_tsc_rate / 1000;
+	if (g_tsc_rate == 0) {
+		fprintf(stderr, "Invalid tsc_rate %ju\n", g_tsc_rate);
+		goto out;
+	}
+
+	for (i = 0; i < SPDK_TRACE_MAX_LCORE; i++) {
+		ctx->lcore_ports[i].valid = ctx->trace_histories->flags.lcore_history_offsets[i] != 0;
+	}
+
+	rc = output_trace_files_prepare(ctx, path);
+	if (rc) {
+		goto out;
+	}
+
+	for (i = 0; i < SPDK_TRACE_MAX_LCORE; i++) {
+		if (ctx->lcore_ports[i].valid) {
+			ctx->lcore_ports[i].out_history->lcore = i;
+		}
+	}
+
+	while ((rc = cont_read(fd, &chunk, sizeof(chunk))) == sizeof(chunk)) {
+		if (chunk.magic != TRACE_STREAM_CHUNK_MAGIC || chunk.lcore >= SPDK_TRACE_MAX_LCORE ||
+		    !ctx->lcore_ports[chunk.lcore].valid) {
+			fprintf(stderr, "Invalid chunk in trace stream file\n");
+			rc = -1;
+			goto out;
+		}
+
+		lcore_port = &ctx->lcore_ports[chunk.lcore];
+		if (chunk.type == TRACE_STREAM_CHUNK_ENTRIES) {
+			size = chunk.num_entries * sizeof(struct spdk_trace_entry);
+		} else {
+			size = sizeof(struct spdk_trace_history);
+		}
+
+		if (trace_stream_buf_reserve(&ctx->stream_buf, &ctx->stream_buf_size, size) ||
+		    trace_stream_buf_reserve(&ctx->stream_zbuf, &ctx->stream_zbuf_size, chunk.data_len)) {
+			rc = -1;
+			goto out;
+		}
+
+		data = (chunk.flags & TRACE_STREAM_CHUNK_COMPRESSED) ? ctx->stream_zbuf : ctx->stream_buf;
+		if (cont_read(fd, data, chunk.data_len) != (int)chunk.data_len) {
+			/* The recording was interrupted in the middle of writing a chunk */
+			rc = -1;
+			break;
+		}
+
+		if (chunk.flags & TRACE_STREAM_CHUNK_COMPRESSED) {
+			rc = trace_stream_decompress(ctx, data, chunk.data_len, ctx->stream_buf, size);
+			if (rc) {
+				goto out;
+			}
+		} else if (chunk.data_len != size) {
+			fprintf(stderr, "Invalid chunk length in trace stream file\n");
+			rc = -1;
+			goto out;
+		}
+
+		if (chunk.type == TRACE_STREAM_CHUNK_HISTORY) {
+			memcpy(lcore_port->out_history, ctx->stream_buf, sizeof(struct spdk_trace_history));
+			continue;
+		}
+
+		rc = cont_write(lcore_port->fd, ctx->stream_buf, size);
+		if (rc < 0) {
+			fprintf(stderr, "Failed to append entries into lcore file\n");
+			goto out;
+		}
+
+		entries = ctx->stream_buf;
+		if (lcore_port->first_entry_tsc == 0) {
+			lcore_port->first_entry_tsc = entries[0].tsc;
+		}
+		lcore_port->last_entry_tsc = entries[chunk.num_entries - 1].tsc;
+		lcore_port->num_entries += chunk.num_entries;
+		lcore_port->num_dropped = chunk.num_dropped;
+	}
+
+	if (rc != 0) {
+		fprintf(stderr, "Trace stream file %s is truncated, converting the complete chunks\n",
+			stream_file);
+	}
+
+	rc = trace_files_aggregate(ctx);
+out:
+	close(fd);
+
+	return rc;
+}
+
 static void
 __shutdown_signal(int signo)
 {
@@ -561,6 +1093,30 @@ setup_exit_signal_handler(void)
 	return rc;
 }
 
+static void
+trace_record_report(struct aggr_trace_record_ctx *ctx)
+{
+	struct lcore_trace_record_ctx	*lcore_port;
+	int				i;
+
+	printf("TSC Rate: %ju\n", g_tsc_rate);
+	for (i = 0; i < SPDK_TRACE_MAX_LCORE; i++) {
+		lcore_port = &ctx->lcore_ports[i];
+
+		if (lcore_port->num_entries == 0 && lcore_port->num_dropped == 0) {
+			continue;
+		}
+
+		printf("Port %ju trace entries for lcore (%d) in %ju usec\n",
+		       lcore_port->num_entries, i,
+		       (lcore_port->last_entry_tsc - lcore_port->first_entry_tsc) / g_utsc_rate);
+
+		if (lcore_port->num_dropped != 0) {
+			printf("Dropped %ju trace entries for lcore (%d)\n", lcore_port->num_dropped, i);
+		}
+	}
+}
+
 static void
 usage(void)
 {
@@ -575,6 +1131,10 @@ usage(void)
 	printf("                 '-p' to specify the trace PID\n");
 	printf("                      (one of -i or -p must be specified)\n");
 	printf("                 '-f' to specify output trace file name\n");
+	printf("                 '-S' to stream the trace entries into the output file\n");
+	printf("                      while recording, in (compressed) chunks\n");
+	printf("                 '-d' to specify a trace stream file to convert into\n");
+	printf("                      the output trace file\n");
 	printf("                 '-h' to print usage information\n");
 }
 
@@ -583,6 +1143,7 @@ main(int argc, char **argv)
 {
 	const char			*app_name = NULL;
 	const char			*file_name = NULL;
+	const char			*stream_file = NULL;
 	int				op;
 	char				shm_name[64];
 	int				shm_id = -1, shm_pid = -1;
@@ -592,7 +1153,7 @@ main(int argc, char **argv)
 	struct lcore_trace_record_ctx	*lcore_port;
 
 	g_exe_name = argv[0];
-	while ((op = getopt(argc, argv, "f:i:p:qs:h")) != -1) {
+	while ((op = getopt(argc, argv, "d:f:i:p:qs:Sh")) != -1) {
 		switch (op) {
 		case 'i':
 			shm_id = spdk_strtol(optarg, 10);
@@ -609,6 +1170,12 @@ main(int argc, char **argv)
 		case 'f':
 			file_name = optarg;
 			break;
+		case 'S':
+			ctx.stream = true;
+			break;
+		case 'd':
+			stream_file = optarg;
+			break;
 		case 'h':
 			usage();
 			exit(EXIT_SUCCESS);
@@ -624,6 +1191,21 @@ main(int argc, char **argv)
 		exit(1);
 	}
 
+	if (stream_file != NULL) {
+		rc = trace_stream_convert(&ctx, stream_file, file_name);
+		if (rc) {
+			exit(1);
+		}
+
+		trace_record_report(&ctx);
+		output_trace_files_finish(&ctx);
+		free(ctx.trace_histories);
+		free(ctx.stream_buf);
+		free(ctx.stream_zbuf);
+
+		return 0;
+	}
+
 	if (app_name == NULL) {
 		fprintf(stderr, "-s must be specified\n");
 		usage();
@@ -652,7 +1234,11 @@ main(int argc, char **argv)
 		exit(1);
 	}
 
-	rc = output_trace_files_prepare(&ctx, file_name);
+	if (ctx.stream) {
+		rc = trace_stream_prepare(&ctx, file_name);
+	} else {
+		rc = output_trace_files_prepare(&ctx, file_name);
+	}
 	if (rc) {
 		exit(1);
 	}
@@ -665,7 +1251,12 @@ main(int argc, char **argv)
 			if (!lcore_port->valid) {
 				continue;
 			}
-			rc = lcore_trace_record(lcore_port);
+
+			if (ctx.stream) {
+				rc = lcore_trace_stream(&ctx, lcore_port, false);
+			} else {
+				rc = lcore_trace_record(lcore_port);
+			}
 			if (rc) {
 				break;
 			}
@@ -676,31 +1267,41 @@ main(int argc, char **argv)
 		exit(1);
 	}
 
-	printf("Start to aggregate lcore trace files\n");
-	rc = trace_files_aggregate(&ctx);
+	if (ctx.stream) {
+		/* Write out the entries which didn't fill a whole chunk yet */
+		for (i = 0; i < SPDK_TRACE_MAX_LCORE && rc == 0; i++) {
+			lcore_port = &ctx.lcore_ports[i];
+			if (lcore_port->valid) {
+				rc = lcore_trace_stream(&ctx, lcore_port, true);
+			}
+		}
+
+		if (rc == 0) {
+			rc = trace_stream_finish(&ctx);
+		}
+	} else {
+		printf("Start to aggregate lcore trace files\n");
+		rc = trace_files_aggregate(&ctx);
+	}
 	if (rc) {
 		exit(1);
 	}
 
 	/* Summary report */
-	printf("TSC Rate: %ju\n", g_tsc_rate);
-	for (i = 0; i < SPDK_TRACE_MAX_LCORE; i++) {
-		lcore_port = &ctx.lcore_ports[i];
-
-		if (lcore_port->num_entries == 0) {
-			continue;
-		}
-
-		printf("Port %ju trace entries for lcore (%d) in %ju usec\n",
-		       lcore_port->num_entries, i,
-		       (lcore_port->last_entry_tsc - lcore_port->first_entry_tsc) / g_utsc_rate);
-
-	}
+	trace_record_report(&ctx);
 
 	munmap(ctx.trace_histories, g_histories_size);
 	close(ctx.shm_fd);
 
-	output_trace_files_finish(&ctx);
+	if (ctx.stream) {
+		free(ctx.stream_buf);
+		free(ctx.stream_zbuf);
+#ifdef SPDK_CONFIG_ISAL
+		free(ctx.stream_level_buf);
+#endif
+	} else {
+		output_trace_files_finish(&ctx);
+	}
 
 	return 0;
 }
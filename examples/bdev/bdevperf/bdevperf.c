@@ -21,10 +21,30 @@
 #include "spdk/zipf.h"
 #include "spdk/histogram_data.h"
 
+#include "bdevperf_replay.h"
+
 #define BDEVPERF_CONFIG_MAX_FILENAME 1024
 #define BDEVPERF_CONFIG_UNDEFINED -1
 #define BDEVPERF_CONFIG_ERROR -2
 
+/* Open-loop latencies are tracked with finer buckets than the bdev histograms (~0.2% precision) */
+#define BDEVPERF_OPEN_LOOP_BUCKET_SHIFT 9
+#define BDEVPERF_RAMP_MAX_STEPS 32
+/* A ramp step is past the latency knee once its p99 latency grows this many times over the first
+ * step's one, or once the achieved rate falls below BDEVPERF_RAMP_KNEE_RATE_PCT of the target. */
+#define BDEVPERF_RAMP_KNEE_FACTOR 2
+#define BDEVPERF_RAMP_KNEE_RATE_PCT 90
+
+static const struct {
+	const char		*name;
+	enum spdk_bdev_io_type	io_type;
+} g_replay_ops[BDEVPERF_REPLAY_NUM_OPS] = {
+	[BDEVPERF_REPLAY_OP_READ] = { "read", SPDK_BDEV_IO_TYPE_READ },
+	[BDEVPERF_REPLAY_OP_WRITE] = { "write", SPDK_BDEV_IO_TYPE_WRITE },
+	[BDEVPERF_REPLAY_OP_UNMAP] = { "unmap", SPDK_BDEV_IO_TYPE_UNMAP },
+	[BDEVPERF_REPLAY_OP_FLUSH] = { "flush", SPDK_BDEV_IO_TYPE_FLUSH },
+};
+
 struct bdevperf_task {
 	struct iovec			iov;
 	struct bdevperf_job		*job;
@@ -32,8 +52,14 @@ struct bdevperf_task {
 	void				*buf;
 	void				*md_buf;
 	uint64_t			offset_blocks;
+	uint64_t			num_blocks;
 	struct bdevperf_task		*task_to_abort;
 	enum spdk_bdev_io_type		io_type;
+	/* Open-loop mode: the time the I/O was due to be submitted and the ramp step at that time */
+	uint64_t			due_tsc;
+	uint32_t			ramp_step;
+	enum bdevperf_replay_op		replay_op;
+	uint64_t			submit_tsc;
 	TAILQ_ENTRY(bdevperf_task)	link;
 	struct spdk_bdev_io_wait_entry	bdev_io_wait;
 };
@@ -69,6 +95,17 @@ static int g_timeout_in_sec;
 static struct spdk_conf *g_bdevperf_conf = NULL;
 static const char *g_bdevperf_conf_file = NULL;
 static double g_zipf_theta;
+static uint64_t g_open_loop_rate = 0;
+static bool g_poisson_arrivals = false;
+static int g_ramp_steps = 0;
+static const char *g_replay_file = NULL;
+static double g_replay_speed = 1.0;
+static double g_replay_tsc_per_usec;
+static struct bdevperf_replay_trace g_replay;
+/* Number of get_job_stats RPCs walking the jobs */
+static uint32_t g_job_stats_in_progress = 0;
+/* The test finished while get_job_stats RPCs were walking the jobs */
+static bool g_test_done_pending = false;
 
 static struct spdk_cpuset g_all_cpuset;
 static struct spdk_poller *g_perf_timer = NULL;
@@ -98,10 +135,19 @@ static const double g_latency_cutoffs[] = {
 	-1,
 };
 
+static const double g_open_loop_cutoffs[] = {
+	0.50,
+	0.99,
+	0.999,
+	0.9999,
+	-1,
+};
+
 struct latency_info {
 	uint64_t	min;
 	uint64_t	max;
 	uint64_t	total;
+	uint64_t	count;
 };
 
 struct bdevperf_job {
@@ -148,6 +194,42 @@ struct bdevperf_job {
 
 	/* keep channel's histogram data before being destroyed */
 	struct spdk_histogram_data	*histogram;
+
+	/* Open-loop mode: I/O is submitted at this rate (IOPS) instead of keeping queue_depth
+	 * I/Os outstanding.  0 means closed-loop mode. */
+	uint64_t			rate;
+	struct spdk_poller		*submit_poller;
+	uint64_t			start_tsc;
+	uint64_t			next_submit_tsc;
+	/* The rate is ramped up from rate / num_ramp_steps to rate, in equal steps */
+	uint32_t			num_ramp_steps;
+	uint64_t			ramp_step_tsc;
+	/* Latencies measured from the time the I/O was due, per ramp step */
+	struct spdk_histogram_data	*open_loop_histogram[BDEVPERF_RAMP_MAX_STEPS];
+	uint64_t			open_loop_max[BDEVPERF_RAMP_MAX_STEPS];
+	uint64_t			open_loop_completed[BDEVPERF_RAMP_MAX_STEPS];
+
+	/* Replay mode: the job submits every replay_stride-th record of the trace, starting with
+	 * replay_next, at the time it was recorded (scaled by the replay speed). */
+	bool				replay;
+	uint64_t			replay_next;
+	uint64_t			replay_stride;
+	uint64_t			replay_skipped;
+	/* Latencies measured from the time the I/O was due, per I/O type */
+	struct spdk_histogram_data	*replay_histogram[BDEVPERF_REPLAY_NUM_OPS];
+	uint64_t			replay_max[BDEVPERF_REPLAY_NUM_OPS];
+	uint64_t			replay_total[BDEVPERF_REPLAY_NUM_OPS];
+	uint64_t			replay_completed[BDEVPERF_REPLAY_NUM_OPS];
+
+	/* Live statistics: latencies and counters since the previous get_job_stats RPC. The
+	 * latencies are collected in open-loop and replay mode, otherwise only once the RPC was
+	 * called, to keep the default closed-loop runs free of the extra per-I/O work. */
+	bool				stats_latency;
+	struct spdk_histogram_data	*stats_histogram;
+	uint64_t			stats_prev_tsc;
+	uint64_t			stats_prev_completed;
+	uint64_t			stats_prev_failed;
+	uint64_t			stats_prev_timeout;
 };
 
 struct spdk_bdevperf {
@@ -172,6 +254,7 @@ enum job_config_rw {
 	JOB_CONFIG_RW_UNMAP,
 	JOB_CONFIG_RW_FLUSH,
 	JOB_CONFIG_RW_WRITE_ZEROES,
+	JOB_CONFIG_RW_REPLAY,
 };
 
 /* Storing values from a section of job config file */
@@ -182,6 +265,7 @@ struct job_config {
 	int				bs;
 	int				iodepth;
 	int				rwmixread;
+	uint64_t			rate;
 	int64_t				offset;
 	uint64_t			length;
 	enum job_config_rw		rw;
@@ -248,6 +332,7 @@ get_avg_latency(void *ctx, uint64_t start, uint64_t end, uint64_t count,
 	}
 
 	latency_info->total += (start + end) / 2 * count;
+	latency_info->count += count;
 
 	if (so_far == count) {
 		latency_info->min = start;
@@ -446,7 +531,16 @@ free_job_config(void)
 static void
 bdevperf_job_free(struct bdevperf_job *job)
 {
+	uint32_t i;
+
+	for (i = 0; i < SPDK_COUNTOF(job->open_loop_histogram); i++) {
+		spdk_histogram_data_free(job->open_loop_histogram[i]);
+	}
+	for (i = 0; i < SPDK_COUNTOF(job->replay_histogram); i++) {
+		spdk_histogram_data_free(job->replay_histogram[i]);
+	}
 	spdk_histogram_data_free(job->histogram);
+	spdk_histogram_data_free(job->stats_histogram);
 	spdk_bit_array_free(&job->outstanding);
 	spdk_zipf_free(&job->zipf);
 	free(job->name);
@@ -498,6 +592,197 @@ print_bucket(void *ctx, uint64_t start, uint64_t end, uint64_t count,
 	       so_far_pct, count);
 }
 
+struct open_loop_percentiles {
+	const double	*cutoff;
+	uint64_t	values[SPDK_COUNTOF(g_open_loop_cutoffs) - 1];
+	uint32_t	num_values;
+};
+
+static void
+get_open_loop_percentiles(void *ctx, uint64_t start, uint64_t end, uint64_t count,
+			  uint64_t total, uint64_t so_far)
+{
+	struct open_loop_percentiles *percentiles = ctx;
+	double so_far_pct;
+
+	if (count == 0) {
+		return;
+	}
+
+	so_far_pct = (double)so_far / total;
+	while (so_far_pct >= *percentiles->cutoff && *percentiles->cutoff > 0) {
+		percentiles->values[percentiles->num_values++] = end;
+		percentiles->cutoff++;
+	}
+}
+
+static uint64_t
+bdevperf_job_get_step_rate(struct bdevperf_job *job, uint32_t step)
+{
+	return job->rate * (step + 1) / job->num_ramp_steps;
+}
+
+/* Prints the line describing a step of the job and returns its p99 latency in usec */
+static double
+open_loop_dump_step(struct bdevperf_job *job, uint32_t step, uint64_t time_in_usec,
+		    double *achieved_rate)
+{
+	struct open_loop_percentiles percentiles = { .cutoff = g_open_loop_cutoffs };
+	struct spdk_histogram_data *histogram = job->open_loop_histogram[step];
+	uint64_t tsc_rate = spdk_get_ticks_hz();
+	uint32_t i;
+
+	spdk_histogram_data_iterate(histogram, get_open_loop_percentiles, &percentiles);
+	for (i = 0; i < percentiles.num_values; i++) {
+		/* The end of a bucket may overshoot the largest latency seen */
+		percentiles.values[i] = spdk_min(percentiles.values[i], job->open_loop_max[step]);
+	}
+
+	*achieved_rate = 0;
+	if (time_in_usec != 0) {
+		*achieved_rate = (double)job->open_loop_completed[step] * SPDK_SEC_TO_USEC / time_in_usec;
+	}
+
+	printf("\t %-20s: %10" PRIu64 " %10.2f", job->name, bdevperf_job_get_step_rate(job, step),
+	       *achieved_rate);
+	for (i = 0; i < SPDK_COUNTOF(percentiles.values); i++) {
+		printf(" %10.2f", i < percentiles.num_values ?
+		       (double)percentiles.values[i] * SPDK_SEC_TO_USEC / tsc_rate : 0.0);
+	}
+	printf(" %10.2f\n", (double)job->open_loop_max[step] * SPDK_SEC_TO_USEC / tsc_rate);
+
+	/* p99 is the second cutoff */
+	return percentiles.num_values > 1 ?
+	       (double)percentiles.values[1] * SPDK_SEC_TO_USEC / tsc_rate : 0.0;
+}
+
+static void
+open_loop_dump_job(struct bdevperf_job *job)
+{
+	uint64_t step_time_in_usec;
+	double p99, first_p99 = 0.0, achieved_rate;
+	uint32_t step;
+	bool knee = false;
+
+	if (job->num_ramp_steps == 1) {
+		open_loop_dump_step(job, 0, job->run_time_in_usec, &achieved_rate);
+		return;
+	}
+
+	printf("\r Job: %s ramp\n", spdk_thread_get_name(job->thread));
+	step_time_in_usec = g_time_in_usec / job->num_ramp_steps;
+	for (step = 0; step < job->num_ramp_steps; step++) {
+		p99 = open_loop_dump_step(job, step, step_time_in_usec, &achieved_rate);
+		if (step == 0) {
+			first_p99 = p99;
+		}
+
+		if (knee) {
+			continue;
+		}
+
+		if (achieved_rate * 100 < (double)bdevperf_job_get_step_rate(job, step) *
+		    BDEVPERF_RAMP_KNEE_RATE_PCT || p99 > first_p99 * BDEVPERF_RAMP_KNEE_FACTOR) {
+			knee = true;
+			if (step == 0) {
+				printf("\t Latency knee below %" PRIu64 " IOPS\n",
+				       bdevperf_job_get_step_rate(job, step));
+			} else {
+				printf("\t Latency knee at about %" PRIu64 " IOPS\n",
+				       bdevperf_job_get_step_rate(job, step - 1));
+			}
+		}
+	}
+
+	if (!knee) {
+		printf("\t No latency knee found up to %" PRIu64 " IOPS\n", job->rate);
+	}
+}
+
+static void
+open_loop_dump(void)
+{
+	struct bdevperf_job *job;
+	bool open_loop = false;
+
+	TAILQ_FOREACH(job, &g_bdevperf.jobs, link) {
+		open_loop |= job->rate != 0;
+	}
+
+	if (!open_loop) {
+		return;
+	}
+
+	printf("\n Open-loop latency, measured from the time each I/O was due (us)\n");
+	printf("\r %-*s: %10s %10s %10s %10s %10s %10s %10s\n", 28, "Device Information",
+	       "Target", "IOPS", "p50", "p99", "p99.9", "p99.99", "max");
+	TAILQ_FOREACH(job, &g_bdevperf.jobs, link) {
+		if (job->rate != 0) {
+			open_loop_dump_job(job);
+		}
+	}
+	fflush(stdout);
+}
+
+static void
+replay_dump_job(struct bdevperf_job *job)
+{
+	struct open_loop_percentiles percentiles;
+	uint64_t tsc_rate = spdk_get_ticks_hz();
+	uint32_t op, i;
+
+	for (op = 0; op < BDEVPERF_REPLAY_NUM_OPS; op++) {
+		if (job->replay_completed[op] == 0) {
+			continue;
+		}
+
+		percentiles = (struct open_loop_percentiles) { .cutoff = g_open_loop_cutoffs };
+		spdk_histogram_data_iterate(job->replay_histogram[op], get_open_loop_percentiles,
+					    &percentiles);
+
+		printf("\t %-20s: %6s %10" PRIu64 " %10.2f", job->name, g_replay_ops[op].name,
+		       job->replay_completed[op],
+		       (double)job->replay_total[op] / job->replay_completed[op] * SPDK_SEC_TO_USEC / tsc_rate);
+		for (i = 0; i < SPDK_COUNTOF(percentiles.values); i++) {
+			/* The end of a bucket may overshoot the largest latency seen */
+			printf(" %10.2f", i < percentiles.num_values ?
+			       (double)spdk_min(percentiles.values[i], job->replay_max[op]) *
+			       SPDK_SEC_TO_USEC / tsc_rate : 0.0);
+		}
+		printf(" %10.2f\n", (double)job->replay_max[op] * SPDK_SEC_TO_USEC / tsc_rate);
+	}
+
+	if (job->replay_skipped != 0) {
+		printf("\t %-20s: skipped %" PRIu64 " I/O not supported by the bdev\n", job->name,
+		       job->replay_skipped);
+	}
+}
+
+static void
+replay_dump(void)
+{
+	struct bdevperf_job *job;
+	bool replay = false;
+
+	TAILQ_FOREACH(job, &g_bdevperf.jobs, link) {
+		replay |= job->replay;
+	}
+
+	if (!replay) {
+		return;
+	}
+
+	printf("\n Replay latency per I/O type, measured from the time each I/O was due (us)\n");
+	printf("\r %-*s: %6s %10s %10s %10s %10s %10s %10s %10s\n", 28, "Device Information",
+	       "Type", "Count", "Average", "p50", "p99", "p99.9", "p99.99", "max");
+	TAILQ_FOREACH(job, &g_bdevperf.jobs, link) {
+		if (job->replay) {
+			replay_dump_job(job);
+		}
+	}
+	fflush(stdout);
+}
+
 static void
 bdevperf_test_done(void *ctx)
 {
@@ -507,6 +792,12 @@ bdevperf_test_done(void *ctx)
 	uint64_t time_in_usec;
 	int rc;
 
+	if (g_job_stats_in_progress > 0) {
+		/* The last RPC walking the jobs calls us again once it's done with them */
+		g_test_done_pending = true;
+		return;
+	}
+
 	if (g_time_in_usec) {
 		g_stats.io_time_in_usec = g_time_in_usec;
 
@@ -551,6 +842,9 @@ bdevperf_test_done(void *ctx)
 
 	fflush(stdout);
 
+	open_loop_dump();
+	replay_dump();
+
 	if (g_latency_display_level == 0 || g_stats.total_io_completed == 0) {
 		goto clean;
 	}
@@ -674,6 +968,7 @@ bdevperf_job_drain(void *ctx)
 	struct bdevperf_job *job = ctx;
 
 	spdk_poller_unregister(&job->run_timer);
+	spdk_poller_unregister(&job->submit_poller);
 	if (job->reset) {
 		spdk_poller_unregister(&job->reset_timer);
 	}
@@ -741,14 +1036,14 @@ bdevperf_verify_dif(struct bdevperf_task *task, struct iovec *iovs, int iovcnt)
 	}
 
 	if (spdk_bdev_is_md_interleaved(bdev)) {
-		rc = spdk_dif_verify(iovs, iovcnt, job->io_size_blocks, &dif_ctx, &err_blk);
+		rc = spdk_dif_verify(iovs, iovcnt, task->num_blocks, &dif_ctx, &err_blk);
 	} else {
 		struct iovec md_iov = {
 			.iov_base	= task->md_buf,
-			.iov_len	= spdk_bdev_get_md_size(bdev) * job->io_size_blocks,
+			.iov_len	= spdk_bdev_get_md_size(bdev) * task->num_blocks,
 		};
 
-		rc = spdk_dix_verify(iovs, iovcnt, &md_iov, job->io_size_blocks, &dif_ctx, &err_blk);
+		rc = spdk_dix_verify(iovs, iovcnt, &md_iov, task->num_blocks, &dif_ctx, &err_blk);
 	}
 
 	if (rc != 0) {
@@ -759,6 +1054,27 @@ bdevperf_verify_dif(struct bdevperf_task *task, struct iovec *iovs, int iovcnt)
 	return rc;
 }
 
+static void
+bdevperf_open_loop_complete(struct bdevperf_job *job, struct bdevperf_task *task)
+{
+	uint64_t latency = spdk_get_ticks() - task->due_tsc;
+
+	spdk_histogram_data_tally(job->open_loop_histogram[task->ramp_step], latency);
+	job->open_loop_max[task->ramp_step] = spdk_max(job->open_loop_max[task->ramp_step], latency);
+	job->open_loop_completed[task->ramp_step]++;
+}
+
+static void
+bdevperf_replay_complete(struct bdevperf_job *job, struct bdevperf_task *task)
+{
+	uint64_t latency = spdk_get_ticks() - task->due_tsc;
+
+	spdk_histogram_data_tally(job->replay_histogram[task->replay_op], latency);
+	job->replay_max[task->replay_op] = spdk_max(job->replay_max[task->replay_op], latency);
+	job->replay_total[task->replay_op] += latency;
+	job->replay_completed[task->replay_op]++;
+}
+
 static void
 bdevperf_complete(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
 {
@@ -791,7 +1107,7 @@ bdevperf_complete(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
 				 spdk_bdev_get_block_size(job->bdev),
 				 task->md_buf, spdk_bdev_io_get_md_buf(bdev_io),
 				 spdk_bdev_get_md_size(job->bdev),
-				 job->io_size_blocks, md_check)) {
+				 task->num_blocks, md_check)) {
 			printf("Buffer mismatch! Target: %s Disk Offset: %" PRIu64 "\n", job->name, task->offset_blocks);
 			printf("   First dword expected 0x%x got 0x%x\n", *(int *)task->buf, *(int *)iovs[0].iov_base);
 			bdevperf_job_drain(job);
@@ -825,6 +1141,18 @@ bdevperf_complete(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
 		job->io_failed++;
 	}
 
+	/* I/Os submitted before the latencies were collected have no submission time */
+	if (job->stats_latency && task->submit_tsc != 0) {
+		spdk_histogram_data_tally(job->stats_histogram,
+					  spdk_get_ticks() - task->submit_tsc);
+	}
+
+	if (job->rate != 0) {
+		bdevperf_open_loop_complete(job, task);
+	} else if (job->replay) {
+		bdevperf_replay_complete(job, task);
+	}
+
 	if (job->verify) {
 		assert(task->offset_blocks / job->io_size_blocks >= job->ios_base);
 		offset_in_ios = task->offset_blocks / job->io_size_blocks - job->ios_base;
@@ -839,9 +1167,10 @@ bdevperf_complete(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
 	 * is_draining indicates when time has expired for the test run
 	 * and we are just waiting for the previously submitted I/O
 	 * to complete.  In this case, do not submit a new I/O to replace
-	 * the one just completed.
+	 * the one just completed.  In open-loop and replay modes, new I/O is
+	 * submitted by the submit poller instead.
 	 */
-	if (!job->is_draining) {
+	if (!job->is_draining && job->rate == 0 && !job->replay) {
 		bdevperf_submit_single(job, task);
 	} else {
 		bdevperf_end_task(task);
@@ -859,7 +1188,7 @@ bdevperf_verify_submit_read(void *cb_arg)
 
 	/* Read the data back in */
 	rc = spdk_bdev_read_blocks_with_md(job->bdev_desc, job->ch, NULL, NULL,
-					   task->offset_blocks, job->io_size_blocks,
+					   task->offset_blocks, task->num_blocks,
 					   bdevperf_complete, task);
 
 	if (rc == -ENOMEM) {
@@ -916,14 +1245,14 @@ bdevperf_generate_dif(struct bdevperf_task *task)
 	}
 
 	if (spdk_bdev_is_md_interleaved(bdev)) {
-		rc = spdk_dif_generate(&task->iov, 1, job->io_size_blocks, &dif_ctx);
+		rc = spdk_dif_generate(&task->iov, 1, task->num_blocks, &dif_ctx);
 	} else {
 		struct iovec md_iov = {
 			.iov_base	= task->md_buf,
-			.iov_len	= spdk_bdev_get_md_size(bdev) * job->io_size_blocks,
+			.iov_len	= spdk_bdev_get_md_size(bdev) * task->num_blocks,
 		};
 
-		rc = spdk_dix_generate(&task->iov, 1, &md_iov, job->io_size_blocks, &dif_ctx);
+		rc = spdk_dix_generate(&task->iov, 1, &md_iov, task->num_blocks, &dif_ctx);
 	}
 
 	if (rc != 0) {
@@ -946,6 +1275,9 @@ bdevperf_submit_task(void *arg)
 
 	desc = job->bdev_desc;
 	ch = job->ch;
+	if (job->stats_latency) {
+		task->submit_tsc = spdk_get_ticks();
+	}
 
 	switch (task->io_type) {
 	case SPDK_BDEV_IO_TYPE_WRITE:
@@ -962,31 +1294,31 @@ bdevperf_submit_task(void *arg)
 				rc = spdk_bdev_writev_blocks_with_md(desc, ch, &task->iov, 1,
 								     task->md_buf,
 								     task->offset_blocks,
-								     job->io_size_blocks,
+								     task->num_blocks,
 								     cb_fn, task);
 			}
 		}
 		break;
 	case SPDK_BDEV_IO_TYPE_FLUSH:
 		rc = spdk_bdev_flush_blocks(desc, ch, task->offset_blocks,
-					    job->io_size_blocks, bdevperf_complete, task);
+					    task->num_blocks, bdevperf_complete, task);
 		break;
 	case SPDK_BDEV_IO_TYPE_UNMAP:
 		rc = spdk_bdev_unmap_blocks(desc, ch, task->offset_blocks,
-					    job->io_size_blocks, bdevperf_complete, task);
+					    task->num_blocks, bdevperf_complete, task);
 		break;
 	case SPDK_BDEV_IO_TYPE_WRITE_ZEROES:
 		rc = spdk_bdev_write_zeroes_blocks(desc, ch, task->offset_blocks,
-						   job->io_size_blocks, bdevperf_complete, task);
+						   task->num_blocks, bdevperf_complete, task);
 		break;
 	case SPDK_BDEV_IO_TYPE_READ:
 		if (g_zcopy) {
-			rc = spdk_bdev_zcopy_start(desc, ch, NULL, 0, task->offset_blocks, job->io_size_blocks,
+			rc = spdk_bdev_zcopy_start(desc, ch, NULL, 0, task->offset_blocks, task->num_blocks,
 						   true, bdevperf_zcopy_populate_complete, task);
 		} else {
 			rc = spdk_bdev_read_blocks_with_md(desc, ch, task->buf, task->md_buf,
 							   task->offset_blocks,
-							   job->io_size_blocks,
+							   task->num_blocks,
 							   bdevperf_complete, task);
 		}
 		break;
@@ -1050,7 +1382,7 @@ bdevperf_zcopy_get_buf_complete(struct spdk_bdev_io *bdev_io, bool success, void
 		copy_data(iovs[0].iov_base, iovs[0].iov_len, task->buf, job->buf_size,
 			  spdk_bdev_get_block_size(job->bdev),
 			  spdk_bdev_io_get_md_buf(bdev_io), task->md_buf,
-			  spdk_bdev_get_md_size(job->bdev), job->io_size_blocks);
+			  spdk_bdev_get_md_size(job->bdev), task->num_blocks);
 	}
 
 	bdevperf_submit_task(task);
@@ -1064,7 +1396,7 @@ bdevperf_prep_zcopy_write_task(void *arg)
 	int			rc;
 
 	rc = spdk_bdev_zcopy_start(job->bdev_desc, job->ch, NULL, 0,
-				   task->offset_blocks, job->io_size_blocks,
+				   task->offset_blocks, task->num_blocks,
 				   false, bdevperf_zcopy_get_buf_complete, task);
 	if (rc != 0) {
 		assert(rc == -ENOMEM);
@@ -1127,6 +1459,7 @@ bdevperf_submit_single(struct bdevperf_job *job, struct bdevperf_task *task)
 	 * is absolute (entire bdev LBA range).
 	 */
 	task->offset_blocks = (offset_in_ios + job->ios_base) * job->io_size_blocks;
+	task->num_blocks = job->io_size_blocks;
 
 	if (job->verify || job->reset) {
 		generate_data(task->buf, job->buf_size,
@@ -1231,6 +1564,144 @@ bdevperf_timeout_cb(void *cb_arg, struct spdk_bdev_io *bdev_io)
 	bdevperf_submit_task(task);
 }
 
+/* Returns the ramp step that an I/O due at the given tsc belongs to */
+static uint32_t
+bdevperf_job_get_ramp_step(struct bdevperf_job *job, uint64_t tsc)
+{
+	if (job->num_ramp_steps == 1 || tsc <= job->start_tsc) {
+		return 0;
+	}
+
+	return spdk_min((tsc - job->start_tsc) / job->ramp_step_tsc, job->num_ramp_steps - 1);
+}
+
+static uint64_t
+bdevperf_job_get_interarrival(struct bdevperf_job *job, uint32_t step)
+{
+	double interval, u;
+
+	interval = (double)spdk_get_ticks_hz() / bdevperf_job_get_step_rate(job, step);
+	if (!g_poisson_arrivals) {
+		return interval;
+	}
+
+	/* Exponentially distributed inter-arrival times make for Poisson arrivals */
+	u = ((double)rand_r(&job->seed) + 1) / ((double)RAND_MAX + 2);
+
+	return -log(u) * interval;
+}
+
+static int
+bdevperf_job_open_loop_submit(void *ctx)
+{
+	struct bdevperf_job *job = ctx;
+	struct bdevperf_task *task;
+	uint64_t now = spdk_get_ticks();
+	uint32_t step;
+	int count = 0;
+
+	while (now >= job->next_submit_tsc) {
+		/* Once queue_depth I/Os are outstanding, the due I/Os are delayed until some
+		 * complete.  Their latency is still measured from the time they were due, so the
+		 * queueing delay isn't omitted. */
+		task = TAILQ_FIRST(&job->task_list);
+		if (task == NULL) {
+			break;
+		}
+
+		TAILQ_REMOVE(&job->task_list, task, link);
+		/* An I/O delayed past a step boundary still belongs to the step it was due in */
+		step = bdevperf_job_get_ramp_step(job, job->next_submit_tsc);
+		task->due_tsc = job->next_submit_tsc;
+		task->ramp_step = step;
+		job->next_submit_tsc += bdevperf_job_get_interarrival(job, step);
+
+		bdevperf_submit_single(job, task);
+		count++;
+	}
+
+	return count > 0 ? SPDK_POLLER_BUSY : SPDK_POLLER_IDLE;
+}
+
+static void
+bdevperf_replay_submit_record(struct bdevperf_job *job, struct bdevperf_task *task,
+			      const struct bdevperf_replay_record *record)
+{
+	uint64_t num_blocks = spdk_bdev_get_num_blocks(job->bdev);
+	uint32_t data_block_size = spdk_bdev_get_data_block_size(job->bdev);
+
+	task->replay_op = record->op;
+	task->io_type = g_replay_ops[record->op].io_type;
+	if (!spdk_bdev_io_type_supported(job->bdev, task->io_type)) {
+		job->replay_skipped++;
+		TAILQ_INSERT_TAIL(&job->task_list, task, link);
+		return;
+	}
+
+	if (record->length == 0) {
+		task->offset_blocks = 0;
+		task->num_blocks = num_blocks;
+	} else {
+		task->num_blocks = spdk_min(spdk_divide_round_up(record->length, data_block_size),
+					    num_blocks);
+		/* The trace may have been recorded on a larger device, wrap such offsets around */
+		task->offset_blocks = record->offset / data_block_size % (num_blocks - task->num_blocks + 1);
+	}
+
+	if (task->io_type == SPDK_BDEV_IO_TYPE_WRITE) {
+		assert(task->num_blocks <= job->io_size_blocks);
+		task->iov.iov_base = task->buf;
+		task->iov.iov_len = task->num_blocks * spdk_bdev_get_block_size(job->bdev);
+	}
+
+	bdevperf_submit_task(task);
+}
+
+static int
+bdevperf_job_replay_submit(void *ctx)
+{
+	struct bdevperf_job *job = ctx;
+	const struct bdevperf_replay_record *record;
+	struct bdevperf_task *task;
+	uint64_t now = spdk_get_ticks();
+	uint64_t due_tsc;
+	int count = 0;
+
+	while (job->replay_next < g_replay.num_records) {
+		record = &g_replay.records[job->replay_next];
+		if (g_replay_speed > 0) {
+			due_tsc = job->start_tsc + (uint64_t)(record->time_in_usec * g_replay_tsc_per_usec);
+			if (due_tsc > now) {
+				break;
+			}
+		} else {
+			/* Replaying as fast as possible, so there's no time the I/O was due at */
+			due_tsc = now;
+		}
+
+		/* Just like in open-loop mode, the latency of the I/O delayed by queue_depth
+		 * is measured from the time it was due. */
+		task = TAILQ_FIRST(&job->task_list);
+		if (task == NULL) {
+			break;
+		}
+
+		TAILQ_REMOVE(&job->task_list, task, link);
+		task->due_tsc = due_tsc;
+		job->replay_next += job->replay_stride;
+
+		bdevperf_replay_submit_record(job, task, record);
+		count++;
+	}
+
+	if (job->replay_next >= g_replay.num_records) {
+		/* The whole trace was submitted, end the job once the I/O completes */
+		bdevperf_job_drain_timer(job);
+	}
+
+	return count > 0 ? SPDK_POLLER_BUSY : SPDK_POLLER_IDLE;
+}
+
 static void
 bdevperf_job_run(void *ctx)
 {
@@ -1250,6 +1721,25 @@ bdevperf_job_run(void *ctx)
 
 	spdk_bdev_set_timeout(job->bdev_desc, g_timeout_in_sec, bdevperf_timeout_cb, job);
 
+	job->stats_prev_tsc = spdk_get_ticks();
+	if (job->rate != 0 || job->replay) {
+		job->stats_latency = true;
+	}
+
+	if (job->rate != 0) {
+		job->start_tsc = job->next_submit_tsc = spdk_get_ticks();
+		job->ramp_step_tsc = spdk_max(g_time_in_usec / job->num_ramp_steps *
+					      (spdk_get_ticks_hz() / SPDK_SEC_TO_USEC), 1);
+		job->submit_poller = SPDK_POLLER_REGISTER(bdevperf_job_open_loop_submit, job, 0);
+		return;
+	}
+
+	if (job->replay) {
+		job->start_tsc = spdk_get_ticks();
+		job->submit_poller = SPDK_POLLER_REGISTER(bdevperf_job_replay_submit, job, 0);
+		return;
+	}
+
 	for (i = 0; i < job->queue_depth; i++) {
 		task = bdevperf_job_get_task(job);
 		bdevperf_submit_single(job, task);
@@ -1335,6 +1825,25 @@ performance_statistics_thread(void *arg)
 	return -1;
 }
 
+/* The records of the trace are dealt round-robin among the replay jobs of the same bdev */
+static void
+bdevperf_job_replay_partition(struct bdevperf_job *job)
+{
+	struct bdevperf_job *other;
+
+	job->replay_stride = 0;
+	TAILQ_FOREACH(other, &g_bdevperf.jobs, link) {
+		if (!other->replay || other->bdev != job->bdev) {
+			continue;
+		}
+
+		if (other == job) {
+			job->replay_next = job->replay_stride;
+		}
+		job->replay_stride++;
+	}
+}
+
 static void
 bdevperf_test(void)
 {
@@ -1354,8 +1863,15 @@ bdevperf_test(void)
 						    g_show_performance_period_in_usec);
 	}
 
+	if (g_replay_speed > 0) {
+		g_replay_tsc_per_usec = (double)spdk_get_ticks_hz() / SPDK_SEC_TO_USEC / g_replay_speed;
+	}
+
 	/* Iterate jobs to start all I/O */
 	TAILQ_FOREACH(job, &g_bdevperf.jobs, link) {
+		if (job->replay) {
+			bdevperf_job_replay_partition(job);
+		}
 		g_bdevperf.running_jobs++;
 		spdk_thread_send_msg(job->thread, bdevperf_job_run, job);
 	}
@@ -1570,6 +2086,9 @@ job_init_rw(struct bdevperf_job *job, enum job_config_rw rw)
 	case JOB_CONFIG_RW_WRITE_ZEROES:
 		job->write_zeroes = true;
 		break;
+	case JOB_CONFIG_RW_REPLAY:
+		job->replay = true;
+		break;
 	}
 }
 
@@ -1608,9 +2127,45 @@ bdevperf_construct_job(struct spdk_bdev *bdev, struct job_config *config,
 	job->io_size_blocks = job->io_size / data_block_size;
 	job->buf_size = job->io_size_blocks * block_size;
 	job->abort = g_abort;
+	job->rate = config->rate;
+	job->num_ramp_steps = g_ramp_steps > 0 ? g_ramp_steps : 1;
 	job_init_rw(job, config->rw);
 
-	if ((job->io_size % data_block_size) != 0) {
+	if (job->rate != 0 && (job->verify || job->abort)) {
+		fprintf(stderr, "Open-loop mode is not supported with verify, reset or abort (job %s)\n",
+			job->name);
+		bdevperf_job_free(job);
+		return -ENOTSUP;
+	}
+
+	if (job->rate != 0 && job->rate < job->num_ramp_steps) {
+		fprintf(stderr, "Open-loop rate of job %s must be at least the number of ramp steps\n",
+			job->name);
+		bdevperf_job_free(job);
+		return -EINVAL;
+	}
+
+	if (job->replay) {
+		if (g_replay.num_records == 0) {
+			fprintf(stderr, "Replay job %s requires a trace file (-b)\n", job->name);
+			bdevperf_job_free(job);
+			return -EINVAL;
+		}
+
+		if (job->rate != 0 || job->abort || g_zcopy) {
+			fprintf(stderr, "Replay is not supported with open-loop mode, abort or zcopy (job %s)\n",
+				job->name);
+			bdevperf_job_free(job);
+			return -ENOTSUP;
+		}
+
+		/* The data buffers have to fit the largest read or write of the trace, while the
+		 * throughput is accounted using the average I/O size. */
+		job->io_size_blocks = spdk_divide_round_up(g_replay.max_length, data_block_size);
+		job->io_size_blocks = spdk_max(spdk_min(job->io_size_blocks, spdk_bdev_get_num_blocks(bdev)), 1);
+		job->buf_size = job->io_size_blocks * block_size;
+		job->io_size = g_replay.total_length / g_replay.num_records;
+	} else if ((job->io_size % data_block_size) != 0) {
 		SPDK_ERRLOG("IO size (%d) is not multiples of data block size of bdev %s (%"PRIu32")\n",
 			    job->io_size, spdk_bdev_get_name(bdev), data_block_size);
 		bdevperf_job_free(job);
@@ -1664,12 +2219,38 @@ bdevperf_construct_job(struct spdk_bdev *bdev, struct job_config *config,
 	}
 
 	job->histogram = spdk_histogram_data_alloc();
-	if (job->histogram == NULL) {
+	job->stats_histogram = spdk_histogram_data_alloc();
+	if (job->histogram == NULL || job->stats_histogram == NULL) {
 		fprintf(stderr, "Failed to allocate histogram\n");
 		bdevperf_job_free(job);
 		return -ENOMEM;
 	}
 
+	if (job->rate != 0) {
+		job->seed = rand();
+		for (n = 0; n < (int)job->num_ramp_steps; n++) {
+			job->open_loop_histogram[n] = spdk_histogram_data_alloc_sized(
+							      BDEVPERF_OPEN_LOOP_BUCKET_SHIFT);
+			if (job->open_loop_histogram[n] == NULL) {
+				fprintf(stderr, "Failed to allocate histogram\n");
+				bdevperf_job_free(job);
+				return -ENOMEM;
+			}
+		}
+	}
+
+	if (job->replay) {
+		for (n = 0; n < BDEVPERF_REPLAY_NUM_OPS; n++) {
+			job->replay_histogram[n] = spdk_histogram_data_alloc_sized(
+							   BDEVPERF_OPEN_LOOP_BUCKET_SHIFT);
+			if (job->replay_histogram[n] == NULL) {
+				fprintf(stderr, "Failed to allocate histogram\n");
+				bdevperf_job_free(job);
+				return -ENOMEM;
+			}
+		}
+	}
+
 	TAILQ_INIT(&job->task_list);
 
 	task_num = job->queue_depth;
@@ -1752,9 +2333,11 @@ parse_rw(const char *str, enum job_config_rw ret)
 		ret = JOB_CONFIG_RW_RW;
 	} else if (!strcmp(str, "randrw")) {
 		ret = JOB_CONFIG_RW_RANDRW;
+	} else if (!strcmp(str, "replay")) {
+		ret = JOB_CONFIG_RW_REPLAY;
 	} else {
 		fprintf(stderr, "rw must be one of\n"
-			"(read, write, randread, randwrite, rw, randrw, verify, reset, unmap, flush)\n");
+			"(read, write, randread, randwrite, rw, randrw, verify, reset, unmap, flush, replay)\n");
 		ret = BDEVPERF_CONFIG_ERROR;
 	}
 
@@ -1846,6 +2429,7 @@ make_cli_job_config(const char *filename, int64_t offset, uint64_t range)
 	config->bs = g_io_size;
 	config->iodepth = g_queue_depth;
 	config->rwmixread = g_rw_percentage;
+	config->rate = g_open_loop_rate;
 	config->offset = offset;
 	config->length = range;
 	config->rw = parse_rw(g_workload_type, BDEVPERF_CONFIG_ERROR);
@@ -1976,6 +2560,28 @@ end:
 	_bdevperf_construct_job_done(NULL);
 }
 
+static int
+parse_uint64_option(struct spdk_conf_section *s, const char *name, uint64_t def, uint64_t *val)
+{
+	const char *str;
+	long long tmp;
+
+	str = spdk_conf_section_get_val(s, name);
+	if (str == NULL) {
+		*val = def;
+		return 0;
+	}
+
+	tmp = spdk_strtoll(str, 10);
+	if (tmp < 0) {
+		fprintf(stderr, "Job '%s' has bad '%s' value\n", spdk_conf_section_get_name(s), name);
+		return BDEVPERF_CONFIG_ERROR;
+	}
+
+	*val = tmp;
+	return 0;
+}
+
 static int
 parse_uint_option(struct spdk_conf_section *s, const char *name, int def)
 {
@@ -2027,6 +2633,9 @@ config_set_cli_args(struct job_config *config)
 	if (g_rw_percentage > 0) {
 		config->rwmixread = g_rw_percentage;
 	}
+	if (g_open_loop_rate > 0) {
+		config->rate = g_open_loop_rate;
+	}
 	if (g_workload_type) {
 		config->rw = parse_rw(g_workload_type, config->rw);
 	}
@@ -2071,6 +2680,8 @@ read_job_config(void)
 	global_default_config.iodepth = BDEVPERF_CONFIG_UNDEFINED;
 	/* bdevperf has no default for -M option but in FIO the default is 50 */
 	global_default_config.rwmixread = 50;
+	/* rate 0 means closed-loop */
+	global_default_config.rate = 0;
 	global_default_config.offset = 0;
 	/* length 0 means 100% */
 	global_default_config.length = 0;
@@ -2154,6 +2765,10 @@ read_job_config(void)
 			goto error;
 		}
 
+		if (parse_uint64_option(s, "rate", global_config.rate, &config->rate) != 0) {
+			goto error;
+		}
+
 		config->offset = parse_uint_option(s, "offset", global_config.offset);
 		if (config->offset == BDEVPERF_CONFIG_ERROR) {
 			goto error;
@@ -2270,6 +2885,148 @@ rpc_perform_tests(struct spdk_jsonrpc_request *request, const struct spdk_json_v
 }
 SPDK_RPC_REGISTER("perform_tests", rpc_perform_tests, SPDK_RPC_RUNTIME)
 
+struct rpc_get_job_stats_ctx {
+	struct spdk_jsonrpc_request	*request;
+	struct spdk_json_write_ctx	*w;
+	struct bdevperf_job		*current_job;
+};
+
+static void
+rpc_get_job_stats_done(void *ctx)
+{
+	struct rpc_get_job_stats_ctx *stats_ctx = ctx;
+
+	spdk_json_write_array_end(stats_ctx->w);
+	spdk_json_write_object_end(stats_ctx->w);
+	spdk_jsonrpc_end_result(stats_ctx->request, stats_ctx->w);
+
+	free(stats_ctx);
+
+	if (--g_job_stats_in_progress == 0 && g_test_done_pending) {
+		g_test_done_pending = false;
+		bdevperf_test_done(NULL);
+	}
+}
+
+static void
+rpc_get_job_stats_write_job(struct spdk_json_write_ctx *w, struct bdevperf_job *job)
+{
+	struct open_loop_percentiles percentiles = { .cutoff = g_open_loop_cutoffs };
+	struct latency_info latency_info = {};
+	uint64_t now = spdk_get_ticks(), tsc_rate = spdk_get_ticks_hz();
+	uint64_t interval_tsc, completed, failed, timeout;
+	double interval_in_sec, io_per_second;
+	static const char *percentile_names[] = { "p50", "p99", "p99.9", "p99.99" };
+	uint32_t i;
+
+	SPDK_STATIC_ASSERT(SPDK_COUNTOF(percentile_names) == SPDK_COUNTOF(percentiles.values),
+			   "Incorrect number of percentile names");
+
+	/* The job hasn't started yet */
+	if (job->stats_prev_tsc == 0) {
+		job->stats_prev_tsc = now;
+	}
+
+	interval_tsc = spdk_max(now - job->stats_prev_tsc, 1);
+	interval_in_sec = (double)interval_tsc / tsc_rate;
+	completed = job->io_completed - job->stats_prev_completed;
+	failed = job->io_failed - job->stats_prev_failed;
+	timeout = job->io_timeout - job->stats_prev_timeout;
+	io_per_second = completed / interval_in_sec;
+
+	spdk_histogram_data_iterate(job->stats_histogram, get_avg_latency, &latency_info);
+	spdk_histogram_data_iterate(job->stats_histogram, get_open_loop_percentiles, &percentiles);
+
+	spdk_json_write_object_begin(w);
+	spdk_json_write_named_string(w, "name", job->name);
+	spdk_json_write_named_string(w, "thread", spdk_thread_get_name(job->thread));
+	spdk_json_write_named_string(w, "core_mask",
+				     spdk_cpuset_fmt(spdk_thread_get_cpumask(job->thread)));
+	spdk_json_write_named_bool(w, "running", job->run_time_in_usec == 0);
+	spdk_json_write_named_int32(w, "queue_depth", job->current_queue_depth);
+	spdk_json_write_named_uint64(w, "io_completed", job->io_completed);
+	spdk_json_write_named_uint64(w, "io_failed", job->io_failed);
+	spdk_json_write_named_uint64(w, "io_timeout", job->io_timeout);
+	spdk_json_write_named_uint64(w, "interval_usec", interval_tsc * SPDK_SEC_TO_USEC / tsc_rate);
+	spdk_json_write_named_double(w, "iops", io_per_second);
+	spdk_json_write_named_double(w, "mibps", io_per_second * job->io_size / (1024 * 1024));
+	spdk_json_write_named_double(w, "failed_per_second", failed / interval_in_sec);
+	spdk_json_write_named_double(w, "timeout_per_second", timeout / interval_in_sec);
+
+	spdk_json_write_named_object_begin(w, "latency_us");
+	spdk_json_write_named_double(w, "average", latency_info.count == 0 ? 0.0 :
+				     (double)latency_info.total / latency_info.count *
+				     SPDK_SEC_TO_USEC / tsc_rate);
+	spdk_json_write_named_double(w, "min", (double)latency_info.min * SPDK_SEC_TO_USEC / tsc_rate);
+	spdk_json_write_named_double(w, "max", (double)latency_info.max * SPDK_SEC_TO_USEC / tsc_rate);
+	for (i = 0; i < percentiles.num_values; i++) {
+		spdk_json_write_named_double(w, percentile_names[i],
+					     (double)percentiles.values[i] * SPDK_SEC_TO_USEC / tsc_rate);
+	}
+	spdk_json_write_object_end(w);
+
+	spdk_json_write_object_end(w);
+
+	/* Start the next interval, with latencies from now on */
+	job->stats_latency = true;
+	spdk_histogram_data_reset(job->stats_histogram);
+	job->stats_prev_tsc = now;
+	job->stats_prev_completed = job->io_completed;
+	job->stats_prev_failed = job->io_failed;
+	job->stats_prev_timeout = job->io_timeout;
+}
+
+static void
+_rpc_get_job_stats(void *ctx)
+{
+	struct rpc_get_job_stats_ctx *stats_ctx = ctx;
+
+	rpc_get_job_stats_write_job(stats_ctx->w, stats_ctx->current_job);
+
+	/* The jobs aren't freed until g_job_stats_in_progress drops to 0 */
+	stats_ctx->current_job = TAILQ_NEXT(stats_ctx->current_job, link);
+	if (stats_ctx->current_job == NULL) {
+		spdk_thread_send_msg(g_main_thread, rpc_get_job_stats_done, stats_ctx);
+	} else {
+		spdk_thread_send_msg(stats_ctx->current_job->thread, _rpc_get_job_stats, stats_ctx);
+	}
+}
+
+static void
+rpc_get_job_stats(struct spdk_jsonrpc_request *request, const struct spdk_json_val *params)
+{
+	struct rpc_get_job_stats_ctx *stats_ctx;
+
+	if (params != NULL) {
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INVALID_PARAMS,
+						 "get_job_stats method requires no parameters");
+		return;
+	}
+
+	stats_ctx = calloc(1, sizeof(*stats_ctx));
+	if (stats_ctx == NULL) {
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 spdk_strerror(ENOMEM));
+		return;
+	}
+
+	stats_ctx->request = request;
+	stats_ctx->w = spdk_jsonrpc_begin_result(request);
+	spdk_json_write_object_begin(stats_ctx->w);
+	spdk_json_write_named_uint64(stats_ctx->w, "tick_rate", spdk_get_ticks_hz());
+	spdk_json_write_named_uint64(stats_ctx->w, "ticks", spdk_get_ticks());
+	spdk_json_write_named_array_begin(stats_ctx->w, "jobs");
+
+	g_job_stats_in_progress++;
+	stats_ctx->current_job = TAILQ_FIRST(&g_bdevperf.jobs);
+	if (stats_ctx->current_job == NULL) {
+		rpc_get_job_stats_done(stats_ctx);
+	} else {
+		spdk_thread_send_msg(stats_ctx->current_job->thread, _rpc_get_job_stats, stats_ctx);
+	}
+}
+SPDK_RPC_REGISTER("get_job_stats", rpc_get_job_stats, SPDK_RPC_RUNTIME)
+
 static void
 _bdevperf_job_drain(void *ctx)
 {
@@ -2325,6 +3082,26 @@ bdevperf_parse_arg(int ch, char *arg)
 		}
 	} else if (ch == 'l') {
 		g_latency_display_level++;
+	} else if (ch == 'E') {
+		g_poisson_arrivals = true;
+	} else if (ch == 'b') {
+		g_replay_file = optarg;
+	} else if (ch == 'x') {
+		char *endptr;
+
+		errno = 0;
+		g_replay_speed = strtod(optarg, &endptr);
+		if (errno || optarg == endptr || g_replay_speed < 0) {
+			fprintf(stderr, "Illegal replay speed %s\n", optarg);
+			return -EINVAL;
+		}
+	} else if (ch == 'O') {
+		tmp = spdk_strtoll(optarg, 10);
+		if (tmp < 0) {
+			fprintf(stderr, "Parse failed for the option %c.\n", ch);
+			return tmp;
+		}
+		g_open_loop_rate = tmp;
 	} else {
 		tmp = spdk_strtoll(optarg, 10);
 		if (tmp < 0) {
@@ -2359,6 +3136,9 @@ bdevperf_parse_arg(int ch, char *arg)
 			g_show_performance_real_time = 1;
 			g_show_performance_period_in_usec = tmp * SPDK_SEC_TO_USEC;
 			break;
+		case 'G':
+			g_ramp_steps = tmp;
+			break;
 		default:
 			return -EINVAL;
 		}
@@ -2371,7 +3151,7 @@ bdevperf_usage(void)
 {
 	printf(" -q <depth>                io depth\n");
 	printf(" -o <size>                 io size in bytes\n");
-	printf(" -w <type>                 io pattern type, must be one of (read, write, randread, randwrite, rw, randrw, verify, reset, unmap, flush)\n");
+	printf(" -w <type>                 io pattern type, must be one of (read, write, randread, randwrite, rw, randrw, verify, reset, unmap, flush, replay)\n");
 	printf(" -t <time>                 time in seconds\n");
 	printf(" -k <timeout>              timeout in seconds to detect starved I/O (default is 0 and disabled)\n");
 	printf(" -M <percent>              rwmixread (100 for reads, 0 for writes)\n");
@@ -2389,6 +3169,15 @@ bdevperf_usage(void)
 	printf(" -C                        enable every core to send I/Os to each bdev\n");
 	printf(" -j <filename>             use job config file\n");
 	printf(" -l                        display latency histogram, default: disable. -l display summary, -ll display details\n");
+	printf(" -O <rate>                 open-loop mode, submit I/O at <rate> IOPS per job instead of keeping\n");
+	printf("\t\t<depth> I/Os outstanding (<depth> still limits the outstanding I/Os)\n");
+	printf(" -E                        use Poisson (exponential) inter-arrival times in open-loop mode\n");
+	printf(" -G <steps>                ramp the open-loop rate up to <rate> in <steps> equal steps\n");
+	printf("\t\tover the run time and report the latency of each step (max %d)\n",
+	       BDEVPERF_RAMP_MAX_STEPS);
+	printf(" -b <filename>             block trace (fio iolog or \"<usec> <op> <offset> <length>\" lines) to replay\n");
+	printf("\t\tby the replay jobs, its records are spread among the jobs of the same bdev\n");
+	printf(" -x <speed>                replay speed, 2 replays the trace twice as fast (default 1, 0 ignores the timestamps)\n");
 }
 
 static int
@@ -2404,7 +3193,9 @@ verify_test_params(struct spdk_app_opts *opts)
 	if (!g_bdevperf_conf_file && g_queue_depth <= 0) {
 		goto out;
 	}
-	if (!g_bdevperf_conf_file && g_io_size <= 0) {
+	/* Replay takes the I/O sizes from the trace */
+	if (!g_bdevperf_conf_file && g_io_size <= 0 &&
+	    (g_workload_type == NULL || strcmp(g_workload_type, "replay"))) {
 		goto out;
 	}
 	if (!g_bdevperf_conf_file && !g_workload_type) {
@@ -2429,6 +3220,22 @@ verify_test_params(struct spdk_app_opts *opts)
 		return 1;
 	}
 
+	if (g_ramp_steps > BDEVPERF_RAMP_MAX_STEPS) {
+		fprintf(stderr, "-G option must not exceed %d\n", BDEVPERF_RAMP_MAX_STEPS);
+		return 1;
+	}
+
+	if (!g_bdevperf_conf_file && g_open_loop_rate == 0 && (g_poisson_arrivals || g_ramp_steps)) {
+		fprintf(stderr, "-E and -G options must be specified with -O option\n");
+		return 1;
+	}
+
+	if (!g_bdevperf_conf_file && g_workload_type && !strcmp(g_workload_type, "replay") &&
+	    g_replay_file == NULL) {
+		fprintf(stderr, "-b option must be specified for replay\n");
+		return 1;
+	}
+
 	if (false && (g_io_size > SPDK_BDEV_LARGE_BUF_MAX_SIZE)) {
 		printf("I/O size of %d is greater than zero copy threshold (%d).\n",
 		       g_io_size, SPDK_BDEV_LARGE_BUF_MAX_SIZE);
@@ -2463,7 +3270,8 @@ verify_test_params(struct spdk_app_opts *opts)
 	    !strcmp(g_workload_type, "reset") ||
 	    !strcmp(g_workload_type, "unmap") ||
 	    !strcmp(g_workload_type, "write_zeroes") ||
-	    !strcmp(g_workload_type, "flush")) {
+	    !strcmp(g_workload_type, "flush") ||
+	    !strcmp(g_workload_type, "replay")) {
 		if (g_mix_specified) {
 			fprintf(stderr, "Ignoring -M option... Please use -M option"
 				" only when using rw or randrw.\n");
@@ -2501,7 +3309,7 @@ main(int argc, char **argv)
 	opts.rpc_addr = NULL;
 	opts.shutdown_cb = spdk_bdevperf_shutdown_cb;
 
-	if ((rc = spdk_app_parse_args(argc, argv, &opts, "Zzfq:o:t:w:k:CF:M:P:S:T:Xlj:", NULL,
+	if ((rc = spdk_app_parse_args(argc, argv, &opts, "Zzfq:o:t:w:k:CF:M:P:S:T:Xlj:O:EG:b:x:", NULL,
 				      bdevperf_parse_arg, bdevperf_usage)) !=
 	    SPDK_APP_PARSE_ARGS_SUCCESS) {
 		return rc;
@@ -2517,9 +3325,15 @@ main(int argc, char **argv)
 		exit(1);
 	}
 
+	if (g_replay_file && bdevperf_replay_load(&g_replay, g_replay_file) != 0) {
+		free_job_config();
+		exit(1);
+	}
+
 	rc = spdk_app_start(&opts, bdevperf_run, NULL);
 
 	spdk_app_fini();
 	free_job_config();
+	free(g_replay.records);
 	return rc;
 }
@@ -6,8 +6,10 @@
 
 import logging
 import argparse
+import json
 import sys
 import shlex
+import time
 
 try:
     from spdk.rpc.client import print_dict, JSONRPCException
@@ -40,6 +42,20 @@ def perform_tests_func(client):
     return client.call('perform_tests', params)
 
 
+def get_job_stats_func(client):
+    """Get the statistics of each bdevperf job since the previous call (or the start of the job).
+
+    Args:
+        none
+
+    Returns:
+        Object with the current tick count and rate and the array of jobs statistics:
+        IOPS, bandwidth, error rates and latency percentiles.
+    """
+    params = {}
+    return client.call('get_job_stats', params)
+
+
 if __name__ == "__main__":
     parser = argparse.ArgumentParser(
         description='SPDK RPC command line interface. NOTE: spdk/python is expected in PYTHONPATH')
@@ -63,6 +79,31 @@ if __name__ == "__main__":
     p = subparsers.add_parser('perform_tests', help='Perform bdevperf tests')
     p.set_defaults(func=perform_tests)
 
+    def get_job_stats(args):
+        if args.interval is None:
+            print_dict(get_job_stats_func(args.client))
+            return
+
+        # Print one JSON object per line, until the count is reached or bdevperf exits
+        count = 0
+        while args.count == 0 or count < args.count:
+            try:
+                stats = get_job_stats_func(args.client)
+            except (JSONRPCException, OSError):
+                if count == 0:
+                    raise
+                break
+            print(json.dumps(stats), flush=True)
+            count += 1
+            time.sleep(args.interval)
+
+    p = subparsers.add_parser('get_job_stats', help='Get the statistics of bdevperf jobs since the previous call')
+    p.add_argument('-i', '--interval', help='Repeat every <interval> seconds (may be fractional) and print '
+                   'the statistics as JSON lines', type=float)
+    p.add_argument('-n', '--count', help='Number of samples to print with --interval, 0 for no limit (default)',
+                   type=int, default=0)
+    p.set_defaults(func=get_job_stats)
+
     def call_rpc_func(args):
         try:
             args.func(args)
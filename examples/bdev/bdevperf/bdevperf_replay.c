@@ -0,0 +1,174 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (C) 2023 Intel Corporation.
+ *   All rights reserved.
+ */
+
+#include "spdk/stdinc.h"
+#include "spdk/string.h"
+#include "spdk/util.h"
+
+#include "bdevperf_replay.h"
+
+static int
+replay_parse_op(const char *str, enum bdevperf_replay_op *op)
+{
+	if (!strcmp(str, "read")) {
+		*op = BDEVPERF_REPLAY_OP_READ;
+	} else if (!strcmp(str, "write")) {
+		*op = BDEVPERF_REPLAY_OP_WRITE;
+	} else if (!strcmp(str, "trim") || !strcmp(str, "discard") || !strcmp(str, "unmap")) {
+		*op = BDEVPERF_REPLAY_OP_UNMAP;
+	} else if (!strcmp(str, "sync") || !strcmp(str, "datasync") || !strcmp(str, "flush")) {
+		*op = BDEVPERF_REPLAY_OP_FLUSH;
+	} else {
+		/* blktrace RWBS field, a flush (F) may be combined with a write (FWS) */
+		switch (str[0]) {
+		case 'F':
+			*op = BDEVPERF_REPLAY_OP_FLUSH;
+			break;
+		case 'R':
+			*op = BDEVPERF_REPLAY_OP_READ;
+			break;
+		case 'W':
+			*op = BDEVPERF_REPLAY_OP_WRITE;
+			break;
+		case 'D':
+			*op = BDEVPERF_REPLAY_OP_UNMAP;
+			break;
+		default:
+			return -EINVAL;
+		}
+	}
+
+	return 0;
+}
+
+static int
+replay_add_record(struct bdevperf_replay_trace *trace, uint64_t time_in_usec,
+		  enum bdevperf_replay_op op, uint64_t offset, uint64_t length)
+{
+	struct bdevperf_replay_record *records, *record;
+	uint64_t max_records;
+
+	if (trace->num_records == trace->max_records) {
+		max_records = spdk_max(trace->max_records * 2, 1024);
+		records = realloc(trace->records, max_records * sizeof(*records));
+		if (records == NULL) {
+			return -ENOMEM;
+		}
+
+		trace->records = records;
+		trace->max_records = max_records;
+	}
+
+	record = &trace->records[trace->num_records++];
+	record->time_in_usec = time_in_usec;
+	record->op = op;
+	record->offset = offset;
+	record->length = length;
+
+	trace->total_length += length;
+	if (op == BDEVPERF_REPLAY_OP_READ || op == BDEVPERF_REPLAY_OP_WRITE) {
+		trace->max_length = spdk_max(trace->max_length, length);
+	}
+
+	return 0;
+}
+
+int
+bdevperf_replay_load(struct bdevperf_replay_trace *trace, const char *path)
+{
+	char line[BDEVPERF_REPLAY_MAX_LINE], name[BDEVPERF_REPLAY_MAX_LINE], op_str[32];
+	enum bdevperf_replay_op op;
+	uint64_t time_in_usec = 0, first_time_in_usec = 0, offset, length;
+	int fio_version = 0, line_num = 0, n, rc = 0;
+	double timestamp;
+	bool valid;
+	FILE *file;
+
+	file = fopen(path, "r");
+	if (file == NULL) {
+		rc = -errno;
+		fprintf(stderr, "Could not open trace file %s: %s\n", path, spdk_strerror(-rc));
+		return rc;
+	}
+
+	while (fgets(line, sizeof(line), file) != NULL) {
+		line_num++;
+		if (line[0] == '#' || line[0] == '\n') {
+			continue;
+		}
+
+		if (line_num == 1 && sscanf(line, "fio version %d iolog", &fio_version) == 1) {
+			if (fio_version != 2 && fio_version != 3) {
+				fprintf(stderr, "Unsupported fio iolog version %d\n", fio_version);
+				rc = -EINVAL;
+				break;
+			}
+			continue;
+		}
+
+		offset = length = 0;
+		if (fio_version == 2) {
+			n = sscanf(line, "%s %31s %" SCNu64 " %" SCNu64, name, op_str, &offset, &length);
+			if (n >= 3 && !strcmp(op_str, "wait")) {
+				/* The offset is the delay in usec */
+				time_in_usec += offset;
+				continue;
+			}
+			valid = n >= 2;
+		} else if (fio_version == 3) {
+			n = sscanf(line, "%" SCNu64 " %s %31s %" SCNu64 " %" SCNu64, &time_in_usec, name,
+				   op_str, &offset, &length);
+			/* The timestamps are in msec */
+			time_in_usec *= 1000;
+			valid = n >= 3;
+		} else {
+			n = sscanf(line, "%lf %31s %" SCNu64 " %" SCNu64, &timestamp, op_str, &offset, &length);
+			time_in_usec = timestamp;
+			valid = n >= 2;
+		}
+
+		if (!valid) {
+			fprintf(stderr, "Invalid record at %s:%d\n", path, line_num);
+			rc = -EINVAL;
+			break;
+		}
+
+		if (replay_parse_op(op_str, &op) != 0) {
+			/* fio's open, close, add etc. */
+			continue;
+		}
+
+		if (op != BDEVPERF_REPLAY_OP_FLUSH && length == 0) {
+			fprintf(stderr, "Missing I/O length at %s:%d\n", path, line_num);
+			rc = -EINVAL;
+			break;
+		}
+
+		if (trace->num_records == 0) {
+			first_time_in_usec = time_in_usec;
+		}
+
+		rc = replay_add_record(trace, time_in_usec - spdk_min(time_in_usec, first_time_in_usec),
+				       op, offset, length);
+		if (rc != 0) {
+			fprintf(stderr, "Failed to allocate trace records\n");
+			break;
+		}
+	}
+
+	fclose(file);
+
+	if (rc == 0 && trace->num_records == 0) {
+		fprintf(stderr, "No I/O found in trace file %s\n", path);
+		rc = -EINVAL;
+	}
+
+	if (rc != 0) {
+		free(trace->records);
+		memset(trace, 0, sizeof(*trace));
+	}
+
+	return rc;
+}
@@ -0,0 +1,54 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (C) 2023 Intel Corporation.
+ *   All rights reserved.
+ */
+
+#ifndef BDEVPERF_REPLAY_H
+#define BDEVPERF_REPLAY_H
+
+#include "spdk/stdinc.h"
+
+/* Maximum length of a line of a replayed trace file */
+#define BDEVPERF_REPLAY_MAX_LINE 1024
+
+/* I/O types of the replayed trace records, the latency is reported separately for each of them */
+enum bdevperf_replay_op {
+	BDEVPERF_REPLAY_OP_READ = 0,
+	BDEVPERF_REPLAY_OP_WRITE,
+	BDEVPERF_REPLAY_OP_UNMAP,
+	BDEVPERF_REPLAY_OP_FLUSH,
+	BDEVPERF_REPLAY_NUM_OPS,
+};
+
+struct bdevperf_replay_record {
+	/* Relative to the first record of the trace */
+	uint64_t			time_in_usec;
+	/* In bytes.  A flush without a range has length 0 and covers the whole bdev. */
+	uint64_t			offset;
+	uint64_t			length;
+	enum bdevperf_replay_op		op;
+};
+
+struct bdevperf_replay_trace {
+	struct bdevperf_replay_record	*records;
+	uint64_t			num_records;
+	uint64_t			max_records;
+	/* Largest read or write of the trace, sizes the data buffers */
+	uint64_t			max_length;
+	uint64_t			total_length;
+};
+
+/*
+ * Loads a block trace to replay.  Two formats are accepted:
+ *  - fio iolog version 2 or 3, the timestamps of version 3 are in milliseconds and version 2
+ *    is timed by its "wait" actions,
+ *  - one "<time in usec> <op> <offset> <length>" record per line, where op is read, write,
+ *    trim or flush (or a blktrace RWBS field) and both offset and length are in bytes.
+ * Lines starting with '#' are skipped, as are the fio actions not doing any I/O.
+ *
+ * On success, the records are stored in the trace, which must be zeroed beforehand, and the
+ * caller frees trace->records.  On failure, the trace is left zeroed.
+ */
+int bdevperf_replay_load(struct bdevperf_replay_trace *trace, const char *path);
+
+#endif /* BDEVPERF_REPLAY_H */
@@ -1142,6 +1142,8 @@ static void
 nvme_dump_pcie_statistics(struct spdk_nvme_transport_poll_group_stat *stat)
 {
 	struct spdk_nvme_pcie_stat *pcie_stat;
+	struct spdk_nvme_pcie_qpair_stat *qpair_stat;
+	uint32_t i;
 
 	pcie_stat = &stat->pcie;
 
@@ -1155,6 +1157,18 @@ nvme_dump_pcie_statistics(struct spdk_nvme_transport_poll_group_stat *stat)
 	printf("\tsq_mmio_doorbell_updates:  %"PRIu64"\n", pcie_stat->sq_mmio_doorbell_updates);
 	printf("\tsq_shadow_doorbell_updates:  %"PRIu64"\n", pcie_stat->sq_shadow_doorbell_updates);
 	printf("\tqueued_requests:     %"PRIu64"\n", pcie_stat->queued_requests);
+	printf("\tsq_coalesced_submissions: %"PRIu64"\n", pcie_stat->sq_coalesced_submissions);
+	printf("\tsq_doorbell_updates_per_io: %.3f\n", pcie_stat->submitted_requests ?
+	       (double)spdk_max(pcie_stat->sq_mmio_doorbell_updates,
+				pcie_stat->sq_shadow_doorbell_updates) /
+	       pcie_stat->submitted_requests : 0.0);
+	printf("\tskipped_polls:       %"PRIu64"\n", pcie_stat->skipped_polls);
+	for (i = 0; i < pcie_stat->num_qpairs; i++) {
+		qpair_stat = &pcie_stat->qpair_stats[i];
+		printf("\t%s qid %u: polls %"PRIu64", idle_polls %"PRIu64" (%.2f%% idle)\n",
+		       qpair_stat->traddr, qpair_stat->qid, qpair_stat->polls, qpair_stat->idle_polls,
+		       qpair_stat->polls ? (double)qpair_stat->idle_polls * 100 / qpair_stat->polls : 0.0);
+	}
 }
 
 static void
@@ -61,6 +61,7 @@ struct spdk_blob_store;
 struct spdk_io_channel;
 struct spdk_blob;
 struct spdk_xattr_names;
+struct spdk_bit_array;
 
 /**
  * Blobstore operation completion callback.
@@ -106,6 +107,16 @@ typedef void (*spdk_blob_op_with_id_complete)(void *cb_arg, spdk_blob_id blobid,
  */
 typedef void (*spdk_blob_op_with_handle_complete)(void *cb_arg, struct spdk_blob *blb, int bserrno);
 
+/**
+ * Blob operation completion callback with a number of clusters.
+ *
+ * \param cb_arg Callback argument.
+ * \param num_clusters Number of clusters the operation affected.
+ * \param bserrno 0 if it completed successfully, or negative errno if it failed.
+ */
+typedef void (*spdk_blob_op_with_clusters_complete)(void *cb_arg, uint64_t num_clusters,
+		int bserrno);
+
 /**
  * Blobstore device completion callback.
  *
@@ -469,6 +480,25 @@ uint64_t spdk_blob_get_next_allocated_io_unit(struct spdk_blob *blob, uint64_t o
  */
 uint64_t spdk_blob_get_next_unallocated_io_unit(struct spdk_blob *blob, uint64_t offset);
 
+/**
+ * Get the clusters of a blob that changed since an older snapshot in its lineage.
+ *
+ * A cluster has changed if it is allocated in the blob or in any of its ancestors
+ * that are newer than the base snapshot. Only cluster maps are inspected, no data
+ * is read. Unallocated clusters read the same in both the blob and the base snapshot.
+ *
+ * \param blob Blob to compare, usually a snapshot.
+ * \param base_id Id of an ancestor snapshot of the blob, or SPDK_BLOBID_INVALID to
+ * report every cluster allocated anywhere in the lineage.
+ * \param clusters Bit array with capacity of at least the number of clusters of the
+ * blob. Bits of changed clusters are set, all other bits are cleared.
+ *
+ * \return 0 on success, -EINVAL if the base is not an ancestor of the blob or the
+ * bit array is too small.
+ */
+int spdk_blob_get_changed_clusters(struct spdk_blob *blob, spdk_blob_id base_id,
+				   struct spdk_bit_array *clusters);
+
 struct spdk_blob_xattr_opts {
 	/* Number of attributes */
 	size_t	count;
@@ -734,6 +764,29 @@ void spdk_bs_open_blob_ext(struct spdk_blob_store *bs, spdk_blob_id blobid,
 void spdk_blob_resize(struct spdk_blob *blob, uint64_t sz, spdk_blob_op_complete cb_fn,
 		      void *cb_arg);
 
+/**
+ * Deallocate clusters of a thin provisioned blob that contain only zeroes.
+ *
+ * Allocated clusters in the given range are read and the ones holding nothing but
+ * zeroes are removed from the blob and returned to the blobstore. Clusters are only
+ * released if reading them afterwards still returns zeroes, so clusters of a clone
+ * are kept unless the backing data is all zeroes as well. Released clusters are
+ * unmapped on the blobstore device, unless the blob's clear method is none or
+ * write zeroes.
+ *
+ * I/O to the blob is frozen while candidate clusters are verified and the blob
+ * metadata is persisted. This function must be called from the metadata thread.
+ *
+ * \param blob Blob to reclaim clusters from. Must be thin provisioned and writable.
+ * \param cluster_offset Index of the first cluster of the range to scan.
+ * \param cluster_count Number of clusters to scan.
+ * \param cb_fn Called when the operation is complete, with the number of released clusters.
+ * \param cb_arg Argument passed to function cb_fn.
+ */
+void spdk_blob_reclaim_zeroed_clusters(struct spdk_blob *blob, uint64_t cluster_offset,
+				       uint64_t cluster_count,
+				       spdk_blob_op_with_clusters_complete cb_fn, void *cb_arg);
+
 /**
  * Set blob as read only.
  *
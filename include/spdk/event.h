@@ -163,8 +163,15 @@ struct spdk_app_opts {
 	 * The vf_token is an UUID that shared between SR-IOV PF and VF.
 	 */
 	const char		*vf_token;
+
+	/**
+	 * Number of trace histories available to threads not bound to any of the
+	 * application's cores, see spdk_trace_register_user_thread().
+	 */
+	uint32_t		num_trace_threads;
+	uint8_t			reserved220[4];
 } __attribute__((packed));
-SPDK_STATIC_ASSERT(sizeof(struct spdk_app_opts) == 216, "Incorrect size");
+SPDK_STATIC_ASSERT(sizeof(struct spdk_app_opts) == 224, "Incorrect size");
 
 /**
  * Initialize the default value of opts
@@ -54,6 +54,31 @@ enum ftl_stats_type {
 	FTL_STATS_TYPE_MAX,
 };
 
+/* Streams of user data written to the base device */
+enum ftl_stats_stream {
+	/* Data compacted from the NV cache to the compaction bands */
+	FTL_STATS_STREAM_CMP = 0,
+	/* Rarely rewritten data compacted from the NV cache to the GC bands */
+	FTL_STATS_STREAM_CMP_COLD,
+	/* Data relocated by GC */
+	FTL_STATS_STREAM_GC,
+	FTL_STATS_STREAM_MAX,
+};
+
+struct ftl_stats_l2p_cache {
+	/* Number of L2P page pins served from memory */
+	uint64_t		hits;
+
+	/* Number of L2P page pins which had to wait for the page to be read from the cache device */
+	uint64_t		misses;
+
+	/* Number of L2P pages read ahead of demand after detecting sequential access */
+	uint64_t		prefetches;
+
+	/* Number of prefetched L2P pages which were pinned afterwards */
+	uint64_t		prefetch_hits;
+};
+
 struct ftl_stats {
 	/* Number of times write limits were triggered by FTL writers
 	 * (gc and compaction) dependent on number of free bands. GC starts at
@@ -69,6 +94,12 @@ struct ftl_stats {
 	uint64_t		io_activity_total;
 
 	struct ftl_stats_entry	entries[FTL_STATS_TYPE_MAX];
+
+	/* Number of user data blocks written to the base device by each stream (excluding padding) */
+	uint64_t		stream_blocks[FTL_STATS_STREAM_MAX];
+
+	/* L2P cache efficiency */
+	struct ftl_stats_l2p_cache	l2p_cache;
 };
 
 typedef void (*spdk_ftl_stats_fn)(struct ftl_stats *stats, void *cb_arg);
@@ -111,8 +142,8 @@ struct spdk_ftl_conf {
 		uint32_t			chunk_free_target;
 	} nv_cache;
 
-	/* Hole at bytes 0x60 - 0x67. */
-	uint8_t					reserved[4];
+	/* GC victim selection policy, see spdk_ftl_gc_policy enum for possible values */
+	uint32_t				gc_policy;
 
 	/* Name of base block device (zoned or non-zoned) */
 	char					*base_bdev;
@@ -123,8 +154,15 @@ struct spdk_ftl_conf {
 	/* Enable fast shutdown path */
 	bool					fast_shutdown;
 
-	/* Hole at bytes 0x79 - 0x7f. */
-	uint8_t					reserved2[7];
+	/*
+	 * Submit the data transfers of user IO to the base and cache devices from the
+	 * threads owning the FTL IO channels, instead of from the core thread. Metadata
+	 * (L2P, bands and NV cache chunks) is still managed by the core thread only.
+	 */
+	bool					user_io_offload;
+
+	/* Hole at bytes 0x7a - 0x7f. */
+	uint8_t					reserved2[6];
 
 	/*
 	 * The size of spdk_ftl_conf according to the caller of this library is used for ABI
@@ -135,6 +173,22 @@ struct spdk_ftl_conf {
 } __attribute__((packed));
 SPDK_STATIC_ASSERT(sizeof(struct spdk_ftl_conf) == 136, "Incorrect size");
 
+enum spdk_ftl_gc_policy {
+	/*
+	 * Relocate the bands with the most invalid blocks first, if their invalidity is
+	 * similar, prefer the ones written fewer times
+	 */
+	SPDK_FTL_GC_POLICY_GREEDY = 0,
+
+	/*
+	 * Weigh the space reclaimed by relocating a band and the time since it was closed
+	 * against the cost of moving its valid data
+	 */
+	SPDK_FTL_GC_POLICY_COST_BENEFIT,
+
+	SPDK_FTL_GC_POLICY_MAX,
+};
+
 enum spdk_ftl_mode {
 	/* Create new device */
 	SPDK_FTL_MODE_CREATE = (1 << 0),
@@ -326,6 +380,25 @@ void spdk_ftl_dev_set_fast_shutdown(struct spdk_ftl_dev *dev, bool fast_shutdown
 int spdk_ftl_get_stats(struct spdk_ftl_dev *dev, struct ftl_stats *stats, spdk_ftl_stats_fn cb_fn,
 		       void *cb_arg);
 
+/**
+ * Get the name of a GC policy.
+ *
+ * \param gc_policy GC policy, one of the spdk_ftl_gc_policy values.
+ *
+ * \return name of the policy, or NULL if the policy is unknown.
+ */
+const char *spdk_ftl_gc_policy_str(uint32_t gc_policy);
+
+/**
+ * Parse the name of a GC policy.
+ *
+ * \param gc_policy Filled with the spdk_ftl_gc_policy value of the policy.
+ * \param str Name of the policy.
+ *
+ * \return 0 on success, -EINVAL if there's no policy with such name.
+ */
+int spdk_ftl_gc_policy_parse(uint32_t *gc_policy, const char *str);
+
 #ifdef __cplusplus
 }
 #endif
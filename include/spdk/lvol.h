@@ -276,6 +276,75 @@ void spdk_lvol_inflate(struct spdk_lvol *lvol, spdk_lvol_op_complete cb_fn, void
  */
 void spdk_lvol_decouple_parent(struct spdk_lvol *lvol, spdk_lvol_op_complete cb_fn, void *cb_arg);
 
+/**
+ * Progress of the space reclamation of a lvol.
+ */
+struct spdk_lvol_reclaim_status {
+	/** True while reclamation is running */
+	bool in_progress;
+
+	/** Number of clusters scanned so far */
+	uint64_t scanned_clusters;
+
+	/** Number of clusters of the lvol when reclamation started */
+	uint64_t total_clusters;
+
+	/** Number of clusters released back to the lvolstore */
+	uint64_t released_clusters;
+
+	/** Result of the last finished reclamation, 0 on success */
+	int result;
+};
+
+/**
+ * Start background reclamation of the space of a thin provisioned lvol.
+ *
+ * Allocated clusters that contain only zeroes, and would read as zeroes once
+ * deallocated, are released back to the lvolstore. The lvol is scanned in
+ * chunks of clusters, and I/O to the lvol is only held while a chunk that
+ * contained zeroed clusters is being committed. Closing the lvol stops the
+ * reclamation.
+ *
+ * \param lvol Handle to lvol.
+ * \param rate_limit_mb_per_sec Maximum scan rate in MiB/s, 0 for no limit.
+ * \param cb_fn Called when reclamation finishes, may be NULL.
+ * \param cb_arg Completion callback custom arguments.
+ *
+ * \return 0 if reclamation was started, negative errno otherwise:
+ * -EINVAL if the lvol is not thin provisioned or not open, -EPERM if the
+ * lvol is read only, -EBUSY if reclamation is already running.
+ */
+int spdk_lvol_reclaim_space(struct spdk_lvol *lvol, uint64_t rate_limit_mb_per_sec,
+			    spdk_lvol_op_complete cb_fn, void *cb_arg);
+
+/**
+ * Get the progress of the running or last finished space reclamation of a lvol.
+ *
+ * \param lvol Handle to lvol.
+ * \param status Filled with the reclamation progress.
+ */
+void spdk_lvol_get_reclaim_status(struct spdk_lvol *lvol,
+				  struct spdk_lvol_reclaim_status *status);
+
+/**
+ * Get the clusters of a snapshot that changed since an older snapshot of the same lvol.
+ *
+ * The difference is computed from the cluster maps of the snapshots, no data is read.
+ * Only the changed clusters have to be copied to bring a backup of the base snapshot
+ * up to date with the snapshot.
+ *
+ * \param snapshot Handle to the snapshot lvol.
+ * \param base_snapshot Handle to an older snapshot in the lineage of the snapshot,
+ * or NULL to get every cluster allocated in the lineage, for a full backup.
+ * \param clusters Bit array with capacity of at least the number of clusters of the
+ * snapshot. Bits of changed clusters are set, all other bits are cleared.
+ *
+ * \return 0 on success, -EINVAL if an lvol is not a snapshot, the base snapshot
+ * is not an ancestor of the snapshot or the bit array is too small.
+ */
+int spdk_lvol_get_changed_clusters(struct spdk_lvol *snapshot, struct spdk_lvol *base_snapshot,
+				   struct spdk_bit_array *clusters);
+
 #ifdef __cplusplus
 }
 #endif
@@ -519,6 +519,14 @@ struct spdk_nvme_rdma_device_stat {
 	uint64_t recv_doorbell_updates;
 };
 
+struct spdk_nvme_pcie_qpair_stat {
+	/* PCI address of the controller owning the qpair */
+	char traddr[SPDK_NVMF_TRADDR_MAX_LEN + 1];
+	uint16_t qid;
+	uint64_t polls;
+	uint64_t idle_polls;
+};
+
 struct spdk_nvme_pcie_stat {
 	uint64_t polls;
 	uint64_t idle_polls;
@@ -529,6 +537,12 @@ struct spdk_nvme_pcie_stat {
 	uint64_t queued_requests;
 	uint64_t sq_mmio_doorbell_updates;
 	uint64_t sq_shadow_doorbell_updates;
+	/* Submissions whose SQ doorbell write was merged into a later one */
+	uint64_t sq_coalesced_submissions;
+	/* Idle polls that were resolved by the poll group from the CQ phase bit alone */
+	uint64_t skipped_polls;
+	uint32_t num_qpairs;
+	struct spdk_nvme_pcie_qpair_stat *qpair_stats;
 };
 
 struct spdk_nvme_tcp_stat {
@@ -1639,8 +1653,20 @@ struct spdk_nvme_io_qpair_opts {
 	 */
 	bool async_mode;
 
-	/* Hole at bytes 66-71. */
-	uint8_t reserved66[6];
+	/* Hole at bytes 66-67. */
+	uint8_t reserved66[2];
+
+	/**
+	 * Enable adaptive submission queue doorbell coalescing with the given upper bound,
+	 * in microseconds, on how long a submitted command may wait for its doorbell write.
+	 * The number of commands covered by one doorbell write follows the observed
+	 * submission rate of the qpair, and the doorbell is written immediately whenever the
+	 * controller would otherwise have no command to work on. Pending commands are also
+	 * submitted on every completion poll. 0 disables the feature.
+	 *
+	 * This only applies to the PCIe transport and is ignored if delay_cmd_submit is set.
+	 */
+	uint32_t sq_doorbell_max_delay_us;
 } __attribute__((packed));
 SPDK_STATIC_ASSERT(sizeof(struct spdk_nvme_io_qpair_opts) == 72, "Incorrect size");
 
@@ -86,10 +86,21 @@ struct spdk_trace_tpoint {
 	} related_objects[SPDK_TRACE_MAX_RELATIONS];
 };
 
+#define SPDK_TRACE_MAX_THREAD_NAME_LEN	16
+
 struct spdk_trace_history {
-	/** Logical core number associated with this structure instance. */
+	/**
+	 * Logical core number associated with this structure instance.  Histories of threads
+	 *  not bound to any lcore use the numbers following the application's last core.
+	 */
 	int				lcore;
 
+	/**
+	 * Name of the thread which registered this history with
+	 *  spdk_trace_register_user_thread().  Empty for lcore histories.
+	 */
+	char				thread_name[SPDK_TRACE_MAX_THREAD_NAME_LEN];
+
 	/** Number of trace_entries contained in each trace_history. */
 	uint64_t			num_entries;
 
@@ -279,9 +290,30 @@ void spdk_trace_clear_tpoint_group_mask(uint64_t tpoint_group_mask);
  *
  * \param shm_name Name of shared memory.
  * \param num_entries Number of trace entries per lcore.
+ * \param num_threads Number of trace histories to allocate for threads not bound
+ * to any lcore, see spdk_trace_register_user_thread().
  * \return 0 on success, else non-zero indicates a failure.
  */
-int spdk_trace_init(const char *shm_name, uint64_t num_entries);
+int spdk_trace_init(const char *shm_name, uint64_t num_entries, uint32_t num_threads);
+
+/**
+ * Assign one of the trace histories allocated for threads not bound to any lcore
+ * to the calling thread.  Tracepoints recorded by such a thread are dropped until
+ * it's registered.
+ *
+ * \return 0 on success, -EINVAL if the calling thread runs on an lcore, -EEXIST if
+ * it's already registered, -ENOENT if there are no histories left.
+ */
+int spdk_trace_register_user_thread(void);
+
+/**
+ * Release the trace history assigned to the calling thread by
+ * spdk_trace_register_user_thread().  The entries recorded so far are kept.  Registered
+ * threads need to unregister before spdk_trace_cleanup() is called.
+ *
+ * \return 0 on success, -ENOENT if the calling thread isn't registered.
+ */
+int spdk_trace_unregister_user_thread(void);
 
 /**
  * Unmap global trace memory structs.
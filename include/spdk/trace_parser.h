@@ -121,6 +121,18 @@ bool spdk_trace_parser_next_entry(struct spdk_trace_parser *parser,
  */
 uint64_t spdk_trace_parser_get_entry_count(const struct spdk_trace_parser *parser, uint16_t lcore);
 
+/**
+ * Return the name of the thread which recorded the entries of a given history.  Histories of
+ * threads not bound to any lcore are stored after the lcore ones and are merged with them.
+ *
+ * \param parser Parser object to be used.
+ * \param lcore Logical core number (history index).
+ *
+ * \return Name of the thread or NULL if the history belongs to an lcore.
+ */
+const char *spdk_trace_parser_get_thread_name(const struct spdk_trace_parser *parser,
+		uint16_t lcore);
+
 #ifdef __cplusplus
 }
 #endif
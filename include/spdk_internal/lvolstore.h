@@ -43,6 +43,19 @@ struct spdk_lvol_req {
 	char			name[SPDK_LVOL_NAME_MAX];
 };
 
+struct spdk_lvol_reclaim_req {
+	spdk_lvol_op_complete	cb_fn;
+	void			*cb_arg;
+	struct spdk_lvol	*lvol;
+	struct spdk_poller	*poller;
+	uint64_t		next_cluster;
+	uint64_t		chunk_start_tsc;
+	/* Minimum ticks between the starts of two chunks, 0 for no rate limit */
+	uint64_t		ticks_per_chunk;
+	/* Close deferred until the reclamation stops */
+	struct spdk_lvol_req	*close_req;
+};
+
 struct spdk_lvs_with_handle_req {
 	spdk_lvs_op_with_handle_complete cb_fn;
 	void				*cb_arg;
@@ -93,6 +106,8 @@ struct spdk_lvol {
 	int				ref_count;
 	bool				action_in_progress;
 	enum blob_clear_method		clear_method;
+	struct spdk_lvol_reclaim_req	*reclaim_req;
+	struct spdk_lvol_reclaim_status	reclaim_status;
 	TAILQ_ENTRY(spdk_lvol) link;
 };
 
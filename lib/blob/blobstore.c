@@ -90,6 +90,39 @@ bs_release_md_page(struct spdk_blob_store *bs, uint32_t page)
 	spdk_bit_array_clear(bs->used_md_pages, page);
 }
 
+static void
+bs_magazine_return_clusters(struct spdk_blob_store *bs, struct spdk_bs_cluster_magazine *mag)
+{
+	uint32_t i;
+
+	assert(spdk_spin_held(&bs->used_lock));
+	assert(spdk_spin_held(&mag->lock));
+
+	for (i = 0; i < mag->count; i++) {
+		assert(spdk_bit_pool_is_allocated(bs->used_clusters, mag->clusters[i]) == true);
+		spdk_bit_pool_free_bit(bs->used_clusters, mag->clusters[i]);
+	}
+
+	bs->num_free_clusters += mag->count;
+	__atomic_fetch_sub(&bs->num_cached_clusters, mag->count, __ATOMIC_RELAXED);
+	mag->count = 0;
+}
+
+/* Return the clusters cached by all channels to used_clusters. */
+static void
+bs_reclaim_cached_clusters(struct spdk_blob_store *bs)
+{
+	struct spdk_bs_cluster_magazine *mag;
+
+	assert(spdk_spin_held(&bs->used_lock));
+
+	TAILQ_FOREACH(mag, &bs->cluster_magazines, link) {
+		spdk_spin_lock(&mag->lock);
+		bs_magazine_return_clusters(bs, mag);
+		spdk_spin_unlock(&mag->lock);
+	}
+}
+
 static uint32_t
 bs_claim_cluster(struct spdk_blob_store *bs)
 {
@@ -98,6 +131,12 @@ bs_claim_cluster(struct spdk_blob_store *bs)
 	assert(spdk_spin_held(&bs->used_lock));
 
 	cluster_num = spdk_bit_pool_allocate_bit(bs->used_clusters);
+	if (cluster_num == UINT32_MAX &&
+	    __atomic_load_n(&bs->num_cached_clusters, __ATOMIC_RELAXED) != 0) {
+		/* Take back the clusters cached by the channels before giving up */
+		bs_reclaim_cached_clusters(bs);
+		cluster_num = spdk_bit_pool_allocate_bit(bs->used_clusters);
+	}
 	if (cluster_num == UINT32_MAX) {
 		return UINT32_MAX;
 	}
@@ -137,6 +176,26 @@ blob_insert_cluster(struct spdk_blob *blob, uint32_t cluster_num, uint64_t clust
 	return 0;
 }
 
+static int
+bs_claim_extent_page(struct spdk_blob_store *bs, uint32_t *lowest_free_md_page)
+{
+	assert(spdk_spin_held(&bs->used_lock));
+
+	/* Extent page shall never occupy md_page so start the search from 1 */
+	if (*lowest_free_md_page == 0) {
+		*lowest_free_md_page = 1;
+	}
+	*lowest_free_md_page = spdk_bit_array_find_first_clear(bs->used_md_pages,
+			       *lowest_free_md_page);
+	if (*lowest_free_md_page == UINT32_MAX) {
+		/* No more free md pages. Cannot satisfy the request */
+		return -ENOSPC;
+	}
+	bs_claim_md_page(bs, *lowest_free_md_page);
+
+	return 0;
+}
+
 static int
 bs_allocate_cluster(struct spdk_blob *blob, uint32_t cluster_num,
 		    uint64_t *cluster, uint32_t *lowest_free_md_page, bool update_map)
@@ -153,20 +212,10 @@ bs_allocate_cluster(struct spdk_blob *blob, uint32_t cluster_num,
 
 	if (blob->use_extent_table) {
 		extent_page = bs_cluster_to_extent_page(blob, cluster_num);
-		if (*extent_page == 0) {
-			/* Extent page shall never occupy md_page so start the search from 1 */
-			if (*lowest_free_md_page == 0) {
-				*lowest_free_md_page = 1;
-			}
-			/* No extent_page is allocated for the cluster */
-			*lowest_free_md_page = spdk_bit_array_find_first_clear(blob->bs->used_md_pages,
-					       *lowest_free_md_page);
-			if (*lowest_free_md_page == UINT32_MAX) {
-				/* No more free md pages. Cannot satisfy the request */
-				bs_release_cluster(blob->bs, *cluster);
-				return -ENOSPC;
-			}
-			bs_claim_md_page(blob->bs, *lowest_free_md_page);
+		/* No extent_page is allocated for the cluster */
+		if (*extent_page == 0 && bs_claim_extent_page(blob->bs, lowest_free_md_page) != 0) {
+			bs_release_cluster(blob->bs, *cluster);
+			return -ENOSPC;
 		}
 	}
 
@@ -183,6 +232,125 @@ bs_allocate_cluster(struct spdk_blob *blob, uint32_t cluster_num,
 	return 0;
 }
 
+static void
+bs_magazine_refill(struct spdk_bs_channel *ch)
+{
+	struct spdk_blob_store *bs = ch->bs;
+	struct spdk_bs_cluster_magazine *mag = &ch->cluster_magazine;
+	uint32_t clusters[SPDK_BS_CLUSTER_MAGAZINE_SIZE];
+	uint32_t count = 0;
+
+	spdk_spin_lock(&bs->used_lock);
+
+	if (bs->num_free_clusters == 0) {
+		/* Other channels may still be sitting on free clusters */
+		bs_reclaim_cached_clusters(bs);
+	}
+
+	/* The bit pool hands out the lowest free bits first, so a refill usually
+	 * yields a contiguous run of clusters. */
+	while (count < SPDK_BS_CLUSTER_MAGAZINE_SIZE) {
+		clusters[count] = spdk_bit_pool_allocate_bit(bs->used_clusters);
+		if (clusters[count] == UINT32_MAX) {
+			break;
+		}
+		count++;
+	}
+	bs->num_free_clusters -= count;
+	__atomic_fetch_add(&bs->num_cached_clusters, count, __ATOMIC_RELAXED);
+
+	spdk_spin_lock(&mag->lock);
+	assert(mag->count + count <= SPDK_BS_CLUSTER_MAGAZINE_SIZE);
+	memcpy(&mag->clusters[mag->count], clusters, count * sizeof(clusters[0]));
+	mag->count += count;
+	spdk_spin_unlock(&mag->lock);
+
+	spdk_spin_unlock(&bs->used_lock);
+}
+
+static uint32_t
+bs_magazine_claim_cluster(struct spdk_bs_channel *ch, uint32_t hint)
+{
+	struct spdk_bs_cluster_magazine *mag = &ch->cluster_magazine;
+	uint32_t cluster_num;
+	uint32_t i;
+
+	spdk_spin_lock(&mag->lock);
+	if (mag->count == 0) {
+		spdk_spin_unlock(&mag->lock);
+		bs_magazine_refill(ch);
+		spdk_spin_lock(&mag->lock);
+	}
+	if (mag->count == 0) {
+		spdk_spin_unlock(&mag->lock);
+		return UINT32_MAX;
+	}
+
+	for (i = 0; i < mag->count; i++) {
+		if (mag->clusters[i] == hint) {
+			break;
+		}
+	}
+	if (i == mag->count) {
+		i = 0;
+	}
+
+	cluster_num = mag->clusters[i];
+	mag->count--;
+	memmove(&mag->clusters[i], &mag->clusters[i + 1], (mag->count - i) * sizeof(mag->clusters[0]));
+	__atomic_fetch_sub(&ch->bs->num_cached_clusters, 1, __ATOMIC_RELAXED);
+	spdk_spin_unlock(&mag->lock);
+
+	SPDK_DEBUGLOG(blob, "Claiming cached cluster %u\n", cluster_num);
+
+	return cluster_num;
+}
+
+/*
+ * Allocate a cluster for a thin provisioned blob from the channel's magazine.
+ * Prefer the cluster directly following the one backing the previous cluster
+ * of the blob, so that sequentially written blobs stay contiguous on disk.
+ */
+static int
+bs_channel_allocate_cluster(struct spdk_bs_channel *ch, struct spdk_blob *blob,
+			    uint32_t cluster_num, uint64_t *cluster, uint32_t *lowest_free_md_page)
+{
+	struct spdk_blob_store *bs = blob->bs;
+	uint32_t hint = UINT32_MAX;
+	uint32_t *extent_page;
+	int rc;
+
+	if (cluster_num > 0 && blob->active.clusters[cluster_num - 1] != 0) {
+		hint = bs_lba_to_cluster(bs, blob->active.clusters[cluster_num - 1]) + 1;
+	}
+
+	*cluster = bs_magazine_claim_cluster(ch, hint);
+	if (*cluster == UINT32_MAX) {
+		/* No more free clusters. Cannot satisfy the request */
+		return -ENOSPC;
+	}
+
+	if (blob->use_extent_table) {
+		extent_page = bs_cluster_to_extent_page(blob, cluster_num);
+		if (*extent_page == 0) {
+			spdk_spin_lock(&bs->used_lock);
+			rc = bs_claim_extent_page(bs, lowest_free_md_page);
+			if (rc != 0) {
+				bs_release_cluster(bs, *cluster);
+			}
+			spdk_spin_unlock(&bs->used_lock);
+			if (rc != 0) {
+				return rc;
+			}
+		}
+	}
+
+	SPDK_DEBUGLOG(blob, "Claiming cluster %" PRIu64 " for blob 0x%" PRIx64 "\n", *cluster,
+		      blob->id);
+
+	return 0;
+}
+
 static void
 blob_xattrs_init(struct spdk_blob_xattr_opts *xattrs)
 {
@@ -2026,6 +2194,10 @@ blob_resize(struct spdk_blob *blob, uint64_t sz)
 	 */
 	if (sz > num_clusters && spdk_blob_is_thin_provisioned(blob) == false) {
 		spdk_spin_lock(&bs->used_lock);
+		if ((sz - num_clusters) > bs->num_free_clusters) {
+			/* Clusters cached by the channels are free as well */
+			bs_reclaim_cached_clusters(bs);
+		}
 		if ((sz - num_clusters) > bs->num_free_clusters) {
 			rc = -ENOSPC;
 			goto out;
@@ -2535,10 +2707,8 @@ bs_allocate_and_copy_cluster(struct spdk_blob *blob,
 		}
 	}
 
-	spdk_spin_lock(&blob->bs->used_lock);
-	rc = bs_allocate_cluster(blob, cluster_number, &ctx->new_cluster, &ctx->new_extent_page,
-				 false);
-	spdk_spin_unlock(&blob->bs->used_lock);
+	rc = bs_channel_allocate_cluster(ch, blob, cluster_number, &ctx->new_cluster,
+					 &ctx->new_extent_page);
 	if (rc != 0) {
 		spdk_free(ctx->buf);
 		free(ctx);
@@ -2801,6 +2971,7 @@ blob_request_submit_op_single(struct spdk_io_channel *_ch, struct spdk_blob *blo
 
 		if (is_allocated) {
 			/* Read from the blob */
+			batch->io_blob = blob;
 			bs_batch_read_dev(batch, payload, lba, lba_count);
 		} else {
 			/* Read from the backing block device */
@@ -2827,6 +2998,7 @@ blob_request_submit_op_single(struct spdk_io_channel *_ch, struct spdk_blob *blo
 				return;
 			}
 
+			batch->io_blob = blob;
 			if (op_type == SPDK_BLOB_WRITE) {
 				bs_batch_write_dev(batch, payload, lba, lba_count);
 			} else {
@@ -2858,6 +3030,7 @@ blob_request_submit_op_single(struct spdk_io_channel *_ch, struct spdk_blob *blo
 		}
 
 		if (is_allocated) {
+			batch->io_blob = blob;
 			bs_batch_unmap_dev(batch, lba, lba_count);
 		}
 
@@ -3074,6 +3247,7 @@ blob_request_submit_rw_iov(struct spdk_blob *blob, struct spdk_io_channel *_chan
 			seq->ext_io_opts = ext_io_opts;
 
 			if (is_allocated) {
+				seq->io_blob = blob;
 				bs_sequence_readv_dev(seq, iov, iovcnt, lba, lba_count, rw_iov_done, NULL);
 			} else {
 				bs_sequence_readv_bs_dev(seq, blob->back_bs_dev, iov, iovcnt, lba, lba_count,
@@ -3090,6 +3264,7 @@ blob_request_submit_rw_iov(struct spdk_blob *blob, struct spdk_io_channel *_chan
 				}
 
 				seq->ext_io_opts = ext_io_opts;
+				seq->io_blob = blob;
 
 				bs_sequence_writev_dev(seq, iov, iovcnt, lba, lba_count, rw_iov_done, NULL);
 			} else {
@@ -3219,15 +3394,31 @@ bs_channel_create(void *io_device, void *ctx_buf)
 	TAILQ_INIT(&channel->need_cluster_alloc);
 	TAILQ_INIT(&channel->queued_io);
 
+	spdk_spin_init(&channel->cluster_magazine.lock);
+	channel->cluster_magazine.count = 0;
+	spdk_spin_lock(&bs->used_lock);
+	TAILQ_INSERT_TAIL(&bs->cluster_magazines, &channel->cluster_magazine, link);
+	spdk_spin_unlock(&bs->used_lock);
+
 	return 0;
 }
 
 static void
 bs_channel_destroy(void *io_device, void *ctx_buf)
 {
+	struct spdk_blob_store *bs = io_device;
 	struct spdk_bs_channel *channel = ctx_buf;
+	struct spdk_bs_cluster_magazine *mag = &channel->cluster_magazine;
 	spdk_bs_user_op_t *op;
 
+	spdk_spin_lock(&bs->used_lock);
+	TAILQ_REMOVE(&bs->cluster_magazines, mag, link);
+	spdk_spin_lock(&mag->lock);
+	bs_magazine_return_clusters(bs, mag);
+	spdk_spin_unlock(&mag->lock);
+	spdk_spin_unlock(&bs->used_lock);
+	spdk_spin_destroy(&mag->lock);
+
 	while (!TAILQ_EMPTY(&channel->need_cluster_alloc)) {
 		op = TAILQ_FIRST(&channel->need_cluster_alloc);
 		TAILQ_REMOVE(&channel->need_cluster_alloc, op, link);
@@ -3506,6 +3697,7 @@ bs_alloc(struct spdk_bs_dev *dev, struct spdk_bs_opts *opts, struct spdk_blob_st
 
 	RB_INIT(&bs->open_blobs);
 	TAILQ_INIT(&bs->snapshots);
+	TAILQ_INIT(&bs->cluster_magazines);
 	bs->dev = dev;
 	bs->md_thread = spdk_get_thread();
 	assert(bs->md_thread != NULL);
@@ -5426,6 +5618,11 @@ bs_unload_write_used_blobids_cpl(spdk_bs_sequence_t *seq, void *cb_arg, int bser
 		return;
 	}
 
+	/* Clusters cached by channels that are still around must not be persisted as used */
+	spdk_spin_lock(&ctx->bs->used_lock);
+	bs_reclaim_cached_clusters(ctx->bs);
+	spdk_spin_unlock(&ctx->bs->used_lock);
+
 	bs_write_used_clusters(seq, ctx, bs_unload_write_used_clusters_cpl);
 }
 
@@ -5627,7 +5824,7 @@ spdk_bs_get_io_unit_size(struct spdk_blob_store *bs)
 uint64_t
 spdk_bs_free_cluster_count(struct spdk_blob_store *bs)
 {
-	return bs->num_free_clusters;
+	return bs->num_free_clusters + __atomic_load_n(&bs->num_cached_clusters, __ATOMIC_RELAXED);
 }
 
 uint64_t
@@ -5716,6 +5913,56 @@ spdk_blob_get_next_unallocated_io_unit(struct spdk_blob *blob, uint64_t offset)
 	return blob_find_io_unit(blob, offset, false);
 }
 
+static struct spdk_blob *
+blob_get_parent_blob(struct spdk_blob *blob)
+{
+	if (blob->parent_id == SPDK_BLOBID_INVALID) {
+		return NULL;
+	}
+
+	/* Parent snapshot is kept open as the back device of its clones */
+	return ((struct spdk_blob_bs_dev *)blob->back_bs_dev)->blob;
+}
+
+int
+spdk_blob_get_changed_clusters(struct spdk_blob *blob, spdk_blob_id base_id,
+			       struct spdk_bit_array *clusters)
+{
+	struct spdk_blob *ancestor;
+	uint64_t i, num_clusters;
+
+	blob_verify_md_op(blob);
+
+	if (spdk_bit_array_capacity(clusters) < blob->active.num_clusters) {
+		return -EINVAL;
+	}
+
+	if (base_id != SPDK_BLOBID_INVALID) {
+		ancestor = blob;
+		while (ancestor != NULL && ancestor->id != base_id) {
+			ancestor = blob_get_parent_blob(ancestor);
+		}
+		if (ancestor == NULL) {
+			SPDK_DEBUGLOG(blob, "Blob 0x%" PRIx64 " is not an ancestor of blob 0x%" PRIx64 "\n",
+				      base_id, blob->id);
+			return -EINVAL;
+		}
+	}
+
+	spdk_bit_array_clear_mask(clusters);
+	for (ancestor = blob; ancestor != NULL && ancestor->id != base_id;
+	     ancestor = blob_get_parent_blob(ancestor)) {
+		num_clusters = spdk_min(ancestor->active.num_clusters, blob->active.num_clusters);
+		for (i = 0; i < num_clusters; i++) {
+			if (ancestor->active.clusters[i] != 0) {
+				spdk_bit_array_set(clusters, i);
+			}
+		}
+	}
+
+	return 0;
+}
+
 /* START spdk_bs_create_blob */
 
 static void
@@ -6599,7 +6846,7 @@ bs_inflate_blob_open_cpl(void *cb_arg, struct spdk_blob *_blob, int bserrno)
 		}
 	}
 
-	if (clusters_needed > _blob->bs->num_free_clusters) {
+	if (clusters_needed > spdk_bs_free_cluster_count(_blob->bs)) {
 		/* Not enough free clusters. Cannot satisfy the request. */
 		bs_clone_snapshot_origblob_cleanup(ctx, -ENOSPC);
 		return;
@@ -6731,6 +6978,419 @@ spdk_blob_resize(struct spdk_blob *blob, uint64_t sz, spdk_blob_op_complete cb_f
 
 /* END spdk_blob_resize */
 
+/* START spdk_blob_reclaim_zeroed_clusters */
+
+/* Maximum number of clusters verified and released per freeze of the blob I/O */
+#define BLOB_RECLAIM_BATCH 32
+
+struct spdk_blob_reclaim_ctx {
+	struct spdk_blob			*blob;
+	spdk_bs_sequence_t			*seq;
+	void					*buf;
+	uint64_t				next_cluster;
+	uint64_t				end_cluster;
+	uint64_t				cur_cluster;
+
+	/* Clusters found to be zeroed and the LBA they were backed by at that time */
+	uint64_t				clusters[BLOB_RECLAIM_BATCH];
+	uint64_t				lbas[BLOB_RECLAIM_BATCH];
+	uint32_t				num_candidates;
+	uint32_t				verify_idx;
+	uint32_t				num_released;
+	uint32_t				next_released;
+
+	/* Extent page rewritten for the released clusters, NULL without extent table */
+	struct spdk_blob_md_page		*extent_page;
+
+	uint64_t				total_released;
+	bool					io_busy;
+	int					bserrno;
+	spdk_blob_op_with_clusters_complete	cb_fn;
+	void					*cb_arg;
+};
+
+static void blob_reclaim_scan_next(struct spdk_blob_reclaim_ctx *ctx);
+static void blob_reclaim_verify_next(struct spdk_blob_reclaim_ctx *ctx);
+
+static void
+blob_reclaim_done(void *cb_arg, int bserrno)
+{
+	struct spdk_blob_reclaim_ctx *ctx = cb_arg;
+
+	ctx->blob->locked_operation_in_progress = false;
+	ctx->cb_fn(ctx->cb_arg, ctx->total_released, bserrno);
+	spdk_free(ctx->extent_page);
+	spdk_free(ctx->buf);
+	free(ctx);
+}
+
+static void
+blob_reclaim_finish(struct spdk_blob_reclaim_ctx *ctx, int bserrno)
+{
+	bs_sequence_finish(ctx->seq, bserrno);
+}
+
+static void
+blob_reclaim_unmap_cpl(spdk_bs_sequence_t *seq, void *cb_arg, int bserrno)
+{
+	struct spdk_blob_reclaim_ctx *ctx = cb_arg;
+	struct spdk_blob_store *bs = ctx->blob->bs;
+	uint32_t i;
+
+	if (bserrno != 0) {
+		/* The clusters are not referenced anymore, so unmap is only a hint */
+		SPDK_NOTICELOG("Failed to unmap released clusters of blob 0x%" PRIx64 ": %d\n",
+			       ctx->blob->id, bserrno);
+	}
+
+	spdk_spin_lock(&bs->used_lock);
+	for (i = 0; i < ctx->num_released; i++) {
+		bs_release_cluster(bs, bs_lba_to_cluster(bs, ctx->lbas[i]));
+	}
+	spdk_spin_unlock(&bs->used_lock);
+
+	ctx->total_released += ctx->num_released;
+	ctx->num_released = 0;
+	ctx->num_candidates = 0;
+
+	blob_reclaim_scan_next(ctx);
+}
+
+static void
+blob_reclaim_unfreeze_cpl(void *cb_arg, int bserrno)
+{
+	struct spdk_blob_reclaim_ctx *ctx = cb_arg;
+	struct spdk_blob *blob = ctx->blob;
+	spdk_bs_batch_t *batch;
+	uint64_t lba, lba_count;
+	uint32_t i;
+
+	if (ctx->bserrno != 0) {
+		blob_reclaim_finish(ctx, ctx->bserrno);
+		return;
+	}
+
+	if (ctx->num_released == 0) {
+		ctx->num_candidates = 0;
+		blob_reclaim_scan_next(ctx);
+		return;
+	}
+
+	/* Unmap before the clusters go back to the pool, so that no other blob
+	 * can have written to them in the meantime. */
+	batch = bs_sequence_to_batch(ctx->seq, blob_reclaim_unmap_cpl, ctx);
+	if (blob->clear_method == BLOB_CLEAR_WITH_DEFAULT || blob->clear_method == BLOB_CLEAR_WITH_UNMAP) {
+		lba = ctx->lbas[0];
+		lba_count = bs_cluster_to_lba(blob->bs, 1);
+		for (i = 1; i < ctx->num_released; i++) {
+			if (ctx->lbas[i] == lba + lba_count) {
+				lba_count += bs_cluster_to_lba(blob->bs, 1);
+				continue;
+			}
+			bs_batch_unmap_dev(batch, lba, lba_count);
+			lba = ctx->lbas[i];
+			lba_count = bs_cluster_to_lba(blob->bs, 1);
+		}
+		bs_batch_unmap_dev(batch, lba, lba_count);
+	}
+	bs_batch_close(batch);
+}
+
+static void
+blob_reclaim_persist_cpl(spdk_bs_sequence_t *seq, void *cb_arg, int bserrno)
+{
+	struct spdk_blob_reclaim_ctx *ctx = cb_arg;
+
+	if (bserrno != 0) {
+		/* Metadata on disk may or may not reference the clusters anymore.
+		 * Keep them unallocated in the blob, but do not return them to the pool. */
+		ctx->num_released = 0;
+		ctx->bserrno = bserrno;
+	}
+
+	blob_unfreeze_io(ctx->blob, blob_reclaim_unfreeze_cpl, ctx);
+}
+
+static void
+blob_reclaim_write_extent_pages(spdk_bs_sequence_t *seq, void *cb_arg, int bserrno)
+{
+	struct spdk_blob_reclaim_ctx *ctx = cb_arg;
+	struct spdk_blob *blob = ctx->blob;
+	uint64_t cluster_num;
+	uint32_t *extent_page;
+
+	if (bserrno != 0) {
+		blob_reclaim_persist_cpl(seq, ctx, bserrno);
+		return;
+	}
+
+	if (ctx->extent_page == NULL || ctx->next_released == ctx->num_released) {
+		blob_persist(seq, blob, blob_reclaim_persist_cpl, ctx);
+		return;
+	}
+
+	/* Released clusters are sorted, write each extent page covering them once */
+	cluster_num = ctx->clusters[ctx->next_released];
+	while (ctx->next_released < ctx->num_released &&
+	       ctx->clusters[ctx->next_released] / SPDK_EXTENTS_PER_EP == cluster_num / SPDK_EXTENTS_PER_EP) {
+		ctx->next_released++;
+	}
+
+	extent_page = bs_cluster_to_extent_page(blob, cluster_num);
+	assert(*extent_page != 0);
+
+	memset(ctx->extent_page, 0, SPDK_BS_PAGE_SIZE);
+	ctx->extent_page->next = SPDK_INVALID_MD_PAGE;
+	ctx->extent_page->id = blob->id;
+	ctx->extent_page->sequence_num = 0;
+	blob_serialize_extent_page(blob, cluster_num, ctx->extent_page);
+	ctx->extent_page->crc = blob_md_page_calc_crc(ctx->extent_page);
+
+	bs_sequence_write_dev(seq, ctx->extent_page, bs_md_page_to_lba(blob->bs, *extent_page),
+			      bs_byte_to_lba(blob->bs, SPDK_BS_PAGE_SIZE),
+			      blob_reclaim_write_extent_pages, ctx);
+}
+
+static void
+blob_reclaim_verify_cpl(spdk_bs_sequence_t *seq, void *cb_arg, int bserrno)
+{
+	struct spdk_blob_reclaim_ctx *ctx = cb_arg;
+	uint32_t i = ctx->verify_idx;
+
+	if (bserrno != 0) {
+		ctx->bserrno = bserrno;
+		blob_unfreeze_io(ctx->blob, blob_reclaim_unfreeze_cpl, ctx);
+		return;
+	}
+
+	if (spdk_mem_all_zero(ctx->buf, ctx->blob->bs->cluster_sz)) {
+		ctx->clusters[ctx->num_released] = ctx->clusters[i];
+		ctx->lbas[ctx->num_released] = ctx->lbas[i];
+		ctx->num_released++;
+	}
+
+	ctx->verify_idx++;
+	blob_reclaim_verify_next(ctx);
+}
+
+static void
+blob_reclaim_verify_next(struct spdk_blob_reclaim_ctx *ctx)
+{
+	struct spdk_blob *blob = ctx->blob;
+	uint32_t i;
+
+	for (; ctx->verify_idx < ctx->num_candidates; ctx->verify_idx++) {
+		i = ctx->verify_idx;
+		/* Skip clusters that were rewritten since they were found zeroed */
+		if (blob->active.clusters[ctx->clusters[i]] != ctx->lbas[i]) {
+			continue;
+		}
+
+		bs_sequence_read_dev(ctx->seq, ctx->buf, ctx->lbas[i], bs_cluster_to_lba(blob->bs, 1),
+				     blob_reclaim_verify_cpl, ctx);
+		return;
+	}
+
+	if (ctx->num_released == 0) {
+		blob_unfreeze_io(blob, blob_reclaim_unfreeze_cpl, ctx);
+		return;
+	}
+
+	for (i = 0; i < ctx->num_released; i++) {
+		blob->active.clusters[ctx->clusters[i]] = 0;
+	}
+	blob->state = SPDK_BLOB_STATE_DIRTY;
+
+	/* Extent pages are not rewritten by blob_persist() unless the blob is resized */
+	ctx->next_released = 0;
+	bs_mark_dirty(ctx->seq, blob->bs, blob_reclaim_write_extent_pages, ctx);
+}
+
+static void
+blob_reclaim_check_channel(struct spdk_io_channel_iter *i)
+{
+	struct spdk_io_channel *_ch = spdk_io_channel_iter_get_channel(i);
+	struct spdk_bs_channel *ch = spdk_io_channel_get_ctx(_ch);
+	struct spdk_blob_reclaim_ctx *ctx = spdk_io_channel_iter_get_ctx(i);
+	uint32_t j;
+
+	for (j = 0; j < ctx->blob->bs->max_channel_ops; j++) {
+		if (ch->req_mem[j].io_blob == ctx->blob) {
+			ctx->io_busy = true;
+			break;
+		}
+	}
+
+	spdk_for_each_channel_continue(i, 0);
+}
+
+static void
+blob_reclaim_check_channels_cpl(struct spdk_io_channel_iter *i, int status)
+{
+	struct spdk_blob_reclaim_ctx *ctx = spdk_io_channel_iter_get_ctx(i);
+
+	if (ctx->io_busy) {
+		/* I/O submitted before the freeze may still target the candidates,
+		 * wait until it is done. */
+		ctx->io_busy = false;
+		spdk_for_each_channel(ctx->blob->bs, blob_reclaim_check_channel, ctx,
+				      blob_reclaim_check_channels_cpl);
+		return;
+	}
+
+	ctx->verify_idx = 0;
+	ctx->num_released = 0;
+	blob_reclaim_verify_next(ctx);
+}
+
+static void
+blob_reclaim_freeze_cpl(void *cb_arg, int bserrno)
+{
+	struct spdk_blob_reclaim_ctx *ctx = cb_arg;
+
+	if (bserrno != 0) {
+		blob_reclaim_finish(ctx, bserrno);
+		return;
+	}
+
+	ctx->io_busy = false;
+	spdk_for_each_channel(ctx->blob->bs, blob_reclaim_check_channel, ctx,
+			      blob_reclaim_check_channels_cpl);
+}
+
+static void
+blob_reclaim_scan_cpl(spdk_bs_sequence_t *seq, void *cb_arg, int bserrno)
+{
+	struct spdk_blob_reclaim_ctx *ctx = cb_arg;
+	struct spdk_blob *blob = ctx->blob;
+
+	if (bserrno != 0) {
+		blob_reclaim_finish(ctx, bserrno);
+		return;
+	}
+
+	if (spdk_mem_all_zero(ctx->buf, blob->bs->cluster_sz)) {
+		ctx->clusters[ctx->num_candidates] = ctx->cur_cluster;
+		ctx->lbas[ctx->num_candidates] = blob->active.clusters[ctx->cur_cluster];
+		ctx->num_candidates++;
+	}
+
+	blob_reclaim_scan_next(ctx);
+}
+
+static void
+blob_reclaim_scan_next(struct spdk_blob_reclaim_ctx *ctx)
+{
+	struct spdk_blob *blob = ctx->blob;
+	struct spdk_blob_store *bs = blob->bs;
+	uint64_t i;
+
+	/* Find candidates without freezing I/O, reading only the clusters that
+	 * would read as zeroes once deallocated. */
+	while (ctx->num_candidates < BLOB_RECLAIM_BATCH && ctx->next_cluster < ctx->end_cluster) {
+		i = ctx->next_cluster++;
+		if (blob->active.clusters[i] == 0) {
+			continue;
+		}
+		if (!blob->back_bs_dev->is_zeroes(blob->back_bs_dev,
+						  bs_dev_page_to_lba(blob->back_bs_dev, i * bs->pages_per_cluster),
+						  bs_dev_byte_to_lba(blob->back_bs_dev, bs->cluster_sz))) {
+			continue;
+		}
+
+		ctx->cur_cluster = i;
+		bs_sequence_read_dev(ctx->seq, ctx->buf, blob->active.clusters[i], bs_cluster_to_lba(bs, 1),
+				     blob_reclaim_scan_cpl, ctx);
+		return;
+	}
+
+	if (ctx->num_candidates == 0) {
+		blob_reclaim_finish(ctx, 0);
+		return;
+	}
+
+	blob_freeze_io(blob, blob_reclaim_freeze_cpl, ctx);
+}
+
+void
+spdk_blob_reclaim_zeroed_clusters(struct spdk_blob *blob, uint64_t cluster_offset,
+				  uint64_t cluster_count,
+				  spdk_blob_op_with_clusters_complete cb_fn, void *cb_arg)
+{
+	struct spdk_blob_reclaim_ctx *ctx;
+	struct spdk_bs_cpl cpl;
+
+	blob_verify_md_op(blob);
+
+	SPDK_DEBUGLOG(blob, "Reclaiming zeroed clusters %" PRIu64 "-%" PRIu64 " of blob 0x%" PRIx64 "\n",
+		      cluster_offset, cluster_offset + cluster_count, blob->id);
+
+	if (blob->md_ro || blob->data_ro) {
+		cb_fn(cb_arg, 0, -EPERM);
+		return;
+	}
+
+	if (!spdk_blob_is_thin_provisioned(blob) ||
+	    cluster_offset + cluster_count > blob->active.num_clusters) {
+		cb_fn(cb_arg, 0, -EINVAL);
+		return;
+	}
+
+	if (blob->locked_operation_in_progress) {
+		cb_fn(cb_arg, 0, -EBUSY);
+		return;
+	}
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (!ctx) {
+		cb_fn(cb_arg, 0, -ENOMEM);
+		return;
+	}
+
+	ctx->buf = spdk_malloc(blob->bs->cluster_sz, blob->back_bs_dev->blocklen, NULL,
+			       SPDK_ENV_SOCKET_ID_ANY, SPDK_MALLOC_DMA);
+	if (!ctx->buf) {
+		free(ctx);
+		cb_fn(cb_arg, 0, -ENOMEM);
+		return;
+	}
+
+	if (blob->use_extent_table) {
+		ctx->extent_page = spdk_zmalloc(SPDK_BS_PAGE_SIZE, 0, NULL, SPDK_ENV_SOCKET_ID_ANY,
+						SPDK_MALLOC_DMA);
+		if (!ctx->extent_page) {
+			spdk_free(ctx->buf);
+			free(ctx);
+			cb_fn(cb_arg, 0, -ENOMEM);
+			return;
+		}
+	}
+
+	ctx->blob = blob;
+	ctx->next_cluster = cluster_offset;
+	ctx->end_cluster = cluster_offset + cluster_count;
+	ctx->cb_fn = cb_fn;
+	ctx->cb_arg = cb_arg;
+
+	cpl.type = SPDK_BS_CPL_TYPE_BLOB_BASIC;
+	cpl.u.blob_basic.cb_fn = blob_reclaim_done;
+	cpl.u.blob_basic.cb_arg = ctx;
+
+	ctx->seq = bs_sequence_start(blob->bs->md_channel, &cpl);
+	if (!ctx->seq) {
+		spdk_free(ctx->extent_page);
+		spdk_free(ctx->buf);
+		free(ctx);
+		cb_fn(cb_arg, 0, -ENOMEM);
+		return;
+	}
+
+	blob->locked_operation_in_progress = true;
+	blob_reclaim_scan_next(ctx);
+}
+
+/* END spdk_blob_reclaim_zeroed_clusters */
+
 
 /* START spdk_bs_delete_blob */
 
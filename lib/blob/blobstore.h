@@ -185,9 +185,30 @@ struct spdk_blob_store {
 	RB_HEAD(spdk_blob_tree, spdk_blob) open_blobs;
 	TAILQ_HEAD(, spdk_blob_list)	snapshots;
 
+	/* Per-channel caches of claimed but not yet assigned clusters */
+	TAILQ_HEAD(, spdk_bs_cluster_magazine) cluster_magazines;	/* Protected by used_lock */
+	uint64_t			num_cached_clusters;	/* Updated atomically */
+
 	bool				clean;
 };
 
+/* Number of clusters a channel claims from the blobstore in one go. */
+#define SPDK_BS_CLUSTER_MAGAZINE_SIZE 16
+
+/*
+ * Clusters claimed from used_clusters in bulk, so that allocating a cluster for a
+ * thin provisioned blob does not have to take used_lock every time.  The clusters
+ * are kept in ascending order.  The lock is taken by the owning channel for every
+ * access and by other threads (with used_lock already held) only when they need
+ * the cached clusters back.
+ */
+struct spdk_bs_cluster_magazine {
+	struct spdk_spinlock		lock;
+	uint32_t			count;
+	uint32_t			clusters[SPDK_BS_CLUSTER_MAGAZINE_SIZE];
+	TAILQ_ENTRY(spdk_bs_cluster_magazine) link;
+};
+
 struct spdk_bs_channel {
 	struct spdk_bs_request_set	*req_mem;
 	TAILQ_HEAD(, spdk_bs_request_set) reqs;
@@ -200,6 +221,8 @@ struct spdk_bs_channel {
 	/* This page is only used during insert of a new cluster. */
 	struct spdk_blob_md_page	*new_cluster_page;
 
+	struct spdk_bs_cluster_magazine	cluster_magazine;
+
 	TAILQ_HEAD(, spdk_bs_request_set) need_cluster_alloc;
 	TAILQ_HEAD(, spdk_bs_request_set) queued_io;
 };
@@ -58,6 +58,7 @@ bs_request_set_complete(struct spdk_bs_request_set *set)
 	struct spdk_bs_cpl cpl = set->cpl;
 	int bserrno = set->bserrno;
 
+	set->io_blob = NULL;
 	TAILQ_INSERT_TAIL(&set->channel->reqs, set, link);
 
 	bs_call_cpl(&cpl, bserrno);
@@ -95,6 +96,7 @@ bs_sequence_start(struct spdk_io_channel *_channel,
 	set->cb_args.cb_arg = set;
 	set->cb_args.channel = channel->dev_channel;
 	set->ext_io_opts = NULL;
+	set->io_blob = NULL;
 
 	return (spdk_bs_sequence_t *)set;
 }
@@ -319,6 +321,7 @@ bs_batch_open(struct spdk_io_channel *_channel,
 	set->cb_args.cb_fn = bs_batch_completion;
 	set->cb_args.cb_arg = set;
 	set->cb_args.channel = channel->dev_channel;
+	set->io_blob = NULL;
 
 	return (spdk_bs_batch_t *)set;
 }
@@ -446,6 +449,7 @@ bs_user_op_alloc(struct spdk_io_channel *_channel, struct spdk_bs_cpl *cpl,
 	set->cpl = *cpl;
 	set->channel = channel;
 	set->ext_io_opts = NULL;
+	set->io_blob = NULL;
 
 	args = &set->u.user_op;
 
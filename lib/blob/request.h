@@ -114,6 +114,8 @@ struct spdk_bs_request_set {
 	} u;
 	/* Pointer to ext_io_opts passed by the user */
 	struct spdk_blob_ext_io_opts *ext_io_opts;
+	/* Blob targeted by the user I/O this set is executing, NULL for internal I/O */
+	struct spdk_blob	*io_blob;
 	TAILQ_ENTRY(spdk_bs_request_set) link;
 };
 
@@ -130,6 +130,8 @@ static const struct option g_cmdline_options[] = {
 	{"vfio-vf-token",		required_argument,	NULL, ENV_VF_TOKEN_OPT_IDX},
 #define MSG_MEMPOOL_SIZE_OPT_IDX 270
 	{"msg-mempool-size",		required_argument,	NULL, MSG_MEMPOOL_SIZE_OPT_IDX},
+#define NUM_TRACE_THREADS_OPT_IDX	271
+	{"num-trace-threads",		required_argument,	NULL, NUM_TRACE_THREADS_OPT_IDX},
 };
 
 static void
@@ -370,7 +372,7 @@ app_setup_trace(struct spdk_app_opts *opts)
 		snprintf(shm_name, sizeof(shm_name), "/%s_trace.pid%d", opts->name, (int)getpid());
 	}
 
-	if (spdk_trace_init(shm_name, opts->num_entries) != 0) {
+	if (spdk_trace_init(shm_name, opts->num_entries, opts->num_trace_threads) != 0) {
 		return -1;
 	}
 
@@ -523,10 +525,11 @@ app_copy_opts(struct spdk_app_opts *opts, struct spdk_app_opts *opts_user, size_
 	SET_FIELD(msg_mempool_size);
 	SET_FIELD(rpc_allowlist);
 	SET_FIELD(vf_token);
+	SET_FIELD(num_trace_threads);
 
 	/* You should not remove this statement, but need to update the assert statement
 	 * if you add a new field, and also add a corresponding SET_FIELD statement */
-	SPDK_STATIC_ASSERT(sizeof(struct spdk_app_opts) == 216, "Incorrect size");
+	SPDK_STATIC_ASSERT(sizeof(struct spdk_app_opts) == 224, "Incorrect size");
 
 #undef SET_FIELD
 }
@@ -879,6 +882,7 @@ usage(void (*app_usage)(void))
 	printf("     --base-virtaddr <addr>      the base virtual address for DPDK (default: 0x200000000000)\n");
 	printf("     --num-trace-entries <num>   number of trace entries for each core, must be power of 2, setting 0 to disable trace (default %d)\n",
 	       SPDK_APP_DEFAULT_NUM_TRACE_ENTRIES);
+	printf("     --num-trace-threads <num>   number of trace histories for threads not bound to any core (default 0)\n");
 	printf("     --rpcs-allowed	   comma-separated list of permitted RPCS\n");
 	printf("     --env-context         Opaque context for use of the env implementation\n");
 	printf("     --vfio-vf-token       VF token (UUID) shared between SR-IOV PF and VFs for vfio_pci driver\n");
@@ -1135,6 +1139,15 @@ spdk_app_parse_args(int argc, char **argv, struct spdk_app_opts *opts,
 				goto out;
 			}
 			break;
+		case NUM_TRACE_THREADS_OPT_IDX:
+			tmp = spdk_strtol(optarg, 10);
+			if (tmp < 0) {
+				SPDK_ERRLOG("Invalid num-trace-threads %s\n", optarg);
+				usage(app_usage);
+				goto out;
+			}
+			opts->num_trace_threads = (uint32_t)tmp;
+			break;
 		case MAX_REACTOR_DELAY_OPT_IDX:
 			SPDK_ERRLOG("Deprecation warning: The maximum allowed latency parameter is no longer supported.\n");
 			break;
@@ -13,6 +13,7 @@
 #include "ftl_io.h"
 #include "ftl_core.h"
 #include "ftl_debug.h"
+#include "ftl_gc_policy.h"
 #include "ftl_internal.h"
 #include "utils/ftl_md.h"
 #include "utils/ftl_defs.h"
@@ -470,13 +471,13 @@ is_band_relocateable(struct ftl_band *band)
 }
 
 static void
-get_band_phys_info(struct spdk_ftl_dev *dev, uint64_t phys_id,
-		   double *invalidity, double *wr_cnt)
+get_band_phys_info(struct spdk_ftl_dev *dev, uint64_t phys_id, struct ftl_gc_candidate *cand)
 {
 	struct ftl_band *band;
 	uint64_t band_id = phys_id * dev->num_logical_bands_in_physical;
 
-	*wr_cnt = *invalidity = 0.0L;
+	cand->phys_id = phys_id;
+	cand->wr_cnt = cand->invalidity = cand->age = 0.0L;
 	for (; band_id < ftl_get_num_bands(dev); band_id++) {
 		band = &dev->bands[band_id];
 
@@ -484,45 +485,21 @@ get_band_phys_info(struct spdk_ftl_dev *dev, uint64_t phys_id,
 			break;
 		}
 
-		*wr_cnt += band->md->wr_cnt;
+		cand->wr_cnt += band->md->wr_cnt;
 
 		if (!is_band_relocateable(band)) {
 			continue;
 		}
 
-		*invalidity += _band_invalidity(band);
-	}
-
-	*invalidity /= dev->num_logical_bands_in_physical;
-	*wr_cnt /= dev->num_logical_bands_in_physical;
-}
-
-static bool
-band_cmp(double a_invalidity, double a_wr_cnt,
-	 double b_invalidity, double b_wr_cnt,
-	 uint64_t a_id, uint64_t b_id)
-{
-	assert(a_id != FTL_BAND_PHYS_ID_INVALID);
-	assert(b_id != FTL_BAND_PHYS_ID_INVALID);
-	double diff = a_invalidity - b_invalidity;
-	if (diff < 0.0L) {
-		diff *= -1.0L;
-	}
-
-	/* Use the following metrics for picking bands for GC (in order):
-	 * - relative invalidity
-	 * - if invalidity is similar (within 10% points), then their write counts (how many times band was written to)
-	 * - if write count is equal, then pick based on their placement on base device (lower LBAs win)
-	 */
-	if (diff > 0.1L) {
-		return a_invalidity > b_invalidity;
-	}
-
-	if (a_wr_cnt != b_wr_cnt) {
-		return a_wr_cnt < b_wr_cnt;
+		cand->invalidity += _band_invalidity(band);
+		if (dev->sb->seq_id > band->md->close_seq_id) {
+			cand->age += dev->sb->seq_id - band->md->close_seq_id;
+		}
 	}
 
-	return a_id < b_id;
+	cand->invalidity /= dev->num_logical_bands_in_physical;
+	cand->wr_cnt /= dev->num_logical_bands_in_physical;
+	cand->age /= dev->num_logical_bands_in_physical;
 }
 
 static void
@@ -570,9 +547,9 @@ ftl_band_reset_gc_iter(struct spdk_ftl_dev *dev)
 struct ftl_band *
 ftl_band_search_next_to_reloc(struct spdk_ftl_dev *dev)
 {
-	double invalidity, max_invalidity = 0.0L;
-	double wr_cnt, max_wr_cnt = 0.0L;
-	uint64_t phys_id = FTL_BAND_PHYS_ID_INVALID;
+	const struct ftl_gc_policy *policy = ftl_gc_policy_get(dev->conf.gc_policy);
+	struct ftl_gc_candidate cand, best = { .phys_id = FTL_BAND_PHYS_ID_INVALID };
+	uint64_t phys_id;
 	struct ftl_band *band;
 	uint64_t i, band_count;
 	uint64_t phys_count;
@@ -604,22 +581,17 @@ ftl_band_search_next_to_reloc(struct spdk_ftl_dev *dev)
 		band = &dev->bands[i];
 
 		/* Calculate entire band physical group invalidity */
-		get_band_phys_info(dev, band->phys_id, &invalidity, &wr_cnt);
-
-		if (invalidity != 0.0L) {
-			if (phys_id == FTL_BAND_PHYS_ID_INVALID ||
-			    band_cmp(invalidity, wr_cnt, max_invalidity, max_wr_cnt,
-				     band->phys_id, phys_id)) {
-				max_wr_cnt = wr_cnt;
-				phys_id = band->phys_id;
-
-				if (invalidity > max_invalidity) {
-					max_invalidity = invalidity;
-				}
+		get_band_phys_info(dev, band->phys_id, &cand);
+
+		if (cand.invalidity != 0.0L) {
+			assert(cand.phys_id != FTL_BAND_PHYS_ID_INVALID);
+			if (best.phys_id == FTL_BAND_PHYS_ID_INVALID || policy->cmp(&cand, &best)) {
+				best = cand;
 			}
 		}
 	}
 
+	phys_id = best.phys_id;
 	if (FTL_BAND_PHYS_ID_INVALID != phys_id) {
 		FTL_DEBUGLOG(dev, "Band physical id %"PRIu64" to GC\n", phys_id);
 		dev->sb_shm->gc_info.is_valid = 0;
@@ -11,6 +11,30 @@
 #include "ftl_band.h"
 #include "ftl_internal.h"
 
+static void
+write_rq_stream_stats(struct ftl_rq *rq)
+{
+	struct spdk_ftl_dev *dev = rq->dev;
+	enum ftl_stats_stream stream;
+	uint64_t i, num_blocks = 0;
+
+	if (!rq->owner.compaction) {
+		stream = FTL_STATS_STREAM_GC;
+	} else if (rq->io.band->md->type == FTL_BAND_TYPE_GC) {
+		stream = FTL_STATS_STREAM_CMP_COLD;
+	} else {
+		stream = FTL_STATS_STREAM_CMP;
+	}
+
+	for (i = 0; i < rq->num_blocks; ++i) {
+		if (rq->entries[i].lba != FTL_LBA_INVALID) {
+			num_blocks++;
+		}
+	}
+
+	dev->stats.stream_blocks[stream] += num_blocks;
+}
+
 static void
 write_rq_end(struct spdk_bdev_io *bdev_io, bool success, void *arg)
 {
@@ -20,6 +44,10 @@ write_rq_end(struct spdk_bdev_io *bdev_io, bool success, void *arg)
 	ftl_stats_bdev_io_completed(dev, rq->owner.compaction ? FTL_STATS_TYPE_CMP : FTL_STATS_TYPE_GC,
 				    bdev_io);
 
+	if (spdk_likely(success)) {
+		write_rq_stream_stats(rq);
+	}
+
 	rq->success = success;
 
 	ftl_p2l_ckpt_issue(rq);
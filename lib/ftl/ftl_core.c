@@ -17,6 +17,7 @@
 #include "ftl_io.h"
 #include "ftl_debug.h"
 #include "ftl_internal.h"
+#include "ftl_nv_cache_io.h"
 #include "mngt/ftl_mngt.h"
 
 
@@ -322,6 +323,19 @@ ftl_io_pin_cb(struct spdk_ftl_dev *dev, int status, struct ftl_l2p_pin_ctx *pin_
 	}
 
 	io->flags |= FTL_IO_PINNED;
+
+	if (dev->conf.user_io_offload) {
+		size_t i;
+
+		/* Resolve the whole mapping here, the IO channel's thread only transfers the data */
+		for (i = 0; i < io->num_blocks; ++i) {
+			io->map[i] = ftl_l2p_get(dev, ftl_io_get_lba(io, i));
+		}
+
+		ftl_io_xfer_submit(io);
+		return;
+	}
+
 	ftl_submit_read(io);
 }
 
@@ -512,7 +526,195 @@ spdk_ftl_unmap(struct spdk_ftl_dev *dev, struct ftl_io *io, struct spdk_io_chann
 	return rc;
 }
 
+void
+ftl_io_xfer_submit(struct ftl_io *io)
+{
+	struct ftl_io_channel *ioch = ftl_io_channel_get_ctx(io->ioch);
+	size_t result  __attribute__((unused));
+
+	/* Account the transfer as a single request, so that the shutdown waits for it */
+	io->dev->num_inflight++;
+
+	result = spdk_ring_enqueue(ioch->xfer_sq, (void **)&io, 1, NULL);
+	assert(result != 0);
+}
+
+void
+ftl_io_xfer_done(struct ftl_io *io)
+{
+	struct ftl_io_channel *ioch = ftl_io_channel_get_ctx(io->ioch);
+	size_t result  __attribute__((unused));
+
+	result = spdk_ring_enqueue(ioch->xfer_cq, (void **)&io, 1, NULL);
+	assert(result != 0);
+}
+
+static void
+ftl_xfer_read_cb(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct ftl_io *io = cb_arg;
+
+	ftl_stats_group_bdev_io_completed(&io->xfer_stats, bdev_io);
+
+	if (spdk_unlikely(!success)) {
+		io->status = -EIO;
+	}
+
+	ftl_trace_completion(io->dev, io, FTL_TRACE_COMPLETION_DISK);
+
+	assert(io->req_cnt > 0);
+	io->req_cnt--;
+	if (ftl_io_done(io)) {
+		ftl_io_xfer_done(io);
+	}
+
+	spdk_bdev_free_io(bdev_io);
+}
+
+static void ftl_xfer_read(struct ftl_io *io);
+
+static void
+_ftl_xfer_read(void *_io)
+{
+	struct ftl_io *io = _io;
+
+	ftl_xfer_read(io);
+}
+
+/*
+ * Reads the data of a pinned user IO on the thread of its IO channel. The mapping has been
+ * resolved by the core thread already (io->map), so no FTL metadata is accessed here.
+ */
+static void
+ftl_xfer_read(struct ftl_io *io)
+{
+	struct ftl_io_channel *ioch = ftl_io_channel_get_ctx(io->ioch);
+	struct spdk_ftl_dev *dev = io->dev;
+	struct spdk_bdev_desc *desc;
+	struct spdk_io_channel *ch;
+	ftl_addr addr, next_addr;
+	size_t num_blocks;
+	bool addr_cached;
+	int rc;
+
+	while (io->pos < io->num_blocks) {
+		addr = io->map[io->pos];
+
+		/* User LBA doesn't hold valid data (trimmed or never written to), fill with 0 and skip this block */
+		if (addr == FTL_ADDR_INVALID) {
+			memset(ftl_io_iovec_addr(io), 0, FTL_BLOCK_SIZE);
+			ftl_io_advance(io, 1);
+			continue;
+		}
+
+		addr_cached = ftl_addr_in_nvc(dev, addr);
+
+		for (num_blocks = 1; num_blocks < ftl_io_iovec_len_left(io); ++num_blocks) {
+			next_addr = io->map[io->pos + num_blocks];
+
+			if (next_addr == FTL_ADDR_INVALID ||
+			    addr_cached != ftl_addr_in_nvc(dev, next_addr) ||
+			    addr + num_blocks != next_addr) {
+				break;
+			}
+		}
+
+		ftl_trace_submission(dev, io, addr, num_blocks);
+
+		if (addr_cached) {
+			desc = dev->nv_cache.bdev_desc;
+			ch = ioch->cache_ioch;
+			rc = ftl_nv_cache_bdev_read_blocks_with_md(dev, desc, ch,
+					ftl_io_iovec_addr(io), NULL,
+					ftl_addr_to_nvc_offset(dev, addr), num_blocks,
+					ftl_xfer_read_cb, io);
+		} else {
+			desc = dev->base_bdev_desc;
+			ch = ioch->base_ioch;
+			rc = spdk_bdev_read_blocks(desc, ch, ftl_io_iovec_addr(io),
+						   addr, num_blocks, ftl_xfer_read_cb, io);
+		}
+
+		if (spdk_unlikely(rc)) {
+			if (rc == -ENOMEM) {
+				struct spdk_bdev *bdev = spdk_bdev_desc_get_bdev(desc);
+
+				io->bdev_io_wait.bdev = bdev;
+				io->bdev_io_wait.cb_fn = _ftl_xfer_read;
+				io->bdev_io_wait.cb_arg = io;
+				spdk_bdev_queue_io_wait(bdev, ch, &io->bdev_io_wait);
+				return;
+			} else {
+				ftl_abort();
+			}
+		}
+
+		io->req_cnt++;
+		ftl_io_advance(io, num_blocks);
+	}
+
+	/* If we didn't have to read anything from the device, */
+	/* return the request right away */
+	if (ftl_io_done(io)) {
+		ftl_io_xfer_done(io);
+	}
+}
+
+static void
+ftl_io_xfer_complete(struct spdk_ftl_dev *dev, struct ftl_io *io)
+{
+	struct ftl_stats_entry *stats_entry = &dev->stats.entries[FTL_STATS_TYPE_USER];
+	struct ftl_stats_group *stats_group;
+
+	assert(dev->num_inflight > 0);
+	dev->num_inflight--;
+
+	stats_group = io->type == FTL_IO_READ ? &stats_entry->read : &stats_entry->write;
+	stats_group->ios += io->xfer_stats.ios;
+	stats_group->blocks += io->xfer_stats.blocks;
+	stats_group->errors.media += io->xfer_stats.errors.media;
+	stats_group->errors.crc += io->xfer_stats.errors.crc;
+	stats_group->errors.other += io->xfer_stats.errors.other;
+	memset(&io->xfer_stats, 0, sizeof(io->xfer_stats));
+
+	switch (io->type) {
+	case FTL_IO_READ:
+		ftl_io_xfer_read_complete(io);
+		break;
+	case FTL_IO_WRITE:
+		ftl_nv_cache_write_complete(io);
+		break;
+	default:
+		assert(0);
+		break;
+	}
+}
+
 #define FTL_IO_QUEUE_BATCH 16
+static void
+ftl_io_channel_process_xfer(struct ftl_io_channel *ch)
+{
+	void *ios[FTL_IO_QUEUE_BATCH];
+	uint64_t i, count;
+
+	count = spdk_ring_dequeue(ch->xfer_sq, ios, FTL_IO_QUEUE_BATCH);
+	for (i = 0; i < count; i++) {
+		struct ftl_io *io = ios[i];
+
+		switch (io->type) {
+		case FTL_IO_READ:
+			ftl_xfer_read(io);
+			break;
+		case FTL_IO_WRITE:
+			ftl_nv_cache_xfer_write(io);
+			break;
+		default:
+			assert(0);
+			break;
+		}
+	}
+}
+
 int
 ftl_io_channel_poll(void *arg)
 {
@@ -520,6 +722,10 @@ ftl_io_channel_poll(void *arg)
 	void *ios[FTL_IO_QUEUE_BATCH];
 	uint64_t i, count;
 
+	if (ch->xfer_sq) {
+		ftl_io_channel_process_xfer(ch);
+	}
+
 	count = spdk_ring_dequeue(ch->cq, ios, FTL_IO_QUEUE_BATCH);
 	if (count == 0) {
 		return SPDK_POLLER_IDLE;
@@ -539,6 +745,13 @@ ftl_process_io_channel(struct spdk_ftl_dev *dev, struct ftl_io_channel *ioch)
 	void *ios[FTL_IO_QUEUE_BATCH];
 	size_t count, i;
 
+	if (ioch->xfer_cq) {
+		count = spdk_ring_dequeue(ioch->xfer_cq, ios, FTL_IO_QUEUE_BATCH);
+		for (i = 0; i < count; i++) {
+			ftl_io_xfer_complete(dev, ios[i]);
+		}
+	}
+
 	count = spdk_ring_dequeue(ioch->sq, ios, FTL_IO_QUEUE_BATCH);
 	if (count == 0) {
 		return;
@@ -762,9 +975,6 @@ ftl_stats_bdev_io_completed(struct spdk_ftl_dev *dev, enum ftl_stats_type type,
 {
 	struct ftl_stats_entry *stats_entry = &dev->stats.entries[type];
 	struct ftl_stats_group *stats_group;
-	uint32_t cdw0;
-	int sct;
-	int sc;
 
 	switch (bdev_io->type) {
 	case SPDK_BDEV_IO_TYPE_READ:
@@ -778,6 +988,17 @@ ftl_stats_bdev_io_completed(struct spdk_ftl_dev *dev, enum ftl_stats_type type,
 		return;
 	}
 
+	ftl_stats_group_bdev_io_completed(stats_group, bdev_io);
+}
+
+void
+ftl_stats_group_bdev_io_completed(struct ftl_stats_group *stats_group,
+				  struct spdk_bdev_io *bdev_io)
+{
+	uint32_t cdw0;
+	int sct;
+	int sc;
+
 	spdk_bdev_io_get_nvme_status(bdev_io, &cdw0, &sct, &sc);
 
 	if (sct == SPDK_NVME_SCT_GENERIC && sc == SPDK_NVME_SC_SUCCESS) {
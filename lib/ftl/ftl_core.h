@@ -138,6 +138,9 @@ struct spdk_ftl_dev {
 	/* Manages data relocation */
 	struct ftl_reloc		*reloc;
 
+	/* Tracks write frequency of user LBA ranges */
+	struct ftl_heat			*heat;
+
 	/* Thread on which the poller is running */
 	struct spdk_thread		*core_thread;
 
@@ -209,6 +212,15 @@ void ftl_recover_max_seq(struct spdk_ftl_dev *dev);
 void ftl_stats_bdev_io_completed(struct spdk_ftl_dev *dev, enum ftl_stats_type type,
 				 struct spdk_bdev_io *bdev_io);
 
+void ftl_stats_group_bdev_io_completed(struct ftl_stats_group *stats_group,
+				       struct spdk_bdev_io *bdev_io);
+
+/* Hand the data transfer of a pinned user IO over to its IO channel's thread */
+void ftl_io_xfer_submit(struct ftl_io *io);
+
+/* Return a user IO with a finished data transfer back to the core thread */
+void ftl_io_xfer_done(struct ftl_io *io);
+
 void ftl_stats_crc_error(struct spdk_ftl_dev *dev, enum ftl_stats_type type);
 
 int ftl_unmap(struct spdk_ftl_dev *dev, struct ftl_io *io, struct spdk_io_channel *ch,
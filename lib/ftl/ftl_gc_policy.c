@@ -0,0 +1,114 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (C) 2023 Intel Corporation.
+ *   All rights reserved.
+ */
+
+#include "spdk/stdinc.h"
+#include "spdk/util.h"
+
+#include "ftl_gc_policy.h"
+
+static bool
+greedy_cmp(const struct ftl_gc_candidate *a, const struct ftl_gc_candidate *b)
+{
+	double diff = a->invalidity - b->invalidity;
+	if (diff < 0.0L) {
+		diff *= -1.0L;
+	}
+
+	/* Use the following metrics for picking bands for GC (in order):
+	 * - relative invalidity
+	 * - if invalidity is similar (within 10% points), then their write counts (how many times band was written to)
+	 * - if write count is equal, then pick based on their placement on base device (lower LBAs win)
+	 */
+	if (diff > 0.1L) {
+		return a->invalidity > b->invalidity;
+	}
+
+	if (a->wr_cnt != b->wr_cnt) {
+		return a->wr_cnt < b->wr_cnt;
+	}
+
+	return a->phys_id < b->phys_id;
+}
+
+static double
+cost_benefit_score(const struct ftl_gc_candidate *c)
+{
+	double utilization = 1.0L - c->invalidity;
+
+	/*
+	 * The benefit is the amount of space reclaimed, weighted by how long the data has
+	 * stayed unmodified - older bands are less likely to get invalidated any further, so
+	 * there's no point waiting for them. The cost is reading the band's valid data and
+	 * writing it back (1 + u).
+	 */
+	return c->invalidity * (c->age + 1.0L) / (1.0L + utilization);
+}
+
+static bool
+cost_benefit_cmp(const struct ftl_gc_candidate *a, const struct ftl_gc_candidate *b)
+{
+	double a_score = cost_benefit_score(a);
+	double b_score = cost_benefit_score(b);
+
+	if (a_score != b_score) {
+		return a_score > b_score;
+	}
+
+	return a->phys_id < b->phys_id;
+}
+
+static const struct ftl_gc_policy g_gc_policies[] = {
+	[SPDK_FTL_GC_POLICY_GREEDY] = {
+		.name = "greedy",
+		.cmp = greedy_cmp,
+	},
+	[SPDK_FTL_GC_POLICY_COST_BENEFIT] = {
+		.name = "cost_benefit",
+		.cmp = cost_benefit_cmp,
+	},
+};
+SPDK_STATIC_ASSERT(SPDK_COUNTOF(g_gc_policies) == SPDK_FTL_GC_POLICY_MAX,
+		   "Missing GC policy definition");
+
+const struct ftl_gc_policy *
+ftl_gc_policy_get(uint32_t type)
+{
+	if (type >= SPDK_COUNTOF(g_gc_policies)) {
+		return NULL;
+	}
+
+	return &g_gc_policies[type];
+}
+
+const struct ftl_gc_policy *
+ftl_gc_policy_get_by_name(const char *name, uint32_t *type)
+{
+	uint32_t i;
+
+	for (i = 0; i < SPDK_COUNTOF(g_gc_policies); ++i) {
+		if (!strcmp(g_gc_policies[i].name, name)) {
+			if (type) {
+				*type = i;
+			}
+			return &g_gc_policies[i];
+		}
+	}
+
+	return NULL;
+}
+
+const char *
+spdk_ftl_gc_policy_str(uint32_t gc_policy)
+{
+	const struct ftl_gc_policy *policy = ftl_gc_policy_get(gc_policy);
+
+	return policy ? policy->name : NULL;
+}
+
+int
+spdk_ftl_gc_policy_parse(uint32_t *gc_policy, const char *str)
+{
+	return ftl_gc_policy_get_by_name(str, gc_policy) ? 0 : -EINVAL;
+}
@@ -0,0 +1,41 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (C) 2023 Intel Corporation.
+ *   All rights reserved.
+ */
+
+#ifndef FTL_GC_POLICY_H
+#define FTL_GC_POLICY_H
+
+#include "spdk/stdinc.h"
+#include "spdk/ftl.h"
+
+/* Summary of a band physical group considered for relocation */
+struct ftl_gc_candidate {
+	/* Physical id of the band group */
+	uint64_t	phys_id;
+
+	/* Fraction of invalid blocks in the group (0.0 - 1.0) */
+	double		invalidity;
+
+	/* Average number of times the group's bands were written */
+	double		wr_cnt;
+
+	/* Average number of sequence ids issued since the group's bands were closed */
+	double		age;
+};
+
+struct ftl_gc_policy {
+	/* Policy name, as accepted by the bdev_ftl_create RPC */
+	const char	*name;
+
+	/* Returns true if candidate a should be relocated before candidate b */
+	bool (*cmp)(const struct ftl_gc_candidate *a, const struct ftl_gc_candidate *b);
+};
+
+/* Returns the policy for given spdk_ftl_gc_policy value or NULL if it's unknown */
+const struct ftl_gc_policy *ftl_gc_policy_get(uint32_t type);
+
+/* Returns the policy with given name or NULL if there's no such policy */
+const struct ftl_gc_policy *ftl_gc_policy_get_by_name(const char *name, uint32_t *type);
+
+#endif /* FTL_GC_POLICY_H */
@@ -0,0 +1,122 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (C) 2023 Intel Corporation.
+ *   All rights reserved.
+ */
+
+#include "spdk/stdinc.h"
+#include "spdk/util.h"
+
+#include "ftl_core.h"
+#include "ftl_internal.h"
+
+/* Number of user blocks sharing a single write counter (1MiB) */
+#define FTL_HEAT_RANGE_BLOCKS 256
+
+/* All counters are halved each time this many writes per range were recorded on average */
+#define FTL_HEAT_DECAY_PERIOD 16
+
+/* A range is cold when its counter is lower than the average by this factor */
+#define FTL_HEAT_COLD_RATIO 2
+
+/*
+ * Tracks how often the user writes to each LBA range. The counters are decayed periodically,
+ * so they follow the recent workload. This allows for separating the rarely rewritten (cold)
+ * data from the rest during NV cache compaction and placing it along with the data relocated
+ * by GC, which reduces the amount of cold data being moved around again and again.
+ */
+struct ftl_heat {
+	/* Saturating write counter per LBA range */
+	uint8_t		*counters;
+
+	/* Number of LBA ranges */
+	uint64_t	num_ranges;
+
+	/* Sum of all counters */
+	uint64_t	sum;
+
+	/* Number of writes recorded since the last decay */
+	uint64_t	num_writes;
+};
+
+struct ftl_heat *
+ftl_heat_init(struct spdk_ftl_dev *dev)
+{
+	struct ftl_heat *heat;
+
+	heat = calloc(1, sizeof(*heat));
+	if (!heat) {
+		return NULL;
+	}
+
+	heat->num_ranges = spdk_divide_round_up(dev->num_lbas, FTL_HEAT_RANGE_BLOCKS);
+	heat->counters = calloc(heat->num_ranges, sizeof(*heat->counters));
+	if (!heat->counters) {
+		free(heat);
+		return NULL;
+	}
+
+	return heat;
+}
+
+void
+ftl_heat_free(struct ftl_heat *heat)
+{
+	if (!heat) {
+		return;
+	}
+
+	free(heat->counters);
+	free(heat);
+}
+
+static void
+heat_decay(struct ftl_heat *heat)
+{
+	uint64_t i;
+
+	heat->sum = 0;
+	for (i = 0; i < heat->num_ranges; ++i) {
+		heat->counters[i] /= 2;
+		heat->sum += heat->counters[i];
+	}
+
+	heat->num_writes = 0;
+}
+
+void
+ftl_heat_record_write(struct ftl_heat *heat, uint64_t lba, uint64_t num_blocks)
+{
+	uint64_t range, last_range;
+
+	assert(num_blocks > 0);
+	last_range = (lba + num_blocks - 1) / FTL_HEAT_RANGE_BLOCKS;
+	assert(last_range < heat->num_ranges);
+
+	for (range = lba / FTL_HEAT_RANGE_BLOCKS; range <= last_range; ++range) {
+		if (heat->counters[range] < UINT8_MAX) {
+			heat->counters[range]++;
+			heat->sum++;
+		}
+		heat->num_writes++;
+	}
+
+	if (heat->num_writes >= heat->num_ranges * FTL_HEAT_DECAY_PERIOD) {
+		heat_decay(heat);
+	}
+}
+
+bool
+ftl_heat_is_cold(const struct ftl_heat *heat, uint64_t lba)
+{
+	uint64_t counter;
+
+	assert(lba / FTL_HEAT_RANGE_BLOCKS < heat->num_ranges);
+	counter = heat->counters[lba / FTL_HEAT_RANGE_BLOCKS];
+
+	/* Not enough writes recorded yet to tell the ranges apart */
+	if (heat->sum < heat->num_ranges) {
+		return false;
+	}
+
+	return counter * heat->num_ranges * FTL_HEAT_COLD_RATIO < heat->sum;
+}
@@ -163,4 +163,12 @@ void ftl_reloc_resume(struct ftl_reloc *reloc);
 
 bool ftl_reloc_is_halted(const struct ftl_reloc *reloc);
 
+struct ftl_heat *ftl_heat_init(struct spdk_ftl_dev *dev);
+
+void ftl_heat_free(struct ftl_heat *heat);
+
+void ftl_heat_record_write(struct ftl_heat *heat, uint64_t lba, uint64_t num_blocks);
+
+bool ftl_heat_is_cold(const struct ftl_heat *heat, uint64_t lba);
+
 #endif /* FTL_INTERNAL_H */
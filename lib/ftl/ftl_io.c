@@ -231,6 +231,40 @@ ftl_io_complete(struct ftl_io *io)
 	ftl_io_cb(io, io->cb_ctx, io->status);
 }
 
+void
+ftl_io_xfer_read_complete(struct ftl_io *io)
+{
+	struct spdk_ftl_dev *dev = io->dev;
+	bool remapped = false;
+	uint64_t i;
+
+	assert(io->type == FTL_IO_READ);
+	assert(io->flags & FTL_IO_PINNED);
+
+	if (spdk_likely(io->status == 0)) {
+		/* The data was read on the IO channel's thread, while relocation or compaction
+		 * could have moved the LBAs. Look the mapping up again and read the moved blocks
+		 * from their new location, instead of returning stale data. */
+		for (i = 0; i < io->num_blocks; i++) {
+			ftl_addr current_addr = ftl_l2p_get(dev, ftl_io_get_lba(io, i));
+
+			if (spdk_unlikely(current_addr != io->map[i])) {
+				io->map[i] = current_addr;
+				remapped = true;
+			}
+		}
+	}
+
+	if (spdk_unlikely(remapped)) {
+		assert(io->req_cnt == 0);
+		io->pos = io->iov_pos = io->iov_off = 0;
+		ftl_io_xfer_submit(io);
+		return;
+	}
+
+	ftl_io_complete(io);
+}
+
 void
 ftl_io_fail(struct ftl_io *io, int status)
 {
@@ -52,6 +52,14 @@ struct ftl_io_channel {
 	struct spdk_ring		*sq;
 	/*  Completion queue */
 	struct spdk_ring		*cq;
+	/*  Base device IO channel, used for offloaded user IO */
+	struct spdk_io_channel		*base_ioch;
+	/*  Cache device IO channel, used for offloaded user IO */
+	struct spdk_io_channel		*cache_ioch;
+	/*  User IO handed over by the core thread for its data transfer */
+	struct spdk_ring		*xfer_sq;
+	/*  User IO with finished data transfer, returned to the core thread */
+	struct spdk_ring		*xfer_cq;
 };
 
 /* General IO descriptor for user requests */
@@ -130,6 +138,9 @@ struct ftl_io {
 	ftl_addr			*map;
 
 	struct spdk_bdev_io_wait_entry	bdev_io_wait;
+
+	/* Statistics of offloaded data transfers, accounted on the core thread */
+	struct ftl_stats_group		xfer_stats;
 };
 
 /* */
@@ -306,6 +317,8 @@ int ftl_io_init(struct spdk_io_channel *ioch, struct ftl_io *io, uint64_t lba,
 		size_t num_blocks, struct iovec *iov, size_t iov_cnt, spdk_ftl_fn cb_fn,
 		void *cb_arg, int type);
 void ftl_io_complete(struct ftl_io *io);
+/* Completes an offloaded read on the core thread, transferring moved blocks again */
+void ftl_io_xfer_read_complete(struct ftl_io *io);
 void ftl_rq_del(struct ftl_rq *rq);
 struct ftl_rq *ftl_rq_new(struct spdk_ftl_dev *dev, uint32_t io_md_size);
 void ftl_rq_unpin(struct ftl_rq *rq);
@@ -4,6 +4,7 @@
  */
 
 #include "spdk/stdinc.h"
+#include "spdk/bit_array.h"
 #include "spdk/cpuset.h"
 #include "spdk/queue.h"
 #include "spdk/thread.h"
@@ -46,6 +47,9 @@ struct ftl_l2p_page {
 	uint64_t pin_ref_cnt;
 	struct ftl_l2p_cache_page_io_ctx ctx;
 	bool on_lru_list;
+	bool hot; /* Page was needed again shortly after being evicted, it's kept on the LRU list */
+	bool prefetched; /* Page was read ahead of demand and wasn't pinned yet */
+	uint64_t fifo_seq; /* Admission order of the page, keeps its place on the FIFO list across pins */
 	void *page_buffer;
 	uint64_t ckpt_seq_id;
 	ftl_df_obj_id obj_id;
@@ -69,6 +73,10 @@ struct ftl_l2p_page_wait_ctx {
  * bottom device (e.g. RAID5F), since then big IOs (especially unaligned ones) could potentially break this.
  */
 #define L2P_MAX_PAGES_TO_PIN 4
+
+/* Max L2P page I/Os in flight, so the cache device queue depth stays bounded */
+#define L2P_MAX_IOS_IN_FLIGHT 512
+
 struct ftl_l2p_page_set {
 	uint16_t to_pin_cnt;
 	uint16_t pinned_cnt;
@@ -99,6 +107,38 @@ struct ftl_l2p_cache_process_ctx {
 	uint64_t qd;
 };
 
+/*
+ * Resident pages are managed according to the 2Q replacement policy, so that a single scan
+ * over the volume doesn't flush the entire working set out of the cache:
+ * - pages read for the first time are placed on the FIFO list, which is evicted first once
+ *   it takes more than FTL_L2P_CACHE_FIFO_RATIO percent of the cache,
+ * - page numbers evicted from the FIFO list are remembered in the ghost ring, sized to
+ *   FTL_L2P_CACHE_GHOST_RATIO percent of the cache,
+ * - pages read again while their number is in the ghost ring are considered hot and kept on
+ *   the LRU list.
+ */
+#define FTL_L2P_CACHE_FIFO_RATIO	25
+#define FTL_L2P_CACHE_GHOST_RATIO	50
+#define FTL_L2P_CACHE_GHOST_EMPTY	UINT64_MAX
+
+/*
+ * Sequential access detection. Pins continuing any of the tracked streams advance it, other
+ * pins replace the streams in round robin manner. Once a stream covers FTL_L2P_PREFETCH_TRIGGER
+ * consecutive pages, up to FTL_L2P_PREFETCH_DEPTH pages following it are read ahead of demand.
+ */
+#define FTL_L2P_PREFETCH_STREAMS	4
+#define FTL_L2P_PREFETCH_TRIGGER	2
+#define FTL_L2P_PREFETCH_DEPTH		8
+
+struct ftl_l2p_cache_stream {
+	/* Last page pinned by the stream */
+	uint64_t last_page;
+	/* Number of consecutive pages pinned by the stream */
+	uint64_t seq_cnt;
+	/* Next page to be prefetched */
+	uint64_t prefetch_page;
+};
+
 struct ftl_l2p_cache {
 	struct spdk_ftl_dev *dev;
 	struct ftl_l2p_l1_map_entry *l2_mapping;
@@ -108,6 +148,24 @@ struct ftl_l2p_cache {
 	struct ftl_md *l1_md;
 
 	TAILQ_HEAD(l2p_lru_list, ftl_l2p_page) lru_list;
+	struct l2p_lru_list fifo_list;
+	uint64_t fifo_cnt;		/* Number of pages on the FIFO list */
+	uint64_t fifo_max;		/* Number of pages the FIFO list can keep before it's evicted first */
+	uint64_t fifo_seq;		/* Admission sequence number of the most recent page */
+
+	/* Numbers of the pages recently evicted from the FIFO list */
+	struct {
+		struct spdk_bit_array *map;
+		uint64_t *ring;
+		uint64_t size;
+		uint64_t idx;
+	} ghost;
+
+	struct {
+		struct ftl_l2p_cache_stream stream[FTL_L2P_PREFETCH_STREAMS];
+		uint32_t victim;
+	} prefetch;
+
 	/* TODO: A lot of / and % operations are done on this value, consider adding a shift based field and calculactions instead */
 	uint64_t lbas_in_page;
 	uint64_t num_pages;		/* num pages to hold the entire L2P */
@@ -155,6 +213,8 @@ static void page_set_end(struct spdk_ftl_dev *dev, struct ftl_l2p_cache *cache,
 			 struct ftl_l2p_page_set *page_set);
 static void page_out_io_retry(void *arg);
 static void page_in_io_retry(void *arg);
+static void ftl_l2p_cache_prefetch(struct spdk_ftl_dev *dev, struct ftl_l2p_cache *cache,
+				   uint64_t start, uint64_t end);
 
 static inline void
 ftl_l2p_page_queue_wait_ctx(struct ftl_l2p_page *page,
@@ -187,17 +247,48 @@ ftl_l2p_cache_lru_remove_page(struct ftl_l2p_cache *cache, struct ftl_l2p_page *
 	assert(page);
 	assert(page->on_lru_list);
 
-	TAILQ_REMOVE(&cache->lru_list, page, list_entry);
+	if (page->hot) {
+		TAILQ_REMOVE(&cache->lru_list, page, list_entry);
+	} else {
+		TAILQ_REMOVE(&cache->fifo_list, page, list_entry);
+		assert(cache->fifo_cnt > 0);
+		cache->fifo_cnt--;
+	}
 	page->on_lru_list = false;
 }
 
+static void
+ftl_l2p_cache_fifo_insert_page(struct ftl_l2p_cache *cache, struct ftl_l2p_page *page)
+{
+	struct ftl_l2p_page *iter;
+
+	/*
+	 * Pages are taken off the FIFO list while pinned. Put them back at their original
+	 * position, so that pinning doesn't reset their age. The pinned pages are usually
+	 * the recently admitted ones, so the search from the head is short.
+	 */
+	TAILQ_FOREACH(iter, &cache->fifo_list, list_entry) {
+		if (iter->fifo_seq < page->fifo_seq) {
+			TAILQ_INSERT_BEFORE(iter, page, list_entry);
+			return;
+		}
+	}
+
+	TAILQ_INSERT_TAIL(&cache->fifo_list, page, list_entry);
+}
+
 static void
 ftl_l2p_cache_lru_add_page(struct ftl_l2p_cache *cache, struct ftl_l2p_page *page)
 {
 	assert(page);
 	assert(!page->on_lru_list);
 
-	TAILQ_INSERT_HEAD(&cache->lru_list, page, list_entry);
+	if (page->hot) {
+		TAILQ_INSERT_HEAD(&cache->lru_list, page, list_entry);
+	} else {
+		ftl_l2p_cache_fifo_insert_page(cache, page);
+		cache->fifo_cnt++;
+	}
 
 	page->on_lru_list = true;
 }
@@ -205,7 +296,8 @@ ftl_l2p_cache_lru_add_page(struct ftl_l2p_cache *cache, struct ftl_l2p_page *pag
 static void
 ftl_l2p_cache_lru_promote_page(struct ftl_l2p_cache *cache, struct ftl_l2p_page *page)
 {
-	if (!page->on_lru_list) {
+	/* Repeated references to a page on the FIFO list are correlated, don't reorder it */
+	if (!page->on_lru_list || !page->hot) {
 		return;
 	}
 
@@ -236,9 +328,43 @@ ftl_l2p_cache_page_remove(struct ftl_l2p_cache *cache, struct ftl_l2p_page *page
 	ftl_mempool_put(cache->l2_ctx_pool, page);
 }
 
+static void
+ftl_l2p_cache_ghost_add(struct ftl_l2p_cache *cache, uint64_t page_no)
+{
+	uint64_t *slot = &cache->ghost.ring[cache->ghost.idx];
+
+	/*
+	 * The slot being reused may refer to a page which got evicted again in the meantime,
+	 * in which case it's dropped from the ghost ring a bit early. It only makes the page
+	 * less likely to be considered hot.
+	 */
+	if (*slot != FTL_L2P_CACHE_GHOST_EMPTY) {
+		spdk_bit_array_clear(cache->ghost.map, *slot);
+	}
+
+	*slot = page_no;
+	spdk_bit_array_set(cache->ghost.map, page_no);
+	cache->ghost.idx = (cache->ghost.idx + 1) % cache->ghost.size;
+}
+
+static void
+ftl_l2p_cache_page_evict(struct ftl_l2p_cache *cache, struct ftl_l2p_page *page)
+{
+	if (!page->hot) {
+		ftl_l2p_cache_ghost_add(cache, page->page_no);
+	}
+
+	ftl_l2p_cache_page_remove(cache, page);
+}
+
 static inline struct ftl_l2p_page *
 ftl_l2p_cache_get_coldest_page(struct ftl_l2p_cache *cache)
 {
+	/* Pages seen only once are evicted first, unless they fit in their share of the cache */
+	if (cache->fifo_cnt > cache->fifo_max || TAILQ_EMPTY(&cache->lru_list)) {
+		return TAILQ_LAST(&cache->fifo_list, l2p_lru_list);
+	}
+
 	return TAILQ_LAST(&cache->lru_list, l2p_lru_list);
 }
 
@@ -286,6 +412,7 @@ ftl_l2p_cache_page_alloc(struct ftl_l2p_cache *cache, size_t page_no)
 
 	page->page_no = page_no;
 	page->state = L2P_CACHE_PAGE_INIT;
+	page->fifo_seq = ++cache->fifo_seq;
 
 	return page;
 }
@@ -336,6 +463,11 @@ ftl_l2p_page_set_invalid(struct spdk_ftl_dev *dev, struct ftl_l2p_page *page)
 static inline void
 ftl_l2p_cache_page_pin(struct ftl_l2p_cache *cache, struct ftl_l2p_page *page)
 {
+	if (page->prefetched) {
+		page->prefetched = false;
+		cache->dev->stats.l2p_cache.prefetch_hits++;
+	}
+
 	page->pin_ref_cnt++;
 	/* Pinned pages can't be evicted (since L2P sets/gets will be executed on it), so remove them from LRU */
 	if (page->on_lru_list) {
@@ -460,13 +592,27 @@ ftl_l2p_cache_init(struct spdk_ftl_dev *dev)
 
 	TAILQ_INIT(&cache->deferred_page_set_list);
 	TAILQ_INIT(&cache->lru_list);
+	TAILQ_INIT(&cache->fifo_list);
+	cache->fifo_max = spdk_divide_round_up(max_resident_pgs * FTL_L2P_CACHE_FIFO_RATIO, 100);
+
+	cache->ghost.size = spdk_max(1, max_resident_pgs * FTL_L2P_CACHE_GHOST_RATIO / 100);
+	cache->ghost.ring = calloc(cache->ghost.size, sizeof(*cache->ghost.ring));
+	if (!cache->ghost.ring) {
+		return -1;
+	}
+	memset(cache->ghost.ring, 0xff, cache->ghost.size * sizeof(*cache->ghost.ring));
+
+	cache->ghost.map = spdk_bit_array_create(cache->num_pages);
+	if (!cache->ghost.map) {
+		goto fail_ghost;
+	}
 
 	cache->l2_ctx_md = ftl_md_create(dev,
 					 spdk_divide_round_up(max_resident_pgs * SPDK_ALIGN_CEIL(sizeof(struct ftl_l2p_page), 64),
 							 FTL_BLOCK_SIZE), 0, FTL_L2P_CACHE_MD_NAME_L2_CTX, ftl_md_create_shm_flags(dev), NULL);
 
 	if (cache->l2_ctx_md == NULL) {
-		return -1;
+		goto fail_ghost;
 	}
 
 	cache->l2_pgs_resident_max = max_resident_pgs;
@@ -476,7 +622,7 @@ ftl_l2p_cache_init(struct spdk_ftl_dev *dev)
 			     max_resident_pgs, sizeof(struct ftl_l2p_page), 64);
 
 	if (cache->l2_ctx_pool == NULL) {
-		return -1;
+		goto fail_ghost;
 	}
 
 #define FTL_L2P_CACHE_PAGE_AVAIL_MAX            16UL << 10
@@ -495,7 +641,7 @@ ftl_l2p_cache_init(struct spdk_ftl_dev *dev)
 				     ftl_md_create_shm_flags(dev), NULL);
 
 	if (cache->l1_md == NULL) {
-		return -1;
+		goto fail_ghost;
 	}
 
 	/* Cache MD layout */
@@ -505,6 +651,11 @@ ftl_l2p_cache_init(struct spdk_ftl_dev *dev)
 	cache->cache_layout_ioch = reg->ioch;
 
 	return 0;
+fail_ghost:
+	spdk_bit_array_free(&cache->ghost.map);
+	free(cache->ghost.ring);
+	cache->ghost.ring = NULL;
+	return -1;
 }
 
 static void
@@ -521,6 +672,10 @@ ftl_l2p_cache_deinit_l2(struct spdk_ftl_dev *dev, struct ftl_l2p_cache *cache)
 
 	ftl_mempool_destroy(cache->page_sets_pool);
 	cache->page_sets_pool = NULL;
+
+	spdk_bit_array_free(&cache->ghost.map);
+	free(cache->ghost.ring);
+	cache->ghost.ring = NULL;
 }
 
 static void
@@ -819,6 +974,8 @@ l2p_shm_restore_clean(struct spdk_ftl_dev *dev)
 
 		page->pin_ref_cnt = 0;
 		page->on_lru_list = 0;
+		page->prefetched = false;
+		page->fifo_seq = ++cache->fifo_seq;
 		memset(&page->ctx, 0, sizeof(page->ctx));
 
 		ftl_l2p_cache_lru_add_page(cache, page);
@@ -867,6 +1024,8 @@ l2p_shm_restore_dirty(struct spdk_ftl_dev *dev)
 
 		page->pin_ref_cnt = 0;
 		page->on_lru_list = 0;
+		page->prefetched = false;
+		page->fifo_seq = ++cache->fifo_seq;
 		memset(&page->ctx, 0, sizeof(page->ctx));
 
 		ftl_l2p_cache_lru_add_page(cache, page);
@@ -1039,6 +1198,7 @@ ftl_l2p_cache_pin(struct spdk_ftl_dev *dev, struct ftl_l2p_pin_ctx *pin_ctx)
 		if (page) {
 			if (ftl_l2p_cache_page_is_pinnable(page)) {
 				/* Page available and we can pin it */
+				dev->stats.l2p_cache.hits++;
 				page_set->pinned_cnt++;
 				entry->pg_pin_issued = true;
 				entry->pg_pin_completed = true;
@@ -1046,15 +1206,19 @@ ftl_l2p_cache_pin(struct spdk_ftl_dev *dev, struct ftl_l2p_pin_ctx *pin_ctx)
 			} else {
 				/* The page is being loaded */
 				/* Queue the page pin entry to be executed on page in */
+				dev->stats.l2p_cache.misses++;
 				ftl_l2p_page_queue_wait_ctx(page, entry);
 				entry->pg_pin_issued = true;
 			}
 		} else {
 			/* The page is not in the cache, queue the page_set to page in */
+			dev->stats.l2p_cache.misses++;
 			defer_pin = true;
 		}
 	}
 
+	ftl_l2p_cache_prefetch(dev, cache, start, end);
+
 	/* Check if page set is done */
 	if (page_set_is_done(page_set)) {
 		page_set_end(dev, cache, page_set);
@@ -1135,6 +1299,12 @@ page_allocate(struct ftl_l2p_cache *cache, uint64_t page_no)
 	struct ftl_l2p_page *page = ftl_l2p_cache_page_alloc(cache, page_no);
 	ftl_l2p_cache_page_insert(cache, page);
 
+	/* The page was evicted recently, it's part of the working set */
+	if (spdk_bit_array_get(cache->ghost.map, page_no)) {
+		spdk_bit_array_clear(cache->ghost.map, page_no);
+		page->hot = true;
+	}
+
 	return page;
 }
 
@@ -1229,6 +1399,9 @@ page_in_io_complete(struct spdk_ftl_dev *dev, struct ftl_l2p_cache *cache,
 	if (spdk_unlikely(!success)) {
 		ftl_bug(page->on_lru_list);
 		ftl_l2p_cache_page_remove(cache, page);
+	} else if (!page->pin_ref_cnt && !page->on_lru_list) {
+		/* Prefetched page which wasn't needed yet */
+		ftl_l2p_cache_lru_add_page(cache, page);
 	}
 }
 
@@ -1318,6 +1491,69 @@ page_in(struct spdk_ftl_dev *dev, struct ftl_l2p_cache *cache,
 	}
 }
 
+static void
+page_prefetch(struct spdk_ftl_dev *dev, struct ftl_l2p_cache *cache, uint64_t page_no)
+{
+	struct ftl_l2p_page *page;
+
+	page = page_allocate(cache, page_no);
+	page->prefetched = true;
+	dev->stats.l2p_cache.prefetches++;
+
+	page_in_io(dev, cache, page);
+}
+
+static struct ftl_l2p_cache_stream *
+prefetch_get_stream(struct ftl_l2p_cache *cache, uint64_t start, uint64_t end)
+{
+	struct ftl_l2p_cache_stream *stream;
+	uint32_t i;
+
+	for (i = 0; i < FTL_L2P_PREFETCH_STREAMS; i++) {
+		stream = &cache->prefetch.stream[i];
+
+		if (start == stream->last_page || start == stream->last_page + 1) {
+			stream->seq_cnt += end - stream->last_page;
+			stream->last_page = end;
+			return stream;
+		}
+	}
+
+	stream = &cache->prefetch.stream[cache->prefetch.victim];
+	cache->prefetch.victim = (cache->prefetch.victim + 1) % FTL_L2P_PREFETCH_STREAMS;
+
+	stream->last_page = end;
+	stream->seq_cnt = 0;
+	stream->prefetch_page = end + 1;
+
+	return stream;
+}
+
+static void
+ftl_l2p_cache_prefetch(struct spdk_ftl_dev *dev, struct ftl_l2p_cache *cache,
+		       uint64_t start, uint64_t end)
+{
+	struct ftl_l2p_cache_stream *stream = prefetch_get_stream(cache, start, end);
+	uint64_t last = spdk_min(end + FTL_L2P_PREFETCH_DEPTH, cache->num_pages - 1);
+
+	if (stream->seq_cnt < FTL_L2P_PREFETCH_TRIGGER) {
+		return;
+	}
+
+	stream->prefetch_page = spdk_max(stream->prefetch_page, end + 1);
+	for (; stream->prefetch_page <= last; stream->prefetch_page++) {
+		/* Always leave enough pages for the demanded page sets */
+		if (cache->l2_pgs_avail <= L2P_MAX_PAGES_TO_PIN ||
+		    cache->ios_in_flight > L2P_MAX_IOS_IN_FLIGHT) {
+			break;
+		}
+
+		if (!get_l2p_page_by_df_id(cache, stream->prefetch_page)) {
+			page_prefetch(dev, cache, stream->prefetch_page);
+		}
+	}
+}
+
 static int
 ftl_l2p_cache_process_page_sets(struct spdk_ftl_dev *dev, struct ftl_l2p_cache *cache)
 {
@@ -1335,7 +1571,7 @@ ftl_l2p_cache_process_page_sets(struct spdk_ftl_dev *dev, struct ftl_l2p_cache *
 		/* No enough page to pin, wait */
 		return -EBUSY;
 	}
-	if (cache->ios_in_flight > 512) {
+	if (cache->ios_in_flight > L2P_MAX_IOS_IN_FLIGHT) {
 		/* Too big QD */
 		return -EBUSY;
 	}
@@ -1406,7 +1642,7 @@ page_out_io_complete(struct spdk_ftl_dev *dev, struct ftl_l2p_cache *cache,
 	}
 
 	if (success && ftl_l2p_cache_page_can_remove(page)) {
-		ftl_l2p_cache_page_remove(cache, page);
+		ftl_l2p_cache_page_evict(cache, page);
 	} else {
 		if (!page->pin_ref_cnt) {
 			ftl_l2p_cache_lru_add_page(cache, page);
@@ -1500,7 +1736,7 @@ ftl_l2p_cache_process_eviction(struct spdk_ftl_dev *dev, struct ftl_l2p_cache *c
 		page_out_io(dev, cache, page);
 	} else {
 		/* Page clean and we can remove it */
-		ftl_l2p_cache_page_remove(cache, page);
+		ftl_l2p_cache_page_evict(cache, page);
 	}
 }
 
@@ -741,13 +741,52 @@ compaction_submit_read(struct ftl_nv_cache_compactor *compactor, ftl_addr addr,
 			compactor);
 }
 
+static struct ftl_rq *
+compaction_get_wr(struct ftl_nv_cache_compactor *compactor, uint64_t lba)
+{
+	struct spdk_ftl_dev *dev = SPDK_CONTAINEROF(compactor->nv_cache, struct spdk_ftl_dev, nv_cache);
+
+	if (ftl_heat_is_cold(dev->heat, lba)) {
+		return compactor->wr[FTL_NV_CACHE_STREAM_COLD];
+	}
+
+	return compactor->wr[FTL_NV_CACHE_STREAM_DEFAULT];
+}
+
+static void
+compaction_queue_wr(struct ftl_nv_cache_compactor *compactor, struct ftl_rq *wr)
+{
+	struct spdk_ftl_dev *dev = SPDK_CONTAINEROF(compactor->nv_cache, struct spdk_ftl_dev, nv_cache);
+	struct ftl_writer *writer = &dev->writer_user;
+
+	/*
+	 * Cold data goes to the GC bands, unless the free bands have dropped to the high
+	 * limit - GC writer needs to be left for the relocation then.
+	 */
+	if (wr == compactor->wr[FTL_NV_CACHE_STREAM_COLD] && dev->limit > SPDK_FTL_LIMIT_HIGH) {
+		writer = &dev->writer_gc;
+	}
+
+	ftl_writer_queue_rq(writer, wr);
+}
+
 static void
 compaction_process_pad(struct ftl_nv_cache_compactor *compactor)
 {
-	struct ftl_rq *wr = compactor->wr;
-	const uint64_t num_entries = wr->num_blocks;
+	struct ftl_rq *wr;
 	struct ftl_rq_entry *iter;
+	uint64_t num_entries;
 
+	/*
+	 * Pad the request holding most of the data first, it releases most of the NV cache.
+	 * The other streams are padded once it's written, see compaction_process_ftl_done().
+	 */
+	wr = ftl_nv_cache_compactor_get_wr_to_pad(compactor);
+	if (!wr) {
+		wr = compactor->wr[FTL_NV_CACHE_STREAM_DEFAULT];
+	}
+
+	num_entries = wr->num_blocks;
 	iter = &wr->entries[wr->iter.idx];
 
 	while (wr->iter.idx < num_entries) {
@@ -758,6 +797,8 @@ compaction_process_pad(struct ftl_nv_cache_compactor *compactor)
 		iter++;
 		wr->iter.idx++;
 	}
+
+	compaction_queue_wr(compactor, wr);
 }
 
 static void
@@ -782,9 +823,8 @@ compaction_process(struct ftl_nv_cache_compactor *compactor)
 	 */
 	chunk = get_chunk_for_compaction(nv_cache);
 	if (!chunk) {
-		/* No chunks to compact, pad this request */
+		/* No chunks to compact, pad a request */
 		compaction_process_pad(compactor);
-		ftl_writer_queue_rq(&dev->writer_user, compactor->wr);
 		return;
 	}
 
@@ -859,11 +899,12 @@ compaction_process_ftl_done(struct ftl_rq *rq)
 	struct ftl_rq_entry *entry;
 	ftl_addr addr;
 	uint64_t i;
+	bool padded = false;
 
 	if (spdk_unlikely(false == rq->success)) {
 		/* IO error retry writing */
 #ifdef SPDK_FTL_RETRY_ON_ERROR
-		ftl_writer_queue_rq(&dev->writer_user, rq);
+		compaction_queue_wr(compactor, rq);
 		return;
 #else
 		ftl_abort();
@@ -878,6 +919,7 @@ compaction_process_ftl_done(struct ftl_rq *rq)
 		if (entry->lba == FTL_LBA_INVALID) {
 			assert(entry->addr == FTL_ADDR_INVALID);
 			addr = ftl_band_next_addr(band, addr, 1);
+			padded = true;
 			continue;
 		}
 
@@ -888,9 +930,15 @@ compaction_process_ftl_done(struct ftl_rq *rq)
 		addr = ftl_band_next_addr(band, addr, 1);
 	}
 
-	compactor->wr->iter.idx = 0;
+	rq->iter.idx = 0;
 
-	if (is_compaction_required(nv_cache)) {
+	/*
+	 * Keep padding the other streams, even if compaction isn't required anymore. Otherwise a
+	 * partially filled one could keep its NV cache chunks pinned once the workload stops.
+	 */
+	if (padded && !nv_cache->halt && ftl_nv_cache_compactor_get_wr_to_pad(compactor)) {
+		compaction_process_pad(compactor);
+	} else if (is_compaction_required(nv_cache)) {
 		compaction_process(compactor);
 	} else {
 		compactor_deactivate(compactor);
@@ -900,7 +948,7 @@ compaction_process_ftl_done(struct ftl_rq *rq)
 static void
 compaction_process_finish_read(struct ftl_nv_cache_compactor *compactor)
 {
-	struct ftl_rq *wr = compactor->wr;
+	struct ftl_rq *wr, *wr_full = NULL;
 	struct ftl_rq *rd = compactor->rd;
 	ftl_addr cache_addr = rd->io.addr;
 	struct ftl_nv_cache_chunk *chunk = rd->owner.priv;
@@ -908,7 +956,6 @@ compaction_process_finish_read(struct ftl_nv_cache_compactor *compactor)
 	struct ftl_rq_entry *iter;
 	union ftl_md_vss *md;
 	ftl_addr current_addr;
-	const uint64_t num_entries = wr->num_blocks;
 	uint64_t tsc = spdk_thread_get_last_tsc(spdk_get_thread());
 
 	chunk->compaction_length_tsc += tsc - chunk->compaction_start_tsc;
@@ -917,13 +964,15 @@ compaction_process_finish_read(struct ftl_nv_cache_compactor *compactor)
 	dev = SPDK_CONTAINEROF(compactor->nv_cache,
 			       struct spdk_ftl_dev, nv_cache);
 
-	assert(wr->iter.idx < num_entries);
+	assert(compactor->wr[FTL_NV_CACHE_STREAM_DEFAULT]->iter.idx <
+	       compactor->wr[FTL_NV_CACHE_STREAM_DEFAULT]->num_blocks);
+	assert(compactor->wr[FTL_NV_CACHE_STREAM_COLD]->iter.idx <
+	       compactor->wr[FTL_NV_CACHE_STREAM_COLD]->num_blocks);
 	assert(rd->iter.idx < rd->iter.count);
 
 	cache_addr += rd->iter.idx;
-	iter = &wr->entries[wr->iter.idx];
 
-	while (wr->iter.idx < num_entries && rd->iter.idx < rd->iter.count) {
+	while (!wr_full && rd->iter.idx < rd->iter.count) {
 		/* Get metadata */
 		md = rd->entries[rd->iter.idx].io_md;
 		if (md->nv_cache.lba == FTL_LBA_INVALID || md->nv_cache.seq_id != chunk->md->seq_id) {
@@ -935,6 +984,9 @@ compaction_process_finish_read(struct ftl_nv_cache_compactor *compactor)
 
 		current_addr = ftl_l2p_get(dev, md->nv_cache.lba);
 		if (current_addr == cache_addr) {
+			wr = compaction_get_wr(compactor, md->nv_cache.lba);
+			iter = &wr->entries[wr->iter.idx];
+
 			/* Swap payload */
 			ftl_rq_swap_payload(wr, wr->iter.idx, rd, rd->iter.idx);
 
@@ -949,8 +1001,10 @@ compaction_process_finish_read(struct ftl_nv_cache_compactor *compactor)
 			iter->seq_id = chunk->md->seq_id;
 
 			/* Advance within batch */
-			iter++;
 			wr->iter.idx++;
+			if (wr->iter.idx == wr->num_blocks) {
+				wr_full = wr;
+			}
 		} else {
 			/* This address already invalidated, just omit this block */
 			chunk_compaction_advance(chunk, 1);
@@ -962,11 +1016,11 @@ compaction_process_finish_read(struct ftl_nv_cache_compactor *compactor)
 		cache_addr++;
 	}
 
-	if (num_entries == wr->iter.idx) {
+	if (wr_full) {
 		/*
 		 * Request contains data to be placed on FTL, compact it
 		 */
-		ftl_writer_queue_rq(&dev->writer_user, wr);
+		compaction_queue_wr(compactor, wr_full);
 	} else {
 		if (is_compaction_required(compactor->nv_cache)) {
 			compaction_process(compactor);
@@ -979,11 +1033,15 @@ compaction_process_finish_read(struct ftl_nv_cache_compactor *compactor)
 static void
 compactor_free(struct spdk_ftl_dev *dev, struct ftl_nv_cache_compactor *compactor)
 {
+	int i;
+
 	if (!compactor) {
 		return;
 	}
 
-	ftl_rq_del(compactor->wr);
+	for (i = 0; i < FTL_NV_CACHE_STREAM_MAX; ++i) {
+		ftl_rq_del(compactor->wr[i]);
+	}
 	ftl_rq_del(compactor->rd);
 	free(compactor);
 }
@@ -992,16 +1050,23 @@ static struct ftl_nv_cache_compactor *
 compactor_alloc(struct spdk_ftl_dev *dev)
 {
 	struct ftl_nv_cache_compactor *compactor;
+	int i;
 
 	compactor = calloc(1, sizeof(*compactor));
 	if (!compactor) {
 		goto error;
 	}
 
-	/* Allocate help request for writing */
-	compactor->wr = ftl_rq_new(dev, dev->md_size);
-	if (!compactor->wr) {
-		goto error;
+	/* Allocate help requests for writing, one per stream */
+	for (i = 0; i < FTL_NV_CACHE_STREAM_MAX; ++i) {
+		compactor->wr[i] = ftl_rq_new(dev, dev->md_size);
+		if (!compactor->wr[i]) {
+			goto error;
+		}
+
+		compactor->wr[i]->owner.priv = compactor;
+		compactor->wr[i]->owner.cb = compaction_process_ftl_done;
+		compactor->wr[i]->owner.compaction = true;
 	}
 
 	/* Allocate help request for reading */
@@ -1011,9 +1076,6 @@ compactor_alloc(struct spdk_ftl_dev *dev)
 	}
 
 	compactor->nv_cache = &dev->nv_cache;
-	compactor->wr->owner.priv = compactor;
-	compactor->wr->owner.cb = compaction_process_ftl_done;
-	compactor->wr->owner.compaction = true;
 
 	return compactor;
 
@@ -1118,9 +1180,69 @@ ftl_nv_cache_pin_cb(struct spdk_ftl_dev *dev, int status, struct ftl_l2p_pin_ctx
 
 	ftl_trace_submission(io->dev, io, io->addr, io->num_blocks);
 
+	if (dev->conf.user_io_offload) {
+		ftl_io_xfer_submit(io);
+		return;
+	}
+
 	nv_cache_write(io);
 }
 
+static void
+ftl_nv_cache_xfer_cb(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct ftl_io *io = cb_arg;
+
+	ftl_stats_group_bdev_io_completed(&io->xfer_stats, bdev_io);
+
+	spdk_bdev_free_io(bdev_io);
+
+	if (spdk_unlikely(!success)) {
+		io->status = -EIO;
+	}
+
+	ftl_io_xfer_done(io);
+}
+
+void
+ftl_nv_cache_xfer_write(void *_io)
+{
+	struct ftl_io *io = _io;
+	struct ftl_io_channel *ioch = ftl_io_channel_get_ctx(io->ioch);
+	struct spdk_ftl_dev *dev = io->dev;
+	struct ftl_nv_cache *nv_cache = &dev->nv_cache;
+	int rc;
+
+	rc = ftl_nv_cache_bdev_writev_blocks_with_md(dev,
+			nv_cache->bdev_desc, ioch->cache_ioch,
+			io->iov, io->iov_cnt, io->md,
+			ftl_addr_to_nvc_offset(dev, io->addr), io->num_blocks,
+			ftl_nv_cache_xfer_cb, io);
+	if (spdk_unlikely(rc)) {
+		if (rc == -ENOMEM) {
+			struct spdk_bdev *bdev = spdk_bdev_desc_get_bdev(nv_cache->bdev_desc);
+			io->bdev_io_wait.bdev = bdev;
+			io->bdev_io_wait.cb_fn = ftl_nv_cache_xfer_write;
+			io->bdev_io_wait.cb_arg = io;
+			spdk_bdev_queue_io_wait(bdev, ioch->cache_ioch, &io->bdev_io_wait);
+		} else {
+			ftl_abort();
+		}
+	}
+}
+
+void
+ftl_nv_cache_write_complete(struct ftl_io *io)
+{
+	if (spdk_unlikely(io->status)) {
+		FTL_ERRLOG(io->dev, "Non-volatile cache write failed at %"PRIx64"\n",
+			   io->addr);
+		ftl_nv_cache_submit_cb_done(io);
+	} else {
+		ftl_nv_cache_l2p_update(io);
+	}
+}
+
 bool
 ftl_nv_cache_write(struct ftl_io *io)
 {
@@ -1143,6 +1265,7 @@ ftl_nv_cache_write(struct ftl_io *io)
 	io->nv_cache_chunk = dev->nv_cache.chunk_current;
 
 	ftl_nv_cache_fill_md(io);
+	ftl_heat_record_write(dev->heat, io->lba, io->num_blocks);
 	ftl_l2p_pin(io->dev, io->lba, io->num_blocks,
 		    ftl_nv_cache_pin_cb, io,
 		    &io->l2p_pin_ctx);
@@ -1178,7 +1301,9 @@ ftl_nv_cache_is_halted(struct ftl_nv_cache *nv_cache)
 	}
 
 	TAILQ_FOREACH(compactor, &nv_cache->compactor_list, entry) {
-		if (compactor->rd->iter.idx != 0 || compactor->wr->iter.idx != 0) {
+		if (compactor->rd->iter.idx != 0 ||
+		    compactor->wr[FTL_NV_CACHE_STREAM_DEFAULT]->iter.idx != 0 ||
+		    compactor->wr[FTL_NV_CACHE_STREAM_COLD]->iter.idx != 0) {
 			return false;
 		}
 	}
@@ -1194,9 +1319,10 @@ static void
 ftl_nv_cache_compaction_reset(struct ftl_nv_cache_compactor *compactor)
 {
 	struct ftl_rq *rd = compactor->rd;
-	struct ftl_rq *wr = compactor->wr;
+	struct ftl_rq *wr;
 	uint64_t lba;
 	uint64_t i;
+	int stream;
 
 	for (i = rd->iter.idx; i < rd->iter.count; i++) {
 		lba = ((union ftl_md_vss *)rd->entries[i].io_md)->nv_cache.lba;
@@ -1208,13 +1334,17 @@ ftl_nv_cache_compaction_reset(struct ftl_nv_cache_compactor *compactor)
 	rd->iter.idx = 0;
 	rd->iter.count = 0;
 
-	for (i = 0; i < wr->iter.idx; i++) {
-		lba = wr->entries[i].lba;
-		assert(lba != FTL_LBA_INVALID);
-		ftl_l2p_unpin(wr->dev, lba, 1);
-	}
+	for (stream = 0; stream < FTL_NV_CACHE_STREAM_MAX; stream++) {
+		wr = compactor->wr[stream];
 
-	wr->iter.idx = 0;
+		for (i = 0; i < wr->iter.idx; i++) {
+			lba = wr->entries[i].lba;
+			assert(lba != FTL_LBA_INVALID);
+			ftl_l2p_unpin(wr->dev, lba, 1);
+		}
+
+		wr->iter.idx = 0;
+	}
 }
 
 void
@@ -121,9 +121,18 @@ struct ftl_nv_cache_chunk {
 	struct ftl_md_io_entry_ctx md_persist_entry_ctx;
 };
 
+/* Streams the compacted data is separated into, based on its write frequency */
+enum ftl_nv_cache_stream {
+	/* Written to the compaction bands */
+	FTL_NV_CACHE_STREAM_DEFAULT,
+	/* Rarely rewritten data, placed along with the data relocated by GC */
+	FTL_NV_CACHE_STREAM_COLD,
+	FTL_NV_CACHE_STREAM_MAX
+};
+
 struct ftl_nv_cache_compactor {
 	struct ftl_nv_cache *nv_cache;
-	struct ftl_rq *wr;
+	struct ftl_rq *wr[FTL_NV_CACHE_STREAM_MAX];
 	struct ftl_rq *rd;
 	TAILQ_ENTRY(ftl_nv_cache_compactor) entry;
 	struct spdk_bdev_io_wait_entry bdev_io_wait;
@@ -225,6 +234,8 @@ bool ftl_nv_cache_write(struct ftl_io *io);
 void ftl_nv_cache_fill_md(struct ftl_io *io);
 int ftl_nv_cache_read(struct ftl_io *io, ftl_addr addr, uint32_t num_blocks,
 		      spdk_bdev_io_completion_cb cb, void *cb_arg);
+void ftl_nv_cache_xfer_write(void *io);
+void ftl_nv_cache_write_complete(struct ftl_io *io);
 bool ftl_nv_cache_throttle(struct spdk_ftl_dev *dev);
 void ftl_nv_cache_process(struct spdk_ftl_dev *dev);
 
@@ -250,6 +261,29 @@ ftl_nv_cache_resume(struct ftl_nv_cache *nv_cache)
 
 bool ftl_nv_cache_is_halted(struct ftl_nv_cache *nv_cache);
 
+/*
+ * Returns the compaction write request to pad next - the fullest one still holding data,
+ * or NULL once no stream does.
+ */
+static inline struct ftl_rq *
+ftl_nv_cache_compactor_get_wr_to_pad(struct ftl_nv_cache_compactor *compactor)
+{
+	struct ftl_rq *wr = NULL;
+	int i;
+
+	for (i = 0; i < FTL_NV_CACHE_STREAM_MAX; ++i) {
+		if (compactor->wr[i]->iter.idx == 0) {
+			continue;
+		}
+
+		if (!wr || compactor->wr[i]->iter.idx > wr->iter.idx) {
+			wr = compactor->wr[i];
+		}
+	}
+
+	return wr;
+}
+
 size_t ftl_nv_cache_chunk_tail_md_num_blocks(const struct ftl_nv_cache *nv_cache);
 
 uint64_t chunk_tail_md_offset(struct ftl_nv_cache *nv_cache);
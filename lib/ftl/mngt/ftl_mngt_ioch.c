@@ -39,6 +39,8 @@ io_channel_unregister(void *ctx)
 
 	TAILQ_REMOVE(&dev->ioch_queue, ioch, entry);
 
+	spdk_ring_free(ioch->xfer_cq);
+	spdk_ring_free(ioch->xfer_sq);
 	spdk_ring_free(ioch->cq);
 	spdk_ring_free(ioch->sq);
 	ftl_mempool_destroy(ioch->map_pool);
@@ -99,10 +101,35 @@ io_channel_create_cb(void *io_device, void *ctx)
 		goto fail_cq;
 	}
 
+	if (dev->conf.user_io_offload) {
+		ioch->xfer_sq = spdk_ring_create(SPDK_RING_TYPE_SP_SC,
+						 spdk_align64pow2(dev->conf.user_io_pool_size + 1),
+						 SPDK_ENV_SOCKET_ID_ANY);
+		ioch->xfer_cq = spdk_ring_create(SPDK_RING_TYPE_SP_SC,
+						 spdk_align64pow2(dev->conf.user_io_pool_size + 1),
+						 SPDK_ENV_SOCKET_ID_ANY);
+		if (!ioch->xfer_sq || !ioch->xfer_cq) {
+			FTL_ERRLOG(dev, "Failed to create IO channel transfer queues\n");
+			goto fail_xfer;
+		}
+
+		ioch->base_ioch = spdk_bdev_get_io_channel(dev->base_bdev_desc);
+		if (!ioch->base_ioch) {
+			FTL_ERRLOG(dev, "Failed to get base bdev IO channel\n");
+			goto fail_xfer;
+		}
+
+		ioch->cache_ioch = spdk_bdev_get_io_channel(dev->nv_cache.bdev_desc);
+		if (!ioch->cache_ioch) {
+			FTL_ERRLOG(dev, "Failed to get cache bdev IO channel\n");
+			goto fail_xfer;
+		}
+	}
+
 	ioch->poller = SPDK_POLLER_REGISTER(ftl_io_channel_poll, ioch, 0);
 	if (!ioch->poller) {
 		FTL_ERRLOG(dev, "Failed to register IO channel poller\n");
-		goto fail_sq;
+		goto fail_xfer;
 	}
 
 	if (spdk_thread_send_msg(dev->core_thread, ftl_dev_register_channel, ioch)) {
@@ -115,10 +142,18 @@ io_channel_create_cb(void *io_device, void *ctx)
 
 fail_poller:
 	spdk_poller_unregister(&ioch->poller);
+fail_xfer:
+	if (ioch->cache_ioch) {
+		spdk_put_io_channel(ioch->cache_ioch);
+	}
+	if (ioch->base_ioch) {
+		spdk_put_io_channel(ioch->base_ioch);
+	}
+	spdk_ring_free(ioch->xfer_cq);
+	spdk_ring_free(ioch->xfer_sq);
+	spdk_ring_free(ioch->sq);
 fail_cq:
 	spdk_ring_free(ioch->cq);
-fail_sq:
-	spdk_ring_free(ioch->sq);
 fail_io_pool:
 	ftl_mempool_destroy(ioch->map_pool);
 	free(ioch);
@@ -137,6 +172,16 @@ io_channel_destroy_cb(void *io_device, void *ctx)
 		      spdk_thread_get_name(spdk_get_thread()));
 
 	spdk_poller_unregister(&ioch->poller);
+
+	if (ioch->cache_ioch) {
+		spdk_put_io_channel(ioch->cache_ioch);
+		ioch->cache_ioch = NULL;
+	}
+	if (ioch->base_ioch) {
+		spdk_put_io_channel(ioch->base_ioch);
+		ioch->base_ioch = NULL;
+	}
+
 	spdk_thread_send_msg(ftl_get_core_thread(dev),
 			     io_channel_unregister, ioch);
 }
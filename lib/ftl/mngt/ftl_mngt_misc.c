@@ -121,6 +121,27 @@ ftl_mngt_deinit_reloc(struct spdk_ftl_dev *dev, struct ftl_mngt_process *mngt)
 	ftl_mngt_next_step(mngt);
 }
 
+void
+ftl_mngt_init_heat(struct spdk_ftl_dev *dev, struct ftl_mngt_process *mngt)
+{
+	dev->heat = ftl_heat_init(dev);
+	if (!dev->heat) {
+		FTL_ERRLOG(dev, "Unable to initialize write heat tracking\n");
+		ftl_mngt_fail_step(mngt);
+		return;
+	}
+
+	ftl_mngt_next_step(mngt);
+}
+
+void
+ftl_mngt_deinit_heat(struct spdk_ftl_dev *dev, struct ftl_mngt_process *mngt)
+{
+	ftl_heat_free(dev->heat);
+	dev->heat = NULL;
+	ftl_mngt_next_step(mngt);
+}
+
 void
 ftl_mngt_init_nv_cache(struct spdk_ftl_dev *dev, struct ftl_mngt_process *mngt)
 {
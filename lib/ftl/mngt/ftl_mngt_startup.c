@@ -137,6 +137,11 @@ static const struct ftl_mngt_process_desc desc_startup = {
 			.action = ftl_mngt_init_reloc,
 			.cleanup = ftl_mngt_deinit_reloc
 		},
+		{
+			.name = "Initialize write heat tracking",
+			.action = ftl_mngt_init_heat,
+			.cleanup = ftl_mngt_deinit_heat
+		},
 		{
 			.name = "Select startup mode",
 			.action = ftl_mngt_select_startup_mode
@@ -166,5 +166,9 @@ ftl_conf_is_valid(const struct spdk_ftl_conf *conf)
 		return false;
 	}
 
+	if (conf->gc_policy >= SPDK_FTL_GC_POLICY_MAX) {
+		return false;
+	}
+
 	return true;
 }
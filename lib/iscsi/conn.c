@@ -125,6 +125,7 @@ iscsi_poll_group_add_conn(struct spdk_iscsi_poll_group *pg, struct spdk_iscsi_co
 
 	conn->is_stopped = false;
 	STAILQ_INSERT_TAIL(&pg->connections, conn, pg_link);
+	pg->num_conns++;
 }
 
 static void
@@ -133,13 +134,57 @@ iscsi_poll_group_remove_conn(struct spdk_iscsi_poll_group *pg, struct spdk_iscsi
 	int rc;
 
 	assert(conn->sock != NULL);
-	rc = spdk_sock_group_remove_sock(pg->sock_group, conn->sock);
-	if (rc < 0) {
-		SPDK_ERRLOG("Failed to remove sock=%p of conn=%p\n", conn->sock, conn);
+	if (!conn->recv_paused) {
+		rc = spdk_sock_group_remove_sock(pg->sock_group, conn->sock);
+		if (rc < 0) {
+			SPDK_ERRLOG("Failed to remove sock=%p of conn=%p\n", conn->sock, conn);
+		}
 	}
 
+	conn->recv_paused = false;
 	conn->is_stopped = true;
 	STAILQ_REMOVE(&pg->connections, conn, spdk_iscsi_conn, pg_link);
+	pg->num_conns--;
+}
+
+/* Stop polling the socket of a connection draining for migration, so that
+ *  the new commands left in it do not make the poll group spin.
+ */
+static void
+iscsi_conn_pause_recv(struct spdk_iscsi_conn *conn)
+{
+	int rc;
+
+	if (conn->recv_paused) {
+		return;
+	}
+
+	rc = spdk_sock_group_remove_sock(conn->pg->sock_group, conn->sock);
+	if (rc < 0) {
+		SPDK_ERRLOG("Failed to remove sock=%p of conn=%p\n", conn->sock, conn);
+		return;
+	}
+
+	conn->recv_paused = true;
+}
+
+static void
+iscsi_conn_resume_recv(struct spdk_iscsi_conn *conn)
+{
+	int rc;
+
+	if (!conn->recv_paused) {
+		return;
+	}
+
+	rc = spdk_sock_group_add_sock(conn->pg->sock_group, conn->sock, iscsi_conn_sock_cb, conn);
+	if (rc < 0) {
+		SPDK_ERRLOG("Failed to add sock=%p of conn=%p\n", conn->sock, conn);
+		conn->state = ISCSI_CONN_STATE_EXITING;
+		return;
+	}
+
+	conn->recv_paused = false;
 }
 
 static int
@@ -479,9 +524,16 @@ _iscsi_conn_hotremove_lun(void *ctx)
 	struct spdk_iscsi_lun *iscsi_lun = ctx;
 	struct spdk_iscsi_conn *conn = iscsi_lun->conn;
 	struct spdk_scsi_lun *lun = iscsi_lun->lun;
+	struct spdk_thread *thread;
 
-	assert(spdk_io_channel_get_thread(spdk_io_channel_from_ctx(conn->pg)) ==
-	       spdk_get_thread());
+	/* The connection may have been migrated to another poll group after
+	 *  this message was sent.  Follow it.
+	 */
+	thread = spdk_io_channel_get_thread(spdk_io_channel_from_ctx(conn->pg));
+	if (spdk_unlikely(thread != spdk_get_thread())) {
+		spdk_thread_send_msg(thread, _iscsi_conn_hotremove_lun, iscsi_lun);
+		return;
+	}
 
 	/* If a connection is already in stating status, just return */
 	if (conn->state >= ISCSI_CONN_STATE_EXITING) {
@@ -778,6 +830,16 @@ static void
 _iscsi_conn_request_logout(void *ctx)
 {
 	struct spdk_iscsi_conn *conn = ctx;
+	struct spdk_thread *thread;
+
+	/* The connection may have been migrated to another poll group after
+	 *  this message was sent.  Follow it.
+	 */
+	thread = spdk_io_channel_get_thread(spdk_io_channel_from_ctx(conn->pg));
+	if (spdk_unlikely(thread != spdk_get_thread())) {
+		spdk_thread_send_msg(thread, _iscsi_conn_request_logout, conn);
+		return;
+	}
 
 	if (conn->state > ISCSI_CONN_STATE_RUNNING ||
 	    conn->logout_request_timer != NULL) {
@@ -839,6 +901,16 @@ static void
 _iscsi_conn_drop(void *ctx)
 {
 	struct spdk_iscsi_conn *conn = ctx;
+	struct spdk_thread *thread;
+
+	/* The connection may have been migrated to another poll group after
+	 *  this message was sent.  Follow it.
+	 */
+	thread = spdk_io_channel_get_thread(spdk_io_channel_from_ctx(conn->pg));
+	if (spdk_unlikely(thread != spdk_get_thread())) {
+		spdk_thread_send_msg(thread, _iscsi_conn_drop, conn);
+		return;
+	}
 
 	if (conn->state < ISCSI_CONN_STATE_EXITING) {
 		conn->state = ISCSI_CONN_STATE_EXITING;
@@ -1471,6 +1543,7 @@ static void
 iscsi_conn_sock_cb(void *arg, struct spdk_sock_group *group, struct spdk_sock *sock)
 {
 	struct spdk_iscsi_conn *conn = arg;
+	uint64_t tsc;
 	int rc;
 
 	assert(conn != NULL);
@@ -1480,8 +1553,21 @@ iscsi_conn_sock_cb(void *arg, struct spdk_sock_group *group, struct spdk_sock *s
 		return;
 	}
 
+	/* While the connection drains for migration, read only what outstanding
+	 *  commands are waiting for and leave new commands in the socket.  Stop
+	 *  polling the socket until then, the migration poller resumes it.
+	 */
+	if (spdk_unlikely(conn->migrating) &&
+	    conn->pdu_recv_state == ISCSI_PDU_RECV_STATE_AWAIT_PDU_READY &&
+	    TAILQ_EMPTY(&conn->active_r2t_tasks)) {
+		iscsi_conn_pause_recv(conn);
+		return;
+	}
+
 	/* Handle incoming PDUs */
+	tsc = spdk_get_ticks();
 	rc = iscsi_handle_incoming_pdus(conn);
+	conn->busy_tsc += spdk_get_ticks() - tsc;
 	if (rc < 0) {
 		conn->state = ISCSI_CONN_STATE_EXITING;
 	}
@@ -1491,9 +1577,30 @@ static void
 iscsi_conn_full_feature_migrate(void *arg)
 {
 	struct spdk_iscsi_conn *conn = arg;
+	struct spdk_iscsi_tgt_node *target;
+	struct spdk_iscsi_poll_group *pg;
 
 	assert(conn->state != ISCSI_CONN_STATE_EXITED);
 
+	if (conn->sess->session_type == SESSION_TYPE_NORMAL) {
+		/* The target node may have been moved to another poll group while
+		 *  this message was in flight.  All connections to a target node
+		 *  have to share the poll group because each LUN has a single
+		 *  I/O channel, so follow it.
+		 */
+		target = conn->sess->target;
+		pthread_mutex_lock(&target->mutex);
+		pg = target->pg;
+		pthread_mutex_unlock(&target->mutex);
+
+		if (spdk_unlikely(pg != conn->pg)) {
+			conn->pg = pg;
+			spdk_thread_send_msg(spdk_io_channel_get_thread(spdk_io_channel_from_ctx(pg)),
+					     iscsi_conn_full_feature_migrate, conn);
+			return;
+		}
+	}
+
 	/* Note: it is possible that connection could have moved to EXITING
 	 * state after this message was sent. We will still add it to the
 	 * poll group in this case.  When the poll group is polled
@@ -1510,6 +1617,56 @@ iscsi_conn_full_feature_migrate(void *arg)
 
 static struct spdk_iscsi_poll_group *g_next_pg = NULL;
 
+static bool
+iscsi_poll_group_is_less_loaded(struct spdk_iscsi_poll_group *pg,
+				struct spdk_iscsi_poll_group *best)
+{
+	uint32_t load = pg->load, best_load = best->load;
+
+	if (load + ISCSI_POLL_GROUP_LOAD_SLACK < best_load) {
+		return true;
+	} else if (best_load + ISCSI_POLL_GROUP_LOAD_SLACK < load) {
+		return false;
+	}
+
+	return pg->num_conns < best->num_conns;
+}
+
+/* Pick the poll group whose thread was the least busy over the last load
+ *  period.  Poll groups whose loads are within ISCSI_POLL_GROUP_LOAD_SLACK
+ *  of each other are compared by their number of connections, and any
+ *  remaining tie is broken round-robin.  g_iscsi.mutex must be held.
+ */
+static struct spdk_iscsi_poll_group *
+iscsi_poll_group_get_least_loaded(void)
+{
+	struct spdk_iscsi_poll_group *pg, *best;
+
+	if (g_next_pg == NULL) {
+		g_next_pg = TAILQ_FIRST(&g_iscsi.poll_group_head);
+		assert(g_next_pg != NULL);
+	}
+
+	best = g_next_pg;
+	pg = g_next_pg;
+	while (true) {
+		pg = TAILQ_NEXT(pg, link);
+		if (pg == NULL) {
+			pg = TAILQ_FIRST(&g_iscsi.poll_group_head);
+		}
+		if (pg == g_next_pg) {
+			break;
+		}
+		if (iscsi_poll_group_is_less_loaded(pg, best)) {
+			best = pg;
+		}
+	}
+
+	g_next_pg = TAILQ_NEXT(best, link);
+
+	return best;
+}
+
 void
 iscsi_conn_schedule(struct spdk_iscsi_conn *conn)
 {
@@ -1529,15 +1686,9 @@ iscsi_conn_schedule(struct spdk_iscsi_conn *conn)
 	if (target->num_active_conns == 1) {
 		/**
 		 * This is the only active connection for this target node.
-		 *  Pick a poll group using round-robin.
+		 *  Pick the least loaded poll group.
 		 */
-		if (g_next_pg == NULL) {
-			g_next_pg = TAILQ_FIRST(&g_iscsi.poll_group_head);
-			assert(g_next_pg != NULL);
-		}
-
-		pg = g_next_pg;
-		g_next_pg = TAILQ_NEXT(g_next_pg, link);
+		pg = iscsi_poll_group_get_least_loaded();
 
 		/* Save the pg in the target node so it can be used for any other connections to this target node. */
 		target->pg = pg;
@@ -1563,6 +1714,393 @@ iscsi_conn_schedule(struct spdk_iscsi_conn *conn)
 			     iscsi_conn_full_feature_migrate, conn);
 }
 
+struct iscsi_conn_migrate_ctx {
+	struct spdk_iscsi_poll_group	*src;
+	struct spdk_iscsi_poll_group	*dst;
+	struct spdk_iscsi_tgt_node	*target;
+	uint32_t			max_load;
+	uint64_t			timeout_tsc;
+	struct spdk_poller		*poller;
+	struct spdk_thread		*orig_thread;
+	iscsi_conn_migrate_cb		cb_fn;
+	void				*cb_arg;
+	int				rc;
+
+	/* Connections on their way between the poll groups */
+	STAILQ_HEAD(, spdk_iscsi_conn)	conns;
+};
+
+/* Returns false if the connection is going away and must not be migrated. */
+static bool
+iscsi_conn_can_migrate(struct spdk_iscsi_conn *conn)
+{
+	return conn->state == ISCSI_CONN_STATE_RUNNING &&
+	       !conn->is_logged_out &&
+	       conn->logout_request_timer == NULL &&
+	       conn->logout_timer == NULL &&
+	       conn->shutdown_timer == NULL;
+}
+
+/* Returns true if the connection has nothing outstanding that is tied to the
+ *  thread of its current poll group.
+ */
+static bool
+iscsi_conn_is_drained(struct spdk_iscsi_conn *conn)
+{
+	struct spdk_iscsi_lun *iscsi_lun;
+
+	if (conn->pending_task_cnt != 0 ||
+	    conn->data_in_cnt != 0 ||
+	    conn->data_out_cnt != 0 ||
+	    conn->pdu_recv_state != ISCSI_PDU_RECV_STATE_AWAIT_PDU_READY ||
+	    !TAILQ_EMPTY(&conn->write_pdu_list) ||
+	    !TAILQ_EMPTY(&conn->snack_pdu_list) ||
+	    !TAILQ_EMPTY(&conn->queued_r2t_tasks) ||
+	    !TAILQ_EMPTY(&conn->active_r2t_tasks) ||
+	    !TAILQ_EMPTY(&conn->queued_datain_tasks)) {
+		return false;
+	}
+
+	TAILQ_FOREACH(iscsi_lun, &conn->luns, tailq) {
+		if (iscsi_lun->remove_poller != NULL) {
+			return false;
+		}
+	}
+
+	return !spdk_scsi_dev_has_pending_tasks(conn->dev, conn->initiator_port);
+}
+
+/* Pick the target node on the poll group whose connections together took the
+ *  share of thread time closest to half of max_load, but less than max_load
+ *  so that moving it does not just move the hot spot.
+ */
+static struct spdk_iscsi_tgt_node *
+iscsi_poll_group_pick_target(struct spdk_iscsi_poll_group *pg, uint32_t max_load)
+{
+	struct spdk_iscsi_conn *conn, *tmp;
+	struct spdk_iscsi_tgt_node *target, *best = NULL;
+	uint32_t load, dist, best_dist = UINT32_MAX;
+
+	STAILQ_FOREACH(conn, &pg->connections, pg_link) {
+		target = conn->target;
+		if (target == NULL || !conn->full_feature ||
+		    conn->sess->session_type != SESSION_TYPE_NORMAL) {
+			continue;
+		}
+
+		/* Skip target nodes which were already accounted. */
+		STAILQ_FOREACH(tmp, &pg->connections, pg_link) {
+			if (tmp == conn || tmp->target == target) {
+				break;
+			}
+		}
+		if (tmp != conn) {
+			continue;
+		}
+
+		load = 0;
+		for (tmp = conn; tmp != NULL; tmp = STAILQ_NEXT(tmp, pg_link)) {
+			if (tmp->target == target && tmp->full_feature) {
+				load += tmp->load;
+			}
+		}
+
+		if (load == 0 || load >= max_load) {
+			continue;
+		}
+
+		dist = load > max_load / 2 ? load - max_load / 2 : max_load / 2 - load;
+		if (dist < best_dist) {
+			best = target;
+			best_dist = dist;
+		}
+	}
+
+	return best;
+}
+
+static void
+_iscsi_conns_migrate_done(void *arg)
+{
+	struct iscsi_conn_migrate_ctx *ctx = arg;
+
+	ctx->cb_fn(ctx->cb_arg, ctx->rc);
+	free(ctx);
+}
+
+static void
+iscsi_conns_migrate_done(struct iscsi_conn_migrate_ctx *ctx, int rc)
+{
+	spdk_poller_unregister(&ctx->poller);
+
+	ctx->rc = rc;
+	spdk_thread_send_msg(ctx->orig_thread, _iscsi_conns_migrate_done, ctx);
+}
+
+/* Give up the migration before any connection left the source poll group. */
+static void
+iscsi_conns_migrate_abort(struct iscsi_conn_migrate_ctx *ctx, int rc)
+{
+	struct spdk_iscsi_conn *conn;
+
+	STAILQ_FOREACH(conn, &ctx->src->connections, pg_link) {
+		if (conn->target == ctx->target) {
+			conn->migrating = false;
+			iscsi_conn_resume_recv(conn);
+		}
+	}
+
+	iscsi_conns_migrate_done(ctx, rc);
+}
+
+static int
+iscsi_conn_get_lun_channels(struct spdk_iscsi_conn *conn)
+{
+	struct spdk_iscsi_lun *iscsi_lun, *tmp;
+	int rc;
+
+	TAILQ_FOREACH(iscsi_lun, &conn->luns, tailq) {
+		rc = spdk_scsi_lun_allocate_io_channel(iscsi_lun->desc);
+		if (rc != 0) {
+			SPDK_ERRLOG("Failed to allocate io_channel for LUN%d of conn=%p\n",
+				    spdk_scsi_lun_get_id(iscsi_lun->lun), conn);
+			TAILQ_FOREACH(tmp, &conn->luns, tailq) {
+				if (tmp == iscsi_lun) {
+					break;
+				}
+				spdk_scsi_lun_free_io_channel(tmp->desc);
+			}
+			return rc;
+		}
+	}
+
+	return 0;
+}
+
+static void
+iscsi_conn_put_lun_channels(struct spdk_iscsi_conn *conn)
+{
+	struct spdk_iscsi_lun *iscsi_lun;
+
+	TAILQ_FOREACH(iscsi_lun, &conn->luns, tailq) {
+		spdk_scsi_lun_free_io_channel(iscsi_lun->desc);
+	}
+}
+
+static void
+iscsi_conns_migrate_add(struct iscsi_conn_migrate_ctx *ctx, struct spdk_iscsi_poll_group *pg)
+{
+	struct spdk_iscsi_conn *conn;
+
+	while ((conn = STAILQ_FIRST(&ctx->conns)) != NULL) {
+		STAILQ_REMOVE_HEAD(&ctx->conns, pg_link);
+		conn->migrating = false;
+		iscsi_poll_group_add_conn(pg, conn);
+	}
+}
+
+/* Runs on the source thread again after the I/O channels could not be
+ *  allocated on the destination thread.
+ */
+static void
+iscsi_conns_migrate_rollback(void *arg)
+{
+	struct iscsi_conn_migrate_ctx *ctx = arg;
+	struct spdk_iscsi_conn *conn;
+	struct spdk_iscsi_lun *iscsi_lun, *tmp;
+
+	STAILQ_FOREACH(conn, &ctx->conns, pg_link) {
+		if (iscsi_conn_get_lun_channels(conn) == 0) {
+			continue;
+		}
+
+		/* The connection can't serve its LUNs on either thread.  Its LUNs hold
+		 *  no I/O channel anymore, so close them here and drop the connection.
+		 */
+		SPDK_ERRLOG("Failed to restore LUNs of conn=%p, dropping it\n", conn);
+		TAILQ_FOREACH_SAFE(iscsi_lun, &conn->luns, tailq, tmp) {
+			spdk_scsi_lun_close(iscsi_lun->desc);
+			spdk_poller_unregister(&iscsi_lun->remove_poller);
+			TAILQ_REMOVE(&conn->luns, iscsi_lun, tailq);
+			free(iscsi_lun);
+		}
+		if (conn->state < ISCSI_CONN_STATE_EXITING) {
+			conn->state = ISCSI_CONN_STATE_EXITING;
+		}
+	}
+
+	iscsi_conns_migrate_add(ctx, ctx->src);
+	iscsi_conns_migrate_done(ctx, ctx->rc);
+}
+
+/* Runs on the destination thread.  Either all connections of the target node
+ *  get the I/O channels of their LUNs here, or all of them go back to the
+ *  source poll group.
+ */
+static void
+iscsi_conns_migrate_arrive(void *arg)
+{
+	struct iscsi_conn_migrate_ctx *ctx = arg;
+	struct spdk_iscsi_tgt_node *target = ctx->target;
+	struct spdk_iscsi_conn *conn, *failed;
+	int rc = 0;
+
+	STAILQ_FOREACH(conn, &ctx->conns, pg_link) {
+		rc = iscsi_conn_get_lun_channels(conn);
+		if (rc != 0) {
+			break;
+		}
+	}
+
+	if (spdk_likely(rc == 0)) {
+		iscsi_conns_migrate_add(ctx, ctx->dst);
+		iscsi_conns_migrate_done(ctx, 0);
+		return;
+	}
+
+	failed = conn;
+	STAILQ_FOREACH(conn, &ctx->conns, pg_link) {
+		if (conn == failed) {
+			break;
+		}
+		iscsi_conn_put_lun_channels(conn);
+	}
+
+	pthread_mutex_lock(&target->mutex);
+	target->pg = ctx->src;
+	STAILQ_FOREACH(conn, &ctx->conns, pg_link) {
+		conn->pg = ctx->src;
+	}
+	pthread_mutex_unlock(&target->mutex);
+
+	ctx->rc = -EIO;
+	spdk_thread_send_msg(spdk_io_channel_get_thread(spdk_io_channel_from_ctx(ctx->src)),
+			     iscsi_conns_migrate_rollback, ctx);
+}
+
+static void
+iscsi_conns_migrate_move(struct iscsi_conn_migrate_ctx *ctx)
+{
+	struct spdk_iscsi_tgt_node *target = ctx->target;
+	struct spdk_iscsi_conn *conn, *tmp;
+
+	pthread_mutex_lock(&target->mutex);
+	if (spdk_unlikely(target->pg != ctx->src)) {
+		/* The target node was moved away from src meanwhile, leave it
+		 *  where it is now.
+		 */
+		pthread_mutex_unlock(&target->mutex);
+		iscsi_conns_migrate_abort(ctx, -ECANCELED);
+		return;
+	}
+
+	STAILQ_FOREACH_SAFE(conn, &ctx->src->connections, pg_link, tmp) {
+		if (conn->target != target) {
+			continue;
+		}
+
+		iscsi_poll_group_remove_conn(ctx->src, conn);
+		iscsi_conn_put_lun_channels(conn);
+		conn->pg = ctx->dst;
+		STAILQ_INSERT_TAIL(&ctx->conns, conn, pg_link);
+	}
+
+	target->pg = ctx->dst;
+	pthread_mutex_unlock(&target->mutex);
+
+	spdk_poller_unregister(&ctx->poller);
+	spdk_thread_send_msg(spdk_io_channel_get_thread(spdk_io_channel_from_ctx(ctx->dst)),
+			     iscsi_conns_migrate_arrive, ctx);
+}
+
+static int
+iscsi_conns_migrate_poll(void *arg)
+{
+	struct iscsi_conn_migrate_ctx *ctx = arg;
+	struct spdk_iscsi_conn *conn;
+	uint32_t num_conns = 0;
+	bool drained = true;
+
+	STAILQ_FOREACH(conn, &ctx->src->connections, pg_link) {
+		if (conn->target != ctx->target) {
+			continue;
+		}
+
+		if (!iscsi_conn_can_migrate(conn)) {
+			iscsi_conns_migrate_abort(ctx, -ECANCELED);
+			return SPDK_POLLER_BUSY;
+		}
+
+		/* Outstanding writes became ready to receive their data. */
+		if (conn->recv_paused && !TAILQ_EMPTY(&conn->active_r2t_tasks)) {
+			iscsi_conn_resume_recv(conn);
+		}
+
+		num_conns++;
+		drained = drained && iscsi_conn_is_drained(conn);
+	}
+
+	if (num_conns == 0) {
+		iscsi_conns_migrate_abort(ctx, -ENOENT);
+	} else if (drained) {
+		iscsi_conns_migrate_move(ctx);
+	} else if (spdk_get_ticks() > ctx->timeout_tsc) {
+		iscsi_conns_migrate_abort(ctx, -ETIMEDOUT);
+	}
+
+	return SPDK_POLLER_BUSY;
+}
+
+static void
+_iscsi_poll_group_migrate_conns(void *arg)
+{
+	struct iscsi_conn_migrate_ctx *ctx = arg;
+	struct spdk_iscsi_conn *conn;
+
+	ctx->target = iscsi_poll_group_pick_target(ctx->src, ctx->max_load);
+	if (ctx->target == NULL) {
+		iscsi_conns_migrate_done(ctx, -ENOENT);
+		return;
+	}
+
+	STAILQ_FOREACH(conn, &ctx->src->connections, pg_link) {
+		if (conn->target == ctx->target) {
+			conn->migrating = true;
+		}
+	}
+
+	ctx->timeout_tsc = spdk_get_ticks() +
+			   ISCSI_CONN_MIGRATION_TIMEOUT * spdk_get_ticks_hz() / SPDK_SEC_TO_USEC;
+	ctx->poller = SPDK_POLLER_REGISTER(iscsi_conns_migrate_poll, ctx, 100);
+}
+
+void
+iscsi_poll_group_migrate_conns(struct spdk_iscsi_poll_group *src,
+			       struct spdk_iscsi_poll_group *dst, uint32_t max_load,
+			       iscsi_conn_migrate_cb cb_fn, void *cb_arg)
+{
+	struct iscsi_conn_migrate_ctx *ctx;
+
+	assert(src != dst);
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (ctx == NULL) {
+		cb_fn(cb_arg, -ENOMEM);
+		return;
+	}
+
+	ctx->src = src;
+	ctx->dst = dst;
+	ctx->max_load = max_load;
+	ctx->orig_thread = spdk_get_thread();
+	ctx->cb_fn = cb_fn;
+	ctx->cb_arg = cb_arg;
+	STAILQ_INIT(&ctx->conns);
+
+	spdk_thread_send_msg(spdk_io_channel_get_thread(spdk_io_channel_from_ctx(src)),
+			     _iscsi_poll_group_migrate_conns, ctx);
+}
+
 static int
 logout_timeout(void *arg)
 {
@@ -1676,5 +2214,7 @@ iscsi_conn_info_json(struct spdk_json_write_ctx *w, struct spdk_iscsi_conn *conn
 	spdk_json_write_named_string(w, "thread_name",
 				     spdk_thread_get_name(spdk_get_thread()));
 
+	spdk_json_write_named_uint32(w, "load", conn->load);
+
 	spdk_json_write_object_end(w);
 }
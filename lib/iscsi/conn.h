@@ -162,6 +162,16 @@ struct spdk_iscsi_conn {
 
 	STAILQ_ENTRY(spdk_iscsi_conn) pg_link;
 	bool			is_stopped;  /* Set true when connection is stopped for migration */
+	bool			migrating;   /* Set true while draining before migration */
+	bool			recv_paused; /* Set true while out of the sock group */
+
+	/* Ticks spent handling incoming PDUs, and their share of the poll group
+	 *  thread time in percent over the last load period.
+	 */
+	uint64_t		busy_tsc;
+	uint64_t		last_busy_tsc;
+	uint32_t		load;
+
 	TAILQ_HEAD(queued_r2t_tasks, spdk_iscsi_task)	queued_r2t_tasks;
 	TAILQ_HEAD(active_r2t_tasks, spdk_iscsi_task)	active_r2t_tasks;
 	TAILQ_HEAD(queued_datain_tasks, spdk_iscsi_task)	queued_datain_tasks;
@@ -183,6 +193,18 @@ int iscsi_conn_construct(struct spdk_iscsi_portal *portal, struct spdk_sock *soc
 void iscsi_conn_destruct(struct spdk_iscsi_conn *conn);
 void iscsi_conn_handle_nop(struct spdk_iscsi_conn *conn);
 void iscsi_conn_schedule(struct spdk_iscsi_conn *conn);
+
+typedef void (*iscsi_conn_migrate_cb)(void *cb_arg, int rc);
+
+/**
+ * Move the connections of one target node from src to dst, picking the target
+ *  node whose connections took closest to half of max_load percent of the src
+ *  thread time.  The connections are drained of outstanding I/O first.
+ *  cb_fn is called on the calling thread when done or given up.
+ */
+void iscsi_poll_group_migrate_conns(struct spdk_iscsi_poll_group *src,
+				    struct spdk_iscsi_poll_group *dst, uint32_t max_load,
+				    iscsi_conn_migrate_cb cb_fn, void *cb_arg);
 void iscsi_conn_logout(struct spdk_iscsi_conn *conn);
 int iscsi_drop_conns(struct spdk_iscsi_conn *conn,
 		     const char *conn_match, int drop_all);
@@ -3254,6 +3254,107 @@ iscsi_submit_write_subtask(struct spdk_iscsi_conn *conn, struct spdk_iscsi_task
 	return 0;
 }
 
+/* Submit the data buffers merged by the primary task as a single write subtask. */
+static int
+iscsi_submit_write_mobjs(struct spdk_iscsi_conn *conn, struct spdk_iscsi_task *task,
+			 struct spdk_iscsi_pdu *pdu)
+{
+	struct spdk_iscsi_task *subtask;
+	uint32_t length = 0;
+	int i;
+
+	if (task->write_mobj == NULL) {
+		return 0;
+	}
+
+	subtask = iscsi_task_get(conn, task, iscsi_task_cpl);
+	if (subtask == NULL) {
+		SPDK_ERRLOG("Unable to acquire subtask\n");
+		return SPDK_ISCSI_CONNECTION_FATAL;
+	}
+
+	for (i = 0; i < task->write_iovcnt; i++) {
+		subtask->write_iovs[i] = task->write_iovs[i];
+		length += task->write_iovs[i].iov_len;
+	}
+	subtask->write_iovcnt = task->write_iovcnt;
+
+	subtask->scsi.offset = task->current_data_offset;
+	subtask->scsi.length = length;
+	subtask->scsi.iovs = subtask->write_iovs;
+	subtask->scsi.iovcnt = subtask->write_iovcnt;
+
+	/* The subtask owns the chain of data buffers from now on. */
+	iscsi_task_set_mobj(subtask, task->write_mobj);
+	task->write_mobj = NULL;
+	task->write_iovcnt = 0;
+	if (pdu != NULL) {
+		iscsi_task_associate_pdu(subtask, pdu);
+	}
+
+	task->current_data_offset += length;
+
+	iscsi_queue_task(conn, subtask);
+	return 0;
+}
+
+/* Merge a data buffer into the next write subtask of the primary task. */
+static int
+iscsi_task_add_write_mobj(struct spdk_iscsi_conn *conn, struct spdk_iscsi_task *task,
+			  struct spdk_iscsi_pdu *pdu, struct spdk_mobj *mobj)
+{
+	struct spdk_mobj *head;
+	int rc;
+
+	if (task->write_iovcnt == ISCSI_WRITE_SUBTASK_MAX_IOVS) {
+		rc = iscsi_submit_write_mobjs(conn, task, pdu);
+		if (rc != 0) {
+			return rc;
+		}
+	}
+
+	head = task->write_mobj;
+	if (head == NULL) {
+		task->write_mobj = mobj;
+	} else {
+		mobj->next = head->next;
+		head->next = mobj;
+	}
+
+	task->write_iovs[task->write_iovcnt].iov_base = mobj->buf;
+	task->write_iovs[task->write_iovcnt].iov_len = mobj->data_len;
+	task->write_iovcnt++;
+
+	return 0;
+}
+
+/* Submit the data buffers merged so far by all write tasks of the connection.
+ *  This is done when the data buffer pool runs out, so that buffers held by
+ *  incomplete bursts are released as the writes complete.
+ */
+static int
+iscsi_conn_flush_write_mobjs(struct spdk_iscsi_conn *conn)
+{
+	struct spdk_iscsi_task *task;
+	int rc;
+
+	TAILQ_FOREACH(task, &conn->active_r2t_tasks, link) {
+		rc = iscsi_submit_write_mobjs(conn, task, NULL);
+		if (rc != 0) {
+			return rc;
+		}
+	}
+
+	TAILQ_FOREACH(task, &conn->queued_r2t_tasks, link) {
+		rc = iscsi_submit_write_mobjs(conn, task, NULL);
+		if (rc != 0) {
+			return rc;
+		}
+	}
+
+	return 0;
+}
+
 static int
 iscsi_pdu_payload_op_scsi_write(struct spdk_iscsi_conn *conn, struct spdk_iscsi_task *task)
 {
@@ -3283,18 +3384,27 @@ iscsi_pdu_payload_op_scsi_write(struct spdk_iscsi_conn *conn, struct spdk_iscsi_
 			mobj = pdu->mobj[0];
 			assert(mobj != NULL);
 
-			if (!pdu->dif_insert_or_strip &&
-			    mobj->data_len < SPDK_ISCSI_MAX_RECV_DATA_SEGMENT_LENGTH) {
+			if (pdu->dif_insert_or_strip) {
+				/* we are doing the first partial write task */
+				rc = iscsi_submit_write_subtask(conn, task, pdu, mobj);
+				if (rc < 0) {
+					iscsi_task_put(task);
+					return SPDK_ISCSI_CONNECTION_FATAL;
+				}
+			} else if (mobj->data_len < SPDK_ISCSI_MAX_RECV_DATA_SEGMENT_LENGTH) {
 				/* continue aggregation until the first data buffer is full. */
 				iscsi_task_set_mobj(task, mobj);
 				pdu->mobj[0] = NULL;
 			} else {
-				/* we are doing the first partial write task */
-				rc = iscsi_submit_write_subtask(conn, task, pdu, mobj);
+				/* The full data buffer is written together with the Data-OUT
+				 * PDUs of the first burst.
+				 */
+				rc = iscsi_task_add_write_mobj(conn, task, pdu, mobj);
 				if (rc < 0) {
 					iscsi_task_put(task);
 					return SPDK_ISCSI_CONNECTION_FATAL;
 				}
+				pdu->mobj[0] = NULL;
 			}
 		}
 		return 0;
@@ -4320,20 +4430,26 @@ iscsi_pdu_payload_op_data(struct spdk_iscsi_conn *conn, struct spdk_iscsi_pdu *p
 		return iscsi_reject(conn, pdu, ISCSI_REASON_PROTOCOL_ERROR);
 	}
 
-	/* If current PDU is final in a sequence, submit all received data,
-	 * otherwise, continue aggregation until the first data buffer is full.
-	 * We do not use SGL and instead create a subtask per data buffer. Hence further
-	 * aggregation does not improve any performance.
+	/* Data buffers are filled up to SPDK_ISCSI_MAX_RECV_DATA_SEGMENT_LENGTH first.
+	 * Full data buffers are merged until the current PDU is final in a sequence,
+	 * and then all received data is submitted by a single subtask with an iovec
+	 * per data buffer. Hence a whole R2T burst is written by a single bdev I/O.
 	 */
 	mobj = pdu->mobj[0];
 	assert(mobj != NULL);
 
-	if (F_bit || mobj->data_len >= SPDK_ISCSI_MAX_RECV_DATA_SEGMENT_LENGTH ||
-	    pdu->dif_insert_or_strip) {
-		rc = iscsi_submit_write_subtask(conn, task, pdu, mobj);
+	if (spdk_unlikely(pdu->dif_insert_or_strip)) {
+		/* DIF insert/strip works on a single data buffer. */
+		assert(pdu->mobj[1] == NULL);
+		return iscsi_submit_write_subtask(conn, task, pdu, mobj);
+	}
+
+	if (F_bit || mobj->data_len >= SPDK_ISCSI_MAX_RECV_DATA_SEGMENT_LENGTH) {
+		rc = iscsi_task_add_write_mobj(conn, task, pdu, mobj);
 		if (rc != 0) {
 			return rc;
 		}
+		pdu->mobj[0] = NULL;
 	} else {
 		assert(pdu->mobj[1] == NULL);
 		iscsi_task_set_mobj(task, mobj);
@@ -4342,20 +4458,25 @@ iscsi_pdu_payload_op_data(struct spdk_iscsi_conn *conn, struct spdk_iscsi_pdu *p
 	}
 
 	mobj = pdu->mobj[1];
-	if (mobj == NULL) {
-		return 0;
-	}
+	if (mobj != NULL) {
+		assert(mobj->data_len < SPDK_ISCSI_MAX_RECV_DATA_SEGMENT_LENGTH);
 
-	assert(pdu->dif_insert_or_strip == false);
-	assert(mobj->data_len < SPDK_ISCSI_MAX_RECV_DATA_SEGMENT_LENGTH);
+		if (F_bit) {
+			rc = iscsi_task_add_write_mobj(conn, task, pdu, mobj);
+			if (rc != 0) {
+				return rc;
+			}
+		} else {
+			iscsi_task_set_mobj(task, mobj);
+		}
+		pdu->mobj[1] = NULL;
+	}
 
 	if (F_bit) {
-		return iscsi_submit_write_subtask(conn, task, pdu, mobj);
-	} else {
-		iscsi_task_set_mobj(task, mobj);
-		pdu->mobj[1] = NULL;
-		return 0;
+		return iscsi_submit_write_mobjs(conn, task, pdu);
 	}
+
+	return 0;
 }
 
 static void
@@ -4629,6 +4750,12 @@ iscsi_pdu_payload_read(struct spdk_iscsi_conn *conn, struct spdk_iscsi_pdu *pdu)
 		}
 		mobj = iscsi_datapool_get(pool);
 		if (mobj == NULL) {
+			if (pool == g_iscsi.pdu_data_out_pool) {
+				rc = iscsi_conn_flush_write_mobjs(conn);
+				if (rc != 0) {
+					return rc;
+				}
+			}
 			return 1;
 		}
 
@@ -4651,6 +4778,10 @@ iscsi_pdu_payload_read(struct spdk_iscsi_conn *conn, struct spdk_iscsi_pdu *pdu)
 			}
 			mobj = iscsi_datapool_get(g_iscsi.pdu_data_out_pool);
 			if (mobj == NULL) {
+				rc = iscsi_conn_flush_write_mobjs(conn);
+				if (rc != 0) {
+					return rc;
+				}
 				return 1;
 			}
 			pdu->mobj[1] = mobj;
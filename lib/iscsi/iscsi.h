@@ -107,6 +107,19 @@
 /** Defines how long we should wait until login process completes. */
 #define ISCSI_LOGIN_TIMEOUT 30 /* in seconds */
 
+/** Defines how often each poll group samples the busy time of its thread. */
+#define ISCSI_POLL_GROUP_LOAD_PERIOD 1000000 /* in microseconds */
+
+/** Defines how far apart (in percent of busy time) two poll groups have to be
+ *   before connections are placed or migrated by load rather than by count.
+ */
+#define ISCSI_POLL_GROUP_LOAD_SLACK 10
+
+/** Defines how long connections may drain outstanding I/O before a migration
+ *   to another poll group is abandoned.
+ */
+#define ISCSI_CONN_MIGRATION_TIMEOUT 1000000 /* in microseconds */
+
 /* For spdk_iscsi_login_in related function use, we need to avoid the conflict
  * with other errors
  * */
@@ -116,10 +129,19 @@
 
 #define ISCSI_AHS_LEN 60
 
+/*
+ * Maximum number of data buffers merged into a single write subtask.
+ *  A full R2T burst fits into this many Data-OUT data buffers.
+ */
+#define ISCSI_WRITE_SUBTASK_MAX_IOVS MAX_DATA_OUT_PER_CONNECTION
+
 struct spdk_mobj {
 	struct spdk_mempool *mp;
 	void *buf;
 	uint32_t data_len;
+
+	/* Data buffers merged into a single write subtask are chained to the first one. */
+	struct spdk_mobj *next;
 };
 
 /*
@@ -285,9 +307,19 @@ struct spdk_iscsi_sess {
 struct spdk_iscsi_poll_group {
 	struct spdk_poller				*poller;
 	struct spdk_poller				*nop_poller;
+	struct spdk_poller				*load_poller;
 	STAILQ_HEAD(connections, spdk_iscsi_conn)	connections;
 	struct spdk_sock_group				*sock_group;
 	TAILQ_ENTRY(spdk_iscsi_poll_group)		link;
+
+	/* Thread busy time in percent over the last load period, and the number
+	 *  of connections on this poll group.  Both are written by the poll group
+	 *  thread and read without locking by connection placement.
+	 */
+	uint32_t					load;
+	uint32_t					num_conns;
+	uint64_t					last_busy_tsc;
+	uint64_t					last_idle_tsc;
 };
 
 struct spdk_iscsi_opts {
@@ -314,6 +346,7 @@ struct spdk_iscsi_opts {
 	uint32_t pdu_pool_size;
 	uint32_t immediate_data_pool_size;
 	uint32_t data_out_pool_size;
+	uint32_t poll_group_rebalance_period_us;
 };
 
 struct spdk_iscsi_globals {
@@ -350,6 +383,7 @@ struct spdk_iscsi_globals {
 	uint32_t pdu_pool_size;
 	uint32_t immediate_data_pool_size;
 	uint32_t data_out_pool_size;
+	uint32_t poll_group_rebalance_period_us;
 
 	struct spdk_mempool *pdu_pool;
 	struct spdk_mempool *pdu_immediate_data_pool;
@@ -452,10 +486,18 @@ iscsi_datapool_get(struct spdk_mempool *pool)
 static inline void
 iscsi_datapool_put(struct spdk_mobj *mobj)
 {
+	struct spdk_mobj *next;
+
 	assert(mobj != NULL);
 
-	mobj->data_len = 0;
-	spdk_mempool_put(mobj->mp, (void *)mobj);
+	/* Release the whole chain if mobj heads merged data buffers. */
+	do {
+		next = mobj->next;
+		mobj->next = NULL;
+		mobj->data_len = 0;
+		spdk_mempool_put(mobj->mp, (void *)mobj);
+		mobj = next;
+	} while (mobj != NULL);
 }
 
 static inline uint32_t
@@ -25,6 +25,9 @@ static void *g_init_cb_arg = NULL;
 static spdk_iscsi_fini_cb g_fini_cb_fn;
 static void *g_fini_cb_arg;
 
+static struct spdk_poller *g_rebalance_poller = NULL;
+static bool g_rebalance_in_progress = false;
+
 #define ISCSI_DATA_BUFFER_ALIGNMENT	(0x1000)
 #define ISCSI_DATA_BUFFER_MASK		(ISCSI_DATA_BUFFER_ALIGNMENT - 1)
 
@@ -38,6 +41,7 @@ mobj_ctor(struct spdk_mempool *mp, __attribute__((unused)) void *arg,
 	m->buf = (uint8_t *)m + sizeof(struct spdk_mobj);
 	m->buf = (void *)((uintptr_t)((uint8_t *)m->buf + ISCSI_DATA_BUFFER_ALIGNMENT) &
 			  ~ISCSI_DATA_BUFFER_MASK);
+	m->next = NULL;
 }
 
 static int
@@ -290,6 +294,9 @@ iscsi_log_globals(void)
 
 	SPDK_DEBUGLOG(iscsi, "MaxR2TPerConnection %d\n",
 		      g_iscsi.MaxR2TPerConnection);
+
+	SPDK_DEBUGLOG(iscsi, "PollGroupRebalancePeriod %" PRIu32 "us\n",
+		      g_iscsi.poll_group_rebalance_period_us);
 }
 
 #define NUM_PDU_PER_CONNECTION(opts)	(2 * (opts->MaxQueueDepth +	\
@@ -401,6 +408,7 @@ iscsi_opts_copy(struct spdk_iscsi_opts *src)
 	dst->pdu_pool_size = src->pdu_pool_size;
 	dst->immediate_data_pool_size = src->immediate_data_pool_size;
 	dst->data_out_pool_size = src->data_out_pool_size;
+	dst->poll_group_rebalance_period_us = src->poll_group_rebalance_period_us;
 
 	return dst;
 }
@@ -553,6 +561,7 @@ iscsi_set_global_params(struct spdk_iscsi_opts *opts)
 	g_iscsi.pdu_pool_size = opts->pdu_pool_size;
 	g_iscsi.immediate_data_pool_size = opts->immediate_data_pool_size;
 	g_iscsi.data_out_pool_size = opts->data_out_pool_size;
+	g_iscsi.poll_group_rebalance_period_us = opts->poll_group_rebalance_period_us;
 
 	iscsi_log_globals();
 
@@ -929,6 +938,56 @@ iscsi_init_complete(int rc)
 	cb_fn(cb_arg, rc);
 }
 
+static void
+iscsi_poll_group_rebalance_done(void *cb_arg, int rc)
+{
+	assert(g_rebalance_in_progress);
+	g_rebalance_in_progress = false;
+
+	SPDK_DEBUGLOG(iscsi, "poll group rebalance finished, rc=%d\n", rc);
+}
+
+/* Move one target node from the busiest to the least busy poll group if their
+ *  loads are further apart than ISCSI_POLL_GROUP_LOAD_SLACK.
+ */
+static int
+iscsi_poll_group_rebalance(void *ctx)
+{
+	struct spdk_iscsi_poll_group *pg, *busiest = NULL, *idlest = NULL;
+	uint32_t load, max_load = 0, min_load = UINT32_MAX;
+
+	if (g_rebalance_in_progress) {
+		return SPDK_POLLER_IDLE;
+	}
+
+	pthread_mutex_lock(&g_iscsi.mutex);
+	TAILQ_FOREACH(pg, &g_iscsi.poll_group_head, link) {
+		load = pg->load;
+		if (busiest == NULL || load > max_load) {
+			busiest = pg;
+			max_load = load;
+		}
+		if (idlest == NULL || load < min_load) {
+			idlest = pg;
+			min_load = load;
+		}
+	}
+	pthread_mutex_unlock(&g_iscsi.mutex);
+
+	if (busiest == idlest || max_load - min_load <= ISCSI_POLL_GROUP_LOAD_SLACK) {
+		return SPDK_POLLER_IDLE;
+	}
+
+	SPDK_DEBUGLOG(iscsi, "rebalancing poll groups, busiest %" PRIu32 "%%, idlest %" PRIu32 "%%\n",
+		      max_load, min_load);
+
+	g_rebalance_in_progress = true;
+	iscsi_poll_group_migrate_conns(busiest, idlest, max_load - min_load,
+				       iscsi_poll_group_rebalance_done, NULL);
+
+	return SPDK_POLLER_BUSY;
+}
+
 static void
 iscsi_parse_configuration(void)
 {
@@ -946,6 +1005,11 @@ iscsi_parse_configuration(void)
 		}
 	}
 
+	if (rc == 0 && g_iscsi.poll_group_rebalance_period_us != 0) {
+		g_rebalance_poller = SPDK_POLLER_REGISTER(iscsi_poll_group_rebalance, NULL,
+				     g_iscsi.poll_group_rebalance_period_us);
+	}
+
 	iscsi_init_complete(rc);
 }
 
@@ -987,6 +1051,39 @@ iscsi_poll_group_handle_nop(void *ctx)
 	return SPDK_POLLER_BUSY;
 }
 
+/* Sample the busy time of the poll group thread and the share of it taken by
+ *  each connection over the last load period.
+ */
+static int
+iscsi_poll_group_update_load(void *ctx)
+{
+	struct spdk_iscsi_poll_group *pg = ctx;
+	struct spdk_iscsi_conn *conn;
+	struct spdk_thread_stats stats;
+	uint64_t busy_tsc, period_tsc;
+
+	if (spdk_thread_get_stats(&stats) != 0) {
+		return SPDK_POLLER_IDLE;
+	}
+
+	busy_tsc = stats.busy_tsc - pg->last_busy_tsc;
+	period_tsc = busy_tsc + stats.idle_tsc - pg->last_idle_tsc;
+	if (period_tsc == 0) {
+		return SPDK_POLLER_IDLE;
+	}
+
+	pg->load = busy_tsc * 100 / period_tsc;
+	pg->last_busy_tsc = stats.busy_tsc;
+	pg->last_idle_tsc = stats.idle_tsc;
+
+	STAILQ_FOREACH(conn, &pg->connections, pg_link) {
+		conn->load = spdk_min(conn->busy_tsc - conn->last_busy_tsc, period_tsc) * 100 / period_tsc;
+		conn->last_busy_tsc = conn->busy_tsc;
+	}
+
+	return SPDK_POLLER_BUSY;
+}
+
 static int
 iscsi_poll_group_create(void *io_device, void *ctx_buf)
 {
@@ -999,6 +1096,8 @@ iscsi_poll_group_create(void *io_device, void *ctx_buf)
 	pg->poller = SPDK_POLLER_REGISTER(iscsi_poll_group_poll, pg, 0);
 	/* set the period to 1 sec */
 	pg->nop_poller = SPDK_POLLER_REGISTER(iscsi_poll_group_handle_nop, pg, 1000000);
+	pg->load_poller = SPDK_POLLER_REGISTER(iscsi_poll_group_update_load, pg,
+					       ISCSI_POLL_GROUP_LOAD_PERIOD);
 
 	return 0;
 }
@@ -1016,6 +1115,7 @@ iscsi_poll_group_destroy(void *io_device, void *ctx_buf)
 	spdk_sock_group_close(&pg->sock_group);
 	spdk_poller_unregister(&pg->poller);
 	spdk_poller_unregister(&pg->nop_poller);
+	spdk_poller_unregister(&pg->load_poller);
 
 	ch = spdk_io_channel_from_ctx(pg);
 	thread = spdk_io_channel_get_thread(ch);
@@ -1152,6 +1252,7 @@ spdk_iscsi_fini(spdk_iscsi_fini_cb cb_fn, void *cb_arg)
 	g_fini_cb_fn = cb_fn;
 	g_fini_cb_arg = cb_arg;
 
+	spdk_poller_unregister(&g_rebalance_poller);
 	iscsi_portal_grp_close_all();
 	shutdown_iscsi_conns();
 }
@@ -1260,6 +1361,8 @@ iscsi_opts_info_json(struct spdk_json_write_ctx *w)
 	spdk_json_write_named_uint32(w, "immediate_data_pool_size",
 				     g_iscsi.immediate_data_pool_size);
 	spdk_json_write_named_uint32(w, "data_out_pool_size", g_iscsi.data_out_pool_size);
+	spdk_json_write_named_uint32(w, "poll_group_rebalance_period_us",
+				     g_iscsi.poll_group_rebalance_period_us);
 
 	spdk_json_write_object_end(w);
 }
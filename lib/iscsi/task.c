@@ -28,6 +28,10 @@ iscsi_task_free(struct spdk_scsi_task *scsi_task)
 		iscsi_datapool_put(iscsi_task_get_mobj(task));
 	}
 
+	if (task->write_mobj) {
+		iscsi_datapool_put(task->write_mobj);
+	}
+
 	iscsi_task_disassociate_pdu(task);
 	assert(task->conn->pending_task_cnt > 0);
 	task->conn->pending_task_cnt--;
@@ -47,7 +51,7 @@ iscsi_task_get(struct spdk_iscsi_conn *conn, struct spdk_iscsi_task *parent,
 	}
 
 	assert(conn != NULL);
-	memset(task, 0, sizeof(*task));
+	memset(task, 0, offsetof(struct spdk_iscsi_task, write_iovs));
 	task->conn = conn;
 	assert(conn->pending_task_cnt < UINT32_MAX);
 	conn->pending_task_cnt++;
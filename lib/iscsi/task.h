@@ -19,6 +19,13 @@ struct spdk_iscsi_task {
 	struct spdk_iscsi_conn *conn;
 	struct spdk_iscsi_pdu *pdu;
 	struct spdk_mobj *mobj;
+
+	/*
+	 * Full data buffers of the current R2T burst which are not submitted yet.
+	 *  They are written by a single subtask when the burst completes.
+	 */
+	struct spdk_mobj *write_mobj;
+	int write_iovcnt;
 	uint32_t outstanding_r2t;
 
 	uint32_t desired_data_transfer_length;
@@ -74,6 +81,13 @@ struct spdk_iscsi_task {
 	TAILQ_HEAD(subtask_list, spdk_iscsi_task) subtask_list;
 	TAILQ_ENTRY(spdk_iscsi_task) subtask_link;
 	bool is_queued; /* is queued in scsi layer for handling */
+
+	/*
+	 * Data buffers merged so far by a primary task, or written by a subtask.
+	 *  Kept last, as only write_iovcnt entries are valid and the rest isn't
+	 *  cleared when the task is allocated.
+	 */
+	struct iovec write_iovs[ISCSI_WRITE_SUBTASK_MAX_IOVS];
 };
 
 static inline void
@@ -5,6 +5,7 @@
  */
 
 #include "spdk_internal/lvolstore.h"
+#include "spdk/env.h"
 #include "spdk/log.h"
 #include "spdk/string.h"
 #include "spdk/thread.h"
@@ -16,6 +17,12 @@
 
 #define LVOL_NAME "name"
 
+/* Number of clusters scanned by one step of space reclamation */
+#define LVOL_RECLAIM_CHUNK_CLUSTERS 16
+
+/* Delay before retrying a reclamation step that raced with another blob operation */
+#define LVOL_RECLAIM_BUSY_RETRY_US (10 * 1000)
+
 SPDK_LOG_REGISTER_COMPONENT(lvol)
 
 static TAILQ_HEAD(, spdk_lvol_store) g_lvol_stores = TAILQ_HEAD_INITIALIZER(g_lvol_stores);
@@ -1360,6 +1367,114 @@ spdk_lvol_destroy(struct spdk_lvol *lvol, spdk_lvol_op_complete cb_fn, void *cb_
 	spdk_bs_delete_blob(bs, lvol->blob_id, lvol_delete_blob_cb, req);
 }
 
+static void
+lvol_reclaim_finish(struct spdk_lvol_reclaim_req *req, int lvolerrno)
+{
+	struct spdk_lvol *lvol = req->lvol;
+	struct spdk_lvol_req *close_req = req->close_req;
+
+	lvol->reclaim_status.in_progress = false;
+	lvol->reclaim_status.result = lvolerrno;
+	lvol->reclaim_req = NULL;
+
+	if (lvolerrno != 0 && lvolerrno != -ECANCELED) {
+		SPDK_ERRLOG("Could not reclaim space of lvol %s: %s\n", lvol->unique_id,
+			    spdk_strerror(-lvolerrno));
+	} else {
+		SPDK_INFOLOG(lvol, "Reclaimed %" PRIu64 " clusters of lvol %s\n",
+			     lvol->reclaim_status.released_clusters, lvol->unique_id);
+	}
+
+	if (req->cb_fn != NULL) {
+		req->cb_fn(req->cb_arg, lvolerrno);
+	}
+	free(req);
+
+	if (close_req != NULL) {
+		spdk_blob_close(lvol->blob, lvol_close_blob_cb, close_req);
+	}
+}
+
+static void lvol_reclaim_chunk(struct spdk_lvol_reclaim_req *req);
+
+static int
+lvol_reclaim_poll(void *arg)
+{
+	struct spdk_lvol_reclaim_req *req = arg;
+
+	spdk_poller_unregister(&req->poller);
+	lvol_reclaim_chunk(req);
+
+	return SPDK_POLLER_BUSY;
+}
+
+static void
+lvol_reclaim_schedule(struct spdk_lvol_reclaim_req *req, uint64_t delay_us)
+{
+	/* Always continue from a poller, chunks without allocated clusters
+	 * complete synchronously. */
+	req->poller = SPDK_POLLER_REGISTER(lvol_reclaim_poll, req, delay_us);
+	if (req->poller == NULL) {
+		lvol_reclaim_finish(req, -ENOMEM);
+	}
+}
+
+static void
+lvol_reclaim_chunk_cb(void *cb_arg, uint64_t num_clusters, int lvolerrno)
+{
+	struct spdk_lvol_reclaim_req *req = cb_arg;
+	struct spdk_lvol *lvol = req->lvol;
+	uint64_t elapsed, delay_us = 0;
+
+	lvol->reclaim_status.released_clusters += num_clusters;
+
+	if (req->close_req != NULL) {
+		lvol_reclaim_finish(req, -ECANCELED);
+		return;
+	}
+
+	if (lvolerrno == -EBUSY) {
+		/* Blob is being resized or snapshotted, retry the same chunk later */
+		lvol_reclaim_schedule(req, LVOL_RECLAIM_BUSY_RETRY_US);
+		return;
+	} else if (lvolerrno != 0) {
+		lvol_reclaim_finish(req, lvolerrno);
+		return;
+	}
+
+	req->next_cluster += LVOL_RECLAIM_CHUNK_CLUSTERS;
+	lvol->reclaim_status.scanned_clusters = spdk_min(req->next_cluster,
+						lvol->reclaim_status.total_clusters);
+
+	if (req->ticks_per_chunk != 0) {
+		elapsed = spdk_get_ticks() - req->chunk_start_tsc;
+		if (elapsed < req->ticks_per_chunk) {
+			delay_us = (req->ticks_per_chunk - elapsed) * SPDK_SEC_TO_USEC / spdk_get_ticks_hz();
+		}
+	}
+
+	lvol_reclaim_schedule(req, delay_us);
+}
+
+static void
+lvol_reclaim_chunk(struct spdk_lvol_reclaim_req *req)
+{
+	struct spdk_lvol *lvol = req->lvol;
+	uint64_t num_clusters;
+
+	/* The lvol may have been resized since the previous chunk */
+	num_clusters = spdk_blob_get_num_clusters(lvol->blob);
+	if (req->next_cluster >= num_clusters) {
+		lvol_reclaim_finish(req, 0);
+		return;
+	}
+
+	req->chunk_start_tsc = spdk_get_ticks();
+	spdk_blob_reclaim_zeroed_clusters(lvol->blob, req->next_cluster,
+					  spdk_min(LVOL_RECLAIM_CHUNK_CLUSTERS, num_clusters - req->next_cluster),
+					  lvol_reclaim_chunk_cb, req);
+}
+
 void
 spdk_lvol_close(struct spdk_lvol *lvol, spdk_lvol_op_complete cb_fn, void *cb_arg)
 {
@@ -1395,6 +1510,16 @@ spdk_lvol_close(struct spdk_lvol *lvol, spdk_lvol_op_complete cb_fn, void *cb_ar
 	req->cb_arg = cb_arg;
 	req->lvol = lvol;
 
+	if (lvol->reclaim_req != NULL) {
+		/* Stop space reclamation first, the blob is closed once it is done */
+		lvol->reclaim_req->close_req = req;
+		if (lvol->reclaim_req->poller != NULL) {
+			spdk_poller_unregister(&lvol->reclaim_req->poller);
+			lvol_reclaim_finish(lvol->reclaim_req, -ECANCELED);
+		}
+		return;
+	}
+
 	spdk_blob_close(lvol->blob, lvol_close_blob_cb, req);
 }
 
@@ -1491,6 +1616,94 @@ spdk_lvol_decouple_parent(struct spdk_lvol *lvol, spdk_lvol_op_complete cb_fn, v
 				     lvol_inflate_cb, req);
 }
 
+int
+spdk_lvol_reclaim_space(struct spdk_lvol *lvol, uint64_t rate_limit_mb_per_sec,
+			spdk_lvol_op_complete cb_fn, void *cb_arg)
+{
+	struct spdk_lvol_reclaim_req *req;
+	uint64_t chunk_kb;
+
+	if (lvol == NULL) {
+		SPDK_ERRLOG("Lvol does not exist\n");
+		return -ENODEV;
+	}
+
+	if (lvol->ref_count == 0 || lvol->action_in_progress) {
+		SPDK_ERRLOG("Lvol %s is not open\n", lvol->unique_id);
+		return -EINVAL;
+	}
+
+	if (!spdk_blob_is_thin_provisioned(lvol->blob)) {
+		SPDK_ERRLOG("Lvol %s is not thin provisioned\n", lvol->unique_id);
+		return -EINVAL;
+	}
+
+	if (spdk_blob_is_read_only(lvol->blob)) {
+		SPDK_ERRLOG("Lvol %s is read only\n", lvol->unique_id);
+		return -EPERM;
+	}
+
+	if (lvol->reclaim_req != NULL) {
+		SPDK_ERRLOG("Space reclamation of lvol %s is already in progress\n", lvol->unique_id);
+		return -EBUSY;
+	}
+
+	req = calloc(1, sizeof(*req));
+	if (!req) {
+		SPDK_ERRLOG("Cannot alloc memory for lvol request pointer\n");
+		return -ENOMEM;
+	}
+
+	req->cb_fn = cb_fn;
+	req->cb_arg = cb_arg;
+	req->lvol = lvol;
+	if (rate_limit_mb_per_sec != 0) {
+		chunk_kb = LVOL_RECLAIM_CHUNK_CLUSTERS *
+			   spdk_bs_get_cluster_size(lvol->lvol_store->blobstore) / 1024;
+		req->ticks_per_chunk = spdk_get_ticks_hz() / rate_limit_mb_per_sec * chunk_kb / 1024;
+	}
+
+	memset(&lvol->reclaim_status, 0, sizeof(lvol->reclaim_status));
+	lvol->reclaim_status.in_progress = true;
+	lvol->reclaim_status.total_clusters = spdk_blob_get_num_clusters(lvol->blob);
+	lvol->reclaim_req = req;
+
+	SPDK_INFOLOG(lvol, "Reclaiming space of lvol %s\n", lvol->unique_id);
+	lvol_reclaim_schedule(req, 0);
+
+	return 0;
+}
+
+void
+spdk_lvol_get_reclaim_status(struct spdk_lvol *lvol, struct spdk_lvol_reclaim_status *status)
+{
+	*status = lvol->reclaim_status;
+}
+
+int
+spdk_lvol_get_changed_clusters(struct spdk_lvol *snapshot, struct spdk_lvol *base_snapshot,
+			       struct spdk_bit_array *clusters)
+{
+	spdk_blob_id base_id = SPDK_BLOBID_INVALID;
+
+	if (!spdk_blob_is_snapshot(snapshot->blob)) {
+		SPDK_ERRLOG("Lvol %s is not a snapshot\n", snapshot->unique_id);
+		return -EINVAL;
+	}
+
+	if (base_snapshot != NULL) {
+		if (base_snapshot->lvol_store != snapshot->lvol_store ||
+		    !spdk_blob_is_snapshot(base_snapshot->blob)) {
+			SPDK_ERRLOG("Lvol %s is not a snapshot in the lvolstore of %s\n",
+				    base_snapshot->unique_id, snapshot->unique_id);
+			return -EINVAL;
+		}
+		base_id = base_snapshot->blob_id;
+	}
+
+	return spdk_blob_get_changed_clusters(snapshot->blob, base_id, clusters);
+}
+
 void
 spdk_lvs_grow(struct spdk_bs_dev *bs_dev, spdk_lvs_op_with_handle_complete cb_fn, void *cb_arg)
 {
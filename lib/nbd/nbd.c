@@ -25,6 +25,15 @@
 #define NBD_STOP_BUSY_WAITING_MS	10000
 #define NBD_BUSY_POLLING_INTERVAL_US	20000
 #define NBD_IO_TIMEOUT_S		60
+#define NBD_MAX_CONNECTIONS		64
+/* Size of the buffer request headers are read ahead into */
+#define NBD_RECV_BUF_SIZE		4096
+/* Max number of iovecs gathered into a single writev() of replies */
+#define NBD_XMIT_IOV_MAX		64
+
+#ifndef NBD_FLAG_CAN_MULTI_CONN
+#define NBD_FLAG_CAN_MULTI_CONN		(1 << 8)
+#endif
 
 enum nbd_io_state_t {
 	/* Receiving or ready to receive nbd request header */
@@ -38,7 +47,7 @@ enum nbd_io_state_t {
 };
 
 struct nbd_io {
-	struct spdk_nbd_disk	*nbd;
+	struct nbd_conn		*conn;
 	enum nbd_io_state_t	state;
 
 	void			*payload;
@@ -59,33 +68,67 @@ struct nbd_io {
 	TAILQ_ENTRY(nbd_io)	tailq;
 };
 
-struct spdk_nbd_disk {
-	struct spdk_bdev	*bdev;
-	struct spdk_bdev_desc	*bdev_desc;
+/*
+ * A single socket handed to the kernel with NBD_SET_SOCK. Each connection is
+ * polled by its own SPDK thread, and all of its state is only touched from there.
+ */
+struct nbd_conn {
+	struct spdk_nbd_disk	*nbd;
+	struct spdk_thread	*thread;
+	/* The thread was created for this connection and exits along with it */
+	bool			own_thread;
 	struct spdk_io_channel	*ch;
-	int			dev_fd;
-	char			*nbd_path;
 	int			kernel_sp_fd;
 	int			spdk_sp_fd;
 	struct spdk_poller	*nbd_poller;
 	struct spdk_interrupt	*intr;
 	bool			interrupt_mode;
+
+	struct nbd_io		*io_in_recv;
+	TAILQ_HEAD(, nbd_io)	received_io_list;
+	TAILQ_HEAD(, nbd_io)	executed_io_list;
+	TAILQ_HEAD(, nbd_io)	processing_io_list;
+
+	/* No more requests are accepted */
+	bool			is_closing;
+	/* The socket failed, no more replies can be sent */
+	bool			is_broken;
+	/* The disk asked the connection to release its resources */
+	bool			is_stopping;
+	/* count of nbd_io in nbd_conn */
+	int			io_count;
+
+	/* Data read ahead from the socket, but not consumed yet */
+	uint32_t		recv_buf_offset;
+	uint32_t		recv_buf_len;
+	uint8_t			recv_buf[NBD_RECV_BUF_SIZE];
+};
+
+struct spdk_nbd_disk {
+	struct spdk_bdev	*bdev;
+	struct spdk_bdev_desc	*bdev_desc;
+	int			dev_fd;
+	char			*nbd_path;
 	uint32_t		buf_align;
+	char			*cpumask;
+
+	/* Thread the disk was started on, all the fields below are only accessed from it */
+	struct spdk_thread	*thread;
+	struct nbd_conn		*conns;
+	uint32_t		num_conns;
+	/* Number of connections handed to the kernel so far */
+	uint32_t		num_conns_set;
+	/* Number of connections still holding their poller and io channel */
+	uint32_t		num_conns_running;
 
 	struct spdk_poller	*retry_poller;
 	int			retry_count;
 	/* Synchronize nbd_start_kernel pthread and nbd_stop */
 	bool			has_nbd_pthread;
 
-	struct nbd_io		*io_in_recv;
-	TAILQ_HEAD(, nbd_io)	received_io_list;
-	TAILQ_HEAD(, nbd_io)	executed_io_list;
-	TAILQ_HEAD(, nbd_io)	processing_io_list;
-
 	bool			is_started;
 	bool			is_closing;
-	/* count of nbd_io in spdk_nbd_disk */
-	int			io_count;
+	bool			is_stopping;
 
 	TAILQ_ENTRY(spdk_nbd_disk)	tailq;
 };
@@ -100,8 +143,8 @@ static void *g_fini_cb_arg;
 
 static void _nbd_fini(void *arg1);
 
-static int nbd_submit_bdev_io(struct spdk_nbd_disk *nbd, struct nbd_io *io);
-static int nbd_io_recv_internal(struct spdk_nbd_disk *nbd);
+static int nbd_submit_bdev_io(struct nbd_conn *conn, struct nbd_io *io);
+static int nbd_io_recv_internal(struct nbd_conn *conn);
 
 int
 spdk_nbd_init(void)
@@ -210,6 +253,18 @@ nbd_disk_get_bdev_name(struct spdk_nbd_disk *nbd)
 	return spdk_bdev_get_name(nbd->bdev);
 }
 
+uint32_t
+nbd_disk_get_num_connections(struct spdk_nbd_disk *nbd)
+{
+	return nbd->num_conns;
+}
+
+const char *
+nbd_disk_get_cpumask(struct spdk_nbd_disk *nbd)
+{
+	return nbd->cpumask;
+}
+
 void
 spdk_nbd_write_config_json(struct spdk_json_write_ctx *w)
 {
@@ -225,6 +280,10 @@ spdk_nbd_write_config_json(struct spdk_json_write_ctx *w)
 		spdk_json_write_named_object_begin(w, "params");
 		spdk_json_write_named_string(w, "nbd_device",  nbd_disk_get_nbd_path(nbd));
 		spdk_json_write_named_string(w, "bdev_name", nbd_disk_get_bdev_name(nbd));
+		spdk_json_write_named_uint32(w, "num_connections", nbd->num_conns);
+		if (nbd->cpumask) {
+			spdk_json_write_named_string(w, "cpumask", nbd->cpumask);
+		}
 		spdk_json_write_object_end(w);
 
 		spdk_json_write_object_end(w);
@@ -245,7 +304,7 @@ nbd_disconnect(struct spdk_nbd_disk *nbd)
 }
 
 static struct nbd_io *
-nbd_get_io(struct spdk_nbd_disk *nbd)
+nbd_get_io(struct nbd_conn *conn)
 {
 	struct nbd_io *io;
 
@@ -254,23 +313,23 @@ nbd_get_io(struct spdk_nbd_disk *nbd)
 		return NULL;
 	}
 
-	io->nbd = nbd;
+	io->conn = conn;
 	to_be32(&io->resp.magic, NBD_REPLY_MAGIC);
 
-	nbd->io_count++;
+	conn->io_count++;
 
 	return io;
 }
 
 static void
-nbd_put_io(struct spdk_nbd_disk *nbd, struct nbd_io *io)
+nbd_put_io(struct nbd_conn *conn, struct nbd_io *io)
 {
 	if (io->payload) {
 		spdk_free(io->payload);
 	}
 	free(io);
 
-	nbd->io_count--;
+	conn->io_count--;
 }
 
 /*
@@ -281,22 +340,22 @@ nbd_put_io(struct spdk_nbd_disk *nbd, struct nbd_io *io)
  *         0 all nbd_io gotten are freed.
  */
 static int
-nbd_cleanup_io(struct spdk_nbd_disk *nbd)
+nbd_cleanup_io(struct nbd_conn *conn)
 {
 	/* Try to read the remaining nbd commands in the socket */
-	while (nbd_io_recv_internal(nbd) > 0);
+	while (nbd_io_recv_internal(conn) > 0);
 
 	/* free io_in_recv */
-	if (nbd->io_in_recv != NULL) {
-		nbd_put_io(nbd, nbd->io_in_recv);
-		nbd->io_in_recv = NULL;
+	if (conn->io_in_recv != NULL) {
+		nbd_put_io(conn, conn->io_in_recv);
+		conn->io_in_recv = NULL;
 	}
 
 	/*
 	 * Some nbd_io may be under executing in bdev.
 	 * Wait for their done operation.
 	 */
-	if (nbd->io_count != 0) {
+	if (conn->io_count != 0) {
 		return 1;
 	}
 
@@ -307,23 +366,23 @@ static int
 _nbd_stop(void *arg)
 {
 	struct spdk_nbd_disk *nbd = arg;
+	struct nbd_conn *conn;
+	uint32_t i;
 
-	if (nbd->nbd_poller) {
-		spdk_poller_unregister(&nbd->nbd_poller);
-	}
+	assert(nbd->num_conns_running == 0);
 
-	if (nbd->intr) {
-		spdk_interrupt_unregister(&nbd->intr);
-	}
+	for (i = 0; nbd->conns && i < nbd->num_conns; i++) {
+		conn = &nbd->conns[i];
 
-	if (nbd->spdk_sp_fd >= 0) {
-		close(nbd->spdk_sp_fd);
-		nbd->spdk_sp_fd = -1;
-	}
+		if (conn->spdk_sp_fd >= 0) {
+			close(conn->spdk_sp_fd);
+			conn->spdk_sp_fd = -1;
+		}
 
-	if (nbd->kernel_sp_fd >= 0) {
-		close(nbd->kernel_sp_fd);
-		nbd->kernel_sp_fd = -1;
+		if (conn->kernel_sp_fd >= 0) {
+			close(conn->kernel_sp_fd);
+			conn->kernel_sp_fd = -1;
+		}
 	}
 
 	/* Continue the stop procedure after the exit of nbd_start_kernel pthread */
@@ -359,11 +418,6 @@ _nbd_stop(void *arg)
 		free(nbd->nbd_path);
 	}
 
-	if (nbd->ch) {
-		spdk_put_io_channel(nbd->ch);
-		nbd->ch = NULL;
-	}
-
 	if (nbd->bdev_desc) {
 		spdk_bdev_close(nbd->bdev_desc);
 		nbd->bdev_desc = NULL;
@@ -371,18 +425,80 @@ _nbd_stop(void *arg)
 
 	nbd_disk_unregister(nbd);
 
+	free(nbd->conns);
+	free(nbd->cpumask);
 	free(nbd);
 
 	return 0;
 }
 
+static void
+nbd_conn_stopped(void *arg)
+{
+	struct nbd_conn *conn = arg;
+	struct spdk_nbd_disk *nbd = conn->nbd;
+
+	assert(nbd->num_conns_running > 0);
+	if (--nbd->num_conns_running == 0) {
+		_nbd_stop(nbd);
+	}
+}
+
+static void
+nbd_conn_try_stop(struct nbd_conn *conn)
+{
+	struct nbd_io *io, *io_tmp;
+
+	if (conn->is_broken) {
+		/* Replies cannot be delivered anymore, drop them */
+		TAILQ_FOREACH_SAFE(io, &conn->executed_io_list, tailq, io_tmp) {
+			TAILQ_REMOVE(&conn->executed_io_list, io, tailq);
+			nbd_put_io(conn, io);
+		}
+	}
+
+	/*
+	 * Stop action should be called only after all nbd_io are executed.
+	 */
+	if (nbd_cleanup_io(conn)) {
+		return;
+	}
+
+	spdk_poller_unregister(&conn->nbd_poller);
+	if (conn->intr) {
+		spdk_interrupt_unregister(&conn->intr);
+	}
+
+	if (conn->ch) {
+		spdk_put_io_channel(conn->ch);
+		conn->ch = NULL;
+	}
+
+	spdk_thread_send_msg(conn->nbd->thread, nbd_conn_stopped, conn);
+
+	if (conn->own_thread) {
+		spdk_thread_exit(spdk_get_thread());
+	}
+}
+
+static void
+nbd_conn_stop(void *arg)
+{
+	struct nbd_conn *conn = arg;
+
+	conn->is_closing = true;
+	conn->is_stopping = true;
+
+	nbd_conn_try_stop(conn);
+}
+
 int
 spdk_nbd_stop(struct spdk_nbd_disk *nbd)
 {
-	int rc = 0;
+	uint32_t i;
 
 	if (nbd == NULL) {
-		return rc;
+		return 0;
 	}
 
 	nbd->is_closing = true;
@@ -392,16 +508,41 @@ spdk_nbd_stop(struct spdk_nbd_disk *nbd)
 		return 1;
 	}
 
+	if (nbd->is_stopping) {
+		return 0;
+	}
+
 	/*
-	 * Stop action should be called only after all nbd_io are executed.
+	 * Each connection waits for its own nbd_io to be executed and
+	 * reports back once it released its resources.
 	 */
+	nbd->is_stopping = true;
+	for (i = 0; i < nbd->num_conns; i++) {
+		spdk_thread_send_msg(nbd->conns[i].thread, nbd_conn_stop, &nbd->conns[i]);
+	}
 
-	rc = nbd_cleanup_io(nbd);
-	if (!rc) {
-		_nbd_stop(nbd);
+	return 0;
+}
+
+static void
+_nbd_disk_stop(void *arg)
+{
+	spdk_nbd_stop(arg);
+}
+
+/*
+ * Stop accepting requests on the connection and have the disk stop
+ * all of its connections. Only called from the connection's thread.
+ */
+static void
+nbd_conn_close(struct nbd_conn *conn)
+{
+	if (conn->is_closing) {
+		return;
 	}
 
-	return rc;
+	conn->is_closing = true;
+	spdk_thread_send_msg(conn->nbd->thread, _nbd_disk_stop, conn->nbd);
 }
 
 static int64_t
@@ -427,11 +568,50 @@ nbd_socket_rw(int fd, void *buf, size_t length, bool read_op)
 	}
 }
 
+/*
+ * Read up to length bytes of the request stream. Data already read ahead is consumed
+ * first. Request headers are small, so they are read through the read ahead buffer,
+ * which lets a single read() pick up all the requests queued by the kernel. Payloads
+ * go straight from the socket into their buffer.
+ */
+static int64_t
+nbd_conn_recv(struct nbd_conn *conn, void *buf, size_t length, bool read_ahead)
+{
+	uint32_t len;
+	int64_t rc;
+
+	if (conn->recv_buf_offset == conn->recv_buf_len) {
+		if (!read_ahead) {
+			return nbd_socket_rw(conn->spdk_sp_fd, buf, length, true);
+		}
+
+		rc = nbd_socket_rw(conn->spdk_sp_fd, conn->recv_buf, sizeof(conn->recv_buf), true);
+		if (rc <= 0) {
+			return rc;
+		}
+
+		conn->recv_buf_offset = 0;
+		conn->recv_buf_len = rc;
+	}
+
+	len = spdk_min(length, conn->recv_buf_len - conn->recv_buf_offset);
+	memcpy(buf, conn->recv_buf + conn->recv_buf_offset, len);
+	conn->recv_buf_offset += len;
+
+	return len;
+}
+
+static inline bool
+nbd_conn_has_read_ahead(struct nbd_conn *conn)
+{
+	return conn->recv_buf_offset < conn->recv_buf_len;
+}
+
 static void
 nbd_io_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
 {
 	struct nbd_io	*io = cb_arg;
-	struct spdk_nbd_disk *nbd = io->nbd;
+	struct nbd_conn *conn = io->conn;
 
 	if (success) {
 		io->resp.error = 0;
@@ -444,12 +624,12 @@ nbd_io_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
 	/* When there begins to have executed_io, enable socket writable notice in order to
 	 * get it processed in nbd_io_xmit
 	 */
-	if (nbd->interrupt_mode && TAILQ_EMPTY(&nbd->executed_io_list)) {
-		spdk_interrupt_set_event_types(nbd->intr, SPDK_INTERRUPT_EVENT_IN | SPDK_INTERRUPT_EVENT_OUT);
+	if (conn->interrupt_mode && TAILQ_EMPTY(&conn->executed_io_list)) {
+		spdk_interrupt_set_event_types(conn->intr, SPDK_INTERRUPT_EVENT_IN | SPDK_INTERRUPT_EVENT_OUT);
 	}
 
-	TAILQ_REMOVE(&nbd->processing_io_list, io, tailq);
-	TAILQ_INSERT_TAIL(&nbd->executed_io_list, io, tailq);
+	TAILQ_REMOVE(&conn->processing_io_list, io, tailq);
+	TAILQ_INSERT_TAIL(&conn->executed_io_list, io, tailq);
 
 	if (bdev_io != NULL) {
 		spdk_bdev_free_io(bdev_io);
@@ -460,13 +640,13 @@ static void
 nbd_resubmit_io(void *arg)
 {
 	struct nbd_io *io = (struct nbd_io *)arg;
-	struct spdk_nbd_disk *nbd = io->nbd;
+	struct nbd_conn *conn = io->conn;
 	int rc = 0;
 
-	rc = nbd_submit_bdev_io(nbd, io);
+	rc = nbd_submit_bdev_io(conn, io);
 	if (rc) {
 		SPDK_INFOLOG(nbd, "nbd: io resubmit for dev %s , io_type %d, returned %d.\n",
-			     nbd_disk_get_bdev_name(nbd), from_be32(&io->req.type), rc);
+			     nbd_disk_get_bdev_name(conn->nbd), from_be32(&io->req.type), rc);
 	}
 }
 
@@ -474,13 +654,13 @@ static void
 nbd_queue_io(struct nbd_io *io)
 {
 	int rc;
-	struct spdk_bdev *bdev = io->nbd->bdev;
+	struct spdk_bdev *bdev = io->conn->nbd->bdev;
 
 	io->bdev_io_wait.bdev = bdev;
 	io->bdev_io_wait.cb_fn = nbd_resubmit_io;
 	io->bdev_io_wait.cb_arg = io;
 
-	rc = spdk_bdev_queue_io_wait(bdev, io->nbd->ch, &io->bdev_io_wait);
+	rc = spdk_bdev_queue_io_wait(bdev, io->conn->ch, &io->bdev_io_wait);
 	if (rc != 0) {
 		SPDK_ERRLOG("Queue io failed in nbd_queue_io, rc=%d.\n", rc);
 		nbd_io_done(NULL, false, io);
@@ -488,10 +668,11 @@ nbd_queue_io(struct nbd_io *io)
 }
 
 static int
-nbd_submit_bdev_io(struct spdk_nbd_disk *nbd, struct nbd_io *io)
+nbd_submit_bdev_io(struct nbd_conn *conn, struct nbd_io *io)
 {
+	struct spdk_nbd_disk *nbd = conn->nbd;
 	struct spdk_bdev_desc *desc = nbd->bdev_desc;
-	struct spdk_io_channel *ch = nbd->ch;
+	struct spdk_io_channel *ch = conn->ch;
 	int rc = 0;
 
 	switch (from_be32(&io->req.type)) {
@@ -534,17 +715,17 @@ nbd_submit_bdev_io(struct spdk_nbd_disk *nbd, struct nbd_io *io)
 }
 
 static int
-nbd_io_exec(struct spdk_nbd_disk *nbd)
+nbd_io_exec(struct nbd_conn *conn)
 {
 	struct nbd_io *io, *io_tmp;
 	int io_count = 0;
 	int ret = 0;
 
-	if (!TAILQ_EMPTY(&nbd->received_io_list)) {
-		TAILQ_FOREACH_SAFE(io, &nbd->received_io_list, tailq, io_tmp) {
-			TAILQ_REMOVE(&nbd->received_io_list, io, tailq);
-			TAILQ_INSERT_TAIL(&nbd->processing_io_list, io, tailq);
-			ret = nbd_submit_bdev_io(nbd, io);
+	if (!TAILQ_EMPTY(&conn->received_io_list)) {
+		TAILQ_FOREACH_SAFE(io, &conn->received_io_list, tailq, io_tmp) {
+			TAILQ_REMOVE(&conn->received_io_list, io, tailq);
+			TAILQ_INSERT_TAIL(&conn->processing_io_list, io, tailq);
+			ret = nbd_submit_bdev_io(conn, io);
 			if (ret < 0) {
 				return ret;
 			}
@@ -556,28 +737,41 @@ nbd_io_exec(struct spdk_nbd_disk *nbd)
 	return io_count;
 }
 
+static void
+nbd_io_received(struct nbd_conn *conn, struct nbd_io *io)
+{
+	io->state = NBD_IO_XMIT_RESP;
+	if (spdk_likely(!conn->is_closing)) {
+		TAILQ_INSERT_TAIL(&conn->received_io_list, io, tailq);
+	} else {
+		TAILQ_INSERT_TAIL(&conn->processing_io_list, io, tailq);
+		nbd_io_done(NULL, false, io);
+	}
+	conn->io_in_recv = NULL;
+}
+
 static int
-nbd_io_recv_internal(struct spdk_nbd_disk *nbd)
+nbd_io_recv_internal(struct nbd_conn *conn)
 {
 	struct nbd_io *io;
 	int ret = 0;
 	int received = 0;
 
-	if (nbd->io_in_recv == NULL) {
-		nbd->io_in_recv = nbd_get_io(nbd);
-		if (!nbd->io_in_recv) {
+	if (conn->io_in_recv == NULL) {
+		conn->io_in_recv = nbd_get_io(conn);
+		if (!conn->io_in_recv) {
 			return -ENOMEM;
 		}
 	}
 
-	io = nbd->io_in_recv;
+	io = conn->io_in_recv;
 
 	if (io->state == NBD_IO_RECV_REQ) {
-		ret = nbd_socket_rw(nbd->spdk_sp_fd, (char *)&io->req + io->offset,
+		ret = nbd_conn_recv(conn, (char *)&io->req + io->offset,
 				    sizeof(io->req) - io->offset, true);
 		if (ret < 0) {
-			nbd_put_io(nbd, io);
-			nbd->io_in_recv = NULL;
+			nbd_put_io(conn, io);
+			conn->io_in_recv = NULL;
 			return ret;
 		}
 
@@ -591,18 +785,18 @@ nbd_io_recv_internal(struct spdk_nbd_disk *nbd)
 			/* req magic check */
 			if (from_be32(&io->req.magic) != NBD_REQUEST_MAGIC) {
 				SPDK_ERRLOG("invalid request magic\n");
-				nbd_put_io(nbd, io);
-				nbd->io_in_recv = NULL;
+				nbd_put_io(conn, io);
+				conn->io_in_recv = NULL;
 				return -EINVAL;
 			}
 
 			if (from_be32(&io->req.type) == NBD_CMD_DISC) {
-				nbd->is_closing = true;
-				nbd->io_in_recv = NULL;
-				if (nbd->interrupt_mode && TAILQ_EMPTY(&nbd->executed_io_list)) {
-					spdk_interrupt_set_event_types(nbd->intr, SPDK_INTERRUPT_EVENT_IN | SPDK_INTERRUPT_EVENT_OUT);
+				nbd_conn_close(conn);
+				conn->io_in_recv = NULL;
+				if (conn->interrupt_mode && TAILQ_EMPTY(&conn->executed_io_list)) {
+					spdk_interrupt_set_event_types(conn->intr, SPDK_INTERRUPT_EVENT_IN | SPDK_INTERRUPT_EVENT_OUT);
 				}
-				nbd_put_io(nbd, io);
+				nbd_put_io(conn, io);
 				/* After receiving NBD_CMD_DISC, nbd will not receive any new commands */
 				return received;
 			}
@@ -617,12 +811,12 @@ nbd_io_recv_internal(struct spdk_nbd_disk *nbd)
 
 			/* io payload allocate */
 			if (io->payload_size) {
-				io->payload = spdk_malloc(io->payload_size, nbd->buf_align, NULL,
+				io->payload = spdk_malloc(io->payload_size, conn->nbd->buf_align, NULL,
 							  SPDK_ENV_LCORE_ID_ANY, SPDK_MALLOC_DMA);
 				if (io->payload == NULL) {
 					SPDK_ERRLOG("could not allocate io->payload of size %d\n", io->payload_size);
-					nbd_put_io(nbd, io);
-					nbd->io_in_recv = NULL;
+					nbd_put_io(conn, io);
+					conn->io_in_recv = NULL;
 					return -ENOMEM;
 				}
 			} else {
@@ -633,23 +827,16 @@ nbd_io_recv_internal(struct spdk_nbd_disk *nbd)
 			if (from_be32(&io->req.type) == NBD_CMD_WRITE) {
 				io->state = NBD_IO_RECV_PAYLOAD;
 			} else {
-				io->state = NBD_IO_XMIT_RESP;
-				if (spdk_likely((!nbd->is_closing) && nbd->is_started)) {
-					TAILQ_INSERT_TAIL(&nbd->received_io_list, io, tailq);
-				} else {
-					TAILQ_INSERT_TAIL(&nbd->processing_io_list, io, tailq);
-					nbd_io_done(NULL, false, io);
-				}
-				nbd->io_in_recv = NULL;
+				nbd_io_received(conn, io);
 			}
 		}
 	}
 
 	if (io->state == NBD_IO_RECV_PAYLOAD) {
-		ret = nbd_socket_rw(nbd->spdk_sp_fd, io->payload + io->offset, io->payload_size - io->offset, true);
+		ret = nbd_conn_recv(conn, io->payload + io->offset, io->payload_size - io->offset, false);
 		if (ret < 0) {
-			nbd_put_io(nbd, io);
-			nbd->io_in_recv = NULL;
+			nbd_put_io(conn, io);
+			conn->io_in_recv = NULL;
 			return ret;
 		}
 
@@ -659,14 +846,7 @@ nbd_io_recv_internal(struct spdk_nbd_disk *nbd)
 		/* request payload is fully received */
 		if (io->offset == io->payload_size) {
 			io->offset = 0;
-			io->state = NBD_IO_XMIT_RESP;
-			if (spdk_likely((!nbd->is_closing) && nbd->is_started)) {
-				TAILQ_INSERT_TAIL(&nbd->received_io_list, io, tailq);
-			} else {
-				TAILQ_INSERT_TAIL(&nbd->processing_io_list, io, tailq);
-				nbd_io_done(NULL, false, io);
-			}
-			nbd->io_in_recv = NULL;
+			nbd_io_received(conn, io);
 		}
 
 	}
@@ -675,24 +855,29 @@ nbd_io_recv_internal(struct spdk_nbd_disk *nbd)
 }
 
 static int
-nbd_io_recv(struct spdk_nbd_disk *nbd)
+nbd_io_recv(struct nbd_conn *conn)
 {
 	int i, rc, ret = 0;
 
 	/*
 	 * nbd server should not accept request after closing command
 	 */
-	if (nbd->is_closing) {
+	if (conn->is_closing) {
 		return 0;
 	}
 
-	for (i = 0; i < GET_IO_LOOP_COUNT; i++) {
-		rc = nbd_io_recv_internal(nbd);
+	/*
+	 * Keep going past GET_IO_LOOP_COUNT while requests are left in the read ahead
+	 * buffer. In interrupt mode nothing would wake the connection up for them, the
+	 * socket only becomes readable again when the kernel sends more.
+	 */
+	for (i = 0; i < GET_IO_LOOP_COUNT || nbd_conn_has_read_ahead(conn); i++) {
+		rc = nbd_io_recv_internal(conn);
 		if (rc < 0) {
 			return rc;
 		}
 		ret += rc;
-		if (nbd->is_closing) {
+		if (conn->is_closing) {
 			break;
 		}
 	}
@@ -700,117 +885,150 @@ nbd_io_recv(struct spdk_nbd_disk *nbd)
 	return ret;
 }
 
-static int
-nbd_io_xmit_internal(struct spdk_nbd_disk *nbd)
+static bool
+nbd_io_has_read_payload(struct nbd_io *io)
 {
-	struct nbd_io *io;
-	int ret = 0;
-	int sent = 0;
-
-	io = TAILQ_FIRST(&nbd->executed_io_list);
-	if (io == NULL) {
-		return 0;
-	}
+	/* transmit payload only when NBD_CMD_READ with no resp error */
+	return from_be32(&io->req.type) == NBD_CMD_READ && io->resp.error == 0;
+}
 
-	/* Remove IO from list now assuming it will be completed.  It will be inserted
-	 *  back to the head if it cannot be completed.  This approach is specifically
-	 *  taken to work around a scan-build use-after-free mischaracterization.
-	 */
-	TAILQ_REMOVE(&nbd->executed_io_list, io, tailq);
+/*
+ * Account sent bytes to the replies at the head of executed_io_list.
+ * Fully transmitted nbd_io are put back.
+ */
+static void
+nbd_io_xmit_complete(struct nbd_conn *conn, size_t sent)
+{
+	struct nbd_io *io;
+	size_t len;
 
-	/* resp error and handler are already set in io_done */
+	while (sent > 0) {
+		io = TAILQ_FIRST(&conn->executed_io_list);
+		assert(io != NULL);
 
-	if (io->state == NBD_IO_XMIT_RESP) {
-		ret = nbd_socket_rw(nbd->spdk_sp_fd, (char *)&io->resp + io->offset,
-				    sizeof(io->resp) - io->offset, false);
-		if (ret <= 0) {
-			goto reinsert;
-		}
+		if (io->state == NBD_IO_XMIT_RESP) {
+			len = spdk_min(sent, sizeof(io->resp) - io->offset);
+			io->offset += len;
+			sent -= len;
 
-		io->offset += ret;
-		sent = ret;
+			/* response is not fully transmitted */
+			if (io->offset < sizeof(io->resp)) {
+				break;
+			}
 
-		/* response is fully transmitted */
-		if (io->offset == sizeof(io->resp)) {
 			io->offset = 0;
-
-			/* transmit payload only when NBD_CMD_READ with no resp error */
-			if (from_be32(&io->req.type) != NBD_CMD_READ || io->resp.error != 0) {
-				nbd_put_io(nbd, io);
-				return 0;
-			} else {
-				io->state = NBD_IO_XMIT_PAYLOAD;
+			if (!nbd_io_has_read_payload(io)) {
+				TAILQ_REMOVE(&conn->executed_io_list, io, tailq);
+				nbd_put_io(conn, io);
+				continue;
 			}
-		}
-	}
 
-	if (io->state == NBD_IO_XMIT_PAYLOAD) {
-		ret = nbd_socket_rw(nbd->spdk_sp_fd, io->payload + io->offset, io->payload_size - io->offset,
-				    false);
-		if (ret <= 0) {
-			goto reinsert;
+			io->state = NBD_IO_XMIT_PAYLOAD;
 		}
 
-		io->offset += ret;
-		sent += ret;
+		len = spdk_min(sent, io->payload_size - io->offset);
+		io->offset += len;
+		sent -= len;
 
-		/* read payload is fully transmitted */
-		if (io->offset == io->payload_size) {
-			nbd_put_io(nbd, io);
-			return sent;
+		/* read payload is not fully transmitted */
+		if (io->offset < io->payload_size) {
+			break;
 		}
-	}
 
-reinsert:
-	TAILQ_INSERT_HEAD(&nbd->executed_io_list, io, tailq);
-	return ret < 0 ? ret : sent;
+		TAILQ_REMOVE(&conn->executed_io_list, io, tailq);
+		nbd_put_io(conn, io);
+	}
 }
 
+/*
+ * Transmit the executed nbd_io. Responses and read payloads of several
+ * nbd_io are gathered, so that they are sent by a single writev() call.
+ */
 static int
-nbd_io_xmit(struct spdk_nbd_disk *nbd)
+nbd_io_xmit(struct nbd_conn *conn)
 {
+	struct iovec iovs[NBD_XMIT_IOV_MAX];
+	struct nbd_io *io;
+	ssize_t rc;
+	size_t len;
+	int iovcnt;
 	int ret = 0;
-	int rc;
 
-	while (!TAILQ_EMPTY(&nbd->executed_io_list)) {
-		rc = nbd_io_xmit_internal(nbd);
+	while (!TAILQ_EMPTY(&conn->executed_io_list)) {
+		iovcnt = 0;
+		len = 0;
+
+		/* resp error and handler are already set in io_done */
+		TAILQ_FOREACH(io, &conn->executed_io_list, tailq) {
+			if (iovcnt + 2 > NBD_XMIT_IOV_MAX) {
+				break;
+			}
+
+			if (io->state == NBD_IO_XMIT_RESP) {
+				iovs[iovcnt].iov_base = (char *)&io->resp + io->offset;
+				iovs[iovcnt].iov_len = sizeof(io->resp) - io->offset;
+				len += iovs[iovcnt++].iov_len;
+				if (nbd_io_has_read_payload(io) && io->payload_size) {
+					iovs[iovcnt].iov_base = io->payload;
+					iovs[iovcnt].iov_len = io->payload_size;
+					len += iovs[iovcnt++].iov_len;
+				}
+			} else {
+				iovs[iovcnt].iov_base = (char *)io->payload + io->offset;
+				iovs[iovcnt].iov_len = io->payload_size - io->offset;
+				len += iovs[iovcnt++].iov_len;
+			}
+		}
+
+		rc = writev(conn->spdk_sp_fd, iovs, iovcnt);
 		if (rc < 0) {
-			return rc;
+			if (errno != EAGAIN) {
+				return -errno;
+			}
+			break;
+		} else if (rc == 0) {
+			return -EIO;
 		}
 
+		nbd_io_xmit_complete(conn, rc);
 		ret += rc;
+
+		/* socket buffer is full */
+		if ((size_t)rc < len) {
+			break;
+		}
 	}
 
 	/* When there begins to have no executed_io, disable socket writable notice */
-	if (nbd->interrupt_mode) {
-		spdk_interrupt_set_event_types(nbd->intr, SPDK_INTERRUPT_EVENT_IN);
+	if (conn->interrupt_mode && TAILQ_EMPTY(&conn->executed_io_list)) {
+		spdk_interrupt_set_event_types(conn->intr, SPDK_INTERRUPT_EVENT_IN);
 	}
 
 	return ret;
 }
 
 /**
- * Poll an NBD instance.
+ * Poll an NBD connection.
  *
  * \return 0 on success or negated errno values on error (e.g. connection closed).
  */
 static int
-_nbd_poll(struct spdk_nbd_disk *nbd)
+_nbd_poll(struct nbd_conn *conn)
 {
 	int received, sent, executed;
 
 	/* transmit executed io first */
-	sent = nbd_io_xmit(nbd);
+	sent = nbd_io_xmit(conn);
 	if (sent < 0) {
 		return sent;
 	}
 
-	received = nbd_io_recv(nbd);
+	received = nbd_io_recv(conn);
 	if (received < 0) {
 		return received;
 	}
 
-	executed = nbd_io_exec(nbd);
+	executed = nbd_io_exec(conn);
 	if (executed < 0) {
 		return executed;
 	}
@@ -821,21 +1039,24 @@ _nbd_poll(struct spdk_nbd_disk *nbd)
 static int
 nbd_poll(void *arg)
 {
-	struct spdk_nbd_disk *nbd = arg;
-	int rc;
+	struct nbd_conn *conn = arg;
+	int rc = 0;
 
-	rc = _nbd_poll(nbd);
-	if (rc < 0) {
-		SPDK_INFOLOG(nbd, "nbd_poll() returned %s (%d); closing connection\n",
-			     spdk_strerror(-rc), rc);
-		_nbd_stop(nbd);
-		return SPDK_POLLER_IDLE;
+	if (spdk_likely(!conn->is_broken)) {
+		rc = _nbd_poll(conn);
+		if (rc < 0) {
+			SPDK_INFOLOG(nbd, "nbd_poll() returned %s (%d); closing connection\n",
+				     spdk_strerror(-rc), rc);
+			conn->is_broken = true;
+			nbd_conn_close(conn);
+		}
 	}
-	if (nbd->is_closing) {
-		spdk_nbd_stop(nbd);
+
+	if (conn->is_stopping) {
+		nbd_conn_try_stop(conn);
 	}
 
-	return rc == 0 ? SPDK_POLLER_IDLE : SPDK_POLLER_BUSY;
+	return rc > 0 ? SPDK_POLLER_BUSY : SPDK_POLLER_IDLE;
 }
 
 static void *
@@ -845,7 +1066,7 @@ nbd_start_kernel(void *arg)
 
 	spdk_unaffinitize_thread();
 
-	/* This will block in the kernel until we close the spdk_sp_fd. */
+	/* This will block in the kernel until we close all the spdk_sp_fd. */
 	ioctl(nbd->dev_fd, NBD_DO_IT);
 
 	nbd->has_nbd_pthread = false;
@@ -854,26 +1075,41 @@ nbd_start_kernel(void *arg)
 }
 
 static void
-nbd_bdev_hot_remove(struct spdk_nbd_disk *nbd)
+nbd_conn_hot_remove(void *arg)
 {
+	struct nbd_conn *conn = arg;
 	struct nbd_io *io, *io_tmp;
 
-	nbd->is_closing = true;
-	nbd_cleanup_io(nbd);
+	conn->is_closing = true;
+	nbd_cleanup_io(conn);
 
-	if (!TAILQ_EMPTY(&nbd->received_io_list)) {
-		TAILQ_FOREACH_SAFE(io, &nbd->received_io_list, tailq, io_tmp) {
-			TAILQ_REMOVE(&nbd->received_io_list, io, tailq);
-			TAILQ_INSERT_TAIL(&nbd->processing_io_list, io, tailq);
+	if (!TAILQ_EMPTY(&conn->received_io_list)) {
+		TAILQ_FOREACH_SAFE(io, &conn->received_io_list, tailq, io_tmp) {
+			TAILQ_REMOVE(&conn->received_io_list, io, tailq);
+			TAILQ_INSERT_TAIL(&conn->processing_io_list, io, tailq);
 		}
 	}
-	if (!TAILQ_EMPTY(&nbd->processing_io_list)) {
-		TAILQ_FOREACH_SAFE(io, &nbd->processing_io_list, tailq, io_tmp) {
+	if (!TAILQ_EMPTY(&conn->processing_io_list)) {
+		TAILQ_FOREACH_SAFE(io, &conn->processing_io_list, tailq, io_tmp) {
 			nbd_io_done(NULL, false, io);
 		}
 	}
 }
 
+static void
+nbd_bdev_hot_remove(struct spdk_nbd_disk *nbd)
+{
+	uint32_t i;
+
+	if (nbd->is_started && !nbd->is_stopping) {
+		for (i = 0; i < nbd->num_conns; i++) {
+			spdk_thread_send_msg(nbd->conns[i].thread, nbd_conn_hot_remove, &nbd->conns[i]);
+		}
+	}
+
+	spdk_nbd_stop(nbd);
+}
+
 static void
 nbd_bdev_event_cb(enum spdk_bdev_event_type type, struct spdk_bdev *bdev,
 		  void *event_ctx)
@@ -897,9 +1133,114 @@ struct spdk_nbd_start_ctx {
 static void
 nbd_poller_set_interrupt_mode(struct spdk_poller *poller, void *cb_arg, bool interrupt_mode)
 {
-	struct spdk_nbd_disk *nbd = cb_arg;
+	struct nbd_conn *conn = cb_arg;
+
+	conn->interrupt_mode = interrupt_mode;
+}
+
+static void
+nbd_conn_start(void *arg)
+{
+	struct nbd_conn *conn = arg;
+
+	conn->ch = spdk_bdev_get_io_channel(conn->nbd->bdev_desc);
+	if (conn->ch == NULL) {
+		SPDK_ERRLOG("could not get io channel for %s\n", conn->nbd->nbd_path);
+		conn->is_broken = true;
+		nbd_conn_close(conn);
+	}
+
+	if (spdk_interrupt_mode_is_enabled()) {
+		conn->intr = SPDK_INTERRUPT_REGISTER(conn->spdk_sp_fd, nbd_poll, conn);
+	}
+
+	conn->nbd_poller = SPDK_POLLER_REGISTER(nbd_poll, conn, 0);
+	spdk_poller_register_interrupt(conn->nbd_poller, nbd_poller_set_interrupt_mode, conn);
+}
+
+static void
+_nbd_thread_exit(void *arg)
+{
+	spdk_thread_exit(spdk_get_thread());
+}
+
+static void
+nbd_conns_put_threads(struct spdk_nbd_disk *nbd)
+{
+	struct nbd_conn *conn;
+	uint32_t i;
+
+	for (i = 0; i < nbd->num_conns; i++) {
+		conn = &nbd->conns[i];
+		if (conn->own_thread) {
+			spdk_thread_send_msg(conn->thread, _nbd_thread_exit, NULL);
+			conn->own_thread = false;
+		}
+		conn->thread = NULL;
+	}
+}
+
+/*
+ * Assign an SPDK thread to each connection. A disk with a single connection
+ * and no cpumask is served by the thread it was started on. Otherwise every
+ * connection gets a dedicated thread, pinned round-robin to the cores of the
+ * cpumask if one was given.
+ */
+static int
+nbd_conns_get_threads(struct spdk_nbd_disk *nbd)
+{
+	struct spdk_cpuset cpumask, thread_cpumask;
+	uint32_t cores[SPDK_CPUSET_SIZE];
+	uint32_t i, core, num_cores = 0;
+	const char *dev_name;
+	char thread_name[32];
+
+	if (nbd->num_conns == 1 && nbd->cpumask == NULL) {
+		nbd->conns[0].thread = nbd->thread;
+		return 0;
+	}
+
+	if (nbd->cpumask) {
+		if (spdk_cpuset_parse(&cpumask, nbd->cpumask) != 0) {
+			SPDK_ERRLOG("invalid cpumask %s\n", nbd->cpumask);
+			return -EINVAL;
+		}
+
+		SPDK_ENV_FOREACH_CORE(core) {
+			if (spdk_cpuset_get_cpu(&cpumask, core)) {
+				cores[num_cores++] = core;
+			}
+		}
+
+		if (num_cores == 0) {
+			SPDK_ERRLOG("cpumask %s does not contain any core of the application\n", nbd->cpumask);
+			return -EINVAL;
+		}
+	}
 
-	nbd->interrupt_mode = interrupt_mode;
+	dev_name = strrchr(nbd->nbd_path, '/');
+	dev_name = dev_name ? dev_name + 1 : nbd->nbd_path;
+
+	for (i = 0; i < nbd->num_conns; i++) {
+		snprintf(thread_name, sizeof(thread_name), "%s.%" PRIu32, dev_name, i);
+
+		if (num_cores > 0) {
+			spdk_cpuset_zero(&thread_cpumask);
+			spdk_cpuset_set_cpu(&thread_cpumask, cores[i % num_cores], true);
+			nbd->conns[i].thread = spdk_thread_create(thread_name, &thread_cpumask);
+		} else {
+			nbd->conns[i].thread = spdk_thread_create(thread_name, NULL);
+		}
+
+		if (nbd->conns[i].thread == NULL) {
+			SPDK_ERRLOG("could not create thread %s\n", thread_name);
+			nbd_conns_put_threads(nbd);
+			return -ENOMEM;
+		}
+		nbd->conns[i].own_thread = true;
+	}
+
+	return 0;
 }
 
 static void
@@ -908,6 +1249,7 @@ nbd_start_complete(struct spdk_nbd_start_ctx *ctx)
 	int		rc;
 	pthread_t	tid;
 	unsigned long	nbd_flags = 0;
+	uint32_t	i;
 
 	rc = ioctl(ctx->nbd->dev_fd, NBD_SET_BLKSIZE, spdk_bdev_get_block_size(ctx->nbd->bdev));
 	if (rc == -1) {
@@ -944,6 +1286,10 @@ nbd_start_complete(struct spdk_nbd_start_ctx *ctx)
 		nbd_flags |= NBD_FLAG_SEND_TRIM;
 	}
 #endif
+	/* The kernel refuses to use more than one socket unless the server allows it */
+	if (ctx->nbd->num_conns > 1) {
+		nbd_flags |= NBD_FLAG_CAN_MULTI_CONN;
+	}
 
 	if (nbd_flags) {
 		rc = ioctl(ctx->nbd->dev_fd, NBD_SET_FLAGS, nbd_flags);
@@ -954,39 +1300,47 @@ nbd_start_complete(struct spdk_nbd_start_ctx *ctx)
 		}
 	}
 
+	rc = nbd_conns_get_threads(ctx->nbd);
+	if (rc != 0) {
+		goto err;
+	}
+
 	ctx->nbd->has_nbd_pthread = true;
 	rc = pthread_create(&tid, NULL, nbd_start_kernel, ctx->nbd);
 	if (rc != 0) {
 		ctx->nbd->has_nbd_pthread = false;
 		SPDK_ERRLOG("could not create thread: %s\n", spdk_strerror(rc));
 		rc = -rc;
-		goto err;
+		goto err_threads;
 	}
 
 	rc = pthread_detach(tid);
 	if (rc != 0) {
 		SPDK_ERRLOG("could not detach thread for nbd kernel: %s\n", spdk_strerror(rc));
 		rc = -rc;
-		goto err;
+		goto err_threads;
 	}
 
-	if (spdk_interrupt_mode_is_enabled()) {
-		ctx->nbd->intr = SPDK_INTERRUPT_REGISTER(ctx->nbd->spdk_sp_fd, nbd_poll, ctx->nbd);
+	for (i = 0; i < ctx->nbd->num_conns; i++) {
+		ctx->nbd->num_conns_running++;
+		spdk_thread_send_msg(ctx->nbd->conns[i].thread, nbd_conn_start, &ctx->nbd->conns[i]);
 	}
 
-	ctx->nbd->nbd_poller = SPDK_POLLER_REGISTER(nbd_poll, ctx->nbd, 0);
-	spdk_poller_register_interrupt(ctx->nbd->nbd_poller, nbd_poller_set_interrupt_mode, ctx->nbd);
-
 	if (ctx->cb_fn) {
 		ctx->cb_fn(ctx->cb_arg, ctx->nbd, 0);
 	}
 
 	/* nbd will possibly receive stop command while initing */
 	ctx->nbd->is_started = true;
+	if (ctx->nbd->is_closing) {
+		spdk_nbd_stop(ctx->nbd);
+	}
 
 	free(ctx);
 	return;
 
+err_threads:
+	nbd_conns_put_threads(ctx->nbd);
 err:
 	_nbd_stop(ctx->nbd);
 	if (ctx->cb_fn) {
@@ -999,44 +1353,50 @@ static int
 nbd_enable_kernel(void *arg)
 {
 	struct spdk_nbd_start_ctx *ctx = arg;
+	struct spdk_nbd_disk *nbd = ctx->nbd;
 	int rc;
 
-	/* Declare device setup by this process */
-	rc = ioctl(ctx->nbd->dev_fd, NBD_SET_SOCK, ctx->nbd->kernel_sp_fd);
+	/* Declare device setup by this process, one socket per connection */
+	while (nbd->num_conns_set < nbd->num_conns) {
+		rc = ioctl(nbd->dev_fd, NBD_SET_SOCK, nbd->conns[nbd->num_conns_set].kernel_sp_fd);
+		if (rc == 0) {
+			nbd->num_conns_set++;
+			continue;
+		}
 
-	if (rc) {
 		if (errno == EBUSY) {
-			if (ctx->nbd->retry_poller == NULL) {
-				ctx->nbd->retry_count = NBD_START_BUSY_WAITING_MS * 1000ULL / NBD_BUSY_POLLING_INTERVAL_US;
-				ctx->nbd->retry_poller = SPDK_POLLER_REGISTER(nbd_enable_kernel, ctx,
-							 NBD_BUSY_POLLING_INTERVAL_US);
+			if (nbd->retry_poller == NULL) {
+				nbd->retry_count = NBD_START_BUSY_WAITING_MS * 1000ULL / NBD_BUSY_POLLING_INTERVAL_US;
+				nbd->retry_poller = SPDK_POLLER_REGISTER(nbd_enable_kernel, ctx,
+						    NBD_BUSY_POLLING_INTERVAL_US);
 				return SPDK_POLLER_BUSY;
-			} else if (ctx->nbd->retry_count-- > 0) {
+			} else if (nbd->retry_count-- > 0) {
 				/* Repeatedly unregister and register retry poller to avoid scan-build error */
-				spdk_poller_unregister(&ctx->nbd->retry_poller);
-				ctx->nbd->retry_poller = SPDK_POLLER_REGISTER(nbd_enable_kernel, ctx,
-							 NBD_BUSY_POLLING_INTERVAL_US);
+				spdk_poller_unregister(&nbd->retry_poller);
+				nbd->retry_poller = SPDK_POLLER_REGISTER(nbd_enable_kernel, ctx,
+						    NBD_BUSY_POLLING_INTERVAL_US);
 				return SPDK_POLLER_BUSY;
 			}
 		}
 
-		SPDK_ERRLOG("ioctl(NBD_SET_SOCK) failed: %s\n", spdk_strerror(errno));
-		if (ctx->nbd->retry_poller) {
-			spdk_poller_unregister(&ctx->nbd->retry_poller);
+		rc = -errno;
+		SPDK_ERRLOG("ioctl(NBD_SET_SOCK) failed: %s\n", spdk_strerror(-rc));
+		if (nbd->retry_poller) {
+			spdk_poller_unregister(&nbd->retry_poller);
 		}
 
-		_nbd_stop(ctx->nbd);
+		_nbd_stop(nbd);
 
 		if (ctx->cb_fn) {
-			ctx->cb_fn(ctx->cb_arg, NULL, -errno);
+			ctx->cb_fn(ctx->cb_arg, NULL, rc);
 		}
 
 		free(ctx);
 		return SPDK_POLLER_BUSY;
 	}
 
-	if (ctx->nbd->retry_poller) {
-		spdk_poller_unregister(&ctx->nbd->retry_poller);
+	if (nbd->retry_poller) {
+		spdk_poller_unregister(&nbd->retry_poller);
 	}
 
 	nbd_start_complete(ctx);
@@ -1045,15 +1405,23 @@ nbd_enable_kernel(void *arg)
 }
 
 void
-spdk_nbd_start(const char *bdev_name, const char *nbd_path,
-	       spdk_nbd_start_cb cb_fn, void *cb_arg)
+nbd_start(const char *bdev_name, const char *nbd_path, uint32_t num_connections,
+	  const char *cpumask, spdk_nbd_start_cb cb_fn, void *cb_arg)
 {
 	struct spdk_nbd_start_ctx	*ctx = NULL;
 	struct spdk_nbd_disk		*nbd = NULL;
+	struct nbd_conn			*conn;
 	struct spdk_bdev		*bdev;
+	uint32_t			i;
 	int				rc;
 	int				sp[2];
 
+	if (num_connections == 0 || num_connections > NBD_MAX_CONNECTIONS) {
+		SPDK_ERRLOG("num_connections must be between 1 and %d\n", NBD_MAX_CONNECTIONS);
+		rc = -EINVAL;
+		goto err;
+	}
+
 	nbd = calloc(1, sizeof(*nbd));
 	if (nbd == NULL) {
 		rc = -ENOMEM;
@@ -1061,8 +1429,24 @@ spdk_nbd_start(const char *bdev_name, const char *nbd_path,
 	}
 
 	nbd->dev_fd = -1;
-	nbd->spdk_sp_fd = -1;
-	nbd->kernel_sp_fd = -1;
+	nbd->thread = spdk_get_thread();
+
+	nbd->conns = calloc(num_connections, sizeof(*nbd->conns));
+	if (nbd->conns == NULL) {
+		rc = -ENOMEM;
+		goto err;
+	}
+
+	nbd->num_conns = num_connections;
+	for (i = 0; i < num_connections; i++) {
+		conn = &nbd->conns[i];
+		conn->nbd = nbd;
+		conn->spdk_sp_fd = -1;
+		conn->kernel_sp_fd = -1;
+		TAILQ_INIT(&conn->received_io_list);
+		TAILQ_INIT(&conn->executed_io_list);
+		TAILQ_INIT(&conn->processing_io_list);
+	}
 
 	ctx = calloc(1, sizeof(*ctx));
 	if (ctx == NULL) {
@@ -1083,18 +1467,20 @@ spdk_nbd_start(const char *bdev_name, const char *nbd_path,
 	bdev = spdk_bdev_desc_get_bdev(nbd->bdev_desc);
 	nbd->bdev = bdev;
 
-	nbd->ch = spdk_bdev_get_io_channel(nbd->bdev_desc);
 	nbd->buf_align = spdk_max(spdk_bdev_get_buf_align(bdev), 64);
 
-	rc = socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, sp);
-	if (rc != 0) {
-		SPDK_ERRLOG("socketpair failed\n");
-		rc = -errno;
-		goto err;
+	for (i = 0; i < num_connections; i++) {
+		rc = socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, sp);
+		if (rc != 0) {
+			SPDK_ERRLOG("socketpair failed\n");
+			rc = -errno;
+			goto err;
+		}
+
+		nbd->conns[i].spdk_sp_fd = sp[0];
+		nbd->conns[i].kernel_sp_fd = sp[1];
 	}
 
-	nbd->spdk_sp_fd = sp[0];
-	nbd->kernel_sp_fd = sp[1];
 	nbd->nbd_path = strdup(nbd_path);
 	if (!nbd->nbd_path) {
 		SPDK_ERRLOG("strdup allocation failure\n");
@@ -1102,9 +1488,14 @@ spdk_nbd_start(const char *bdev_name, const char *nbd_path,
 		goto err;
 	}
 
-	TAILQ_INIT(&nbd->received_io_list);
-	TAILQ_INIT(&nbd->executed_io_list);
-	TAILQ_INIT(&nbd->processing_io_list);
+	if (cpumask) {
+		nbd->cpumask = strdup(cpumask);
+		if (!nbd->cpumask) {
+			SPDK_ERRLOG("strdup allocation failure\n");
+			rc = -ENOMEM;
+			goto err;
+		}
+	}
 
 	/* Add nbd_disk to the end of disk list */
 	rc = nbd_disk_register(ctx->nbd);
@@ -1119,8 +1510,8 @@ spdk_nbd_start(const char *bdev_name, const char *nbd_path,
 		goto err;
 	}
 
-	SPDK_INFOLOG(nbd, "Enabling kernel access to bdev %s via %s\n",
-		     bdev_name, nbd_path);
+	SPDK_INFOLOG(nbd, "Enabling kernel access to bdev %s via %s with %" PRIu32 " connection(s)\n",
+		     bdev_name, nbd_path, num_connections);
 
 	nbd_enable_kernel(ctx);
 	return;
@@ -1136,6 +1527,13 @@ err:
 	}
 }
 
+void
+spdk_nbd_start(const char *bdev_name, const char *nbd_path,
+	       spdk_nbd_start_cb cb_fn, void *cb_arg)
+{
+	nbd_start(bdev_name, nbd_path, 1, NULL, cb_fn, cb_arg);
+}
+
 const char *
 spdk_nbd_get_path(struct spdk_nbd_disk *nbd)
 {
@@ -19,6 +19,19 @@ const char *nbd_disk_get_nbd_path(struct spdk_nbd_disk *nbd);
 
 const char *nbd_disk_get_bdev_name(struct spdk_nbd_disk *nbd);
 
+uint32_t nbd_disk_get_num_connections(struct spdk_nbd_disk *nbd);
+
+const char *nbd_disk_get_cpumask(struct spdk_nbd_disk *nbd);
+
+/**
+ * Start a network block device served by num_connections sockets. Each connection
+ * is polled by its own SPDK thread unless there is only one and no cpumask is given,
+ * in which case the calling thread is used. The threads are placed round-robin on
+ * the cores of cpumask, or by the scheduler if it is NULL.
+ */
+void nbd_start(const char *bdev_name, const char *nbd_path, uint32_t num_connections,
+	       const char *cpumask, spdk_nbd_start_cb cb_fn, void *cb_arg);
+
 void nbd_disconnect(struct spdk_nbd_disk *nbd);
 
 #endif /* SPDK_NBD_INTERNAL_H */
@@ -354,6 +354,10 @@ spdk_nvme_ctrlr_get_default_io_qpair_opts(struct spdk_nvme_ctrlr *ctrlr,
 		opts->async_mode = false;
 	}
 
+	if (FIELD_OK(sq_doorbell_max_delay_us)) {
+		opts->sq_doorbell_max_delay_us = 0;
+	}
+
 #undef FIELD_OK
 }
 
@@ -43,6 +43,8 @@ nvme_pcie_qpair_reset(struct spdk_nvme_qpair *qpair)
 
 	/* all head/tail vals are set to 0 */
 	pqpair->last_sq_tail = pqpair->sq_tail = pqpair->sq_head = pqpair->cq_head = 0;
+	pqpair->sq_db.pending = 0;
+	pqpair->sq_db.submits = 0;
 
 	/*
 	 * First time through the completion queue, HW will set phase
@@ -216,6 +218,7 @@ nvme_pcie_qpair_construct(struct spdk_nvme_qpair *qpair,
 
 	TAILQ_INIT(&pqpair->free_tr);
 	TAILQ_INIT(&pqpair->outstanding_tr);
+	pqpair->num_outstanding_tr = 0;
 
 	for (i = 0; i < num_trackers; i++) {
 		tr = &pqpair->tr[i];
@@ -621,6 +624,79 @@ nvme_pcie_copy_command(struct spdk_nvme_cmd *dst, const struct spdk_nvme_cmd *sr
 #endif
 }
 
+/* Upper bound on the number of commands covered by one adaptive SQ doorbell write */
+#define NVME_PCIE_SQ_DB_MAX_BATCH	32
+
+static inline void
+nvme_pcie_qpair_flush_sq_doorbell(struct spdk_nvme_qpair *qpair)
+{
+	struct nvme_pcie_qpair *pqpair = nvme_pcie_qpair(qpair);
+
+	if (qpair->last_fuse == SPDK_NVME_IO_FLAGS_FUSE_FIRST) {
+		/* Both commands of a fused pair need to be covered by the same doorbell write */
+		return;
+	}
+
+	nvme_pcie_qpair_ring_sq_doorbell(qpair);
+	pqpair->last_sq_tail = pqpair->sq_tail;
+	pqpair->sq_db.pending = 0;
+}
+
+/*
+ * Decide whether a newly submitted command needs a doorbell write right away.
+ * The doorbell is written if every command submitted to the SQ is still
+ * waiting for it (the controller would be idle otherwise), once the batch target
+ * is reached, or once the oldest pending command has waited for max_delay_ticks.
+ * Anything else is left for the next submission or completion poll.
+ */
+static inline void
+nvme_pcie_qpair_adaptive_sq_doorbell(struct spdk_nvme_qpair *qpair)
+{
+	struct nvme_pcie_qpair *pqpair = nvme_pcie_qpair(qpair);
+	uint64_t now;
+
+	pqpair->sq_db.submits++;
+	pqpair->sq_db.pending++;
+
+	if (pqpair->num_outstanding_tr <= pqpair->sq_db.pending ||
+	    pqpair->sq_db.pending >= pqpair->sq_db.batch) {
+		nvme_pcie_qpair_flush_sq_doorbell(qpair);
+		return;
+	}
+
+	now = spdk_get_ticks();
+	if (pqpair->sq_db.pending == 1) {
+		pqpair->sq_db.first_tsc = now;
+	} else if (now - pqpair->sq_db.first_tsc >= pqpair->sq_db.max_delay_ticks) {
+		nvme_pcie_qpair_flush_sq_doorbell(qpair);
+		return;
+	}
+
+	pqpair->stat->sq_coalesced_submissions++;
+}
+
+/*
+ * Called on every completion poll.  Updates the coalescing target from the
+ * submission rate seen since the previous poll, aiming at a few doorbell writes
+ * per poll interval, and submits whatever is still pending.
+ */
+static inline void
+nvme_pcie_qpair_adapt_sq_doorbell(struct spdk_nvme_qpair *qpair)
+{
+	struct nvme_pcie_qpair *pqpair = nvme_pcie_qpair(qpair);
+	uint32_t max_batch;
+
+	pqpair->sq_db.rate = pqpair->sq_db.rate - pqpair->sq_db.rate / 8 + pqpair->sq_db.submits;
+	pqpair->sq_db.submits = 0;
+
+	max_batch = spdk_max(1, spdk_min(NVME_PCIE_SQ_DB_MAX_BATCH, pqpair->num_entries / 4));
+	pqpair->sq_db.batch = spdk_max(1, spdk_min(max_batch, pqpair->sq_db.rate / 8 / 4));
+
+	if (pqpair->last_sq_tail != pqpair->sq_tail) {
+		nvme_pcie_qpair_flush_sq_doorbell(qpair);
+	}
+}
+
 void
 nvme_pcie_qpair_submit_tracker(struct spdk_nvme_qpair *qpair, struct nvme_tracker *tr)
 {
@@ -661,7 +737,9 @@ nvme_pcie_qpair_submit_tracker(struct spdk_nvme_qpair *qpair, struct nvme_tracke
 		SPDK_ERRLOG("sq_tail is passing sq_head!\n");
 	}
 
-	if (!pqpair->flags.delay_cmd_submit) {
+	if (spdk_unlikely(pqpair->flags.adaptive_cmd_submit)) {
+		nvme_pcie_qpair_adaptive_sq_doorbell(qpair);
+	} else if (!pqpair->flags.delay_cmd_submit) {
 		nvme_pcie_qpair_ring_sq_doorbell(qpair);
 	}
 }
@@ -703,6 +781,8 @@ nvme_pcie_qpair_complete_tracker(struct spdk_nvme_qpair *qpair, struct nvme_trac
 		nvme_pcie_qpair_submit_tracker(qpair, tr);
 	} else {
 		TAILQ_REMOVE(&pqpair->outstanding_tr, tr, tq_list);
+		assert(pqpair->num_outstanding_tr > 0);
+		pqpair->num_outstanding_tr--;
 
 		/* Only check admin requests from different processes. */
 		if (nvme_qpair_is_admin_queue(qpair) && req->pid != getpid()) {
@@ -831,6 +911,29 @@ nvme_pcie_qpair_check_timeout(struct spdk_nvme_qpair *qpair)
 	}
 }
 
+static void
+nvme_pcie_qpair_defer_cq_doorbell(struct spdk_nvme_qpair *qpair)
+{
+	struct nvme_pcie_qpair *pqpair = nvme_pcie_qpair(qpair);
+	struct nvme_pcie_poll_group *group = nvme_pcie_poll_group(qpair->poll_group);
+
+	if (!pqpair->flags.cq_doorbell_pending) {
+		pqpair->flags.cq_doorbell_pending = 1;
+		TAILQ_INSERT_TAIL(&group->cq_doorbell_pending, pqpair, cq_doorbell_link);
+	}
+}
+
+static void
+nvme_pcie_qpair_flush_cq_doorbell(struct nvme_pcie_poll_group *group,
+				  struct nvme_pcie_qpair *pqpair)
+{
+	if (pqpair->flags.cq_doorbell_pending) {
+		TAILQ_REMOVE(&group->cq_doorbell_pending, pqpair, cq_doorbell_link);
+		pqpair->flags.cq_doorbell_pending = 0;
+		nvme_pcie_qpair_ring_cq_doorbell(&pqpair->qpair);
+	}
+}
+
 int32_t
 nvme_pcie_qpair_process_completions(struct spdk_nvme_qpair *qpair, uint32_t max_completions)
 {
@@ -887,6 +990,7 @@ nvme_pcie_qpair_process_completions(struct spdk_nvme_qpair *qpair, uint32_t max_
 	}
 
 	pqpair->stat->polls++;
+	pqpair->polls++;
 
 	while (1) {
 		cpl = &pqpair->cpl[pqpair->cq_head];
@@ -946,9 +1050,15 @@ nvme_pcie_qpair_process_completions(struct spdk_nvme_qpair *qpair, uint32_t max_
 
 	if (num_completions > 0) {
 		pqpair->stat->completions += num_completions;
-		nvme_pcie_qpair_ring_cq_doorbell(qpair);
+		if (qpair->poll_group != NULL &&
+		    nvme_pcie_poll_group(qpair->poll_group)->in_process_completions) {
+			nvme_pcie_qpair_defer_cq_doorbell(qpair);
+		} else {
+			nvme_pcie_qpair_ring_cq_doorbell(qpair);
+		}
 	} else {
 		pqpair->stat->idle_polls++;
+		pqpair->idle_polls++;
 	}
 
 	if (pqpair->flags.delay_cmd_submit) {
@@ -956,6 +1066,8 @@ nvme_pcie_qpair_process_completions(struct spdk_nvme_qpair *qpair, uint32_t max_
 			nvme_pcie_qpair_ring_sq_doorbell(qpair);
 			pqpair->last_sq_tail = pqpair->sq_tail;
 		}
+	} else if (spdk_unlikely(pqpair->flags.adaptive_cmd_submit)) {
+		nvme_pcie_qpair_adapt_sq_doorbell(qpair);
 	}
 
 	if (spdk_unlikely(ctrlr->timeout_enabled)) {
@@ -1056,6 +1168,12 @@ nvme_pcie_ctrlr_create_io_qpair(struct spdk_nvme_ctrlr *ctrlr, uint16_t qid,
 
 	pqpair->num_entries = opts->io_queue_size;
 	pqpair->flags.delay_cmd_submit = opts->delay_cmd_submit;
+	if (!opts->delay_cmd_submit && opts->sq_doorbell_max_delay_us > 0) {
+		pqpair->flags.adaptive_cmd_submit = 1;
+		pqpair->sq_db.batch = 1;
+		pqpair->sq_db.max_delay_ticks = opts->sq_doorbell_max_delay_us * spdk_get_ticks_hz() /
+						SPDK_SEC_TO_USEC;
+	}
 
 	qpair = &pqpair->qpair;
 
@@ -1651,6 +1769,7 @@ nvme_pcie_qpair_submit_request(struct spdk_nvme_qpair *qpair, struct nvme_reques
 	pqpair->stat->submitted_requests++;
 	TAILQ_REMOVE(&pqpair->free_tr, tr, tq_list); /* remove tr from free_tr */
 	TAILQ_INSERT_TAIL(&pqpair->outstanding_tr, tr, tq_list);
+	pqpair->num_outstanding_tr++;
 	tr->req = req;
 	tr->cb_fn = req->cb_fn;
 	tr->cb_arg = req->cb_arg;
@@ -1715,6 +1834,8 @@ nvme_pcie_poll_group_create(void)
 		return NULL;
 	}
 
+	TAILQ_INIT(&group->cq_doorbell_pending);
+
 	return &group->group;
 }
 
@@ -1727,6 +1848,11 @@ nvme_pcie_poll_group_connect_qpair(struct spdk_nvme_qpair *qpair)
 int
 nvme_pcie_poll_group_disconnect_qpair(struct spdk_nvme_qpair *qpair)
 {
+	/* The CQ is still alive at this point, so write back any deferred head update
+	 * before the qpair leaves the connected list.
+	 */
+	nvme_pcie_qpair_flush_cq_doorbell(nvme_pcie_poll_group(qpair->poll_group),
+					  nvme_pcie_qpair(qpair));
 	return 0;
 }
 
@@ -1743,14 +1869,55 @@ nvme_pcie_poll_group_remove(struct spdk_nvme_transport_poll_group *tgroup,
 {
 	struct nvme_pcie_qpair *pqpair = nvme_pcie_qpair(qpair);
 
+	assert(!pqpair->flags.cq_doorbell_pending);
 	pqpair->stat = &g_dummy_stat;
 	return 0;
 }
 
+/*
+ * Returns true if polling the qpair would do nothing but find its CQ empty, i.e.
+ * there is no state transition, deferred submission, timeout or error handling
+ * pending on it.  Such a qpair can be skipped by the poll group without going
+ * through the generic completion path.
+ */
+static inline bool
+nvme_pcie_qpair_poll_is_idle(struct spdk_nvme_qpair *qpair)
+{
+	struct nvme_pcie_qpair *pqpair = nvme_pcie_qpair(qpair);
+	struct spdk_nvme_ctrlr *ctrlr = qpair->ctrlr;
+
+	if (pqpair->cpl[pqpair->cq_head].status.p == pqpair->flags.phase) {
+		return false;
+	}
+
+	if (spdk_unlikely(nvme_qpair_get_state(qpair) != NVME_QPAIR_ENABLED ||
+			  pqpair->pcie_state != NVME_PCIE_QPAIR_READY ||
+			  ctrlr->is_failed || ctrlr->timeout_enabled ||
+			  pqpair->flags.has_pending_vtophys_failures ||
+			  !STAILQ_EMPTY(&qpair->err_req_head) ||
+			  !STAILQ_EMPTY(&qpair->aborting_queued_req))) {
+		return false;
+	}
+
+	if (pqpair->flags.delay_cmd_submit && pqpair->last_sq_tail != pqpair->sq_tail) {
+		return false;
+	}
+
+	/* The adaptive doorbell policy needs to see every poll that follows submissions */
+	if (pqpair->flags.adaptive_cmd_submit &&
+	    (pqpair->last_sq_tail != pqpair->sq_tail || pqpair->sq_db.submits != 0)) {
+		return false;
+	}
+
+	return true;
+}
+
 int64_t
 nvme_pcie_poll_group_process_completions(struct spdk_nvme_transport_poll_group *tgroup,
 		uint32_t completions_per_qpair, spdk_nvme_disconnected_qpair_cb disconnected_qpair_cb)
 {
+	struct nvme_pcie_poll_group *group = nvme_pcie_poll_group(tgroup);
+	struct nvme_pcie_qpair *pqpair;
 	struct spdk_nvme_qpair *qpair, *tmp_qpair;
 	int32_t local_completions = 0;
 	int64_t total_completions = 0;
@@ -1759,7 +1926,27 @@ nvme_pcie_poll_group_process_completions(struct spdk_nvme_transport_poll_group *
 		disconnected_qpair_cb(qpair, tgroup->group->ctx);
 	}
 
+	/* Pull the CQ heads of all qpairs into the cache up front, so that the phase checks
+	 * below do not stall on each qpair in turn.
+	 */
+	STAILQ_FOREACH(qpair, &tgroup->connected_qpairs, poll_group_stailq) {
+		pqpair = nvme_pcie_qpair(qpair);
+		__builtin_prefetch(&pqpair->cpl[pqpair->cq_head]);
+	}
+
+	group->in_process_completions = true;
+
 	STAILQ_FOREACH_SAFE(qpair, &tgroup->connected_qpairs, poll_group_stailq, tmp_qpair) {
+		if (nvme_pcie_qpair_poll_is_idle(qpair)) {
+			pqpair = nvme_pcie_qpair(qpair);
+			pqpair->stat->polls++;
+			pqpair->stat->idle_polls++;
+			pqpair->stat->skipped_polls++;
+			pqpair->polls++;
+			pqpair->idle_polls++;
+			continue;
+		}
+
 		local_completions = spdk_nvme_qpair_process_completions(qpair, completions_per_qpair);
 		if (spdk_unlikely(local_completions < 0)) {
 			disconnected_qpair_cb(qpair, tgroup->group->ctx);
@@ -1769,6 +1956,12 @@ nvme_pcie_poll_group_process_completions(struct spdk_nvme_transport_poll_group *
 		}
 	}
 
+	group->in_process_completions = false;
+
+	while (!TAILQ_EMPTY(&group->cq_doorbell_pending)) {
+		nvme_pcie_qpair_flush_cq_doorbell(group, TAILQ_FIRST(&group->cq_doorbell_pending));
+	}
+
 	return total_completions;
 }
 
@@ -1790,6 +1983,10 @@ nvme_pcie_poll_group_get_stats(struct spdk_nvme_transport_poll_group *tgroup,
 {
 	struct nvme_pcie_poll_group *group;
 	struct spdk_nvme_transport_poll_group_stat *stats;
+	struct spdk_nvme_pcie_qpair_stat *qpair_stat;
+	struct nvme_pcie_qpair *pqpair;
+	struct spdk_nvme_qpair *qpair;
+	uint32_t num_qpairs = 0;
 
 	if (tgroup == NULL || _stats == NULL) {
 		SPDK_ERRLOG("Invalid stats or group pointer\n");
@@ -1802,9 +1999,31 @@ nvme_pcie_poll_group_get_stats(struct spdk_nvme_transport_poll_group *tgroup,
 		return -ENOMEM;
 	}
 	stats->trtype = SPDK_NVME_TRANSPORT_PCIE;
-	group = SPDK_CONTAINEROF(tgroup, struct nvme_pcie_poll_group, group);
+	group = nvme_pcie_poll_group(tgroup);
 	memcpy(&stats->pcie, &group->stats, sizeof(group->stats));
 
+	STAILQ_FOREACH(qpair, &tgroup->connected_qpairs, poll_group_stailq) {
+		num_qpairs++;
+	}
+
+	if (num_qpairs > 0) {
+		stats->pcie.qpair_stats = calloc(num_qpairs, sizeof(*stats->pcie.qpair_stats));
+		if (!stats->pcie.qpair_stats) {
+			SPDK_ERRLOG("Can't allocate memory for PCIe qpair stats\n");
+			free(stats);
+			return -ENOMEM;
+		}
+	}
+
+	STAILQ_FOREACH(qpair, &tgroup->connected_qpairs, poll_group_stailq) {
+		pqpair = nvme_pcie_qpair(qpair);
+		qpair_stat = &stats->pcie.qpair_stats[stats->pcie.num_qpairs++];
+		snprintf(qpair_stat->traddr, sizeof(qpair_stat->traddr), "%s", qpair->ctrlr->trid.traddr);
+		qpair_stat->qid = qpair->id;
+		qpair_stat->polls = pqpair->polls;
+		qpair_stat->idle_polls = pqpair->idle_polls;
+	}
+
 	*_stats = stats;
 
 	return 0;
@@ -1814,6 +2033,9 @@ void
 nvme_pcie_poll_group_free_stats(struct spdk_nvme_transport_poll_group *tgroup,
 				struct spdk_nvme_transport_poll_group_stat *stats)
 {
+	if (stats) {
+		free(stats->pcie.qpair_stats);
+	}
 	free(stats);
 }
 
@@ -112,6 +112,13 @@ SPDK_STATIC_ASSERT((offsetof(struct nvme_tracker, meta_sgl) & 7) == 0, "SGL must
 struct nvme_pcie_poll_group {
 	struct spdk_nvme_transport_poll_group group;
 	struct spdk_nvme_pcie_stat stats;
+
+	/* Set while the poll group reaps completions of its connected qpairs.  CQ head
+	 * doorbell updates of those qpairs are deferred and written back to back once
+	 * all of the qpairs have been polled.
+	 */
+	bool in_process_completions;
+	TAILQ_HEAD(, nvme_pcie_qpair) cq_doorbell_pending;
 };
 
 enum nvme_pcie_qpair_state {
@@ -137,6 +144,8 @@ struct nvme_pcie_qpair {
 
 	TAILQ_HEAD(, nvme_tracker) free_tr;
 	TAILQ_HEAD(nvme_outstanding_tr_head, nvme_tracker) outstanding_tr;
+	/* Number of trackers on outstanding_tr, i.e. commands submitted to the SQ */
+	uint16_t num_outstanding_tr;
 
 	/* Array of trackers indexed by command ID. */
 	struct nvme_tracker *tr;
@@ -162,8 +171,30 @@ struct nvme_pcie_qpair {
 		uint8_t has_shadow_doorbell	: 1;
 		uint8_t has_pending_vtophys_failures : 1;
 		uint8_t defer_destruction	: 1;
+		uint8_t cq_doorbell_pending	: 1;
+		uint8_t adaptive_cmd_submit	: 1;
 	} flags;
 
+	/* Adaptive SQ doorbell coalescing state */
+	struct {
+		/* Commands copied to the SQ but not yet covered by a doorbell write */
+		uint16_t pending;
+		/* Number of commands to coalesce into one doorbell write */
+		uint16_t batch;
+		/* Submissions since the last completion poll */
+		uint16_t submits;
+		/* Moving average of submissions per completion poll, scaled by 8 */
+		uint32_t rate;
+		uint64_t first_tsc;
+		uint64_t max_delay_ticks;
+	} sq_db;
+
+	/* Per-qpair counters, reported through the poll group statistics */
+	uint64_t polls;
+	uint64_t idle_polls;
+
+	TAILQ_ENTRY(nvme_pcie_qpair) cq_doorbell_link;
+
 	/*
 	 * Base qpair structure.
 	 * This is located after the hot data in this structure so that the important parts of
@@ -205,6 +236,12 @@ nvme_pcie_qpair(struct spdk_nvme_qpair *qpair)
 	return SPDK_CONTAINEROF(qpair, struct nvme_pcie_qpair, qpair);
 }
 
+static inline struct nvme_pcie_poll_group *
+nvme_pcie_poll_group(struct spdk_nvme_transport_poll_group *tgroup)
+{
+	return SPDK_CONTAINEROF(tgroup, struct nvme_pcie_poll_group, group);
+}
+
 static inline struct nvme_pcie_ctrlr *
 nvme_pcie_ctrlr(struct spdk_nvme_ctrlr *ctrlr)
 {
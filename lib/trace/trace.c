@@ -18,6 +18,13 @@
 static int g_trace_fd = -1;
 static char g_shm_name[64];
 
+/* Histories of threads not bound to any lcore follow the last lcore's one */
+static uint32_t g_user_thread_index_start;
+static uint32_t g_num_user_threads;
+static bool g_user_thread_used[SPDK_TRACE_MAX_LCORE];
+static pthread_mutex_t g_user_thread_mutex = PTHREAD_MUTEX_INITIALIZER;
+static __thread struct spdk_trace_history *t_user_thread_history;
+
 struct spdk_trace_histories *g_trace_histories;
 
 static inline struct spdk_trace_entry *
@@ -41,11 +48,15 @@ _spdk_trace_record(uint64_t tsc, uint16_t tpoint_id, uint16_t poller_id, uint32_
 	va_list vl;
 
 	lcore = spdk_env_get_current_core();
-	if (spdk_unlikely(lcore >= SPDK_TRACE_MAX_LCORE)) {
-		return;
+	if (spdk_likely(lcore < SPDK_TRACE_MAX_LCORE)) {
+		lcore_history = spdk_get_per_lcore_history(g_trace_histories, lcore);
+	} else {
+		lcore_history = t_user_thread_history;
 	}
 
-	lcore_history = spdk_get_per_lcore_history(g_trace_histories, lcore);
+	if (spdk_unlikely(lcore_history == NULL)) {
+		return;
+	}
 
 	if (tsc == 0) {
 		tsc = spdk_get_ticks();
@@ -144,7 +155,7 @@ _spdk_trace_record(uint64_t tsc, uint16_t tpoint_id, uint16_t poller_id, uint32_
 }
 
 int
-spdk_trace_init(const char *shm_name, uint64_t num_entries)
+spdk_trace_init(const char *shm_name, uint64_t num_entries, uint32_t num_threads)
 {
 	uint32_t i = 0;
 	int histories_size;
@@ -156,6 +167,15 @@ spdk_trace_init(const char *shm_name, uint64_t num_entries)
 		return 0;
 	}
 
+	g_user_thread_index_start = spdk_env_get_last_core() + 1;
+	if (g_user_thread_index_start + num_threads > SPDK_TRACE_MAX_LCORE) {
+		SPDK_ERRLOG("Too many trace histories requested for user threads: %"PRIu32", "
+			    "up to %"PRIu32" are available\n", num_threads,
+			    SPDK_TRACE_MAX_LCORE - spdk_min(g_user_thread_index_start, SPDK_TRACE_MAX_LCORE));
+		return 1;
+	}
+	g_num_user_threads = num_threads;
+
 	spdk_cpuset_zero(&cpuset);
 	histories_size = sizeof(struct spdk_trace_flags);
 	SPDK_ENV_FOREACH_CORE(i) {
@@ -163,6 +183,10 @@ spdk_trace_init(const char *shm_name, uint64_t num_entries)
 		lcore_offsets[i] = histories_size;
 		histories_size += spdk_get_trace_history_size(num_entries);
 	}
+	for (i = g_user_thread_index_start; i < g_user_thread_index_start + num_threads; i++) {
+		lcore_offsets[i] = histories_size;
+		histories_size += spdk_get_trace_history_size(num_entries);
+	}
 	lcore_offsets[SPDK_TRACE_MAX_LCORE] = histories_size;
 
 	snprintf(g_shm_name, sizeof(g_shm_name), "%s", shm_name);
@@ -213,7 +237,7 @@ spdk_trace_init(const char *shm_name, uint64_t num_entries)
 		if (lcore_offsets[i] == 0) {
 			continue;
 		}
-		assert(spdk_cpuset_get_cpu(&cpuset, i));
+		assert(spdk_cpuset_get_cpu(&cpuset, i) || i >= g_user_thread_index_start);
 		lcore_history = spdk_get_per_lcore_history(g_trace_histories, i);
 		lcore_history->lcore = i;
 		lcore_history->num_entries = num_entries;
@@ -268,11 +292,89 @@ spdk_trace_cleanup(void)
 	g_trace_histories = NULL;
 	close(g_trace_fd);
 
+	pthread_mutex_lock(&g_user_thread_mutex);
+	memset(g_user_thread_used, 0, sizeof(g_user_thread_used));
+	g_num_user_threads = 0;
+	pthread_mutex_unlock(&g_user_thread_mutex);
+
 	if (unlink) {
 		shm_unlink(g_shm_name);
 	}
 }
 
+int
+spdk_trace_register_user_thread(void)
+{
+	struct spdk_trace_history *history;
+	uint32_t i;
+
+	if (spdk_env_get_current_core() != SPDK_ENV_LCORE_ID_ANY) {
+		SPDK_ERRLOG("Cannot register a user thread running on lcore %"PRIu32"\n",
+			    spdk_env_get_current_core());
+		return -EINVAL;
+	}
+
+	if (t_user_thread_history != NULL) {
+		return -EEXIST;
+	}
+
+	if (g_trace_histories == NULL) {
+		return -ENOENT;
+	}
+
+	pthread_mutex_lock(&g_user_thread_mutex);
+	for (i = g_user_thread_index_start; i < g_user_thread_index_start + g_num_user_threads; i++) {
+		if (!g_user_thread_used[i]) {
+			break;
+		}
+	}
+
+	if (i == g_user_thread_index_start + g_num_user_threads) {
+		pthread_mutex_unlock(&g_user_thread_mutex);
+		SPDK_ERRLOG("No trace histories left for user threads\n");
+		return -ENOENT;
+	}
+
+	g_user_thread_used[i] = true;
+	pthread_mutex_unlock(&g_user_thread_mutex);
+
+	history = spdk_get_per_lcore_history(g_trace_histories, i);
+	assert(history != NULL);
+
+	memset(history->thread_name, 0, sizeof(history->thread_name));
+#if defined(__linux__)
+	if (pthread_getname_np(pthread_self(), history->thread_name,
+			       sizeof(history->thread_name)) != 0 || history->thread_name[0] == '\0')
+#endif
+	{
+		snprintf(history->thread_name, sizeof(history->thread_name), "thread%"PRIu32,
+			 i - g_user_thread_index_start);
+	}
+
+	t_user_thread_history = history;
+
+	return 0;
+}
+
+int
+spdk_trace_unregister_user_thread(void)
+{
+	struct spdk_trace_history *history = t_user_thread_history;
+
+	if (history == NULL) {
+		return -ENOENT;
+	}
+
+	t_user_thread_history = NULL;
+
+	pthread_mutex_lock(&g_user_thread_mutex);
+	assert(g_user_thread_used[history->lcore]);
+	g_user_thread_used[history->lcore] = false;
+	pthread_mutex_unlock(&g_user_thread_mutex);
+
+	return 0;
+}
+
 const char *
 trace_get_shm_name(void)
 {
@@ -70,6 +70,7 @@ struct spdk_trace_parser {
 	uint64_t tsc_offset() const { return _tsc_offset; }
 	bool next_entry(spdk_trace_parser_entry *entry);
 	uint64_t entry_count(uint16_t lcore) const;
+	const char *thread_name(uint16_t lcore) const;
 private:
 	spdk_trace_entry_buffer *get_next_buffer(spdk_trace_entry_buffer *buf, uint16_t lcore);
 	bool build_arg(argument_context *argctx, const spdk_trace_argument *arg, int argid,
@@ -101,6 +102,23 @@ spdk_trace_parser::entry_count(uint16_t lcore) const
 	return history == NULL ? 0 : history->num_entries;
 }
 
+const char *
+spdk_trace_parser::thread_name(uint16_t lcore) const
+{
+	spdk_trace_history *history;
+
+	if (lcore >= SPDK_TRACE_MAX_LCORE) {
+		return NULL;
+	}
+
+	history = spdk_get_per_lcore_history(_histories, lcore);
+	if (history == NULL || history->thread_name[0] == '\0') {
+		return NULL;
+	}
+
+	return history->thread_name;
+}
+
 spdk_trace_entry_buffer *
 spdk_trace_parser::get_next_buffer(spdk_trace_entry_buffer *buf, uint16_t lcore)
 {
@@ -430,3 +448,9 @@ spdk_trace_parser_get_entry_count(const struct spdk_trace_parser *parser, uint16
 {
 	return parser->entry_count(lcore);
 }
+
+const char *
+spdk_trace_parser_get_thread_name(const struct spdk_trace_parser *parser, uint16_t lcore)
+{
+	return parser->thread_name(lcore);
+}
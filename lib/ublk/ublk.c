@@ -26,19 +26,31 @@
 
 #define LINUX_SECTOR_SHIFT		9
 #define UBLK_CTRL_RING_DEPTH		32
-#define UBLK_THREAD_MAX			128
 #define UBLK_IO_MAX_BYTES		SPDK_BDEV_LARGE_BUF_MAX_SIZE
-#define UBLK_DEV_MAX_QUEUES		32
-#define UBLK_DEV_MAX_QUEUE_DEPTH	1024
+#define UBLK_DEV_MAX_QUEUE_DEPTH	UBLK_MAX_QUEUE_DEPTH
 #define UBLK_QUEUE_REQUEST		32
 #define UBLK_STOP_BUSY_WAITING_MS	10000
 #define UBLK_BUSY_POLLING_INTERVAL_US	20000
 
+/* User copy definitions, for building against kernel headers older than 6.5 */
+#ifndef UBLK_F_USER_COPY
+#define UBLK_F_USER_COPY		(1ULL << 7)
+#endif
+#ifndef UBLK_U_CMD_GET_FEATURES
+#define UBLK_U_CMD_GET_FEATURES		_IOR('u', 0x13, struct ublksrv_ctrl_cmd)
+#endif
+#ifndef UBLK_TAG_OFF
+#define UBLK_TAG_OFF			25
+#define UBLK_QID_OFF			41
+#endif
+
+/* user_data op of the reads and writes on the char device in user copy mode */
+#define UBLK_IO_USER_COPY		0xff
+
 #define UBLK_DEBUGLOG(ublk, format, ...) \
 	SPDK_DEBUGLOG(ublk, "ublk%d: " format, ublk->ublk_id, ##__VA_ARGS__);
 
 static uint32_t g_num_ublk_threads = 0;
-static uint32_t g_queue_thread_id = 0;
 static struct spdk_cpuset g_core_mask;
 
 struct ublk_queue;
@@ -51,11 +63,13 @@ static void ublk_ios_fini(struct spdk_ublk_dev *ublk);
 
 typedef void (*ublk_next_state_fn)(struct spdk_ublk_dev *ublk);
 static void ublk_set_params(struct spdk_ublk_dev *ublk);
+static void ublk_get_queue_affinity_done(struct spdk_ublk_dev *ublk);
 static void ublk_finish_start(struct spdk_ublk_dev *ublk);
 static void ublk_free_dev(struct spdk_ublk_dev *ublk);
 
 static const char *ublk_op_name[64]
 __attribute__((unused)) = {
+	[UBLK_CMD_GET_QUEUE_AFFINITY] =	"UBLK_CMD_GET_QUEUE_AFFINITY",
 	[UBLK_CMD_ADD_DEV] =	"UBLK_CMD_ADD_DEV",
 	[UBLK_CMD_DEL_DEV] =	"UBLK_CMD_DEL_DEV",
 	[UBLK_CMD_START_DEV] =	"UBLK_CMD_START_DEV",
@@ -72,17 +86,34 @@ struct ublk_io {
 	struct ublk_queue	*q;
 	/* for bdev io_wait */
 	struct spdk_bdev_io_wait_entry bdev_io_wait;
+	/* for waiting on an iobuf buffer in user copy mode */
+	struct spdk_iobuf_entry	iobuf;
 
 	TAILQ_ENTRY(ublk_io)	tailq;
 };
 
+struct ublk_queue_stat {
+	uint64_t		read_ops;
+	uint64_t		write_ops;
+	uint64_t		other_ops;
+	uint64_t		bytes_read;
+	uint64_t		bytes_written;
+	uint64_t		io_errors;
+};
+
 struct ublk_queue {
 	uint32_t		q_id;
 	uint32_t		q_depth;
 	struct ublk_io		*ios;
+	struct spdk_io_channel	*bdev_ch;
+	/* CPUs whose block requests are mapped to this queue by blk-mq */
+	cpu_set_t		cpuset;
+	struct ublk_queue_stat	stat;
 	TAILQ_HEAD(, ublk_io)	completed_io_list;
 	TAILQ_HEAD(, ublk_io)	inflight_io_list;
 	uint32_t		cmd_inflight;
+	/* user copy SQEs prepared since the last io_uring_submit() */
+	uint32_t		user_copy_pending;
 	struct ublksrv_io_desc	*io_cmd_buf;
 	/* ring depth == dev_info->queue_depth. */
 	struct io_uring		ring;
@@ -95,7 +126,6 @@ struct ublk_queue {
 struct spdk_ublk_dev {
 	struct spdk_bdev	*bdev;
 	struct spdk_bdev_desc	*bdev_desc;
-	struct spdk_io_channel	*ch[UBLK_DEV_MAX_QUEUES];
 	struct spdk_thread	*app_thread;
 
 	int			cdev_fd;
@@ -105,9 +135,11 @@ struct spdk_ublk_dev {
 	uint32_t		ublk_id;
 	uint32_t		num_queues;
 	uint32_t		queue_depth;
+	/* I/O data is copied through the char device into iobuf buffers */
+	bool			user_copy;
 
 	struct spdk_mempool	*io_buf_pool;
-	struct ublk_queue	queues[UBLK_DEV_MAX_QUEUES];
+	struct ublk_queue	*queues;
 
 	struct spdk_poller	*retry_poller;
 	int			retry_count;
@@ -117,6 +149,8 @@ struct spdk_ublk_dev {
 	ublk_del_cb		del_cb;
 	void			*cb_arg;
 	uint32_t		ctrl_cmd_op;
+	/* queue of the UBLK_CMD_GET_QUEUE_AFFINITY command */
+	uint32_t		ctrl_q_id;
 	ublk_next_state_fn	next_state_fn;
 	uint32_t		ctrl_ops_in_progress;
 
@@ -127,7 +161,11 @@ struct spdk_ublk_dev {
 struct ublk_thread_ctx {
 	struct spdk_thread		*ublk_thread;
 	struct spdk_poller		*ublk_poller;
+	struct spdk_iobuf_channel	iobuf_ch;
 	TAILQ_HEAD(, ublk_queue)	queue_list;
+	/* Core of the thread and number of queues assigned to it, used by the app thread */
+	uint32_t			core;
+	uint32_t			num_queues;
 };
 
 struct ublk_tgt {
@@ -138,8 +176,10 @@ struct ublk_tgt {
 	void			*cb_arg;
 	struct io_uring		ctrl_ring;
 	struct spdk_poller	*ctrl_poller;
+	/* UBLK_F_* flags supported by the kernel driver */
+	uint64_t		features;
 	uint32_t		ctrl_ops_in_progress;
-	struct ublk_thread_ctx	thread_ctx[UBLK_THREAD_MAX];
+	struct ublk_thread_ctx	*thread_ctx;
 	TAILQ_HEAD(, spdk_ublk_dev)	ctrl_wait_tailq;
 };
 
@@ -197,13 +237,25 @@ user_data_to_op(uint64_t user_data)
 	return (user_data >> 16) & 0xff;
 }
 
+static inline uint64_t
+ublk_user_copy_pos(uint16_t q_id, uint16_t tag)
+{
+	return UBLKSRV_IO_BUF_OFFSET + (((uint64_t)q_id << UBLK_QID_OFF) | ((uint64_t)tag << UBLK_TAG_OFF));
+}
+
 void
 spdk_ublk_init(void)
 {
 	uint32_t i;
+	int rc;
 
 	assert(spdk_get_thread() == spdk_thread_get_app_thread());
 
+	rc = spdk_iobuf_register_module("ublk");
+	if (rc != 0 && rc != -EEXIST) {
+		SPDK_ERRLOG("Failed to register ublk iobuf module: %s\n", spdk_strerror(-rc));
+	}
+
 	spdk_cpuset_zero(&g_core_mask);
 	SPDK_ENV_FOREACH_CORE(i) {
 		spdk_cpuset_set_cpu(&g_core_mask, i, true);
@@ -287,9 +339,17 @@ ublk_ctrl_cmd(struct spdk_ublk_dev *ublk, uint32_t cmd_op)
 		cmd->len = sizeof(ublk->dev_info);
 		break;
 	case UBLK_CMD_SET_PARAMS:
-		ublk->next_state_fn = ublk_finish_start;
+		ublk->next_state_fn = ublk_get_queue_affinity_done;
 		cmd->addr = (__u64)(uintptr_t)&ublk->dev_params;
 		cmd->len = sizeof(ublk->dev_params);
+		ublk->ctrl_q_id = 0;
+		break;
+	case UBLK_CMD_GET_QUEUE_AFFINITY:
+		ublk->next_state_fn = ublk_get_queue_affinity_done;
+		CPU_ZERO(&ublk->queues[ublk->ctrl_q_id].cpuset);
+		cmd->addr = (__u64)(uintptr_t)&ublk->queues[ublk->ctrl_q_id].cpuset;
+		cmd->len = sizeof(cpu_set_t);
+		cmd->data[0] = ublk->ctrl_q_id;
 		break;
 	case UBLK_CMD_START_DEV:
 		cmd->data[0] = getpid();
@@ -332,6 +392,52 @@ ublk_queue_cmd_buf_sz(uint32_t q_depth)
 	return (size + page_sz - 1) & ~(page_sz - 1);
 }
 
+static void
+ublk_get_features(void)
+{
+	struct io_uring *ring = &g_ublk_tgt.ctrl_ring;
+	struct io_uring_sqe *sqe;
+	struct io_uring_cqe *cqe;
+	struct ublksrv_ctrl_cmd *cmd;
+	int rc;
+
+	g_ublk_tgt.features = 0;
+
+	/* Nothing else uses the control ring yet, so simply wait for the result */
+	sqe = io_uring_get_sqe(ring);
+	assert(sqe != NULL);
+	cmd = (struct ublksrv_ctrl_cmd *)ublk_get_sqe_cmd(sqe);
+	sqe->fd = g_ublk_tgt.ctrl_fd;
+	sqe->opcode = IORING_OP_URING_CMD;
+	sqe->ioprio = 0;
+	cmd->dev_id = -1;
+	cmd->queue_id = -1;
+	cmd->addr = (__u64)(uintptr_t)&g_ublk_tgt.features;
+	cmd->len = sizeof(g_ublk_tgt.features);
+	ublk_set_sqe_cmd_op(sqe, UBLK_U_CMD_GET_FEATURES);
+	io_uring_sqe_set_data(sqe, NULL);
+
+	rc = io_uring_submit(ring);
+	if (rc < 0) {
+		SPDK_ERRLOG("uring submit rc %d\n", rc);
+		return;
+	}
+
+	rc = io_uring_wait_cqe(ring, &cqe);
+	if (rc < 0) {
+		SPDK_ERRLOG("wait for ublk features failed: %s\n", spdk_strerror(-rc));
+		return;
+	}
+
+	/* Kernels older than 6.5 don't know this command */
+	if (cqe->res < 0) {
+		g_ublk_tgt.features = 0;
+	}
+	io_uring_cqe_seen(ring, cqe);
+
+	SPDK_DEBUGLOG(ublk, "ublk driver features %#" PRIx64 "\n", g_ublk_tgt.features);
+}
+
 static int
 ublk_open(void)
 {
@@ -353,6 +459,8 @@ ublk_open(void)
 		return rc;
 	}
 
+	ublk_get_features();
+
 	return 0;
 }
 
@@ -399,8 +507,15 @@ ublk_poller_register(void *args)
 {
 	struct ublk_thread_ctx *thread_ctx = args;
 
+	int rc;
+
 	assert(spdk_get_thread() == thread_ctx->ublk_thread);
 	TAILQ_INIT(&thread_ctx->queue_list);
+	/* The user copy buffers are taken straight from the pools, which have per-core caches */
+	rc = spdk_iobuf_channel_init(&thread_ctx->iobuf_ch, "ublk", 0, 0);
+	if (rc != 0) {
+		SPDK_ERRLOG("Failed to initialize iobuf channel: %s\n", spdk_strerror(-rc));
+	}
 	thread_ctx->ublk_poller = SPDK_POLLER_REGISTER(ublk_poll, thread_ctx, 0);
 }
 
@@ -426,9 +541,16 @@ ublk_create_target(const char *cpumask_str)
 		return rc;
 	}
 
+	g_ublk_tgt.thread_ctx = calloc(spdk_cpuset_count(&cpuset), sizeof(*g_ublk_tgt.thread_ctx));
+	if (g_ublk_tgt.thread_ctx == NULL) {
+		return -ENOMEM;
+	}
+
 	rc = ublk_open();
 	if (rc != 0) {
 		SPDK_ERRLOG("Fail to open UBLK, error=%s\n", spdk_strerror(-rc));
+		free(g_ublk_tgt.thread_ctx);
+		g_ublk_tgt.thread_ctx = NULL;
 		return rc;
 	}
 
@@ -438,6 +560,7 @@ ublk_create_target(const char *cpumask_str)
 			spdk_cpuset_set_cpu(&thd_cpuset, i, true);
 			snprintf(thread_name, sizeof(thread_name), "ublk_thread%u", i);
 			thread_ctx = &g_ublk_tgt.thread_ctx[g_num_ublk_threads];
+			thread_ctx->core = i;
 			thread_ctx->ublk_thread = spdk_thread_create(thread_name, &thd_cpuset);
 			spdk_thread_send_msg(thread_ctx->ublk_thread, ublk_poller_register, thread_ctx);
 			g_num_ublk_threads++;
@@ -454,7 +577,8 @@ _ublk_fini_done(void *args)
 {
 	SPDK_DEBUGLOG(ublk, "\n");
 	g_num_ublk_threads = 0;
-	g_queue_thread_id = 0;
+	free(g_ublk_tgt.thread_ctx);
+	g_ublk_tgt.thread_ctx = NULL;
 	g_ublk_tgt.is_destroying = false;
 	g_ublk_tgt.active = false;
 	if (g_ublk_tgt.cb_fn) {
@@ -473,6 +597,9 @@ ublk_thread_exit(void *args)
 	for (i = 0; i < g_num_ublk_threads; i++) {
 		if (g_ublk_tgt.thread_ctx[i].ublk_thread == ublk_thread) {
 			spdk_poller_unregister(&g_ublk_tgt.thread_ctx[i].ublk_poller);
+			if (g_ublk_tgt.thread_ctx[i].iobuf_ch.parent != NULL) {
+				spdk_iobuf_channel_fini(&g_ublk_tgt.thread_ctx[i].iobuf_ch);
+			}
 			spdk_thread_exit(ublk_thread);
 		}
 	}
@@ -598,6 +725,40 @@ ublk_dev_get_num_queues(struct spdk_ublk_dev *ublk)
 	return ublk->num_queues;
 }
 
+bool
+ublk_dev_get_user_copy(struct spdk_ublk_dev *ublk)
+{
+	return ublk->user_copy;
+}
+
+void
+ublk_dev_write_queues_json(struct spdk_ublk_dev *ublk, struct spdk_json_write_ctx *w)
+{
+	struct ublk_queue *q;
+	uint32_t q_id;
+
+	spdk_json_write_named_array_begin(w, "queues");
+	for (q_id = 0; q_id < ublk->num_queues; q_id++) {
+		q = &ublk->queues[q_id];
+
+		spdk_json_write_object_begin(w);
+		spdk_json_write_named_uint32(w, "q_id", q_id);
+		if (q->thread_ctx != NULL) {
+			spdk_json_write_named_string(w, "thread", spdk_thread_get_name(q->thread_ctx->ublk_thread));
+			spdk_json_write_named_uint32(w, "core", q->thread_ctx->core);
+		}
+		/* The counters are updated by the queue's thread, so this is only a snapshot */
+		spdk_json_write_named_uint64(w, "read_ops", q->stat.read_ops);
+		spdk_json_write_named_uint64(w, "write_ops", q->stat.write_ops);
+		spdk_json_write_named_uint64(w, "other_ops", q->stat.other_ops);
+		spdk_json_write_named_uint64(w, "bytes_read", q->stat.bytes_read);
+		spdk_json_write_named_uint64(w, "bytes_written", q->stat.bytes_written);
+		spdk_json_write_named_uint64(w, "io_errors", q->stat.io_errors);
+		spdk_json_write_object_end(w);
+	}
+	spdk_json_write_array_end(w);
+}
+
 const char *
 ublk_dev_get_bdev_name(struct spdk_ublk_dev *ublk)
 {
@@ -621,6 +782,7 @@ spdk_ublk_write_config_json(struct spdk_json_write_ctx *w)
 		spdk_json_write_named_uint32(w, "ublk_id", ublk->ublk_id);
 		spdk_json_write_named_uint32(w, "num_queues", ublk->num_queues);
 		spdk_json_write_named_uint32(w, "queue_depth", ublk->queue_depth);
+		spdk_json_write_named_bool(w, "user_copy", ublk->user_copy);
 		spdk_json_write_object_end(w);
 
 		spdk_json_write_object_end(w);
@@ -673,6 +835,10 @@ ublk_delete_dev(void *arg)
 	assert(spdk_get_thread() == ublk->app_thread);
 	for (q_idx = 0; q_idx < ublk->num_queues; q_idx++) {
 		ublk_dev_queue_fini(&ublk->queues[q_idx]);
+		if (ublk->queues[q_idx].thread_ctx != NULL) {
+			ublk->queues[q_idx].thread_ctx->num_queues--;
+			ublk->queues[q_idx].thread_ctx = NULL;
+		}
 	}
 
 	if (ublk->cdev_fd >= 0) {
@@ -700,6 +866,7 @@ ublk_free_dev(struct spdk_ublk_dev *ublk)
 		ublk->del_cb(ublk->cb_arg);
 	}
 	SPDK_NOTICELOG("ublk dev %d stopped\n", ublk->ublk_id);
+	free(ublk->queues);
 	free(ublk);
 }
 
@@ -763,8 +930,8 @@ ublk_try_close_queue(struct ublk_queue *q)
 	}
 
 	TAILQ_REMOVE(&q->thread_ctx->queue_list, q, tailq);
-	spdk_put_io_channel(ublk->ch[q->q_id]);
-	ublk->ch[q->q_id] = NULL;
+	spdk_put_io_channel(q->bdev_ch);
+	q->bdev_ch = NULL;
 
 	spdk_thread_send_msg(ublk->app_thread, ublk_try_close_dev, ublk);
 }
@@ -808,6 +975,31 @@ ublk_mark_io_done(struct ublk_io *io, int res)
 	io->result = res;
 }
 
+static void
+ublk_queue_stat_update(struct ublk_queue *q, struct ublk_io *io, int res)
+{
+	const struct ublksrv_io_desc *iod = &q->io_cmd_buf[io - q->ios];
+
+	if (spdk_unlikely(res < 0)) {
+		q->stat.io_errors++;
+		return;
+	}
+
+	switch (ublksrv_get_op(iod)) {
+	case UBLK_IO_OP_READ:
+		q->stat.read_ops++;
+		q->stat.bytes_read += res;
+		break;
+	case UBLK_IO_OP_WRITE:
+		q->stat.write_ops++;
+		q->stat.bytes_written += res;
+		break;
+	default:
+		q->stat.other_ops++;
+		break;
+	}
+}
+
 static void
 ublk_io_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
 {
@@ -821,6 +1013,12 @@ ublk_io_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
 		res = -EIO;
 	}
 
+	if (q->dev->user_copy && io->payload != NULL) {
+		spdk_iobuf_put(&q->thread_ctx->iobuf_ch, io->payload, io->payload_size);
+		io->payload = NULL;
+	}
+
+	ublk_queue_stat_update(q, io, res);
 	ublk_mark_io_done(io, res);
 
 	SPDK_DEBUGLOG(ublk_io, "(qid %d tag %d res %d)\n",
@@ -833,6 +1031,109 @@ ublk_io_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
 	}
 }
 
+static void
+ublk_queue_user_copy(struct ublk_queue *q, struct ublk_io *io, uint16_t tag)
+{
+	const struct ublksrv_io_desc *iod = &q->io_cmd_buf[tag];
+	struct io_uring_sqe *sqe;
+	uint64_t pos = ublk_user_copy_pos(q->q_id, tag);
+
+	/* Each tag has at most one SQE outstanding, so there is always room in the ring */
+	sqe = io_uring_get_sqe(&q->ring);
+	assert(sqe);
+
+	/* The request pages are accessed through the char device, which is registered file 0 */
+	if (ublksrv_get_op(iod) == UBLK_IO_OP_WRITE) {
+		io_uring_prep_read(sqe, 0, io->payload, io->payload_size, pos);
+	} else {
+		io_uring_prep_write(sqe, 0, io->payload, io->payload_size, pos);
+	}
+	sqe->flags |= IOSQE_FIXED_FILE;
+	io_uring_sqe_set_data64(sqe, build_user_data(tag, UBLK_IO_USER_COPY));
+
+	q->cmd_inflight++;
+	q->user_copy_pending++;
+}
+
+static void
+ublk_user_copy_done(struct ublk_queue *q, uint16_t tag, int res)
+{
+	struct ublk_io *io = &q->ios[tag];
+	const struct ublksrv_io_desc *iod = &q->io_cmd_buf[tag];
+
+	if (spdk_unlikely(res != (int)io->payload_size)) {
+		SPDK_ERRLOG("ublk user copy failed: res %d qid %d tag %u\n", res, q->q_id, tag);
+		ublk_io_done(NULL, false, io);
+		return;
+	}
+
+	if (ublksrv_get_op(iod) == UBLK_IO_OP_WRITE) {
+		/* The data was fetched from the request, write it to the bdev */
+		ublk_submit_bdev_io(q, tag);
+	} else {
+		/* The data read from the bdev was copied into the request */
+		ublk_io_done(NULL, true, io);
+	}
+}
+
+static void
+ublk_user_copy_read_done(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct ublk_io *io = cb_arg;
+
+	if (!success) {
+		ublk_io_done(bdev_io, false, io);
+		return;
+	}
+
+	spdk_bdev_free_io(bdev_io);
+	ublk_queue_user_copy(io->q, io, io - io->q->ios);
+}
+
+static void
+ublk_user_copy_buf_ready(struct ublk_io *io, void *buf)
+{
+	struct ublk_queue *q = io->q;
+	uint16_t tag = io - q->ios;
+
+	io->payload = buf;
+	if (ublksrv_get_op(&q->io_cmd_buf[tag]) == UBLK_IO_OP_WRITE) {
+		ublk_queue_user_copy(q, io, tag);
+	} else {
+		ublk_submit_bdev_io(q, tag);
+	}
+}
+
+static void
+ublk_user_copy_get_buf_cb(struct spdk_iobuf_entry *iobuf, void *buf)
+{
+	struct ublk_io *io = SPDK_CONTAINEROF(iobuf, struct ublk_io, iobuf);
+
+	ublk_user_copy_buf_ready(io, buf);
+}
+
+/* Start processing a request, getting a data buffer first if the I/O data is copied by SPDK */
+static void
+ublk_handle_io(struct ublk_queue *q, uint16_t tag)
+{
+	struct ublk_io *io = &q->ios[tag];
+	const struct ublksrv_io_desc *iod = &q->io_cmd_buf[tag];
+	uint8_t ublk_op = ublksrv_get_op(iod);
+	void *buf;
+
+	if (!q->dev->user_copy || (ublk_op != UBLK_IO_OP_READ && ublk_op != UBLK_IO_OP_WRITE)) {
+		ublk_submit_bdev_io(q, tag);
+		return;
+	}
+
+	io->payload_size = iod->nr_sectors << LINUX_SECTOR_SHIFT;
+	buf = spdk_iobuf_get(&q->thread_ctx->iobuf_ch, io->payload_size, &io->iobuf,
+			     ublk_user_copy_get_buf_cb);
+	if (buf != NULL) {
+		ublk_user_copy_buf_ready(io, buf);
+	}
+}
+
 static void
 ublk_resubmit_io(void *arg)
 {
@@ -853,7 +1154,7 @@ ublk_queue_io(struct ublk_io *io)
 	io->bdev_io_wait.cb_fn = ublk_resubmit_io;
 	io->bdev_io_wait.cb_arg = io;
 
-	rc = spdk_bdev_queue_io_wait(bdev, q->dev->ch[q->q_id], &io->bdev_io_wait);
+	rc = spdk_bdev_queue_io_wait(bdev, q->bdev_ch, &io->bdev_io_wait);
 	if (rc != 0) {
 		SPDK_ERRLOG("Queue io failed in ublk_queue_io, rc=%d.\n", rc);
 		ublk_io_done(NULL, false, io);
@@ -866,7 +1167,7 @@ ublk_submit_bdev_io(struct ublk_queue *q, uint16_t tag)
 	struct spdk_ublk_dev *ublk = q->dev;
 	struct ublk_io *io = &q->ios[tag];
 	struct spdk_bdev_desc *desc = ublk->bdev_desc;
-	struct spdk_io_channel *ch = ublk->ch[q->q_id];
+	struct spdk_io_channel *ch = q->bdev_ch;
 	uint64_t offset_blocks, num_blocks;
 	uint8_t ublk_op;
 	uint32_t sector_per_block, sector_per_block_shift;
@@ -879,12 +1180,13 @@ ublk_submit_bdev_io(struct ublk_queue *q, uint16_t tag)
 	sector_per_block_shift = spdk_u32log2(sector_per_block);
 	offset_blocks = iod->start_sector >> sector_per_block_shift;
 	num_blocks = iod->nr_sectors >> sector_per_block_shift;
-	payload = (void *)iod->addr;
+	payload = ublk->user_copy ? io->payload : (void *)iod->addr;
 
 	io->result = num_blocks * spdk_bdev_get_data_block_size(ublk->bdev);
 	switch (ublk_op) {
 	case UBLK_IO_OP_READ:
-		rc = spdk_bdev_read_blocks(desc, ch, payload, offset_blocks, num_blocks, ublk_io_done, io);
+		rc = spdk_bdev_read_blocks(desc, ch, payload, offset_blocks, num_blocks,
+					   ublk->user_copy ? ublk_user_copy_read_done : ublk_io_done, io);
 		break;
 	case UBLK_IO_OP_WRITE:
 		rc = spdk_bdev_write_blocks(desc, ch, payload, offset_blocks, num_blocks, ublk_io_done, io);
@@ -944,7 +1246,8 @@ ublksrv_queue_io_cmd(struct ublk_queue *q,
 	sqe->flags	= IOSQE_FIXED_FILE;
 	sqe->rw_flags	= 0;
 	cmd->tag	= tag;
-	cmd->addr	= (__u64)(uintptr_t)(io->payload);
+	/* With user copy the kernel doesn't copy the data, so no buffer is passed */
+	cmd->addr	= q->dev->user_copy ? 0 : (__u64)(uintptr_t)(io->payload);
 	cmd->q_id	= q->q_id;
 
 	user_data = build_user_data(tag, cmd_op);
@@ -961,10 +1264,13 @@ ublksrv_queue_io_cmd(struct ublk_queue *q,
 static int
 ublk_io_xmit(struct ublk_queue *q)
 {
-	int rc = 0, count = 0, tag;
+	int rc = 0, count, tag;
 	struct ublk_io *io;
 
-	if (TAILQ_EMPTY(&q->completed_io_list)) {
+	/* The user copy SQEs are submitted along with the commands */
+	count = q->user_copy_pending;
+	q->user_copy_pending = 0;
+	if (TAILQ_EMPTY(&q->completed_io_list) && count == 0) {
 		return 0;
 	}
 
@@ -1008,6 +1314,17 @@ ublk_io_recv(struct ublk_queue *q)
 	io_uring_for_each_cqe(&q->ring, head, cqe) {
 		tag = user_data_to_tag(cqe->user_data);
 		cmd_op = user_data_to_op(cqe->user_data);
+
+		if (cmd_op == UBLK_IO_USER_COPY) {
+			q->cmd_inflight--;
+			ublk_user_copy_done(q, tag, cqe->res);
+			count += 1;
+			if (count == UBLK_QUEUE_REQUEST) {
+				break;
+			}
+			continue;
+		}
+
 		fetch = (cqe->res != UBLK_IO_RES_ABORT) && !dev->is_closing;
 
 		SPDK_DEBUGLOG(ublk_io, "res %d qid %d tag %u cmd_op %u\n",
@@ -1025,7 +1342,7 @@ ublk_io_recv(struct ublk_queue *q)
 
 		TAILQ_INSERT_TAIL(&q->inflight_io_list, io, tailq);
 		if (cqe->res == UBLK_IO_RES_OK) {
-			ublk_submit_bdev_io(q, tag);
+			ublk_handle_io(q, tag);
 		} else if (cqe->res == UBLK_IO_RES_NEED_GET_DATA) {
 			ublk_mark_io_get_data(io);
 			TAILQ_REMOVE(&q->inflight_io_list, io, tailq);
@@ -1223,7 +1540,7 @@ ublk_info_param_init(struct spdk_ublk_dev *ublk)
 		.dev_id = ublk->ublk_id,
 		.max_io_buf_bytes = UBLK_IO_MAX_BYTES,
 		.ublksrv_pid = getpid(),
-		.flags = UBLK_F_URING_CMD_COMP_IN_TASK,
+		.flags = UBLK_F_URING_CMD_COMP_IN_TASK | (ublk->user_copy ? UBLK_F_USER_COPY : 0),
 	};
 	struct ublk_params uparams = {
 		.types = UBLK_PARAM_TYPE_BASIC,
@@ -1267,7 +1584,9 @@ ublk_ios_fini(struct spdk_ublk_dev *ublk)
 		}
 
 		for (i = 0; i < q->q_depth; i++) {
-			if (q->ios[i].payload) {
+			/* In user copy mode the buffers are only held while the I/O is processed */
+			assert(!ublk->user_copy || q->ios[i].payload == NULL);
+			if (q->ios[i].payload && !ublk->user_copy) {
 				spdk_mempool_put(ublk->io_buf_pool, q->ios[i].payload);
 				q->ios[i].payload = NULL;
 			}
@@ -1287,18 +1606,20 @@ ublk_ios_init(struct spdk_ublk_dev *ublk)
 	uint32_t i, j;
 	struct ublk_queue *q;
 
-	snprintf(mempool_name, sizeof(mempool_name), "ublk_io_buf_pool_%d", ublk->ublk_id);
-
-	/* Create a mempool to allocate buf for each io */
-	ublk->io_buf_pool = spdk_mempool_create(mempool_name,
-						ublk->num_queues * ublk->queue_depth,
-						UBLK_IO_MAX_BYTES,
-						0,
-						SPDK_ENV_SOCKET_ID_ANY);
-	if (ublk->io_buf_pool == NULL) {
-		rc = -ENOMEM;
-		SPDK_ERRLOG("could not allocate ublk_io_buf pool\n");
-		return rc;
+	if (!ublk->user_copy) {
+		snprintf(mempool_name, sizeof(mempool_name), "ublk_io_buf_pool_%d", ublk->ublk_id);
+
+		/* Create a mempool to allocate buf for each io */
+		ublk->io_buf_pool = spdk_mempool_create(mempool_name,
+							ublk->num_queues * ublk->queue_depth,
+							UBLK_IO_MAX_BYTES,
+							0,
+							SPDK_ENV_SOCKET_ID_ANY);
+		if (ublk->io_buf_pool == NULL) {
+			rc = -ENOMEM;
+			SPDK_ERRLOG("could not allocate ublk_io_buf pool\n");
+			return rc;
+		}
 	}
 
 	for (i = 0; i < ublk->num_queues; i++) {
@@ -1317,7 +1638,9 @@ ublk_ios_init(struct spdk_ublk_dev *ublk)
 		}
 		for (j = 0; j < q->q_depth; j++) {
 			q->ios[j].q = q;
-			q->ios[j].payload = spdk_mempool_get(ublk->io_buf_pool);
+			if (!ublk->user_copy) {
+				q->ios[j].payload = spdk_mempool_get(ublk->io_buf_pool);
+			}
 		}
 	}
 
@@ -1339,17 +1662,37 @@ ublk_queue_run(void *arg1)
 	/* Queues must be filled with IO in the io pthread */
 	ublk_dev_queue_io_init(q);
 
-	ublk->ch[q->q_id] = spdk_bdev_get_io_channel(ublk->bdev_desc);
+	q->bdev_ch = spdk_bdev_get_io_channel(ublk->bdev_desc);
 	TAILQ_INSERT_TAIL(&thread_ctx->queue_list, q, tailq);
 }
 
+static bool
+ublk_user_copy_supported(void)
+{
+	struct spdk_iobuf_opts opts;
+
+	if (!(g_ublk_tgt.features & UBLK_F_USER_COPY)) {
+		SPDK_NOTICELOG("ublk driver doesn't support UBLK_F_USER_COPY\n");
+		return false;
+	}
+
+	spdk_iobuf_get_opts(&opts);
+	if (opts.large_bufsize < UBLK_IO_MAX_BYTES) {
+		SPDK_NOTICELOG("iobuf large_bufsize %" PRIu32 " is smaller than the maximum ublk I/O size %u\n",
+			       opts.large_bufsize, UBLK_IO_MAX_BYTES);
+		return false;
+	}
+
+	return true;
+}
+
 int
 ublk_start_disk(const char *bdev_name, uint32_t ublk_id,
-		uint32_t num_queues, uint32_t queue_depth,
+		uint32_t num_queues, uint32_t queue_depth, bool user_copy,
 		ublk_start_cb start_cb, void *cb_arg)
 {
 	int			rc;
-	uint32_t		i;
+	uint32_t		i, max_queues;
 	struct spdk_bdev	*bdev;
 	struct spdk_ublk_dev	*ublk = NULL;
 
@@ -1371,8 +1714,14 @@ ublk_start_disk(const char *bdev_name, uint32_t ublk_id,
 	ublk->cb_arg = cb_arg;
 	ublk->cdev_fd = -1;
 	ublk->ublk_id = ublk_id;
-	UBLK_DEBUGLOG(ublk, "bdev %s num_queues %d queue_depth %d\n",
-		      bdev_name, num_queues, queue_depth);
+	UBLK_DEBUGLOG(ublk, "bdev %s num_queues %d queue_depth %d user_copy %d\n",
+		      bdev_name, num_queues, queue_depth, user_copy);
+
+	if (user_copy && !ublk_user_copy_supported()) {
+		SPDK_NOTICELOG("ublk%u: falling back to copying the I/O data in the kernel\n", ublk_id);
+		user_copy = false;
+	}
+	ublk->user_copy = user_copy;
 
 	rc = spdk_bdev_open_ext(bdev_name, true, ublk_bdev_event_cb, ublk, &ublk->bdev_desc);
 	if (rc != 0) {
@@ -1393,10 +1742,18 @@ ublk_start_disk(const char *bdev_name, uint32_t ublk_id,
 			     ublk->queue_depth, ublk->ublk_id, UBLK_DEV_MAX_QUEUE_DEPTH);
 		ublk->queue_depth = UBLK_DEV_MAX_QUEUE_DEPTH;
 	}
-	if (ublk->num_queues > UBLK_DEV_MAX_QUEUES) {
+	/* blk-mq doesn't use more hardware queues than there are CPUs */
+	max_queues = spdk_max(sysconf(_SC_NPROCESSORS_CONF), 1);
+	if (ublk->num_queues > max_queues) {
 		SPDK_WARNLOG("Set Queue num %d of UBLK %d to maximum %d\n",
-			     ublk->num_queues, ublk->ublk_id, UBLK_DEV_MAX_QUEUES);
-		ublk->num_queues = UBLK_DEV_MAX_QUEUES;
+			     ublk->num_queues, ublk->ublk_id, max_queues);
+		ublk->num_queues = max_queues;
+	}
+	ublk->queues = calloc(ublk->num_queues, sizeof(*ublk->queues));
+	if (ublk->queues == NULL) {
+		spdk_bdev_close(ublk->bdev_desc);
+		free(ublk);
+		return -ENOMEM;
 	}
 	for (i = 0; i < ublk->num_queues; i++) {
 		ublk->queues[i].ring.ring_fd = -1;
@@ -1406,6 +1763,7 @@ ublk_start_disk(const char *bdev_name, uint32_t ublk_id,
 	rc = ublk_dev_list_register(ublk);
 	if (rc != 0) {
 		spdk_bdev_close(ublk->bdev_desc);
+		free(ublk->queues);
 		free(ublk);
 		return rc;
 	}
@@ -1428,12 +1786,99 @@ ublk_start_disk(const char *bdev_name, uint32_t ublk_id,
 	return rc;
 }
 
+static void
+ublk_get_queue_affinity_done(struct spdk_ublk_dev *ublk)
+{
+	int rc;
+
+	/* The affinity of the previous queue was received, ask for the next one */
+	if (ublk->ctrl_cmd_op == UBLK_CMD_GET_QUEUE_AFFINITY) {
+		ublk->ctrl_q_id++;
+	}
+
+	if (ublk->ctrl_q_id < ublk->num_queues) {
+		rc = ublk_ctrl_cmd(ublk, UBLK_CMD_GET_QUEUE_AFFINITY);
+		if (rc == 0) {
+			return;
+		}
+		/* Not fatal, the queues without affinity are simply spread over the threads */
+		SPDK_WARNLOG("ublk%d: can't get queue affinity, rc %s\n", ublk->ublk_id, spdk_strerror(-rc));
+	}
+
+	ublk_finish_start(ublk);
+}
+
+static int
+ublk_get_cpu_numa_node(uint32_t cpu)
+{
+	char path[64];
+	DIR *dir;
+	struct dirent *entry;
+	int node = -1;
+
+	snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u", cpu);
+	dir = opendir(path);
+	if (dir == NULL) {
+		return -1;
+	}
+
+	while ((entry = readdir(dir)) != NULL) {
+		if (sscanf(entry->d_name, "node%d", &node) == 1) {
+			break;
+		}
+	}
+	closedir(dir);
+
+	return node;
+}
+
+/*
+ * Pick the ublk thread for a queue, in order of preference: a thread running on one of the CPUs
+ * mapped to the queue, so the requests don't bounce between cores, a thread on the same NUMA
+ * node as those CPUs, or any thread. The least loaded thread is taken within each of these.
+ * This relies on the SPDK cores being the host CPUs of the same ids, which is the default.
+ */
+static struct ublk_thread_ctx *
+ublk_queue_select_thread(struct ublk_queue *q)
+{
+	struct ublk_thread_ctx *thread_ctx, *best = NULL;
+	uint32_t i, socket_id, best_rank = UINT32_MAX, rank;
+	int numa_node = -1, cpu;
+
+	for (cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+		if (CPU_ISSET(cpu, &q->cpuset)) {
+			numa_node = ublk_get_cpu_numa_node(cpu);
+			break;
+		}
+	}
+
+	for (i = 0; i < g_num_ublk_threads; i++) {
+		thread_ctx = &g_ublk_tgt.thread_ctx[i];
+		socket_id = spdk_env_get_socket_id(thread_ctx->core);
+		if (thread_ctx->core < CPU_SETSIZE && CPU_ISSET(thread_ctx->core, &q->cpuset)) {
+			rank = 0;
+		} else if (numa_node >= 0 && socket_id == (uint32_t)numa_node) {
+			rank = 1;
+		} else {
+			rank = 2;
+		}
+
+		if (best == NULL || rank < best_rank ||
+		    (rank == best_rank && thread_ctx->num_queues < best->num_queues)) {
+			best = thread_ctx;
+			best_rank = rank;
+		}
+	}
+
+	return best;
+}
+
 static void
 ublk_finish_start(struct spdk_ublk_dev *ublk)
 {
 	int			rc;
 	uint32_t		q_id;
-	struct spdk_thread	*ublk_thread;
+	struct ublk_thread_ctx	*thread_ctx;
 	char			buf[64];
 
 	snprintf(buf, 64, "%s%d", UBLK_BLK_CDEV, ublk->ublk_id);
@@ -1458,15 +1903,13 @@ ublk_finish_start(struct spdk_ublk_dev *ublk)
 		goto err;
 	}
 
-	/* Send queue to different spdk_threads for load balance */
+	/* Send queues to the spdk_threads close to the CPUs submitting to them */
 	for (q_id = 0; q_id < ublk->num_queues; q_id++) {
-		ublk->queues[q_id].thread_ctx = &g_ublk_tgt.thread_ctx[g_queue_thread_id];
-		ublk_thread = g_ublk_tgt.thread_ctx[g_queue_thread_id].ublk_thread;
-		spdk_thread_send_msg(ublk_thread, ublk_queue_run, &ublk->queues[q_id]);
-		g_queue_thread_id++;
-		if (g_queue_thread_id == g_num_ublk_threads) {
-			g_queue_thread_id = 0;
-		}
+		thread_ctx = ublk_queue_select_thread(&ublk->queues[q_id]);
+		thread_ctx->num_queues++;
+		ublk->queues[q_id].thread_ctx = thread_ctx;
+		UBLK_DEBUGLOG(ublk, "queue %u on core %u\n", q_id, thread_ctx->core);
+		spdk_thread_send_msg(thread_ctx->ublk_thread, ublk_queue_run, &ublk->queues[q_id]);
 	}
 
 	goto out;
@@ -23,7 +23,7 @@ typedef void (*ublk_del_cb)(void *cb_arg);
 int ublk_create_target(const char *cpumask_str);
 int ublk_destroy_target(spdk_ublk_fini_cb cb_fn, void *cb_arg);
 int ublk_start_disk(const char *bdev_name, uint32_t ublk_id,
-		    uint32_t num_queues, uint32_t queue_depth,
+		    uint32_t num_queues, uint32_t queue_depth, bool user_copy,
 		    ublk_start_cb start_cb, void *cb_arg);
 int ublk_stop_disk(uint32_t ublk_id, ublk_del_cb del_cb, void *cb_arg);
 struct spdk_ublk_dev *ublk_dev_find_by_id(uint32_t ublk_id);
@@ -33,6 +33,8 @@ struct spdk_ublk_dev *ublk_dev_first(void);
 struct spdk_ublk_dev *ublk_dev_next(struct spdk_ublk_dev *prev);
 uint32_t ublk_dev_get_queue_depth(struct spdk_ublk_dev *ublk);
 uint32_t ublk_dev_get_num_queues(struct spdk_ublk_dev *ublk);
+bool ublk_dev_get_user_copy(struct spdk_ublk_dev *ublk);
+void ublk_dev_write_queues_json(struct spdk_ublk_dev *ublk, struct spdk_json_write_ctx *w);
 
 #ifdef __cplusplus
 }
@@ -81,6 +81,7 @@ struct rpc_ublk_start_disk {
 	uint32_t	ublk_id;
 	uint32_t	num_queues;
 	uint32_t	queue_depth;
+	bool		user_copy;
 	struct spdk_jsonrpc_request *request;
 };
 
@@ -89,6 +90,7 @@ static const struct spdk_json_object_decoder rpc_ublk_start_disk_decoders[] = {
 	{"ublk_id", offsetof(struct rpc_ublk_start_disk, ublk_id), spdk_json_decode_uint32},
 	{"num_queues", offsetof(struct rpc_ublk_start_disk, num_queues), spdk_json_decode_uint32, true},
 	{"queue_depth", offsetof(struct rpc_ublk_start_disk, queue_depth), spdk_json_decode_uint32, true},
+	{"user_copy", offsetof(struct rpc_ublk_start_disk, user_copy), spdk_json_decode_bool, true},
 };
 
 static void
@@ -142,7 +144,7 @@ rpc_ublk_start_disk(struct spdk_jsonrpc_request *request,
 	}
 
 	rc = ublk_start_disk(req->bdev_name, req->ublk_id, req->num_queues, req->queue_depth,
-			     rpc_ublk_start_disk_done, req);
+			     req->user_copy, rpc_ublk_start_disk_done, req);
 	if (rc != 0) {
 		rpc_ublk_start_disk_done(req, rc);
 	}
@@ -229,7 +231,9 @@ rpc_dump_ublk_info(struct spdk_json_write_ctx *w,
 	spdk_json_write_named_uint32(w, "id", ublk_dev_get_id(ublk));
 	spdk_json_write_named_uint32(w, "queue_depth", ublk_dev_get_queue_depth(ublk));
 	spdk_json_write_named_uint32(w, "num_queues", ublk_dev_get_num_queues(ublk));
+	spdk_json_write_named_bool(w, "user_copy", ublk_dev_get_user_copy(ublk));
 	spdk_json_write_named_string(w, "bdev_name", ublk_dev_get_bdev_name(ublk));
+	ublk_dev_write_queues_json(ublk, w);
 
 	spdk_json_write_object_end(w);
 }
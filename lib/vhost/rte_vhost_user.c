@@ -176,7 +176,9 @@ vhost_vq_avail_ring_get(struct spdk_vhost_virtqueue *virtqueue, uint16_t *reqs,
 
 	spdk_smp_rmb();
 
-	if (virtqueue->vsession && spdk_unlikely(virtqueue->vsession->interrupt_mode)) {
+	/* A virtqueue with its own poller doesn't wait for kicks, even in interrupt mode */
+	if (virtqueue->vsession && spdk_unlikely(virtqueue->vsession->interrupt_mode) &&
+	    virtqueue->poller == NULL) {
 		/* Read to clear vring's kickfd */
 		rc = read(vring->kickfd, &u64_value, sizeof(u64_value));
 		if (rc < 0) {
@@ -201,7 +203,14 @@ vhost_vq_avail_ring_get(struct spdk_vhost_virtqueue *virtqueue, uint16_t *reqs,
 
 	virtqueue->last_avail_idx += count;
 	/* Check whether there are unprocessed reqs in vq, then kick vq manually */
-	if (virtqueue->vsession && spdk_unlikely(virtqueue->vsession->interrupt_mode)) {
+	if (virtqueue->vsession && spdk_unlikely(virtqueue->vsession->interrupt_mode) &&
+	    virtqueue->poller == NULL) {
+		if (vhost_dev_has_feature(virtqueue->vsession, VIRTIO_RING_F_EVENT_IDX)) {
+			/* Ask for a kick on the next request */
+			* (volatile uint16_t *) vhost_vq_avail_event(virtqueue) = virtqueue->last_avail_idx;
+			spdk_smp_mb();
+		}
+
 		/* If avail_idx is larger than virtqueue's last_avail_idx, then there is unprocessed reqs.
 		 * avail_idx should get updated here from memory, in case of race condition with guest.
 		 */
@@ -346,10 +355,31 @@ vhost_inflight_queue_get_desc(struct spdk_vhost_session *vsession,
 	return 0;
 }
 
+static int
+vhost_vq_call(struct spdk_vhost_session *vsession, struct spdk_vhost_virtqueue *virtqueue)
+{
+	/*
+	 * rte_vhost checks the event index against the used index of the rings it processes
+	 * itself, which is never updated for ours. Whether the guest wants to be interrupted
+	 * was already checked in vhost_vq_event_is_suppressed(), so signal it directly.
+	 */
+	if (vhost_dev_has_feature(vsession, VIRTIO_RING_F_EVENT_IDX)) {
+		if (virtqueue->vring.callfd < 0) {
+			return -1;
+		}
+
+		return eventfd_write(virtqueue->vring.callfd, (eventfd_t)1);
+	}
+
+	return rte_vhost_vring_call(vsession->vid, virtqueue->vring_idx);
+}
+
 int
 vhost_vq_used_signal(struct spdk_vhost_session *vsession,
 		     struct spdk_vhost_virtqueue *virtqueue)
 {
+	vhost_vq_used_ring_flush(vsession, virtqueue);
+
 	if (virtqueue->used_req_cnt == 0) {
 		return 0;
 	}
@@ -358,10 +388,11 @@ vhost_vq_used_signal(struct spdk_vhost_session *vsession,
 		      "Queue %td - USED RING: sending IRQ: last used %"PRIu16"\n",
 		      virtqueue - vsession->virtqueue, virtqueue->last_used_idx);
 
-	if (rte_vhost_vring_call(vsession->vid, virtqueue->vring_idx) == 0) {
+	if (vhost_vq_call(vsession, virtqueue) == 0) {
 		/* interrupt signalled */
 		virtqueue->req_cnt += virtqueue->used_req_cnt;
 		virtqueue->used_req_cnt = 0;
+		virtqueue->stats.irqs++;
 		return 1;
 	} else {
 		/* interrupt not signalled */
@@ -384,6 +415,8 @@ session_vq_io_stats_update(struct spdk_vhost_session *vsession,
 	}
 
 	irq_delay = (irq_delay_base * (req_cnt - io_threshold)) / io_threshold;
+	/* Don't let the delay grow with the load indefinitely, it adds to the latency of every request */
+	irq_delay = spdk_min(irq_delay, (int64_t)irq_delay_base * SPDK_VHOST_COALESCING_MAX_DELAY_FACTOR);
 	virtqueue->irq_delay_time = (uint32_t) spdk_max(0, irq_delay);
 
 	virtqueue->req_cnt = 0;
@@ -394,28 +427,59 @@ static void
 check_session_vq_io_stats(struct spdk_vhost_session *vsession,
 			  struct spdk_vhost_virtqueue *virtqueue, uint64_t now)
 {
-	if (now < vsession->next_stats_check_time) {
+	if (now < virtqueue->next_stats_check_time) {
 		return;
 	}
 
-	vsession->next_stats_check_time = now + vsession->stats_check_interval;
+	virtqueue->next_stats_check_time = now + vsession->stats_check_interval;
 	session_vq_io_stats_update(vsession, virtqueue, now);
 }
 
+/*
+ * Check whether the guest asked not to be interrupted for the entries added to
+ * the used ring since the last check. With VIRTIO_RING_F_EVENT_IDX on split rings,
+ * the guest names the used index it wants an interrupt for, which lets it skip the
+ * interrupts for completions it is going to reap anyway.
+ */
 static inline bool
 vhost_vq_event_is_suppressed(struct spdk_vhost_virtqueue *vq)
 {
+	uint16_t old_idx, new_idx;
+	bool valid;
+
 	if (spdk_unlikely(vq->packed.packed_ring)) {
+		/* Event index mode of packed rings is not used, VRING_PACKED_EVENT_FLAG_DESC enables events */
 		if (vq->vring.driver_event->flags & VRING_PACKED_EVENT_FLAG_DISABLE) {
-			return true;
+			goto suppressed;
+		}
+	} else if (vhost_dev_has_feature(vq->vsession, VIRTIO_RING_F_EVENT_IDX)) {
+		old_idx = vq->signalled_used;
+		new_idx = vq->last_used_idx;
+		valid = vq->signalled_used_valid;
+		vq->signalled_used = new_idx;
+		vq->signalled_used_valid = true;
+
+		/* Make sure used->idx is visible before used_event is read */
+		spdk_smp_mb();
+
+		if (valid && !vring_need_event(* (volatile uint16_t *) vhost_vq_used_event(vq),
+					       new_idx, old_idx)) {
+			goto suppressed;
 		}
 	} else {
 		if (vq->vring.avail->flags & VRING_AVAIL_F_NO_INTERRUPT) {
-			return true;
+			goto suppressed;
 		}
 	}
 
 	return false;
+
+suppressed:
+	if (vq->used_req_cnt != 0) {
+		vq->stats.irqs_suppressed++;
+	}
+
+	return true;
 }
 
 void
@@ -424,6 +488,9 @@ vhost_session_vq_used_signal(struct spdk_vhost_virtqueue *virtqueue)
 	struct spdk_vhost_session *vsession = virtqueue->vsession;
 	uint64_t now;
 
+	/* The guest can pick up the completions even if it's not interrupted yet */
+	vhost_vq_used_ring_flush(vsession, virtqueue);
+
 	if (vsession->coalescing_delay_time_base == 0) {
 		if (virtqueue->vring.desc == NULL) {
 			return;
@@ -480,6 +547,13 @@ vhost_vq_used_ring_enqueue(struct spdk_vhost_session *vsession,
 	used->ring[last_idx].id = id;
 	used->ring[last_idx].len = len;
 
+	if (virtqueue->used_batch && !vsession->interrupt_mode) {
+		/* used->idx is updated for the whole batch by vhost_vq_used_ring_flush() */
+		virtqueue->used_req_cnt++;
+		vhost_log_used_vring_elem(vsession, virtqueue, last_idx);
+		return;
+	}
+
 	/* Ensure the used ring is updated before we log it or increment used->idx. */
 	spdk_smp_wmb();
 
@@ -502,6 +576,26 @@ vhost_vq_used_ring_enqueue(struct spdk_vhost_session *vsession,
 	}
 }
 
+void
+vhost_vq_used_ring_flush(struct spdk_vhost_session *vsession,
+			 struct spdk_vhost_virtqueue *virtqueue)
+{
+	struct vring_used *used = virtqueue->vring.used;
+
+	if (virtqueue->packed.packed_ring || used == NULL || used->idx == virtqueue->last_used_idx) {
+		return;
+	}
+
+	SPDK_DEBUGLOG(vhost_ring, "Queue %td - USED RING: publishing used idx %"PRIu16" (was %"PRIu16")\n",
+		      virtqueue - vsession->virtqueue, virtqueue->last_used_idx, used->idx);
+
+	/* Ensure the used ring entries are visible before used->idx. */
+	spdk_smp_wmb();
+
+	* (volatile uint16_t *) &used->idx = virtqueue->last_used_idx;
+	vhost_log_used_vring_idx(vsession, virtqueue);
+}
+
 void
 vhost_vq_packed_ring_enqueue(struct spdk_vhost_session *vsession,
 			     struct spdk_vhost_virtqueue *virtqueue,
@@ -966,7 +1060,6 @@ new_connection(int vid)
 		return -1;
 	}
 	vsession->started = false;
-	vsession->next_stats_check_time = 0;
 	vsession->stats_check_interval = SPDK_VHOST_STATS_CHECK_INTERVAL_MS *
 					 spdk_get_ticks_hz() / 1000UL;
 	TAILQ_INSERT_TAIL(&user_dev->vsessions, vsession, tailq);
@@ -1097,19 +1190,11 @@ enable_device_vq(struct spdk_vhost_session *vsession, uint16_t qid)
 		q->last_avail_idx = q->last_avail_idx & 0x7FFF;
 		q->packed.used_phase = q->last_used_idx >> 15;
 		q->last_used_idx = q->last_used_idx & 0x7FFF;
-
-		if (!vsession->interrupt_mode) {
-			/* Disable I/O submission notifications, we'll be polling. */
-			q->vring.device_event->flags = VRING_PACKED_EVENT_FLAG_DISABLE;
-		}
-	} else {
-		if (!vsession->interrupt_mode) {
-			/* Disable I/O submission notifications, we'll be polling. */
-			q->vring.used->flags = VRING_USED_F_NO_NOTIFY;
-		}
 	}
 
 	q->packed.packed_ring = packed_ring;
+	/* Disable I/O submission notifications if we'll be polling. */
+	vhost_vq_set_guest_notify(vsession, q, vsession->interrupt_mode);
 	vsession->max_queues = spdk_max(vsession->max_queues, qid + 1);
 
 	return 0;
@@ -1401,15 +1486,33 @@ vhost_user_dev_foreach_session(struct spdk_vhost_dev *vdev,
 	spdk_thread_send_msg(vdev->thread, foreach_session, ev_ctx);
 }
 
+void
+vhost_vq_set_guest_notify(struct spdk_vhost_session *vsession, struct spdk_vhost_virtqueue *vq,
+			  bool enable)
+{
+	if (vq->packed.packed_ring) {
+		* (volatile uint16_t *) &vq->vring.device_event->flags =
+			enable ? VRING_PACKED_EVENT_FLAG_ENABLE : VRING_PACKED_EVENT_FLAG_DISABLE;
+		return;
+	}
+
+	* (volatile uint16_t *) &vq->vring.used->flags = enable ? 0 : VRING_USED_F_NO_NOTIFY;
+
+	/*
+	 * The flags are ignored by guests using event indexes. The avail event is
+	 * left behind when polling, so the guest only kicks once it wraps around.
+	 */
+	if (enable && vhost_dev_has_feature(vsession, VIRTIO_RING_F_EVENT_IDX)) {
+		* (volatile uint16_t *) vhost_vq_avail_event(vq) = vq->last_avail_idx;
+	}
+}
+
 void
 vhost_user_session_set_interrupt_mode(struct spdk_vhost_session *vsession, bool interrupt_mode)
 {
 	uint16_t i;
-	bool packed_ring;
 	int rc = 0;
 
-	packed_ring = ((vsession->negotiated_features & (1ULL << VIRTIO_F_RING_PACKED)) != 0);
-
 	for (i = 0; i < vsession->max_queues; i++) {
 		struct spdk_vhost_virtqueue *q = &vsession->virtqueue[i];
 		uint64_t num_events = 1;
@@ -1422,12 +1525,11 @@ vhost_user_session_set_interrupt_mode(struct spdk_vhost_session *vsession, bool
 		}
 
 		if (interrupt_mode) {
+			/* Completions are published one by one from now on */
+			vhost_session_vq_used_signal(q);
+
 			/* Enable I/O submission notifications, we'll be interrupting. */
-			if (packed_ring) {
-				* (volatile uint16_t *) &q->vring.device_event->flags = VRING_PACKED_EVENT_FLAG_ENABLE;
-			} else {
-				* (volatile uint16_t *) &q->vring.used->flags = 0;
-			}
+			vhost_vq_set_guest_notify(vsession, q, true);
 
 			/* In case of race condition, always kick vring when switch to intr */
 			rc = write(q->vring.kickfd, &num_events, sizeof(num_events));
@@ -1438,11 +1540,7 @@ vhost_user_session_set_interrupt_mode(struct spdk_vhost_session *vsession, bool
 			vsession->interrupt_mode = true;
 		} else {
 			/* Disable I/O submission notifications, we'll be polling. */
-			if (packed_ring) {
-				* (volatile uint16_t *) &q->vring.device_event->flags = VRING_PACKED_EVENT_FLAG_DISABLE;
-			} else {
-				* (volatile uint16_t *) &q->vring.used->flags = VRING_USED_F_NO_NOTIFY;
-			}
+			vhost_vq_set_guest_notify(vsession, q, false);
 
 			vsession->interrupt_mode = false;
 		}
@@ -1731,6 +1829,55 @@ vhost_user_get_coalescing(struct spdk_vhost_dev *vdev, uint32_t *delay_base_us,
 	}
 }
 
+void
+vhost_user_dev_dump_vq_stats_json(struct spdk_vhost_dev *vdev, struct spdk_json_write_ctx *w)
+{
+	struct spdk_vhost_user_dev *user_dev = to_user_dev(vdev);
+	struct spdk_vhost_session *vsession;
+	struct spdk_vhost_virtqueue *vq;
+	uint16_t i;
+
+	spdk_json_write_named_array_begin(w, "sessions");
+
+	pthread_mutex_lock(&user_dev->lock);
+	TAILQ_FOREACH(vsession, &user_dev->vsessions, tailq) {
+		if (!vsession->started) {
+			continue;
+		}
+
+		spdk_json_write_object_begin(w);
+		spdk_json_write_named_string(w, "name", vsession->name);
+		spdk_json_write_named_bool(w, "interrupt_mode", vsession->interrupt_mode);
+		spdk_json_write_named_bool(w, "event_idx",
+					   vhost_dev_has_feature(vsession, VIRTIO_RING_F_EVENT_IDX));
+
+		spdk_json_write_named_array_begin(w, "virtqueues");
+		for (i = 0; i < vsession->max_queues; i++) {
+			vq = &vsession->virtqueue[i];
+			if (vq->vring.desc == NULL) {
+				continue;
+			}
+
+			spdk_json_write_object_begin(w);
+			spdk_json_write_named_uint32(w, "id", i);
+			spdk_json_write_named_bool(w, "polling", !vsession->interrupt_mode || vq->poller != NULL);
+			spdk_json_write_named_uint64(w, "polls", vq->stats.polls);
+			spdk_json_write_named_uint64(w, "busy_polls", vq->stats.busy_polls);
+			spdk_json_write_named_uint64(w, "kicks", vq->stats.kicks);
+			spdk_json_write_named_uint64(w, "irqs", vq->stats.irqs);
+			spdk_json_write_named_uint64(w, "irqs_suppressed", vq->stats.irqs_suppressed);
+			spdk_json_write_named_uint64(w, "mode_switches", vq->stats.mode_switches);
+			spdk_json_write_object_end(w);
+		}
+		spdk_json_write_array_end(w);
+
+		spdk_json_write_object_end(w);
+	}
+	pthread_mutex_unlock(&user_dev->lock);
+
+	spdk_json_write_array_end(w);
+}
+
 int
 spdk_vhost_set_socket_path(const char *basename)
 {
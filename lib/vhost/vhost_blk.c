@@ -37,10 +37,14 @@
 
 #define VIRTIO_BLK_DEFAULT_TRANSPORT "vhost_user_blk"
 
+#define SPDK_VHOST_BLK_MAX_QUEUE_THREADS 64
+
 struct spdk_vhost_user_blk_task {
 	struct spdk_vhost_blk_task blk_task;
 	struct spdk_vhost_blk_session *bvsession;
 	struct spdk_vhost_virtqueue *vq;
+	/* Queue group the task's virtqueue belongs to, NULL if it's processed on the session thread */
+	struct vhost_blk_queue_group *qgroup;
 
 	uint16_t req_idx;
 	uint16_t num_descs;
@@ -60,6 +64,35 @@ struct spdk_vhost_blk_dev {
 	/* dummy_io_channel is used to hold a bdev reference */
 	struct spdk_io_channel *dummy_io_channel;
 	bool readonly;
+	bool event_idx;
+
+	/*
+	 * In interrupt mode, a virtqueue kicked by the guest is polled until it stays
+	 * idle for this long. 0 means virtqueues are only processed on guest kicks.
+	 */
+	uint32_t poll_idle_us;
+
+	/*
+	 * Threads the virtqueues of each session are spread over, in addition to
+	 * the controller thread. num_queue_threads counts the controller thread too.
+	 */
+	struct spdk_thread **queue_threads;
+	uint32_t num_queue_threads;
+};
+
+/*
+ * Virtqueues of a session processed on one of the controller's queue threads.
+ * It holds virtqueues first_vq, first_vq + num_qgroups + 1 and so on, while the
+ * session thread takes care of virtqueues 0, num_qgroups + 1 etc.
+ */
+struct vhost_blk_queue_group {
+	struct spdk_vhost_blk_session *bvsession;
+	struct spdk_thread *thread;
+	struct spdk_io_channel *io_channel;
+	struct spdk_poller *requestq_poller;
+	struct spdk_poller *stop_poller;
+	int task_cnt;
+	uint16_t first_vq;
 };
 
 struct spdk_vhost_blk_session {
@@ -69,6 +102,12 @@ struct spdk_vhost_blk_session {
 	struct spdk_poller *requestq_poller;
 	struct spdk_io_channel *io_channel;
 	struct spdk_poller *stop_poller;
+	uint64_t poll_idle_ticks;
+
+	struct vhost_blk_queue_group *qgroups;
+	uint32_t num_qgroups;
+	/* Queue groups still running, only accessed on the session thread */
+	uint32_t num_qgroups_running;
 };
 
 /* forward declaration */
@@ -82,8 +121,11 @@ vhost_user_process_blk_request(struct spdk_vhost_user_blk_task *user_task)
 {
 	struct spdk_vhost_blk_session *bvsession = user_task->bvsession;
 	struct spdk_vhost_dev *vdev = &bvsession->bvdev->vdev;
+	struct spdk_io_channel *ch;
+
+	ch = user_task->qgroup != NULL ? user_task->qgroup->io_channel : bvsession->io_channel;
 
-	return virtio_blk_process_request(vdev, bvsession->io_channel, &user_task->blk_task,
+	return virtio_blk_process_request(vdev, ch, &user_task->blk_task,
 					  vhost_user_blk_request_finish, NULL);
 }
 
@@ -119,11 +161,24 @@ to_blk_session(struct spdk_vhost_session *vsession)
 	return (struct spdk_vhost_blk_session *)vsession;
 }
 
+static inline int *
+blk_task_cnt(struct spdk_vhost_user_blk_task *task)
+{
+	/* Tasks are counted by the thread processing them */
+	if (task->qgroup != NULL) {
+		return &task->qgroup->task_cnt;
+	}
+
+	return &task->bvsession->vsession.task_cnt;
+}
+
 static void
 blk_task_finish(struct spdk_vhost_user_blk_task *task)
 {
-	assert(task->bvsession->vsession.task_cnt > 0);
-	task->bvsession->vsession.task_cnt--;
+	int *task_cnt = blk_task_cnt(task);
+
+	assert(*task_cnt > 0);
+	(*task_cnt)--;
 	task->used = false;
 }
 
@@ -132,6 +187,7 @@ blk_task_init(struct spdk_vhost_user_blk_task *task)
 {
 	struct spdk_vhost_blk_task *blk_task = &task->blk_task;
 
+	(*blk_task_cnt(task))++;
 	task->used = true;
 	blk_task->iovcnt = SPDK_COUNTOF(blk_task->iovs);
 	blk_task->status = NULL;
@@ -652,8 +708,6 @@ process_blk_task(struct spdk_vhost_virtqueue *vq, uint16_t req_idx)
 		return;
 	}
 
-	task->bvsession->vsession.task_cnt++;
-
 	blk_task_init(task);
 
 	rc = blk_iovs_split_queue_setup(task->bvsession, vq, task->req_idx,
@@ -717,8 +771,6 @@ process_packed_blk_task(struct spdk_vhost_virtqueue *vq, uint16_t req_idx)
 					   req_idx, (req_idx + num_descs - 1) % vq->vring.size,
 					   &task->inflight_head);
 
-	task->bvsession->vsession.task_cnt++;
-
 	blk_task_init(task);
 
 	rc = blk_iovs_packed_queue_setup(task->bvsession, vq, task->req_idx, blk_task->iovs,
@@ -778,8 +830,6 @@ process_packed_inflight_blk_task(struct spdk_vhost_virtqueue *vq,
 	/* It's for cleaning inflight entries */
 	task->inflight_head = req_idx;
 
-	task->bvsession->vsession.task_cnt++;
-
 	blk_task_init(task);
 
 	rc = blk_iovs_inflight_queue_setup(task->bvsession, vq, task->req_idx, blk_task->iovs,
@@ -913,16 +963,119 @@ _vdev_vq_worker(struct spdk_vhost_virtqueue *vq)
 
 	vhost_session_vq_used_signal(vq);
 
+	vq->stats.polls++;
+	if (rc > 0) {
+		vq->stats.busy_polls++;
+	}
+
 	return rc;
 
 }
 
+static void vhost_blk_vq_stop_polling(struct spdk_vhost_virtqueue *vq);
+
+static int
+vdev_vq_poll(void *arg)
+{
+	struct spdk_vhost_virtqueue *vq = arg;
+	struct spdk_vhost_blk_session *bvsession = to_blk_session(vq->vsession);
+	uint64_t now;
+	int rc;
+
+	rc = _vdev_vq_worker(vq);
+
+	now = spdk_get_ticks();
+	if (rc > 0) {
+		vq->last_busy_time = now;
+		return SPDK_POLLER_BUSY;
+	}
+
+	if (now - vq->last_busy_time > bvsession->poll_idle_ticks) {
+		vhost_blk_vq_stop_polling(vq);
+	}
+
+	return SPDK_POLLER_IDLE;
+}
+
+/*
+ * Switch a kick-driven virtqueue to polling. Kicks are suppressed,
+ * as the guest doesn't need to wake us up anymore.
+ */
+static void
+vhost_blk_vq_start_polling(struct spdk_vhost_virtqueue *vq)
+{
+	vq->poller = SPDK_POLLER_REGISTER(vdev_vq_poll, vq, 0);
+	if (vq->poller == NULL) {
+		return;
+	}
+
+	vhost_vq_set_guest_notify(vq->vsession, vq, false);
+	vq->last_busy_time = spdk_get_ticks();
+	vq->stats.mode_switches++;
+}
+
+/*
+ * Switch a polled virtqueue back to guest kicks.
+ */
+static void
+vhost_blk_vq_stop_polling(struct spdk_vhost_virtqueue *vq)
+{
+	uint64_t num_events = 1;
+
+	spdk_poller_unregister(&vq->poller);
+	vhost_vq_set_guest_notify(vq->vsession, vq, true);
+	vq->stats.mode_switches++;
+
+	/* Requests added before the guest saw kicks enabled again wouldn't be kicked */
+	if (write(vq->vring.kickfd, &num_events, sizeof(num_events)) < 0) {
+		SPDK_ERRLOG("failed to kick vring: %s.\n", spdk_strerror(errno));
+	}
+}
+
 static int
 vdev_vq_worker(void *arg)
 {
 	struct spdk_vhost_virtqueue *vq = arg;
+	struct spdk_vhost_blk_session *bvsession = to_blk_session(vq->vsession);
+	uint64_t num_events;
+	int rc;
+
+	vq->stats.kicks++;
+
+	if (vq->poller != NULL) {
+		/* The virtqueue is polled anyway, just acknowledge the kick */
+		if (read(vq->vring.kickfd, &num_events, sizeof(num_events)) < 0 && errno != EAGAIN) {
+			SPDK_ERRLOG("failed to acknowledge kickfd: %s.\n", spdk_strerror(errno));
+		}
+		return SPDK_POLLER_IDLE;
+	}
+
+	rc = _vdev_vq_worker(vq);
+
+	/* More requests are likely to follow, poll for them instead of waiting for kicks */
+	if (rc > 0 && bvsession->poll_idle_ticks != 0) {
+		vhost_blk_vq_start_polling(vq);
+	}
+
+	return rc;
+}
+
+static void
+vhost_blk_session_unregister_vq_pollers(struct spdk_vhost_blk_session *bvsession)
+{
+	struct spdk_vhost_session *vsession = &bvsession->vsession;
+	int i;
+
+	for (i = 0; i < vsession->max_queues; i++) {
+		spdk_poller_unregister(&vsession->virtqueue[i].poller);
+	}
+}
 
-	return _vdev_vq_worker(vq);
+/* Distance between the indexes of virtqueues processed on the same thread */
+static inline uint16_t
+vhost_blk_vq_stride(struct spdk_vhost_blk_session *bvsession)
+{
+	return bvsession->num_qgroups + 1;
 }
 
 static int
@@ -933,7 +1086,24 @@ vdev_worker(void *arg)
 	uint16_t q_idx;
 	int rc = 0;
 
-	for (q_idx = 0; q_idx < vsession->max_queues; q_idx++) {
+	for (q_idx = 0; q_idx < vsession->max_queues; q_idx += vhost_blk_vq_stride(bvsession)) {
+		rc += _vdev_vq_worker(&vsession->virtqueue[q_idx]);
+	}
+
+	return rc > 0 ? SPDK_POLLER_BUSY : SPDK_POLLER_IDLE;
+}
+
+static int
+vdev_qgroup_worker(void *arg)
+{
+	struct vhost_blk_queue_group *qgroup = arg;
+	struct spdk_vhost_blk_session *bvsession = qgroup->bvsession;
+	struct spdk_vhost_session *vsession = &bvsession->vsession;
+	uint16_t q_idx;
+	int rc = 0;
+
+	for (q_idx = qgroup->first_vq; q_idx < vsession->max_queues;
+	     q_idx += vhost_blk_vq_stride(bvsession)) {
 		rc += _vdev_vq_worker(&vsession->virtqueue[q_idx]);
 	}
 
@@ -1004,21 +1174,27 @@ no_bdev_process_packed_vq(struct spdk_vhost_blk_session *bvsession, struct spdk_
 				     task->inflight_head);
 }
 
-static int
-_no_bdev_vdev_vq_worker(struct spdk_vhost_virtqueue *vq)
+static void
+no_bdev_vq_process(struct spdk_vhost_virtqueue *vq)
 {
-	struct spdk_vhost_session *vsession = vq->vsession;
-	struct spdk_vhost_blk_session *bvsession = to_blk_session(vsession);
-	bool packed_ring;
+	struct spdk_vhost_blk_session *bvsession = to_blk_session(vq->vsession);
 
-	packed_ring = vq->packed.packed_ring;
-	if (packed_ring) {
+	if (vq->packed.packed_ring) {
 		no_bdev_process_packed_vq(bvsession, vq);
 	} else {
 		no_bdev_process_vq(bvsession, vq);
 	}
 
 	vhost_session_vq_used_signal(vq);
+}
+
+static int
+_no_bdev_vdev_vq_worker(struct spdk_vhost_virtqueue *vq)
+{
+	struct spdk_vhost_session *vsession = vq->vsession;
+	struct spdk_vhost_blk_session *bvsession = to_blk_session(vsession);
+
+	no_bdev_vq_process(vq);
 
 	if (vsession->task_cnt == 0 && bvsession->io_channel) {
 		vhost_blk_put_io_channel(bvsession->io_channel);
@@ -1043,13 +1219,34 @@ no_bdev_vdev_worker(void *arg)
 	struct spdk_vhost_session *vsession = &bvsession->vsession;
 	uint16_t q_idx;
 
-	for (q_idx = 0; q_idx < vsession->max_queues; q_idx++) {
+	for (q_idx = 0; q_idx < vsession->max_queues; q_idx += vhost_blk_vq_stride(bvsession)) {
 		_no_bdev_vdev_vq_worker(&vsession->virtqueue[q_idx]);
 	}
 
 	return SPDK_POLLER_BUSY;
 }
 
+static int
+no_bdev_vdev_qgroup_worker(void *arg)
+{
+	struct vhost_blk_queue_group *qgroup = arg;
+	struct spdk_vhost_blk_session *bvsession = qgroup->bvsession;
+	struct spdk_vhost_session *vsession = &bvsession->vsession;
+	uint16_t q_idx;
+
+	for (q_idx = qgroup->first_vq; q_idx < vsession->max_queues;
+	     q_idx += vhost_blk_vq_stride(bvsession)) {
+		no_bdev_vq_process(&vsession->virtqueue[q_idx]);
+	}
+
+	if (qgroup->task_cnt == 0 && qgroup->io_channel) {
+		vhost_blk_put_io_channel(qgroup->io_channel);
+		qgroup->io_channel = NULL;
+	}
+
+	return SPDK_POLLER_BUSY;
+}
+
 static void
 vhost_blk_session_unregister_interrupts(struct spdk_vhost_blk_session *bvsession)
 {
@@ -1104,6 +1301,10 @@ vhost_blk_poller_set_interrupt_mode(struct spdk_poller *poller, void *cb_arg, bo
 {
 	struct spdk_vhost_blk_session *bvsession = cb_arg;
 
+	/* The session poller takes care of all virtqueues in poll mode, and
+	 * all of them start out kick-driven in interrupt mode.
+	 */
+	vhost_blk_session_unregister_vq_pollers(bvsession);
 	vhost_user_session_set_interrupt_mode(&bvsession->vsession, interrupt_mode);
 }
 
@@ -1146,17 +1347,36 @@ vhost_user_blk_resize_cb(struct spdk_vhost_dev *vdev, bdev_event_cb_complete cb,
 				       cb, cb_arg);
 }
 
+static void
+vhost_blk_qgroup_bdev_remove(void *arg)
+{
+	struct vhost_blk_queue_group *qgroup = arg;
+
+	/* The session might be stopping already */
+	if (qgroup->requestq_poller == NULL) {
+		return;
+	}
+
+	spdk_poller_unregister(&qgroup->requestq_poller);
+	qgroup->requestq_poller = SPDK_POLLER_REGISTER(no_bdev_vdev_qgroup_worker, qgroup, 0);
+}
+
 static int
 vhost_user_session_bdev_remove_cb(struct spdk_vhost_dev *vdev,
 				  struct spdk_vhost_session *vsession,
 				  void *ctx)
 {
 	struct spdk_vhost_blk_session *bvsession;
-	int rc;
+	int i, rc;
 
 	bvsession = to_blk_session(vsession);
 	if (bvsession->requestq_poller) {
 		spdk_poller_unregister(&bvsession->requestq_poller);
+		for (i = 0; i < vsession->max_queues; i++) {
+			if (vsession->virtqueue[i].poller != NULL) {
+				vhost_blk_vq_stop_polling(&vsession->virtqueue[i]);
+			}
+		}
 		if (vsession->virtqueue[0].intr) {
 			vhost_blk_session_unregister_interrupts(bvsession);
 			rc = vhost_blk_session_register_interrupts(bvsession, no_bdev_vdev_vq_worker,
@@ -1170,19 +1390,90 @@ vhost_user_session_bdev_remove_cb(struct spdk_vhost_dev *vdev,
 		bvsession->requestq_poller = SPDK_POLLER_REGISTER(no_bdev_vdev_worker, bvsession, 0);
 		spdk_poller_register_interrupt(bvsession->requestq_poller, vhost_blk_poller_set_interrupt_mode,
 					       bvsession);
+
+		for (i = 0; i < (int)bvsession->num_qgroups; i++) {
+			spdk_thread_send_msg(bvsession->qgroups[i].thread, vhost_blk_qgroup_bdev_remove,
+					     &bvsession->qgroups[i]);
+		}
 	}
 
 	return 0;
 }
 
+struct vhost_blk_remove_ctx {
+	struct spdk_vhost_blk_dev *bvdev;
+	struct spdk_thread *thread;
+	uint32_t queue_thread_idx;
+	bdev_event_cb_complete cb;
+	void *cb_arg;
+};
+
+static void vhost_blk_queue_threads_sync(void *arg);
+
+static void
+vhost_blk_queue_thread_sync(void *arg)
+{
+	struct vhost_blk_remove_ctx *ctx = arg;
+
+	spdk_thread_send_msg(ctx->thread, vhost_blk_queue_threads_sync, ctx);
+}
+
+/*
+ * Pass through all the queue threads of the controller, so the queue groups there
+ * are done switching to the no-bdev pollers before the bdev gets closed.
+ */
+static void
+vhost_blk_queue_threads_sync(void *arg)
+{
+	struct vhost_blk_remove_ctx *ctx = arg;
+	struct spdk_vhost_blk_dev *bvdev = ctx->bvdev;
+
+	if (ctx->queue_thread_idx < bvdev->num_queue_threads - 1) {
+		spdk_thread_send_msg(bvdev->queue_threads[ctx->queue_thread_idx++],
+				     vhost_blk_queue_thread_sync, ctx);
+		return;
+	}
+
+	ctx->cb(&bvdev->vdev, ctx->cb_arg);
+	free(ctx);
+}
+
+static void
+vhost_user_bdev_remove_cpl(struct spdk_vhost_dev *vdev, void *arg)
+{
+	struct vhost_blk_remove_ctx *ctx = arg;
+
+	ctx->thread = spdk_get_thread();
+	vhost_blk_queue_threads_sync(ctx);
+}
+
 static void
 vhost_user_bdev_remove_cb(struct spdk_vhost_dev *vdev, bdev_event_cb_complete cb, void *cb_arg)
 {
+	struct spdk_vhost_blk_dev *bvdev = to_blk_dev(vdev);
+	struct vhost_blk_remove_ctx *ctx;
+
 	SPDK_WARNLOG("%s: hot-removing bdev - all further requests will fail.\n",
 		     vdev->name);
 
+	if (bvdev->num_queue_threads <= 1) {
+		vhost_user_dev_foreach_session(vdev, vhost_user_session_bdev_remove_cb,
+					       cb, cb_arg);
+		return;
+	}
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (ctx == NULL) {
+		SPDK_ERRLOG("%s: failed to allocate hot-remove context\n", vdev->name);
+		assert(false);
+		return;
+	}
+
+	ctx->bvdev = bvdev;
+	ctx->cb = cb;
+	ctx->cb_arg = cb_arg;
 	vhost_user_dev_foreach_session(vdev, vhost_user_session_bdev_remove_cb,
-				       cb, cb_arg);
+				       vhost_user_bdev_remove_cpl, ctx);
 }
 
 static void
@@ -1286,6 +1577,79 @@ alloc_vq_task_pool(struct spdk_vhost_session *vsession, uint16_t qid)
 	return 0;
 }
 
+static void
+vhost_blk_qgroup_start(void *arg)
+{
+	struct vhost_blk_queue_group *qgroup = arg;
+	struct spdk_vhost_blk_session *bvsession = qgroup->bvsession;
+
+	qgroup->io_channel = vhost_blk_get_io_channel(&bvsession->bvdev->vdev);
+	if (qgroup->io_channel == NULL) {
+		SPDK_ERRLOG("%s: I/O channel allocation failed on thread %s, failing requests of its queues\n",
+			    bvsession->vsession.name, spdk_thread_get_name(qgroup->thread));
+		qgroup->requestq_poller = SPDK_POLLER_REGISTER(no_bdev_vdev_qgroup_worker, qgroup, 0);
+		return;
+	}
+
+	qgroup->requestq_poller = SPDK_POLLER_REGISTER(vdev_qgroup_worker, qgroup, 0);
+	SPDK_INFOLOG(vhost, "%s: started poller for queues from %"PRIu16" on lcore %d\n",
+		     bvsession->vsession.name, qgroup->first_vq, spdk_env_get_current_core());
+}
+
+/*
+ * Spread the virtqueues of the session over the queue threads of the controller.
+ * Interrupt mode keeps all of them on the session thread.
+ */
+static int
+vhost_blk_session_start_qgroups(struct spdk_vhost_blk_session *bvsession)
+{
+	struct spdk_vhost_session *vsession = &bvsession->vsession;
+	struct spdk_vhost_blk_dev *bvdev = bvsession->bvdev;
+	struct vhost_blk_queue_group *qgroup;
+	struct spdk_vhost_virtqueue *vq;
+	struct spdk_vhost_user_blk_task *tasks;
+	uint32_t i, j;
+
+	bvsession->num_qgroups = spdk_min(bvdev->num_queue_threads, vsession->max_queues);
+	if (bvsession->num_qgroups <= 1 || spdk_interrupt_mode_is_enabled()) {
+		bvsession->num_qgroups = 0;
+		return 0;
+	}
+	bvsession->num_qgroups--;
+
+	bvsession->qgroups = calloc(bvsession->num_qgroups, sizeof(*bvsession->qgroups));
+	if (bvsession->qgroups == NULL) {
+		bvsession->num_qgroups = 0;
+		return -ENOMEM;
+	}
+
+	for (i = 0; i < bvsession->num_qgroups; i++) {
+		qgroup = &bvsession->qgroups[i];
+		qgroup->bvsession = bvsession;
+		qgroup->thread = bvdev->queue_threads[i];
+		qgroup->first_vq = i + 1;
+	}
+
+	for (i = 0; i < vsession->max_queues; i++) {
+		vq = &vsession->virtqueue[i];
+		j = i % vhost_blk_vq_stride(bvsession);
+		qgroup = j == 0 ? NULL : &bvsession->qgroups[j - 1];
+
+		tasks = vq->tasks;
+		for (j = 0; j < vq->vring.size; j++) {
+			tasks[j].qgroup = qgroup;
+		}
+	}
+
+	for (i = 0; i < bvsession->num_qgroups; i++) {
+		spdk_thread_send_msg(bvsession->qgroups[i].thread, vhost_blk_qgroup_start,
+				     &bvsession->qgroups[i]);
+	}
+	bvsession->num_qgroups_running = bvsession->num_qgroups;
+
+	return 0;
+}
+
 static int
 vhost_blk_start(struct spdk_vhost_dev *vdev,
 		struct spdk_vhost_session *vsession, void *unused)
@@ -1314,6 +1678,7 @@ vhost_blk_start(struct spdk_vhost_dev *vdev,
 	bvdev = to_blk_dev(vdev);
 	assert(bvdev != NULL);
 	bvsession->bvdev = bvdev;
+	bvsession->poll_idle_ticks = bvdev->poll_idle_us * spdk_get_ticks_hz() / SPDK_SEC_TO_USEC;
 
 	if (bvdev->bdev) {
 		bvsession->io_channel = vhost_blk_get_io_channel(vdev);
@@ -1342,6 +1707,15 @@ vhost_blk_start(struct spdk_vhost_dev *vdev,
 	}
 
 	if (bvdev->bdev) {
+		rc = vhost_blk_session_start_qgroups(bvsession);
+		if (rc) {
+			SPDK_ERRLOG("%s: failed to spread queues over threads\n", vsession->name);
+			spdk_put_io_channel(bvsession->io_channel);
+			bvsession->io_channel = NULL;
+			free_task_pool(bvsession);
+			return rc;
+		}
+
 		bvsession->requestq_poller = SPDK_POLLER_REGISTER(vdev_worker, bvsession, 0);
 	} else {
 		bvsession->requestq_poller = SPDK_POLLER_REGISTER(no_bdev_vdev_worker, bvsession, 0);
@@ -1355,6 +1729,44 @@ vhost_blk_start(struct spdk_vhost_dev *vdev,
 	return 0;
 }
 
+static void
+vhost_blk_qgroup_stopped(void *arg)
+{
+	struct vhost_blk_queue_group *qgroup = arg;
+
+	assert(qgroup->bvsession->num_qgroups_running > 0);
+	qgroup->bvsession->num_qgroups_running--;
+}
+
+static int
+destroy_qgroup_poller_cb(void *arg)
+{
+	struct vhost_blk_queue_group *qgroup = arg;
+
+	if (qgroup->task_cnt > 0) {
+		return SPDK_POLLER_BUSY;
+	}
+
+	if (qgroup->io_channel) {
+		vhost_blk_put_io_channel(qgroup->io_channel);
+		qgroup->io_channel = NULL;
+	}
+
+	spdk_poller_unregister(&qgroup->stop_poller);
+	spdk_thread_send_msg(qgroup->bvsession->vsession.vdev->thread, vhost_blk_qgroup_stopped, qgroup);
+
+	return SPDK_POLLER_BUSY;
+}
+
+static void
+vhost_blk_qgroup_stop(void *arg)
+{
+	struct vhost_blk_queue_group *qgroup = arg;
+
+	spdk_poller_unregister(&qgroup->requestq_poller);
+	qgroup->stop_poller = SPDK_POLLER_REGISTER(destroy_qgroup_poller_cb, qgroup, 1000);
+}
+
 static int
 destroy_session_poller_cb(void *arg)
 {
@@ -1363,7 +1775,8 @@ destroy_session_poller_cb(void *arg)
 	struct spdk_vhost_user_dev *user_dev = to_user_dev(vsession->vdev);
 	int i;
 
-	if (vsession->task_cnt > 0 || (pthread_mutex_trylock(&user_dev->lock) != 0)) {
+	if (vsession->task_cnt > 0 || bvsession->num_qgroups_running > 0 ||
+	    (pthread_mutex_trylock(&user_dev->lock) != 0)) {
 		assert(vsession->stop_retry_count > 0);
 		vsession->stop_retry_count--;
 		if (vsession->stop_retry_count == 0) {
@@ -1390,6 +1803,9 @@ destroy_session_poller_cb(void *arg)
 	}
 
 	free_task_pool(bvsession);
+	free(bvsession->qgroups);
+	bvsession->qgroups = NULL;
+	bvsession->num_qgroups = 0;
 	spdk_poller_unregister(&bvsession->stop_poller);
 	vhost_user_session_stop_done(vsession, 0);
 
@@ -1402,6 +1818,7 @@ vhost_blk_stop(struct spdk_vhost_dev *vdev,
 	       struct spdk_vhost_session *vsession, void *unused)
 {
 	struct spdk_vhost_blk_session *bvsession = to_blk_session(vsession);
+	uint32_t i;
 
 	/* return if stop is already in progress */
 	if (bvsession->stop_poller) {
@@ -1409,11 +1826,17 @@ vhost_blk_stop(struct spdk_vhost_dev *vdev,
 	}
 
 	spdk_poller_unregister(&bvsession->requestq_poller);
+	vhost_blk_session_unregister_vq_pollers(bvsession);
 
 	if (vsession->virtqueue[0].intr) {
 		vhost_blk_session_unregister_interrupts(bvsession);
 	}
 
+	for (i = 0; i < bvsession->num_qgroups; i++) {
+		spdk_thread_send_msg(bvsession->qgroups[i].thread, vhost_blk_qgroup_stop,
+				     &bvsession->qgroups[i]);
+	}
+
 	/* vhost_user_session_send_event timeout is 3 seconds, here set retry within 4 seconds */
 	bvsession->vsession.stop_retry_count = 4000;
 	bvsession->stop_poller = SPDK_POLLER_REGISTER(destroy_session_poller_cb,
@@ -1440,6 +1863,11 @@ vhost_blk_dump_info_json(struct spdk_vhost_dev *vdev, struct spdk_json_write_ctx
 		spdk_json_write_null(w);
 	}
 	spdk_json_write_named_string(w, "transport", bvdev->ops->name);
+	spdk_json_write_named_bool(w, "event_idx", bvdev->event_idx);
+	spdk_json_write_named_uint32(w, "poll_idle_us", bvdev->poll_idle_us);
+	spdk_json_write_named_uint32(w, "num_queue_threads", bvdev->num_queue_threads);
+
+	vhost_user_dev_dump_vq_stats_json(vdev, w);
 
 	spdk_json_write_object_end(w);
 }
@@ -1466,6 +1894,15 @@ vhost_blk_write_config_json(struct spdk_vhost_dev *vdev, struct spdk_json_write_
 				     spdk_cpuset_fmt(spdk_thread_get_cpumask(vdev->thread)));
 	spdk_json_write_named_bool(w, "readonly", bvdev->readonly);
 	spdk_json_write_named_string(w, "transport", bvdev->ops->name);
+	if (bvdev->event_idx) {
+		spdk_json_write_named_bool(w, "event_idx", bvdev->event_idx);
+	}
+	if (bvdev->poll_idle_us) {
+		spdk_json_write_named_uint32(w, "poll_idle_us", bvdev->poll_idle_us);
+	}
+	if (bvdev->num_queue_threads > 1) {
+		spdk_json_write_named_uint32(w, "num_queue_threads", bvdev->num_queue_threads);
+	}
 	spdk_json_write_object_end(w);
 
 	spdk_json_write_object_end(w);
@@ -1744,20 +2181,105 @@ struct rpc_vhost_blk {
 	bool readonly;
 	bool packed_ring;
 	bool packed_ring_recovery;
+	bool event_idx;
+	uint32_t poll_idle_us;
+	uint32_t num_queue_threads;
 };
 
 static const struct spdk_json_object_decoder rpc_construct_vhost_blk[] = {
 	{"readonly", offsetof(struct rpc_vhost_blk, readonly), spdk_json_decode_bool, true},
 	{"packed_ring", offsetof(struct rpc_vhost_blk, packed_ring), spdk_json_decode_bool, true},
 	{"packed_ring_recovery", offsetof(struct rpc_vhost_blk, packed_ring_recovery), spdk_json_decode_bool, true},
+	{"event_idx", offsetof(struct rpc_vhost_blk, event_idx), spdk_json_decode_bool, true},
+	{"poll_idle_us", offsetof(struct rpc_vhost_blk, poll_idle_us), spdk_json_decode_uint32, true},
+	{"num_queue_threads", offsetof(struct rpc_vhost_blk, num_queue_threads), spdk_json_decode_uint32, true},
 };
 
+static void
+vhost_blk_queue_thread_exit(void *arg)
+{
+	spdk_thread_exit(spdk_get_thread());
+}
+
+static void
+vhost_blk_destroy_queue_threads(struct spdk_vhost_blk_dev *bvdev)
+{
+	uint32_t i;
+
+	for (i = 0; i + 1 < bvdev->num_queue_threads; i++) {
+		if (bvdev->queue_threads[i] != NULL) {
+			spdk_thread_send_msg(bvdev->queue_threads[i], vhost_blk_queue_thread_exit, NULL);
+		}
+	}
+
+	free(bvdev->queue_threads);
+	bvdev->queue_threads = NULL;
+	bvdev->num_queue_threads = 1;
+}
+
+static uint32_t
+cpuset_next_cpu(const struct spdk_cpuset *cpumask, uint32_t cpu)
+{
+	uint32_t i;
+
+	for (i = 1; i <= SPDK_CPUSET_SIZE; i++) {
+		if (spdk_cpuset_get_cpu(cpumask, (cpu + i) % SPDK_CPUSET_SIZE)) {
+			return (cpu + i) % SPDK_CPUSET_SIZE;
+		}
+	}
+
+	return cpu;
+}
+
+/*
+ * Create the threads virtqueues are spread over. Each one is pinned to a single core
+ * of the controller's cpumask, starting with the second one, as the controller thread
+ * is usually scheduled on the first.
+ */
+static int
+vhost_blk_create_queue_threads(struct spdk_vhost_blk_dev *bvdev, struct spdk_cpuset *cpumask,
+			       uint32_t num_queue_threads)
+{
+	struct spdk_cpuset thread_cpumask;
+	char thread_name[64];
+	uint32_t i, cpu;
+
+	bvdev->num_queue_threads = num_queue_threads;
+	if (num_queue_threads <= 1) {
+		return 0;
+	}
+
+	bvdev->queue_threads = calloc(num_queue_threads - 1, sizeof(*bvdev->queue_threads));
+	if (bvdev->queue_threads == NULL) {
+		bvdev->num_queue_threads = 1;
+		return -ENOMEM;
+	}
+
+	cpu = cpuset_next_cpu(cpumask, SPDK_CPUSET_SIZE - 1);
+	for (i = 0; i < num_queue_threads - 1; i++) {
+		cpu = cpuset_next_cpu(cpumask, cpu);
+		spdk_cpuset_zero(&thread_cpumask);
+		spdk_cpuset_set_cpu(&thread_cpumask, cpu, true);
+
+		snprintf(thread_name, sizeof(thread_name), "%s.q%"PRIu32, bvdev->vdev.name, i + 1);
+		bvdev->queue_threads[i] = spdk_thread_create(thread_name, &thread_cpumask);
+		if (bvdev->queue_threads[i] == NULL) {
+			SPDK_ERRLOG("%s: failed to create queue thread %s\n", bvdev->vdev.name, thread_name);
+			vhost_blk_destroy_queue_threads(bvdev);
+			return -EIO;
+		}
+	}
+
+	return 0;
+}
+
 static int
 vhost_user_blk_create_ctrlr(struct spdk_vhost_dev *vdev, struct spdk_cpuset *cpumask,
 			    const char *address, const struct spdk_json_val *params, void *custom_opts)
 {
 	struct rpc_vhost_blk req = {0};
 	struct spdk_vhost_blk_dev *bvdev = to_blk_dev(vdev);
+	int rc;
 
 	if (spdk_json_decode_object_relaxed(params, rpc_construct_vhost_blk,
 					    SPDK_COUNTOF(rpc_construct_vhost_blk),
@@ -1776,14 +2298,44 @@ vhost_user_blk_create_ctrlr(struct spdk_vhost_dev *vdev, struct spdk_cpuset *cpu
 		vdev->virtio_features |= (1ULL << VIRTIO_BLK_F_RO);
 		bvdev->readonly = req.readonly;
 	}
+	if (req.event_idx) {
+		vdev->disabled_features &= ~(1ULL << VIRTIO_RING_F_EVENT_IDX);
+		bvdev->event_idx = req.event_idx;
+	}
+	bvdev->poll_idle_us = req.poll_idle_us;
+
+	if (req.num_queue_threads > SPDK_VHOST_BLK_MAX_QUEUE_THREADS) {
+		SPDK_ERRLOG("%s: num_queue_threads can't exceed %d\n", vdev->name,
+			    SPDK_VHOST_BLK_MAX_QUEUE_THREADS);
+		return -EINVAL;
+	}
+
+	rc = vhost_blk_create_queue_threads(bvdev, cpumask, spdk_max(req.num_queue_threads, 1));
+	if (rc != 0) {
+		return rc;
+	}
+
+	rc = vhost_user_dev_register(vdev, address, cpumask, custom_opts);
+	if (rc != 0) {
+		vhost_blk_destroy_queue_threads(bvdev);
+	}
 
-	return vhost_user_dev_register(vdev, address, cpumask, custom_opts);
+	return rc;
 }
 
 static int
 vhost_user_blk_destroy_ctrlr(struct spdk_vhost_dev *vdev)
 {
-	return vhost_user_dev_unregister(vdev);
+	int rc;
+
+	rc = vhost_user_dev_unregister(vdev);
+	if (rc != 0) {
+		return rc;
+	}
+
+	vhost_blk_destroy_queue_threads(to_blk_dev(vdev));
+
+	return 0;
 }
 
 static void
@@ -42,6 +42,11 @@
  */
 #define SPDK_VHOST_COALESCING_DELAY_BASE_US 0
 
+/*
+ * Interrupts are never delayed by more than this many times the coalescing delay base.
+ */
+#define SPDK_VHOST_COALESCING_MAX_DELAY_FACTOR 4
+
 #define SPDK_VHOST_FEATURES ((1ULL << VHOST_F_LOG_ALL) | \
 	(1ULL << VHOST_USER_F_PROTOCOL_FEATURES) | \
 	(1ULL << VIRTIO_F_VERSION_1) | \
@@ -62,6 +67,21 @@ typedef struct rte_vhost_resubmit_desc spdk_vhost_resubmit_desc;
 typedef struct rte_vhost_resubmit_info spdk_vhost_resubmit_info;
 typedef struct rte_vhost_inflight_desc_packed	spdk_vhost_inflight_desc;
 
+struct spdk_vhost_vq_stats {
+	/* Number of times the virtqueue was checked for new requests */
+	uint64_t polls;
+	/* Number of checks which found new requests */
+	uint64_t busy_polls;
+	/* Number of guest kicks handled */
+	uint64_t kicks;
+	/* Number of interrupts sent to the guest */
+	uint64_t irqs;
+	/* Number of interrupts not sent, because the guest asked so */
+	uint64_t irqs_suppressed;
+	/* Number of switches between polling and waiting for guest kicks */
+	uint64_t mode_switches;
+};
+
 struct spdk_vhost_virtqueue {
 	struct rte_vhost_vring vring;
 	struct rte_vhost_ring_inflight vring_inflight;
@@ -95,6 +115,35 @@ struct spdk_vhost_virtqueue {
 	/* Next time when we need to send event */
 	uint64_t next_event_time;
 
+	/*
+	 * Next time when stats for event coalescing will be checked. Kept per virtqueue,
+	 * as the virtqueues of a session may be processed by different threads.
+	 */
+	uint64_t next_stats_check_time;
+
+	/* Used index the last interrupt check was done for, with VIRTIO_RING_F_EVENT_IDX */
+	uint16_t signalled_used;
+	bool signalled_used_valid;
+
+	/*
+	 * Poller of a virtqueue that stopped waiting for guest kicks, while its
+	 * session is in interrupt mode. NULL if the virtqueue is kick-driven.
+	 */
+	struct spdk_poller *poller;
+
+	/* Last time the virtqueue poller found new requests */
+	uint64_t last_busy_time;
+
+	/*
+	 * If set, used ring entries are only made visible to the guest by
+	 * vhost_vq_used_ring_flush(), so a whole batch of completions costs a
+	 * single used index update. Only honored in poll mode and without
+	 * inflight tracking, which needs the used index updated per entry.
+	 */
+	bool used_batch;
+
+	struct spdk_vhost_vq_stats stats;
+
 	/* Associated vhost_virtqueue in the virtio device's virtqueue list */
 	uint32_t vring_idx;
 
@@ -129,9 +178,6 @@ struct spdk_vhost_session {
 	uint32_t coalescing_delay_time_base;
 	uint32_t coalescing_io_rate_threshold;
 
-	/* Next time when stats for event coalescing will be checked. */
-	uint64_t next_stats_check_time;
-
 	/* Interval used for event coalescing checking. */
 	uint64_t stats_check_interval;
 
@@ -319,6 +365,15 @@ void vhost_vq_used_ring_enqueue(struct spdk_vhost_session *vsession,
 				struct spdk_vhost_virtqueue *vq,
 				uint16_t id, uint32_t len);
 
+/**
+ * Publish the used ring entries enqueued in batch mode to the guest.
+ * It's done by vhost_vq_used_signal() and vhost_session_vq_used_signal() too.
+ * \param vsession vhost session
+ * \param vq virtqueue
+ */
+void vhost_vq_used_ring_flush(struct spdk_vhost_session *vsession,
+			      struct spdk_vhost_virtqueue *vq);
+
 /**
  * Enqueue the entry to the used ring when device complete the request.
  * \param vsession vhost session
@@ -398,6 +453,29 @@ vhost_dev_has_feature(struct spdk_vhost_session *vsession, unsigned feature_id)
 	return vsession->negotiated_features & (1ULL << feature_id);
 }
 
+/* Entry of the avail ring the guest wants to be interrupted for, with VIRTIO_RING_F_EVENT_IDX */
+static inline uint16_t *
+vhost_vq_used_event(struct spdk_vhost_virtqueue *vq)
+{
+	return &vq->vring.avail->ring[vq->vring.size];
+}
+
+/* Entry of the used ring the guest should kick the device for, with VIRTIO_RING_F_EVENT_IDX */
+static inline uint16_t *
+vhost_vq_avail_event(struct spdk_vhost_virtqueue *vq)
+{
+	return (uint16_t *)&vq->vring.used->ring[vq->vring.size];
+}
+
+/**
+ * Enable or disable guest kicks for new requests on the virtqueue.
+ * \param vsession vhost session
+ * \param vq virtqueue
+ * \param enable true to have the guest kick the virtqueue, false if it's polled
+ */
+void vhost_vq_set_guest_notify(struct spdk_vhost_session *vsession, struct spdk_vhost_virtqueue *vq,
+			       bool enable);
+
 int vhost_dev_register(struct spdk_vhost_dev *vdev, const char *name, const char *mask_str,
 		       const struct spdk_json_val *params,
 		       const struct spdk_vhost_dev_backend *backend,
@@ -434,6 +512,13 @@ void vhost_user_dev_foreach_session(struct spdk_vhost_dev *dev,
 				    spdk_vhost_dev_fn cpl_fn,
 				    void *arg);
 
+/**
+ * Write the statistics of the virtqueues of all sessions of the device.
+ * \param vdev vhost device
+ * \param w JSON write context
+ */
+void vhost_user_dev_dump_vq_stats_json(struct spdk_vhost_dev *vdev, struct spdk_json_write_ctx *w);
+
 /**
  * Finish a blocking vhost_user_wait_for_session_stop() call and finally
  * stop the session. This must be called on the session's lcore which
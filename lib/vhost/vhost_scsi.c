@@ -688,7 +688,13 @@ process_request(struct spdk_vhost_scsi_task *task)
 	return 0;
 }
 
-static void
+/*
+ * Set up the task of the request.
+ * Return
+ *   the task if it's ready to be submitted with task_submit(),
+ *   NULL if the request was already completed.
+ */
+static struct spdk_vhost_scsi_task *
 process_scsi_task(struct spdk_vhost_session *vsession,
 		  struct spdk_vhost_virtqueue *vq,
 		  uint16_t req_idx)
@@ -701,7 +707,7 @@ process_scsi_task(struct spdk_vhost_session *vsession,
 		SPDK_ERRLOG("%s: request with idx '%"PRIu16"' is already pending.\n",
 			    vsession->name, req_idx);
 		vhost_vq_used_ring_enqueue(vsession, vq, req_idx, 0);
-		return;
+		return NULL;
 	}
 
 	vsession->task_cnt++;
@@ -711,10 +717,8 @@ process_scsi_task(struct spdk_vhost_session *vsession,
 		process_ctrl_request(task);
 	} else {
 		result = process_request(task);
-		if (likely(result == 0)) {
-			task_submit(task);
-			SPDK_DEBUGLOG(vhost_scsi, "====== Task %p req_idx %d submitted ======\n", task,
-				      task->req_idx);
+		if (spdk_likely(result == 0)) {
+			return task;
 		} else if (result > 0) {
 			vhost_scsi_task_cpl(&task->scsi);
 			SPDK_DEBUGLOG(vhost_scsi, "====== Task %p req_idx %d finished early ======\n", task,
@@ -725,6 +729,8 @@ process_scsi_task(struct spdk_vhost_session *vsession,
 				      task->req_idx);
 		}
 	}
+
+	return NULL;
 }
 
 static int
@@ -734,6 +740,7 @@ submit_inflight_desc(struct spdk_vhost_scsi_session *svsession,
 	struct spdk_vhost_session *vsession;
 	spdk_vhost_resubmit_info *resubmit;
 	spdk_vhost_resubmit_desc *resubmit_list;
+	struct spdk_vhost_scsi_task *task;
 	uint16_t req_idx;
 	int i, resubmit_cnt;
 
@@ -758,25 +765,34 @@ submit_inflight_desc(struct spdk_vhost_scsi_session *svsession,
 			continue;
 		}
 
-		process_scsi_task(vsession, vq, req_idx);
+		task = process_scsi_task(vsession, vq, req_idx);
+		if (task != NULL) {
+			task_submit(task);
+		}
 	}
 	resubmit_cnt = resubmit->resubmit_num;
 	resubmit->resubmit_num = 0;
 	return resubmit_cnt;
 }
 
+/*
+ * Dequeue a batch of requests and set up all of their tasks before submitting
+ * any of them. Completions are published to the used ring per batch too, if the
+ * virtqueue allows it - see vhost_vq_used_ring_flush().
+ */
 static int
 process_vq(struct spdk_vhost_scsi_session *svsession, struct spdk_vhost_virtqueue *vq)
 {
 	struct spdk_vhost_session *vsession = &svsession->vsession;
-	uint16_t reqs[32];
-	uint16_t reqs_cnt, i;
+	struct spdk_vhost_scsi_task *tasks[SPDK_VHOST_VQ_MAX_SUBMISSIONS];
+	uint16_t reqs[SPDK_VHOST_VQ_MAX_SUBMISSIONS];
+	uint16_t reqs_cnt, tasks_cnt = 0, i;
 	int resubmit_cnt;
 
 	resubmit_cnt = submit_inflight_desc(svsession, vq);
 
 	reqs_cnt = vhost_vq_avail_ring_get(vq, reqs, SPDK_COUNTOF(reqs));
-	assert(reqs_cnt <= 32);
+	assert(reqs_cnt <= SPDK_COUNTOF(reqs));
 
 	for (i = 0; i < reqs_cnt; i++) {
 		SPDK_DEBUGLOG(vhost_scsi, "====== Starting processing request idx %"PRIu16"======\n",
@@ -791,7 +807,16 @@ process_vq(struct spdk_vhost_scsi_session *svsession, struct spdk_vhost_virtqueu
 
 		rte_vhost_set_inflight_desc_split(vsession->vid, vq->vring_idx, reqs[i]);
 
-		process_scsi_task(vsession, vq, reqs[i]);
+		tasks[tasks_cnt] = process_scsi_task(vsession, vq, reqs[i]);
+		if (tasks[tasks_cnt] != NULL) {
+			tasks_cnt++;
+		}
+	}
+
+	for (i = 0; i < tasks_cnt; i++) {
+		task_submit(tasks[i]);
+		SPDK_DEBUGLOG(vhost_scsi, "====== Task %p req_idx %d submitted ======\n", tasks[i],
+			      tasks[i]->req_idx);
 	}
 
 	return reqs_cnt > 0 ? reqs_cnt : resubmit_cnt;
@@ -827,7 +852,7 @@ vdev_worker(void *arg)
 	int rc = 0;
 
 	for (q_idx = VIRTIO_SCSI_REQUESTQ; q_idx < vsession->max_queues; q_idx++) {
-		rc = process_vq(svsession, &vsession->virtqueue[q_idx]);
+		rc += process_vq(svsession, &vsession->virtqueue[q_idx]);
 		vhost_session_vq_used_signal(&vsession->virtqueue[q_idx]);
 	}
 
@@ -1402,6 +1427,11 @@ vhost_scsi_start(struct spdk_vhost_dev *vdev,
 			continue;
 		}
 	}
+	/* The inflight region tracks the used index per completion, so it can't be batched */
+	for (i = VIRTIO_SCSI_REQUESTQ; i < vsession->max_queues; i++) {
+		vsession->virtqueue[i].used_batch = vsession->virtqueue[i].vring_inflight.inflight_split == NULL;
+	}
+
 	SPDK_INFOLOG(vhost, "%s: started poller on lcore %d\n",
 		     vsession->name, spdk_env_get_current_core());
 
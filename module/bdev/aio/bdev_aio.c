@@ -24,10 +24,17 @@
 #include <sys/eventfd.h>
 #include <libaio.h>
 
+#define SPDK_AIO_QUEUE_DEPTH 128
+#define MAX_EVENTS_PER_POLL 32
+
 struct bdev_aio_io_channel {
 	uint64_t				io_inflight;
 	io_context_t				io_ctx;
 	struct bdev_aio_group_channel		*group_ch;
+	struct file_disk			*fdisk;
+	/* iocbs prepared since the last poll, submitted together with a single io_submit() */
+	uint32_t				num_pending;
+	struct iocb				*pending[SPDK_AIO_QUEUE_DEPTH];
 	TAILQ_ENTRY(bdev_aio_io_channel)	link;
 };
 
@@ -47,7 +54,15 @@ struct bdev_aio_task {
 	struct bdev_aio_io_channel	*ch;
 };
 
+struct bdev_aio_stat {
+	/* Number of io_submit() calls */
+	uint64_t		io_submit_calls;
+	/* Number of iocbs accepted by those calls */
+	uint64_t		iocbs_submitted;
+};
+
 struct file_disk {
+	struct bdev_aio_stat	stat;
 	struct bdev_aio_task	*reset_task;
 	struct spdk_poller	*reset_retry_timer;
 	struct spdk_bdev	disk;
@@ -78,9 +93,6 @@ static void bdev_aio_fini(void);
 static void aio_free_disk(struct file_disk *fdisk);
 static TAILQ_HEAD(, file_disk) g_aio_disk_head = TAILQ_HEAD_INITIALIZER(g_aio_disk_head);
 
-#define SPDK_AIO_QUEUE_DEPTH 128
-#define MAX_EVENTS_PER_POLL 32
-
 static int
 bdev_aio_get_ctx_size(void)
 {
@@ -140,6 +152,62 @@ bdev_aio_close(struct file_disk *disk)
 	return 0;
 }
 
+static void
+bdev_aio_submit_pending(struct bdev_aio_io_channel *aio_ch)
+{
+	struct iocb *iocbs[SPDK_AIO_QUEUE_DEPTH];
+	struct bdev_aio_task *aio_task;
+	uint32_t count, submitted = 0, accepted = 0, calls = 0;
+	int rc;
+
+	/* Completing a failed request may queue a new one on this channel,
+	 * so work on a copy of the pending iocbs. */
+	count = aio_ch->num_pending;
+	memcpy(iocbs, aio_ch->pending, count * sizeof(iocbs[0]));
+	aio_ch->num_pending = 0;
+
+	while (submitted < count) {
+		rc = io_submit(aio_ch->io_ctx, count - submitted, &iocbs[submitted]);
+		calls++;
+		if (spdk_likely(rc > 0)) {
+			aio_ch->io_inflight += rc;
+			submitted += rc;
+			accepted += rc;
+			continue;
+		}
+
+		if (rc == -EAGAIN || rc == 0) {
+			/* The context is full, let the bdev layer retry the rest later */
+			while (submitted < count) {
+				aio_task = iocbs[submitted++]->data;
+				spdk_bdev_io_complete(spdk_bdev_io_from_ctx(aio_task), SPDK_BDEV_IO_STATUS_NOMEM);
+			}
+			break;
+		}
+
+		/* The first remaining iocb was rejected, fail it and go on with the others */
+		aio_task = iocbs[submitted++]->data;
+		spdk_bdev_io_complete_aio_status(spdk_bdev_io_from_ctx(aio_task), rc);
+		SPDK_ERRLOG("%s: io_submit returned %d\n", __func__, rc);
+	}
+
+	__atomic_fetch_add(&aio_ch->fdisk->stat.io_submit_calls, calls, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&aio_ch->fdisk->stat.iocbs_submitted, accepted, __ATOMIC_RELAXED);
+}
+
+static void
+bdev_aio_queue_task(struct bdev_aio_io_channel *aio_ch, struct bdev_aio_task *aio_task)
+{
+	aio_ch->pending[aio_ch->num_pending++] = &aio_task->iocb;
+
+	/* In interrupt mode the group poller does not run on its own, so submit right away.
+	 * Otherwise, defer the submission to the poller to batch all the requests queued
+	 * during the current reactor iteration. */
+	if (aio_ch->group_ch->efd >= 0 || aio_ch->num_pending == SPDK_AIO_QUEUE_DEPTH) {
+		bdev_aio_submit_pending(aio_ch);
+	}
+}
+
 static void
 bdev_aio_readv(struct file_disk *fdisk, struct spdk_io_channel *ch,
 	       struct bdev_aio_task *aio_task,
@@ -147,7 +215,6 @@ bdev_aio_readv(struct file_disk *fdisk, struct spdk_io_channel *ch,
 {
 	struct iocb *iocb = &aio_task->iocb;
 	struct bdev_aio_io_channel *aio_ch = spdk_io_channel_get_ctx(ch);
-	int rc;
 
 	io_prep_preadv(iocb, fdisk->fd, iov, iovcnt, offset);
 	if (aio_ch->group_ch->efd >= 0) {
@@ -160,17 +227,7 @@ bdev_aio_readv(struct file_disk *fdisk, struct spdk_io_channel *ch,
 	SPDK_DEBUGLOG(aio, "read %d iovs size %lu to off: %#lx\n",
 		      iovcnt, nbytes, offset);
 
-	rc = io_submit(aio_ch->io_ctx, 1, &iocb);
-	if (spdk_unlikely(rc < 0)) {
-		if (rc == -EAGAIN) {
-			spdk_bdev_io_complete(spdk_bdev_io_from_ctx(aio_task), SPDK_BDEV_IO_STATUS_NOMEM);
-		} else {
-			spdk_bdev_io_complete_aio_status(spdk_bdev_io_from_ctx(aio_task), rc);
-			SPDK_ERRLOG("%s: io_submit returned %d\n", __func__, rc);
-		}
-	} else {
-		aio_ch->io_inflight++;
-	}
+	bdev_aio_queue_task(aio_ch, aio_task);
 }
 
 static void
@@ -180,7 +237,6 @@ bdev_aio_writev(struct file_disk *fdisk, struct spdk_io_channel *ch,
 {
 	struct iocb *iocb = &aio_task->iocb;
 	struct bdev_aio_io_channel *aio_ch = spdk_io_channel_get_ctx(ch);
-	int rc;
 
 	io_prep_pwritev(iocb, fdisk->fd, iov, iovcnt, offset);
 	if (aio_ch->group_ch->efd >= 0) {
@@ -193,17 +249,7 @@ bdev_aio_writev(struct file_disk *fdisk, struct spdk_io_channel *ch,
 	SPDK_DEBUGLOG(aio, "write %d iovs size %lu from off: %#lx\n",
 		      iovcnt, len, offset);
 
-	rc = io_submit(aio_ch->io_ctx, 1, &iocb);
-	if (spdk_unlikely(rc < 0)) {
-		if (rc == -EAGAIN) {
-			spdk_bdev_io_complete(spdk_bdev_io_from_ctx(aio_task), SPDK_BDEV_IO_STATUS_NOMEM);
-		} else {
-			spdk_bdev_io_complete_aio_status(spdk_bdev_io_from_ctx(aio_task), rc);
-			SPDK_ERRLOG("%s: io_submit returned %d\n", __func__, rc);
-		}
-	} else {
-		aio_ch->io_inflight++;
-	}
+	bdev_aio_queue_task(aio_ch, aio_task);
 }
 
 static void
@@ -308,13 +354,23 @@ bdev_user_io_getevents(io_context_t io_ctx, unsigned int max, struct io_event *u
 static int
 bdev_aio_io_channel_poll(struct bdev_aio_io_channel *io_ch)
 {
-	int nr, i, res = 0;
+	int nr, i, res = 0, submitted = 0;
 	struct bdev_aio_task *aio_task;
 	struct io_event events[SPDK_AIO_QUEUE_DEPTH];
 
+	if (io_ch->num_pending > 0) {
+		submitted = io_ch->num_pending;
+		bdev_aio_submit_pending(io_ch);
+	}
+
+	/* Nothing can complete, skip reading the ring (or the io_getevents() syscall) */
+	if (io_ch->io_inflight == 0) {
+		return submitted;
+	}
+
 	nr = bdev_user_io_getevents(io_ch->io_ctx, SPDK_AIO_QUEUE_DEPTH, events);
 	if (nr < 0) {
-		return 0;
+		return submitted;
 	}
 
 	for (i = 0; i < nr; i++) {
@@ -338,7 +394,7 @@ bdev_aio_io_channel_poll(struct bdev_aio_io_channel *io_ch)
 		}
 	}
 
-	return nr;
+	return nr + submitted;
 }
 
 static int
@@ -390,7 +446,7 @@ _bdev_aio_get_io_inflight(struct spdk_io_channel_iter *i)
 	struct spdk_io_channel *ch = spdk_io_channel_iter_get_channel(i);
 	struct bdev_aio_io_channel *aio_ch = spdk_io_channel_get_ctx(ch);
 
-	if (aio_ch->io_inflight) {
+	if (aio_ch->io_inflight || aio_ch->num_pending) {
 		spdk_for_each_channel_continue(i, -1);
 		return;
 	}
@@ -541,6 +597,7 @@ bdev_aio_create_cb(void *io_device, void *ctx_buf)
 		return -1;
 	}
 
+	ch->fdisk = io_device;
 	ch->group_ch = spdk_io_channel_get_ctx(spdk_get_io_channel(&aio_if));
 	TAILQ_INSERT_TAIL(&ch->group_ch->io_ch_head, ch, link);
 
@@ -552,6 +609,7 @@ bdev_aio_destroy_cb(void *io_device, void *ctx_buf)
 {
 	struct bdev_aio_io_channel *ch = ctx_buf;
 
+	assert(ch->num_pending == 0);
 	io_destroy(ch->io_ctx);
 
 	assert(ch->group_ch);
@@ -608,6 +666,28 @@ bdev_aio_write_json_config(struct spdk_bdev *bdev, struct spdk_json_write_ctx *w
 	spdk_json_write_object_end(w);
 }
 
+static void
+bdev_aio_reset_device_stat(void *ctx)
+{
+	struct file_disk *fdisk = ctx;
+
+	__atomic_store_n(&fdisk->stat.io_submit_calls, 0, __ATOMIC_RELAXED);
+	__atomic_store_n(&fdisk->stat.iocbs_submitted, 0, __ATOMIC_RELAXED);
+}
+
+static void
+bdev_aio_dump_device_stat_json(void *ctx, struct spdk_json_write_ctx *w)
+{
+	struct file_disk *fdisk = ctx;
+
+	spdk_json_write_named_object_begin(w, "aio");
+	spdk_json_write_named_uint64(w, "io_submit_calls",
+				     __atomic_load_n(&fdisk->stat.io_submit_calls, __ATOMIC_RELAXED));
+	spdk_json_write_named_uint64(w, "iocbs_submitted",
+				     __atomic_load_n(&fdisk->stat.iocbs_submitted, __ATOMIC_RELAXED));
+	spdk_json_write_object_end(w);
+}
+
 static const struct spdk_bdev_fn_table aio_fn_table = {
 	.destruct		= bdev_aio_destruct,
 	.submit_request		= bdev_aio_submit_request,
@@ -615,6 +695,8 @@ static const struct spdk_bdev_fn_table aio_fn_table = {
 	.get_io_channel		= bdev_aio_get_io_channel,
 	.dump_info_json		= bdev_aio_dump_info_json,
 	.write_config_json	= bdev_aio_write_json_config,
+	.reset_device_stat	= bdev_aio_reset_device_stat,
+	.dump_device_stat_json	= bdev_aio_dump_device_stat_json,
 };
 
 static void
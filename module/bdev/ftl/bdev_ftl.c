@@ -219,6 +219,11 @@ bdev_ftl_write_config_json(struct spdk_bdev *bdev, struct spdk_json_write_ctx *w
 	spdk_json_write_named_string(w, "uuid", uuid);
 
 	spdk_json_write_named_bool(w, "fast_shutdown", conf.fast_shutdown);
+	spdk_json_write_named_bool(w, "user_io_offload", conf.user_io_offload);
+
+	if (spdk_ftl_gc_policy_str(conf.gc_policy)) {
+		spdk_json_write_named_string(w, "gc_policy", spdk_ftl_gc_policy_str(conf.gc_policy));
+	}
 
 	spdk_json_write_named_string(w, "base_bdev", conf.base_bdev);
 
@@ -28,6 +28,27 @@ rpc_bdev_ftl_decode_uuid(const struct spdk_json_val *val, void *out)
 	return ret;
 }
 
+static int
+rpc_bdev_ftl_decode_gc_policy(const struct spdk_json_val *val, void *out)
+{
+	uint32_t *gc_policy = out;
+	char *str;
+	int rc;
+
+	str = spdk_json_strdup(val);
+	if (!str) {
+		return -ENOMEM;
+	}
+
+	rc = spdk_ftl_gc_policy_parse(gc_policy, str);
+	if (rc) {
+		SPDK_NOTICELOG("Invalid parameter value: gc_policy\n");
+	}
+
+	free(str);
+	return rc;
+}
+
 static const struct spdk_json_object_decoder rpc_bdev_ftl_create_decoders[] = {
 	{"name", offsetof(struct spdk_ftl_conf, name), spdk_json_decode_string},
 	{"base_bdev", offsetof(struct spdk_ftl_conf, base_bdev), spdk_json_decode_string},
@@ -49,6 +70,14 @@ static const struct spdk_json_object_decoder rpc_bdev_ftl_create_decoders[] = {
 		"fast_shutdown", offsetof(struct spdk_ftl_conf, fast_shutdown),
 		spdk_json_decode_bool, true
 	},
+	{
+		"user_io_offload", offsetof(struct spdk_ftl_conf, user_io_offload),
+		spdk_json_decode_bool, true
+	},
+	{
+		"gc_policy", offsetof(struct spdk_ftl_conf, gc_policy),
+		rpc_bdev_ftl_decode_gc_policy, true
+	},
 };
 
 static void
@@ -278,6 +307,39 @@ _rpc_bdev_ftl_get_stats(void *cntx)
 		spdk_json_write_object_end(w);
 	}
 
+	spdk_json_write_named_object_begin(w, "streams");
+	for (uint64_t i = 0; i < FTL_STATS_STREAM_MAX; i++) {
+		uint64_t user_blocks = stats->entries[FTL_STATS_TYPE_USER].write.blocks;
+
+		switch (i) {
+		case FTL_STATS_STREAM_CMP:
+			spdk_json_write_named_object_begin(w, "cmp");
+			break;
+		case FTL_STATS_STREAM_CMP_COLD:
+			spdk_json_write_named_object_begin(w, "cmp_cold");
+			break;
+		case FTL_STATS_STREAM_GC:
+			spdk_json_write_named_object_begin(w, "gc");
+			break;
+		default:
+			assert(false);
+			continue;
+		}
+
+		spdk_json_write_named_uint64(w, "blocks", stats->stream_blocks[i]);
+		spdk_json_write_named_double(w, "write_amplification",
+					     user_blocks ? (double)stats->stream_blocks[i] / user_blocks : 0.0);
+		spdk_json_write_object_end(w);
+	}
+	spdk_json_write_object_end(w);
+
+	spdk_json_write_named_object_begin(w, "l2p_cache");
+	spdk_json_write_named_uint64(w, "hits", stats->l2p_cache.hits);
+	spdk_json_write_named_uint64(w, "misses", stats->l2p_cache.misses);
+	spdk_json_write_named_uint64(w, "prefetches", stats->l2p_cache.prefetches);
+	spdk_json_write_named_uint64(w, "prefetch_hits", stats->l2p_cache.prefetch_hits);
+	spdk_json_write_object_end(w);
+
 	spdk_json_write_object_end(w);
 	spdk_jsonrpc_end_result(request, w);
 
@@ -5,6 +5,8 @@
  */
 
 #include "spdk/blob_bdev.h"
+#include "spdk/bit_array.h"
+#include "spdk/env.h"
 #include "spdk/rpc.h"
 #include "spdk/bdev_module.h"
 #include "spdk/log.h"
@@ -1284,6 +1286,282 @@ vbdev_lvol_set_read_only(struct spdk_lvol *lvol, spdk_lvol_op_complete cb_fn, vo
 	spdk_lvol_set_read_only(lvol, _vbdev_lvol_set_read_only_cb, req);
 }
 
+/* Number of clusters copied in parallel by a diff export */
+#define VBDEV_LVOL_EXPORT_QD 4
+
+struct vbdev_lvol_export_ctx;
+
+struct vbdev_lvol_export_io {
+	struct vbdev_lvol_export_ctx	*ctx;
+	void				*buf;
+	uint64_t			offset;
+	bool				writing;
+	struct spdk_bdev_io_wait_entry	bdev_io_wait;
+};
+
+struct vbdev_lvol_export_ctx {
+	struct spdk_bit_array		*clusters;
+	struct spdk_bdev_desc		*src_desc;
+	struct spdk_bdev_desc		*dst_desc;
+	struct spdk_io_channel		*src_ch;
+	struct spdk_io_channel		*dst_ch;
+	uint64_t			cluster_sz;
+	uint32_t			next_cluster;
+	uint32_t			outstanding;
+	uint64_t			exported_clusters;
+	int				rc;
+	vbdev_lvol_export_diff_cb	cb_fn;
+	void				*cb_arg;
+	struct vbdev_lvol_export_io	ios[VBDEV_LVOL_EXPORT_QD];
+};
+
+static void
+vbdev_lvol_export_free(struct vbdev_lvol_export_ctx *ctx)
+{
+	int i;
+
+	for (i = 0; i < VBDEV_LVOL_EXPORT_QD; i++) {
+		spdk_free(ctx->ios[i].buf);
+	}
+	if (ctx->src_ch != NULL) {
+		spdk_put_io_channel(ctx->src_ch);
+	}
+	if (ctx->dst_ch != NULL) {
+		spdk_put_io_channel(ctx->dst_ch);
+	}
+	if (ctx->src_desc != NULL) {
+		spdk_bdev_close(ctx->src_desc);
+	}
+	if (ctx->dst_desc != NULL) {
+		spdk_bdev_close(ctx->dst_desc);
+	}
+	spdk_bit_array_free(&ctx->clusters);
+	free(ctx);
+}
+
+static void
+vbdev_lvol_export_check_done(struct vbdev_lvol_export_ctx *ctx)
+{
+	if (ctx->outstanding != 0) {
+		return;
+	}
+
+	if (ctx->rc != 0) {
+		SPDK_ERRLOG("Could not export lvol diff due to error: %d.\n", ctx->rc);
+	}
+
+	ctx->cb_fn(ctx->cb_arg, ctx->exported_clusters, ctx->rc);
+	vbdev_lvol_export_free(ctx);
+}
+
+static void vbdev_lvol_export_submit(struct vbdev_lvol_export_io *io);
+
+static void
+vbdev_lvol_export_retry(void *arg)
+{
+	struct vbdev_lvol_export_io *io = arg;
+
+	io->ctx->outstanding--;
+	vbdev_lvol_export_submit(io);
+}
+
+static void
+vbdev_lvol_export_write_cpl(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct vbdev_lvol_export_io *io = cb_arg;
+	struct vbdev_lvol_export_ctx *ctx = io->ctx;
+
+	spdk_bdev_free_io(bdev_io);
+	ctx->outstanding--;
+
+	if (!success) {
+		ctx->rc = -EIO;
+		vbdev_lvol_export_check_done(ctx);
+		return;
+	}
+
+	ctx->exported_clusters++;
+	io->writing = false;
+	vbdev_lvol_export_submit(io);
+}
+
+static void
+vbdev_lvol_export_read_cpl(struct spdk_bdev_io *bdev_io, bool success, void *cb_arg)
+{
+	struct vbdev_lvol_export_io *io = cb_arg;
+	struct vbdev_lvol_export_ctx *ctx = io->ctx;
+
+	spdk_bdev_free_io(bdev_io);
+	ctx->outstanding--;
+
+	if (!success) {
+		ctx->rc = -EIO;
+		vbdev_lvol_export_check_done(ctx);
+		return;
+	}
+
+	io->writing = true;
+	vbdev_lvol_export_submit(io);
+}
+
+static void
+vbdev_lvol_export_submit(struct vbdev_lvol_export_io *io)
+{
+	struct vbdev_lvol_export_ctx *ctx = io->ctx;
+	struct spdk_bdev_desc *desc;
+	uint32_t cluster;
+	int rc;
+
+	if (ctx->rc != 0) {
+		vbdev_lvol_export_check_done(ctx);
+		return;
+	}
+
+	if (io->writing) {
+		desc = ctx->dst_desc;
+		rc = spdk_bdev_write(desc, ctx->dst_ch, io->buf, io->offset, ctx->cluster_sz,
+				     vbdev_lvol_export_write_cpl, io);
+	} else {
+		cluster = spdk_bit_array_find_first_set(ctx->clusters, ctx->next_cluster);
+		if (cluster == UINT32_MAX) {
+			vbdev_lvol_export_check_done(ctx);
+			return;
+		}
+		ctx->next_cluster = cluster + 1;
+		io->offset = cluster * ctx->cluster_sz;
+
+		desc = ctx->src_desc;
+		rc = spdk_bdev_read(desc, ctx->src_ch, io->buf, io->offset, ctx->cluster_sz,
+				    vbdev_lvol_export_read_cpl, io);
+	}
+
+	if (rc == -ENOMEM) {
+		if (!io->writing) {
+			/* Retry the same cluster */
+			ctx->next_cluster = io->offset / ctx->cluster_sz;
+		}
+		/* Waiting I/O counts as outstanding, so the export is not freed under it */
+		ctx->outstanding++;
+		io->bdev_io_wait.bdev = spdk_bdev_desc_get_bdev(desc);
+		io->bdev_io_wait.cb_fn = vbdev_lvol_export_retry;
+		io->bdev_io_wait.cb_arg = io;
+		spdk_bdev_queue_io_wait(io->bdev_io_wait.bdev, io->writing ? ctx->dst_ch : ctx->src_ch,
+					&io->bdev_io_wait);
+		return;
+	} else if (rc != 0) {
+		ctx->rc = rc;
+		vbdev_lvol_export_check_done(ctx);
+		return;
+	}
+
+	ctx->outstanding++;
+}
+
+static void
+vbdev_lvol_export_event_cb(enum spdk_bdev_event_type type, struct spdk_bdev *bdev, void *event_ctx)
+{
+	struct vbdev_lvol_export_ctx *ctx = event_ctx;
+
+	if (type == SPDK_BDEV_EVENT_REMOVE) {
+		/* Stop submitting, descriptors are closed once outstanding I/O completes */
+		ctx->rc = -ENODEV;
+	}
+}
+
+void
+vbdev_lvol_export_diff(struct spdk_lvol *snapshot, struct spdk_lvol *base_snapshot,
+		       const char *target_name, vbdev_lvol_export_diff_cb cb_fn, void *cb_arg)
+{
+	struct vbdev_lvol_export_ctx *ctx;
+	struct spdk_bdev *target;
+	uint64_t num_clusters;
+	int i, rc;
+
+	if (snapshot == NULL) {
+		SPDK_ERRLOG("lvol does not exist\n");
+		cb_fn(cb_arg, 0, -EINVAL);
+		return;
+	}
+
+	assert(snapshot->bdev != NULL);
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (ctx == NULL) {
+		cb_fn(cb_arg, 0, -ENOMEM);
+		return;
+	}
+
+	ctx->cb_fn = cb_fn;
+	ctx->cb_arg = cb_arg;
+	ctx->cluster_sz = spdk_bs_get_cluster_size(snapshot->lvol_store->blobstore);
+	num_clusters = spdk_blob_get_num_clusters(snapshot->blob);
+
+	ctx->clusters = spdk_bit_array_create(num_clusters);
+	if (ctx->clusters == NULL) {
+		rc = -ENOMEM;
+		goto err;
+	}
+
+	rc = spdk_lvol_get_changed_clusters(snapshot, base_snapshot, ctx->clusters);
+	if (rc != 0) {
+		goto err;
+	}
+
+	rc = spdk_bdev_open_ext(spdk_bdev_get_name(snapshot->bdev), false, vbdev_lvol_export_event_cb,
+				ctx, &ctx->src_desc);
+	if (rc != 0) {
+		goto err;
+	}
+
+	rc = spdk_bdev_open_ext(target_name, true, vbdev_lvol_export_event_cb, ctx, &ctx->dst_desc);
+	if (rc != 0) {
+		SPDK_ERRLOG("Could not open target bdev %s: %d.\n", target_name, rc);
+		goto err;
+	}
+
+	target = spdk_bdev_desc_get_bdev(ctx->dst_desc);
+	if (ctx->cluster_sz % spdk_bdev_get_block_size(target) != 0 ||
+	    spdk_bdev_get_num_blocks(target) * spdk_bdev_get_block_size(target) <
+	    num_clusters * ctx->cluster_sz) {
+		SPDK_ERRLOG("Target bdev %s cannot hold lvol %s\n", target_name, snapshot->name);
+		rc = -EINVAL;
+		goto err;
+	}
+
+	ctx->src_ch = spdk_bdev_get_io_channel(ctx->src_desc);
+	ctx->dst_ch = spdk_bdev_get_io_channel(ctx->dst_desc);
+	if (ctx->src_ch == NULL || ctx->dst_ch == NULL) {
+		rc = -ENOMEM;
+		goto err;
+	}
+
+	for (i = 0; i < VBDEV_LVOL_EXPORT_QD; i++) {
+		ctx->ios[i].ctx = ctx;
+		ctx->ios[i].buf = spdk_malloc(ctx->cluster_sz, spdk_bdev_get_buf_align(target), NULL,
+					      SPDK_ENV_SOCKET_ID_ANY, SPDK_MALLOC_DMA);
+		if (ctx->ios[i].buf == NULL) {
+			rc = -ENOMEM;
+			goto err;
+		}
+	}
+
+	SPDK_INFOLOG(vbdev_lvol, "Exporting %u changed clusters of lvol %s to %s\n",
+		     spdk_bit_array_count_set(ctx->clusters), snapshot->name, target_name);
+
+	/* Hold a reference while starting, so that the export cannot complete in the loop */
+	ctx->outstanding++;
+	for (i = 0; i < VBDEV_LVOL_EXPORT_QD; i++) {
+		vbdev_lvol_export_submit(&ctx->ios[i]);
+	}
+	ctx->outstanding--;
+	vbdev_lvol_export_check_done(ctx);
+	return;
+
+err:
+	vbdev_lvol_export_free(ctx);
+	cb_fn(cb_arg, 0, rc);
+}
+
 static int
 vbdev_lvs_init(void)
 {
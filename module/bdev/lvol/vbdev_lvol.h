@@ -61,6 +61,24 @@ void vbdev_lvol_resize(struct spdk_lvol *lvol, uint64_t sz, spdk_lvol_op_complet
  */
 void vbdev_lvol_set_read_only(struct spdk_lvol *lvol, spdk_lvol_op_complete cb_fn, void *cb_arg);
 
+typedef void (*vbdev_lvol_export_diff_cb)(void *cb_arg, uint64_t exported_clusters, int lvolerrno);
+
+/**
+ * Copy the clusters of a snapshot that changed since an older snapshot to a bdev.
+ *
+ * Clusters are written at the same offset as in the snapshot, so a target holding
+ * a copy of the base snapshot becomes a copy of the snapshot.
+ *
+ * \param snapshot Handle to the snapshot lvol
+ * \param base_snapshot Handle to an older snapshot in its lineage, NULL to copy
+ * every cluster allocated in the lineage
+ * \param target_name Name of the bdev to write the changed clusters to
+ * \param cb_fn Completion callback
+ * \param cb_arg Completion callback custom arguments
+ */
+void vbdev_lvol_export_diff(struct spdk_lvol *snapshot, struct spdk_lvol *base_snapshot,
+			    const char *target_name, vbdev_lvol_export_diff_cb cb_fn, void *cb_arg);
+
 void vbdev_lvol_rename(struct spdk_lvol *lvol, const char *new_lvol_name,
 		       spdk_lvol_op_complete cb_fn, void *cb_arg);
 
@@ -709,6 +709,220 @@ cleanup:
 
 SPDK_RPC_REGISTER("bdev_lvol_decouple_parent", rpc_bdev_lvol_decouple_parent, SPDK_RPC_RUNTIME)
 
+struct rpc_bdev_lvol_reclaim_space {
+	char *name;
+	uint64_t rate_limit_mb_per_sec;
+};
+
+static void
+free_rpc_bdev_lvol_reclaim_space(struct rpc_bdev_lvol_reclaim_space *req)
+{
+	free(req->name);
+}
+
+static const struct spdk_json_object_decoder rpc_bdev_lvol_reclaim_space_decoders[] = {
+	{"name", offsetof(struct rpc_bdev_lvol_reclaim_space, name), spdk_json_decode_string},
+	{
+		"rate_limit_mb_per_sec", offsetof(struct rpc_bdev_lvol_reclaim_space, rate_limit_mb_per_sec),
+		spdk_json_decode_uint64, true
+	},
+};
+
+static void
+rpc_bdev_lvol_reclaim_space(struct spdk_jsonrpc_request *request,
+			    const struct spdk_json_val *params)
+{
+	struct rpc_bdev_lvol_reclaim_space req = {};
+	struct spdk_bdev *bdev;
+	struct spdk_lvol *lvol;
+	int rc;
+
+	SPDK_INFOLOG(lvol_rpc, "Reclaiming space of lvol\n");
+
+	if (spdk_json_decode_object(params, rpc_bdev_lvol_reclaim_space_decoders,
+				    SPDK_COUNTOF(rpc_bdev_lvol_reclaim_space_decoders),
+				    &req)) {
+		SPDK_INFOLOG(lvol_rpc, "spdk_json_decode_object failed\n");
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 "spdk_json_decode_object failed");
+		goto cleanup;
+	}
+
+	bdev = spdk_bdev_get_by_name(req.name);
+	if (bdev == NULL) {
+		SPDK_ERRLOG("bdev '%s' does not exist\n", req.name);
+		spdk_jsonrpc_send_error_response(request, -ENODEV, spdk_strerror(ENODEV));
+		goto cleanup;
+	}
+
+	lvol = vbdev_lvol_get_from_bdev(bdev);
+	if (lvol == NULL) {
+		SPDK_ERRLOG("lvol does not exist\n");
+		spdk_jsonrpc_send_error_response(request, -ENODEV, spdk_strerror(ENODEV));
+		goto cleanup;
+	}
+
+	/* Reclamation runs in the background, its progress is reported by
+	 * bdev_lvol_get_reclaim_status */
+	rc = spdk_lvol_reclaim_space(lvol, req.rate_limit_mb_per_sec, NULL, NULL);
+	if (rc != 0) {
+		spdk_jsonrpc_send_error_response(request, rc, spdk_strerror(-rc));
+		goto cleanup;
+	}
+
+	spdk_jsonrpc_send_bool_response(request, true);
+
+cleanup:
+	free_rpc_bdev_lvol_reclaim_space(&req);
+}
+
+SPDK_RPC_REGISTER("bdev_lvol_reclaim_space", rpc_bdev_lvol_reclaim_space, SPDK_RPC_RUNTIME)
+
+static void
+rpc_bdev_lvol_get_reclaim_status(struct spdk_jsonrpc_request *request,
+				 const struct spdk_json_val *params)
+{
+	struct rpc_bdev_lvol_inflate req = {};
+	struct spdk_lvol_reclaim_status status;
+	struct spdk_json_write_ctx *w;
+	struct spdk_bdev *bdev;
+	struct spdk_lvol *lvol;
+
+	if (spdk_json_decode_object(params, rpc_bdev_lvol_inflate_decoders,
+				    SPDK_COUNTOF(rpc_bdev_lvol_inflate_decoders),
+				    &req)) {
+		SPDK_INFOLOG(lvol_rpc, "spdk_json_decode_object failed\n");
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 "spdk_json_decode_object failed");
+		goto cleanup;
+	}
+
+	bdev = spdk_bdev_get_by_name(req.name);
+	if (bdev == NULL) {
+		SPDK_ERRLOG("bdev '%s' does not exist\n", req.name);
+		spdk_jsonrpc_send_error_response(request, -ENODEV, spdk_strerror(ENODEV));
+		goto cleanup;
+	}
+
+	lvol = vbdev_lvol_get_from_bdev(bdev);
+	if (lvol == NULL) {
+		SPDK_ERRLOG("lvol does not exist\n");
+		spdk_jsonrpc_send_error_response(request, -ENODEV, spdk_strerror(ENODEV));
+		goto cleanup;
+	}
+
+	spdk_lvol_get_reclaim_status(lvol, &status);
+
+	w = spdk_jsonrpc_begin_result(request);
+	spdk_json_write_object_begin(w);
+	spdk_json_write_named_bool(w, "in_progress", status.in_progress);
+	spdk_json_write_named_uint64(w, "scanned_clusters", status.scanned_clusters);
+	spdk_json_write_named_uint64(w, "total_clusters", status.total_clusters);
+	spdk_json_write_named_uint64(w, "released_clusters", status.released_clusters);
+	spdk_json_write_named_int32(w, "result", status.result);
+	spdk_json_write_object_end(w);
+	spdk_jsonrpc_end_result(request, w);
+
+cleanup:
+	free_rpc_bdev_lvol_inflate(&req);
+}
+
+SPDK_RPC_REGISTER("bdev_lvol_get_reclaim_status", rpc_bdev_lvol_get_reclaim_status,
+		  SPDK_RPC_RUNTIME)
+
+struct rpc_bdev_lvol_export_diff {
+	char *name;
+	char *base_name;
+	char *target_bdev;
+};
+
+static void
+free_rpc_bdev_lvol_export_diff(struct rpc_bdev_lvol_export_diff *req)
+{
+	free(req->name);
+	free(req->base_name);
+	free(req->target_bdev);
+}
+
+static const struct spdk_json_object_decoder rpc_bdev_lvol_export_diff_decoders[] = {
+	{"name", offsetof(struct rpc_bdev_lvol_export_diff, name), spdk_json_decode_string},
+	{"base_name", offsetof(struct rpc_bdev_lvol_export_diff, base_name), spdk_json_decode_string, true},
+	{"target_bdev", offsetof(struct rpc_bdev_lvol_export_diff, target_bdev), spdk_json_decode_string},
+};
+
+static struct spdk_lvol *
+rpc_bdev_lvol_get_by_name(const char *name)
+{
+	struct spdk_bdev *bdev;
+
+	bdev = spdk_bdev_get_by_name(name);
+	if (bdev == NULL) {
+		SPDK_ERRLOG("bdev '%s' does not exist\n", name);
+		return NULL;
+	}
+
+	return vbdev_lvol_get_from_bdev(bdev);
+}
+
+static void
+rpc_bdev_lvol_export_diff_cb(void *cb_arg, uint64_t exported_clusters, int lvolerrno)
+{
+	struct spdk_jsonrpc_request *request = cb_arg;
+	struct spdk_json_write_ctx *w;
+
+	if (lvolerrno != 0) {
+		spdk_jsonrpc_send_error_response(request, lvolerrno, spdk_strerror(-lvolerrno));
+		return;
+	}
+
+	w = spdk_jsonrpc_begin_result(request);
+	spdk_json_write_object_begin(w);
+	spdk_json_write_named_uint64(w, "exported_clusters", exported_clusters);
+	spdk_json_write_object_end(w);
+	spdk_jsonrpc_end_result(request, w);
+}
+
+static void
+rpc_bdev_lvol_export_diff(struct spdk_jsonrpc_request *request,
+			  const struct spdk_json_val *params)
+{
+	struct rpc_bdev_lvol_export_diff req = {};
+	struct spdk_lvol *snapshot, *base_snapshot = NULL;
+
+	SPDK_INFOLOG(lvol_rpc, "Exporting lvol diff\n");
+
+	if (spdk_json_decode_object(params, rpc_bdev_lvol_export_diff_decoders,
+				    SPDK_COUNTOF(rpc_bdev_lvol_export_diff_decoders),
+				    &req)) {
+		SPDK_INFOLOG(lvol_rpc, "spdk_json_decode_object failed\n");
+		spdk_jsonrpc_send_error_response(request, SPDK_JSONRPC_ERROR_INTERNAL_ERROR,
+						 "spdk_json_decode_object failed");
+		goto cleanup;
+	}
+
+	snapshot = rpc_bdev_lvol_get_by_name(req.name);
+	if (snapshot == NULL) {
+		spdk_jsonrpc_send_error_response(request, -ENODEV, spdk_strerror(ENODEV));
+		goto cleanup;
+	}
+
+	if (req.base_name != NULL) {
+		base_snapshot = rpc_bdev_lvol_get_by_name(req.base_name);
+		if (base_snapshot == NULL) {
+			spdk_jsonrpc_send_error_response(request, -ENODEV, spdk_strerror(ENODEV));
+			goto cleanup;
+		}
+	}
+
+	vbdev_lvol_export_diff(snapshot, base_snapshot, req.target_bdev,
+			       rpc_bdev_lvol_export_diff_cb, request);
+
+cleanup:
+	free_rpc_bdev_lvol_export_diff(&req);
+}
+
+SPDK_RPC_REGISTER("bdev_lvol_export_diff", rpc_bdev_lvol_export_diff, SPDK_RPC_RUNTIME)
+
 struct rpc_bdev_lvol_resize {
 	char *name;
 	uint64_t size;
@@ -133,6 +133,7 @@ static struct spdk_bdev_nvme_opts g_opts = {
 	.transport_tos = 0,
 	.nvme_error_stat = false,
 	.io_path_stat = false,
+	.sq_doorbell_max_delay_us = 0,
 };
 
 #define NVME_HOTPLUG_POLL_PERIOD_MAX			10000000ULL
@@ -1643,6 +1644,7 @@ bdev_nvme_create_qpair(struct nvme_qpair *nvme_qpair)
 
 	spdk_nvme_ctrlr_get_default_io_qpair_opts(nvme_ctrlr->ctrlr, &opts, sizeof(opts));
 	opts.delay_cmd_submit = g_opts.delay_cmd_submit;
+	opts.sq_doorbell_max_delay_us = g_opts.sq_doorbell_max_delay_us;
 	opts.create_only = true;
 	opts.async_mode = true;
 	opts.io_queue_requests = spdk_max(g_opts.io_queue_requests, opts.io_queue_requests);
@@ -7231,6 +7233,7 @@ bdev_nvme_opts_config_json(struct spdk_json_write_ctx *w)
 	spdk_json_write_named_bool(w, "generate_uuids", g_opts.generate_uuids);
 	spdk_json_write_named_uint8(w, "transport_tos", g_opts.transport_tos);
 	spdk_json_write_named_bool(w, "io_path_stat", g_opts.io_path_stat);
+	spdk_json_write_named_uint32(w, "sq_doorbell_max_delay_us", g_opts.sq_doorbell_max_delay_us);
 	spdk_json_write_object_end(w);
 
 	spdk_json_write_object_end(w);
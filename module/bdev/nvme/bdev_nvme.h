@@ -285,6 +285,8 @@ struct spdk_bdev_nvme_opts {
 	bool nvme_error_stat;
 	uint32_t rdma_srq_size;
 	bool io_path_stat;
+	/* Upper bound of adaptive SQ doorbell coalescing in microseconds - PCIe only */
+	uint32_t sq_doorbell_max_delay_us;
 };
 
 struct spdk_nvme_qpair *bdev_nvme_get_io_qpair(struct spdk_io_channel *ctrlr_io_ch);
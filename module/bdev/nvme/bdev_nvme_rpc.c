@@ -74,6 +74,7 @@ static const struct spdk_json_object_decoder rpc_bdev_nvme_options_decoders[] =
 	{"nvme_error_stat", offsetof(struct spdk_bdev_nvme_opts, nvme_error_stat), spdk_json_decode_bool, true},
 	{"rdma_srq_size", offsetof(struct spdk_bdev_nvme_opts, rdma_srq_size), spdk_json_decode_uint32, true},
 	{"io_path_stat", offsetof(struct spdk_bdev_nvme_opts, io_path_stat), spdk_json_decode_bool, true},
+	{"sq_doorbell_max_delay_us", offsetof(struct spdk_bdev_nvme_opts, sq_doorbell_max_delay_us), spdk_json_decode_uint32, true},
 };
 
 static void
@@ -1118,6 +1119,9 @@ static void
 rpc_bdev_nvme_pcie_stats(struct spdk_json_write_ctx *w,
 			 struct spdk_nvme_transport_poll_group_stat *stat)
 {
+	struct spdk_nvme_pcie_qpair_stat *qpair_stat;
+	uint32_t i;
+
 	spdk_json_write_named_uint64(w, "polls", stat->pcie.polls);
 	spdk_json_write_named_uint64(w, "idle_polls", stat->pcie.idle_polls);
 	spdk_json_write_named_uint64(w, "completions", stat->pcie.completions);
@@ -1129,6 +1133,28 @@ rpc_bdev_nvme_pcie_stats(struct spdk_json_write_ctx *w,
 	spdk_json_write_named_uint64(w, "sq_mmio_doorbell_updates", stat->pcie.sq_mmio_doorbell_updates);
 	spdk_json_write_named_uint64(w, "sq_shadow_doorbell_updates",
 				     stat->pcie.sq_shadow_doorbell_updates);
+	spdk_json_write_named_uint64(w, "sq_coalesced_submissions", stat->pcie.sq_coalesced_submissions);
+	/* With a shadow doorbell, every write is counted as a shadow update and
+	 *  possibly an MMIO one too, so count it once.
+	 */
+	spdk_json_write_named_double(w, "sq_doorbell_updates_per_io",
+				     stat->pcie.submitted_requests ?
+				     (double)spdk_max(stat->pcie.sq_mmio_doorbell_updates,
+						      stat->pcie.sq_shadow_doorbell_updates) /
+				     stat->pcie.submitted_requests : 0.0);
+	spdk_json_write_named_uint64(w, "skipped_polls", stat->pcie.skipped_polls);
+
+	spdk_json_write_named_array_begin(w, "qpairs");
+	for (i = 0; i < stat->pcie.num_qpairs; i++) {
+		qpair_stat = &stat->pcie.qpair_stats[i];
+		spdk_json_write_object_begin(w);
+		spdk_json_write_named_string(w, "traddr", qpair_stat->traddr);
+		spdk_json_write_named_uint32(w, "qid", qpair_stat->qid);
+		spdk_json_write_named_uint64(w, "polls", qpair_stat->polls);
+		spdk_json_write_named_uint64(w, "idle_polls", qpair_stat->idle_polls);
+		spdk_json_write_object_end(w);
+	}
+	spdk_json_write_array_end(w);
 }
 
 static void
@@ -25,26 +25,50 @@
 #define SECTOR_SHIFT 9
 #endif
 
+#include <linux/nvme_ioctl.h>
+#include "spdk/nvme_spec.h"
+
+/* NVMe passthrough of /dev/ngXnY char devices needs the big SQEs/CQEs and the NVMe uring_cmd */
+#if defined(IORING_SETUP_SQE128) && defined(IORING_SETUP_CQE32) && defined(NVME_URING_CMD_IO)
+#define SPDK_URING_PASSTHRU 1
+#endif
+
 struct bdev_uring_zoned_dev {
 	uint64_t		num_zones;
 	uint32_t		zone_shift;
 	uint32_t		lba_shift;
 };
 
+struct bdev_uring_ring {
+	struct io_uring				uring;
+	bool					initialized;
+	uint64_t				io_inflight;
+	uint64_t				io_pending;
+	/* Registered file table, with -1 for the free slots.  NULL if files aren't registered. */
+	int					*files;
+	/* Number of the g_uring_buffers entries when the fixed buffers were registered, 0 if none */
+	uint32_t				num_buffers;
+	/* Index in the ring's fixed buffer table of each of those entries, -1 for the holes */
+	int					*buffer_index;
+};
+
 struct bdev_uring_io_channel {
 	struct bdev_uring_group_channel		*group_ch;
+	struct bdev_uring_ring			*ring;
+	/* Index of the bdev's file in the ring's registered file table, -1 if not registered */
+	int					file_index;
 };
 
 struct bdev_uring_group_channel {
-	uint64_t				io_inflight;
-	uint64_t				io_pending;
 	struct spdk_poller			*poller;
-	struct io_uring				uring;
+	struct bdev_uring_ring			ring;
+	/* Ring with big SQEs and CQEs for NVMe passthrough commands, set up on first use */
+	struct bdev_uring_ring			cmd_ring;
 };
 
 struct bdev_uring_task {
 	uint64_t			len;
-	struct bdev_uring_io_channel	*ch;
+	struct bdev_uring_ring		*ring;
 	TAILQ_ENTRY(bdev_uring_task)	link;
 };
 
@@ -53,16 +77,48 @@ struct bdev_uring {
 	struct bdev_uring_zoned_dev	zd;
 	char			*filename;
 	int			fd;
+	/* NVMe passthrough of a char device, I/O is submitted as NVMe commands to nsid */
+	bool			passthru;
+	uint32_t		nsid;
 	TAILQ_ENTRY(bdev_uring)  link;
 };
 
 static int bdev_uring_init(void);
 static void bdev_uring_fini(void);
+static int bdev_uring_config_json(struct spdk_json_write_ctx *w);
 static void uring_free_bdev(struct bdev_uring *uring);
 static TAILQ_HEAD(, bdev_uring) g_uring_bdev_head = TAILQ_HEAD_INITIALIZER(g_uring_bdev_head);
 
 #define SPDK_URING_QUEUE_DEPTH 512
 #define MAX_EVENTS_PER_POLL 32
+#define SPDK_URING_SQ_THREAD_IDLE_MS 1000
+/* Size of the registered file table of each ring, i.e. the number of bdevs using it */
+#define SPDK_URING_MAX_FILES 64
+/* The kernel doesn't accept fixed buffers larger than 1GiB */
+#define SPDK_URING_MAX_BUFFER_SIZE (1ULL << 30)
+#define SPDK_URING_MAX_BUFFERS 1024
+/* Transfer size limit of the passthrough commands if the controller doesn't report any */
+#define SPDK_URING_PASSTHRU_MAX_XFER (128 * 1024)
+
+static struct spdk_bdev_uring_opts g_opts = {
+	.queue_depth = SPDK_URING_QUEUE_DEPTH,
+	.fixed_files = false,
+	.fixed_buffers = false,
+	.sqpoll = false,
+	.sq_thread_idle_ms = SPDK_URING_SQ_THREAD_IDLE_MS,
+};
+
+/*
+ * The fixed buffers cover all the memory registered with SPDK (so all the hugepage memory the
+ * bdev_io buffers come from), split into chunks of at most SPDK_URING_MAX_BUFFER_SIZE.  The mem
+ * map translates an address to the index of its buffer + 1.  Buffers are only ever appended, so
+ * the indices stay valid for the rings that registered them earlier.  The buffers of unregistered
+ * memory are left as NULL holes, which the rings registering later skip.
+ */
+static struct spdk_mem_map *g_uring_mem_map;
+static pthread_mutex_t g_uring_buffers_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct iovec g_uring_buffers[SPDK_URING_MAX_BUFFERS];
+static uint32_t g_uring_num_buffers;
 
 static int
 bdev_uring_get_ctx_size(void)
@@ -74,11 +130,234 @@ static struct spdk_bdev_module uring_if = {
 	.name		= "uring",
 	.module_init	= bdev_uring_init,
 	.module_fini	= bdev_uring_fini,
+	.config_json	= bdev_uring_config_json,
 	.get_ctx_size	= bdev_uring_get_ctx_size,
 };
 
 SPDK_BDEV_MODULE_REGISTER(uring, &uring_if)
 
+void
+bdev_uring_get_opts(struct spdk_bdev_uring_opts *opts)
+{
+	*opts = g_opts;
+}
+
+int
+bdev_uring_set_opts(const struct spdk_bdev_uring_opts *opts)
+{
+	/* The rings are shared by all the bdevs of a thread, so they can't be changed under them */
+	if (!TAILQ_EMPTY(&g_uring_bdev_head)) {
+		return -EPERM;
+	}
+
+	if (opts->queue_depth == 0) {
+		return -EINVAL;
+	}
+
+	g_opts = *opts;
+
+	return 0;
+}
+
+static int
+bdev_uring_config_json(struct spdk_json_write_ctx *w)
+{
+	spdk_json_write_object_begin(w);
+
+	spdk_json_write_named_string(w, "method", "bdev_uring_set_options");
+
+	spdk_json_write_named_object_begin(w, "params");
+	spdk_json_write_named_uint32(w, "queue_depth", g_opts.queue_depth);
+	spdk_json_write_named_bool(w, "fixed_files", g_opts.fixed_files);
+	spdk_json_write_named_bool(w, "fixed_buffers", g_opts.fixed_buffers);
+	spdk_json_write_named_bool(w, "sqpoll", g_opts.sqpoll);
+	spdk_json_write_named_uint32(w, "sq_thread_idle_ms", g_opts.sq_thread_idle_ms);
+	spdk_json_write_object_end(w);
+
+	spdk_json_write_object_end(w);
+
+	return 0;
+}
+
+static int
+bdev_uring_mem_notify(void *cb_ctx, struct spdk_mem_map *map,
+		      enum spdk_mem_map_notify_action action,
+		      void *vaddr, size_t size)
+{
+	uint8_t *addr = vaddr;
+	size_t len;
+	uint32_t i;
+	int rc = 0;
+
+	pthread_mutex_lock(&g_uring_buffers_mutex);
+	switch (action) {
+	case SPDK_MEM_MAP_NOTIFY_REGISTER:
+		/* Memory past the last buffer is simply never used as a fixed buffer */
+		for (; size > 0 && g_uring_num_buffers < SPDK_URING_MAX_BUFFERS; addr += len, size -= len) {
+			len = spdk_min(size, SPDK_URING_MAX_BUFFER_SIZE);
+			i = g_uring_num_buffers;
+			rc = spdk_mem_map_set_translation(map, (uint64_t)addr, len, i + 1);
+			if (rc != 0) {
+				break;
+			}
+
+			g_uring_buffers[i].iov_base = addr;
+			g_uring_buffers[i].iov_len = len;
+			g_uring_num_buffers++;
+		}
+		break;
+	case SPDK_MEM_MAP_NOTIFY_UNREGISTER:
+		/* The rings keep the old pages pinned until they're destroyed, so just make sure no
+		 * new I/O is submitted with these buffers. */
+		rc = spdk_mem_map_clear_translation(map, (uint64_t)vaddr, size);
+		for (i = 0; i < g_uring_num_buffers; i++) {
+			if ((uint8_t *)g_uring_buffers[i].iov_base >= (uint8_t *)vaddr &&
+			    (uint8_t *)g_uring_buffers[i].iov_base < (uint8_t *)vaddr + size) {
+				g_uring_buffers[i].iov_base = NULL;
+				g_uring_buffers[i].iov_len = 0;
+			}
+		}
+		break;
+	default:
+		break;
+	}
+	pthread_mutex_unlock(&g_uring_buffers_mutex);
+
+	return rc;
+}
+
+static int
+bdev_uring_mem_are_contiguous(uint64_t translation1, uint64_t translation2)
+{
+	/* Only the pages of the same buffer can be accessed with a single fixed buffer I/O */
+	return translation1 == translation2;
+}
+
+static const struct spdk_mem_map_ops g_uring_mem_map_ops = {
+	.notify_cb = bdev_uring_mem_notify,
+	.are_contiguous = bdev_uring_mem_are_contiguous,
+};
+
+static void
+bdev_uring_ring_register_buffers(struct bdev_uring_ring *ring)
+{
+	struct iovec *iovs = NULL;
+	uint32_t i, num_buffers, num_iovs = 0;
+	int rc = 0;
+
+	pthread_mutex_lock(&g_uring_buffers_mutex);
+	num_buffers = g_uring_num_buffers;
+	if (num_buffers == 0) {
+		goto out;
+	}
+
+	iovs = calloc(num_buffers, sizeof(*iovs));
+	ring->buffer_index = calloc(num_buffers, sizeof(*ring->buffer_index));
+	if (iovs == NULL || ring->buffer_index == NULL) {
+		rc = -ENOMEM;
+		goto out;
+	}
+
+	/* Older kernels reject the NULL entries, so only the live buffers are registered */
+	for (i = 0; i < num_buffers; i++) {
+		if (g_uring_buffers[i].iov_base == NULL) {
+			ring->buffer_index[i] = -1;
+			continue;
+		}
+
+		ring->buffer_index[i] = num_iovs;
+		iovs[num_iovs++] = g_uring_buffers[i];
+	}
+
+	if (num_iovs > 0) {
+		rc = io_uring_register_buffers(&ring->uring, iovs, num_iovs);
+		if (rc == 0) {
+			ring->num_buffers = num_buffers;
+		}
+	}
+out:
+	pthread_mutex_unlock(&g_uring_buffers_mutex);
+	free(iovs);
+
+	if (ring->num_buffers == 0) {
+		free(ring->buffer_index);
+		ring->buffer_index = NULL;
+	}
+
+	if (rc != 0) {
+		/* E.g. RLIMIT_MEMLOCK too low */
+		SPDK_WARNLOG("Failed to register uring fixed buffers: %s\n", spdk_strerror(-rc));
+	}
+}
+
+static void
+bdev_uring_ring_register_files(struct bdev_uring_ring *ring)
+{
+	int i, rc;
+
+	ring->files = calloc(SPDK_URING_MAX_FILES, sizeof(*ring->files));
+	if (ring->files == NULL) {
+		return;
+	}
+
+	for (i = 0; i < SPDK_URING_MAX_FILES; i++) {
+		ring->files[i] = -1;
+	}
+
+	rc = io_uring_register_files(&ring->uring, ring->files, SPDK_URING_MAX_FILES);
+	if (rc != 0) {
+		SPDK_WARNLOG("Failed to register uring files: %s\n", spdk_strerror(-rc));
+		free(ring->files);
+		ring->files = NULL;
+	}
+}
+
+static int
+bdev_uring_ring_init(struct bdev_uring_ring *ring, uint32_t flags)
+{
+	struct io_uring_params params = {};
+	int rc;
+
+	/* Do not use IORING_SETUP_IOPOLL until the Linux kernel can support not only
+	 * local devices but also devices attached from remote target */
+	params.flags = flags;
+	if (g_opts.sqpoll) {
+		params.flags |= IORING_SETUP_SQPOLL;
+		params.sq_thread_idle = g_opts.sq_thread_idle_ms;
+	}
+
+	rc = io_uring_queue_init_params(g_opts.queue_depth, &ring->uring, &params);
+	if (rc < 0) {
+		SPDK_ERRLOG("uring I/O context setup failure: %s\n", spdk_strerror(-rc));
+		return rc;
+	}
+
+	if (g_opts.fixed_files) {
+		bdev_uring_ring_register_files(ring);
+	}
+
+	if (g_opts.fixed_buffers && g_uring_mem_map != NULL) {
+		bdev_uring_ring_register_buffers(ring);
+	}
+
+	ring->initialized = true;
+
+	return 0;
+}
+
+static void
+bdev_uring_ring_fini(struct bdev_uring_ring *ring)
+{
+	if (!ring->initialized) {
+		return;
+	}
+
+	io_uring_queue_exit(&ring->uring);
+	free(ring->files);
+	free(ring->buffer_index);
+	memset(ring, 0, sizeof(*ring));
+}
+
 static int
 bdev_uring_open(struct bdev_uring *bdev)
 {
@@ -122,57 +401,121 @@ bdev_uring_close(struct bdev_uring *bdev)
 	return 0;
 }
 
-static int64_t
-bdev_uring_readv(struct bdev_uring *uring, struct spdk_io_channel *ch,
-		 struct bdev_uring_task *uring_task,
-		 struct iovec *iov, int iovcnt, uint64_t nbytes, uint64_t offset)
+/* Returns the index of the fixed buffer containing the whole I/O buffer, or -1 */
+static int
+bdev_uring_get_buf_index(struct bdev_uring_ring *ring, struct iovec *iov, int iovcnt)
 {
-	struct bdev_uring_io_channel *uring_ch = spdk_io_channel_get_ctx(ch);
-	struct bdev_uring_group_channel *group_ch = uring_ch->group_ch;
-	struct io_uring_sqe *sqe;
+	uint64_t translation, size;
 
-	sqe = io_uring_get_sqe(&group_ch->uring);
-	if (!sqe) {
-		SPDK_DEBUGLOG(uring, "get sqe failed as out of resource\n");
-		return -ENOMEM;
+	if (ring->num_buffers == 0 || iovcnt != 1) {
+		return -1;
 	}
 
-	io_uring_prep_readv(sqe, uring->fd, iov, iovcnt, offset);
-	io_uring_sqe_set_data(sqe, uring_task);
-	uring_task->len = nbytes;
-	uring_task->ch = uring_ch;
+	size = iov->iov_len;
+	translation = spdk_mem_map_translate(g_uring_mem_map, (uint64_t)iov->iov_base, &size);
+	if (translation == 0 || translation > ring->num_buffers || size < iov->iov_len) {
+		return -1;
+	}
 
-	SPDK_DEBUGLOG(uring, "read %d iovs size %lu to off: %#lx\n",
-		      iovcnt, nbytes, offset);
+	return ring->buffer_index[translation - 1];
+}
 
-	group_ch->io_pending++;
-	return nbytes;
+#ifdef SPDK_URING_PASSTHRU
+static void
+bdev_uring_prep_nvme_cmd(struct io_uring_sqe *sqe, int fd, struct bdev_uring *uring,
+			 enum spdk_bdev_io_type type, struct iovec *iov, int iovcnt,
+			 uint64_t offset_blocks, uint64_t num_blocks, int buf_index)
+{
+	struct nvme_uring_cmd *cmd = (struct nvme_uring_cmd *)sqe->cmd;
+
+	io_uring_prep_rw(IORING_OP_URING_CMD, sqe, fd, NULL, 0, 0);
+	sqe->cmd_op = iovcnt == 1 ? NVME_URING_CMD_IO : NVME_URING_CMD_IO_VEC;
+
+	memset(cmd, 0, sizeof(*cmd));
+	cmd->opcode = type == SPDK_BDEV_IO_TYPE_READ ? SPDK_NVME_OPC_READ : SPDK_NVME_OPC_WRITE;
+	cmd->nsid = uring->nsid;
+	cmd->cdw10 = (uint32_t)offset_blocks;
+	cmd->cdw11 = (uint32_t)(offset_blocks >> 32);
+	/* 0's based number of blocks */
+	cmd->cdw12 = num_blocks - 1;
+	if (iovcnt == 1) {
+		cmd->addr = (uintptr_t)iov->iov_base;
+		cmd->data_len = iov->iov_len;
+	} else {
+		cmd->addr = (uintptr_t)iov;
+		cmd->data_len = iovcnt;
+	}
+
+	if (buf_index >= 0) {
+		sqe->uring_cmd_flags = IORING_URING_CMD_FIXED;
+		sqe->buf_index = buf_index;
+	}
+}
+#else
+static void
+bdev_uring_prep_nvme_cmd(struct io_uring_sqe *sqe, int fd, struct bdev_uring *uring,
+			 enum spdk_bdev_io_type type, struct iovec *iov, int iovcnt,
+			 uint64_t offset_blocks, uint64_t num_blocks, int buf_index)
+{
+	/* Passthrough bdevs can't be created without the support */
+	assert(false);
 }
+#endif
 
 static int64_t
-bdev_uring_writev(struct bdev_uring *uring, struct spdk_io_channel *ch,
-		  struct bdev_uring_task *uring_task,
-		  struct iovec *iov, int iovcnt, size_t nbytes, uint64_t offset)
+bdev_uring_rw(struct bdev_uring *uring, struct spdk_io_channel *ch,
+	      struct bdev_uring_task *uring_task, enum spdk_bdev_io_type type,
+	      struct iovec *iov, int iovcnt, uint64_t offset_blocks, uint64_t num_blocks)
 {
 	struct bdev_uring_io_channel *uring_ch = spdk_io_channel_get_ctx(ch);
-	struct bdev_uring_group_channel *group_ch = uring_ch->group_ch;
+	struct bdev_uring_ring *ring = uring_ch->ring;
 	struct io_uring_sqe *sqe;
+	uint64_t nbytes = num_blocks * uring->bdev.blocklen;
+	uint64_t offset = offset_blocks * uring->bdev.blocklen;
+	int buf_index, fd;
 
-	sqe = io_uring_get_sqe(&group_ch->uring);
+	sqe = io_uring_get_sqe(&ring->uring);
 	if (!sqe) {
 		SPDK_DEBUGLOG(uring, "get sqe failed as out of resource\n");
 		return -ENOMEM;
 	}
 
-	io_uring_prep_writev(sqe, uring->fd, iov, iovcnt, offset);
+	fd = uring_ch->file_index >= 0 ? uring_ch->file_index : uring->fd;
+	buf_index = bdev_uring_get_buf_index(ring, iov, iovcnt);
+
+	if (uring->passthru) {
+		bdev_uring_prep_nvme_cmd(sqe, fd, uring, type, iov, iovcnt, offset_blocks, num_blocks,
+					 buf_index);
+		/* NVMe commands complete with 0 */
+		uring_task->len = 0;
+	} else {
+		if (type == SPDK_BDEV_IO_TYPE_READ) {
+			if (buf_index >= 0) {
+				io_uring_prep_read_fixed(sqe, fd, iov->iov_base, nbytes, offset, buf_index);
+			} else {
+				io_uring_prep_readv(sqe, fd, iov, iovcnt, offset);
+			}
+		} else {
+			if (buf_index >= 0) {
+				io_uring_prep_write_fixed(sqe, fd, iov->iov_base, nbytes, offset, buf_index);
+			} else {
+				io_uring_prep_writev(sqe, fd, iov, iovcnt, offset);
+			}
+		}
+		uring_task->len = nbytes;
+	}
+
+	if (uring_ch->file_index >= 0) {
+		io_uring_sqe_set_flags(sqe, IOSQE_FIXED_FILE);
+	}
 	io_uring_sqe_set_data(sqe, uring_task);
-	uring_task->len = nbytes;
-	uring_task->ch = uring_ch;
+	uring_task->ring = ring;
 
-	SPDK_DEBUGLOG(uring, "write %d iovs size %lu from off: %#lx\n",
-		      iovcnt, nbytes, offset);
+	SPDK_DEBUGLOG(uring, "%s %d iovs size %lu at off: %#lx%s\n",
+		      type == SPDK_BDEV_IO_TYPE_READ ? "read" : "write",
+		      iovcnt, nbytes, offset, buf_index >= 0 ? " (fixed buffer)" : "");
 
-	group_ch->io_pending++;
+	ring->io_pending++;
 	return nbytes;
 }
 
@@ -218,7 +561,7 @@ bdev_uring_reap(struct io_uring *ring, int max)
 			status = SPDK_BDEV_IO_STATUS_SUCCESS;
 		}
 
-		uring_task->ch->group_ch->io_inflight--;
+		uring_task->ring->io_inflight--;
 		io_uring_cqe_seen(ring, cqe);
 		spdk_bdev_io_complete(spdk_bdev_io_from_ctx(uring_task), status);
 		count++;
@@ -228,33 +571,47 @@ bdev_uring_reap(struct io_uring *ring, int max)
 }
 
 static int
-bdev_uring_group_poll(void *arg)
+bdev_uring_ring_poll(struct bdev_uring_ring *ring)
 {
-	struct bdev_uring_group_channel *group_ch = arg;
 	int to_complete, to_submit;
 	int count, ret;
 
-	to_submit = group_ch->io_pending;
+	to_submit = ring->io_pending;
 
 	if (to_submit > 0) {
 		/* If there are I/O to submit, use io_uring_submit here.
-		 * It will automatically call spdk_io_uring_enter appropriately. */
-		ret = io_uring_submit(&group_ch->uring);
+		 * It will automatically call spdk_io_uring_enter appropriately
+		 * (and only wake up the SQ thread if it went idle in SQPOLL mode). */
+		ret = io_uring_submit(&ring->uring);
 		if (ret < 0) {
-			return SPDK_POLLER_BUSY;
+			return 1;
 		}
 
-		group_ch->io_pending = 0;
-		group_ch->io_inflight += to_submit;
+		ring->io_pending = 0;
+		ring->io_inflight += to_submit;
 	}
 
-	to_complete = group_ch->io_inflight;
+	to_complete = ring->io_inflight;
 	count = 0;
 	if (to_complete > 0) {
-		count = bdev_uring_reap(&group_ch->uring, to_complete);
+		count = bdev_uring_reap(&ring->uring, to_complete);
 	}
 
-	if (count + to_submit > 0) {
+	return spdk_max(count, 0) + to_submit;
+}
+
+static int
+bdev_uring_group_poll(void *arg)
+{
+	struct bdev_uring_group_channel *group_ch = arg;
+	int count;
+
+	count = bdev_uring_ring_poll(&group_ch->ring);
+	if (group_ch->cmd_ring.initialized) {
+		count += bdev_uring_ring_poll(&group_ch->cmd_ring);
+	}
+
+	if (count > 0) {
 		return SPDK_POLLER_BUSY;
 	} else {
 		return SPDK_POLLER_IDLE;
@@ -274,22 +631,15 @@ bdev_uring_get_buf_cb(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io,
 
 	switch (bdev_io->type) {
 	case SPDK_BDEV_IO_TYPE_READ:
-		ret = bdev_uring_readv((struct bdev_uring *)bdev_io->bdev->ctxt,
-				       ch,
-				       (struct bdev_uring_task *)bdev_io->driver_ctx,
-				       bdev_io->u.bdev.iovs,
-				       bdev_io->u.bdev.iovcnt,
-				       bdev_io->u.bdev.num_blocks * bdev_io->bdev->blocklen,
-				       bdev_io->u.bdev.offset_blocks * bdev_io->bdev->blocklen);
-		break;
 	case SPDK_BDEV_IO_TYPE_WRITE:
-		ret = bdev_uring_writev((struct bdev_uring *)bdev_io->bdev->ctxt,
-					ch,
-					(struct bdev_uring_task *)bdev_io->driver_ctx,
-					bdev_io->u.bdev.iovs,
-					bdev_io->u.bdev.iovcnt,
-					bdev_io->u.bdev.num_blocks * bdev_io->bdev->blocklen,
-					bdev_io->u.bdev.offset_blocks * bdev_io->bdev->blocklen);
+		ret = bdev_uring_rw((struct bdev_uring *)bdev_io->bdev->ctxt,
+				    ch,
+				    (struct bdev_uring_task *)bdev_io->driver_ctx,
+				    bdev_io->type,
+				    bdev_io->u.bdev.iovs,
+				    bdev_io->u.bdev.iovcnt,
+				    bdev_io->u.bdev.offset_blocks,
+				    bdev_io->u.bdev.num_blocks);
 		break;
 	default:
 		SPDK_ERRLOG("Wrong io type\n");
@@ -618,6 +968,8 @@ bdev_uring_io_type_supported(void *ctx, enum spdk_bdev_io_type io_type)
 #ifdef SPDK_CONFIG_URING_ZNS
 	case SPDK_BDEV_IO_TYPE_GET_ZONE_INFO:
 	case SPDK_BDEV_IO_TYPE_ZONE_MANAGEMENT:
+		/* The zone ioctls are only issued to block devices, not to passthrough char devices */
+		return !((struct bdev_uring *)ctx)->passthru;
 #endif
 	case SPDK_BDEV_IO_TYPE_READ:
 	case SPDK_BDEV_IO_TYPE_WRITE:
@@ -627,12 +979,81 @@ bdev_uring_io_type_supported(void *ctx, enum spdk_bdev_io_type io_type)
 	}
 }
 
+static void
+bdev_uring_register_file(struct bdev_uring_io_channel *ch, int fd)
+{
+	struct bdev_uring_ring *ring = ch->ring;
+	int i, rc;
+
+	ch->file_index = -1;
+	if (ring->files == NULL) {
+		return;
+	}
+
+	for (i = 0; i < SPDK_URING_MAX_FILES; i++) {
+		if (ring->files[i] == -1) {
+			break;
+		}
+	}
+
+	if (i == SPDK_URING_MAX_FILES) {
+		/* Fall back to the unregistered fd */
+		SPDK_DEBUGLOG(uring, "registered file table of the ring is full\n");
+		return;
+	}
+
+	rc = io_uring_register_files_update(&ring->uring, i, &fd, 1);
+	if (rc != 1) {
+		SPDK_WARNLOG("Failed to register uring file: %s\n", spdk_strerror(rc < 0 ? -rc : EIO));
+		return;
+	}
+
+	ring->files[i] = fd;
+	ch->file_index = i;
+}
+
+static void
+bdev_uring_unregister_file(struct bdev_uring_io_channel *ch)
+{
+	struct bdev_uring_ring *ring = ch->ring;
+	int fd = -1;
+
+	if (ch->file_index < 0) {
+		return;
+	}
+
+	io_uring_register_files_update(&ring->uring, ch->file_index, &fd, 1);
+	ring->files[ch->file_index] = -1;
+	ch->file_index = -1;
+}
+
 static int
 bdev_uring_create_cb(void *io_device, void *ctx_buf)
 {
 	struct bdev_uring_io_channel *ch = ctx_buf;
+	struct bdev_uring *uring = io_device;
+	struct spdk_io_channel *group_io_ch;
+
+	group_io_ch = spdk_get_io_channel(&uring_if);
+	if (group_io_ch == NULL) {
+		return -ENOMEM;
+	}
+
+	ch->group_ch = spdk_io_channel_get_ctx(group_io_ch);
+	ch->ring = &ch->group_ch->ring;
+
+#ifdef SPDK_URING_PASSTHRU
+	if (uring->passthru) {
+		ch->ring = &ch->group_ch->cmd_ring;
+		if (!ch->ring->initialized &&
+		    bdev_uring_ring_init(ch->ring, IORING_SETUP_SQE128 | IORING_SETUP_CQE32) != 0) {
+			spdk_put_io_channel(group_io_ch);
+			return -EIO;
+		}
+	}
+#endif
 
-	ch->group_ch = spdk_io_channel_get_ctx(spdk_get_io_channel(&uring_if));
+	bdev_uring_register_file(ch, uring->fd);
 
 	return 0;
 }
@@ -642,6 +1063,7 @@ bdev_uring_destroy_cb(void *io_device, void *ctx_buf)
 {
 	struct bdev_uring_io_channel *ch = ctx_buf;
 
+	bdev_uring_unregister_file(ch);
 	spdk_put_io_channel(spdk_io_channel_from_ctx(ch->group_ch));
 }
 
@@ -661,6 +1083,7 @@ bdev_uring_dump_info_json(void *ctx, struct spdk_json_write_ctx *w)
 	spdk_json_write_named_object_begin(w, "uring");
 
 	spdk_json_write_named_string(w, "filename", uring->filename);
+	spdk_json_write_named_bool(w, "passthru", uring->passthru);
 
 	spdk_json_write_object_end(w);
 
@@ -710,10 +1133,7 @@ bdev_uring_group_create_cb(void *io_device, void *ctx_buf)
 {
 	struct bdev_uring_group_channel *ch = ctx_buf;
 
-	/* Do not use IORING_SETUP_IOPOLL until the Linux kernel can support not only
-	 * local devices but also devices attached from remote target */
-	if (io_uring_queue_init(SPDK_URING_QUEUE_DEPTH, &ch->uring, 0) < 0) {
-		SPDK_ERRLOG("uring I/O context setup failure\n");
+	if (bdev_uring_ring_init(&ch->ring, 0) != 0) {
 		return -1;
 	}
 
@@ -726,17 +1146,97 @@ bdev_uring_group_destroy_cb(void *io_device, void *ctx_buf)
 {
 	struct bdev_uring_group_channel *ch = ctx_buf;
 
-	io_uring_queue_exit(&ch->uring);
+	bdev_uring_ring_fini(&ch->ring);
+	bdev_uring_ring_fini(&ch->cmd_ring);
 
 	spdk_poller_unregister(&ch->poller);
 }
 
+#ifdef SPDK_URING_PASSTHRU
+static int
+bdev_uring_nvme_admin_identify(int fd, uint32_t nsid, uint32_t cns, void *buf)
+{
+	struct nvme_admin_cmd cmd = {};
+
+	cmd.opcode = SPDK_NVME_OPC_IDENTIFY;
+	cmd.nsid = nsid;
+	cmd.addr = (uintptr_t)buf;
+	cmd.data_len = 4096;
+	cmd.cdw10 = cns;
+
+	return ioctl(fd, NVME_IOCTL_ADMIN_CMD, &cmd);
+}
+
+/* Gets the geometry of the namespace behind an NVMe generic char device (/dev/ngXnY) */
+static int
+bdev_uring_passthru_init(struct bdev_uring *uring, uint32_t *block_size, uint64_t *num_blocks)
+{
+	struct spdk_nvme_ctrlr_data *cdata = NULL;
+	struct spdk_nvme_ns_data *nsdata;
+	uint32_t max_xfer;
+	int nsid, rc = -EINVAL;
+
+	nsid = ioctl(uring->fd, NVME_IOCTL_ID);
+	if (nsid <= 0) {
+		SPDK_ERRLOG("%s is not an NVMe namespace char device\n", uring->filename);
+		return -EINVAL;
+	}
+
+	nsdata = calloc(1, sizeof(*nsdata));
+	cdata = calloc(1, sizeof(*cdata));
+	if (nsdata == NULL || cdata == NULL) {
+		rc = -ENOMEM;
+		goto out;
+	}
+
+	if (bdev_uring_nvme_admin_identify(uring->fd, nsid, SPDK_NVME_IDENTIFY_NS, nsdata) != 0 ||
+	    bdev_uring_nvme_admin_identify(uring->fd, 0, SPDK_NVME_IDENTIFY_CTRLR, cdata) != 0) {
+		SPDK_ERRLOG("Failed to identify %s, errno %d: %s\n", uring->filename, errno,
+			    spdk_strerror(errno));
+		goto out;
+	}
+
+	if (nsdata->lbaf[nsdata->flbas.format].ms != 0) {
+		SPDK_ERRLOG("Namespaces with metadata are not supported (%s)\n", uring->filename);
+		rc = -ENOTSUP;
+		goto out;
+	}
+
+	uring->nsid = nsid;
+	uring->passthru = true;
+	*block_size = 1u << nsdata->lbaf[nsdata->flbas.format].lbads;
+	*num_blocks = nsdata->nsze;
+
+	/* The passthrough commands aren't split by the kernel, assume the minimum memory page
+	 * size of 4KiB the MDTS is reported in. */
+	max_xfer = SPDK_URING_PASSTHRU_MAX_XFER;
+	if (cdata->mdts != 0 && cdata->mdts < 20) {
+		max_xfer = spdk_min(max_xfer, (1u << cdata->mdts) * 4096);
+	}
+	uring->bdev.optimal_io_boundary = spdk_max(max_xfer / *block_size, 1);
+	uring->bdev.split_on_optimal_io_boundary = true;
+	rc = 0;
+out:
+	free(nsdata);
+	free(cdata);
+	return rc;
+}
+#else
+static int
+bdev_uring_passthru_init(struct bdev_uring *uring, uint32_t *block_size, uint64_t *num_blocks)
+{
+	SPDK_ERRLOG("NVMe passthrough is not supported by this build (%s)\n", uring->filename);
+	return -ENOTSUP;
+}
+#endif
+
 struct spdk_bdev *
 create_uring_bdev(const char *name, const char *filename, uint32_t block_size)
 {
 	struct bdev_uring *uring;
 	uint32_t detected_block_size;
-	uint64_t bdev_size;
+	uint64_t bdev_size, num_blocks = 0;
+	struct stat st;
 	int rc;
 
 	uring = calloc(1, sizeof(*uring));
@@ -755,7 +1255,22 @@ create_uring_bdev(const char *name, const char *filename, uint32_t block_size)
 		goto error_return;
 	}
 
-	bdev_size = spdk_fd_get_size(uring->fd);
+	if (fstat(uring->fd, &st) == 0 && S_ISCHR(st.st_mode)) {
+		/* NVMe generic char device, its I/O is submitted as NVMe commands */
+		if (bdev_uring_passthru_init(uring, &detected_block_size, &num_blocks) != 0) {
+			goto error_return;
+		}
+
+		if (block_size != 0 && block_size != detected_block_size) {
+			SPDK_ERRLOG("Block size of passthrough bdev must match the LBA size (%" PRIu32 ")\n",
+				    detected_block_size);
+			goto error_return;
+		}
+		block_size = detected_block_size;
+		bdev_size = num_blocks * block_size;
+	} else {
+		bdev_size = spdk_fd_get_size(uring->fd);
+	}
 
 	uring->bdev.name = strdup(name);
 	if (!uring->bdev.name) {
@@ -766,7 +1281,7 @@ create_uring_bdev(const char *name, const char *filename, uint32_t block_size)
 
 	uring->bdev.write_cache = 1;
 
-	detected_block_size = spdk_fd_get_blocklen(uring->fd);
+	detected_block_size = uring->passthru ? block_size : spdk_fd_get_blocklen(uring->fd);
 	if (block_size == 0) {
 		/* User did not specify block size - use autodetected block size. */
 		if (detected_block_size == 0) {
@@ -800,9 +1315,18 @@ create_uring_bdev(const char *name, const char *filename, uint32_t block_size)
 	uring->bdev.blocklen = block_size;
 	uring->bdev.required_alignment = spdk_u32log2(block_size);
 
-	rc = bdev_uring_check_zoned_support(uring, name, filename);
-	if (rc) {
-		goto error_return;
+	if (!uring->passthru) {
+		rc = bdev_uring_check_zoned_support(uring, name, filename);
+		if (rc) {
+			goto error_return;
+		}
+	}
+
+	if (g_opts.fixed_buffers && g_uring_mem_map == NULL) {
+		g_uring_mem_map = spdk_mem_map_alloc(0, &g_uring_mem_map_ops, NULL);
+		if (g_uring_mem_map == NULL) {
+			SPDK_WARNLOG("Failed to allocate mem map, fixed buffers won't be used\n");
+		}
 	}
 
 	if (bdev_size % uring->bdev.blocklen != 0) {
@@ -881,6 +1405,9 @@ static void
 bdev_uring_fini(void)
 {
 	spdk_io_device_unregister(&uring_if, NULL);
+	if (g_uring_mem_map != NULL) {
+		spdk_mem_map_free(&g_uring_mem_map);
+	}
 }
 
 SPDK_LOG_REGISTER_COMPONENT(uring)
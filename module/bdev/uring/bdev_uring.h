@@ -13,10 +13,26 @@
 
 #include "spdk/bdev_module.h"
 
+struct spdk_bdev_uring_opts {
+	/* Number of SQEs of each ring */
+	uint32_t queue_depth;
+	/* Register the files of the bdevs with the rings */
+	bool fixed_files;
+	/* Register the SPDK memory as fixed buffers with the rings */
+	bool fixed_buffers;
+	/* Let a kernel thread poll the SQ of each ring (IORING_SETUP_SQPOLL) */
+	bool sqpoll;
+	/* Idle time after which the SQ thread goes to sleep */
+	uint32_t sq_thread_idle_ms;
+};
+
 typedef void (*spdk_delete_uring_complete)(void *cb_arg, int bdeverrno);
 
 struct spdk_bdev *create_uring_bdev(const char *name, const char *filename, uint32_t block_size);
 
 void delete_uring_bdev(const char *name, spdk_delete_uring_complete cb_fn, void *cb_arg);
 
+void bdev_uring_get_opts(struct spdk_bdev_uring_opts *opts);
+int bdev_uring_set_opts(const struct spdk_bdev_uring_opts *opts);
+
 #endif /* SPDK_BDEV_URING_H */
@@ -465,11 +465,38 @@ def bdev_aio_delete(client, name):
     return client.call('bdev_aio_delete', params)
 
 
+def bdev_uring_set_options(client, queue_depth=None, fixed_files=None, fixed_buffers=None, sqpoll=None,
+                           sq_thread_idle_ms=None):
+    """Set parameters for the uring bdev module. Only allowed before any uring bdev is created.
+
+    Args:
+        queue_depth: number of SQEs of each ring (optional)
+        fixed_files: register the files of the bdevs with the rings (optional)
+        fixed_buffers: register the SPDK memory as fixed buffers with the rings (optional)
+        sqpoll: let a kernel thread poll the SQ of each ring (optional)
+        sq_thread_idle_ms: idle time after which the SQ thread goes to sleep (optional)
+    """
+    params = {}
+
+    if queue_depth is not None:
+        params['queue_depth'] = queue_depth
+    if fixed_files is not None:
+        params['fixed_files'] = fixed_files
+    if fixed_buffers is not None:
+        params['fixed_buffers'] = fixed_buffers
+    if sqpoll is not None:
+        params['sqpoll'] = sqpoll
+    if sq_thread_idle_ms is not None:
+        params['sq_thread_idle_ms'] = sq_thread_idle_ms
+
+    return client.call('bdev_uring_set_options', params)
+
+
 def bdev_uring_create(client, filename, name, block_size=None):
     """Create a bdev with Linux io_uring backend.
 
     Args:
-        filename: path to device or file (ex: /dev/nvme0n1)
+        filename: path to device or file (ex: /dev/nvme0n1), or NVMe generic char device for passthrough (ex: /dev/ng0n1)
         name: name of bdev
         block_size: block size of device (optional; autodetected if omitted)
 
@@ -535,7 +562,8 @@ def bdev_nvme_set_options(client, action_on_timeout=None, timeout_us=None, timeo
                           delay_cmd_submit=None, transport_retry_count=None, bdev_retry_count=None,
                           transport_ack_timeout=None, ctrlr_loss_timeout_sec=None, reconnect_delay_sec=None,
                           fast_io_fail_timeout_sec=None, disable_auto_failback=None, generate_uuids=None,
-                          transport_tos=None, nvme_error_stat=None, rdma_srq_size=None, io_path_stat=None):
+                          transport_tos=None, nvme_error_stat=None, rdma_srq_size=None, io_path_stat=None,
+                          sq_doorbell_max_delay_us=None):
     """Set options for the bdev nvme. This is startup command.
 
     Args:
@@ -580,6 +608,8 @@ def bdev_nvme_set_options(client, action_on_timeout=None, timeout_us=None, timeo
         nvme_error_stat: Enable collecting NVMe error counts. (optional)
         rdma_srq_size: Set the size of a shared rdma receive queue. Default: 0 (disabled) (optional)
         io_path_stat: Enable collection I/O path stat of each io path. (optional)
+        sq_doorbell_max_delay_us: Enable adaptive coalescing of PCIe SQ doorbell writes with this upper bound
+        on the delay of a command, in microseconds. Ignored if delay_cmd_submit is enabled. Default: 0 (disabled) (optional)
 
     """
     params = {}
@@ -660,6 +690,9 @@ def bdev_nvme_set_options(client, action_on_timeout=None, timeout_us=None, timeo
     if io_path_stat is not None:
         params['io_path_stat'] = io_path_stat
 
+    if sq_doorbell_max_delay_us is not None:
+        params['sq_doorbell_max_delay_us'] = sq_doorbell_max_delay_us
+
     return client.call('bdev_nvme_set_options', params)
 
 
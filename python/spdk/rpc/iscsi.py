@@ -26,7 +26,8 @@ def iscsi_set_options(
         max_r2t_per_connection=None,
         pdu_pool_size=None,
         immediate_data_pool_size=None,
-        data_out_pool_size=None):
+        data_out_pool_size=None,
+        poll_group_rebalance_period_us=None):
     """Set iSCSI target options.
 
     Args:
@@ -52,6 +53,8 @@ def iscsi_set_options(
         pdu_pool_size: Number of PDUs in the pool (optional)
         immediate_data_pool_size: Number of immediate data buffers in the pool (optional)
         data_out_pool_size: Number of data out buffers in the pool (optional)
+        poll_group_rebalance_period_us: Period in microseconds to move a target node from the busiest
+        to the least busy poll group, 0 to disable (optional)
 
     Returns:
         True or False
@@ -102,6 +105,8 @@ def iscsi_set_options(
         params['immediate_data_pool_size'] = immediate_data_pool_size
     if data_out_pool_size:
         params['data_out_pool_size'] = data_out_pool_size
+    if poll_group_rebalance_period_us is not None:
+        params['poll_group_rebalance_period_us'] = poll_group_rebalance_period_us
 
     return client.call('iscsi_set_options', params)
 
@@ -198,6 +198,50 @@ def bdev_lvol_decouple_parent(client, name):
     return client.call('bdev_lvol_decouple_parent', params)
 
 
+def bdev_lvol_reclaim_space(client, name, rate_limit_mb_per_sec=None):
+    """Start background release of zeroed clusters of a thin provisioned logical volume.
+
+    Args:
+        name: name of logical volume to reclaim space of
+        rate_limit_mb_per_sec: maximum scan rate in MiB/s, 0 for no limit (optional)
+    """
+    params = {
+        'name': name,
+    }
+    if rate_limit_mb_per_sec is not None:
+        params['rate_limit_mb_per_sec'] = rate_limit_mb_per_sec
+    return client.call('bdev_lvol_reclaim_space', params)
+
+
+def bdev_lvol_get_reclaim_status(client, name):
+    """Get progress of the space reclamation of a logical volume.
+
+    Args:
+        name: name of logical volume
+    """
+    params = {
+        'name': name,
+    }
+    return client.call('bdev_lvol_get_reclaim_status', params)
+
+
+def bdev_lvol_export_diff(client, name, target_bdev, base_name=None):
+    """Copy clusters of a snapshot changed since an older snapshot to a bdev.
+
+    Args:
+        name: name of the snapshot logical volume to export
+        target_bdev: name of the bdev to write the changed clusters to
+        base_name: name of an older snapshot in the lineage; all allocated clusters are copied if omitted (optional)
+    """
+    params = {
+        'name': name,
+        'target_bdev': target_bdev,
+    }
+    if base_name:
+        params['base_name'] = base_name
+    return client.call('bdev_lvol_export_diff', params)
+
+
 def bdev_lvol_delete_lvstore(client, uuid=None, lvs_name=None):
     """Destroy a logical volume store.
 
@@ -3,12 +3,16 @@
 #  All rights reserved.
 
 
-def nbd_start_disk(client, bdev_name, nbd_device):
+def nbd_start_disk(client, bdev_name, nbd_device, num_connections=None, cpumask=None):
     params = {
         'bdev_name': bdev_name
     }
     if nbd_device:
         params['nbd_device'] = nbd_device
+    if num_connections:
+        params['num_connections'] = num_connections
+    if cpumask:
+        params['cpumask'] = cpumask
     return client.call('nbd_start_disk', params)
 
 
@@ -13,7 +13,7 @@ def ublk_destroy_target(client):
     return client.call('ublk_destroy_target')
 
 
-def ublk_start_disk(client, bdev_name, ublk_id=1, num_queues=1, queue_depth=128):
+def ublk_start_disk(client, bdev_name, ublk_id=1, num_queues=1, queue_depth=128, user_copy=None):
     params = {
         'bdev_name': bdev_name,
         'ublk_id': ublk_id
@@ -22,6 +22,8 @@ def ublk_start_disk(client, bdev_name, ublk_id=1, num_queues=1, queue_depth=128)
         params['num_queues'] = num_queues
     if queue_depth:
         params['queue_depth'] = queue_depth
+    if user_copy is not None:
+        params['user_copy'] = user_copy
     return client.call('ublk_start_disk', params)
 
 
@@ -100,6 +100,9 @@ def vhost_create_blk_controller(client, **params):
         readonly: set controller as read-only
         packed_ring: support controller packed_ring
         packed_ring_recovery: enable packed ring live recovery
+        event_idx: support VIRTIO_RING_F_EVENT_IDX to coalesce notifications
+        poll_idle_us: in interrupt mode, poll a kicked virtqueue until idle for this long (default: 0 - never poll)
+        num_queue_threads: number of threads the virtqueues of a session are spread over (default: 1)
     """
     strip_globals(params)
     remove_null(params)
@@ -493,6 +493,25 @@ if __name__ == "__main__":
     p.add_argument('name', help='aio bdev name')
     p.set_defaults(func=bdev_aio_delete)
 
+    def bdev_uring_set_options(args):
+        rpc.bdev.bdev_uring_set_options(args.client,
+                                        queue_depth=args.queue_depth,
+                                        fixed_files=args.fixed_files,
+                                        fixed_buffers=args.fixed_buffers,
+                                        sqpoll=args.sqpoll,
+                                        sq_thread_idle_ms=args.sq_thread_idle_ms)
+
+    p = subparsers.add_parser('bdev_uring_set_options', help='Set options for the uring bdev module')
+    p.add_argument('-q', '--queue-depth', help='Number of SQEs of each ring', type=int)
+    p.add_argument('--fixed-files', help='Register the files of the bdevs with the rings',
+                   action='store_true', default=None)
+    p.add_argument('--fixed-buffers', help='Register the SPDK memory as fixed buffers with the rings',
+                   action='store_true', default=None)
+    p.add_argument('--sqpoll', help='Let a kernel thread poll the SQ of each ring',
+                   action='store_true', default=None)
+    p.add_argument('--sq-thread-idle-ms', help='Idle time after which the SQ thread goes to sleep', type=int)
+    p.set_defaults(func=bdev_uring_set_options)
+
     def bdev_uring_create(args):
         print_json(rpc.bdev.bdev_uring_create(args.client,
                                               filename=args.filename,
@@ -560,7 +579,8 @@ if __name__ == "__main__":
                                        transport_tos=args.transport_tos,
                                        nvme_error_stat=args.nvme_error_stat,
                                        rdma_srq_size=args.rdma_srq_size,
-                                       io_path_stat=args.io_path_stat)
+                                       io_path_stat=args.io_path_stat,
+                                       sq_doorbell_max_delay_us=args.sq_doorbell_max_delay_us)
 
     p = subparsers.add_parser('bdev_nvme_set_options',
                               help='Set options for the bdev nvme type. This is startup command.')
@@ -638,6 +658,9 @@ if __name__ == "__main__":
     p.add_argument('--io-path-stat',
                    help="""Enable collecting I/O path stat of each io path.""",
                    action='store_true')
+    p.add_argument('--sq-doorbell-max-delay-us',
+                   help="""Enable adaptive coalescing of PCIe SQ doorbell writes, bounding the delay of a command
+                   to this many microseconds. Requires --disable-delay-cmd-submit. Default: 0 (disabled)""", type=int)
 
     p.set_defaults(func=bdev_nvme_set_options)
 
@@ -1304,7 +1327,8 @@ if __name__ == "__main__":
             max_r2t_per_connection=args.max_r2t_per_connection,
             pdu_pool_size=args.pdu_pool_size,
             immediate_data_pool_size=args.immediate_data_pool_size,
-            data_out_pool_size=args.data_out_pool_size)
+            data_out_pool_size=args.data_out_pool_size,
+            poll_group_rebalance_period_us=args.poll_group_rebalance_period_us)
 
     p = subparsers.add_parser('iscsi_set_options',
                               help="""Set options of iSCSI subsystem""")
@@ -1333,6 +1357,8 @@ if __name__ == "__main__":
     p.add_argument('-u', '--pdu-pool-size', help='Number of PDUs in the pool', type=int)
     p.add_argument('-j', '--immediate-data-pool-size', help='Number of immediate data buffers in the pool', type=int)
     p.add_argument('-z', '--data-out-pool-size', help='Number of data out buffers in the pool', type=int)
+    p.add_argument('-y', '--poll-group-rebalance-period-us', help="""Period in microseconds to move a target node
+    from the busiest to the least busy poll group. 0 disables it.""", type=int)
     p.set_defaults(func=iscsi_set_options)
 
     def iscsi_set_discovery_auth(args):
@@ -1998,6 +2024,39 @@ Format: 'user:u1 secret:s1 muser:mu1 msecret:ms1,user:u2 secret:s2 muser:mu2 mse
     p.add_argument('name', help='lvol bdev name')
     p.set_defaults(func=bdev_lvol_decouple_parent)
 
+    def bdev_lvol_reclaim_space(args):
+        rpc.lvol.bdev_lvol_reclaim_space(args.client,
+                                         name=args.name,
+                                         rate_limit_mb_per_sec=args.rate_limit_mb_per_sec)
+
+    p = subparsers.add_parser('bdev_lvol_reclaim_space',
+                              help='Release zeroed clusters of thin provisioned lvol in the background')
+    p.add_argument('name', help='lvol bdev name')
+    p.add_argument('-r', '--rate-limit-mb-per-sec', help='Maximum scan rate in MiB/s, 0 for no limit',
+                   type=int)
+    p.set_defaults(func=bdev_lvol_reclaim_space)
+
+    def bdev_lvol_get_reclaim_status(args):
+        print_json(rpc.lvol.bdev_lvol_get_reclaim_status(args.client,
+                                                         name=args.name))
+
+    p = subparsers.add_parser('bdev_lvol_get_reclaim_status', help='Display progress of lvol space reclamation')
+    p.add_argument('name', help='lvol bdev name')
+    p.set_defaults(func=bdev_lvol_get_reclaim_status)
+
+    def bdev_lvol_export_diff(args):
+        print_json(rpc.lvol.bdev_lvol_export_diff(args.client,
+                                                  name=args.name,
+                                                  target_bdev=args.target_bdev,
+                                                  base_name=args.base_name))
+
+    p = subparsers.add_parser('bdev_lvol_export_diff',
+                              help='Copy clusters of a snapshot changed since an older snapshot to a bdev')
+    p.add_argument('name', help='snapshot lvol bdev name')
+    p.add_argument('target_bdev', help='bdev to write the changed clusters to')
+    p.add_argument('-b', '--base-name', help='older snapshot lvol bdev name; all allocated clusters are copied if omitted')
+    p.set_defaults(func=bdev_lvol_export_diff)
+
     def bdev_lvol_resize(args):
         rpc.lvol.bdev_lvol_resize(args.client,
                                   name=args.name,
@@ -2116,7 +2175,9 @@ Format: 'user:u1 secret:s1 muser:mu1 msecret:ms1,user:u2 secret:s2 muser:mu2 mse
                                             overprovisioning=args.overprovisioning,
                                             l2p_dram_limit=args.l2p_dram_limit,
                                             core_mask=args.core_mask,
-                                            fast_shutdown=args.fast_shutdown))
+                                            fast_shutdown=args.fast_shutdown,
+                                            user_io_offload=args.user_io_offload,
+                                            gc_policy=args.gc_policy))
 
     p = subparsers.add_parser('bdev_ftl_create', help='Add FTL bdev')
     p.add_argument('-b', '--name', help="Name of the bdev", required=True)
@@ -2133,6 +2194,10 @@ Format: 'user:u1 secret:s1 muser:mu1 msecret:ms1,user:u2 secret:s2 muser:mu2 mse
     p.add_argument('--core-mask', help='CPU core mask - which cores will be used for ftl core thread, '
                    'by default core thread will be set to the main application core (optional)')
     p.add_argument('-f', '--fast-shutdown', help="Enable fast shutdown", action='store_true')
+    p.add_argument('--user-io-offload', help="Submit user data transfers from the IO channel threads",
+                   action='store_true')
+    p.add_argument('--gc-policy', help='Policy of picking bands for relocation (optional); default greedy',
+                   choices=['greedy', 'cost_benefit'])
     p.set_defaults(func=bdev_ftl_create)
 
     def bdev_ftl_load(args):
@@ -2144,7 +2209,9 @@ Format: 'user:u1 secret:s1 muser:mu1 msecret:ms1,user:u2 secret:s2 muser:mu2 mse
                                           overprovisioning=args.overprovisioning,
                                           l2p_dram_limit=args.l2p_dram_limit,
                                           core_mask=args.core_mask,
-                                          fast_shutdown=args.fast_shutdown))
+                                          fast_shutdown=args.fast_shutdown,
+                                          user_io_offload=args.user_io_offload,
+                                          gc_policy=args.gc_policy))
 
     p = subparsers.add_parser('bdev_ftl_load', help='Load FTL bdev')
     p.add_argument('-b', '--name', help="Name of the bdev", required=True)
@@ -2160,6 +2227,10 @@ Format: 'user:u1 secret:s1 muser:mu1 msecret:ms1,user:u2 secret:s2 muser:mu2 mse
     p.add_argument('--core-mask', help='CPU core mask - which cores will be used for ftl core thread, '
                    'by default core thread will be set to the main application core (optional)')
     p.add_argument('-f', '--fast-shutdown', help="Enable fast shutdown", action='store_true')
+    p.add_argument('--user-io-offload', help="Submit user data transfers from the IO channel threads",
+                   action='store_true')
+    p.add_argument('--gc-policy', help='Policy of picking bands for relocation (optional); default greedy',
+                   choices=['greedy', 'cost_benefit'])
     p.set_defaults(func=bdev_ftl_load)
 
     def bdev_ftl_unload(args):
@@ -2236,7 +2307,8 @@ Format: 'user:u1 secret:s1 muser:mu1 msecret:ms1,user:u2 secret:s2 muser:mu2 mse
                                        bdev_name=args.bdev_name,
                                        ublk_id=args.ublk_id,
                                        num_queues=args.num_queues,
-                                       queue_depth=args.queue_depth))
+                                       queue_depth=args.queue_depth,
+                                       user_copy=args.user_copy))
 
     p = subparsers.add_parser('ublk_start_disk',
                               help='Export a bdev as a ublk device')
@@ -2244,6 +2316,9 @@ Format: 'user:u1 secret:s1 muser:mu1 msecret:ms1,user:u2 secret:s2 muser:mu2 mse
     p.add_argument('ublk_id', help='ublk device id to be assigned. Example: 1.', type=int)
     p.add_argument('-q', '--num-queues', help="the total number of queues. Example: 1", type=int, required=False)
     p.add_argument('-d', '--queue-depth', help="queue depth. Example: 128", type=int, required=False)
+    p.add_argument('-u', '--user-copy', help='Copy the I/O data through the ublk char device instead of '
+                   'per-request bounce buffers. Falls back to bounce buffers on kernels older than 6.5.',
+                   action='store_true', default=None)
     p.set_defaults(func=ublk_start_disk)
 
     def ublk_stop_disk(args):
@@ -2268,12 +2343,17 @@ Format: 'user:u1 secret:s1 muser:mu1 msecret:ms1,user:u2 secret:s2 muser:mu2 mse
     def nbd_start_disk(args):
         print(rpc.nbd.nbd_start_disk(args.client,
                                      bdev_name=args.bdev_name,
-                                     nbd_device=args.nbd_device))
+                                     nbd_device=args.nbd_device,
+                                     num_connections=args.num_connections,
+                                     cpumask=args.cpumask))
 
     p = subparsers.add_parser('nbd_start_disk',
                               help='Export a bdev as an nbd disk')
     p.add_argument('bdev_name', help='Blockdev name to be exported. Example: Malloc0.')
     p.add_argument('nbd_device', help='Nbd device name to be assigned. Example: /dev/nbd0.', nargs='?')
+    p.add_argument('-n', '--num-connections', help='Number of connections to the kernel, each polled by its own thread',
+                   type=int, default=None)
+    p.add_argument('-m', '--cpumask', help='Cores to place the connection threads on. Example: 0xF.')
     p.set_defaults(func=nbd_start_disk)
 
     def nbd_stop_disk(args):
@@ -2707,6 +2787,12 @@ Format: 'user:u1 secret:s1 muser:mu1 msecret:ms1,user:u2 secret:s2 muser:mu2 mse
     p.add_argument("-r", "--readonly", action='store_true', help='Set controller as read-only')
     p.add_argument("-p", "--packed_ring", action='store_true', help='Set controller as packed ring supported')
     p.add_argument("-l", "--packed_ring_recovery", action='store_true', help='Enable packed ring live recovery')
+    p.add_argument("-e", "--event-idx", dest='event_idx', action='store_true',
+                   help='Support VIRTIO_RING_F_EVENT_IDX to coalesce guest notifications')
+    p.add_argument("-i", "--poll-idle-us", dest='poll_idle_us', type=int,
+                   help='In interrupt mode, poll a kicked virtqueue until it is idle for this many microseconds')
+    p.add_argument("-t", "--num-queue-threads", dest='num_queue_threads', type=int,
+                   help='Number of threads the virtqueues of a session are spread over (default: 1)')
     p.set_defaults(func=vhost_create_blk_controller)
 
     def vhost_get_controllers(args):
@@ -41,5 +41,19 @@ create_job "job2"
 create_job "job3"
 bdevperf_output=$($bdevperf -t 2 --json $jsonconf -j $testconf 2>&1)
 [[ $(get_num_jobs "$bdevperf_output") == "4" ]]
+
+cleanup
+#Test open-loop rates, including one that does not fit in an int, ramped in two steps.
+create_job "global" "randread" "Malloc0"
+create_job "job0"
+echo "rate=1000" >> $testconf
+create_job "job1"
+echo "rate=5000000000" >> $testconf
+bdevperf_output=$($bdevperf -t 2 -G 2 --json $jsonconf -j $testconf 2>&1)
+[[ $(get_num_jobs "$bdevperf_output") == "2" ]]
+grep -qE "Malloc0 +: +500 " <<< "$bdevperf_output"
+grep -qE "Malloc0 +: +1000 " <<< "$bdevperf_output"
+grep -qE "Malloc0 +: +2500000000 " <<< "$bdevperf_output"
+grep -qE "Malloc0 +: +5000000000 " <<< "$bdevperf_output"
 cleanup
 trap - SIGINT SIGTERM EXIT
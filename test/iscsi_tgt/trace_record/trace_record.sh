@@ -14,6 +14,11 @@ TRACE_TMP_FOLDER=./tmp-trace
 TRACE_RECORD_OUTPUT=${TRACE_TMP_FOLDER}/record.trace
 TRACE_RECORD_NOTICE_LOG=${TRACE_TMP_FOLDER}/record.notice
 TRACE_TOOL_LOG=${TRACE_TMP_FOLDER}/trace.log
+TRACE_STREAM_OUTPUT=${TRACE_TMP_FOLDER}/record.stream
+TRACE_STREAM_CONVERTED=${TRACE_TMP_FOLDER}/stream.trace
+TRACE_STREAM_NOTICE_LOG=${TRACE_TMP_FOLDER}/stream.notice
+TRACE_STREAM_CONVERT_LOG=${TRACE_TMP_FOLDER}/stream_convert.notice
+TRACE_STREAM_TOOL_LOG=${TRACE_TMP_FOLDER}/stream_trace.log
 
 delete_tmp_files() {
 	rm -rf $TRACE_TMP_FOLDER
@@ -55,6 +60,9 @@ mkdir -p ${TRACE_TMP_FOLDER}
 ./build/bin/spdk_trace_record -s iscsi -p ${iscsi_pid} -f ${TRACE_RECORD_OUTPUT} -q 1> ${TRACE_RECORD_NOTICE_LOG} &
 record_pid=$!
 echo "Trace record pid: $record_pid"
+./build/bin/spdk_trace_record -s iscsi -p ${iscsi_pid} -f ${TRACE_STREAM_OUTPUT} -S -q 1> ${TRACE_STREAM_NOTICE_LOG} &
+stream_record_pid=$!
+echo "Trace stream record pid: $stream_record_pid"
 
 RPCS=
 RPCS+="iscsi_create_portal_group $PORTAL_TAG $TARGET_IP:$ISCSI_PORT\n"
@@ -74,7 +82,7 @@ iscsiadm -m discovery -t sendtargets -p $TARGET_IP:$ISCSI_PORT
 iscsiadm -m node --login -p $TARGET_IP:$ISCSI_PORT
 waitforiscsidevices $((CONNECTION_NUMBER + 1))
 
-trap 'iscsicleanup; killprocess $iscsi_pid; killprocess $record_pid; delete_tmp_files; iscsitestfini; exit 1' SIGINT SIGTERM EXIT
+trap 'iscsicleanup; killprocess $iscsi_pid; killprocess $record_pid; killprocess $stream_record_pid; delete_tmp_files; iscsitestfini; exit 1' SIGINT SIGTERM EXIT
 
 echo "Running FIO"
 $fio_py -p iscsi -i 131072 -d 32 -t randrw -r 1
@@ -93,7 +101,10 @@ trap 'delete_tmp_files; iscsitestfini; exit 1' SIGINT SIGTERM EXIT
 
 killprocess $iscsi_pid
 killprocess $record_pid
+killprocess $stream_record_pid
 ./build/bin/spdk_trace -f ${TRACE_RECORD_OUTPUT} > ${TRACE_TOOL_LOG}
+./build/bin/spdk_trace_record -d ${TRACE_STREAM_OUTPUT} -f ${TRACE_STREAM_CONVERTED} -q > ${TRACE_STREAM_CONVERT_LOG}
+./build/bin/spdk_trace -f ${TRACE_STREAM_CONVERTED} > ${TRACE_STREAM_TOOL_LOG}
 
 #verify trace record and trace tool
 #trace entries str in trace-record, like "Trace Size of lcore (0): 4136"
@@ -102,6 +113,12 @@ record_num="$(grep "trace entries for lcore" ${TRACE_RECORD_NOTICE_LOG} | cut -d
 #trace entries str in trace-tool, like "Port 4096 trace entries for lcore (0) in 441871 msec"
 trace_tool_num="$(grep "Trace Size of lcore" ${TRACE_TOOL_LOG} | cut -d ' ' -f 6)"
 
+#same for the streaming mode, both when recording and when converting the stream file
+stream_record_num="$(grep "trace entries for lcore" ${TRACE_STREAM_NOTICE_LOG} | cut -d ' ' -f 2)"
+stream_convert_num="$(grep "trace entries for lcore" ${TRACE_STREAM_CONVERT_LOG} | cut -d ' ' -f 2)"
+stream_tool_num="$(grep "Trace Size of lcore" ${TRACE_STREAM_TOOL_LOG} | cut -d ' ' -f 6)"
+stream_dropped="$(grep -c "Dropped" ${TRACE_STREAM_NOTICE_LOG} || true)"
+
 delete_tmp_files
 
 echo "entries numbers from trace record are:" $record_num
@@ -132,5 +149,33 @@ for i in $(seq 0 $((len_arr_record_num - 1))); do
 	fi
 done
 
+echo "entries numbers from trace stream record are:" $stream_record_num
+echo "entries numbers from trace tool on the converted stream are:" $stream_tool_num
+
+#the streaming mode drains the buffers as they fill, it's not supposed to lose any entries
+if [ "$stream_dropped" -ne 0 ]; then
+	echo "trace record test on iscsi: streaming mode dropped trace entries"
+	set -e
+	exit 1
+fi
+if [ "$stream_record_num" != "$stream_convert_num" ] || [ "$stream_record_num" != "$stream_tool_num" ]; then
+	echo "trace record test on iscsi: failure on stream entries number check"
+	set -e
+	exit 1
+fi
+arr_stream_record_num=($stream_record_num)
+if [ ${#arr_stream_record_num[@]} -ne $len_arr_record_num ]; then
+	echo "trace record test on iscsi: failure on stream lcore number check"
+	set -e
+	exit 1
+fi
+for i in $(seq 0 $((len_arr_record_num - 1))); do
+	if [ ${arr_stream_record_num[$i]} -le ${NUM_TRACE_ENTRIES} ]; then
+		echo "trace record test on iscsi: failure on inefficient stream entries number check"
+		set -e
+		exit 1
+	fi
+done
+
 trap - SIGINT SIGTERM EXIT
 iscsitestfini
@@ -0,0 +1,220 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (C) 2023 Intel Corporation.
+ *   All rights reserved.
+ */
+
+#include "spdk/stdinc.h"
+
+#include "spdk_cunit.h"
+
+#include "bdev/bdevperf/bdevperf_replay.c"
+
+static char g_path[] = "/tmp/bdevperf_replay_ut.XXXXXX";
+
+static int
+ut_load(struct bdevperf_replay_trace *trace, const char *content)
+{
+	int fd;
+
+	strcpy(g_path + strlen(g_path) - 6, "XXXXXX");
+	fd = mkstemp(g_path);
+	SPDK_CU_ASSERT_FATAL(fd >= 0);
+	SPDK_CU_ASSERT_FATAL(write(fd, content, strlen(content)) == (ssize_t)strlen(content));
+	close(fd);
+
+	memset(trace, 0, sizeof(*trace));
+	return bdevperf_replay_load(trace, g_path);
+}
+
+static void
+ut_cleanup(struct bdevperf_replay_trace *trace)
+{
+	unlink(g_path);
+	free(trace->records);
+	memset(trace, 0, sizeof(*trace));
+}
+
+static void
+ut_check_record(struct bdevperf_replay_trace *trace, uint64_t i, uint64_t time_in_usec,
+		enum bdevperf_replay_op op, uint64_t offset, uint64_t length)
+{
+	SPDK_CU_ASSERT_FATAL(i < trace->num_records);
+	CU_ASSERT_EQUAL(trace->records[i].time_in_usec, time_in_usec);
+	CU_ASSERT_EQUAL(trace->records[i].op, op);
+	CU_ASSERT_EQUAL(trace->records[i].offset, offset);
+	CU_ASSERT_EQUAL(trace->records[i].length, length);
+}
+
+static void
+test_load_plain(void)
+{
+	struct bdevperf_replay_trace trace;
+	int rc;
+
+	rc = ut_load(&trace,
+		     "# time op offset length\n"
+		     "\n"
+		     "100.5 read 0 4096\n"
+		     "150 write 8192 16384\n"
+		     "200 trim 4096 65536\n"
+		     "250 flush\n"
+		     "300 RA 12288 512\n"
+		     "350 WS 0 8192\n"
+		     "400 FWS 0 4096\n"
+		     "450 D 0 1024\n"
+		     "500 N 0 0\n");
+	CU_ASSERT_EQUAL(rc, 0);
+	CU_ASSERT_EQUAL(trace.num_records, 8);
+
+	/* Times are relative to the first record, "N" (no data) isn't an I/O */
+	ut_check_record(&trace, 0, 0, BDEVPERF_REPLAY_OP_READ, 0, 4096);
+	ut_check_record(&trace, 1, 50, BDEVPERF_REPLAY_OP_WRITE, 8192, 16384);
+	ut_check_record(&trace, 2, 100, BDEVPERF_REPLAY_OP_UNMAP, 4096, 65536);
+	ut_check_record(&trace, 3, 150, BDEVPERF_REPLAY_OP_FLUSH, 0, 0);
+	ut_check_record(&trace, 4, 200, BDEVPERF_REPLAY_OP_READ, 12288, 512);
+	ut_check_record(&trace, 5, 250, BDEVPERF_REPLAY_OP_WRITE, 0, 8192);
+	ut_check_record(&trace, 6, 300, BDEVPERF_REPLAY_OP_FLUSH, 0, 4096);
+	ut_check_record(&trace, 7, 350, BDEVPERF_REPLAY_OP_UNMAP, 0, 1024);
+
+	/* Only reads and writes size the data buffers */
+	CU_ASSERT_EQUAL(trace.max_length, 16384);
+	CU_ASSERT_EQUAL(trace.total_length, 4096 + 16384 + 65536 + 512 + 8192 + 4096 + 1024);
+
+	ut_cleanup(&trace);
+}
+
+static void
+test_load_fio(void)
+{
+	struct bdevperf_replay_trace trace;
+	int rc;
+
+	/* Version 2 is timed by the wait actions */
+	rc = ut_load(&trace,
+		     "fio version 2 iolog\n"
+		     "/dev/nvme0n1 add\n"
+		     "/dev/nvme0n1 open\n"
+		     "/dev/nvme0n1 read 0 4096\n"
+		     "/dev/nvme0n1 wait 1000\n"
+		     "/dev/nvme0n1 write 4096 4096\n"
+		     "/dev/nvme0n1 wait 500\n"
+		     "/dev/nvme0n1 trim 8192 8192\n"
+		     "/dev/nvme0n1 sync 0 0\n"
+		     "/dev/nvme0n1 close\n");
+	CU_ASSERT_EQUAL(rc, 0);
+	CU_ASSERT_EQUAL(trace.num_records, 4);
+	ut_check_record(&trace, 0, 0, BDEVPERF_REPLAY_OP_READ, 0, 4096);
+	ut_check_record(&trace, 1, 1000, BDEVPERF_REPLAY_OP_WRITE, 4096, 4096);
+	ut_check_record(&trace, 2, 1500, BDEVPERF_REPLAY_OP_UNMAP, 8192, 8192);
+	ut_check_record(&trace, 3, 1500, BDEVPERF_REPLAY_OP_FLUSH, 0, 0);
+	ut_cleanup(&trace);
+
+	/* Version 3 has timestamps in msec */
+	rc = ut_load(&trace,
+		     "fio version 3 iolog\n"
+		     "0 /dev/nvme0n1 add\n"
+		     "2 /dev/nvme0n1 open\n"
+		     "5 /dev/nvme0n1 write 0 8192\n"
+		     "7 /dev/nvme0n1 read 8192 4096\n"
+		     "12 /dev/nvme0n1 datasync 0 0\n"
+		     "13 /dev/nvme0n1 close\n");
+	CU_ASSERT_EQUAL(rc, 0);
+	CU_ASSERT_EQUAL(trace.num_records, 3);
+	ut_check_record(&trace, 0, 0, BDEVPERF_REPLAY_OP_WRITE, 0, 8192);
+	ut_check_record(&trace, 1, 2000, BDEVPERF_REPLAY_OP_READ, 8192, 4096);
+	ut_check_record(&trace, 2, 7000, BDEVPERF_REPLAY_OP_FLUSH, 0, 0);
+	ut_cleanup(&trace);
+}
+
+static void
+test_load_many(void)
+{
+	struct bdevperf_replay_trace trace;
+	char *content, *pos;
+	uint64_t i, num_records = 3000;
+	int rc;
+
+	content = calloc(num_records, 64);
+	SPDK_CU_ASSERT_FATAL(content != NULL);
+
+	/* Enough records to grow the array a few times */
+	pos = content;
+	for (i = 0; i < num_records; i++) {
+		pos += sprintf(pos, "%" PRIu64 " %s %" PRIu64 " 4096\n", i + 10,
+			       i % 2 ? "write" : "read", i * 4096);
+	}
+
+	rc = ut_load(&trace, content);
+	CU_ASSERT_EQUAL(rc, 0);
+	CU_ASSERT_EQUAL(trace.num_records, num_records);
+	CU_ASSERT(trace.max_records >= num_records);
+	for (i = 0; i < num_records; i++) {
+		ut_check_record(&trace, i, i, i % 2 ? BDEVPERF_REPLAY_OP_WRITE : BDEVPERF_REPLAY_OP_READ,
+				i * 4096, 4096);
+	}
+	CU_ASSERT_EQUAL(trace.max_length, 4096);
+	CU_ASSERT_EQUAL(trace.total_length, num_records * 4096);
+
+	ut_cleanup(&trace);
+	free(content);
+}
+
+static void
+test_load_invalid(void)
+{
+	struct bdevperf_replay_trace trace;
+	const char *invalid[] = {
+		/* Missing length */
+		"0 read 0 4096\n"
+		"10 write 4096\n",
+		/* Unsupported fio version */
+		"fio version 1 iolog\n"
+		"/dev/nvme0n1 read 0 4096\n",
+		/* No op */
+		"0 read 0 4096\n"
+		"10\n",
+		/* No I/O at all */
+		"# nothing\n"
+		"0 N 0 0\n",
+	};
+	uint32_t i;
+	int rc;
+
+	for (i = 0; i < SPDK_COUNTOF(invalid); i++) {
+		rc = ut_load(&trace, invalid[i]);
+		CU_ASSERT_EQUAL(rc, -EINVAL);
+		/* The records parsed before the error are freed */
+		CU_ASSERT_PTR_NULL(trace.records);
+		CU_ASSERT_EQUAL(trace.num_records, 0);
+		CU_ASSERT_EQUAL(trace.max_length, 0);
+		ut_cleanup(&trace);
+	}
+
+	memset(&trace, 0, sizeof(trace));
+	rc = bdevperf_replay_load(&trace, "/tmp/bdevperf_replay_ut.nonexistent");
+	CU_ASSERT_EQUAL(rc, -ENOENT);
+	CU_ASSERT_PTR_NULL(trace.records);
+}
+
+int
+main(int argc, char **argv)
+{
+	CU_pSuite suite = NULL;
+	unsigned int num_failures;
+
+	CU_set_error_action(CUEA_ABORT);
+	CU_initialize_registry();
+
+	suite = CU_add_suite("bdevperf_replay", NULL, NULL);
+	CU_ADD_TEST(suite, test_load_plain);
+	CU_ADD_TEST(suite, test_load_fio);
+	CU_ADD_TEST(suite, test_load_many);
+	CU_ADD_TEST(suite, test_load_invalid);
+
+	CU_basic_set_mode(CU_BRM_VERBOSE);
+	CU_basic_run_tests();
+	num_failures = CU_get_number_of_failures();
+	CU_cleanup_registry();
+
+	return num_failures;
+}
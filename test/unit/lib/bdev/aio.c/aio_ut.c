@@ -0,0 +1,391 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (C) 2023 Intel Corporation.
+ *   All rights reserved.
+ */
+
+#include "spdk/stdinc.h"
+
+#include "spdk_internal/mock.h"
+
+#include "spdk_cunit.h"
+
+#include "common/lib/ut_multithread.c"
+#include "unit/lib/json_mock.c"
+#include "bdev/aio/bdev_aio.c"
+
+DEFINE_STUB_V(spdk_bdev_module_list_add, (struct spdk_bdev_module *bdev_module));
+DEFINE_STUB(spdk_bdev_register, int, (struct spdk_bdev *bdev), 0);
+DEFINE_STUB_V(spdk_bdev_unregister, (struct spdk_bdev *bdev, spdk_bdev_unregister_cb cb_fn,
+				     void *cb_arg));
+DEFINE_STUB(spdk_bdev_unregister_by_name, int, (const char *bdev_name,
+		struct spdk_bdev_module *module, spdk_bdev_unregister_cb cb_fn, void *cb_arg), 0);
+DEFINE_STUB_V(spdk_bdev_destruct_done, (struct spdk_bdev *bdev, int bdeverrno));
+DEFINE_STUB_V(spdk_bdev_io_get_buf, (struct spdk_bdev_io *bdev_io, spdk_bdev_io_get_buf_cb cb,
+				     uint64_t len));
+DEFINE_STUB(spdk_bdev_get_name, const char *, (const struct spdk_bdev *bdev), "aio");
+DEFINE_STUB(spdk_bdev_open_ext, int, (const char *bdev_name, bool write,
+				      spdk_bdev_event_cb_t event_cb, void *event_ctx,
+				      struct spdk_bdev_desc **desc), -ENODEV);
+DEFINE_STUB_V(spdk_bdev_close, (struct spdk_bdev_desc *desc));
+DEFINE_STUB(spdk_bdev_desc_get_bdev, struct spdk_bdev *, (struct spdk_bdev_desc *desc), NULL);
+DEFINE_STUB(spdk_bdev_notify_blockcnt_change, int, (struct spdk_bdev *bdev, uint64_t size), 0);
+DEFINE_STUB(spdk_fd_get_size, uint64_t, (int fd), 0);
+DEFINE_STUB(spdk_fd_get_blocklen, uint32_t, (int fd), 0);
+DEFINE_STUB(io_destroy, int, (io_context_t ctx), 0);
+
+#define UT_RING_SIZE		(SPDK_AIO_QUEUE_DEPTH * 2)
+#define UT_MAX_SUBMIT_CALLS	8
+#define UT_IO_SIZE		4096
+
+/* The completion ring the kernel shares with the user space */
+static struct {
+	struct spdk_aio_ring	hdr;
+	struct io_event		events[UT_RING_SIZE];
+} g_ring;
+
+/* Return values of the next io_submit() calls, the calls past them accept all the iocbs */
+static int g_io_submit_rc[UT_MAX_SUBMIT_CALLS];
+static uint32_t g_io_submit_num_rc;
+static uint32_t g_io_submit_calls;
+static uint32_t g_io_getevents_calls;
+
+int
+io_setup(int maxevents, io_context_t *ctxp)
+{
+	*ctxp = (io_context_t)&g_ring;
+
+	return 0;
+}
+
+int
+io_submit(io_context_t ctx, long nr, struct iocb *ios[])
+{
+	CU_ASSERT(nr > 0);
+
+	if (g_io_submit_calls < g_io_submit_num_rc) {
+		return g_io_submit_rc[g_io_submit_calls++];
+	}
+
+	g_io_submit_calls++;
+	return nr;
+}
+
+int
+io_getevents(io_context_t ctx_id, long min_nr, long nr, struct io_event *events,
+	     struct timespec *timeout)
+{
+	g_io_getevents_calls++;
+
+	return 0;
+}
+
+void
+spdk_bdev_io_complete(struct spdk_bdev_io *bdev_io, enum spdk_bdev_io_status status)
+{
+	bdev_io->internal.status = status;
+}
+
+void
+spdk_bdev_io_complete_aio_status(struct spdk_bdev_io *bdev_io, int aio_result)
+{
+	bdev_io->internal.status = SPDK_BDEV_IO_STATUS_AIO_ERROR;
+	bdev_io->internal.error.aio_result = aio_result;
+}
+
+static struct file_disk *g_fdisk;
+static struct spdk_io_channel *g_ch;
+static struct bdev_aio_io_channel *g_aio_ch;
+
+static void
+ut_init(void)
+{
+	memset(&g_ring, 0, sizeof(g_ring));
+	g_ring.hdr.version = SPDK_AIO_RING_VERSION;
+	g_ring.hdr.size = UT_RING_SIZE;
+	g_ring.hdr.header_length = sizeof(g_ring.hdr);
+	g_io_submit_num_rc = 0;
+	g_io_submit_calls = 0;
+	g_io_getevents_calls = 0;
+
+	allocate_threads(1);
+	set_thread(0);
+	bdev_aio_initialize();
+
+	g_fdisk = calloc(1, sizeof(*g_fdisk));
+	SPDK_CU_ASSERT_FATAL(g_fdisk != NULL);
+	g_fdisk->fd = -1;
+	spdk_io_device_register(g_fdisk, bdev_aio_create_cb, bdev_aio_destroy_cb,
+				sizeof(struct bdev_aio_io_channel), "aio_ut");
+	g_ch = spdk_get_io_channel(g_fdisk);
+	SPDK_CU_ASSERT_FATAL(g_ch != NULL);
+	g_aio_ch = spdk_io_channel_get_ctx(g_ch);
+}
+
+static void
+ut_fini(void)
+{
+	spdk_put_io_channel(g_ch);
+	poll_threads();
+	spdk_io_device_unregister(g_fdisk, NULL);
+	bdev_aio_fini();
+	poll_threads();
+	free(g_fdisk);
+	free_threads();
+}
+
+static struct spdk_bdev_io *
+ut_alloc_io(void)
+{
+	struct spdk_bdev_io *bdev_io;
+
+	bdev_io = calloc(1, sizeof(*bdev_io) + sizeof(struct bdev_aio_task));
+	SPDK_CU_ASSERT_FATAL(bdev_io != NULL);
+	bdev_io->internal.status = SPDK_BDEV_IO_STATUS_PENDING;
+
+	return bdev_io;
+}
+
+static struct bdev_aio_task *
+ut_task(struct spdk_bdev_io *bdev_io)
+{
+	return (struct bdev_aio_task *)bdev_io->driver_ctx;
+}
+
+static void
+ut_read(struct spdk_bdev_io *bdev_io)
+{
+	static struct iovec iov = { .iov_len = UT_IO_SIZE };
+
+	bdev_aio_readv(g_fdisk, g_ch, ut_task(bdev_io), &iov, 1, UT_IO_SIZE, 0);
+}
+
+static void
+ut_complete(struct spdk_bdev_io *bdev_io)
+{
+	struct io_event *event = &g_ring.events[g_ring.hdr.tail];
+
+	event->data = ut_task(bdev_io);
+	event->res = UT_IO_SIZE;
+	g_ring.hdr.tail = (g_ring.hdr.tail + 1) % UT_RING_SIZE;
+}
+
+static void
+test_submit_batch(void)
+{
+	struct spdk_bdev_io *bdev_io[4];
+	uint32_t i;
+
+	ut_init();
+
+	/* The requests are only queued, the poller submits them all at once */
+	for (i = 0; i < SPDK_COUNTOF(bdev_io); i++) {
+		bdev_io[i] = ut_alloc_io();
+		ut_read(bdev_io[i]);
+	}
+	CU_ASSERT_EQUAL(g_io_submit_calls, 0);
+	CU_ASSERT_EQUAL(g_aio_ch->num_pending, 4);
+	CU_ASSERT_EQUAL(g_aio_ch->io_inflight, 0);
+
+	poll_threads();
+	CU_ASSERT_EQUAL(g_io_submit_calls, 1);
+	CU_ASSERT_EQUAL(g_aio_ch->num_pending, 0);
+	CU_ASSERT_EQUAL(g_aio_ch->io_inflight, 4);
+	CU_ASSERT_EQUAL(g_fdisk->stat.io_submit_calls, 1);
+	CU_ASSERT_EQUAL(g_fdisk->stat.iocbs_submitted, 4);
+
+	for (i = 0; i < SPDK_COUNTOF(bdev_io); i++) {
+		ut_complete(bdev_io[i]);
+	}
+	poll_threads();
+	CU_ASSERT_EQUAL(g_aio_ch->io_inflight, 0);
+	for (i = 0; i < SPDK_COUNTOF(bdev_io); i++) {
+		CU_ASSERT_EQUAL(bdev_io[i]->internal.status, SPDK_BDEV_IO_STATUS_SUCCESS);
+		free(bdev_io[i]);
+	}
+
+	/* An idle channel doesn't look for completions, which would take a syscall here */
+	g_ring.hdr.version = 0;
+	CU_ASSERT_EQUAL(bdev_aio_io_channel_poll(g_aio_ch), 0);
+	CU_ASSERT_EQUAL(g_io_getevents_calls, 0);
+	g_aio_ch->io_inflight = 1;
+	CU_ASSERT_EQUAL(bdev_aio_io_channel_poll(g_aio_ch), 0);
+	CU_ASSERT_EQUAL(g_io_getevents_calls, 1);
+	g_aio_ch->io_inflight = 0;
+	g_ring.hdr.version = SPDK_AIO_RING_VERSION;
+
+	ut_fini();
+}
+
+static void
+test_submit_partial(void)
+{
+	struct spdk_bdev_io *bdev_io[5];
+	uint32_t i;
+
+	ut_init();
+
+	for (i = 0; i < SPDK_COUNTOF(bdev_io); i++) {
+		bdev_io[i] = ut_alloc_io();
+		ut_read(bdev_io[i]);
+	}
+
+	/* Two accepted, the third rejected, the fourth accepted and the context full for the fifth */
+	g_io_submit_rc[0] = 2;
+	g_io_submit_rc[1] = -EIO;
+	g_io_submit_rc[2] = 1;
+	g_io_submit_rc[3] = -EAGAIN;
+	g_io_submit_num_rc = 4;
+
+	CU_ASSERT_EQUAL(bdev_aio_io_channel_poll(g_aio_ch), 5);
+	CU_ASSERT_EQUAL(g_io_submit_calls, 4);
+	CU_ASSERT_EQUAL(g_aio_ch->num_pending, 0);
+	CU_ASSERT_EQUAL(g_aio_ch->io_inflight, 3);
+	CU_ASSERT_EQUAL(g_fdisk->stat.io_submit_calls, 4);
+	CU_ASSERT_EQUAL(g_fdisk->stat.iocbs_submitted, 3);
+
+	CU_ASSERT_EQUAL(bdev_io[0]->internal.status, SPDK_BDEV_IO_STATUS_PENDING);
+	CU_ASSERT_EQUAL(bdev_io[1]->internal.status, SPDK_BDEV_IO_STATUS_PENDING);
+	CU_ASSERT_EQUAL(bdev_io[2]->internal.status, SPDK_BDEV_IO_STATUS_AIO_ERROR);
+	CU_ASSERT_EQUAL(bdev_io[2]->internal.error.aio_result, -EIO);
+	CU_ASSERT_EQUAL(bdev_io[3]->internal.status, SPDK_BDEV_IO_STATUS_PENDING);
+	CU_ASSERT_EQUAL(bdev_io[4]->internal.status, SPDK_BDEV_IO_STATUS_NOMEM);
+
+	ut_complete(bdev_io[0]);
+	ut_complete(bdev_io[1]);
+	ut_complete(bdev_io[3]);
+	poll_threads();
+	CU_ASSERT_EQUAL(g_aio_ch->io_inflight, 0);
+
+	/* The stats can be reset */
+	bdev_aio_reset_device_stat(g_fdisk);
+	CU_ASSERT_EQUAL(g_fdisk->stat.io_submit_calls, 0);
+	CU_ASSERT_EQUAL(g_fdisk->stat.iocbs_submitted, 0);
+
+	for (i = 0; i < SPDK_COUNTOF(bdev_io); i++) {
+		free(bdev_io[i]);
+	}
+
+	ut_fini();
+}
+
+static void
+test_submit_full_queue(void)
+{
+	struct spdk_bdev_io *bdev_io[SPDK_AIO_QUEUE_DEPTH];
+	uint32_t i;
+
+	ut_init();
+
+	/* A full queue is flushed without waiting for the poller */
+	for (i = 0; i < SPDK_AIO_QUEUE_DEPTH; i++) {
+		bdev_io[i] = ut_alloc_io();
+		ut_read(bdev_io[i]);
+		CU_ASSERT_EQUAL(g_io_submit_calls, i == SPDK_AIO_QUEUE_DEPTH - 1 ? 1 : 0);
+	}
+	CU_ASSERT_EQUAL(g_aio_ch->num_pending, 0);
+	CU_ASSERT_EQUAL(g_aio_ch->io_inflight, SPDK_AIO_QUEUE_DEPTH);
+
+	for (i = 0; i < SPDK_AIO_QUEUE_DEPTH; i++) {
+		ut_complete(bdev_io[i]);
+	}
+	poll_threads();
+	CU_ASSERT_EQUAL(g_aio_ch->io_inflight, 0);
+
+	/* In interrupt mode, there's no poller to wait for */
+	g_aio_ch->group_ch->efd = 0;
+	bdev_aio_queue_task(g_aio_ch, ut_task(bdev_io[0]));
+	CU_ASSERT_EQUAL(g_io_submit_calls, 2);
+	CU_ASSERT_EQUAL(g_aio_ch->num_pending, 0);
+	CU_ASSERT_EQUAL(g_aio_ch->io_inflight, 1);
+	g_aio_ch->group_ch->efd = -1;
+	ut_complete(bdev_io[0]);
+	poll_threads();
+
+	for (i = 0; i < SPDK_AIO_QUEUE_DEPTH; i++) {
+		free(bdev_io[i]);
+	}
+
+	ut_fini();
+}
+
+static int g_get_io_inflight_status;
+
+static void
+ut_get_io_inflight_done(struct spdk_io_channel_iter *i, int status)
+{
+	g_get_io_inflight_status = status;
+}
+
+static void
+test_reset(void)
+{
+	struct spdk_bdev_io *bdev_io, *reset_io;
+
+	ut_init();
+
+	bdev_io = ut_alloc_io();
+	reset_io = ut_alloc_io();
+
+	/* Nothing queued nor in flight */
+	g_get_io_inflight_status = 1;
+	spdk_for_each_channel(g_fdisk, _bdev_aio_get_io_inflight, NULL, ut_get_io_inflight_done);
+	poll_threads();
+	CU_ASSERT_EQUAL(g_get_io_inflight_status, 0);
+
+	/* A queued request, not submitted yet, counts as outstanding too */
+	ut_read(bdev_io);
+	CU_ASSERT_EQUAL(g_aio_ch->num_pending, 1);
+	CU_ASSERT_EQUAL(g_aio_ch->io_inflight, 0);
+	spdk_for_each_channel(g_fdisk, _bdev_aio_get_io_inflight, NULL, ut_get_io_inflight_done);
+	poll_threads();
+	CU_ASSERT_EQUAL(g_get_io_inflight_status, -1);
+
+	/* Once submitted, it's in flight and holds the reset off */
+	CU_ASSERT_EQUAL(g_aio_ch->num_pending, 0);
+	CU_ASSERT_EQUAL(g_aio_ch->io_inflight, 1);
+	bdev_aio_reset(g_fdisk, ut_task(reset_io));
+	poll_threads();
+	CU_ASSERT_EQUAL(reset_io->internal.status, SPDK_BDEV_IO_STATUS_PENDING);
+	CU_ASSERT_PTR_NOT_NULL(g_fdisk->reset_retry_timer);
+	spdk_delay_us(500);
+	poll_threads();
+	CU_ASSERT_EQUAL(reset_io->internal.status, SPDK_BDEV_IO_STATUS_PENDING);
+
+	/* The reset completes on the next retry after the request */
+	ut_complete(bdev_io);
+	poll_threads();
+	CU_ASSERT_EQUAL(bdev_io->internal.status, SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT_EQUAL(reset_io->internal.status, SPDK_BDEV_IO_STATUS_PENDING);
+	spdk_delay_us(500);
+	poll_threads();
+	CU_ASSERT_EQUAL(reset_io->internal.status, SPDK_BDEV_IO_STATUS_SUCCESS);
+	CU_ASSERT_PTR_NULL(g_fdisk->reset_retry_timer);
+
+	free(bdev_io);
+	free(reset_io);
+
+	ut_fini();
+}
+
+int
+main(int argc, char **argv)
+{
+	CU_pSuite suite = NULL;
+	unsigned int num_failures;
+
+	CU_set_error_action(CUEA_ABORT);
+	CU_initialize_registry();
+
+	suite = CU_add_suite("aio", NULL, NULL);
+	CU_ADD_TEST(suite, test_submit_batch);
+	CU_ADD_TEST(suite, test_submit_partial);
+	CU_ADD_TEST(suite, test_submit_full_queue);
+	CU_ADD_TEST(suite, test_reset);
+
+	CU_basic_set_mode(CU_BRM_VERBOSE);
+	CU_basic_run_tests();
+	num_failures = CU_get_number_of_failures();
+	CU_cleanup_registry();
+
+	return num_failures;
+}
@@ -0,0 +1,288 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (C) 2023 Intel Corporation.
+ *   All rights reserved.
+ */
+
+#include "spdk/stdinc.h"
+
+#include "spdk_internal/mock.h"
+
+#include "spdk_cunit.h"
+
+#include "common/lib/test_env.c"
+#include "unit/lib/json_mock.c"
+#include "bdev/uring/bdev_uring.c"
+
+DEFINE_STUB_V(spdk_bdev_module_list_add, (struct spdk_bdev_module *bdev_module));
+DEFINE_STUB(spdk_bdev_register, int, (struct spdk_bdev *bdev), 0);
+DEFINE_STUB_V(spdk_bdev_unregister, (struct spdk_bdev *bdev, spdk_bdev_unregister_cb cb_fn,
+				     void *cb_arg));
+DEFINE_STUB(spdk_bdev_unregister_by_name, int, (const char *bdev_name,
+		struct spdk_bdev_module *module, spdk_bdev_unregister_cb cb_fn, void *cb_arg), 0);
+DEFINE_STUB_V(spdk_bdev_destruct_done, (struct spdk_bdev *bdev, int bdeverrno));
+DEFINE_STUB_V(spdk_bdev_io_complete, (struct spdk_bdev_io *bdev_io,
+				      enum spdk_bdev_io_status status));
+DEFINE_STUB_V(spdk_bdev_io_get_buf, (struct spdk_bdev_io *bdev_io, spdk_bdev_io_get_buf_cb cb,
+				     uint64_t len));
+DEFINE_STUB(spdk_bdev_io_get_io_channel, struct spdk_io_channel *,
+	    (struct spdk_bdev_io *bdev_io), NULL);
+DEFINE_STUB(spdk_bdev_get_name, const char *, (const struct spdk_bdev *bdev), "uring");
+DEFINE_STUB(spdk_mem_map_alloc, struct spdk_mem_map *, (uint64_t default_translation,
+		const struct spdk_mem_map_ops *ops, void *cb_ctx), NULL);
+DEFINE_STUB_V(spdk_mem_map_free, (struct spdk_mem_map **pmap));
+DEFINE_STUB(spdk_fd_get_size, uint64_t, (int fd), 0);
+DEFINE_STUB(spdk_fd_get_blocklen, uint32_t, (int fd), 0);
+DEFINE_STUB(io_uring_queue_init_params, int, (unsigned entries, struct io_uring *ring,
+		struct io_uring_params *p), 0);
+DEFINE_STUB_V(io_uring_queue_exit, (struct io_uring *ring));
+DEFINE_STUB(io_uring_submit, int, (struct io_uring *ring), 0);
+DEFINE_STUB(io_uring_register_files, int, (struct io_uring *ring, const int *files,
+		unsigned nr_files), 0);
+DEFINE_STUB(io_uring_register_files_update, int, (struct io_uring *ring, unsigned off,
+		const int *files, unsigned nr_files), 0);
+DEFINE_STUB(__io_uring_get_cqe, int, (struct io_uring *ring, struct io_uring_cqe **cqe_ptr,
+				      unsigned submit, unsigned wait_nr, sigset_t *sigmask), 0);
+
+#define UT_MAX_TRANSLATIONS 16
+
+/* The mem map only has to remember the translations of a few regions */
+static struct {
+	uint64_t	vaddr;
+	uint64_t	size;
+	uint64_t	translation;
+} g_translations[UT_MAX_TRANSLATIONS];
+static uint32_t g_num_translations;
+
+int
+spdk_mem_map_set_translation(struct spdk_mem_map *map, uint64_t vaddr, uint64_t size,
+			     uint64_t translation)
+{
+	SPDK_CU_ASSERT_FATAL(g_num_translations < UT_MAX_TRANSLATIONS);
+	g_translations[g_num_translations].vaddr = vaddr;
+	g_translations[g_num_translations].size = size;
+	g_translations[g_num_translations].translation = translation;
+	g_num_translations++;
+
+	return 0;
+}
+
+int
+spdk_mem_map_clear_translation(struct spdk_mem_map *map, uint64_t vaddr, uint64_t size)
+{
+	uint32_t i;
+
+	for (i = 0; i < g_num_translations; i++) {
+		if (g_translations[i].vaddr >= vaddr && g_translations[i].vaddr < vaddr + size) {
+			g_translations[i].translation = 0;
+		}
+	}
+
+	return 0;
+}
+
+uint64_t
+spdk_mem_map_translate(const struct spdk_mem_map *map, uint64_t vaddr, uint64_t *size)
+{
+	uint32_t i;
+
+	for (i = 0; i < g_num_translations; i++) {
+		if (vaddr >= g_translations[i].vaddr &&
+		    vaddr < g_translations[i].vaddr + g_translations[i].size) {
+			*size = spdk_min(*size, g_translations[i].vaddr + g_translations[i].size - vaddr);
+			return g_translations[i].translation;
+		}
+	}
+
+	return 0;
+}
+
+static struct iovec g_registered_iovs[SPDK_URING_MAX_BUFFERS];
+static unsigned g_num_registered_iovs;
+static int g_register_buffers_rc;
+
+int
+io_uring_register_buffers(struct io_uring *ring, const struct iovec *iovecs, unsigned nr_iovecs)
+{
+	g_num_registered_iovs = nr_iovecs;
+	memcpy(g_registered_iovs, iovecs, nr_iovecs * sizeof(*iovecs));
+
+	return g_register_buffers_rc;
+}
+
+static void
+ut_reset_buffers(void)
+{
+	memset(g_uring_buffers, 0, sizeof(g_uring_buffers));
+	g_uring_num_buffers = 0;
+	memset(g_translations, 0, sizeof(g_translations));
+	g_num_translations = 0;
+	g_num_registered_iovs = 0;
+	g_register_buffers_rc = 0;
+}
+
+static void
+ut_ring_fini(struct bdev_uring_ring *ring)
+{
+	ring->initialized = true;
+	bdev_uring_ring_fini(ring);
+}
+
+static int
+ut_get_buf_index(struct bdev_uring_ring *ring, uint64_t addr, size_t len)
+{
+	struct iovec iov = { .iov_base = (void *)addr, .iov_len = len };
+
+	return bdev_uring_get_buf_index(ring, &iov, 1);
+}
+
+static void
+test_io_type_supported(void)
+{
+	struct bdev_uring uring = {};
+	bool zoned_ops;
+
+#ifdef SPDK_CONFIG_URING_ZNS
+	zoned_ops = true;
+#else
+	zoned_ops = false;
+#endif
+
+	uring.passthru = false;
+	CU_ASSERT(bdev_uring_io_type_supported(&uring, SPDK_BDEV_IO_TYPE_READ));
+	CU_ASSERT(bdev_uring_io_type_supported(&uring, SPDK_BDEV_IO_TYPE_WRITE));
+	CU_ASSERT(!bdev_uring_io_type_supported(&uring, SPDK_BDEV_IO_TYPE_UNMAP));
+	CU_ASSERT(bdev_uring_io_type_supported(&uring, SPDK_BDEV_IO_TYPE_GET_ZONE_INFO) == zoned_ops);
+	CU_ASSERT(bdev_uring_io_type_supported(&uring, SPDK_BDEV_IO_TYPE_ZONE_MANAGEMENT) == zoned_ops);
+
+	/* The zone ioctls can't be issued to an NVMe char device */
+	uring.passthru = true;
+	CU_ASSERT(bdev_uring_io_type_supported(&uring, SPDK_BDEV_IO_TYPE_READ));
+	CU_ASSERT(bdev_uring_io_type_supported(&uring, SPDK_BDEV_IO_TYPE_WRITE));
+	CU_ASSERT(!bdev_uring_io_type_supported(&uring, SPDK_BDEV_IO_TYPE_GET_ZONE_INFO));
+	CU_ASSERT(!bdev_uring_io_type_supported(&uring, SPDK_BDEV_IO_TYPE_ZONE_MANAGEMENT));
+}
+
+static void
+test_fixed_buffers(void)
+{
+	struct bdev_uring_ring ring1 = {}, ring2 = {}, ring3 = {};
+	uint64_t addr_a = 0x40000000, size_a = SPDK_URING_MAX_BUFFER_SIZE + 0x200000;
+	uint64_t addr_b = 0x200000000, size_b = 0x200000;
+	uint64_t addr_c = 0x300000000, size_c = 0x400000;
+	int rc;
+
+	ut_reset_buffers();
+
+	/* The first region is split in two buffers */
+	rc = bdev_uring_mem_notify(NULL, NULL, SPDK_MEM_MAP_NOTIFY_REGISTER, (void *)addr_a, size_a);
+	CU_ASSERT_EQUAL(rc, 0);
+	rc = bdev_uring_mem_notify(NULL, NULL, SPDK_MEM_MAP_NOTIFY_REGISTER, (void *)addr_b, size_b);
+	CU_ASSERT_EQUAL(rc, 0);
+	CU_ASSERT_EQUAL(g_uring_num_buffers, 3);
+
+	bdev_uring_ring_register_buffers(&ring1);
+	CU_ASSERT_EQUAL(ring1.num_buffers, 3);
+	CU_ASSERT_EQUAL(g_num_registered_iovs, 3);
+	CU_ASSERT_EQUAL(g_registered_iovs[0].iov_base, (void *)addr_a);
+	CU_ASSERT_EQUAL(g_registered_iovs[0].iov_len, SPDK_URING_MAX_BUFFER_SIZE);
+	CU_ASSERT_EQUAL(g_registered_iovs[1].iov_base, (void *)(addr_a + SPDK_URING_MAX_BUFFER_SIZE));
+	CU_ASSERT_EQUAL(g_registered_iovs[1].iov_len, 0x200000);
+	CU_ASSERT_EQUAL(g_registered_iovs[2].iov_base, (void *)addr_b);
+	CU_ASSERT_EQUAL(ut_get_buf_index(&ring1, addr_a + 0x1000, 0x1000), 0);
+	CU_ASSERT_EQUAL(ut_get_buf_index(&ring1, addr_a + SPDK_URING_MAX_BUFFER_SIZE, 0x1000), 1);
+	CU_ASSERT_EQUAL(ut_get_buf_index(&ring1, addr_b, 0x1000), 2);
+	/* I/O crossing the end of a buffer can't use it */
+	CU_ASSERT_EQUAL(ut_get_buf_index(&ring1, addr_a + SPDK_URING_MAX_BUFFER_SIZE - 0x1000, 0x2000),
+			-1);
+
+	/* Unregistering the first region leaves holes, which the next ring skips */
+	rc = bdev_uring_mem_notify(NULL, NULL, SPDK_MEM_MAP_NOTIFY_UNREGISTER, (void *)addr_a, size_a);
+	CU_ASSERT_EQUAL(rc, 0);
+	CU_ASSERT_EQUAL(g_uring_num_buffers, 3);
+	CU_ASSERT_PTR_NULL(g_uring_buffers[0].iov_base);
+	CU_ASSERT_PTR_NULL(g_uring_buffers[1].iov_base);
+
+	bdev_uring_ring_register_buffers(&ring2);
+	CU_ASSERT_EQUAL(ring2.num_buffers, 3);
+	CU_ASSERT_EQUAL(g_num_registered_iovs, 1);
+	CU_ASSERT_EQUAL(g_registered_iovs[0].iov_base, (void *)addr_b);
+	CU_ASSERT_EQUAL(g_registered_iovs[0].iov_len, size_b);
+	CU_ASSERT_EQUAL(ut_get_buf_index(&ring2, addr_b, 0x1000), 0);
+	CU_ASSERT_EQUAL(ut_get_buf_index(&ring1, addr_b, 0x1000), 2);
+	CU_ASSERT_EQUAL(ut_get_buf_index(&ring1, addr_a, 0x1000), -1);
+	CU_ASSERT_EQUAL(ut_get_buf_index(&ring2, addr_a, 0x1000), -1);
+
+	/* New memory is appended, the older rings don't know about it */
+	rc = bdev_uring_mem_notify(NULL, NULL, SPDK_MEM_MAP_NOTIFY_REGISTER, (void *)addr_c, size_c);
+	CU_ASSERT_EQUAL(rc, 0);
+	CU_ASSERT_EQUAL(g_uring_num_buffers, 4);
+	CU_ASSERT_EQUAL(ut_get_buf_index(&ring2, addr_c, 0x1000), -1);
+
+	bdev_uring_ring_register_buffers(&ring3);
+	CU_ASSERT_EQUAL(ring3.num_buffers, 4);
+	CU_ASSERT_EQUAL(g_num_registered_iovs, 2);
+	CU_ASSERT_EQUAL(ut_get_buf_index(&ring3, addr_b, 0x1000), 0);
+	CU_ASSERT_EQUAL(ut_get_buf_index(&ring3, addr_c + 0x3ff000, 0x1000), 1);
+
+	ut_ring_fini(&ring1);
+	ut_ring_fini(&ring2);
+	ut_ring_fini(&ring3);
+}
+
+static void
+test_fixed_buffers_none(void)
+{
+	struct bdev_uring_ring ring = {};
+	uint64_t addr = 0x40000000, size = 0x200000;
+	int rc;
+
+	ut_reset_buffers();
+
+	/* No memory registered yet */
+	bdev_uring_ring_register_buffers(&ring);
+	CU_ASSERT_EQUAL(ring.num_buffers, 0);
+	CU_ASSERT_PTR_NULL(ring.buffer_index);
+
+	/* The kernel refusing the buffers */
+	rc = bdev_uring_mem_notify(NULL, NULL, SPDK_MEM_MAP_NOTIFY_REGISTER, (void *)addr, size);
+	CU_ASSERT_EQUAL(rc, 0);
+	g_register_buffers_rc = -ENOMEM;
+	bdev_uring_ring_register_buffers(&ring);
+	CU_ASSERT_EQUAL(ring.num_buffers, 0);
+	CU_ASSERT_PTR_NULL(ring.buffer_index);
+	CU_ASSERT_EQUAL(ut_get_buf_index(&ring, addr, 0x1000), -1);
+	g_register_buffers_rc = 0;
+
+	/* Nothing left but holes */
+	rc = bdev_uring_mem_notify(NULL, NULL, SPDK_MEM_MAP_NOTIFY_UNREGISTER, (void *)addr, size);
+	CU_ASSERT_EQUAL(rc, 0);
+	g_num_registered_iovs = UINT32_MAX;
+	bdev_uring_ring_register_buffers(&ring);
+	CU_ASSERT_EQUAL(g_num_registered_iovs, UINT32_MAX);
+	CU_ASSERT_EQUAL(ring.num_buffers, 0);
+	CU_ASSERT_PTR_NULL(ring.buffer_index);
+
+	ut_ring_fini(&ring);
+}
+
+int
+main(int argc, char **argv)
+{
+	CU_pSuite suite = NULL;
+	unsigned int num_failures;
+
+	CU_set_error_action(CUEA_ABORT);
+	CU_initialize_registry();
+
+	suite = CU_add_suite("uring", NULL, NULL);
+	CU_ADD_TEST(suite, test_io_type_supported);
+	CU_ADD_TEST(suite, test_fixed_buffers);
+	CU_ADD_TEST(suite, test_fixed_buffers_none);
+
+	CU_basic_set_mode(CU_BRM_VERBOSE);
+	CU_basic_run_tests();
+	num_failures = CU_get_number_of_failures();
+	CU_cleanup_registry();
+
+	return num_failures;
+}
@@ -38,6 +38,107 @@ bool g_ext_api_called;
 DEFINE_STUB_V(spdk_bdev_module_fini_start_done, (void));
 DEFINE_STUB(spdk_bdev_get_memory_domains, int, (struct spdk_bdev *bdev,
 		struct spdk_memory_domain **domains, int array_size), 0);
+DEFINE_STUB(spdk_bdev_open_ext, int, (const char *bdev_name, bool write,
+				      spdk_bdev_event_cb_t event_cb, void *event_ctx, struct spdk_bdev_desc **desc), -ENODEV);
+DEFINE_STUB_V(spdk_bdev_close, (struct spdk_bdev_desc *desc));
+DEFINE_STUB(spdk_bdev_desc_get_bdev, struct spdk_bdev *, (struct spdk_bdev_desc *desc), NULL);
+DEFINE_STUB(spdk_bdev_get_io_channel, struct spdk_io_channel *, (struct spdk_bdev_desc *desc),
+	    NULL);
+DEFINE_STUB_V(spdk_put_io_channel, (struct spdk_io_channel *ch));
+DEFINE_STUB(spdk_bdev_get_block_size, uint32_t, (const struct spdk_bdev *bdev), 512);
+DEFINE_STUB(spdk_bdev_get_num_blocks, uint64_t, (const struct spdk_bdev *bdev), 0);
+DEFINE_STUB(spdk_bdev_get_buf_align, size_t, (const struct spdk_bdev *bdev), 0);
+DEFINE_STUB_V(spdk_bdev_free_io, (struct spdk_bdev_io *bdev_io));
+DEFINE_STUB(spdk_bdev_queue_io_wait, int, (struct spdk_bdev *bdev, struct spdk_io_channel *ch,
+		struct spdk_bdev_io_wait_entry *entry), 0);
+
+struct ut_export_io {
+	bool				write;
+	uint64_t			offset;
+	uint64_t			nbytes;
+	spdk_bdev_io_completion_cb	cb;
+	void				*cb_arg;
+	TAILQ_ENTRY(ut_export_io)	link;
+};
+
+static TAILQ_HEAD(, ut_export_io) g_export_ios = TAILQ_HEAD_INITIALIZER(g_export_ios);
+static uint64_t g_blob_num_clusters;
+static struct spdk_bit_array *g_changed_clusters;
+static int g_changed_clusters_rc;
+
+int
+spdk_lvol_get_changed_clusters(struct spdk_lvol *snapshot, struct spdk_lvol *base_snapshot,
+			       struct spdk_bit_array *clusters)
+{
+	uint32_t i;
+
+	if (g_changed_clusters_rc != 0) {
+		return g_changed_clusters_rc;
+	}
+
+	spdk_bit_array_clear_mask(clusters);
+	if (g_changed_clusters != NULL) {
+		for (i = 0; i < spdk_bit_array_capacity(g_changed_clusters); i++) {
+			if (spdk_bit_array_get(g_changed_clusters, i)) {
+				spdk_bit_array_set(clusters, i);
+			}
+		}
+	}
+
+	return 0;
+}
+
+static int
+ut_export_queue_io(bool write, uint64_t offset, uint64_t nbytes, spdk_bdev_io_completion_cb cb,
+		   void *cb_arg)
+{
+	struct ut_export_io *io;
+
+	io = calloc(1, sizeof(*io));
+	SPDK_CU_ASSERT_FATAL(io != NULL);
+	io->write = write;
+	io->offset = offset;
+	io->nbytes = nbytes;
+	io->cb = cb;
+	io->cb_arg = cb_arg;
+	TAILQ_INSERT_TAIL(&g_export_ios, io, link);
+
+	return 0;
+}
+
+int
+spdk_bdev_read(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+	       void *buf, uint64_t offset, uint64_t nbytes, spdk_bdev_io_completion_cb cb,
+	       void *cb_arg)
+{
+	return ut_export_queue_io(false, offset, nbytes, cb, cb_arg);
+}
+
+int
+spdk_bdev_write(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+		void *buf, uint64_t offset, uint64_t nbytes, spdk_bdev_io_completion_cb cb,
+		void *cb_arg)
+{
+	return ut_export_queue_io(true, offset, nbytes, cb, cb_arg);
+}
+
+void *
+spdk_malloc(size_t size, size_t align, uint64_t *phys_addr, int socket_id, uint32_t flags)
+{
+	return calloc(1, size);
+}
+
+void *
+spdk_realloc(void *buf, size_t size, size_t align)
+{
+	return realloc(buf, size);
+}
+
+void
+spdk_free(void *buf)
+{
+	free(buf);
+}
 
 const struct spdk_bdev_aliases_list *
 spdk_bdev_get_aliases(const struct spdk_bdev *bdev)
@@ -166,7 +267,7 @@ spdk_lvol_open(struct spdk_lvol *lvol, spdk_lvol_op_with_handle_complete cb_fn,
 uint64_t
 spdk_blob_get_num_clusters(struct spdk_blob *b)
 {
-	return 0;
+	return g_blob_num_clusters;
 }
 
 /* Simulation of a blob with:
@@ -1572,6 +1673,132 @@ ut_lvol_seek(void)
 	free(g_lvol);
 }
 
+static void
+ut_export_diff_done(void *cb_arg, uint64_t exported_clusters, int lvolerrno)
+{
+	uint64_t *exported = cb_arg;
+
+	*exported = exported_clusters;
+	g_lvolerrno = lvolerrno;
+}
+
+static void
+ut_lvol_export_diff(void)
+{
+	struct spdk_lvol_store lvs = {};
+	struct spdk_bdev bdev = {}, target = {};
+	struct spdk_lvol snapshot = {};
+	struct ut_export_io *io;
+	uint64_t exported = 0, written = 0;
+	uint32_t outstanding, max_outstanding = 0;
+	const uint32_t cluster_sz = 0x10000;
+
+	snapshot.lvol_store = &lvs;
+	snapshot.bdev = &bdev;
+	snprintf(snapshot.name, sizeof(snapshot.name), "snap");
+
+	g_cluster_size = cluster_sz;
+	g_blob_num_clusters = 16;
+	g_changed_clusters = spdk_bit_array_create(16);
+	SPDK_CU_ASSERT_FATAL(g_changed_clusters != NULL);
+	spdk_bit_array_set(g_changed_clusters, 1);
+	spdk_bit_array_set(g_changed_clusters, 3);
+	spdk_bit_array_set(g_changed_clusters, 4);
+	spdk_bit_array_set(g_changed_clusters, 7);
+	spdk_bit_array_set(g_changed_clusters, 10);
+	spdk_bit_array_set(g_changed_clusters, 15);
+
+	MOCK_SET(spdk_bdev_open_ext, 0);
+	MOCK_SET(spdk_bdev_desc_get_bdev, &target);
+	MOCK_SET(spdk_bdev_get_io_channel, (struct spdk_io_channel *)0x1);
+	MOCK_SET(spdk_bdev_get_num_blocks, 16 * cluster_sz / 512);
+
+	/* Only changed clusters are read from the snapshot and written to the same
+	 * offset of the target, with at most VBDEV_LVOL_EXPORT_QD clusters in flight.
+	 */
+	g_lvolerrno = -1;
+	vbdev_lvol_export_diff(&snapshot, NULL, "target", ut_export_diff_done, &exported);
+	CU_ASSERT(g_lvolerrno == -1);
+
+	while (!TAILQ_EMPTY(&g_export_ios)) {
+		outstanding = 0;
+		TAILQ_FOREACH(io, &g_export_ios, link) {
+			outstanding++;
+		}
+		max_outstanding = spdk_max(max_outstanding, outstanding);
+
+		io = TAILQ_FIRST(&g_export_ios);
+		TAILQ_REMOVE(&g_export_ios, io, link);
+		CU_ASSERT(io->nbytes == cluster_sz);
+		CU_ASSERT(spdk_bit_array_get(g_changed_clusters, io->offset / cluster_sz));
+		if (io->write) {
+			written++;
+		}
+		io->cb(NULL, true, io->cb_arg);
+		free(io);
+	}
+
+	CU_ASSERT(max_outstanding == VBDEV_LVOL_EXPORT_QD);
+	CU_ASSERT(written == 6);
+	CU_ASSERT(g_lvolerrno == 0);
+	CU_ASSERT(exported == 6);
+
+	/* A failed read stops the export once the in-flight I/O completes. */
+	g_lvolerrno = -1;
+	exported = 0;
+	vbdev_lvol_export_diff(&snapshot, NULL, "target", ut_export_diff_done, &exported);
+
+	io = TAILQ_FIRST(&g_export_ios);
+	SPDK_CU_ASSERT_FATAL(io != NULL);
+	TAILQ_REMOVE(&g_export_ios, io, link);
+	io->cb(NULL, false, io->cb_arg);
+	free(io);
+	CU_ASSERT(g_lvolerrno == -1);
+
+	while (!TAILQ_EMPTY(&g_export_ios)) {
+		io = TAILQ_FIRST(&g_export_ios);
+		TAILQ_REMOVE(&g_export_ios, io, link);
+		/* No new I/O is submitted after the failure */
+		CU_ASSERT(!io->write);
+		io->cb(NULL, true, io->cb_arg);
+		free(io);
+	}
+	CU_ASSERT(g_lvolerrno == -EIO);
+	CU_ASSERT(exported == 0);
+
+	/* Target bdev smaller than the snapshot */
+	g_lvolerrno = -1;
+	MOCK_SET(spdk_bdev_get_num_blocks, 15 * cluster_sz / 512);
+	vbdev_lvol_export_diff(&snapshot, NULL, "target", ut_export_diff_done, &exported);
+	CU_ASSERT(g_lvolerrno == -EINVAL);
+	CU_ASSERT(TAILQ_EMPTY(&g_export_ios));
+
+	/* Changed clusters cannot be computed */
+	g_lvolerrno = -1;
+	g_changed_clusters_rc = -EINVAL;
+	MOCK_SET(spdk_bdev_get_num_blocks, 16 * cluster_sz / 512);
+	vbdev_lvol_export_diff(&snapshot, &snapshot, "target", ut_export_diff_done, &exported);
+	CU_ASSERT(g_lvolerrno == -EINVAL);
+	CU_ASSERT(TAILQ_EMPTY(&g_export_ios));
+
+	/* No changed clusters */
+	g_lvolerrno = -1;
+	g_changed_clusters_rc = 0;
+	spdk_bit_array_clear_mask(g_changed_clusters);
+	vbdev_lvol_export_diff(&snapshot, NULL, "target", ut_export_diff_done, &exported);
+	CU_ASSERT(g_lvolerrno == 0);
+	CU_ASSERT(exported == 0);
+	CU_ASSERT(TAILQ_EMPTY(&g_export_ios));
+
+	MOCK_CLEAR(spdk_bdev_open_ext);
+	MOCK_CLEAR(spdk_bdev_desc_get_bdev);
+	MOCK_CLEAR(spdk_bdev_get_io_channel);
+	MOCK_CLEAR(spdk_bdev_get_num_blocks);
+	spdk_bit_array_free(&g_changed_clusters);
+	g_blob_num_clusters = 0;
+	g_cluster_size = 0;
+}
+
 int
 main(int argc, char **argv)
 {
@@ -1601,6 +1828,7 @@ main(int argc, char **argv)
 	CU_ADD_TEST(suite, ut_bdev_finish);
 	CU_ADD_TEST(suite, ut_lvs_rename);
 	CU_ADD_TEST(suite, ut_lvol_seek);
+	CU_ADD_TEST(suite, ut_lvol_export_diff);
 
 	CU_basic_set_mode(CU_BRM_VERBOSE);
 	CU_basic_run_tests();
@@ -897,6 +897,102 @@ blob_snapshot_freeze_io(void)
 	ut_blob_close_and_delete(bs, blob);
 }
 
+static struct spdk_blob *
+ut_snapshot_and_open(struct spdk_blob_store *bs, spdk_blob_id blobid)
+{
+	spdk_bs_create_snapshot(bs, blobid, NULL, blob_op_with_id_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(g_blobid != SPDK_BLOBID_INVALID);
+
+	spdk_bs_open_blob(bs, g_blobid, blob_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_blob != NULL);
+
+	return g_blob;
+}
+
+static void
+blob_snapshot_changed_clusters(void)
+{
+	struct spdk_blob_store *bs = g_bs;
+	struct spdk_blob *blob, *snapshot1, *snapshot2, *snapshot3;
+	struct spdk_io_channel *channel;
+	struct spdk_bit_array *clusters;
+	struct spdk_blob_opts opts;
+	spdk_blob_id blobid;
+	uint64_t cluster_pages = bs->pages_per_cluster;
+	uint8_t payload[4096];
+	int rc;
+
+	channel = spdk_bs_alloc_io_channel(bs);
+	SPDK_CU_ASSERT_FATAL(channel != NULL);
+	memset(payload, 0xA5, sizeof(payload));
+
+	ut_spdk_blob_opts_init(&opts);
+	opts.thin_provision = true;
+	opts.num_clusters = 5;
+	blob = ut_blob_create_and_open(bs, &opts);
+	blobid = spdk_blob_get_id(blob);
+
+	/* snapshot1 holds clusters 0 and 1, snapshot2 clusters 1 and 2, snapshot3 cluster 3 */
+	spdk_blob_io_write(blob, channel, payload, 0, 1, blob_op_complete, NULL);
+	spdk_blob_io_write(blob, channel, payload, cluster_pages, 1, blob_op_complete, NULL);
+	poll_threads();
+	snapshot1 = ut_snapshot_and_open(bs, blobid);
+
+	spdk_blob_io_write(blob, channel, payload, cluster_pages, 1, blob_op_complete, NULL);
+	spdk_blob_io_write(blob, channel, payload, 2 * cluster_pages, 1, blob_op_complete, NULL);
+	poll_threads();
+	snapshot2 = ut_snapshot_and_open(bs, blobid);
+
+	spdk_blob_io_write(blob, channel, payload, 3 * cluster_pages, 1, blob_op_complete, NULL);
+	poll_threads();
+	snapshot3 = ut_snapshot_and_open(bs, blobid);
+
+	clusters = spdk_bit_array_create(5);
+	SPDK_CU_ASSERT_FATAL(clusters != NULL);
+
+	rc = spdk_blob_get_changed_clusters(snapshot3, spdk_blob_get_id(snapshot1), clusters);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(spdk_bit_array_count_set(clusters) == 3);
+	CU_ASSERT(spdk_bit_array_get(clusters, 1));
+	CU_ASSERT(spdk_bit_array_get(clusters, 2));
+	CU_ASSERT(spdk_bit_array_get(clusters, 3));
+
+	rc = spdk_blob_get_changed_clusters(snapshot2, spdk_blob_get_id(snapshot1), clusters);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(spdk_bit_array_count_set(clusters) == 2);
+	CU_ASSERT(spdk_bit_array_get(clusters, 1));
+	CU_ASSERT(spdk_bit_array_get(clusters, 2));
+
+	/* Without a base every cluster allocated in the lineage is reported */
+	rc = spdk_blob_get_changed_clusters(snapshot3, SPDK_BLOBID_INVALID, clusters);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(spdk_bit_array_count_set(clusters) == 4);
+	CU_ASSERT(!spdk_bit_array_get(clusters, 4));
+
+	/* Base must be an ancestor */
+	rc = spdk_blob_get_changed_clusters(snapshot1, spdk_blob_get_id(snapshot3), clusters);
+	CU_ASSERT(rc == -EINVAL);
+
+	spdk_bit_array_free(&clusters);
+	clusters = spdk_bit_array_create(4);
+	SPDK_CU_ASSERT_FATAL(clusters != NULL);
+	rc = spdk_blob_get_changed_clusters(snapshot3, spdk_blob_get_id(snapshot1), clusters);
+	CU_ASSERT(rc == -EINVAL);
+	spdk_bit_array_free(&clusters);
+
+	spdk_bs_free_io_channel(channel);
+	poll_threads();
+
+	ut_blob_close_and_delete(bs, blob);
+	ut_blob_close_and_delete(bs, snapshot3);
+	ut_blob_close_and_delete(bs, snapshot2);
+	ut_blob_close_and_delete(bs, snapshot1);
+}
+
 static void
 blob_clone(void)
 {
@@ -4156,6 +4252,267 @@ blob_thin_prov_rw(void)
 	g_blobid = 0;
 }
 
+static void
+blob_thin_prov_cluster_magazine(void)
+{
+	struct spdk_blob_store *bs = g_bs;
+	struct spdk_blob *blob, *thick_blob;
+	struct spdk_io_channel *channel, *channel_thread1;
+	struct spdk_blob_opts opts;
+	spdk_blob_id blobid;
+	uint64_t free_clusters;
+	uint64_t first_cluster;
+	uint8_t payload[4096];
+	uint32_t i;
+
+	free_clusters = spdk_bs_free_cluster_count(bs);
+	SPDK_CU_ASSERT_FATAL(free_clusters > 2 * SPDK_BS_CLUSTER_MAGAZINE_SIZE);
+
+	channel = spdk_bs_alloc_io_channel(bs);
+	SPDK_CU_ASSERT_FATAL(channel != NULL);
+
+	ut_spdk_blob_opts_init(&opts);
+	opts.thin_provision = true;
+	opts.num_clusters = 8;
+	blob = ut_blob_create_and_open(bs, &opts);
+	blobid = spdk_blob_get_id(blob);
+	memset(payload, 0xA5, sizeof(payload));
+
+	/* Sequential writes from one channel land on contiguous clusters, and the
+	 * rest of the magazine still counts as free */
+	for (i = 0; i < 4; i++) {
+		spdk_blob_io_write(blob, channel, payload, i * bs->pages_per_cluster, 1,
+				   blob_op_complete, NULL);
+		poll_threads();
+		CU_ASSERT(g_bserrno == 0);
+	}
+	first_cluster = bs_lba_to_cluster(bs, blob->active.clusters[0]);
+	for (i = 1; i < 4; i++) {
+		CU_ASSERT(bs_lba_to_cluster(bs, blob->active.clusters[i]) == first_cluster + i);
+	}
+	CU_ASSERT(bs->num_cached_clusters == SPDK_BS_CLUSTER_MAGAZINE_SIZE - 4);
+	CU_ASSERT(spdk_bs_free_cluster_count(bs) == free_clusters - 4);
+
+	/* Write from a second thread refills that channel's own magazine */
+	set_thread(1);
+	channel_thread1 = spdk_bs_alloc_io_channel(bs);
+	SPDK_CU_ASSERT_FATAL(channel_thread1 != NULL);
+	spdk_blob_io_write(blob, channel_thread1, payload, 4 * bs->pages_per_cluster, 1,
+			   blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(bs->num_cached_clusters == 2 * SPDK_BS_CLUSTER_MAGAZINE_SIZE - 5);
+	CU_ASSERT(spdk_bs_free_cluster_count(bs) == free_clusters - 5);
+
+	/* Destroying the channel returns its cached clusters */
+	spdk_bs_free_io_channel(channel_thread1);
+	poll_threads();
+	set_thread(0);
+	CU_ASSERT(bs->num_cached_clusters == SPDK_BS_CLUSTER_MAGAZINE_SIZE - 4);
+	CU_ASSERT(spdk_bs_free_cluster_count(bs) == free_clusters - 5);
+
+	/* A thick blob can use every free cluster, including the cached ones */
+	ut_spdk_blob_opts_init(&opts);
+	thick_blob = ut_blob_create_and_open(bs, &opts);
+	spdk_blob_resize(thick_blob, free_clusters - 5, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(bs->num_cached_clusters == 0);
+	CU_ASSERT(spdk_bs_free_cluster_count(bs) == 0);
+
+	/* Out of clusters, thin writes fail instead of stealing assigned ones */
+	spdk_blob_io_write(blob, channel, payload, 5 * bs->pages_per_cluster, 1,
+			   blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == -ENOSPC);
+
+	ut_blob_close_and_delete(bs, thick_blob);
+	CU_ASSERT(spdk_bs_free_cluster_count(bs) == free_clusters - 5);
+
+	/* Write one more cluster, so the magazine holds clusters across reload */
+	spdk_blob_io_write(blob, channel, payload, 5 * bs->pages_per_cluster, 1,
+			   blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(bs->num_cached_clusters != 0);
+
+	spdk_blob_close(blob, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	spdk_bs_free_io_channel(channel);
+	poll_threads();
+
+	/* The md thread channel still caches clusters, unload must not persist them as used */
+	ut_bs_reload(&bs, NULL);
+	CU_ASSERT(spdk_bs_free_cluster_count(bs) == free_clusters - 6);
+
+	spdk_bs_delete_blob(bs, blobid, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(spdk_bs_free_cluster_count(bs) == free_clusters);
+
+	g_bs = bs;
+	g_blob = NULL;
+	g_blobid = 0;
+}
+
+static void
+blob_op_with_clusters_complete(void *cb_arg, uint64_t num_clusters, int bserrno)
+{
+	*(uint64_t *)cb_arg = num_clusters;
+	g_bserrno = bserrno;
+}
+
+static void
+blob_thin_prov_reclaim_zeroed(void)
+{
+	struct spdk_blob_store *bs = g_bs;
+	struct spdk_blob *blob, *snapshot, *clone;
+	struct spdk_io_channel *channel;
+	struct spdk_blob_opts opts;
+	spdk_blob_id blobid, snapshotid, cloneid;
+	uint64_t free_clusters;
+	uint64_t released;
+	uint64_t cluster_pages = bs->pages_per_cluster;
+	uint8_t payload[4096];
+	uint8_t *cluster_buf;
+
+	cluster_buf = calloc(1, bs->cluster_sz);
+	SPDK_CU_ASSERT_FATAL(cluster_buf != NULL);
+
+	channel = spdk_bs_alloc_io_channel(bs);
+	SPDK_CU_ASSERT_FATAL(channel != NULL);
+
+	ut_spdk_blob_opts_init(&opts);
+	opts.thin_provision = true;
+	opts.num_clusters = 4;
+	blob = ut_blob_create_and_open(bs, &opts);
+	blobid = spdk_blob_get_id(blob);
+	free_clusters = spdk_bs_free_cluster_count(bs);
+
+	/* Cluster 0 holds data, clusters 1 and 3 were allocated by zero writes */
+	memset(payload, 0xA5, sizeof(payload));
+	spdk_blob_io_write(blob, channel, payload, 0, 1, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	memset(payload, 0, sizeof(payload));
+	spdk_blob_io_write(blob, channel, payload, cluster_pages, 1, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	spdk_blob_io_write(blob, channel, payload, 3 * cluster_pages + 1, 1, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(spdk_bs_free_cluster_count(bs) == free_clusters - 3);
+
+	/* Only part of the range is scanned */
+	released = UINT64_MAX;
+	spdk_blob_reclaim_zeroed_clusters(blob, 0, 2, blob_op_with_clusters_complete, &released);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(released == 1);
+	CU_ASSERT(blob->active.clusters[0] != 0);
+	CU_ASSERT(blob->active.clusters[1] == 0);
+	CU_ASSERT(blob->active.clusters[3] != 0);
+	CU_ASSERT(spdk_bs_free_cluster_count(bs) == free_clusters - 2);
+
+	spdk_blob_reclaim_zeroed_clusters(blob, 0, 4, blob_op_with_clusters_complete, &released);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(released == 1);
+	CU_ASSERT(blob->active.clusters[3] == 0);
+	CU_ASSERT(spdk_bs_free_cluster_count(bs) == free_clusters - 1);
+
+	/* Data is unchanged and the released clusters read as zeroes */
+	memset(cluster_buf, 0xFF, bs->cluster_sz);
+	spdk_blob_io_read(blob, channel, cluster_buf, 0, 1, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	memset(payload, 0xA5, sizeof(payload));
+	CU_ASSERT(memcmp(cluster_buf, payload, sizeof(payload)) == 0);
+	spdk_blob_io_read(blob, channel, cluster_buf, cluster_pages, cluster_pages,
+			  blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(spdk_mem_all_zero(cluster_buf, bs->cluster_sz));
+
+	/* Range past the end of the blob */
+	spdk_blob_reclaim_zeroed_clusters(blob, 2, 3, blob_op_with_clusters_complete, &released);
+	poll_threads();
+	CU_ASSERT(g_bserrno == -EINVAL);
+
+	/* Zeroed clusters survive reload as unallocated */
+	spdk_blob_close(blob, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	spdk_bs_free_io_channel(channel);
+	poll_threads();
+	ut_bs_reload(&bs, NULL);
+	CU_ASSERT(spdk_bs_free_cluster_count(bs) == free_clusters - 1);
+	channel = spdk_bs_alloc_io_channel(bs);
+	SPDK_CU_ASSERT_FATAL(channel != NULL);
+	spdk_bs_open_blob(bs, blobid, blob_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_blob != NULL);
+	blob = g_blob;
+	CU_ASSERT(blob->active.clusters[1] == 0);
+	CU_ASSERT(blob->active.clusters[3] == 0);
+
+	/* A zeroed cluster of a clone shadows non-zero snapshot data and is kept */
+	spdk_bs_create_snapshot(bs, blobid, NULL, blob_op_with_id_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	snapshotid = g_blobid;
+	spdk_bs_create_clone(bs, snapshotid, NULL, blob_op_with_id_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	cloneid = g_blobid;
+	spdk_bs_open_blob(bs, cloneid, blob_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_blob != NULL);
+	clone = g_blob;
+
+	memset(cluster_buf, 0, bs->cluster_sz);
+	spdk_blob_io_write(clone, channel, cluster_buf, 0, cluster_pages, blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	spdk_blob_io_write(clone, channel, cluster_buf, cluster_pages, cluster_pages,
+			   blob_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(clone->active.clusters[0] != 0);
+	CU_ASSERT(clone->active.clusters[1] != 0);
+
+	spdk_blob_reclaim_zeroed_clusters(clone, 0, 4, blob_op_with_clusters_complete, &released);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	CU_ASSERT(released == 1);
+	CU_ASSERT(clone->active.clusters[0] != 0);
+	CU_ASSERT(clone->active.clusters[1] == 0);
+
+	/* Snapshots are read-only */
+	spdk_bs_open_blob(bs, snapshotid, blob_op_with_handle_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_bserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_blob != NULL);
+	snapshot = g_blob;
+	spdk_blob_reclaim_zeroed_clusters(snapshot, 0, 4, blob_op_with_clusters_complete, &released);
+	poll_threads();
+	CU_ASSERT(g_bserrno == -EPERM);
+
+	spdk_bs_free_io_channel(channel);
+	poll_threads();
+	ut_blob_close_and_delete(bs, clone);
+	ut_blob_close_and_delete(bs, blob);
+	ut_blob_close_and_delete(bs, snapshot);
+	free(cluster_buf);
+
+	g_bs = bs;
+	g_blob = NULL;
+	g_blobid = 0;
+}
+
 static void
 blob_thin_prov_write_count_io(void)
 {
@@ -7508,6 +7865,7 @@ main(int argc, char **argv)
 	CU_ADD_TEST(suite_bs, blob_create_zero_extent);
 	CU_ADD_TEST(suite, blob_thin_provision);
 	CU_ADD_TEST(suite_bs, blob_snapshot);
+	CU_ADD_TEST(suite_bs, blob_snapshot_changed_clusters);
 	CU_ADD_TEST(suite_bs, blob_clone);
 	CU_ADD_TEST(suite_bs, blob_inflate);
 	CU_ADD_TEST(suite_bs, blob_delete);
@@ -7548,6 +7906,8 @@ main(int argc, char **argv)
 	CU_ADD_TEST(suite_bs, blob_thin_prov_alloc);
 	CU_ADD_TEST(suite_bs, blob_insert_cluster_msg_test);
 	CU_ADD_TEST(suite_bs, blob_thin_prov_rw);
+	CU_ADD_TEST(suite_bs, blob_thin_prov_cluster_magazine);
+	CU_ADD_TEST(suite_bs, blob_thin_prov_reclaim_zeroed);
 	CU_ADD_TEST(suite, blob_thin_prov_write_count_io);
 	CU_ADD_TEST(suite_bs, blob_thin_prov_rle);
 	CU_ADD_TEST(suite_bs, blob_thin_prov_rw_iov);
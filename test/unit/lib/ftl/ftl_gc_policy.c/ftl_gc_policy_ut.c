@@ -0,0 +1,401 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (C) 2023 Intel Corporation.
+ *   All rights reserved.
+ */
+
+#include "spdk/stdinc.h"
+
+#include "spdk_cunit.h"
+#include "common/lib/test_env.c"
+
+#include "ftl/ftl_gc_policy.c"
+
+/*
+ * Simple model of FTL's base device used for comparing the write amplification of the GC
+ * policies: user writes are appended to an open band, GC relocates the valid blocks of the band
+ * picked by the policy into a separate open band, just like the compaction and GC writers do.
+ * The LBA trace replayed can be passed in a file (one LBA per line) via FTL_GC_SIM_TRACE,
+ * otherwise a skewed synthetic trace is generated.
+ */
+#define SIM_NUM_BANDS		64
+#define SIM_BAND_BLOCKS		512
+#define SIM_OVERPROVISIONING	20
+#define SIM_NUM_LBAS		(SIM_NUM_BANDS * SIM_BAND_BLOCKS * (100 - SIM_OVERPROVISIONING) / 100)
+#define SIM_GC_FREE_BANDS	4
+#define SIM_ADDR_INVALID	UINT64_MAX
+
+/* Synthetic trace: SIM_HOT_WRITES percent of writes go to SIM_HOT_LBAS percent of the LBAs */
+#define SIM_HOT_LBAS		10
+#define SIM_HOT_WRITES		90
+#define SIM_NUM_WRITES		(SIM_NUM_LBAS * 16)
+
+enum sim_band_state {
+	SIM_BAND_FREE,
+	SIM_BAND_OPEN,
+	SIM_BAND_CLOSED,
+};
+
+struct sim_band {
+	enum sim_band_state	state;
+	uint64_t		num_valid;
+	uint64_t		wr_ptr;
+	uint64_t		wr_cnt;
+	uint64_t		close_seq_id;
+	uint64_t		p2l[SIM_BAND_BLOCKS];
+};
+
+struct sim_writer {
+	struct sim_band		*band;
+};
+
+struct sim_dev {
+	const struct ftl_gc_policy	*policy;
+	struct sim_band			bands[SIM_NUM_BANDS];
+	uint64_t			l2p[SIM_NUM_LBAS];
+	uint64_t			num_free;
+	uint64_t			seq_id;
+	uint64_t			user_writes;
+	uint64_t			gc_writes;
+	struct sim_writer		user;
+	struct sim_writer		gc;
+};
+
+static void sim_gc(struct sim_dev *dev);
+
+static void
+sim_init(struct sim_dev *dev, uint32_t policy)
+{
+	uint64_t i;
+
+	memset(dev, 0, sizeof(*dev));
+	dev->policy = ftl_gc_policy_get(policy);
+	SPDK_CU_ASSERT_FATAL(dev->policy != NULL);
+	dev->num_free = SIM_NUM_BANDS;
+
+	for (i = 0; i < SIM_NUM_LBAS; ++i) {
+		dev->l2p[i] = SIM_ADDR_INVALID;
+	}
+}
+
+static struct sim_band *
+sim_get_free_band(struct sim_dev *dev, bool gc)
+{
+	struct sim_band *band;
+	uint64_t i;
+
+	/* Leave the last free bands to GC, so that it can always make progress */
+	if (!gc) {
+		while (dev->num_free < SIM_GC_FREE_BANDS) {
+			sim_gc(dev);
+		}
+	}
+
+	for (i = 0; i < SIM_NUM_BANDS; ++i) {
+		band = &dev->bands[i];
+		if (band->state == SIM_BAND_FREE) {
+			band->state = SIM_BAND_OPEN;
+			band->wr_ptr = 0;
+			band->wr_cnt++;
+			dev->seq_id++;
+			dev->num_free--;
+			return band;
+		}
+	}
+
+	SPDK_CU_ASSERT_FATAL(false);
+	return NULL;
+}
+
+static void
+sim_invalidate(struct sim_dev *dev, uint64_t lba)
+{
+	struct sim_band *band;
+	uint64_t addr = dev->l2p[lba];
+
+	if (addr == SIM_ADDR_INVALID) {
+		return;
+	}
+
+	band = &dev->bands[addr / SIM_BAND_BLOCKS];
+	band->p2l[addr % SIM_BAND_BLOCKS] = SIM_ADDR_INVALID;
+	SPDK_CU_ASSERT_FATAL(band->num_valid > 0);
+	band->num_valid--;
+	dev->l2p[lba] = SIM_ADDR_INVALID;
+}
+
+static void
+sim_append(struct sim_dev *dev, struct sim_writer *writer, uint64_t lba, bool gc)
+{
+	struct sim_band *band;
+
+	if (!writer->band) {
+		writer->band = sim_get_free_band(dev, gc);
+	}
+
+	band = writer->band;
+	band->p2l[band->wr_ptr] = lba;
+	band->num_valid++;
+	dev->l2p[lba] = (band - dev->bands) * SIM_BAND_BLOCKS + band->wr_ptr;
+
+	if (++band->wr_ptr == SIM_BAND_BLOCKS) {
+		band->state = SIM_BAND_CLOSED;
+		band->close_seq_id = ++dev->seq_id;
+		writer->band = NULL;
+	}
+}
+
+static void
+sim_gc(struct sim_dev *dev)
+{
+	struct ftl_gc_candidate cand, best = { .phys_id = SIM_ADDR_INVALID };
+	struct sim_band *band;
+	uint64_t i, lba;
+
+	/* Pick the victim the same way ftl_band_search_next_to_reloc() does */
+	for (i = 0; i < SIM_NUM_BANDS; ++i) {
+		band = &dev->bands[i];
+		if (band->state != SIM_BAND_CLOSED) {
+			continue;
+		}
+
+		cand.phys_id = i;
+		cand.invalidity = 1.0L - (double)band->num_valid / SIM_BAND_BLOCKS;
+		cand.wr_cnt = band->wr_cnt;
+		cand.age = dev->seq_id - band->close_seq_id;
+
+		if (cand.invalidity != 0.0L) {
+			if (best.phys_id == SIM_ADDR_INVALID || dev->policy->cmp(&cand, &best)) {
+				best = cand;
+			}
+		}
+	}
+
+	SPDK_CU_ASSERT_FATAL(best.phys_id != SIM_ADDR_INVALID);
+	band = &dev->bands[best.phys_id];
+
+	for (i = 0; i < SIM_BAND_BLOCKS; ++i) {
+		lba = band->p2l[i];
+		if (lba == SIM_ADDR_INVALID) {
+			continue;
+		}
+
+		sim_invalidate(dev, lba);
+		sim_append(dev, &dev->gc, lba, true);
+		dev->gc_writes++;
+	}
+
+	CU_ASSERT_EQUAL(band->num_valid, 0);
+	band->state = SIM_BAND_FREE;
+	dev->num_free++;
+}
+
+static void
+sim_write(struct sim_dev *dev, uint64_t lba)
+{
+	sim_invalidate(dev, lba);
+	sim_append(dev, &dev->user, lba, false);
+	dev->user_writes++;
+}
+
+static double
+sim_wa(const struct sim_dev *dev)
+{
+	return (double)(dev->user_writes + dev->gc_writes) / dev->user_writes;
+}
+
+static void
+sim_verify(const struct sim_dev *dev)
+{
+	const struct sim_band *band;
+	uint64_t lba, addr;
+
+	for (lba = 0; lba < SIM_NUM_LBAS; ++lba) {
+		addr = dev->l2p[lba];
+		SPDK_CU_ASSERT_FATAL(addr != SIM_ADDR_INVALID);
+
+		band = &dev->bands[addr / SIM_BAND_BLOCKS];
+		CU_ASSERT_NOT_EQUAL(band->state, SIM_BAND_FREE);
+		CU_ASSERT_EQUAL(band->p2l[addr % SIM_BAND_BLOCKS], lba);
+	}
+}
+
+static uint64_t
+sim_rand(uint64_t *state)
+{
+	/* xorshift64, keeps the trace identical across platforms */
+	*state ^= *state << 13;
+	*state ^= *state >> 7;
+	*state ^= *state << 17;
+
+	return *state;
+}
+
+static uint64_t
+sim_skewed_lba(uint64_t *state)
+{
+	uint64_t num_hot = SIM_NUM_LBAS * SIM_HOT_LBAS / 100;
+
+	if (sim_rand(state) % 100 < SIM_HOT_WRITES) {
+		return sim_rand(state) % num_hot;
+	}
+
+	return num_hot + sim_rand(state) % (SIM_NUM_LBAS - num_hot);
+}
+
+static double
+sim_run(uint32_t policy, FILE *trace)
+{
+	struct sim_dev *dev;
+	uint64_t i, lba, state = 0x5eed;
+	double wa;
+
+	dev = calloc(1, sizeof(*dev));
+	SPDK_CU_ASSERT_FATAL(dev != NULL);
+	sim_init(dev, policy);
+
+	/* Precondition the device by filling it sequentially */
+	for (lba = 0; lba < SIM_NUM_LBAS; ++lba) {
+		sim_write(dev, lba);
+	}
+	dev->user_writes = dev->gc_writes = 0;
+
+	if (trace) {
+		rewind(trace);
+		while (fscanf(trace, "%" SCNu64, &lba) == 1) {
+			sim_write(dev, lba % SIM_NUM_LBAS);
+		}
+	} else {
+		for (i = 0; i < SIM_NUM_WRITES; ++i) {
+			sim_write(dev, sim_skewed_lba(&state));
+		}
+	}
+
+	sim_verify(dev);
+	wa = dev->user_writes ? sim_wa(dev) : 1.0L;
+
+	free(dev);
+	return wa;
+}
+
+static void
+test_policy_get(void)
+{
+	const struct ftl_gc_policy *policy;
+	uint32_t type;
+
+	policy = ftl_gc_policy_get(SPDK_FTL_GC_POLICY_GREEDY);
+	SPDK_CU_ASSERT_FATAL(policy != NULL);
+	CU_ASSERT_STRING_EQUAL(policy->name, "greedy");
+
+	policy = ftl_gc_policy_get(SPDK_FTL_GC_POLICY_COST_BENEFIT);
+	SPDK_CU_ASSERT_FATAL(policy != NULL);
+	CU_ASSERT_STRING_EQUAL(policy->name, "cost_benefit");
+
+	CU_ASSERT_PTR_NULL(ftl_gc_policy_get(SPDK_FTL_GC_POLICY_MAX));
+
+	policy = ftl_gc_policy_get_by_name("cost_benefit", &type);
+	CU_ASSERT_PTR_NOT_NULL(policy);
+	CU_ASSERT_EQUAL(type, SPDK_FTL_GC_POLICY_COST_BENEFIT);
+	CU_ASSERT_PTR_NULL(ftl_gc_policy_get_by_name("fifo", &type));
+
+	/* Public name conversions are backed by the same table */
+	CU_ASSERT_STRING_EQUAL(spdk_ftl_gc_policy_str(SPDK_FTL_GC_POLICY_GREEDY), "greedy");
+	CU_ASSERT_PTR_NULL(spdk_ftl_gc_policy_str(SPDK_FTL_GC_POLICY_MAX));
+	CU_ASSERT_EQUAL(spdk_ftl_gc_policy_parse(&type, "greedy"), 0);
+	CU_ASSERT_EQUAL(type, SPDK_FTL_GC_POLICY_GREEDY);
+	CU_ASSERT_EQUAL(spdk_ftl_gc_policy_parse(&type, "fifo"), -EINVAL);
+}
+
+static void
+test_greedy_cmp(void)
+{
+	const struct ftl_gc_policy *policy = ftl_gc_policy_get(SPDK_FTL_GC_POLICY_GREEDY);
+	struct ftl_gc_candidate a = { .phys_id = 1, .invalidity = 0.5, .wr_cnt = 4, .age = 0 };
+	struct ftl_gc_candidate b = { .phys_id = 2, .invalidity = 0.3, .wr_cnt = 1, .age = 100 };
+
+	/* Invalidity wins when the difference is large enough, age is ignored */
+	CU_ASSERT_TRUE(policy->cmp(&a, &b));
+	CU_ASSERT_FALSE(policy->cmp(&b, &a));
+
+	/* Similar invalidity - lower write count wins */
+	b.invalidity = 0.45;
+	CU_ASSERT_TRUE(policy->cmp(&b, &a));
+	CU_ASSERT_FALSE(policy->cmp(&a, &b));
+
+	/* Same write count - lower id wins */
+	b.wr_cnt = a.wr_cnt;
+	CU_ASSERT_TRUE(policy->cmp(&a, &b));
+	CU_ASSERT_FALSE(policy->cmp(&b, &a));
+}
+
+static void
+test_cost_benefit_cmp(void)
+{
+	const struct ftl_gc_policy *policy = ftl_gc_policy_get(SPDK_FTL_GC_POLICY_COST_BENEFIT);
+	struct ftl_gc_candidate a = { .phys_id = 1, .invalidity = 0.5, .wr_cnt = 1, .age = 10 };
+	struct ftl_gc_candidate b = { .phys_id = 2, .invalidity = 0.3, .wr_cnt = 1, .age = 10 };
+
+	/* Same age - more invalid band wins */
+	CU_ASSERT_TRUE(policy->cmp(&a, &b));
+	CU_ASSERT_FALSE(policy->cmp(&b, &a));
+
+	/* Much older band wins despite being less invalid */
+	b.age = 100;
+	CU_ASSERT_TRUE(policy->cmp(&b, &a));
+	CU_ASSERT_FALSE(policy->cmp(&a, &b));
+
+	/* Equal score - lower id wins */
+	b = a;
+	b.phys_id = 0;
+	CU_ASSERT_TRUE(policy->cmp(&b, &a));
+	CU_ASSERT_FALSE(policy->cmp(&a, &b));
+}
+
+static void
+test_simulation(void)
+{
+	const char *path = getenv("FTL_GC_SIM_TRACE");
+	double wa[SPDK_FTL_GC_POLICY_MAX];
+	FILE *trace = NULL;
+	uint32_t policy;
+
+	if (path) {
+		trace = fopen(path, "r");
+		SPDK_CU_ASSERT_FATAL(trace != NULL);
+	}
+
+	for (policy = 0; policy < SPDK_FTL_GC_POLICY_MAX; ++policy) {
+		wa[policy] = sim_run(policy, trace);
+		CU_ASSERT(wa[policy] >= 1.0L);
+	}
+
+	if (trace) {
+		fclose(trace);
+	} else {
+		/* Taking band age into account pays off when the workload is skewed */
+		CU_ASSERT(wa[SPDK_FTL_GC_POLICY_COST_BENEFIT] < wa[SPDK_FTL_GC_POLICY_GREEDY]);
+	}
+}
+
+int
+main(int argc, char **argv)
+{
+	CU_pSuite suite = NULL;
+	unsigned int num_failures;
+
+	CU_set_error_action(CUEA_ABORT);
+	CU_initialize_registry();
+
+	suite = CU_add_suite("ftl_gc_policy", NULL, NULL);
+	CU_ADD_TEST(suite, test_policy_get);
+	CU_ADD_TEST(suite, test_greedy_cmp);
+	CU_ADD_TEST(suite, test_cost_benefit_cmp);
+	CU_ADD_TEST(suite, test_simulation);
+
+	CU_basic_set_mode(CU_BRM_VERBOSE);
+	CU_basic_run_tests();
+	num_failures = CU_get_number_of_failures();
+	CU_cleanup_registry();
+
+	return num_failures;
+}
@@ -0,0 +1,147 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (C) 2023 Intel Corporation.
+ *   All rights reserved.
+ */
+
+#include "spdk/stdinc.h"
+
+#include "spdk_cunit.h"
+#include "common/lib/test_env.c"
+
+#include "ftl/ftl_heat.c"
+
+#define TEST_NUM_RANGES 16
+#define TEST_NUM_LBAS (TEST_NUM_RANGES * FTL_HEAT_RANGE_BLOCKS)
+#define TEST_DECAY_NUM_RANGES 64
+
+static struct spdk_ftl_dev g_dev;
+
+static void
+test_ftl_heat_cold(void)
+{
+	struct ftl_heat *heat;
+	uint64_t i, range;
+
+	g_dev.num_lbas = TEST_NUM_LBAS;
+	heat = ftl_heat_init(&g_dev);
+	SPDK_CU_ASSERT_FATAL(heat != NULL);
+	CU_ASSERT_EQUAL(heat->num_ranges, TEST_NUM_RANGES);
+
+	/* Nothing is considered cold without write history */
+	for (range = 0; range < TEST_NUM_RANGES; ++range) {
+		CU_ASSERT_FALSE(ftl_heat_is_cold(heat, range * FTL_HEAT_RANGE_BLOCKS));
+	}
+
+	/* Uniform writes - no range stands out */
+	for (i = 0; i < 4; ++i) {
+		for (range = 0; range < TEST_NUM_RANGES; ++range) {
+			ftl_heat_record_write(heat, range * FTL_HEAT_RANGE_BLOCKS, 1);
+		}
+	}
+	for (range = 0; range < TEST_NUM_RANGES; ++range) {
+		CU_ASSERT_FALSE(ftl_heat_is_cold(heat, range * FTL_HEAT_RANGE_BLOCKS + 1));
+	}
+
+	/* Skewed writes to the first range, the rest becomes cold */
+	for (i = 0; i < 128; ++i) {
+		ftl_heat_record_write(heat, 0, 8);
+	}
+	CU_ASSERT_FALSE(ftl_heat_is_cold(heat, 0));
+	for (range = 1; range < TEST_NUM_RANGES; ++range) {
+		CU_ASSERT_TRUE(ftl_heat_is_cold(heat, range * FTL_HEAT_RANGE_BLOCKS));
+	}
+
+	ftl_heat_free(heat);
+}
+
+static void
+test_ftl_heat_decay(void)
+{
+	struct ftl_heat *heat;
+	uint64_t i;
+
+	g_dev.num_lbas = TEST_DECAY_NUM_RANGES * FTL_HEAT_RANGE_BLOCKS;
+	heat = ftl_heat_init(&g_dev);
+	SPDK_CU_ASSERT_FATAL(heat != NULL);
+
+	/* A write spanning two ranges counts for both of them */
+	ftl_heat_record_write(heat, FTL_HEAT_RANGE_BLOCKS - 1, 2);
+	CU_ASSERT_EQUAL(heat->counters[0], 1);
+	CU_ASSERT_EQUAL(heat->counters[1], 1);
+	CU_ASSERT_EQUAL(heat->sum, 2);
+	CU_ASSERT_EQUAL(heat->num_writes, 2);
+
+	/* Counters saturate */
+	for (i = 0; i < UINT8_MAX + 8; ++i) {
+		ftl_heat_record_write(heat, 2 * FTL_HEAT_RANGE_BLOCKS, 1);
+	}
+	CU_ASSERT_EQUAL(heat->counters[2], UINT8_MAX);
+	CU_ASSERT_EQUAL(heat->sum, 2 + UINT8_MAX);
+
+	/* Reaching the decay period halves all the counters */
+	while (heat->num_writes < TEST_DECAY_NUM_RANGES * FTL_HEAT_DECAY_PERIOD - 1) {
+		ftl_heat_record_write(heat, 3 * FTL_HEAT_RANGE_BLOCKS, 1);
+	}
+	ftl_heat_record_write(heat, 0, 1);
+	CU_ASSERT_EQUAL(heat->num_writes, 0);
+	CU_ASSERT_EQUAL(heat->counters[0], 1);
+	CU_ASSERT_EQUAL(heat->counters[1], 0);
+	CU_ASSERT_EQUAL(heat->counters[2], UINT8_MAX / 2);
+	CU_ASSERT_EQUAL(heat->sum, heat->counters[0] + heat->counters[2] + heat->counters[3]);
+
+	ftl_heat_free(heat);
+}
+
+static void
+test_ftl_heat_compaction_pad(void)
+{
+	struct ftl_nv_cache_compactor compactor = {};
+	struct ftl_rq wr_default = { .num_blocks = 64 }, wr_cold = { .num_blocks = 64 };
+	struct ftl_rq *wr;
+
+	compactor.wr[FTL_NV_CACHE_STREAM_DEFAULT] = &wr_default;
+	compactor.wr[FTL_NV_CACHE_STREAM_COLD] = &wr_cold;
+
+	/* Nothing to pad while both streams are empty */
+	CU_ASSERT_PTR_NULL(ftl_nv_cache_compactor_get_wr_to_pad(&compactor));
+
+	/* Both streams hold data, the fuller one is padded first */
+	wr_default.iter.idx = 3;
+	wr_cold.iter.idx = 10;
+	wr = ftl_nv_cache_compactor_get_wr_to_pad(&compactor);
+	CU_ASSERT_PTR_EQUAL(wr, &wr_cold);
+
+	/* Once it's written, the other one still holding data is padded too */
+	wr->iter.idx = 0;
+	wr = ftl_nv_cache_compactor_get_wr_to_pad(&compactor);
+	CU_ASSERT_PTR_EQUAL(wr, &wr_default);
+
+	wr->iter.idx = 0;
+	CU_ASSERT_PTR_NULL(ftl_nv_cache_compactor_get_wr_to_pad(&compactor));
+
+	/* A cold stream alone is padded as well */
+	wr_cold.iter.idx = 1;
+	CU_ASSERT_PTR_EQUAL(ftl_nv_cache_compactor_get_wr_to_pad(&compactor), &wr_cold);
+}
+
+int
+main(int argc, char **argv)
+{
+	CU_pSuite suite = NULL;
+	unsigned int num_failures;
+
+	CU_set_error_action(CUEA_ABORT);
+	CU_initialize_registry();
+
+	suite = CU_add_suite("ftl_heat", NULL, NULL);
+	CU_ADD_TEST(suite, test_ftl_heat_cold);
+	CU_ADD_TEST(suite, test_ftl_heat_decay);
+	CU_ADD_TEST(suite, test_ftl_heat_compaction_pad);
+
+	CU_basic_set_mode(CU_BRM_VERBOSE);
+	CU_basic_run_tests();
+	num_failures = CU_get_number_of_failures();
+	CU_cleanup_registry();
+
+	return num_failures;
+}
@@ -71,7 +71,6 @@ DEFINE_STUB_V(ftl_reloc_resume, (struct ftl_reloc *reloc));
 DEFINE_STUB_V(ftl_l2p_unpin, (struct spdk_ftl_dev *dev, uint64_t lba, uint64_t count));
 DEFINE_STUB(ftl_p2l_ckpt_acquire, struct ftl_p2l_ckpt *, (struct spdk_ftl_dev *dev), NULL);
 DEFINE_STUB_V(ftl_p2l_ckpt_release, (struct spdk_ftl_dev *dev, struct ftl_p2l_ckpt *ckpt));
-DEFINE_STUB(ftl_l2p_get, ftl_addr, (struct spdk_ftl_dev *dev, uint64_t lba), 0);
 DEFINE_STUB_V(ftl_mempool_put, (struct ftl_mempool *mpool, void *element));
 
 #if defined(DEBUG)
@@ -92,6 +91,23 @@ DEFINE_STUB_V(ftl_trace_write_band, (struct spdk_ftl_dev *dev, const struct ftl_
 DEFINE_STUB_V(ftl_dev_dump_stats, (const struct spdk_ftl_dev *dev));
 #endif
 
+#define UT_NUM_LBAS 64
+static ftl_addr g_l2p[UT_NUM_LBAS];
+static int g_xfer_submit_cnt;
+
+ftl_addr
+ftl_l2p_get(struct spdk_ftl_dev *dev, uint64_t lba)
+{
+	SPDK_CU_ASSERT_FATAL(lba < UT_NUM_LBAS);
+	return g_l2p[lba];
+}
+
+void
+ftl_io_xfer_submit(struct ftl_io *io)
+{
+	g_xfer_submit_cnt++;
+}
+
 struct ftl_io_channel_ctx {
 	struct ftl_io_channel *ioch;
 };
@@ -282,6 +298,113 @@ test_multiple_ios(void)
 	free_device(dev);
 }
 
+static void
+test_xfer_read_complete(void)
+{
+	struct spdk_ftl_dev *dev;
+	struct ftl_io_channel *ioch;
+	struct ftl_io io = { 0 }, *io_ring;
+	char buf[4 * FTL_BLOCK_SIZE];
+	struct iovec iov = { .iov_base = buf, .iov_len = sizeof(buf) };
+	ftl_addr map[4];
+	int i, status = -1;
+
+	dev = setup_device(1, FTL_NUM_LBA_IN_BLOCK);
+	ioch = ftl_io_channel_get_ctx(dev->ioch);
+
+	for (i = 0; i < 4; i++) {
+		g_l2p[8 + i] = 100 + i;
+	}
+
+	/* The mapping didn't change during the transfer, the read is completed */
+	setup_io(&io, dev, io_complete_cb, &status);
+	io.type = FTL_IO_READ;
+	io.flags = FTL_IO_PINNED;
+	io.lba = 8;
+	io.num_blocks = 4;
+	io.iov = &iov;
+	io.iov_cnt = 1;
+	io.map = map;
+	for (i = 0; i < 4; i++) {
+		map[i] = ftl_l2p_get(dev, io.lba + i);
+	}
+	ftl_io_advance(&io, io.num_blocks);
+	g_xfer_submit_cnt = 0;
+
+	ftl_io_xfer_read_complete(&io);
+	CU_ASSERT_EQUAL(g_xfer_submit_cnt, 0);
+	CU_ASSERT_EQUAL(spdk_ring_count(ioch->cq), 1);
+	spdk_ring_dequeue(ioch->cq, (void **)&io_ring, 1);
+	io_ring->user_fn(io_ring->cb_ctx, io_ring->status);
+	CU_ASSERT_EQUAL(status, 0);
+
+	/* Two LBAs were relocated while their data was being transferred. The new
+	 * addresses are resolved and the read is sent for another transfer.
+	 */
+	status = -1;
+	setup_io(&io, dev, io_complete_cb, &status);
+	io.type = FTL_IO_READ;
+	io.flags = FTL_IO_PINNED;
+	io.lba = 8;
+	io.num_blocks = 4;
+	io.iov = &iov;
+	io.iov_cnt = 1;
+	io.map = map;
+	io.done = false;
+	for (i = 0; i < 4; i++) {
+		map[i] = ftl_l2p_get(dev, io.lba + i);
+	}
+	ftl_io_advance(&io, io.num_blocks);
+
+	g_l2p[9] = 200;
+	g_l2p[11] = FTL_ADDR_INVALID;
+
+	ftl_io_xfer_read_complete(&io);
+	CU_ASSERT_EQUAL(g_xfer_submit_cnt, 1);
+	CU_ASSERT_EQUAL(spdk_ring_count(ioch->cq), 0);
+	CU_ASSERT_EQUAL(io.pos, 0);
+	CU_ASSERT_EQUAL(io.iov_pos, 0);
+	CU_ASSERT_EQUAL(io.iov_off, 0);
+	CU_ASSERT_FALSE(io.done);
+	CU_ASSERT_EQUAL(map[0], 100);
+	CU_ASSERT_EQUAL(map[1], 200);
+	CU_ASSERT_EQUAL(map[2], 102);
+	CU_ASSERT_EQUAL(map[3], FTL_ADDR_INVALID);
+
+	/* The second transfer sees a stable mapping and completes the read */
+	ftl_io_advance(&io, io.num_blocks);
+	ftl_io_xfer_read_complete(&io);
+	CU_ASSERT_EQUAL(g_xfer_submit_cnt, 1);
+	CU_ASSERT_EQUAL(spdk_ring_count(ioch->cq), 1);
+	spdk_ring_dequeue(ioch->cq, (void **)&io_ring, 1);
+	io_ring->user_fn(io_ring->cb_ctx, io_ring->status);
+	CU_ASSERT_EQUAL(status, 0);
+
+	/* A failed transfer is completed with its error, without remapping */
+	status = 0;
+	setup_io(&io, dev, io_complete_cb, &status);
+	io.type = FTL_IO_READ;
+	io.flags = FTL_IO_PINNED;
+	io.lba = 8;
+	io.num_blocks = 4;
+	io.iov = &iov;
+	io.iov_cnt = 1;
+	io.map = map;
+	io.status = -EIO;
+	g_l2p[8] = 300;
+	ftl_io_advance(&io, io.num_blocks);
+
+	ftl_io_xfer_read_complete(&io);
+	CU_ASSERT_EQUAL(g_xfer_submit_cnt, 1);
+	CU_ASSERT_EQUAL(map[0], 100);
+	CU_ASSERT_EQUAL(spdk_ring_count(ioch->cq), 1);
+	spdk_ring_dequeue(ioch->cq, (void **)&io_ring, 1);
+	io_ring->user_fn(io_ring->cb_ctx, io_ring->status);
+	CU_ASSERT_EQUAL(status, -EIO);
+
+	free_device(dev);
+}
+
 int
 main(int argc, char **argv)
 {
@@ -296,6 +419,7 @@ main(int argc, char **argv)
 
 	CU_ADD_TEST(suite, test_completion);
 	CU_ADD_TEST(suite, test_multiple_ios);
+	CU_ADD_TEST(suite, test_xfer_read_complete);
 
 	CU_basic_set_mode(CU_BRM_VERBOSE);
 	CU_basic_run_tests();
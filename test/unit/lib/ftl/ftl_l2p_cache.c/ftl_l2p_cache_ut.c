@@ -0,0 +1,314 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (C) 2023 Intel Corporation.
+ *   All rights reserved.
+ */
+
+#include "spdk/stdinc.h"
+
+#include "spdk_cunit.h"
+#include "common/lib/test_env.c"
+
+#include "ftl/ftl_l2p_cache.c"
+
+#define TEST_NUM_PAGES 16
+
+void *g_ftl_write_buf;
+void *g_ftl_read_buf;
+
+DEFINE_STUB(ftl_bitmap_get, bool, (const struct ftl_bitmap *bitmap, uint64_t bit), false);
+DEFINE_STUB_V(ftl_bitmap_clear, (struct ftl_bitmap *bitmap, uint64_t bit));
+DEFINE_STUB(ftl_bitmap_find_first_set, uint64_t, (struct ftl_bitmap *bitmap, uint64_t start_bit,
+		uint64_t end_bit), UINT64_MAX);
+DEFINE_STUB_V(ftl_invalidate_addr, (struct spdk_ftl_dev *dev, ftl_addr addr));
+DEFINE_STUB_V(ftl_l2p_pin_complete, (struct spdk_ftl_dev *dev, int status,
+				     struct ftl_l2p_pin_ctx *pin_ctx));
+DEFINE_STUB_V(ftl_md_clear, (struct ftl_md *md, int pattern, union ftl_md_vss *vss_pattern));
+DEFINE_STUB(ftl_md_create, struct ftl_md *, (struct spdk_ftl_dev *dev, uint64_t blocks,
+		uint64_t vss_blksz, const char *name, int flags,
+		const struct ftl_layout_region *region), NULL);
+DEFINE_STUB(ftl_md_create_shm_flags, int, (struct spdk_ftl_dev *dev), 0);
+DEFINE_STUB_V(ftl_md_destroy, (struct ftl_md *md, int flags));
+DEFINE_STUB(ftl_md_destroy_shm_flags, int, (struct spdk_ftl_dev *dev), 0);
+DEFINE_STUB(ftl_md_get_buffer, void *, (struct ftl_md *md), NULL);
+DEFINE_STUB(ftl_md_get_buffer_size, uint64_t, (struct ftl_md *md), 0);
+DEFINE_STUB(ftl_mempool_claim_df, void *, (struct ftl_mempool *mpool, ftl_df_obj_id df_obj_id),
+	    NULL);
+DEFINE_STUB(ftl_mempool_create, struct ftl_mempool *, (size_t count, size_t size,
+		size_t alignment, int socket_id), NULL);
+DEFINE_STUB(ftl_mempool_create_ext, struct ftl_mempool *, (void *buffer, size_t count, size_t size,
+		size_t alignment), NULL);
+DEFINE_STUB_V(ftl_mempool_destroy, (struct ftl_mempool *mpool));
+DEFINE_STUB_V(ftl_mempool_destroy_ext, (struct ftl_mempool *mpool));
+DEFINE_STUB(ftl_mempool_get_df_obj_index, size_t, (struct ftl_mempool *mpool, void *df_obj_ptr), 0);
+DEFINE_STUB(ftl_mempool_get_df_ptr, void *, (struct ftl_mempool *mpool, ftl_df_obj_id df_obj_id),
+	    NULL);
+DEFINE_STUB_V(ftl_mempool_initialize_ext, (struct ftl_mempool *mpool));
+DEFINE_STUB_V(ftl_mempool_release_df, (struct ftl_mempool *mpool, ftl_df_obj_id df_obj_id));
+DEFINE_STUB_V(ftl_stats_bdev_io_completed, (struct spdk_ftl_dev *dev, enum ftl_stats_type type,
+		struct spdk_bdev_io *bdev_io));
+DEFINE_STUB(spdk_bdev_desc_get_bdev, struct spdk_bdev *, (struct spdk_bdev_desc *desc), NULL);
+DEFINE_STUB_V(spdk_bdev_free_io, (struct spdk_bdev_io *bdev_io));
+DEFINE_STUB(spdk_bdev_queue_io_wait, int, (struct spdk_bdev *bdev, struct spdk_io_channel *ch,
+		struct spdk_bdev_io_wait_entry *entry), 0);
+DEFINE_STUB(spdk_bdev_read_blocks_with_md, int, (struct spdk_bdev_desc *desc,
+		struct spdk_io_channel *ch, void *buf, void *md, uint64_t offset_blocks,
+		uint64_t num_blocks, spdk_bdev_io_completion_cb cb, void *cb_arg), 0);
+DEFINE_STUB(spdk_bdev_write_blocks_with_md, int, (struct spdk_bdev_desc *desc,
+		struct spdk_io_channel *ch, void *buf, void *md, uint64_t offset_blocks,
+		uint64_t num_blocks, spdk_bdev_io_completion_cb cb, void *cb_arg), 0);
+
+static struct spdk_ftl_dev g_dev;
+static struct ftl_l2p_page g_pages[TEST_NUM_PAGES];
+static bool g_pages_used[TEST_NUM_PAGES];
+
+void *
+ftl_mempool_get(struct ftl_mempool *mpool)
+{
+	size_t i;
+
+	for (i = 0; i < TEST_NUM_PAGES; ++i) {
+		if (!g_pages_used[i]) {
+			g_pages_used[i] = true;
+			return &g_pages[i];
+		}
+	}
+
+	return NULL;
+}
+
+void
+ftl_mempool_put(struct ftl_mempool *mpool, void *element)
+{
+	struct ftl_l2p_page *page = element;
+
+	CU_ASSERT(g_pages_used[page - g_pages]);
+	g_pages_used[page - g_pages] = false;
+}
+
+ftl_df_obj_id
+ftl_mempool_get_df_obj_id(struct ftl_mempool *mpool, void *df_obj_ptr)
+{
+	return (struct ftl_l2p_page *)df_obj_ptr - g_pages;
+}
+
+static struct ftl_l2p_cache *
+test_cache_alloc(uint64_t fifo_max, uint64_t ghost_size)
+{
+	struct ftl_l2p_cache *cache;
+
+	cache = calloc(1, sizeof(*cache));
+	SPDK_CU_ASSERT_FATAL(cache != NULL);
+
+	cache->dev = &g_dev;
+	cache->num_pages = TEST_NUM_PAGES;
+	cache->l2_pgs_avail = TEST_NUM_PAGES;
+	cache->l2_mapping = calloc(TEST_NUM_PAGES, sizeof(*cache->l2_mapping));
+	SPDK_CU_ASSERT_FATAL(cache->l2_mapping != NULL);
+	memset(cache->l2_mapping, (int)FTL_DF_OBJ_ID_INVALID, TEST_NUM_PAGES * sizeof(*cache->l2_mapping));
+
+	TAILQ_INIT(&cache->lru_list);
+	TAILQ_INIT(&cache->fifo_list);
+	cache->fifo_max = fifo_max;
+
+	cache->ghost.size = ghost_size;
+	cache->ghost.ring = calloc(ghost_size, sizeof(*cache->ghost.ring));
+	SPDK_CU_ASSERT_FATAL(cache->ghost.ring != NULL);
+	memset(cache->ghost.ring, 0xff, ghost_size * sizeof(*cache->ghost.ring));
+	cache->ghost.map = spdk_bit_array_create(TEST_NUM_PAGES);
+	SPDK_CU_ASSERT_FATAL(cache->ghost.map != NULL);
+
+	memset(g_pages_used, 0, sizeof(g_pages_used));
+
+	return cache;
+}
+
+static void
+test_cache_free(struct ftl_l2p_cache *cache)
+{
+	spdk_bit_array_free(&cache->ghost.map);
+	free(cache->ghost.ring);
+	free(cache->l2_mapping);
+	free(cache);
+}
+
+/* Allocate a page the way a completed page in does and put it on its rank list */
+static struct ftl_l2p_page *
+test_page_in(struct ftl_l2p_cache *cache, uint64_t page_no)
+{
+	struct ftl_l2p_page *page = page_allocate(cache, page_no);
+
+	page->state = L2P_CACHE_PAGE_READY;
+	ftl_l2p_cache_lru_add_page(cache, page);
+
+	return page;
+}
+
+static void
+test_page_evict(struct ftl_l2p_cache *cache, struct ftl_l2p_page *page)
+{
+	ftl_l2p_cache_lru_remove_page(cache, page);
+	ftl_l2p_cache_page_evict(cache, page);
+}
+
+static void
+test_ghost_hit(void)
+{
+	struct ftl_l2p_cache *cache = test_cache_alloc(2, 2);
+	struct ftl_l2p_page *page;
+
+	/* Pages seen for the first time start on the FIFO list */
+	page = test_page_in(cache, 3);
+	CU_ASSERT_FALSE(page->hot);
+	CU_ASSERT_EQUAL(cache->fifo_cnt, 1);
+	CU_ASSERT_PTR_EQUAL(TAILQ_FIRST(&cache->fifo_list), page);
+	CU_ASSERT(TAILQ_EMPTY(&cache->lru_list));
+
+	/* Evicting it from the FIFO list remembers the page in the ghost ring */
+	test_page_evict(cache, page);
+	CU_ASSERT_EQUAL(cache->fifo_cnt, 0);
+	CU_ASSERT_EQUAL(cache->l2_pgs_avail, TEST_NUM_PAGES);
+	CU_ASSERT_TRUE(spdk_bit_array_get(cache->ghost.map, 3));
+
+	/* Reading it again while it's in the ghost ring promotes it to the LRU list */
+	page = test_page_in(cache, 3);
+	CU_ASSERT_TRUE(page->hot);
+	CU_ASSERT_FALSE(spdk_bit_array_get(cache->ghost.map, 3));
+	CU_ASSERT_EQUAL(cache->fifo_cnt, 0);
+	CU_ASSERT_PTR_EQUAL(TAILQ_FIRST(&cache->lru_list), page);
+
+	/* Hot pages aren't added to the ghost ring on eviction */
+	test_page_evict(cache, page);
+	CU_ASSERT_FALSE(spdk_bit_array_get(cache->ghost.map, 3));
+	page = test_page_in(cache, 3);
+	CU_ASSERT_FALSE(page->hot);
+	test_page_evict(cache, page);
+
+	/* The ghost ring only remembers the most recently evicted pages */
+	test_page_evict(cache, test_page_in(cache, 4));
+	test_page_evict(cache, test_page_in(cache, 5));
+	CU_ASSERT_FALSE(spdk_bit_array_get(cache->ghost.map, 3));
+	CU_ASSERT_TRUE(spdk_bit_array_get(cache->ghost.map, 4));
+	CU_ASSERT_TRUE(spdk_bit_array_get(cache->ghost.map, 5));
+
+	page = test_page_in(cache, 3);
+	CU_ASSERT_FALSE(page->hot);
+	test_page_evict(cache, page);
+	page = test_page_in(cache, 5);
+	CU_ASSERT_TRUE(page->hot);
+	test_page_evict(cache, page);
+
+	test_cache_free(cache);
+}
+
+static void
+test_coldest_page(void)
+{
+	struct ftl_l2p_cache *cache = test_cache_alloc(2, 4);
+	struct ftl_l2p_page *hot, *cold[3];
+
+	test_page_evict(cache, test_page_in(cache, 0));
+	hot = test_page_in(cache, 0);
+	CU_ASSERT_TRUE(hot->hot);
+
+	/* LRU pages are evicted first while the FIFO list fits in its share */
+	cold[0] = test_page_in(cache, 1);
+	cold[1] = test_page_in(cache, 2);
+	CU_ASSERT_PTR_EQUAL(ftl_l2p_cache_get_coldest_page(cache), hot);
+
+	/* Once the FIFO list grows over its share, its oldest page goes first */
+	cold[2] = test_page_in(cache, 3);
+	CU_ASSERT_PTR_EQUAL(ftl_l2p_cache_get_coldest_page(cache), cold[0]);
+	CU_ASSERT_PTR_EQUAL(eviction_get_page(&g_dev, cache), cold[0]);
+	CU_ASSERT_EQUAL(cache->fifo_cnt, 2);
+	ftl_l2p_cache_page_evict(cache, cold[0]);
+
+	CU_ASSERT_PTR_EQUAL(ftl_l2p_cache_get_coldest_page(cache), hot);
+	test_page_evict(cache, hot);
+
+	/* Without any hot pages the FIFO list is evicted regardless of its size */
+	CU_ASSERT_PTR_EQUAL(ftl_l2p_cache_get_coldest_page(cache), cold[1]);
+	test_page_evict(cache, cold[1]);
+	test_page_evict(cache, cold[2]);
+	CU_ASSERT_PTR_NULL(ftl_l2p_cache_get_coldest_page(cache));
+
+	test_cache_free(cache);
+}
+
+static void
+test_fifo_pin(void)
+{
+	struct ftl_l2p_cache *cache = test_cache_alloc(1, 4);
+	struct ftl_l2p_page *page[3], *hot[2];
+	int i;
+
+	for (i = 0; i < 3; ++i) {
+		page[i] = test_page_in(cache, i);
+	}
+
+	/* Pinning a page takes it off the FIFO list, unpinning puts it back in the same place */
+	ftl_l2p_cache_page_pin(cache, page[1]);
+	CU_ASSERT_FALSE(page[1]->on_lru_list);
+	CU_ASSERT_EQUAL(cache->fifo_cnt, 2);
+	ftl_l2p_cache_page_unpin(cache, page[1]);
+	CU_ASSERT_TRUE(page[1]->on_lru_list);
+	CU_ASSERT_EQUAL(cache->fifo_cnt, 3);
+	CU_ASSERT_PTR_EQUAL(TAILQ_FIRST(&cache->fifo_list), page[2]);
+	CU_ASSERT_PTR_EQUAL(TAILQ_NEXT(page[2], list_entry), page[1]);
+	CU_ASSERT_PTR_EQUAL(TAILQ_LAST(&cache->fifo_list, l2p_lru_list), page[0]);
+
+	/* The oldest page is still evicted first after it's been referenced */
+	ftl_l2p_cache_page_pin(cache, page[0]);
+	ftl_l2p_cache_page_pin(cache, page[2]);
+	ftl_l2p_cache_page_unpin(cache, page[2]);
+	ftl_l2p_cache_page_unpin(cache, page[0]);
+	CU_ASSERT_PTR_EQUAL(TAILQ_FIRST(&cache->fifo_list), page[2]);
+	CU_ASSERT_PTR_EQUAL(ftl_l2p_cache_get_coldest_page(cache), page[0]);
+
+	/* Repeated references don't reorder the FIFO list */
+	ftl_l2p_cache_lru_promote_page(cache, page[0]);
+	CU_ASSERT_PTR_EQUAL(ftl_l2p_cache_get_coldest_page(cache), page[0]);
+
+	for (i = 0; i < 3; ++i) {
+		test_page_evict(cache, page[i]);
+	}
+
+	/* Hot pages move to the head of the LRU list on every reference */
+	for (i = 0; i < 2; ++i) {
+		hot[i] = test_page_in(cache, i);
+		CU_ASSERT_TRUE(hot[i]->hot);
+	}
+	CU_ASSERT_PTR_EQUAL(TAILQ_LAST(&cache->lru_list, l2p_lru_list), hot[0]);
+	ftl_l2p_cache_page_pin(cache, hot[0]);
+	ftl_l2p_cache_page_unpin(cache, hot[0]);
+	CU_ASSERT_PTR_EQUAL(TAILQ_FIRST(&cache->lru_list), hot[0]);
+	ftl_l2p_cache_lru_promote_page(cache, hot[1]);
+	CU_ASSERT_PTR_EQUAL(TAILQ_FIRST(&cache->lru_list), hot[1]);
+
+	for (i = 0; i < 2; ++i) {
+		test_page_evict(cache, hot[i]);
+	}
+
+	test_cache_free(cache);
+}
+
+int
+main(int argc, char **argv)
+{
+	CU_pSuite suite = NULL;
+	unsigned int num_failures;
+
+	CU_set_error_action(CUEA_ABORT);
+	CU_initialize_registry();
+
+	suite = CU_add_suite("ftl_l2p_cache", NULL, NULL);
+	CU_ADD_TEST(suite, test_ghost_hit);
+	CU_ADD_TEST(suite, test_coldest_page);
+	CU_ADD_TEST(suite, test_fifo_pin);
+
+	CU_basic_set_mode(CU_BRM_VERBOSE);
+	CU_basic_run_tests();
+	num_failures = CU_get_number_of_failures();
+	CU_cleanup_registry();
+
+	return num_failures;
+}
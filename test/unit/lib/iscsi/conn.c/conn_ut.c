@@ -6,7 +6,7 @@
 
 #include "spdk/stdinc.h"
 
-#include "common/lib/test_env.c"
+#include "common/lib/ut_multithread.c"
 #include "spdk_cunit.h"
 
 #include "iscsi/conn.c"
@@ -140,12 +140,43 @@ DEFINE_STUB(spdk_scsi_lun_open, int,
 	     void *hotremove_ctx, struct spdk_scsi_lun_desc **desc),
 	    0);
 
-DEFINE_STUB_V(spdk_scsi_lun_close, (struct spdk_scsi_lun_desc *desc));
+struct spdk_scsi_lun_desc {
+	struct spdk_thread *ch_thread;
+	struct spdk_thread *fail_thread;
+	int ch_ref;
+	bool closed;
+};
+
+void
+spdk_scsi_lun_close(struct spdk_scsi_lun_desc *desc)
+{
+	desc->closed = true;
+}
+
+/* Like the SCSI layer, a LUN has a single I/O channel, tied to one thread */
+DEFINE_RETURN_MOCK(spdk_scsi_lun_allocate_io_channel, int);
+int
+spdk_scsi_lun_allocate_io_channel(struct spdk_scsi_lun_desc *desc)
+{
+	HANDLE_RETURN_MOCK(spdk_scsi_lun_allocate_io_channel);
 
-DEFINE_STUB(spdk_scsi_lun_allocate_io_channel, int,
-	    (struct spdk_scsi_lun_desc *desc), 0);
+	if (spdk_get_thread() == desc->fail_thread ||
+	    (desc->ch_ref != 0 && spdk_get_thread() != desc->ch_thread)) {
+		return -1;
+	}
 
-DEFINE_STUB_V(spdk_scsi_lun_free_io_channel, (struct spdk_scsi_lun_desc *desc));
+	desc->ch_thread = spdk_get_thread();
+	desc->ch_ref++;
+	return 0;
+}
+
+void
+spdk_scsi_lun_free_io_channel(struct spdk_scsi_lun_desc *desc)
+{
+	CU_ASSERT(desc->ch_ref > 0);
+	CU_ASSERT(desc->ch_thread == spdk_get_thread());
+	desc->ch_ref--;
+}
 
 DEFINE_STUB(spdk_scsi_lun_get_id, int, (const struct spdk_scsi_lun *lun), 0);
 
@@ -891,6 +922,472 @@ abort_queued_datain_tasks_test(void)
 	g_new_task = NULL;
 }
 
+static void
+poll_group_least_loaded_test(void)
+{
+	struct spdk_iscsi_poll_group pg1 = {}, pg2 = {}, pg3 = {};
+
+	TAILQ_INIT(&g_iscsi.poll_group_head);
+	TAILQ_INSERT_TAIL(&g_iscsi.poll_group_head, &pg1, link);
+	TAILQ_INSERT_TAIL(&g_iscsi.poll_group_head, &pg2, link);
+	TAILQ_INSERT_TAIL(&g_iscsi.poll_group_head, &pg3, link);
+	g_next_pg = NULL;
+
+	/* Equally loaded poll groups are picked round-robin. */
+	CU_ASSERT(iscsi_poll_group_get_least_loaded() == &pg1);
+	CU_ASSERT(iscsi_poll_group_get_least_loaded() == &pg2);
+	CU_ASSERT(iscsi_poll_group_get_least_loaded() == &pg3);
+	CU_ASSERT(iscsi_poll_group_get_least_loaded() == &pg1);
+
+	/* Loads within the slack are compared by the number of connections. */
+	pg1.load = 50;
+	pg2.load = 50 + ISCSI_POLL_GROUP_LOAD_SLACK;
+	pg3.load = 50;
+	pg1.num_conns = 4;
+	pg2.num_conns = 1;
+	pg3.num_conns = 2;
+	g_next_pg = NULL;
+	CU_ASSERT(iscsi_poll_group_get_least_loaded() == &pg2);
+
+	/* A clearly less busy poll group wins over the number of connections. */
+	pg3.load = 10;
+	pg3.num_conns = 8;
+	CU_ASSERT(iscsi_poll_group_get_least_loaded() == &pg3);
+	CU_ASSERT(iscsi_poll_group_get_least_loaded() == &pg3);
+
+	TAILQ_INIT(&g_iscsi.poll_group_head);
+	g_next_pg = NULL;
+}
+
+static void
+poll_group_pick_target_test(void)
+{
+	struct spdk_iscsi_poll_group pg = {};
+	struct spdk_iscsi_conn conn1 = {}, conn2 = {}, conn3 = {}, conn4 = {};
+	struct spdk_iscsi_tgt_node target1 = {}, target2 = {};
+	struct spdk_iscsi_sess sess = {};
+
+	sess.session_type = SESSION_TYPE_NORMAL;
+	STAILQ_INIT(&pg.connections);
+
+	/* target1 has two connections taking 40% together, target2 has one taking 15%.
+	 *  conn4 is still logging in and is not counted.
+	 */
+	conn1.target = &target1;
+	conn1.load = 30;
+	conn2.target = &target2;
+	conn2.load = 15;
+	conn3.target = &target1;
+	conn3.load = 10;
+	conn4.target = &target2;
+	conn4.load = 50;
+	conn1.sess = conn2.sess = conn3.sess = &sess;
+	conn1.full_feature = conn2.full_feature = conn3.full_feature = 1;
+	STAILQ_INSERT_TAIL(&pg.connections, &conn1, pg_link);
+	STAILQ_INSERT_TAIL(&pg.connections, &conn2, pg_link);
+	STAILQ_INSERT_TAIL(&pg.connections, &conn3, pg_link);
+	STAILQ_INSERT_TAIL(&pg.connections, &conn4, pg_link);
+
+	/* Moving target1 would leave the poll groups 40 - 40 = 0 apart. */
+	CU_ASSERT(iscsi_poll_group_pick_target(&pg, 80) == &target1);
+	/* target1 is closer to half of the gap than target2. */
+	CU_ASSERT(iscsi_poll_group_pick_target(&pg, 60) == &target1);
+	/* Moving target1 would make the destination hotter than the source. */
+	CU_ASSERT(iscsi_poll_group_pick_target(&pg, 40) == &target2);
+	/* Nothing is small enough to improve the balance. */
+	CU_ASSERT(iscsi_poll_group_pick_target(&pg, 15) == NULL);
+}
+
+static struct spdk_iscsi_poll_group *g_src_pg;
+static struct spdk_iscsi_poll_group *g_dst_pg;
+static bool g_migrate_done;
+static int g_migrate_rc;
+
+static int
+ut_poll_group_create(void *io_device, void *ctx_buf)
+{
+	struct spdk_iscsi_poll_group *pg = ctx_buf;
+
+	STAILQ_INIT(&pg->connections);
+	return 0;
+}
+
+static void
+ut_poll_group_destroy(void *io_device, void *ctx_buf)
+{
+	struct spdk_iscsi_poll_group *pg = ctx_buf;
+
+	CU_ASSERT(STAILQ_EMPTY(&pg->connections));
+}
+
+/* Thread 0 starts the migrations, threads 1 and 2 run the source and destination poll groups */
+static void
+ut_poll_groups_init(void)
+{
+	allocate_threads(3);
+	set_thread(0);
+	spdk_io_device_register(&g_iscsi, ut_poll_group_create, ut_poll_group_destroy,
+				sizeof(struct spdk_iscsi_poll_group), "ut_iscsi");
+
+	set_thread(1);
+	g_src_pg = spdk_io_channel_get_ctx(spdk_get_io_channel(&g_iscsi));
+	set_thread(2);
+	g_dst_pg = spdk_io_channel_get_ctx(spdk_get_io_channel(&g_iscsi));
+	set_thread(0);
+
+	MOCK_SET(spdk_scsi_dev_has_pending_tasks, false);
+	g_migrate_done = false;
+	g_migrate_rc = 0;
+}
+
+static void
+ut_poll_groups_fini(void)
+{
+	set_thread(1);
+	spdk_put_io_channel(spdk_io_channel_from_ctx(g_src_pg));
+	set_thread(2);
+	spdk_put_io_channel(spdk_io_channel_from_ctx(g_dst_pg));
+	set_thread(0);
+	spdk_io_device_unregister(&g_iscsi, NULL);
+	poll_threads();
+	free_threads();
+
+	MOCK_CLEAR(spdk_scsi_dev_has_pending_tasks);
+	g_src_pg = g_dst_pg = NULL;
+}
+
+static struct spdk_thread *
+ut_pg_thread(struct spdk_iscsi_poll_group *pg)
+{
+	return spdk_io_channel_get_thread(spdk_io_channel_from_ctx(pg));
+}
+
+static void
+ut_conn_init(struct spdk_iscsi_conn *conn, struct spdk_iscsi_sess *sess,
+	     struct spdk_iscsi_tgt_node *target, struct spdk_scsi_lun_desc *descs,
+	     int num_luns)
+{
+	struct spdk_iscsi_lun *iscsi_lun;
+	int i;
+
+	memset(conn, 0, sizeof(*conn));
+	conn->state = ISCSI_CONN_STATE_RUNNING;
+	conn->full_feature = 1;
+	conn->sess = sess;
+	conn->target = target;
+	conn->load = 10;
+	conn->sock = (struct spdk_sock *)0xDEADBEEF;
+	conn->pdu_recv_state = ISCSI_PDU_RECV_STATE_AWAIT_PDU_READY;
+	TAILQ_INIT(&conn->write_pdu_list);
+	TAILQ_INIT(&conn->snack_pdu_list);
+	TAILQ_INIT(&conn->queued_r2t_tasks);
+	TAILQ_INIT(&conn->active_r2t_tasks);
+	TAILQ_INIT(&conn->queued_datain_tasks);
+	TAILQ_INIT(&conn->luns);
+
+	for (i = 0; i < num_luns; i++) {
+		iscsi_lun = calloc(1, sizeof(*iscsi_lun));
+		SPDK_CU_ASSERT_FATAL(iscsi_lun != NULL);
+		iscsi_lun->conn = conn;
+		iscsi_lun->desc = &descs[i];
+		descs[i].ch_thread = ut_pg_thread(target->pg);
+		descs[i].ch_ref++;
+		TAILQ_INSERT_TAIL(&conn->luns, iscsi_lun, tailq);
+	}
+
+	conn->pg = target->pg;
+	iscsi_poll_group_add_conn(conn->pg, conn);
+}
+
+static void
+ut_conn_fini(struct spdk_iscsi_conn *conn)
+{
+	struct spdk_iscsi_lun *iscsi_lun, *tmp;
+
+	if (!conn->is_stopped) {
+		iscsi_poll_group_remove_conn(conn->pg, conn);
+	}
+
+	TAILQ_FOREACH_SAFE(iscsi_lun, &conn->luns, tailq, tmp) {
+		TAILQ_REMOVE(&conn->luns, iscsi_lun, tailq);
+		free(iscsi_lun);
+	}
+}
+
+static int
+ut_conn_num_luns(struct spdk_iscsi_conn *conn)
+{
+	struct spdk_iscsi_lun *iscsi_lun;
+	int num = 0;
+
+	TAILQ_FOREACH(iscsi_lun, &conn->luns, tailq) {
+		num++;
+	}
+
+	return num;
+}
+
+static void
+ut_migrate_cb(void *cb_arg, int rc)
+{
+	CU_ASSERT(spdk_get_thread() == g_ut_threads[0].thread);
+	g_migrate_done = true;
+	g_migrate_rc = rc;
+}
+
+static void
+ut_migrate_start(uint32_t max_load)
+{
+	g_migrate_done = false;
+	set_thread(0);
+	iscsi_poll_group_migrate_conns(g_src_pg, g_dst_pg, max_load, ut_migrate_cb, NULL);
+	poll_threads();
+}
+
+static void
+ut_migrate_poll(void)
+{
+	spdk_delay_us(100);
+	poll_threads();
+}
+
+static void
+migrate_conns_test(void)
+{
+	struct spdk_iscsi_tgt_node target1 = {}, target2 = {};
+	struct spdk_iscsi_sess sess = {};
+	struct spdk_iscsi_conn conn1, conn2, conn3;
+	struct spdk_scsi_lun_desc desc1[2] = {}, desc2[2] = {}, desc3[1] = {};
+	struct spdk_iscsi_task task = {};
+	int i;
+
+	ut_poll_groups_init();
+	sess.session_type = SESSION_TYPE_NORMAL;
+	pthread_mutex_init(&target1.mutex, NULL);
+	pthread_mutex_init(&target2.mutex, NULL);
+	target1.pg = target2.pg = g_src_pg;
+	ut_conn_init(&conn1, &sess, &target1, desc1, 2);
+	ut_conn_init(&conn2, &sess, &target1, desc2, 2);
+	ut_conn_init(&conn3, &sess, &target2, desc3, 1);
+	conn3.load = 50;
+
+	/* target1 is picked, its connections drain while conn1 has a command in flight */
+	conn1.pending_task_cnt = 1;
+	ut_migrate_start(40);
+	CU_ASSERT(conn1.migrating == true);
+	CU_ASSERT(conn2.migrating == true);
+	CU_ASSERT(conn3.migrating == false);
+
+	/* New commands are left in the socket, which isn't polled until the migration ends */
+	set_thread(1);
+	iscsi_conn_sock_cb(&conn2, NULL, NULL);
+	CU_ASSERT(conn2.recv_paused == true);
+	CU_ASSERT(conn1.recv_paused == false);
+
+	/* The socket is polled again to receive the data of outstanding writes */
+	TAILQ_INSERT_TAIL(&conn2.active_r2t_tasks, &task, link);
+	ut_migrate_poll();
+	CU_ASSERT(conn2.recv_paused == false);
+	CU_ASSERT(g_migrate_done == false);
+	TAILQ_REMOVE(&conn2.active_r2t_tasks, &task, link);
+	set_thread(1);
+	iscsi_conn_sock_cb(&conn2, NULL, NULL);
+	CU_ASSERT(conn2.recv_paused == true);
+
+	/* Once drained, the connections move along with the I/O channels of their LUNs */
+	conn1.pending_task_cnt = 0;
+	ut_migrate_poll();
+	CU_ASSERT(g_migrate_done == true);
+	CU_ASSERT(g_migrate_rc == 0);
+	CU_ASSERT(target1.pg == g_dst_pg);
+	CU_ASSERT(target2.pg == g_src_pg);
+	CU_ASSERT(conn1.pg == g_dst_pg);
+	CU_ASSERT(conn2.pg == g_dst_pg);
+	CU_ASSERT(conn3.pg == g_src_pg);
+	CU_ASSERT(g_src_pg->num_conns == 1);
+	CU_ASSERT(g_dst_pg->num_conns == 2);
+	CU_ASSERT(STAILQ_FIRST(&g_src_pg->connections) == &conn3);
+	CU_ASSERT(conn1.migrating == false && conn1.recv_paused == false);
+	CU_ASSERT(conn2.migrating == false && conn2.recv_paused == false);
+	for (i = 0; i < 2; i++) {
+		CU_ASSERT(desc1[i].ch_ref == 1);
+		CU_ASSERT(desc1[i].ch_thread == ut_pg_thread(g_dst_pg));
+		CU_ASSERT(desc2[i].ch_ref == 1);
+		CU_ASSERT(desc2[i].ch_thread == ut_pg_thread(g_dst_pg));
+	}
+	CU_ASSERT(desc3[0].ch_thread == ut_pg_thread(g_src_pg));
+
+	ut_conn_fini(&conn1);
+	ut_conn_fini(&conn2);
+	ut_conn_fini(&conn3);
+	ut_poll_groups_fini();
+}
+
+static void
+migrate_conns_rollback_test(void)
+{
+	struct spdk_iscsi_tgt_node target = {};
+	struct spdk_iscsi_sess sess = {};
+	struct spdk_iscsi_conn conn1, conn2;
+	struct spdk_scsi_lun_desc desc1[2] = {}, desc2[1] = {};
+
+	ut_poll_groups_init();
+	sess.session_type = SESSION_TYPE_NORMAL;
+	pthread_mutex_init(&target.mutex, NULL);
+	target.pg = g_src_pg;
+	ut_conn_init(&conn1, &sess, &target, desc1, 2);
+	ut_conn_init(&conn2, &sess, &target, desc2, 1);
+
+	/* The LUN of conn2 can't get its I/O channel on the new thread, so all
+	 * connections go back with all their LUNs.
+	 */
+	desc2[0].fail_thread = ut_pg_thread(g_dst_pg);
+	ut_migrate_start(40);
+	ut_migrate_poll();
+	CU_ASSERT(g_migrate_done == true);
+	CU_ASSERT(g_migrate_rc == -EIO);
+	CU_ASSERT(target.pg == g_src_pg);
+	CU_ASSERT(conn1.pg == g_src_pg);
+	CU_ASSERT(conn2.pg == g_src_pg);
+	CU_ASSERT(g_src_pg->num_conns == 2);
+	CU_ASSERT(g_dst_pg->num_conns == 0);
+	CU_ASSERT(conn1.state == ISCSI_CONN_STATE_RUNNING);
+	CU_ASSERT(conn2.state == ISCSI_CONN_STATE_RUNNING);
+	CU_ASSERT(conn1.migrating == false);
+	CU_ASSERT(conn2.migrating == false);
+	CU_ASSERT(ut_conn_num_luns(&conn1) == 2);
+	CU_ASSERT(ut_conn_num_luns(&conn2) == 1);
+	CU_ASSERT(desc1[0].ch_ref == 1 && desc1[0].ch_thread == ut_pg_thread(g_src_pg));
+	CU_ASSERT(desc1[1].ch_ref == 1 && desc1[1].ch_thread == ut_pg_thread(g_src_pg));
+	CU_ASSERT(desc2[0].ch_ref == 1 && desc2[0].ch_thread == ut_pg_thread(g_src_pg));
+	CU_ASSERT(!desc1[0].closed && !desc1[1].closed && !desc2[0].closed);
+
+	/* If they can't be restored either, the connections are dropped */
+	MOCK_SET(spdk_scsi_lun_allocate_io_channel, -1);
+	ut_migrate_start(40);
+	ut_migrate_poll();
+	MOCK_CLEAR(spdk_scsi_lun_allocate_io_channel);
+	CU_ASSERT(g_migrate_done == true);
+	CU_ASSERT(g_migrate_rc == -EIO);
+	CU_ASSERT(target.pg == g_src_pg);
+	CU_ASSERT(g_src_pg->num_conns == 2);
+	CU_ASSERT(conn1.state == ISCSI_CONN_STATE_EXITING);
+	CU_ASSERT(conn2.state == ISCSI_CONN_STATE_EXITING);
+	CU_ASSERT(TAILQ_EMPTY(&conn1.luns));
+	CU_ASSERT(TAILQ_EMPTY(&conn2.luns));
+	CU_ASSERT(desc1[0].ch_ref == 0 && desc1[0].closed);
+	CU_ASSERT(desc1[1].ch_ref == 0 && desc1[1].closed);
+	CU_ASSERT(desc2[0].ch_ref == 0 && desc2[0].closed);
+
+	ut_conn_fini(&conn1);
+	ut_conn_fini(&conn2);
+	ut_poll_groups_fini();
+}
+
+static void
+migrate_conns_cancel_test(void)
+{
+	struct spdk_iscsi_tgt_node target = {};
+	struct spdk_iscsi_sess sess = {};
+	struct spdk_iscsi_conn conn1, conn2;
+	struct spdk_scsi_lun_desc desc1[1] = {}, desc2[1] = {};
+
+	ut_poll_groups_init();
+	sess.session_type = SESSION_TYPE_NORMAL;
+	pthread_mutex_init(&target.mutex, NULL);
+	target.pg = g_src_pg;
+	ut_conn_init(&conn1, &sess, &target, desc1, 1);
+	ut_conn_init(&conn2, &sess, &target, desc2, 1);
+
+	/* No target node is light enough to be moved */
+	ut_migrate_start(10);
+	CU_ASSERT(g_migrate_done == true);
+	CU_ASSERT(g_migrate_rc == -ENOENT);
+	CU_ASSERT(conn1.migrating == false);
+
+	/* The drain takes too long, the paused socket is polled again */
+	conn1.pending_task_cnt = 1;
+	ut_migrate_start(40);
+	set_thread(1);
+	iscsi_conn_sock_cb(&conn2, NULL, NULL);
+	CU_ASSERT(conn2.recv_paused == true);
+	spdk_delay_us(ISCSI_CONN_MIGRATION_TIMEOUT);
+	ut_migrate_poll();
+	CU_ASSERT(g_migrate_done == true);
+	CU_ASSERT(g_migrate_rc == -ETIMEDOUT);
+	CU_ASSERT(conn1.migrating == false);
+	CU_ASSERT(conn2.migrating == false);
+	CU_ASSERT(conn2.recv_paused == false);
+	CU_ASSERT(conn1.pg == g_src_pg);
+	CU_ASSERT(conn2.pg == g_src_pg);
+	conn1.pending_task_cnt = 0;
+
+	/* A connection going away cancels the migration */
+	ut_migrate_start(40);
+	conn2.state = ISCSI_CONN_STATE_EXITING;
+	ut_migrate_poll();
+	CU_ASSERT(g_migrate_done == true);
+	CU_ASSERT(g_migrate_rc == -ECANCELED);
+	CU_ASSERT(conn1.pg == g_src_pg);
+	conn2.state = ISCSI_CONN_STATE_RUNNING;
+
+	/* So does the target node having been moved elsewhere meanwhile */
+	ut_migrate_start(40);
+	target.pg = g_dst_pg;
+	ut_migrate_poll();
+	CU_ASSERT(g_migrate_done == true);
+	CU_ASSERT(g_migrate_rc == -ECANCELED);
+	CU_ASSERT(target.pg == g_dst_pg);
+	CU_ASSERT(conn1.pg == g_src_pg);
+	CU_ASSERT(conn2.pg == g_src_pg);
+	CU_ASSERT(g_src_pg->num_conns == 2);
+	CU_ASSERT(conn1.migrating == false);
+	CU_ASSERT(desc1[0].ch_ref == 1 && desc1[0].ch_thread == ut_pg_thread(g_src_pg));
+
+	ut_conn_fini(&conn1);
+	ut_conn_fini(&conn2);
+	ut_poll_groups_fini();
+}
+
+static void
+conn_msg_follow_migration_test(void)
+{
+	struct spdk_iscsi_tgt_node target = {};
+	struct spdk_iscsi_sess sess = {};
+	struct spdk_iscsi_conn conn;
+	struct spdk_scsi_lun_desc desc[1] = {};
+	struct spdk_iscsi_lun *iscsi_lun;
+
+	ut_poll_groups_init();
+	sess.session_type = SESSION_TYPE_NORMAL;
+	pthread_mutex_init(&target.mutex, NULL);
+	target.pg = g_src_pg;
+	ut_conn_init(&conn, &sess, &target, desc, 1);
+	iscsi_lun = TAILQ_FIRST(&conn.luns);
+
+	/* The connection moved after the messages were sent to the source thread */
+	iscsi_poll_group_remove_conn(g_src_pg, &conn);
+	conn.pg = g_dst_pg;
+	iscsi_poll_group_add_conn(g_dst_pg, &conn);
+
+	set_thread(1);
+	_iscsi_conn_hotremove_lun(iscsi_lun);
+	CU_ASSERT(iscsi_lun->remove_poller == NULL);
+	poll_threads();
+	CU_ASSERT(iscsi_lun->remove_poller != NULL);
+	set_thread(2);
+	spdk_poller_unregister(&iscsi_lun->remove_poller);
+
+	set_thread(1);
+	_iscsi_conn_drop(&conn);
+	CU_ASSERT(conn.state == ISCSI_CONN_STATE_RUNNING);
+	poll_threads();
+	CU_ASSERT(conn.state == ISCSI_CONN_STATE_EXITING);
+
+	ut_conn_fini(&conn);
+	ut_poll_groups_fini();
+}
+
 int
 main(int argc, char **argv)
 {
@@ -910,6 +1407,12 @@ main(int argc, char **argv)
 	CU_ADD_TEST(suite, free_tasks_with_queued_datain);
 	CU_ADD_TEST(suite, abort_queued_datain_task_test);
 	CU_ADD_TEST(suite, abort_queued_datain_tasks_test);
+	CU_ADD_TEST(suite, poll_group_least_loaded_test);
+	CU_ADD_TEST(suite, poll_group_pick_target_test);
+	CU_ADD_TEST(suite, migrate_conns_test);
+	CU_ADD_TEST(suite, migrate_conns_rollback_test);
+	CU_ADD_TEST(suite, migrate_conns_cancel_test);
+	CU_ADD_TEST(suite, conn_msg_follow_migration_test);
 
 	CU_basic_set_mode(CU_BRM_VERBOSE);
 	CU_basic_run_tests();
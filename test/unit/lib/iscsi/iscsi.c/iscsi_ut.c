@@ -2170,14 +2170,14 @@ check_pdu_payload_handle(struct spdk_iscsi_pdu *pdu, struct spdk_iscsi_task *pri
 }
 
 static void
-check_write_subtask_submit(struct spdk_scsi_lun *lun, struct spdk_mobj *mobj,
-			   struct spdk_iscsi_pdu *pdu,
-			   int index, uint32_t offset, uint32_t length)
+check_write_subtask_submit(struct spdk_scsi_lun *lun, struct spdk_mobj **mobjs, int mobjcnt,
+			   struct spdk_iscsi_pdu *pdu, uint32_t offset, uint32_t length)
 {
 	struct spdk_scsi_task *scsi_task;
 	struct spdk_iscsi_task *subtask;
 	uint32_t *data;
-	uint32_t i;
+	uint32_t i, data_offset = offset;
+	int j;
 
 	scsi_task = TAILQ_FIRST(&lun->tasks);
 	SPDK_CU_ASSERT_FATAL(scsi_task != NULL);
@@ -2186,16 +2186,23 @@ check_write_subtask_submit(struct spdk_scsi_lun *lun, struct spdk_mobj *mobj,
 	subtask = iscsi_task_from_scsi_task(scsi_task);
 
 	CU_ASSERT(iscsi_task_get_pdu(subtask) == pdu);
-	CU_ASSERT(pdu->mobj[index] == mobj);
+	CU_ASSERT(iscsi_task_get_mobj(subtask) == mobjs[0]);
 	CU_ASSERT(subtask->scsi.offset == offset);
 	CU_ASSERT(subtask->scsi.length == length);
-	CU_ASSERT(subtask->scsi.iovs[0].iov_base == mobj->buf);
-	CU_ASSERT(subtask->scsi.iovs[0].iov_len == length);
+	SPDK_CU_ASSERT_FATAL(subtask->scsi.iovcnt == mobjcnt);
+	CU_ASSERT(subtask->scsi.iovs == subtask->write_iovs);
 
-	data = (uint32_t *)mobj->buf;
-	for (i = 0; i < length; i += 4) {
-		CU_ASSERT(data[i / 4] == offset + i);
+	for (j = 0; j < mobjcnt; j++) {
+		CU_ASSERT(subtask->scsi.iovs[j].iov_base == mobjs[j]->buf);
+		CU_ASSERT(subtask->scsi.iovs[j].iov_len == mobjs[j]->data_len);
+
+		data = (uint32_t *)mobjs[j]->buf;
+		for (i = 0; i < mobjs[j]->data_len; i += 4) {
+			CU_ASSERT(data[i / 4] == data_offset + i);
+		}
+		data_offset += mobjs[j]->data_len;
 	}
+	CU_ASSERT(data_offset == offset + length);
 
 	free(subtask);
 }
@@ -2218,7 +2225,7 @@ data_out_pdu_sequence_test(void)
 	};
 	struct spdk_iscsi_task primary = {};
 	struct spdk_iscsi_pdu pdu = {};
-	struct spdk_mobj mobj1 = {}, mobj2 = {}, mobj3 = {};
+	struct spdk_mobj mobj1 = {}, mobj2 = {}, mobj3 = {}, *mobjs[3];
 	struct iscsi_bhs_data_out *data_reqh;
 	int rc;
 
@@ -2240,13 +2247,18 @@ data_out_pdu_sequence_test(void)
 	 * third PDU is SPDK_ISCSI_MAX_RECV_DATA_SEGMENT_LENGTH. Length of the data segment
 	 * of the final PDU is SPDK_ISCSI_MAX_RECV_DATA_SEGMENT_LENGTH / 2 + 8.
 	 *
-	 * Three data buffers should be used and three subtasks should be created and submitted.
+	 * Three data buffers should be used and a single subtask should be created and
+	 * submitted with the three data buffers when the final PDU is received.
 	 *
 	 * The test scenario assume that a iscsi_conn_read_data() call could read
 	 * the required length of the data and all read lengths are 4 bytes multiples.
 	 * The latter is to verify data is copied to the correct offset by using data patterns.
 	 */
 
+	mobjs[0] = &mobj1;
+	mobjs[1] = &mobj2;
+	mobjs[2] = &mobj3;
+
 	primary.scsi.transfer_len = 5 * SPDK_ISCSI_MAX_RECV_DATA_SEGMENT_LENGTH / 2;
 	primary.desired_data_transfer_length = primary.scsi.transfer_len;
 	TAILQ_INSERT_TAIL(&conn.active_r2t_tasks, &primary, link);
@@ -2314,10 +2326,11 @@ data_out_pdu_sequence_test(void)
 
 	rc = iscsi_pdu_payload_handle(&conn, &pdu);
 	CU_ASSERT(rc == 0);
-	check_pdu_payload_handle(&pdu, &primary, &mobj1, NULL, &mobj2,
-				 SPDK_ISCSI_MAX_RECV_DATA_SEGMENT_LENGTH);
+	check_pdu_payload_handle(&pdu, &primary, NULL, NULL, &mobj2, 0);
 
-	check_write_subtask_submit(&lun, &mobj1, &pdu, 0, 0, SPDK_ISCSI_MAX_RECV_DATA_SEGMENT_LENGTH);
+	/* The full data buffer is held until the sequence is completed. */
+	CU_ASSERT(primary.write_mobj == &mobj1);
+	CU_ASSERT(TAILQ_EMPTY(&lun.tasks));
 
 	/* The 4th and final Data-OUT PDU */
 	memset(&pdu, 0, sizeof(pdu));
@@ -2343,14 +2356,12 @@ data_out_pdu_sequence_test(void)
 
 	rc = iscsi_pdu_payload_handle(&conn, &pdu);
 	CU_ASSERT(rc == 0);
-	check_pdu_payload_handle(&pdu, &primary, &mobj2, &mobj3, NULL,
+	check_pdu_payload_handle(&pdu, &primary, NULL, NULL, NULL,
 				 5 * SPDK_ISCSI_MAX_RECV_DATA_SEGMENT_LENGTH / 2);
+	CU_ASSERT(primary.write_mobj == NULL);
 
-	check_write_subtask_submit(&lun, &mobj2, &pdu, 0, SPDK_ISCSI_MAX_RECV_DATA_SEGMENT_LENGTH,
-				   SPDK_ISCSI_MAX_RECV_DATA_SEGMENT_LENGTH);
-
-	check_write_subtask_submit(&lun, &mobj3, &pdu, 1, 2 * SPDK_ISCSI_MAX_RECV_DATA_SEGMENT_LENGTH,
-				   SPDK_ISCSI_MAX_RECV_DATA_SEGMENT_LENGTH / 2);
+	check_write_subtask_submit(&lun, mobjs, 3, &pdu, 0,
+				   5 * SPDK_ISCSI_MAX_RECV_DATA_SEGMENT_LENGTH / 2);
 
 	CU_ASSERT(TAILQ_EMPTY(&lun.tasks));
 
@@ -2381,7 +2392,7 @@ immediate_data_and_data_out_pdu_sequence_test(void)
 		.ttt = 1,
 	};
 	struct spdk_iscsi_pdu pdu = {};
-	struct spdk_mobj mobj = {};
+	struct spdk_mobj mobj = {}, *mobjs[1] = { &mobj };
 	struct spdk_iscsi_task *primary;
 	struct iscsi_bhs_scsi_req *scsi_reqh;
 	struct iscsi_bhs_data_out *data_reqh;
@@ -2572,9 +2583,9 @@ immediate_data_and_data_out_pdu_sequence_test(void)
 
 	rc = iscsi_pdu_payload_handle(&conn, &pdu);
 	CU_ASSERT(rc == 0);
-	check_pdu_payload_handle(&pdu, primary, &mobj, NULL, NULL, 65536);
+	check_pdu_payload_handle(&pdu, primary, NULL, NULL, NULL, 65536);
 
-	check_write_subtask_submit(&lun, &mobj, &pdu, 0, 0, 65536);
+	check_write_subtask_submit(&lun, mobjs, 1, &pdu, 0, 65536);
 
 	CU_ASSERT(TAILQ_EMPTY(&lun.tasks));
 
@@ -2584,6 +2595,78 @@ immediate_data_and_data_out_pdu_sequence_test(void)
 	free(mobj.buf);
 }
 
+static void
+data_out_pool_exhausted_test(void)
+{
+	struct spdk_scsi_lun lun = { .tasks = TAILQ_HEAD_INITIALIZER(lun.tasks), };
+	struct spdk_scsi_dev dev = { .luns = TAILQ_HEAD_INITIALIZER(dev.luns), };
+	struct spdk_iscsi_conn conn = {
+		.dev = &dev,
+		.active_r2t_tasks = TAILQ_HEAD_INITIALIZER(conn.active_r2t_tasks),
+		.queued_r2t_tasks = TAILQ_HEAD_INITIALIZER(conn.queued_r2t_tasks),
+	};
+	struct spdk_iscsi_task primary = {};
+	struct spdk_iscsi_pdu pdu = {};
+	struct spdk_mobj mobj1 = {}, mobj2 = {}, *mobjs[2] = { &mobj1, &mobj2 };
+	uint32_t *data;
+	uint32_t i;
+	int rc;
+
+	TAILQ_INSERT_TAIL(&dev.luns, &lun, tailq);
+
+	alloc_mock_mobj(&mobj1, SPDK_ISCSI_MAX_RECV_DATA_SEGMENT_LENGTH);
+	alloc_mock_mobj(&mobj2, SPDK_ISCSI_MAX_RECV_DATA_SEGMENT_LENGTH);
+
+	primary.scsi.transfer_len = 4 * SPDK_ISCSI_MAX_RECV_DATA_SEGMENT_LENGTH;
+	TAILQ_INSERT_TAIL(&conn.active_r2t_tasks, &primary, link);
+
+	/* Two full data buffers are merged by the primary task. */
+	data = (uint32_t *)mobj1.buf;
+	for (i = 0; i < SPDK_ISCSI_MAX_RECV_DATA_SEGMENT_LENGTH; i += 4) {
+		data[i / 4] = i;
+	}
+	mobj1.data_len = SPDK_ISCSI_MAX_RECV_DATA_SEGMENT_LENGTH;
+
+	data = (uint32_t *)mobj2.buf;
+	for (i = 0; i < SPDK_ISCSI_MAX_RECV_DATA_SEGMENT_LENGTH; i += 4) {
+		data[i / 4] = SPDK_ISCSI_MAX_RECV_DATA_SEGMENT_LENGTH + i;
+	}
+	mobj2.data_len = SPDK_ISCSI_MAX_RECV_DATA_SEGMENT_LENGTH;
+
+	rc = iscsi_task_add_write_mobj(&conn, &primary, NULL, &mobj1);
+	CU_ASSERT(rc == 0);
+	rc = iscsi_task_add_write_mobj(&conn, &primary, NULL, &mobj2);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(primary.write_mobj == &mobj1);
+	CU_ASSERT(primary.write_iovcnt == 2);
+	CU_ASSERT(TAILQ_EMPTY(&lun.tasks));
+
+	/* The next Data-OUT PDU cannot get a data buffer. The merged data buffers
+	 * should be submitted so that they are released when the write completes.
+	 */
+	pdu.bhs.opcode = ISCSI_OP_SCSI_DATAOUT;
+	pdu.data_segment_len = SPDK_ISCSI_MAX_RECV_DATA_SEGMENT_LENGTH;
+	pdu.data_buf_len = SPDK_ISCSI_MAX_RECV_DATA_SEGMENT_LENGTH;
+
+	MOCK_SET(spdk_mempool_get, NULL);
+
+	rc = iscsi_pdu_payload_read(&conn, &pdu);
+	CU_ASSERT(rc == 1);
+	CU_ASSERT(pdu.mobj[0] == NULL);
+	CU_ASSERT(primary.write_mobj == NULL);
+	CU_ASSERT(primary.write_iovcnt == 0);
+	CU_ASSERT(primary.current_data_offset == 2 * SPDK_ISCSI_MAX_RECV_DATA_SEGMENT_LENGTH);
+
+	check_write_subtask_submit(&lun, mobjs, 2, NULL, 0, 2 * SPDK_ISCSI_MAX_RECV_DATA_SEGMENT_LENGTH);
+
+	CU_ASSERT(TAILQ_EMPTY(&lun.tasks));
+
+	MOCK_CLEAR(spdk_mempool_get);
+
+	free(mobj1.buf);
+	free(mobj2.buf);
+}
+
 int
 main(int argc, char **argv)
 {
@@ -2619,6 +2702,7 @@ main(int argc, char **argv)
 	CU_ADD_TEST(suite, pdu_payload_read_test);
 	CU_ADD_TEST(suite, data_out_pdu_sequence_test);
 	CU_ADD_TEST(suite, immediate_data_and_data_out_pdu_sequence_test);
+	CU_ADD_TEST(suite, data_out_pool_exhausted_test);
 
 	CU_basic_set_mode(CU_BRM_VERBOSE);
 	CU_basic_run_tests();
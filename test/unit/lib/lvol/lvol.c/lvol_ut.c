@@ -42,12 +42,15 @@ struct spdk_blob {
 	char			uuid[SPDK_UUID_STRING_LEN];
 	char			name[SPDK_LVS_NAME_MAX];
 	bool			thin_provisioned;
+	uint64_t		num_clusters;
 };
 
 int g_lvserrno;
 int g_close_super_status;
 int g_resize_rc;
 int g_inflate_rc;
+int g_reclaim_rc;
+uint64_t g_reclaim_calls;
 int g_remove_rc;
 bool g_lvs_rename_blob_open_error = false;
 struct spdk_lvol_store *g_lvol_store;
@@ -120,7 +123,18 @@ spdk_bs_iter_first(struct spdk_blob_store *bs,
 uint64_t
 spdk_blob_get_num_clusters(struct spdk_blob *blob)
 {
-	return 0;
+	return blob->num_clusters;
+}
+
+void
+spdk_blob_reclaim_zeroed_clusters(struct spdk_blob *blob, uint64_t cluster_offset,
+				  uint64_t cluster_count,
+				  spdk_blob_op_with_clusters_complete cb_fn, void *cb_arg)
+{
+	CU_ASSERT(cluster_offset + cluster_count <= blob->num_clusters);
+	g_reclaim_calls++;
+	/* Pretend that one cluster of each chunk was zeroed */
+	cb_fn(cb_arg, g_reclaim_rc == 0 ? 1 : 0, g_reclaim_rc);
 }
 
 void
@@ -351,6 +365,10 @@ spdk_blob_resize(struct spdk_blob *blob, uint64_t sz, spdk_blob_op_complete cb_f
 }
 
 DEFINE_STUB(spdk_blob_set_read_only, int, (struct spdk_blob *blob), 0);
+DEFINE_STUB(spdk_blob_is_read_only, bool, (struct spdk_blob *blob), false);
+DEFINE_STUB(spdk_blob_is_snapshot, bool, (struct spdk_blob *blob), false);
+DEFINE_STUB(spdk_blob_get_changed_clusters, int, (struct spdk_blob *blob, spdk_blob_id base_id,
+		struct spdk_bit_array *clusters), 0);
 
 void
 spdk_blob_sync_md(struct spdk_blob *blob, spdk_blob_op_complete cb_fn, void *cb_arg)
@@ -2037,6 +2055,110 @@ lvol_decouple_parent(void)
 	CU_ASSERT(g_io_channel == NULL);
 }
 
+static void
+reclaim_complete(void *cb_arg, int lvolerrno)
+{
+	*(int *)cb_arg = lvolerrno;
+}
+
+static void
+lvol_reclaim_space(void)
+{
+	struct lvol_ut_bs_dev dev;
+	struct spdk_lvs_opts opts;
+	struct spdk_lvol_reclaim_status status;
+	int reclaim_rc;
+	int rc = 0;
+
+	init_dev(&dev);
+
+	spdk_lvs_opts_init(&opts);
+	snprintf(opts.name, sizeof(opts.name), "lvs");
+
+	g_lvserrno = -1;
+	rc = spdk_lvs_init(&dev.bs_dev, &opts, lvol_store_op_with_handle_complete, NULL);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(g_lvserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_lvol_store != NULL);
+
+	/* Thick provisioned lvol has nothing to reclaim */
+	spdk_lvol_create(g_lvol_store, "lvol", 10, false, LVOL_CLEAR_WITH_DEFAULT,
+			 lvol_op_with_handle_complete, NULL);
+	CU_ASSERT(g_lvserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_lvol != NULL);
+
+	rc = spdk_lvol_reclaim_space(g_lvol, 0, op_complete, NULL);
+	CU_ASSERT(rc == -EINVAL);
+
+	spdk_lvol_close(g_lvol, op_complete, NULL);
+	CU_ASSERT(g_lvserrno == 0);
+	spdk_lvol_destroy(g_lvol, op_complete, NULL);
+	CU_ASSERT(g_lvserrno == 0);
+
+	spdk_lvol_create(g_lvol_store, "lvol", 10, true, LVOL_CLEAR_WITH_DEFAULT,
+			 lvol_op_with_handle_complete, NULL);
+	CU_ASSERT(g_lvserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_lvol != NULL);
+	g_lvol->blob->num_clusters = 2 * LVOL_RECLAIM_CHUNK_CLUSTERS + 1;
+
+	/* Reclamation runs in chunks from a poller */
+	g_reclaim_calls = 0;
+	g_lvserrno = -1;
+	rc = spdk_lvol_reclaim_space(g_lvol, 0, op_complete, NULL);
+	CU_ASSERT(rc == 0);
+	spdk_lvol_get_reclaim_status(g_lvol, &status);
+	CU_ASSERT(status.in_progress == true);
+	CU_ASSERT(status.total_clusters == 2 * LVOL_RECLAIM_CHUNK_CLUSTERS + 1);
+	CU_ASSERT(status.scanned_clusters == 0);
+
+	rc = spdk_lvol_reclaim_space(g_lvol, 0, op_complete, NULL);
+	CU_ASSERT(rc == -EBUSY);
+
+	poll_threads();
+	CU_ASSERT(g_lvserrno == 0);
+	CU_ASSERT(g_reclaim_calls == 3);
+	spdk_lvol_get_reclaim_status(g_lvol, &status);
+	CU_ASSERT(status.in_progress == false);
+	CU_ASSERT(status.scanned_clusters == 2 * LVOL_RECLAIM_CHUNK_CLUSTERS + 1);
+	CU_ASSERT(status.released_clusters == 3);
+	CU_ASSERT(status.result == 0);
+
+	/* Error from the blobstore stops reclamation */
+	g_reclaim_rc = -EIO;
+	g_lvserrno = -1;
+	rc = spdk_lvol_reclaim_space(g_lvol, 0, op_complete, NULL);
+	CU_ASSERT(rc == 0);
+	poll_threads();
+	CU_ASSERT(g_lvserrno == -EIO);
+	spdk_lvol_get_reclaim_status(g_lvol, &status);
+	CU_ASSERT(status.in_progress == false);
+	CU_ASSERT(status.scanned_clusters == 0);
+	CU_ASSERT(status.result == -EIO);
+	g_reclaim_rc = 0;
+
+	/* Closing the lvol cancels reclamation before the blob is closed */
+	reclaim_rc = -1;
+	rc = spdk_lvol_reclaim_space(g_lvol, 0, reclaim_complete, &reclaim_rc);
+	CU_ASSERT(rc == 0);
+	g_lvserrno = -1;
+	spdk_lvol_close(g_lvol, op_complete, NULL);
+	CU_ASSERT(reclaim_rc == -ECANCELED);
+	CU_ASSERT(g_lvserrno == 0);
+	CU_ASSERT(g_lvol->reclaim_req == NULL);
+	poll_threads();
+
+	spdk_lvol_destroy(g_lvol, op_complete, NULL);
+	CU_ASSERT(g_lvserrno == 0);
+
+	g_lvserrno = -1;
+	rc = spdk_lvs_unload(g_lvol_store, op_complete, NULL);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(g_lvserrno == 0);
+	g_lvol_store = NULL;
+
+	free_dev(&dev);
+}
+
 static void
 lvol_get_xattr(void)
 {
@@ -2126,6 +2248,7 @@ main(int argc, char **argv)
 	CU_ADD_TEST(suite, lvs_rename);
 	CU_ADD_TEST(suite, lvol_inflate);
 	CU_ADD_TEST(suite, lvol_decouple_parent);
+	CU_ADD_TEST(suite, lvol_reclaim_space);
 	CU_ADD_TEST(suite, lvol_get_xattr);
 
 	allocate_threads(1);
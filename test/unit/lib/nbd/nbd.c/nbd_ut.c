@@ -0,0 +1,292 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (C) 2023 Intel Corporation.
+ *   All rights reserved.
+ */
+
+#include "spdk/stdinc.h"
+
+#include "spdk_internal/mock.h"
+
+#include "spdk_cunit.h"
+
+#include "common/lib/ut_multithread.c"
+#include "unit/lib/json_mock.c"
+#include "nbd/nbd.c"
+
+DEFINE_STUB_V(spdk_bdev_free_io, (struct spdk_bdev_io *bdev_io));
+DEFINE_STUB_V(spdk_bdev_close, (struct spdk_bdev_desc *desc));
+DEFINE_STUB(spdk_bdev_open_ext, int, (const char *bdev_name, bool write,
+				      spdk_bdev_event_cb_t event_cb, void *event_ctx,
+				      struct spdk_bdev_desc **desc), -ENODEV);
+DEFINE_STUB(spdk_bdev_desc_get_bdev, struct spdk_bdev *, (struct spdk_bdev_desc *desc), NULL);
+DEFINE_STUB(spdk_bdev_get_name, const char *, (const struct spdk_bdev *bdev), "Malloc0");
+DEFINE_STUB(spdk_bdev_get_block_size, uint32_t, (const struct spdk_bdev *bdev), 512);
+DEFINE_STUB(spdk_bdev_get_num_blocks, uint64_t, (const struct spdk_bdev *bdev), 1024);
+DEFINE_STUB(spdk_bdev_get_buf_align, size_t, (const struct spdk_bdev *bdev), 1);
+DEFINE_STUB(spdk_bdev_io_type_supported, bool, (struct spdk_bdev *bdev,
+		enum spdk_bdev_io_type io_type), false);
+DEFINE_STUB(spdk_bdev_get_io_channel, struct spdk_io_channel *, (struct spdk_bdev_desc *desc),
+	    NULL);
+DEFINE_STUB(spdk_bdev_queue_io_wait, int, (struct spdk_bdev *bdev, struct spdk_io_channel *ch,
+		struct spdk_bdev_io_wait_entry *entry), 0);
+DEFINE_STUB(spdk_bdev_read, int, (struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+				  void *buf, uint64_t offset, uint64_t nbytes,
+				  spdk_bdev_io_completion_cb cb, void *cb_arg), 0);
+DEFINE_STUB(spdk_bdev_write, int, (struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+				   void *buf, uint64_t offset, uint64_t nbytes,
+				   spdk_bdev_io_completion_cb cb, void *cb_arg), 0);
+DEFINE_STUB(spdk_bdev_flush, int, (struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+				   uint64_t offset, uint64_t length,
+				   spdk_bdev_io_completion_cb cb, void *cb_arg), 0);
+DEFINE_STUB(spdk_bdev_unmap, int, (struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+				   uint64_t offset, uint64_t nbytes,
+				   spdk_bdev_io_completion_cb cb, void *cb_arg), 0);
+
+#define UT_NUM_REQS	200
+#define UT_WRITE_SIZE	512
+
+/* Both ends of the socket pair, the kernel writes the requests into the first one */
+static int g_sp[2];
+static struct spdk_nbd_disk g_nbd;
+static struct nbd_conn g_conn;
+
+static void
+ut_conn_init(void)
+{
+	int rc, flag;
+
+	rc = socketpair(AF_UNIX, SOCK_STREAM, 0, g_sp);
+	SPDK_CU_ASSERT_FATAL(rc == 0);
+	flag = fcntl(g_sp[1], F_GETFL);
+	rc = fcntl(g_sp[1], F_SETFL, flag | O_NONBLOCK);
+	SPDK_CU_ASSERT_FATAL(rc == 0);
+
+	memset(&g_nbd, 0, sizeof(g_nbd));
+	g_nbd.buf_align = 64;
+	g_nbd.thread = spdk_get_thread();
+
+	memset(&g_conn, 0, sizeof(g_conn));
+	g_conn.nbd = &g_nbd;
+	g_conn.thread = spdk_get_thread();
+	g_conn.kernel_sp_fd = g_sp[0];
+	g_conn.spdk_sp_fd = g_sp[1];
+	TAILQ_INIT(&g_conn.received_io_list);
+	TAILQ_INIT(&g_conn.executed_io_list);
+	TAILQ_INIT(&g_conn.processing_io_list);
+}
+
+static void
+ut_conn_fini(void)
+{
+	struct nbd_io *io;
+
+	while ((io = TAILQ_FIRST(&g_conn.received_io_list)) != NULL) {
+		TAILQ_REMOVE(&g_conn.received_io_list, io, tailq);
+		nbd_put_io(&g_conn, io);
+	}
+	if (g_conn.io_in_recv != NULL) {
+		nbd_put_io(&g_conn, g_conn.io_in_recv);
+		g_conn.io_in_recv = NULL;
+	}
+	CU_ASSERT_EQUAL(g_conn.io_count, 0);
+
+	close(g_sp[0]);
+	close(g_sp[1]);
+}
+
+/* Queue a request on the socket as the kernel would */
+static void
+ut_send_req(uint32_t type, uint64_t handle, uint64_t from, uint32_t len, const void *payload)
+{
+	struct nbd_request req = {};
+	ssize_t rc;
+
+	to_be32(&req.magic, NBD_REQUEST_MAGIC);
+	to_be32(&req.type, type);
+	memcpy(req.handle, &handle, sizeof(handle));
+	to_be64(&req.from, from);
+	to_be32(&req.len, len);
+
+	rc = write(g_sp[0], &req, sizeof(req));
+	SPDK_CU_ASSERT_FATAL(rc == sizeof(req));
+	if (payload != NULL) {
+		rc = write(g_sp[0], payload, len);
+		SPDK_CU_ASSERT_FATAL(rc == (ssize_t)len);
+	}
+}
+
+static uint32_t
+ut_check_received(uint32_t first, uint32_t type, uint32_t len)
+{
+	struct nbd_io *io;
+	uint64_t handle;
+	uint32_t i = first;
+
+	TAILQ_FOREACH(io, &g_conn.received_io_list, tailq) {
+		memcpy(&handle, io->req.handle, sizeof(handle));
+		CU_ASSERT_EQUAL(handle, i);
+		CU_ASSERT_EQUAL(from_be32(&io->req.type), type);
+		CU_ASSERT_EQUAL(from_be64(&io->req.from), (uint64_t)i * 4096);
+		CU_ASSERT_EQUAL(io->payload_size, len);
+		CU_ASSERT_EQUAL(io->state, NBD_IO_XMIT_RESP);
+		i++;
+	}
+
+	return i - first;
+}
+
+static void
+test_recv_read_ahead(void)
+{
+	uint32_t i, num_reqs;
+	int rc;
+
+	ut_conn_init();
+
+	/*
+	 * Far more headers than GET_IO_LOOP_COUNT fit into one read ahead, and the last one
+	 * read is cut in the middle. None of the requests read ahead may be left behind.
+	 */
+	SPDK_CU_ASSERT_FATAL(NBD_RECV_BUF_SIZE / sizeof(struct nbd_request) > GET_IO_LOOP_COUNT);
+	SPDK_CU_ASSERT_FATAL(NBD_RECV_BUF_SIZE % sizeof(struct nbd_request) != 0);
+	SPDK_CU_ASSERT_FATAL(UT_NUM_REQS * sizeof(struct nbd_request) > NBD_RECV_BUF_SIZE);
+	for (i = 0; i < UT_NUM_REQS; i++) {
+		ut_send_req(NBD_CMD_READ, i, (uint64_t)i * 4096, 4096, NULL);
+	}
+
+	rc = nbd_io_recv(&g_conn);
+	CU_ASSERT_EQUAL(rc, NBD_RECV_BUF_SIZE);
+	CU_ASSERT(!nbd_conn_has_read_ahead(&g_conn));
+	num_reqs = ut_check_received(0, NBD_CMD_READ, 4096);
+	CU_ASSERT_EQUAL(num_reqs, NBD_RECV_BUF_SIZE / sizeof(struct nbd_request));
+	/* The cut header waits for the rest, which is still in the socket */
+	SPDK_CU_ASSERT_FATAL(g_conn.io_in_recv != NULL);
+	CU_ASSERT_EQUAL(g_conn.io_in_recv->offset, NBD_RECV_BUF_SIZE % sizeof(struct nbd_request));
+
+	rc = nbd_io_recv(&g_conn);
+	CU_ASSERT_EQUAL(rc, UT_NUM_REQS * sizeof(struct nbd_request) - NBD_RECV_BUF_SIZE);
+	CU_ASSERT(!nbd_conn_has_read_ahead(&g_conn));
+	num_reqs = ut_check_received(0, NBD_CMD_READ, 4096);
+	CU_ASSERT_EQUAL(num_reqs, UT_NUM_REQS);
+	CU_ASSERT_PTR_NULL(g_conn.io_in_recv);
+	CU_ASSERT_EQUAL(g_conn.io_count, UT_NUM_REQS);
+
+	/* Nothing left */
+	rc = nbd_io_recv(&g_conn);
+	CU_ASSERT_EQUAL(rc, 0);
+	CU_ASSERT_EQUAL(g_conn.io_count, UT_NUM_REQS + 1);
+
+	ut_conn_fini();
+}
+
+static void
+test_recv_read_ahead_payload(void)
+{
+	struct nbd_io *io;
+	uint8_t payload[UT_WRITE_SIZE];
+	uint32_t i, num_reqs = 0;
+	int rc;
+
+	ut_conn_init();
+
+	/* Write payloads are taken from the read ahead buffer, then from the socket */
+	for (i = 0; i < GET_IO_LOOP_COUNT * 2; i++) {
+		memset(payload, i, sizeof(payload));
+		ut_send_req(NBD_CMD_WRITE, i, (uint64_t)i * 4096, sizeof(payload), payload);
+	}
+	/* Headers without payload behind them */
+	for (; i < GET_IO_LOOP_COUNT * 4; i++) {
+		ut_send_req(NBD_CMD_FLUSH, i, (uint64_t)i * 4096, 0, NULL);
+	}
+
+	for (i = 0; i < 8 && num_reqs < GET_IO_LOOP_COUNT * 4; i++) {
+		rc = nbd_io_recv(&g_conn);
+		CU_ASSERT(rc > 0);
+		/* Whatever is left must still be in the socket, so it's signaled again */
+		CU_ASSERT(!nbd_conn_has_read_ahead(&g_conn));
+		num_reqs = 0;
+		TAILQ_FOREACH(io, &g_conn.received_io_list, tailq) {
+			num_reqs++;
+		}
+	}
+	CU_ASSERT_EQUAL(num_reqs, GET_IO_LOOP_COUNT * 4);
+
+	i = 0;
+	TAILQ_FOREACH(io, &g_conn.received_io_list, tailq) {
+		if (i < GET_IO_LOOP_COUNT * 2) {
+			CU_ASSERT_EQUAL(from_be32(&io->req.type), NBD_CMD_WRITE);
+			SPDK_CU_ASSERT_FATAL(io->payload_size == UT_WRITE_SIZE);
+			memset(payload, i, sizeof(payload));
+			CU_ASSERT(memcmp(io->payload, payload, sizeof(payload)) == 0);
+		} else {
+			CU_ASSERT_EQUAL(from_be32(&io->req.type), NBD_CMD_FLUSH);
+			CU_ASSERT_EQUAL(io->payload_size, 0);
+		}
+		i++;
+	}
+
+	ut_conn_fini();
+}
+
+static void
+test_recv_disconnect(void)
+{
+	int rc;
+
+	ut_conn_init();
+
+	/* Nothing is accepted after NBD_CMD_DISC, even if it was read ahead */
+	ut_send_req(NBD_CMD_READ, 0, 0, 4096, NULL);
+	ut_send_req(NBD_CMD_DISC, 1, 0, 0, NULL);
+	ut_send_req(NBD_CMD_READ, 2, 8192, 4096, NULL);
+
+	rc = nbd_io_recv(&g_conn);
+	CU_ASSERT_EQUAL(rc, 2 * sizeof(struct nbd_request));
+	CU_ASSERT(g_conn.is_closing);
+	CU_ASSERT_EQUAL(ut_check_received(0, NBD_CMD_READ, 4096), 1);
+	CU_ASSERT_EQUAL(nbd_io_recv(&g_conn), 0);
+
+	/* The connection asked the disk to stop */
+	poll_threads();
+	CU_ASSERT(g_nbd.is_closing);
+	ut_conn_fini();
+}
+
+static int
+nbd_ut_init(void)
+{
+	allocate_threads(1);
+	set_thread(0);
+
+	return 0;
+}
+
+static int
+nbd_ut_fini(void)
+{
+	free_threads();
+
+	return 0;
+}
+
+int
+main(int argc, char **argv)
+{
+	CU_pSuite suite = NULL;
+	unsigned int num_failures;
+
+	CU_set_error_action(CUEA_ABORT);
+	CU_initialize_registry();
+
+	suite = CU_add_suite("nbd", nbd_ut_init, nbd_ut_fini);
+	CU_ADD_TEST(suite, test_recv_read_ahead);
+	CU_ADD_TEST(suite, test_recv_read_ahead_payload);
+	CU_ADD_TEST(suite, test_recv_disconnect);
+
+	CU_basic_set_mode(CU_BRM_VERBOSE);
+	CU_basic_run_tests();
+	num_failures = CU_get_number_of_failures();
+	CU_cleanup_registry();
+
+	return num_failures;
+}
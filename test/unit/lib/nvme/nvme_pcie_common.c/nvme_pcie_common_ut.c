@@ -40,8 +40,14 @@ DEFINE_STUB_V(nvme_qpair_deinit, (struct spdk_nvme_qpair *qpair));
 DEFINE_STUB(nvme_ctrlr_get_current_process, struct spdk_nvme_ctrlr_process *,
 	    (struct spdk_nvme_ctrlr *ctrlr), NULL);
 
-DEFINE_STUB(spdk_nvme_qpair_process_completions, int32_t,
-	    (struct spdk_nvme_qpair *qpair, uint32_t max_completions), 0);
+static uint32_t g_process_completions_calls;
+
+int32_t
+spdk_nvme_qpair_process_completions(struct spdk_nvme_qpair *qpair, uint32_t max_completions)
+{
+	g_process_completions_calls++;
+	return 0;
+}
 
 DEFINE_STUB(nvme_request_check_timeout, int, (struct nvme_request *req, uint16_t cid,
 		struct spdk_nvme_ctrlr_process *active_proc, uint64_t now_tick), 0);
@@ -579,6 +585,249 @@ test_nvme_pcie_poll_group_get_stats(void)
 	CU_ASSERT(rc == 0);
 }
 
+static void
+test_nvme_pcie_poll_group_process_completions(void)
+{
+	struct spdk_nvme_transport_poll_group *tgroup;
+	struct spdk_nvme_transport_poll_group_stat *tgroup_stat = NULL;
+	struct spdk_nvme_pcie_qpair_stat *qpair_stat;
+	struct nvme_pcie_poll_group *pgroup;
+	struct nvme_pcie_ctrlr pctrlr = {};
+	struct nvme_pcie_qpair pqpair[2] = {};
+	struct spdk_nvme_cpl cpl[2][2] = {};
+	uint32_t sq_tdbl[2] = {}, cq_hdbl[2] = {};
+	int64_t rc;
+	int i;
+
+	tgroup = nvme_pcie_poll_group_create();
+	SPDK_CU_ASSERT_FATAL(tgroup != NULL);
+	pgroup = nvme_pcie_poll_group(tgroup);
+	STAILQ_INIT(&tgroup->connected_qpairs);
+	STAILQ_INIT(&tgroup->disconnected_qpairs);
+	snprintf(pctrlr.ctrlr.trid.traddr, sizeof(pctrlr.ctrlr.trid.traddr), "0000:01:00.0");
+
+	for (i = 0; i < 2; i++) {
+		pqpair[i].qpair.ctrlr = &pctrlr.ctrlr;
+		pqpair[i].qpair.id = i + 1;
+		pqpair[i].qpair.poll_group = tgroup;
+		pqpair[i].qpair.poll_group_tailq_head = &tgroup->connected_qpairs;
+		STAILQ_INIT(&pqpair[i].qpair.err_req_head);
+		STAILQ_INIT(&pqpair[i].qpair.aborting_queued_req);
+		nvme_qpair_set_state(&pqpair[i].qpair, NVME_QPAIR_ENABLED);
+		pqpair[i].pcie_state = NVME_PCIE_QPAIR_READY;
+		pqpair[i].stat = &pgroup->stats;
+		pqpair[i].shared_stats = true;
+		pqpair[i].cpl = cpl[i];
+		pqpair[i].num_entries = 2;
+		pqpair[i].max_completions_cap = 1;
+		pqpair[i].flags.phase = 1;
+		pqpair[i].sq_tdbl = &sq_tdbl[i];
+		pqpair[i].cq_hdbl = &cq_hdbl[i];
+		STAILQ_INSERT_TAIL(&tgroup->connected_qpairs, &pqpair[i].qpair, poll_group_stailq);
+	}
+
+	/* Both CQs are empty, so neither qpair enters the generic completion path */
+	g_process_completions_calls = 0;
+	rc = nvme_pcie_poll_group_process_completions(tgroup, 0, NULL);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(g_process_completions_calls == 0);
+	CU_ASSERT(pgroup->stats.polls == 2);
+	CU_ASSERT(pgroup->stats.idle_polls == 2);
+	CU_ASSERT(pgroup->stats.skipped_polls == 2);
+	CU_ASSERT(pqpair[0].polls == 1 && pqpair[0].idle_polls == 1);
+	CU_ASSERT(pgroup->in_process_completions == false);
+
+	/* A completion posted to the first CQ sends it down the regular path */
+	cpl[0][0].status.p = 1;
+	rc = nvme_pcie_poll_group_process_completions(tgroup, 0, NULL);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(g_process_completions_calls == 1);
+	CU_ASSERT(pgroup->stats.skipped_polls == 3);
+	cpl[0][0].status.p = 0;
+
+	/* So does a pending deferred submission */
+	pqpair[1].flags.delay_cmd_submit = 1;
+	pqpair[1].sq_tail = 1;
+	rc = nvme_pcie_poll_group_process_completions(tgroup, 0, NULL);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(g_process_completions_calls == 2);
+	CU_ASSERT(pgroup->stats.skipped_polls == 4);
+	pqpair[1].flags.delay_cmd_submit = 0;
+
+	/* CQ head updates are queued once per qpair and written back together */
+	pgroup->in_process_completions = true;
+	pqpair[0].cq_head = 1;
+	pqpair[1].cq_head = 1;
+	nvme_pcie_qpair_defer_cq_doorbell(&pqpair[0].qpair);
+	nvme_pcie_qpair_defer_cq_doorbell(&pqpair[1].qpair);
+	nvme_pcie_qpair_defer_cq_doorbell(&pqpair[0].qpair);
+	pgroup->in_process_completions = false;
+	CU_ASSERT(pqpair[0].flags.cq_doorbell_pending == 1);
+	CU_ASSERT(cq_hdbl[0] == 0 && cq_hdbl[1] == 0);
+	CU_ASSERT(pgroup->stats.cq_mmio_doorbell_updates == 0);
+
+	rc = nvme_pcie_poll_group_process_completions(tgroup, 0, NULL);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(TAILQ_EMPTY(&pgroup->cq_doorbell_pending));
+	CU_ASSERT(pqpair[0].flags.cq_doorbell_pending == 0);
+	CU_ASSERT(cq_hdbl[0] == 1 && cq_hdbl[1] == 1);
+	CU_ASSERT(pgroup->stats.cq_mmio_doorbell_updates == 2);
+
+	/* Disconnecting a qpair writes back its deferred update */
+	pqpair[1].cq_head = 0;
+	nvme_pcie_qpair_defer_cq_doorbell(&pqpair[1].qpair);
+	nvme_pcie_poll_group_disconnect_qpair(&pqpair[1].qpair);
+	CU_ASSERT(pqpair[1].flags.cq_doorbell_pending == 0);
+	CU_ASSERT(cq_hdbl[1] == 0);
+	CU_ASSERT(pgroup->stats.cq_mmio_doorbell_updates == 3);
+
+	/* Per-qpair poll counters are reported with the group statistics */
+	rc = nvme_pcie_poll_group_get_stats(tgroup, &tgroup_stat);
+	CU_ASSERT(rc == 0);
+	SPDK_CU_ASSERT_FATAL(tgroup_stat != NULL);
+	CU_ASSERT(tgroup_stat->pcie.skipped_polls == 6);
+	SPDK_CU_ASSERT_FATAL(tgroup_stat->pcie.num_qpairs == 2);
+	qpair_stat = &tgroup_stat->pcie.qpair_stats[0];
+	CU_ASSERT(strcmp(qpair_stat->traddr, "0000:01:00.0") == 0);
+	CU_ASSERT(qpair_stat->qid == 1);
+	CU_ASSERT(qpair_stat->polls == 3);
+	CU_ASSERT(qpair_stat->idle_polls == 3);
+	qpair_stat = &tgroup_stat->pcie.qpair_stats[1];
+	CU_ASSERT(qpair_stat->qid == 2);
+	CU_ASSERT(qpair_stat->polls == 3);
+	nvme_pcie_poll_group_free_stats(tgroup, tgroup_stat);
+
+	STAILQ_INIT(&tgroup->connected_qpairs);
+	rc = nvme_pcie_poll_group_destroy(tgroup);
+	CU_ASSERT(rc == 0);
+}
+
+static void
+test_nvme_pcie_qpair_adaptive_sq_doorbell(void)
+{
+	struct nvme_pcie_ctrlr pctrlr = {};
+	struct nvme_pcie_qpair pqpair = {};
+	struct spdk_nvme_pcie_stat stat = {};
+	struct spdk_nvme_cmd cmd[64] = {};
+	struct nvme_request req = {};
+	struct nvme_tracker tr = {};
+	uint32_t sq_tdbl = 0;
+	int i;
+
+	pqpair.qpair.ctrlr = &pctrlr.ctrlr;
+	pqpair.cmd = cmd;
+	pqpair.num_entries = 64;
+	pqpair.sq_tdbl = &sq_tdbl;
+	pqpair.stat = &stat;
+	pqpair.flags.adaptive_cmd_submit = 1;
+	pqpair.sq_db.batch = 1;
+	pqpair.sq_db.max_delay_ticks = 10;
+	tr.req = &req;
+
+	/* Nothing else is outstanding, so the doorbell is written right away */
+	pqpair.num_outstanding_tr = 1;
+	nvme_pcie_qpair_submit_tracker(&pqpair.qpair, &tr);
+	CU_ASSERT(sq_tdbl == 1);
+	CU_ASSERT(stat.sq_mmio_doorbell_updates == 1);
+	CU_ASSERT(pqpair.sq_db.pending == 0);
+
+	/* Queued requests and parents of split requests do not keep the controller
+	 * busy, only commands submitted to the SQ do.
+	 */
+	pqpair.qpair.num_outstanding_reqs = 32;
+	pqpair.sq_db.batch = 4;
+	nvme_pcie_qpair_submit_tracker(&pqpair.qpair, &tr);
+	CU_ASSERT(sq_tdbl == 2);
+	CU_ASSERT(stat.sq_mmio_doorbell_updates == 2);
+	CU_ASSERT(pqpair.sq_db.pending == 0);
+
+	/* Under load, commands are coalesced until the batch target is reached */
+	pqpair.num_outstanding_tr = 32;
+	for (i = 0; i < 3; i++) {
+		nvme_pcie_qpair_submit_tracker(&pqpair.qpair, &tr);
+	}
+	CU_ASSERT(sq_tdbl == 2);
+	CU_ASSERT(stat.sq_coalesced_submissions == 3);
+	CU_ASSERT(pqpair.sq_db.pending == 3);
+	nvme_pcie_qpair_submit_tracker(&pqpair.qpair, &tr);
+	CU_ASSERT(sq_tdbl == 6);
+	CU_ASSERT(pqpair.last_sq_tail == 6);
+	CU_ASSERT(stat.sq_mmio_doorbell_updates == 3);
+
+	/* The oldest pending command never waits longer than the maximum delay */
+	nvme_pcie_qpair_submit_tracker(&pqpair.qpair, &tr);
+	CU_ASSERT(sq_tdbl == 6);
+	spdk_delay_us(10);
+	nvme_pcie_qpair_submit_tracker(&pqpair.qpair, &tr);
+	CU_ASSERT(sq_tdbl == 8);
+	CU_ASSERT(stat.sq_mmio_doorbell_updates == 4);
+
+	/* A completion poll submits pending commands and follows the submission rate */
+	nvme_pcie_qpair_submit_tracker(&pqpair.qpair, &tr);
+	CU_ASSERT(sq_tdbl == 8);
+	pqpair.sq_db.rate = 0;
+	pqpair.sq_db.submits = 128;
+	nvme_pcie_qpair_adapt_sq_doorbell(&pqpair.qpair);
+	CU_ASSERT(sq_tdbl == 9);
+	CU_ASSERT(pqpair.sq_db.submits == 0);
+	CU_ASSERT(pqpair.sq_db.rate == 128);
+	CU_ASSERT(pqpair.sq_db.batch == 4);
+
+	/* The batch target decays once the submission rate drops */
+	for (i = 0; i < 32; i++) {
+		nvme_pcie_qpair_adapt_sq_doorbell(&pqpair.qpair);
+	}
+	CU_ASSERT(pqpair.sq_db.batch == 1);
+	CU_ASSERT(stat.sq_mmio_doorbell_updates == 5);
+}
+
+static void
+test_nvme_pcie_qpair_shadow_sq_doorbell(void)
+{
+	struct nvme_pcie_ctrlr pctrlr = {};
+	struct nvme_pcie_qpair pqpair = {};
+	struct spdk_nvme_pcie_stat stat = {};
+	struct spdk_nvme_cmd cmd[64] = {};
+	struct nvme_request req = {};
+	struct nvme_tracker tr = {};
+	uint32_t sq_tdbl = 0, shadow_sq_tdbl = 0, sq_eventidx = 0;
+	int i;
+
+	pqpair.qpair.ctrlr = &pctrlr.ctrlr;
+	pqpair.cmd = cmd;
+	pqpair.num_entries = 64;
+	pqpair.sq_tdbl = &sq_tdbl;
+	pqpair.stat = &stat;
+	pqpair.flags.has_shadow_doorbell = 1;
+	pqpair.shadow_doorbell.sq_tdbl = &shadow_sq_tdbl;
+	pqpair.shadow_doorbell.sq_eventidx = &sq_eventidx;
+	tr.req = &req;
+
+	/* The controller asked to be notified once the tail moves past 0 */
+	nvme_pcie_qpair_submit_tracker(&pqpair.qpair, &tr);
+	CU_ASSERT(shadow_sq_tdbl == 1);
+	CU_ASSERT(sq_tdbl == 1);
+	CU_ASSERT(stat.sq_shadow_doorbell_updates == 1);
+	CU_ASSERT(stat.sq_mmio_doorbell_updates == 1);
+
+	/* Until it moves the event index, the shadow doorbell alone is written */
+	for (i = 0; i < 3; i++) {
+		nvme_pcie_qpair_submit_tracker(&pqpair.qpair, &tr);
+	}
+	CU_ASSERT(shadow_sq_tdbl == 4);
+	CU_ASSERT(sq_tdbl == 1);
+	CU_ASSERT(stat.sq_shadow_doorbell_updates == 4);
+	CU_ASSERT(stat.sq_mmio_doorbell_updates == 1);
+
+	/* Each doorbell write counts as a shadow update, the MMIO count is a subset of it */
+	sq_eventidx = 4;
+	nvme_pcie_qpair_submit_tracker(&pqpair.qpair, &tr);
+	CU_ASSERT(sq_tdbl == 5);
+	CU_ASSERT(stat.sq_shadow_doorbell_updates == 5);
+	CU_ASSERT(stat.sq_mmio_doorbell_updates == 2);
+	CU_ASSERT(spdk_max(stat.sq_shadow_doorbell_updates, stat.sq_mmio_doorbell_updates) == 5);
+}
+
 int
 main(int argc, char **argv)
 {
@@ -595,6 +844,9 @@ main(int argc, char **argv)
 	CU_ADD_TEST(suite, test_nvme_pcie_ctrlr_connect_qpair);
 	CU_ADD_TEST(suite, test_nvme_pcie_ctrlr_construct_admin_qpair);
 	CU_ADD_TEST(suite, test_nvme_pcie_poll_group_get_stats);
+	CU_ADD_TEST(suite, test_nvme_pcie_poll_group_process_completions);
+	CU_ADD_TEST(suite, test_nvme_pcie_qpair_adaptive_sq_doorbell);
+	CU_ADD_TEST(suite, test_nvme_pcie_qpair_shadow_sq_doorbell);
 
 	CU_basic_set_mode(CU_BRM_VERBOSE);
 	CU_basic_run_tests();
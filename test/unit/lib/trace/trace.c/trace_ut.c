@@ -0,0 +1,183 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (C) 2023 Intel Corporation.
+ *   All rights reserved.
+ */
+
+#include "spdk/stdinc.h"
+
+#include "spdk_cunit.h"
+#include "common/lib/test_env.c"
+
+#include "trace/trace.c"
+
+#define TEST_SHM_NAME		"/spdk_trace_ut"
+#define TEST_NUM_CORES		2
+#define TEST_NUM_ENTRIES	32
+#define TEST_NUM_THREADS	2
+#define TEST_TPOINT_ID		1
+
+struct ut_user_thread {
+	pthread_t	thread;
+	const char	*name;
+	int		register_rc;
+	int		unregister_rc;
+	uint32_t	history_idx;
+};
+
+static void
+ut_trace_init(void)
+{
+	int rc;
+
+	allocate_cores(TEST_NUM_CORES);
+	rc = spdk_trace_init(TEST_SHM_NAME, TEST_NUM_ENTRIES, TEST_NUM_THREADS);
+	SPDK_CU_ASSERT_FATAL(rc == 0);
+}
+
+static void
+ut_trace_cleanup(void)
+{
+	spdk_trace_cleanup();
+	shm_unlink(TEST_SHM_NAME);
+	free_cores();
+}
+
+static void *
+ut_user_thread_fn(void *ctx)
+{
+	struct ut_user_thread *thread = ctx;
+
+	pthread_setname_np(pthread_self(), thread->name);
+
+	thread->register_rc = spdk_trace_register_user_thread();
+	if (thread->register_rc == 0) {
+		thread->history_idx = t_user_thread_history->lcore;
+		_spdk_trace_record(0, TEST_TPOINT_ID, 0, 0, 0, 0);
+	}
+	thread->unregister_rc = spdk_trace_unregister_user_thread();
+
+	return NULL;
+}
+
+static void
+ut_user_thread_run(struct ut_user_thread *thread, const char *name)
+{
+	int rc;
+
+	thread->name = name;
+	thread->history_idx = UINT32_MAX;
+	rc = pthread_create(&thread->thread, NULL, ut_user_thread_fn, thread);
+	SPDK_CU_ASSERT_FATAL(rc == 0);
+	pthread_join(thread->thread, NULL);
+}
+
+static void
+test_register_user_thread(void)
+{
+	struct spdk_trace_history *history;
+	struct ut_user_thread thread;
+	uint32_t i;
+
+	ut_trace_init();
+
+	/* User thread histories follow the lcore ones */
+	for (i = 0; i < TEST_NUM_CORES + TEST_NUM_THREADS; ++i) {
+		history = spdk_get_per_lcore_history(g_trace_histories, i);
+		SPDK_CU_ASSERT_FATAL(history != NULL);
+		CU_ASSERT_EQUAL(history->lcore, (int)i);
+		CU_ASSERT_EQUAL(history->num_entries, TEST_NUM_ENTRIES);
+	}
+	CU_ASSERT_PTR_NULL(spdk_get_per_lcore_history(g_trace_histories, i));
+
+	/* Threads running on lcores use their lcore's history */
+	MOCK_SET(spdk_env_get_current_core, 0);
+	CU_ASSERT_EQUAL(spdk_trace_register_user_thread(), -EINVAL);
+	MOCK_CLEAR(spdk_env_get_current_core);
+
+	/* Nothing is recorded by a thread before it's registered */
+	_spdk_trace_record(0, TEST_TPOINT_ID, 0, 0, 0, 0);
+	for (i = 0; i < TEST_NUM_CORES + TEST_NUM_THREADS; ++i) {
+		history = spdk_get_per_lcore_history(g_trace_histories, i);
+		CU_ASSERT_EQUAL(history->next_entry, 0);
+	}
+
+	/* Unregistering a thread which isn't registered fails */
+	CU_ASSERT_EQUAL(spdk_trace_unregister_user_thread(), -ENOENT);
+
+	CU_ASSERT_EQUAL(spdk_trace_register_user_thread(), 0);
+	CU_ASSERT_EQUAL(spdk_trace_register_user_thread(), -EEXIST);
+	history = t_user_thread_history;
+	SPDK_CU_ASSERT_FATAL(history != NULL);
+	CU_ASSERT_EQUAL(history->lcore, TEST_NUM_CORES);
+
+	_spdk_trace_record(0, TEST_TPOINT_ID, 0, 0, 0, 0);
+	CU_ASSERT_EQUAL(history->next_entry, 1);
+	CU_ASSERT_EQUAL(history->tpoint_count[TEST_TPOINT_ID], 1);
+
+	/* Another thread gets the next history and its name is stored in the history */
+	ut_user_thread_run(&thread, "ut_thread");
+	CU_ASSERT_EQUAL(thread.register_rc, 0);
+	CU_ASSERT_EQUAL(thread.unregister_rc, 0);
+	CU_ASSERT_EQUAL(thread.history_idx, TEST_NUM_CORES + 1);
+	history = spdk_get_per_lcore_history(g_trace_histories, TEST_NUM_CORES + 1);
+	CU_ASSERT_STRING_EQUAL(history->thread_name, "ut_thread");
+	CU_ASSERT_EQUAL(history->next_entry, 1);
+
+	/* The history released by the thread can be taken by the next one, which keeps the entries */
+	ut_user_thread_run(&thread, "ut_thread2");
+	CU_ASSERT_EQUAL(thread.register_rc, 0);
+	CU_ASSERT_EQUAL(thread.history_idx, TEST_NUM_CORES + 1);
+	CU_ASSERT_STRING_EQUAL(history->thread_name, "ut_thread2");
+	CU_ASSERT_EQUAL(history->next_entry, 2);
+
+	/* No histories are left while this thread keeps the second one */
+	CU_ASSERT_EQUAL(spdk_trace_unregister_user_thread(), 0);
+	CU_ASSERT_PTR_NULL(t_user_thread_history);
+	CU_ASSERT_EQUAL(spdk_trace_register_user_thread(), 0);
+	CU_ASSERT_EQUAL(t_user_thread_history->lcore, TEST_NUM_CORES);
+	g_user_thread_used[TEST_NUM_CORES + 1] = true;
+	ut_user_thread_run(&thread, "ut_thread3");
+	CU_ASSERT_EQUAL(thread.register_rc, -ENOENT);
+	CU_ASSERT_EQUAL(thread.unregister_rc, -ENOENT);
+	g_user_thread_used[TEST_NUM_CORES + 1] = false;
+
+	CU_ASSERT_EQUAL(spdk_trace_unregister_user_thread(), 0);
+	ut_trace_cleanup();
+}
+
+static void
+test_init_num_threads(void)
+{
+	/* The user thread histories need to fit in the lcore slots left by the application */
+	allocate_cores(SPDK_TRACE_MAX_LCORE - 1);
+	CU_ASSERT_NOT_EQUAL(spdk_trace_init(TEST_SHM_NAME, TEST_NUM_ENTRIES, 2), 0);
+	CU_ASSERT_PTR_NULL(g_trace_histories);
+	free_cores();
+
+	/* Registration fails if tracing isn't enabled */
+	allocate_cores(TEST_NUM_CORES);
+	CU_ASSERT_EQUAL(spdk_trace_init(TEST_SHM_NAME, 0, TEST_NUM_THREADS), 0);
+	CU_ASSERT_EQUAL(spdk_trace_register_user_thread(), -ENOENT);
+	free_cores();
+}
+
+int
+main(int argc, char **argv)
+{
+	CU_pSuite suite = NULL;
+	unsigned int num_failures;
+
+	CU_set_error_action(CUEA_ABORT);
+	CU_initialize_registry();
+
+	suite = CU_add_suite("trace", NULL, NULL);
+	CU_ADD_TEST(suite, test_register_user_thread);
+	CU_ADD_TEST(suite, test_init_num_threads);
+
+	CU_basic_set_mode(CU_BRM_VERBOSE);
+	CU_basic_run_tests();
+	num_failures = CU_get_number_of_failures();
+	CU_cleanup_registry();
+
+	return num_failures;
+}
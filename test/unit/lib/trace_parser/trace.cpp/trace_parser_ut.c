@@ -0,0 +1,201 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (C) 2023 Intel Corporation.
+ *   All rights reserved.
+ */
+
+#include "spdk/stdinc.h"
+
+#include "spdk_cunit.h"
+#include "common/lib/test_env.c"
+
+#include "spdk/trace.h"
+#include "spdk/trace_parser.h"
+#include "spdk_internal/trace_defs.h"
+
+#define TEST_SHM_NAME		"/trace_parser_ut"
+#define TEST_NUM_ENTRIES	64
+
+/* An NVMe-oF TCP request, the bdev_io submitted for it and the NVMe request of the bdev_io */
+#define TEST_TCP_NEW		TRACE_TCP_REQUEST_STATE_NEW
+#define TEST_TCP_EXECUTING	TRACE_TCP_REQUEST_STATE_EXECUTING
+#define TEST_TCP_COMPLETED	TRACE_TCP_REQUEST_STATE_COMPLETED
+#define TEST_BDEV_START		TRACE_BDEV_IO_START
+#define TEST_BDEV_DONE		TRACE_BDEV_IO_DONE
+#define TEST_NVME_SUBMIT	TRACE_NVME_PCIE_SUBMIT
+#define TEST_NVME_COMPLETE	TRACE_NVME_PCIE_COMPLETE
+
+#define TEST_TCP_REQ0		0x1000
+#define TEST_TCP_REQ1		0x2000
+#define TEST_BDEV_IO0		0x3000
+#define TEST_BDEV_IO1		0x5000
+#define TEST_NVME_REQ		0x4000
+#define TEST_UNKNOWN		0x9000
+
+struct ut_entry {
+	uint64_t	tsc;
+	uint16_t	tpoint_id;
+	uint64_t	object_id;
+	uint64_t	arg;
+	/* Expected values */
+	uint64_t	object_index;
+	uint8_t		related_type;
+	uint64_t	related_index;
+};
+
+static const struct ut_entry g_entries[] = {
+	{ 100, TEST_TCP_NEW, TEST_TCP_REQ0, 0, 0, OBJECT_NONE, UINT64_MAX },
+	{ 110, TEST_TCP_NEW, TEST_TCP_REQ1, 0, 1, OBJECT_NONE, UINT64_MAX },
+	{ 120, TEST_TCP_EXECUTING, TEST_TCP_REQ0, 0, 0, OBJECT_NONE, UINT64_MAX },
+	{ 130, TEST_BDEV_START, TEST_BDEV_IO0, TEST_TCP_REQ0, 0, OBJECT_NVMF_TCP_IO, 0 },
+	{ 140, TEST_NVME_SUBMIT, TEST_NVME_REQ, TEST_BDEV_IO0, 0, OBJECT_BDEV_IO, 0 },
+	{ 170, TEST_NVME_COMPLETE, TEST_NVME_REQ, TEST_BDEV_IO0, 0, OBJECT_BDEV_IO, 0 },
+	{ 180, TEST_BDEV_DONE, TEST_BDEV_IO0, TEST_TCP_REQ0, 0, OBJECT_NVMF_TCP_IO, 0 },
+	{ 190, TEST_TCP_COMPLETED, TEST_TCP_REQ0, 0, 0, OBJECT_NONE, UINT64_MAX },
+	/* Reused objects get new indexes, which the relations follow */
+	{ 200, TEST_TCP_NEW, TEST_TCP_REQ0, 0, 2, OBJECT_NONE, UINT64_MAX },
+	{ 210, TEST_BDEV_START, TEST_BDEV_IO0, TEST_TCP_REQ0, 1, OBJECT_NVMF_TCP_IO, 2 },
+	{ 220, TEST_BDEV_START, TEST_BDEV_IO1, TEST_TCP_REQ1, 2, OBJECT_NVMF_TCP_IO, 1 },
+	/* Objects which weren't traced can't be related */
+	{ 230, TEST_BDEV_DONE, TEST_BDEV_IO1, TEST_UNKNOWN, 2, OBJECT_NONE, UINT64_MAX },
+};
+
+static void
+ut_register_tpoint(const char *name, uint16_t tpoint_id, uint8_t owner_type, uint8_t object_type,
+		   uint8_t new_object, const char *arg_name)
+{
+	struct spdk_trace_tpoint_opts opts = {
+		.name = name,
+		.tpoint_id = tpoint_id,
+		.owner_type = owner_type,
+		.object_type = object_type,
+		.new_object = new_object,
+		.args = {{
+				.name = arg_name,
+				.type = SPDK_TRACE_ARG_TYPE_PTR,
+				.size = sizeof(uint64_t),
+			}
+		}
+	};
+
+	spdk_trace_register_description_ext(&opts, 1);
+}
+
+static void
+ut_trace_init(void)
+{
+	size_t i;
+	int rc;
+
+	allocate_cores(1);
+	rc = spdk_trace_init(TEST_SHM_NAME, TEST_NUM_ENTRIES, 0);
+	SPDK_CU_ASSERT_FATAL(rc == 0);
+
+	spdk_trace_register_owner(OWNER_NVMF_TCP, 't');
+	spdk_trace_register_owner(OWNER_BDEV, 'b');
+	spdk_trace_register_owner(OWNER_NVME_PCIE_QP, 'q');
+	spdk_trace_register_object(OBJECT_NVMF_TCP_IO, 'r');
+	spdk_trace_register_object(OBJECT_BDEV_IO, 'i');
+	spdk_trace_register_object(OBJECT_NVME_PCIE_REQ, 'p');
+
+	ut_register_tpoint("TCP_REQ_NEW", TEST_TCP_NEW, OWNER_NVMF_TCP, OBJECT_NVMF_TCP_IO, 1, "");
+	ut_register_tpoint("TCP_REQ_EXECUTING", TEST_TCP_EXECUTING, OWNER_NVMF_TCP,
+			   OBJECT_NVMF_TCP_IO, 0, "");
+	ut_register_tpoint("TCP_REQ_COMPLETED", TEST_TCP_COMPLETED, OWNER_NVMF_TCP,
+			   OBJECT_NVMF_TCP_IO, 0, "");
+	ut_register_tpoint("BDEV_IO_START", TEST_BDEV_START, OWNER_BDEV, OBJECT_BDEV_IO, 1, "ctx");
+	ut_register_tpoint("BDEV_IO_DONE", TEST_BDEV_DONE, OWNER_BDEV, OBJECT_BDEV_IO, 0, "ctx");
+	ut_register_tpoint("NVME_PCIE_SUBMIT", TEST_NVME_SUBMIT, OWNER_NVME_PCIE_QP,
+			   OBJECT_NVME_PCIE_REQ, 1, "ctx");
+	ut_register_tpoint("NVME_PCIE_COMPLETE", TEST_NVME_COMPLETE, OWNER_NVME_PCIE_QP,
+			   OBJECT_NVME_PCIE_REQ, 0, "ctx");
+
+	spdk_trace_tpoint_register_relation(TEST_BDEV_START, OBJECT_NVMF_TCP_IO, 0);
+	spdk_trace_tpoint_register_relation(TEST_BDEV_DONE, OBJECT_NVMF_TCP_IO, 0);
+	spdk_trace_tpoint_register_relation(TEST_NVME_SUBMIT, OBJECT_BDEV_IO, 0);
+	spdk_trace_tpoint_register_relation(TEST_NVME_COMPLETE, OBJECT_BDEV_IO, 0);
+	spdk_trace_set_tpoint_group_mask((1ULL << TRACE_GROUP_NVMF_TCP) | (1ULL << TRACE_GROUP_BDEV) |
+					 (1ULL << TRACE_GROUP_NVME_PCIE));
+
+	MOCK_SET(spdk_env_get_current_core, 0);
+	for (i = 0; i < SPDK_COUNTOF(g_entries); ++i) {
+		if (g_entries[i].arg != 0) {
+			spdk_trace_record_tsc(g_entries[i].tsc, g_entries[i].tpoint_id, 0, 0,
+					      g_entries[i].object_id, g_entries[i].arg);
+		} else {
+			spdk_trace_record_tsc(g_entries[i].tsc, g_entries[i].tpoint_id, 0, 0,
+					      g_entries[i].object_id);
+		}
+	}
+	MOCK_CLEAR(spdk_env_get_current_core);
+}
+
+static void
+ut_trace_cleanup(void)
+{
+	spdk_trace_cleanup();
+	shm_unlink(TEST_SHM_NAME);
+	free_cores();
+}
+
+static void
+test_related_objects(void)
+{
+	struct spdk_trace_parser_opts opts = {};
+	struct spdk_trace_parser_entry entry;
+	struct spdk_trace_parser *parser;
+	const struct spdk_trace_flags *flags;
+	size_t i = 0;
+
+	ut_trace_init();
+
+	opts.filename = TEST_SHM_NAME;
+	opts.mode = SPDK_TRACE_PARSER_MODE_SHM;
+	opts.lcore = SPDK_TRACE_MAX_LCORE;
+	parser = spdk_trace_parser_init(&opts);
+	SPDK_CU_ASSERT_FATAL(parser != NULL);
+
+	flags = spdk_trace_parser_get_flags(parser);
+	CU_ASSERT_EQUAL(flags->tpoint[TEST_BDEV_START].related_objects[0].object_type,
+			OBJECT_NVMF_TCP_IO);
+	CU_ASSERT_EQUAL(flags->tpoint[TEST_NVME_SUBMIT].related_objects[0].object_type,
+			OBJECT_BDEV_IO);
+	CU_ASSERT_EQUAL(spdk_trace_parser_get_entry_count(parser, 0), TEST_NUM_ENTRIES);
+
+	while (spdk_trace_parser_next_entry(parser, &entry)) {
+		SPDK_CU_ASSERT_FATAL(i < SPDK_COUNTOF(g_entries));
+		CU_ASSERT_EQUAL(entry.entry->tsc, g_entries[i].tsc);
+		CU_ASSERT_EQUAL(entry.entry->tpoint_id, g_entries[i].tpoint_id);
+		CU_ASSERT_EQUAL(entry.entry->object_id, g_entries[i].object_id);
+		CU_ASSERT_EQUAL(entry.object_index, g_entries[i].object_index);
+		CU_ASSERT_EQUAL(entry.related_type, g_entries[i].related_type);
+		CU_ASSERT_EQUAL(entry.related_index, g_entries[i].related_index);
+		if (g_entries[i].arg != 0) {
+			CU_ASSERT_EQUAL(entry.args[0].integer, g_entries[i].arg);
+		}
+		i++;
+	}
+	CU_ASSERT_EQUAL(i, SPDK_COUNTOF(g_entries));
+
+	spdk_trace_parser_cleanup(parser);
+	ut_trace_cleanup();
+}
+
+int
+main(int argc, char **argv)
+{
+	CU_pSuite suite = NULL;
+	unsigned int num_failures;
+
+	CU_set_error_action(CUEA_ABORT);
+	CU_initialize_registry();
+
+	suite = CU_add_suite("trace_parser", NULL, NULL);
+	CU_ADD_TEST(suite, test_related_objects);
+
+	CU_basic_set_mode(CU_BRM_VERBOSE);
+	CU_basic_run_tests();
+	num_failures = CU_get_number_of_failures();
+	CU_cleanup_registry();
+
+	return num_failures;
+}
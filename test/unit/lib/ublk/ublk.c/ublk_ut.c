@@ -0,0 +1,701 @@
+/*   SPDX-License-Identifier: BSD-3-Clause
+ *   Copyright (C) 2023 Intel Corporation.
+ *   All rights reserved.
+ */
+
+#include "spdk/stdinc.h"
+#include "spdk/bdev_module.h"
+
+#include "spdk_internal/mock.h"
+
+#include "spdk_cunit.h"
+
+#include "common/lib/ut_multithread.c"
+#include "unit/lib/json_mock.c"
+
+#include <liburing.h>
+
+/*
+ * io_uring_get_sqe() is an inline function in recent liburing releases, so it can't be stubbed.
+ * Have ublk.c use the one of the test instead, liburing.h won't be included again.
+ */
+static struct io_uring_sqe *ut_io_uring_get_sqe(struct io_uring *ring);
+#define io_uring_get_sqe ut_io_uring_get_sqe
+#include "ublk/ublk.c"
+#undef io_uring_get_sqe
+
+DEFINE_STUB_V(spdk_bdev_close, (struct spdk_bdev_desc *desc));
+DEFINE_STUB(spdk_bdev_get_name, const char *, (const struct spdk_bdev *bdev), "Malloc0");
+DEFINE_STUB(spdk_bdev_get_data_block_size, uint32_t, (const struct spdk_bdev *bdev), 512);
+DEFINE_STUB(spdk_bdev_get_physical_block_size, uint32_t, (const struct spdk_bdev *bdev), 512);
+DEFINE_STUB(spdk_bdev_get_optimal_io_boundary, uint32_t, (const struct spdk_bdev *bdev), 0);
+DEFINE_STUB(spdk_bdev_get_num_blocks, uint64_t, (const struct spdk_bdev *bdev), 1024);
+DEFINE_STUB(spdk_bdev_io_type_supported, bool, (struct spdk_bdev *bdev,
+		enum spdk_bdev_io_type io_type), false);
+DEFINE_STUB(spdk_bdev_get_io_channel, struct spdk_io_channel *, (struct spdk_bdev_desc *desc),
+	    NULL);
+DEFINE_STUB_V(spdk_bdev_free_io, (struct spdk_bdev_io *bdev_io));
+DEFINE_STUB(spdk_bdev_queue_io_wait, int, (struct spdk_bdev *bdev, struct spdk_io_channel *ch,
+		struct spdk_bdev_io_wait_entry *entry), 0);
+DEFINE_STUB(spdk_bdev_flush_blocks, int, (struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+		uint64_t offset_blocks, uint64_t num_blocks, spdk_bdev_io_completion_cb cb,
+		void *cb_arg), 0);
+DEFINE_STUB(spdk_bdev_unmap_blocks, int, (struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
+		uint64_t offset_blocks, uint64_t num_blocks, spdk_bdev_io_completion_cb cb,
+		void *cb_arg), 0);
+DEFINE_STUB(spdk_bdev_write_zeroes_blocks, int, (struct spdk_bdev_desc *desc,
+		struct spdk_io_channel *ch, uint64_t offset_blocks, uint64_t num_blocks,
+		spdk_bdev_io_completion_cb cb, void *cb_arg), 0);
+DEFINE_STUB(io_uring_queue_init_params, int, (unsigned entries, struct io_uring *ring,
+		struct io_uring_params *p), 0);
+DEFINE_STUB_V(io_uring_queue_exit, (struct io_uring *ring));
+DEFINE_STUB(io_uring_submit, int, (struct io_uring *ring), 0);
+DEFINE_STUB(io_uring_register_files, int, (struct io_uring *ring, const int *files,
+		unsigned nr_files), 0);
+DEFINE_STUB(io_uring_unregister_files, int, (struct io_uring *ring), 0);
+DEFINE_STUB(__io_uring_get_cqe, int, (struct io_uring *ring, struct io_uring_cqe **cqe_ptr,
+				      unsigned submit, unsigned wait_nr, sigset_t *sigmask), 0);
+
+#define UT_QUEUE_DEPTH	4
+
+static struct spdk_bdev g_bdev;
+static struct spdk_bdev_desc *g_bdev_desc = (struct spdk_bdev_desc *)0xdeadbeef;
+
+/* The SQEs of the rings are 128 bytes long */
+static struct io_uring_sqe g_sqe[2];
+static struct io_uring_sqe *g_sqe_ptr;
+
+/* Last read or write submitted to the bdev */
+static struct {
+	void				*buf;
+	uint64_t			offset_blocks;
+	uint64_t			num_blocks;
+	spdk_bdev_io_completion_cb	cb;
+	void				*cb_arg;
+	uint32_t			count;
+} g_bdev_rw;
+
+static struct io_uring_sqe *
+ut_io_uring_get_sqe(struct io_uring *ring)
+{
+	if (g_sqe_ptr != NULL) {
+		memset(g_sqe, 0, sizeof(g_sqe));
+	}
+
+	return g_sqe_ptr;
+}
+
+int
+spdk_bdev_open_ext(const char *bdev_name, bool write, spdk_bdev_event_cb_t event_cb,
+		   void *event_ctx, struct spdk_bdev_desc **desc)
+{
+	*desc = g_bdev_desc;
+
+	return 0;
+}
+
+struct spdk_bdev *
+spdk_bdev_desc_get_bdev(struct spdk_bdev_desc *desc)
+{
+	CU_ASSERT(desc == g_bdev_desc);
+
+	return &g_bdev;
+}
+
+static int
+ut_bdev_rw(void *buf, uint64_t offset_blocks, uint64_t num_blocks,
+	   spdk_bdev_io_completion_cb cb, void *cb_arg)
+{
+	g_bdev_rw.buf = buf;
+	g_bdev_rw.offset_blocks = offset_blocks;
+	g_bdev_rw.num_blocks = num_blocks;
+	g_bdev_rw.cb = cb;
+	g_bdev_rw.cb_arg = cb_arg;
+	g_bdev_rw.count++;
+
+	return 0;
+}
+
+int
+spdk_bdev_read_blocks(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch, void *buf,
+		      uint64_t offset_blocks, uint64_t num_blocks,
+		      spdk_bdev_io_completion_cb cb, void *cb_arg)
+{
+	return ut_bdev_rw(buf, offset_blocks, num_blocks, cb, cb_arg);
+}
+
+int
+spdk_bdev_write_blocks(struct spdk_bdev_desc *desc, struct spdk_io_channel *ch, void *buf,
+		       uint64_t offset_blocks, uint64_t num_blocks,
+		       spdk_bdev_io_completion_cb cb, void *cb_arg)
+{
+	return ut_bdev_rw(buf, offset_blocks, num_blocks, cb, cb_arg);
+}
+
+static void
+ut_start_cb(void *cb_arg, int rc)
+{
+}
+
+static struct spdk_ublk_dev *
+ut_start_disk(bool user_copy)
+{
+	struct spdk_ublk_dev *ublk;
+	int rc;
+
+	rc = ublk_start_disk("Malloc0", 1, 1, UT_QUEUE_DEPTH, user_copy, ut_start_cb, NULL);
+	CU_ASSERT_EQUAL(rc, 0);
+	ublk = ublk_dev_find_by_id(1);
+	SPDK_CU_ASSERT_FATAL(ublk != NULL);
+
+	/* No SQE was available, so UBLK_CMD_ADD_DEV waits for the control ring */
+	CU_ASSERT_EQUAL(TAILQ_FIRST(&g_ublk_tgt.ctrl_wait_tailq), ublk);
+	CU_ASSERT_EQUAL(ublk->ctrl_cmd_op, UBLK_CMD_ADD_DEV);
+
+	return ublk;
+}
+
+static void
+ut_free_disk(struct spdk_ublk_dev *ublk)
+{
+	TAILQ_REMOVE(&g_ublk_tgt.ctrl_wait_tailq, ublk, wait_tailq);
+	ublk_free_dev(ublk);
+	CU_ASSERT(TAILQ_EMPTY(&g_ublk_bdevs));
+}
+
+static void
+test_user_copy_supported(void)
+{
+	g_ublk_tgt.features = 0;
+	CU_ASSERT(!ublk_user_copy_supported());
+
+	g_ublk_tgt.features = UBLK_F_USER_COPY | UBLK_F_URING_CMD_COMP_IN_TASK;
+	CU_ASSERT(ublk_user_copy_supported());
+
+	g_ublk_tgt.features = 0;
+}
+
+static void
+test_start_disk_user_copy(void)
+{
+	struct spdk_ublk_dev *ublk;
+	struct ublk_queue *q;
+	uint32_t i;
+
+	/* The kernel driver doesn't support user copy, the data is copied by the kernel */
+	g_ublk_tgt.features = 0;
+	ublk = ut_start_disk(true);
+	CU_ASSERT(!ublk->user_copy);
+	CU_ASSERT(!ublk_dev_get_user_copy(ublk));
+	CU_ASSERT_EQUAL(ublk->dev_info.flags & UBLK_F_USER_COPY, 0);
+	CU_ASSERT(ublk->dev_info.flags & UBLK_F_URING_CMD_COMP_IN_TASK);
+	CU_ASSERT_PTR_NOT_NULL(ublk->io_buf_pool);
+	q = &ublk->queues[0];
+	for (i = 0; i < UT_QUEUE_DEPTH; i++) {
+		CU_ASSERT_PTR_NOT_NULL(q->ios[i].payload);
+	}
+	ut_free_disk(ublk);
+
+	/* User copy supported, no buffers are allocated up front */
+	g_ublk_tgt.features = UBLK_F_USER_COPY;
+	ublk = ut_start_disk(true);
+	CU_ASSERT(ublk->user_copy);
+	CU_ASSERT(ublk_dev_get_user_copy(ublk));
+	CU_ASSERT(ublk->dev_info.flags & UBLK_F_USER_COPY);
+	CU_ASSERT(ublk->dev_info.flags & UBLK_F_URING_CMD_COMP_IN_TASK);
+	CU_ASSERT_PTR_NULL(ublk->io_buf_pool);
+	q = &ublk->queues[0];
+	for (i = 0; i < UT_QUEUE_DEPTH; i++) {
+		CU_ASSERT_PTR_NULL(q->ios[i].payload);
+		CU_ASSERT_EQUAL(q->ios[i].q, q);
+	}
+	ut_free_disk(ublk);
+
+	/* Supported but not asked for */
+	ublk = ut_start_disk(false);
+	CU_ASSERT(!ublk->user_copy);
+	CU_ASSERT_EQUAL(ublk->dev_info.flags & UBLK_F_USER_COPY, 0);
+	CU_ASSERT_PTR_NOT_NULL(ublk->io_buf_pool);
+	ut_free_disk(ublk);
+
+	g_ublk_tgt.features = 0;
+}
+
+static void
+test_user_copy_pos(void)
+{
+	CU_ASSERT_EQUAL(ublk_user_copy_pos(0, 0), UBLKSRV_IO_BUF_OFFSET);
+	CU_ASSERT_EQUAL(ublk_user_copy_pos(0, 1), UBLKSRV_IO_BUF_OFFSET + (1ULL << UBLK_TAG_OFF));
+	CU_ASSERT_EQUAL(ublk_user_copy_pos(3, 5), UBLKSRV_IO_BUF_OFFSET + (3ULL << UBLK_QID_OFF) +
+			(5ULL << UBLK_TAG_OFF));
+	/* The largest tag doesn't run into the queue id */
+	CU_ASSERT(ublk_user_copy_pos(0, UBLK_MAX_QUEUE_DEPTH - 1) < ublk_user_copy_pos(1, 0));
+}
+
+struct ut_user_copy_dev {
+	struct spdk_ublk_dev		ublk;
+	struct ublk_thread_ctx		thread_ctx;
+	struct ublk_queue		q;
+	struct ublk_io			ios[UT_QUEUE_DEPTH];
+	struct ublksrv_io_desc		iods[UT_QUEUE_DEPTH];
+};
+
+static void
+ut_user_copy_dev_init(struct ut_user_copy_dev *dev, bool user_copy)
+{
+	uint32_t i;
+	int rc;
+
+	memset(dev, 0, sizeof(*dev));
+	dev->ublk.bdev = &g_bdev;
+	dev->ublk.bdev_desc = g_bdev_desc;
+	dev->ublk.user_copy = user_copy;
+	dev->q.dev = &dev->ublk;
+	dev->q.q_id = 1;
+	dev->q.q_depth = UT_QUEUE_DEPTH;
+	dev->q.ios = dev->ios;
+	dev->q.io_cmd_buf = dev->iods;
+	dev->q.thread_ctx = &dev->thread_ctx;
+	TAILQ_INIT(&dev->q.completed_io_list);
+	TAILQ_INIT(&dev->q.inflight_io_list);
+	for (i = 0; i < UT_QUEUE_DEPTH; i++) {
+		dev->ios[i].q = &dev->q;
+	}
+
+	rc = spdk_iobuf_channel_init(&dev->thread_ctx.iobuf_ch, "ublk", 0, 0);
+	CU_ASSERT_EQUAL(rc, 0);
+}
+
+static void
+ut_user_copy_dev_fini(struct ut_user_copy_dev *dev)
+{
+	spdk_iobuf_channel_fini(&dev->thread_ctx.iobuf_ch);
+}
+
+/* Emulate the request fetched by ublk_io_recv() */
+static struct ublk_io *
+ut_recv_io(struct ut_user_copy_dev *dev, uint16_t tag, uint8_t op, uint64_t start_sector,
+	   uint32_t nr_sectors)
+{
+	struct ublk_io *io = &dev->ios[tag];
+
+	dev->iods[tag].op_flags = op;
+	dev->iods[tag].start_sector = start_sector;
+	dev->iods[tag].nr_sectors = nr_sectors;
+	TAILQ_INSERT_TAIL(&dev->q.inflight_io_list, io, tailq);
+	memset(&g_bdev_rw, 0, sizeof(g_bdev_rw));
+	ublk_handle_io(&dev->q, tag);
+
+	return io;
+}
+
+static void
+ut_check_user_copy_sqe(struct ut_user_copy_dev *dev, uint16_t tag, uint8_t opcode)
+{
+	struct ublk_io *io = &dev->ios[tag];
+
+	CU_ASSERT_EQUAL(g_sqe[0].opcode, opcode);
+	CU_ASSERT_EQUAL(g_sqe[0].fd, 0);
+	CU_ASSERT(g_sqe[0].flags & IOSQE_FIXED_FILE);
+	CU_ASSERT_EQUAL(g_sqe[0].addr, (uintptr_t)io->payload);
+	CU_ASSERT_EQUAL(g_sqe[0].len, io->payload_size);
+	CU_ASSERT_EQUAL(g_sqe[0].off, ublk_user_copy_pos(dev->q.q_id, tag));
+	CU_ASSERT_EQUAL(g_sqe[0].user_data, build_user_data(tag, UBLK_IO_USER_COPY));
+}
+
+static void
+test_user_copy_io(void)
+{
+	struct ut_user_copy_dev dev;
+	struct ublk_io *io;
+
+	g_sqe_ptr = g_sqe;
+	ut_user_copy_dev_init(&dev, true);
+
+	/* Read: the bdev fills an iobuf buffer, which is then written into the request */
+	io = ut_recv_io(&dev, 1, UBLK_IO_OP_READ, 16, 8);
+	CU_ASSERT_EQUAL(io->payload_size, 4096);
+	SPDK_CU_ASSERT_FATAL(io->payload != NULL);
+	CU_ASSERT_EQUAL(g_bdev_rw.count, 1);
+	CU_ASSERT_EQUAL(g_bdev_rw.buf, io->payload);
+	CU_ASSERT_EQUAL(g_bdev_rw.offset_blocks, 16);
+	CU_ASSERT_EQUAL(g_bdev_rw.num_blocks, 8);
+	CU_ASSERT_EQUAL(dev.q.cmd_inflight, 0);
+
+	g_bdev_rw.cb((struct spdk_bdev_io *)0x1, true, g_bdev_rw.cb_arg);
+	ut_check_user_copy_sqe(&dev, 1, IORING_OP_WRITE);
+	CU_ASSERT_EQUAL(dev.q.cmd_inflight, 1);
+	CU_ASSERT_EQUAL(dev.q.user_copy_pending, 1);
+
+	ublk_user_copy_done(&dev.q, 1, 4096);
+	dev.q.cmd_inflight--;
+	CU_ASSERT_PTR_NULL(io->payload);
+	CU_ASSERT_EQUAL(io->result, 4096);
+	CU_ASSERT_EQUAL(io->cmd_op, UBLK_IO_COMMIT_AND_FETCH_REQ);
+	CU_ASSERT_EQUAL(TAILQ_FIRST(&dev.q.completed_io_list), io);
+	CU_ASSERT_EQUAL(dev.q.stat.read_ops, 1);
+	CU_ASSERT_EQUAL(dev.q.stat.bytes_read, 4096);
+	TAILQ_REMOVE(&dev.q.completed_io_list, io, tailq);
+
+	/* Write: the request data is read into an iobuf buffer first, then written to the bdev */
+	dev.q.user_copy_pending = 0;
+	io = ut_recv_io(&dev, 2, UBLK_IO_OP_WRITE, 0, 16);
+	CU_ASSERT_EQUAL(io->payload_size, 8192);
+	SPDK_CU_ASSERT_FATAL(io->payload != NULL);
+	CU_ASSERT_EQUAL(g_bdev_rw.count, 0);
+	ut_check_user_copy_sqe(&dev, 2, IORING_OP_READ);
+	CU_ASSERT_EQUAL(dev.q.user_copy_pending, 1);
+
+	ublk_user_copy_done(&dev.q, 2, 8192);
+	dev.q.cmd_inflight--;
+	CU_ASSERT_EQUAL(g_bdev_rw.count, 1);
+	CU_ASSERT_EQUAL(g_bdev_rw.buf, io->payload);
+	CU_ASSERT_EQUAL(g_bdev_rw.offset_blocks, 0);
+	CU_ASSERT_EQUAL(g_bdev_rw.num_blocks, 16);
+	g_bdev_rw.cb((struct spdk_bdev_io *)0x1, true, g_bdev_rw.cb_arg);
+	CU_ASSERT_PTR_NULL(io->payload);
+	CU_ASSERT_EQUAL(io->result, 8192);
+	CU_ASSERT_EQUAL(dev.q.stat.write_ops, 1);
+	CU_ASSERT_EQUAL(dev.q.stat.bytes_written, 8192);
+	TAILQ_REMOVE(&dev.q.completed_io_list, io, tailq);
+
+	/* A short copy fails the request and releases the buffer */
+	io = ut_recv_io(&dev, 3, UBLK_IO_OP_WRITE, 0, 8);
+	SPDK_CU_ASSERT_FATAL(io->payload != NULL);
+	ublk_user_copy_done(&dev.q, 3, 512);
+	dev.q.cmd_inflight--;
+	CU_ASSERT_EQUAL(g_bdev_rw.count, 0);
+	CU_ASSERT_PTR_NULL(io->payload);
+	CU_ASSERT_EQUAL(io->result, -EIO);
+	CU_ASSERT_EQUAL(dev.q.stat.io_errors, 1);
+	TAILQ_REMOVE(&dev.q.completed_io_list, io, tailq);
+
+	/* Requests without data go straight to the bdev */
+	io = ut_recv_io(&dev, 0, UBLK_IO_OP_FLUSH, 0, 0);
+	CU_ASSERT_PTR_NULL(io->payload);
+	TAILQ_REMOVE(&dev.q.inflight_io_list, io, tailq);
+
+	CU_ASSERT(TAILQ_EMPTY(&dev.q.inflight_io_list));
+	CU_ASSERT(TAILQ_EMPTY(&dev.q.completed_io_list));
+	CU_ASSERT_EQUAL(dev.q.cmd_inflight, 0);
+	ut_user_copy_dev_fini(&dev);
+	g_sqe_ptr = NULL;
+}
+
+static void
+test_user_copy_io_cmd(void)
+{
+	struct ut_user_copy_dev dev;
+	struct ublksrv_io_cmd *cmd = (struct ublksrv_io_cmd *)ublk_get_sqe_cmd(&g_sqe[0]);
+	char buf[512];
+
+	g_sqe_ptr = g_sqe;
+
+	/* The kernel copies the data into the buffer passed with the command */
+	ut_user_copy_dev_init(&dev, false);
+	dev.ios[0].payload = buf;
+	dev.ios[0].io_free = true;
+	dev.ios[0].cmd_op = UBLK_IO_FETCH_REQ;
+	ublksrv_queue_io_cmd(&dev.q, &dev.ios[0], 0);
+	CU_ASSERT_EQUAL(g_sqe[0].opcode, IORING_OP_URING_CMD);
+	CU_ASSERT_EQUAL(cmd->addr, (uintptr_t)buf);
+	CU_ASSERT_EQUAL(cmd->tag, 0);
+	CU_ASSERT_EQUAL(cmd->q_id, 1);
+	ut_user_copy_dev_fini(&dev);
+
+	/* With user copy no buffer is passed */
+	ut_user_copy_dev_init(&dev, true);
+	dev.ios[2].io_free = true;
+	dev.ios[2].cmd_op = UBLK_IO_COMMIT_AND_FETCH_REQ;
+	dev.ios[2].result = 4096;
+	ublksrv_queue_io_cmd(&dev.q, &dev.ios[2], 2);
+	CU_ASSERT_EQUAL(g_sqe[0].opcode, IORING_OP_URING_CMD);
+	CU_ASSERT_EQUAL(cmd->addr, 0);
+	CU_ASSERT_EQUAL(cmd->tag, 2);
+	CU_ASSERT_EQUAL(cmd->result, 4096);
+	ut_user_copy_dev_fini(&dev);
+
+	g_sqe_ptr = NULL;
+}
+
+static int g_start_rc;
+static uint32_t g_start_count;
+
+static void
+ut_affinity_start_cb(void *cb_arg, int rc)
+{
+	g_start_rc = rc;
+	g_start_count++;
+}
+
+static struct spdk_ublk_dev *
+ut_affinity_dev_alloc(uint32_t num_queues)
+{
+	struct spdk_ublk_dev *ublk;
+	uint32_t i;
+	int rc;
+
+	ublk = calloc(1, sizeof(*ublk));
+	SPDK_CU_ASSERT_FATAL(ublk != NULL);
+	ublk->queues = calloc(num_queues, sizeof(*ublk->queues));
+	SPDK_CU_ASSERT_FATAL(ublk->queues != NULL);
+	/* No /dev/ublkc device of this id, so the start fails once the affinity is known */
+	ublk->ublk_id = 10000;
+	ublk->cdev_fd = -1;
+	ublk->num_queues = num_queues;
+	ublk->app_thread = spdk_get_thread();
+	ublk->start_cb = ut_affinity_start_cb;
+	for (i = 0; i < num_queues; i++) {
+		ublk->queues[i].ring.ring_fd = -1;
+		/* The mask must be reset before the kernel fills it */
+		memset(&ublk->queues[i].cpuset, 0xff, sizeof(cpu_set_t));
+	}
+	rc = ublk_dev_list_register(ublk);
+	CU_ASSERT_EQUAL(rc, 0);
+
+	g_start_rc = 0;
+	g_start_count = 0;
+
+	return ublk;
+}
+
+static void
+ut_affinity_dev_free(struct spdk_ublk_dev *ublk)
+{
+	/* Complete the control commands, which would be done by ublk_ctrl_poller() */
+	spdk_poller_unregister(&g_ublk_tgt.ctrl_poller);
+	g_ublk_tgt.ctrl_ops_in_progress = 0;
+	ublk_free_dev(ublk);
+	CU_ASSERT(TAILQ_EMPTY(&g_ublk_bdevs));
+}
+
+static void
+test_get_queue_affinity(void)
+{
+	struct spdk_ublk_dev *ublk;
+	struct ublksrv_ctrl_cmd *cmd = (struct ublksrv_ctrl_cmd *)ublk_get_sqe_cmd(&g_sqe[0]);
+	uint32_t q_id;
+	int rc;
+
+	g_sqe_ptr = g_sqe;
+	ublk = ut_affinity_dev_alloc(3);
+
+	/* The queue affinity is asked for once the parameters are set */
+	rc = ublk_ctrl_cmd(ublk, UBLK_CMD_SET_PARAMS);
+	CU_ASSERT_EQUAL(rc, 0);
+	CU_ASSERT_EQUAL(g_sqe[0].off, UBLK_CMD_SET_PARAMS);
+	CU_ASSERT(ublk->next_state_fn == ublk_get_queue_affinity_done);
+	CU_ASSERT_EQUAL(ublk->ctrl_q_id, 0);
+
+	/* One UBLK_CMD_GET_QUEUE_AFFINITY per queue, in order */
+	for (q_id = 0; q_id < ublk->num_queues; q_id++) {
+		ublk->next_state_fn(ublk);
+		CU_ASSERT_EQUAL(g_start_count, 0);
+		CU_ASSERT_EQUAL(g_sqe[0].off, UBLK_CMD_GET_QUEUE_AFFINITY);
+		CU_ASSERT_EQUAL(cmd->dev_id, ublk->ublk_id);
+		CU_ASSERT_EQUAL(cmd->data[0], q_id);
+		CU_ASSERT_EQUAL(cmd->addr, (uintptr_t)&ublk->queues[q_id].cpuset);
+		CU_ASSERT_EQUAL(cmd->len, sizeof(cpu_set_t));
+		CU_ASSERT(ublk->next_state_fn == ublk_get_queue_affinity_done);
+		CU_ASSERT_EQUAL(CPU_COUNT(&ublk->queues[q_id].cpuset), 0);
+
+		/* The kernel maps two CPUs to each queue */
+		CPU_SET(q_id * 2, (cpu_set_t *)(uintptr_t)cmd->addr);
+		CPU_SET(q_id * 2 + 1, (cpu_set_t *)(uintptr_t)cmd->addr);
+	}
+
+	/* The last answer moves on to starting the device */
+	ublk->next_state_fn(ublk);
+	CU_ASSERT_EQUAL(g_start_count, 1);
+	CU_ASSERT(g_start_rc < 0);
+	CU_ASSERT_EQUAL(g_sqe[0].off, UBLK_CMD_DEL_DEV);
+	for (q_id = 0; q_id < ublk->num_queues; q_id++) {
+		CU_ASSERT_EQUAL(CPU_COUNT(&ublk->queues[q_id].cpuset), 2);
+		CU_ASSERT(CPU_ISSET(q_id * 2, &ublk->queues[q_id].cpuset));
+		CU_ASSERT(CPU_ISSET(q_id * 2 + 1, &ublk->queues[q_id].cpuset));
+	}
+	ut_affinity_dev_free(ublk);
+
+	/* A failed query only loses the placement preference, the start goes on */
+	ublk = ut_affinity_dev_alloc(2);
+	rc = ublk_ctrl_cmd(ublk, UBLK_CMD_SET_PARAMS);
+	CU_ASSERT_EQUAL(rc, 0);
+	ublk->next_state_fn(ublk);
+	CU_ASSERT_EQUAL(cmd->data[0], 0);
+	MOCK_SET(io_uring_submit, -EIO);
+	ublk->next_state_fn(ublk);
+	MOCK_CLEAR(io_uring_submit);
+	CU_ASSERT_EQUAL(ublk->ctrl_q_id, 1);
+	CU_ASSERT_EQUAL(g_start_count, 1);
+	CU_ASSERT(g_start_rc < 0);
+	ut_affinity_dev_free(ublk);
+
+	g_sqe_ptr = NULL;
+}
+
+#define UT_NUM_THREADS	4
+
+static void
+ut_set_thread_load(uint32_t *num_queues)
+{
+	uint32_t i;
+
+	for (i = 0; i < UT_NUM_THREADS; i++) {
+		g_ublk_tgt.thread_ctx[i].num_queues = num_queues[i];
+	}
+}
+
+static void
+test_queue_select_thread(void)
+{
+	struct ublk_thread_ctx *thread_ctx;
+	struct ublk_queue q = {};
+	uint32_t i, load[UT_NUM_THREADS];
+
+	g_ublk_tgt.thread_ctx = calloc(UT_NUM_THREADS, sizeof(*g_ublk_tgt.thread_ctx));
+	SPDK_CU_ASSERT_FATAL(g_ublk_tgt.thread_ctx != NULL);
+	for (i = 0; i < UT_NUM_THREADS; i++) {
+		g_ublk_tgt.thread_ctx[i].core = i;
+	}
+	g_num_ublk_threads = UT_NUM_THREADS;
+
+	/* The thread on the CPU mapped to the queue, even if it's the busiest one */
+	CPU_ZERO(&q.cpuset);
+	CPU_SET(2, &q.cpuset);
+	load[0] = 0;
+	load[1] = 0;
+	load[2] = 5;
+	load[3] = 0;
+	ut_set_thread_load(load);
+	thread_ctx = ublk_queue_select_thread(&q);
+	CU_ASSERT_EQUAL(thread_ctx, &g_ublk_tgt.thread_ctx[2]);
+
+	/* The least loaded of the threads on the mapped CPUs */
+	CPU_SET(1, &q.cpuset);
+	thread_ctx = ublk_queue_select_thread(&q);
+	CU_ASSERT_EQUAL(thread_ctx, &g_ublk_tgt.thread_ctx[1]);
+	load[1] = 6;
+	ut_set_thread_load(load);
+	thread_ctx = ublk_queue_select_thread(&q);
+	CU_ASSERT_EQUAL(thread_ctx, &g_ublk_tgt.thread_ctx[2]);
+
+	/* No thread runs on the mapped CPUs, the least loaded one is taken */
+	CPU_ZERO(&q.cpuset);
+	CPU_SET(UT_NUM_THREADS + 1, &q.cpuset);
+	load[0] = 3;
+	load[1] = 1;
+	load[2] = 2;
+	load[3] = 1;
+	ut_set_thread_load(load);
+	thread_ctx = ublk_queue_select_thread(&q);
+	CU_ASSERT_EQUAL(thread_ctx, &g_ublk_tgt.thread_ctx[1]);
+
+	/* Queues without affinity are spread evenly, as ublk_finish_start() counts them */
+	CPU_ZERO(&q.cpuset);
+	memset(load, 0, sizeof(load));
+	ut_set_thread_load(load);
+	for (i = 0; i < UT_NUM_THREADS * 2; i++) {
+		thread_ctx = ublk_queue_select_thread(&q);
+		CU_ASSERT_EQUAL(thread_ctx, &g_ublk_tgt.thread_ctx[i % UT_NUM_THREADS]);
+		thread_ctx->num_queues++;
+	}
+	for (i = 0; i < UT_NUM_THREADS; i++) {
+		CU_ASSERT_EQUAL(g_ublk_tgt.thread_ctx[i].num_queues, 2);
+	}
+
+	/* A single thread takes everything */
+	g_num_ublk_threads = 1;
+	CPU_SET(3, &q.cpuset);
+	thread_ctx = ublk_queue_select_thread(&q);
+	CU_ASSERT_EQUAL(thread_ctx, &g_ublk_tgt.thread_ctx[0]);
+
+	g_num_ublk_threads = 0;
+	free(g_ublk_tgt.thread_ctx);
+	g_ublk_tgt.thread_ctx = NULL;
+}
+
+static void
+test_get_cpu_numa_node(void)
+{
+	char path[64];
+	int node;
+
+	/* No such CPU */
+	CU_ASSERT_EQUAL(ublk_get_cpu_numa_node(CPU_SETSIZE * 4), -1);
+
+	/* The node is the one of the nodeN link in the CPU's sysfs directory, if there is one */
+	for (node = 0; node < 4; node++) {
+		snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/node%d", node);
+		if (access(path, F_OK) == 0) {
+			CU_ASSERT_EQUAL(ublk_get_cpu_numa_node(0), node);
+			break;
+		}
+	}
+}
+
+static int
+ublk_ut_init(void)
+{
+	int rc;
+
+	allocate_threads(1);
+	set_thread(0);
+
+	rc = spdk_iobuf_initialize();
+	if (rc != 0) {
+		return rc;
+	}
+
+	spdk_ublk_init();
+	TAILQ_INIT(&g_ublk_tgt.ctrl_wait_tailq);
+	g_ublk_tgt.active = true;
+
+	return 0;
+}
+
+static void
+ut_iobuf_finish_cb(void *ctx)
+{
+	*(bool *)ctx = true;
+}
+
+static int
+ublk_ut_fini(void)
+{
+	bool done = false;
+
+	g_ublk_tgt.active = false;
+	spdk_iobuf_finish(ut_iobuf_finish_cb, &done);
+	poll_threads();
+	CU_ASSERT(done);
+	free_threads();
+
+	return 0;
+}
+
+int
+main(int argc, char **argv)
+{
+	CU_pSuite suite = NULL;
+	unsigned int num_failures;
+
+	CU_set_error_action(CUEA_ABORT);
+	CU_initialize_registry();
+
+	suite = CU_add_suite("ublk", ublk_ut_init, ublk_ut_fini);
+	CU_ADD_TEST(suite, test_user_copy_supported);
+	CU_ADD_TEST(suite, test_start_disk_user_copy);
+	CU_ADD_TEST(suite, test_user_copy_pos);
+	CU_ADD_TEST(suite, test_user_copy_io);
+	CU_ADD_TEST(suite, test_user_copy_io_cmd);
+	CU_ADD_TEST(suite, test_get_queue_affinity);
+	CU_ADD_TEST(suite, test_queue_select_thread);
+	CU_ADD_TEST(suite, test_get_cpu_numa_node);
+
+	CU_basic_set_mode(CU_BRM_VERBOSE);
+	CU_basic_run_tests();
+	num_failures = CU_get_number_of_failures();
+	CU_cleanup_registry();
+
+	return num_failures;
+}
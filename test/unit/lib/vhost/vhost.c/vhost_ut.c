@@ -114,7 +114,18 @@ DEFINE_STUB_V(spdk_bdev_close, (struct spdk_bdev_desc *desc));
 DEFINE_STUB(spdk_bdev_queue_io_wait, int, (struct spdk_bdev *bdev, struct spdk_io_channel *ch,
 		struct spdk_bdev_io_wait_entry *entry), 0);
 DEFINE_STUB_V(spdk_bdev_free_io, (struct spdk_bdev_io *bdev_io));
-DEFINE_STUB(spdk_bdev_get_io_channel, struct spdk_io_channel *, (struct spdk_bdev_desc *desc), 0);
+
+static int g_ut_bdev_io_device;
+
+DEFINE_RETURN_MOCK(spdk_bdev_get_io_channel, struct spdk_io_channel *);
+struct spdk_io_channel *
+spdk_bdev_get_io_channel(struct spdk_bdev_desc *desc)
+{
+	HANDLE_RETURN_MOCK(spdk_bdev_get_io_channel);
+
+	return spdk_get_io_channel(&g_ut_bdev_io_device);
+}
+
 DEFINE_STUB(spdk_bdev_readv, int,
 	    (struct spdk_bdev_desc *desc, struct spdk_io_channel *ch,
 	     struct iovec *iov, int iovcnt, uint64_t offset, uint64_t nbytes,
@@ -130,6 +141,7 @@ DEFINE_STUB(rte_vhost_set_inflight_desc_packed, int, (int vid, uint16_t vring_id
 		uint16_t last, uint16_t *inflight_entry), 0);
 DEFINE_STUB(rte_vhost_slave_config_change, int, (int vid, bool need_reply), 0);
 DEFINE_STUB(spdk_json_decode_bool, int, (const struct spdk_json_val *val, void *out), 0);
+DEFINE_STUB(spdk_json_decode_uint32, int, (const struct spdk_json_val *val, void *out), 0);
 DEFINE_STUB(spdk_json_decode_object_relaxed, int,
 	    (const struct spdk_json_val *values, const struct spdk_json_object_decoder *decoders,
 	     size_t num_decoders, void *out), 0);
@@ -150,13 +162,27 @@ init_cb(int rc)
 	g_init_fail = rc;
 }
 
+static int
+ut_bdev_ch_create(void *io_device, void *ctx_buf)
+{
+	return 0;
+}
+
+static void
+ut_bdev_ch_destroy(void *io_device, void *ctx_buf)
+{
+}
+
 static int
 test_setup(void)
 {
 	allocate_cores(1);
-	allocate_threads(1);
+	allocate_threads(3);
 	set_thread(0);
 
+	spdk_io_device_register(&g_ut_bdev_io_device, ut_bdev_ch_create, ut_bdev_ch_destroy, 0,
+				"ut_bdev");
+
 	g_init_fail = true;
 	spdk_vhost_scsi_init(init_cb);
 	assert(g_init_fail == false);
@@ -188,6 +214,9 @@ test_cleanup(void)
 	poll_threads();
 	assert(g_fini_fail == false);
 
+	spdk_io_device_unregister(&g_ut_bdev_io_device, NULL);
+	poll_threads();
+
 	free_threads();
 	free_cores();
 
@@ -516,6 +545,114 @@ vq_avail_ring_get_test(void)
 	}
 }
 
+static void
+vq_event_idx_test(void)
+{
+	struct spdk_vhost_session vs = {};
+	struct spdk_vhost_virtqueue vq = {};
+	uint16_t avail_mem[35] = {};
+	uint64_t used_mem[34] = {};
+
+	vs.negotiated_features = 1ULL << VIRTIO_RING_F_EVENT_IDX;
+	vq.vsession = &vs;
+	vq.vring.avail = (struct vring_avail *)avail_mem;
+	vq.vring.used = (struct vring_used *)used_mem;
+	vq.vring.size = 32;
+
+	/* Nothing has been signalled yet, so the first event is never suppressed */
+	vq.last_used_idx = 3;
+	CU_ASSERT(vhost_vq_event_is_suppressed(&vq) == false);
+	CU_ASSERT(vq.signalled_used == 3);
+
+	/* The guest wants an event only after the used entry 10 */
+	*vhost_vq_used_event(&vq) = 10;
+	vq.last_used_idx = 8;
+	vq.used_req_cnt = 5;
+	CU_ASSERT(vhost_vq_event_is_suppressed(&vq) == true);
+	CU_ASSERT(vq.stats.irqs_suppressed == 1);
+
+	vq.last_used_idx = 12;
+	CU_ASSERT(vhost_vq_event_is_suppressed(&vq) == false);
+
+	/* No new used entries since the last check */
+	vq.used_req_cnt = 0;
+	CU_ASSERT(vhost_vq_event_is_suppressed(&vq) == true);
+	CU_ASSERT(vq.stats.irqs_suppressed == 1);
+
+	/* The used index wraps around past the event index */
+	vq.last_used_idx = 65530;
+	*vhost_vq_used_event(&vq) = 65529;
+	CU_ASSERT(vhost_vq_event_is_suppressed(&vq) == false);
+	*vhost_vq_used_event(&vq) = 65535;
+	vq.last_used_idx = 65533;
+	CU_ASSERT(vhost_vq_event_is_suppressed(&vq) == true);
+	vq.last_used_idx = 4;
+	CU_ASSERT(vhost_vq_event_is_suppressed(&vq) == false);
+
+	/* Enabling kicks asks the guest to kick on the next available entry */
+	vq.last_avail_idx = 17;
+	vhost_vq_set_guest_notify(&vs, &vq, false);
+	CU_ASSERT(vq.vring.used->flags == VRING_USED_F_NO_NOTIFY);
+	CU_ASSERT(*vhost_vq_avail_event(&vq) == 0);
+	vhost_vq_set_guest_notify(&vs, &vq, true);
+	CU_ASSERT(vq.vring.used->flags == 0);
+	CU_ASSERT(*vhost_vq_avail_event(&vq) == 17);
+
+	/* Without the feature, the guest's flags decide */
+	vs.negotiated_features = 0;
+	vq.vring.avail->flags = VRING_AVAIL_F_NO_INTERRUPT;
+	CU_ASSERT(vhost_vq_event_is_suppressed(&vq) == true);
+	vq.vring.avail->flags = 0;
+	CU_ASSERT(vhost_vq_event_is_suppressed(&vq) == false);
+}
+
+static void
+vq_used_ring_batch_test(void)
+{
+	struct spdk_vhost_session vs = {};
+	struct spdk_vhost_virtqueue vq = {};
+	uint64_t used_mem[34] = {};
+	uint16_t i;
+
+	vq.vsession = &vs;
+	vq.vring.used = (struct vring_used *)used_mem;
+	vq.vring.size = 32;
+	vq.last_used_idx = 30;
+	vq.vring.used->idx = 30;
+	vq.used_batch = true;
+
+	/* Entries are written, but not published until the flush */
+	for (i = 0; i < 4; i++) {
+		vhost_vq_used_ring_enqueue(&vs, &vq, i, 512 * i);
+	}
+	CU_ASSERT(vq.last_used_idx == 34);
+	CU_ASSERT(vq.used_req_cnt == 4);
+	CU_ASSERT(vq.vring.used->idx == 30);
+	CU_ASSERT(vq.vring.used->ring[31].id == 1);
+	CU_ASSERT(vq.vring.used->ring[1].id == 3);
+	CU_ASSERT(vq.vring.used->ring[1].len == 1536);
+
+	vhost_vq_used_ring_flush(&vs, &vq);
+	CU_ASSERT(vq.vring.used->idx == 34);
+
+	/* Publishing is done along with the guest notification */
+	vhost_vq_used_ring_enqueue(&vs, &vq, 5, 0);
+	CU_ASSERT(vq.vring.used->idx == 34);
+	vhost_vq_used_signal(&vs, &vq);
+	CU_ASSERT(vq.vring.used->idx == 35);
+	CU_ASSERT(vq.used_req_cnt == 0);
+
+	/* Interrupt mode publishes each entry right away */
+	vs.interrupt_mode = true;
+	vhost_vq_used_ring_enqueue(&vs, &vq, 6, 0);
+	CU_ASSERT(vq.vring.used->idx == 36);
+	vs.interrupt_mode = false;
+
+	vq.used_batch = false;
+	vhost_vq_used_ring_enqueue(&vs, &vq, 7, 0);
+	CU_ASSERT(vq.vring.used->idx == 37);
+}
+
 static bool
 vq_desc_guest_is_used(struct spdk_vhost_virtqueue *vq, int16_t guest_last_used_idx,
 		      int16_t guest_used_phase)
@@ -657,6 +794,340 @@ vq_packed_ring_test(void)
 	CU_ASSERT(guest_avail_phase == guest_used_phase);
 }
 
+#define UT_BLK_NUM_VQS	5
+#define UT_BLK_VQ_SIZE	4
+
+struct ut_blk_vq_mem {
+	struct vring_desc desc[UT_BLK_VQ_SIZE];
+	uint16_t avail[UT_BLK_VQ_SIZE + 3];
+	uint64_t used[UT_BLK_VQ_SIZE + 2];
+};
+
+static struct ut_blk_vq_mem g_blk_vq_mem[UT_BLK_NUM_VQS];
+static struct spdk_thread *g_blk_queue_threads[2];
+
+/* The no-bdev pollers are always busy, so poll_threads() wouldn't return */
+static void
+ut_poll_threads_times(void)
+{
+	uint32_t i, j;
+
+	for (i = 0; i < 4; i++) {
+		for (j = 0; j < g_ut_num_threads; j++) {
+			poll_thread_times(j, 8);
+		}
+	}
+}
+
+static struct spdk_vhost_blk_dev *
+ut_blk_dev_alloc(void)
+{
+	struct spdk_vhost_blk_dev *bvdev;
+	struct spdk_vhost_user_dev *user_dev;
+
+	bvdev = calloc(1, sizeof(*bvdev));
+	SPDK_CU_ASSERT_FATAL(bvdev != NULL);
+	user_dev = calloc(1, sizeof(*user_dev));
+	SPDK_CU_ASSERT_FATAL(user_dev != NULL);
+
+	g_blk_queue_threads[0] = g_ut_threads[1].thread;
+	g_blk_queue_threads[1] = g_ut_threads[2].thread;
+
+	bvdev->vdev.name = strdup("vdev_blk");
+	bvdev->vdev.backend = &vhost_blk_device_backend;
+	bvdev->vdev.thread = g_ut_threads[0].thread;
+	bvdev->vdev.ctxt = user_dev;
+	bvdev->bdev = (struct spdk_bdev *)0xDEADBEEF;
+	bvdev->queue_threads = g_blk_queue_threads;
+	bvdev->num_queue_threads = 3;
+
+	user_dev->vdev = &bvdev->vdev;
+	user_dev->user_backend = &vhost_blk_user_device_backend;
+	TAILQ_INIT(&user_dev->vsessions);
+	pthread_mutex_init(&user_dev->lock, NULL);
+
+	return bvdev;
+}
+
+static void
+ut_blk_dev_free(struct spdk_vhost_blk_dev *bvdev)
+{
+	struct spdk_vhost_user_dev *user_dev = to_user_dev(&bvdev->vdev);
+
+	CU_ASSERT(TAILQ_EMPTY(&user_dev->vsessions));
+	pthread_mutex_destroy(&user_dev->lock);
+	free(user_dev);
+	free(bvdev->vdev.name);
+	free(bvdev);
+}
+
+static struct spdk_vhost_blk_session *
+ut_blk_session_start(struct spdk_vhost_blk_dev *bvdev)
+{
+	struct spdk_vhost_blk_session *bvsession = NULL;
+	struct spdk_vhost_session *vsession;
+	struct spdk_vhost_virtqueue *vq;
+	uint16_t i;
+	int rc;
+
+	rc = posix_memalign((void **)&bvsession, 64, sizeof(*bvsession));
+	SPDK_CU_ASSERT_FATAL(rc == 0);
+	memset(bvsession, 0, sizeof(*bvsession));
+	memset(g_blk_vq_mem, 0, sizeof(g_blk_vq_mem));
+
+	vsession = &bvsession->vsession;
+	vsession->vdev = &bvdev->vdev;
+	vsession->name = "vdev_blk_session";
+	vsession->started = true;
+	vsession->max_queues = UT_BLK_NUM_VQS;
+	for (i = 0; i < UT_BLK_NUM_VQS; i++) {
+		vq = &vsession->virtqueue[i];
+		vq->vsession = vsession;
+		vq->vring_idx = i;
+		vq->vring.size = UT_BLK_VQ_SIZE;
+		vq->vring.desc = g_blk_vq_mem[i].desc;
+		vq->vring.avail = (struct vring_avail *)g_blk_vq_mem[i].avail;
+		vq->vring.used = (struct vring_used *)g_blk_vq_mem[i].used;
+		rc = alloc_vq_task_pool(vsession, i);
+		SPDK_CU_ASSERT_FATAL(rc == 0);
+	}
+	TAILQ_INSERT_TAIL(&to_user_dev(&bvdev->vdev)->vsessions, vsession, tailq);
+
+	rc = vhost_blk_start(&bvdev->vdev, vsession, NULL);
+	CU_ASSERT(rc == 0);
+	poll_threads();
+
+	return bvsession;
+}
+
+static void
+ut_blk_session_stop(struct spdk_vhost_blk_session *bvsession)
+{
+	struct spdk_vhost_session *vsession = &bvsession->vsession;
+	uint32_t i;
+	int rc;
+
+	rc = vhost_blk_stop(vsession->vdev, vsession, NULL);
+	CU_ASSERT(rc == 0);
+	for (i = 0; i < 4 && vsession->started; i++) {
+		spdk_delay_us(1000);
+		ut_poll_threads_times();
+	}
+
+	CU_ASSERT(vsession->started == false);
+	CU_ASSERT(sem_trywait(&g_dpdk_sem) == 0);
+	CU_ASSERT(g_dpdk_response == 0);
+	CU_ASSERT(bvsession->stop_poller == NULL);
+	CU_ASSERT(bvsession->io_channel == NULL);
+	CU_ASSERT(bvsession->qgroups == NULL);
+	CU_ASSERT(bvsession->num_qgroups == 0);
+	for (i = 0; i < UT_BLK_NUM_VQS; i++) {
+		CU_ASSERT(vsession->virtqueue[i].tasks == NULL);
+	}
+
+	TAILQ_REMOVE(&to_user_dev(vsession->vdev)->vsessions, vsession, tailq);
+	free(bvsession);
+}
+
+static void
+blk_qgroups_test(void)
+{
+	struct spdk_vhost_blk_dev *bvdev;
+	struct spdk_vhost_blk_session *bvsession;
+	struct spdk_vhost_session *vsession;
+	struct spdk_vhost_user_blk_task *tasks;
+	struct vhost_blk_queue_group *qgroup;
+	uint16_t i, j;
+
+	bvdev = ut_blk_dev_alloc();
+	bvsession = ut_blk_session_start(bvdev);
+	vsession = &bvsession->vsession;
+
+	/* The session thread takes virtqueues 0 and 3, each queue thread gets a group */
+	SPDK_CU_ASSERT_FATAL(bvsession->num_qgroups == 2);
+	CU_ASSERT(bvsession->num_qgroups_running == 2);
+	CU_ASSERT(spdk_io_channel_get_thread(bvsession->io_channel) == g_ut_threads[0].thread);
+	for (i = 0; i < bvsession->num_qgroups; i++) {
+		qgroup = &bvsession->qgroups[i];
+		CU_ASSERT(qgroup->thread == g_ut_threads[i + 1].thread);
+		CU_ASSERT(qgroup->first_vq == i + 1);
+		CU_ASSERT(qgroup->requestq_poller != NULL);
+		SPDK_CU_ASSERT_FATAL(qgroup->io_channel != NULL);
+		CU_ASSERT(spdk_io_channel_get_thread(qgroup->io_channel) == qgroup->thread);
+	}
+
+	for (i = 0; i < UT_BLK_NUM_VQS; i++) {
+		qgroup = i % 3 == 0 ? NULL : &bvsession->qgroups[i % 3 - 1];
+		tasks = vsession->virtqueue[i].tasks;
+		for (j = 0; j < UT_BLK_VQ_SIZE; j++) {
+			CU_ASSERT(tasks[j].qgroup == qgroup);
+		}
+	}
+
+	/* Each thread polls only its own virtqueues */
+	for (i = 0; i < UT_BLK_NUM_VQS; i++) {
+		vsession->virtqueue[i].stats.polls = 0;
+	}
+	poll_thread(1);
+	CU_ASSERT(vsession->virtqueue[0].stats.polls == 0);
+	CU_ASSERT(vsession->virtqueue[1].stats.polls == 1);
+	CU_ASSERT(vsession->virtqueue[2].stats.polls == 0);
+	CU_ASSERT(vsession->virtqueue[3].stats.polls == 0);
+	CU_ASSERT(vsession->virtqueue[4].stats.polls == 1);
+	poll_thread(2);
+	CU_ASSERT(vsession->virtqueue[0].stats.polls == 0);
+	CU_ASSERT(vsession->virtqueue[2].stats.polls == 1);
+	CU_ASSERT(vsession->virtqueue[3].stats.polls == 0);
+	poll_thread(0);
+	CU_ASSERT(vsession->virtqueue[0].stats.polls == 1);
+	CU_ASSERT(vsession->virtqueue[1].stats.polls == 1);
+	CU_ASSERT(vsession->virtqueue[3].stats.polls == 1);
+
+	/*
+	 * The coalescing stats of each virtqueue are checked on the thread polling it,
+	 * a check on one thread mustn't postpone the check of the other virtqueues.
+	 */
+	vsession->coalescing_delay_time_base = 100;
+	vsession->coalescing_io_rate_threshold = 1;
+	vsession->stats_check_interval = 1000;
+	for (i = 0; i < UT_BLK_NUM_VQS; i++) {
+		vsession->virtqueue[i].req_cnt = 9;
+	}
+
+	poll_thread(1);
+	CU_ASSERT(vsession->virtqueue[1].next_stats_check_time == spdk_get_ticks() + 1000);
+	CU_ASSERT(vsession->virtqueue[1].irq_delay_time != 0);
+	CU_ASSERT(vsession->virtqueue[4].next_stats_check_time == spdk_get_ticks() + 1000);
+	CU_ASSERT(vsession->virtqueue[4].irq_delay_time != 0);
+	CU_ASSERT(vsession->virtqueue[2].next_stats_check_time == 0);
+	CU_ASSERT(vsession->virtqueue[2].irq_delay_time == 0);
+
+	poll_thread(2);
+	CU_ASSERT(vsession->virtqueue[2].next_stats_check_time == spdk_get_ticks() + 1000);
+	CU_ASSERT(vsession->virtqueue[2].irq_delay_time != 0);
+	poll_thread(0);
+	CU_ASSERT(vsession->virtqueue[0].irq_delay_time != 0);
+	CU_ASSERT(vsession->virtqueue[3].irq_delay_time != 0);
+
+	/* The next check of a virtqueue waits for its own interval to pass */
+	vsession->virtqueue[2].req_cnt = 9;
+	vsession->virtqueue[2].irq_delay_time = 0;
+	poll_thread(2);
+	CU_ASSERT(vsession->virtqueue[2].irq_delay_time == 0);
+	spdk_delay_us(1000);
+	poll_thread(2);
+	CU_ASSERT(vsession->virtqueue[2].irq_delay_time != 0);
+	CU_ASSERT(vsession->virtqueue[2].next_stats_check_time == spdk_get_ticks() + 1000);
+
+	vsession->coalescing_delay_time_base = 0;
+	ut_blk_session_stop(bvsession);
+	ut_blk_dev_free(bvdev);
+}
+
+static void
+blk_qgroups_stop_test(void)
+{
+	struct spdk_vhost_blk_dev *bvdev;
+	struct spdk_vhost_blk_session *bvsession;
+	struct spdk_vhost_session *vsession;
+	uint32_t i;
+	int rc;
+
+	bvdev = ut_blk_dev_alloc();
+	bvsession = ut_blk_session_start(bvdev);
+	vsession = &bvsession->vsession;
+	SPDK_CU_ASSERT_FATAL(bvsession->num_qgroups == 2);
+
+	/* The session can't stop while a queue group still has requests in flight */
+	bvsession->qgroups[1].task_cnt = 1;
+	rc = vhost_blk_stop(&bvdev->vdev, vsession, NULL);
+	CU_ASSERT(rc == 0);
+	for (i = 0; i < 3; i++) {
+		spdk_delay_us(1000);
+		poll_threads();
+	}
+
+	CU_ASSERT(vsession->started == true);
+	CU_ASSERT(bvsession->stop_poller != NULL);
+	CU_ASSERT(bvsession->num_qgroups_running == 1);
+	CU_ASSERT(bvsession->qgroups[0].requestq_poller == NULL);
+	CU_ASSERT(bvsession->qgroups[0].io_channel == NULL);
+	CU_ASSERT(bvsession->qgroups[1].requestq_poller == NULL);
+	CU_ASSERT(bvsession->qgroups[1].io_channel != NULL);
+	CU_ASSERT(bvsession->io_channel != NULL);
+
+	rc = vhost_blk_stop(&bvdev->vdev, vsession, NULL);
+	CU_ASSERT(rc == -EINPROGRESS);
+
+	/* Once the last request completes, the group and then the session stop */
+	bvsession->qgroups[1].task_cnt = 0;
+	for (i = 0; i < 3; i++) {
+		spdk_delay_us(1000);
+		poll_threads();
+	}
+
+	CU_ASSERT(vsession->started == false);
+	CU_ASSERT(sem_trywait(&g_dpdk_sem) == 0);
+	CU_ASSERT(g_dpdk_response == 0);
+	CU_ASSERT(bvsession->stop_poller == NULL);
+	CU_ASSERT(bvsession->io_channel == NULL);
+	CU_ASSERT(bvsession->qgroups == NULL);
+	CU_ASSERT(bvsession->num_qgroups == 0);
+	CU_ASSERT(bvsession->num_qgroups_running == 0);
+
+	TAILQ_REMOVE(&to_user_dev(&bvdev->vdev)->vsessions, vsession, tailq);
+	free(bvsession);
+	ut_blk_dev_free(bvdev);
+}
+
+static bool g_bdev_remove_done;
+
+static void
+ut_bdev_remove_cpl(struct spdk_vhost_dev *vdev, void *ctx)
+{
+	g_bdev_remove_done = true;
+}
+
+static void
+blk_qgroups_hotremove_test(void)
+{
+	struct spdk_vhost_blk_dev *bvdev;
+	struct spdk_vhost_blk_session *bvsession;
+	uint32_t i;
+
+	bvdev = ut_blk_dev_alloc();
+	bvsession = ut_blk_session_start(bvdev);
+	SPDK_CU_ASSERT_FATAL(bvsession->num_qgroups == 2);
+
+	bvsession->qgroups[1].task_cnt = 1;
+	g_bdev_remove_done = false;
+	vhost_user_bdev_remove_cb(&bvdev->vdev, ut_bdev_remove_cpl, NULL);
+
+	/* The removal completes only after it passed through all the queue threads */
+	for (i = 0; i < 4; i++) {
+		poll_thread_times(0, 8);
+	}
+	CU_ASSERT(g_bdev_remove_done == false);
+
+	ut_poll_threads_times();
+	CU_ASSERT(g_bdev_remove_done == true);
+
+	/* The channels are released once the outstanding requests of each group complete */
+	CU_ASSERT(bvsession->requestq_poller != NULL);
+	CU_ASSERT(bvsession->io_channel == NULL);
+	CU_ASSERT(bvsession->qgroups[0].requestq_poller != NULL);
+	CU_ASSERT(bvsession->qgroups[0].io_channel == NULL);
+	CU_ASSERT(bvsession->qgroups[1].requestq_poller != NULL);
+	CU_ASSERT(bvsession->qgroups[1].io_channel != NULL);
+
+	bvsession->qgroups[1].task_cnt = 0;
+	ut_poll_threads_times();
+	CU_ASSERT(bvsession->qgroups[1].io_channel == NULL);
+
+	ut_blk_session_stop(bvsession);
+	ut_blk_dev_free(bvdev);
+}
+
 int
 main(int argc, char **argv)
 {
@@ -674,6 +1145,11 @@ main(int argc, char **argv)
 	CU_ADD_TEST(suite, remove_controller_test);
 	CU_ADD_TEST(suite, vq_avail_ring_get_test);
 	CU_ADD_TEST(suite, vq_packed_ring_test);
+	CU_ADD_TEST(suite, vq_event_idx_test);
+	CU_ADD_TEST(suite, vq_used_ring_batch_test);
+	CU_ADD_TEST(suite, blk_qgroups_test);
+	CU_ADD_TEST(suite, blk_qgroups_stop_test);
+	CU_ADD_TEST(suite, blk_qgroups_hotremove_test);
 
 	CU_basic_set_mode(CU_BRM_VERBOSE);
 	CU_basic_run_tests();
@@ -56,8 +56,11 @@ function unittest_ftl() {
 	$valgrind $testdir/lib/ftl/ftl_mngt/ftl_mngt_ut
 	$valgrind $testdir/lib/ftl/ftl_mempool.c/ftl_mempool_ut
 	$valgrind $testdir/lib/ftl/ftl_l2p/ftl_l2p_ut
+	$valgrind $testdir/lib/ftl/ftl_l2p_cache.c/ftl_l2p_cache_ut
 	$valgrind $testdir/lib/ftl/ftl_sb/ftl_sb_ut
 	$valgrind $testdir/lib/ftl/ftl_layout_upgrade/ftl_layout_upgrade_ut
+	$valgrind $testdir/lib/ftl/ftl_heat.c/ftl_heat_ut
+	$valgrind $testdir/lib/ftl/ftl_gc_policy.c/ftl_gc_policy_ut
 }
 
 function unittest_iscsi() {
@@ -227,10 +230,20 @@ if grep -q '#define SPDK_CONFIG_RAID5F 1' $rootdir/include/spdk/config.h; then
 	run_test "unittest_bdev_raid5f" $valgrind $testdir/lib/bdev/raid/raid5f.c/raid5f_ut
 fi
 
+if grep -q '#define SPDK_CONFIG_URING 1' $rootdir/include/spdk/config.h; then
+	run_test "unittest_bdev_uring" $valgrind $testdir/lib/bdev/uring.c/uring_ut
+fi
+
+if grep -q '#define SPDK_CONFIG_UBLK 1' $rootdir/include/spdk/config.h; then
+	run_test "unittest_ublk" $valgrind $testdir/lib/ublk/ublk.c/ublk_ut
+fi
+
 run_test "unittest_blob_blobfs" unittest_blob
 run_test "unittest_event" unittest_event
 if [ $(uname -s) = Linux ]; then
 	run_test "unittest_ftl" unittest_ftl
+	run_test "unittest_bdev_aio" $valgrind $testdir/lib/bdev/aio.c/aio_ut
+	run_test "unittest_nbd" $valgrind $testdir/lib/nbd/nbd.c/nbd_ut
 fi
 
 run_test "unittest_accel" $valgrind $testdir/lib/accel/accel.c/accel_ut
@@ -268,6 +281,8 @@ fi
 run_test "unittest_scsi" unittest_scsi
 run_test "unittest_sock" unittest_sock
 run_test "unittest_thread" $valgrind $testdir/lib/thread/thread.c/thread_ut
+run_test "unittest_trace" $valgrind $testdir/lib/trace/trace.c/trace_ut
+run_test "unittest_trace_parser" $valgrind $testdir/lib/trace_parser/trace.cpp/trace_parser_ut
 run_test "unittest_util" unittest_util
 if grep -q '#define SPDK_CONFIG_VHOST 1' $rootdir/include/spdk/config.h; then
 	run_test "unittest_vhost" $valgrind $testdir/lib/vhost/vhost.c/vhost_ut
@@ -275,6 +290,7 @@ fi
 run_test "unittest_dma" $valgrind $testdir/lib/dma/dma.c/dma_ut
 
 run_test "unittest_init" unittest_init
+run_test "unittest_bdevperf_replay" $valgrind $testdir/examples/bdev/bdevperf/bdevperf_replay.c/bdevperf_replay_ut
 
 if [ "$cov_avail" = "yes" ] && ! [[ "$CC_TYPE" == *"clang"* ]]; then
 	$LCOV -q -d . -c -t "$(hostname)" -o $UT_COVERAGE/ut_cov_test.info